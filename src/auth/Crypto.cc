@@ -168,6 +168,28 @@ public:
     return 0;
   }
 
+  int encrypt_block(const unsigned char *in, size_t in_len,
+		    unsigned char *out, size_t *out_len,
+		    std::string *error) const {
+    // pad manually and encrypt in place so we can skip the
+    // filter/sink pipeline and its allocations; the AES key schedule
+    // in enc_key is already cached
+    size_t pad = AES_BLOCK_LEN - in_len % AES_BLOCK_LEN;
+    size_t ct_len = in_len + pad;
+    if (ct_len > *out_len) {
+      if (error)
+	*error = "encrypt_block: output buffer too small";
+      return -ERANGE;
+    }
+    memcpy(out, in, in_len);
+    memset(out + in_len, pad, pad);
+    CryptoPP::CBC_Mode_ExternalCipher::Encryption cbc(
+      *enc_key, (const byte*)CEPH_AES_IV);
+    cbc.ProcessData((byte*)out, (const byte*)out, ct_len);
+    *out_len = ct_len;
+    return 0;
+  }
+
   int decrypt(const bufferlist& in,
 	      bufferlist& out, std::string *error) const {
     string decryptedtext;
@@ -319,6 +341,37 @@ public:
 	       bufferlist& out, std::string *error) const {
     return nss_aes_operation(CKA_DECRYPT, mechanism, key, param, in, out, error);
   }
+
+  int encrypt_block(const unsigned char *in, size_t in_len,
+		    unsigned char *out, size_t *out_len,
+		    std::string *error) const {
+    // same as nss_aes_operation, but straight into the caller's
+    // buffer; NSS still wants a fresh cipher context per operation,
+    // since a context cannot be reused after PK11_DigestFinal
+    PK11Context *ectx =
+      PK11_CreateContextBySymKey(mechanism, CKA_ENCRYPT, key, param);
+    assert(ectx);
+    int written = 0;
+    SECStatus ret = PK11_CipherOp(ectx, out, &written, *out_len,
+				  (unsigned char*)in, in_len);
+    if (ret == SECSuccess) {
+      unsigned int written2 = 0;
+      ret = PK11_DigestFinal(ectx, out + written, &written2,
+			     *out_len - written);
+      if (ret == SECSuccess)
+	*out_len = written + written2;
+    }
+    PK11_DestroyContext(ectx, PR_TRUE);
+    if (ret != SECSuccess) {
+      if (error) {
+	ostringstream oss;
+	oss << "NSS AES failed: " << PR_GetError();
+	*error = oss.str();
+      }
+      return -1;
+    }
+    return 0;
+  }
 };
 
 #else
@@ -41,6 +41,28 @@ public:
 		       bufferlist& out, std::string *error) const = 0;
   virtual int decrypt(const bufferlist& in,
 		       bufferlist& out, std::string *error) const = 0;
+
+  /*
+   * One-shot encrypt of a small block into a caller-provided buffer,
+   * bypassing the bufferlist round trips of encrypt().  *out_len holds
+   * the buffer size on entry and the ciphertext size on success.  Used
+   * on the per-message signing path; backends override this to avoid
+   * per-operation allocations.
+   */
+  virtual int encrypt_block(const unsigned char *in, size_t in_len,
+			    unsigned char *out, size_t *out_len,
+			    std::string *error) const {
+    bufferlist in_bl, out_bl;
+    in_bl.append(buffer::create_static(in_len, (char*)in));
+    int r = encrypt(in_bl, out_bl, error);
+    if (r < 0)
+      return r;
+    if (out_bl.length() > *out_len)
+      return -ERANGE;
+    out_bl.copy(0, out_bl.length(), (char*)out);
+    *out_len = out_bl.length();
+    return 0;
+  }
 };
 
 /*
@@ -113,6 +135,11 @@ public:
 	       std::string *error) const {
     return ckh->decrypt(in, out, error);
   }
+  int encrypt_block(CephContext *cct, const unsigned char *in, size_t in_len,
+		    unsigned char *out, size_t *out_len,
+		    std::string *error) const {
+    return ckh->encrypt_block(in, in_len, out, out_len, error);
+  }
 
   void to_str(std::string& s) const;
 };
@@ -44,17 +44,22 @@ int CephxSessionHandler::_calc_signature(Message *m, uint64_t *psig)
     1, AUTH_ENC_MAGIC, 4*4,
     header.crc, footer.front_crc, footer.middle_crc, footer.data_crc
   };
-  bufferlist bl_plaintext;
-  bl_plaintext.append(buffer::create_static(sizeof(sigblock), (char*)&sigblock));
-
-  bufferlist bl_ciphertext;
-  if (key.encrypt(cct, bl_plaintext, bl_ciphertext, NULL) < 0) {
-    lderr(cct) << __func__ << " failed to encrypt signature block" << dendl;
+  // sigblock is 29 bytes; AES-CBC pads it to 32.  Encrypt straight
+  // into a stack buffer so signing costs no allocations per message.
+  unsigned char sig_buf[64];
+  size_t sig_len = sizeof(sig_buf);
+  std::string error;
+  if (key.encrypt_block(cct, (const unsigned char *)&sigblock,
+			sizeof(sigblock), sig_buf, &sig_len, &error) < 0) {
+    lderr(cct) << __func__ << " failed to encrypt signature block: "
+	       << error << dendl;
     return -1;
   }
 
-  bufferlist::iterator ci = bl_ciphertext.begin();
-  ::decode(*psig, ci);
+  assert(sig_len >= sizeof(uint64_t));
+  __le64 sigle;
+  memcpy(&sigle, sig_buf, sizeof(sigle));
+  *psig = sigle;
 
   ldout(cct, 10) << __func__ << " seq " << m->get_seq()
 		 << " front_crc_ = " << footer.front_crc
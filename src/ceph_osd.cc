@@ -442,6 +442,9 @@ int main(int argc, const char **argv)
   boost::scoped_ptr<Throttle> client_msg_throttler(
     new Throttle(g_ceph_context, "osd_client_messages",
 		 g_conf->osd_client_message_cap));
+  boost::scoped_ptr<Throttle> recovery_byte_throttler(
+    new Throttle(g_ceph_context, "osd_recovery_bytes",
+		 g_conf->osd_recovery_message_size_cap));
 
   uint64_t supported =
     CEPH_FEATURE_UID | 
@@ -480,6 +483,11 @@ int main(int argc, const char **argv)
   ms_cluster->set_policy(entity_name_t::TYPE_OSD,
 			 Messenger::Policy::lossless_peer(supported,
 							  osd_required));
+  // cap in-memory bytes of low-priority (recovery/backfill) peer traffic
+  // separately, so it cannot starve higher priority cluster messages
+  ms_cluster->set_policy_throttlers(entity_name_t::TYPE_OSD,
+				    NULL, NULL,
+				    recovery_byte_throttler.get());
   ms_cluster->set_policy(entity_name_t::TYPE_CLIENT,
 			 Messenger::Policy::stateless_server(0, 0));
 
@@ -505,6 +513,14 @@ int main(int argc, const char **argv)
     ms_hb_front_server->set_socket_priority(SOCKET_PRIORITY_MIN_DELAY);
   }
 
+  if (!g_conf->osd_cluster_crc_data) {
+    // the cluster network is protected at the transport level; skip the
+    // data crc pass on replication traffic.  receivers honor the nocrc
+    // footer flag, so peers with crc enabled still interoperate.
+    ms_cluster->crcflags &= ~MSG_CRC_DATA;
+    ms_objecter->crcflags &= ~MSG_CRC_DATA;
+  }
+
   // hb back should bind to same ip as cluster_addr (if specified)
   entity_addr_t hb_back_addr = g_conf->osd_heartbeat_addr;
   if (hb_back_addr.is_blank_ip()) {
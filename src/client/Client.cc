@@ -193,6 +193,8 @@ Client::Client(Messenger *m, MonClient *mc)
 {
   monclient->set_messenger(m);
 
+  memset(&cached_statfs, 0, sizeof(cached_statfs));
+
   //
   root = 0;
 
@@ -2629,7 +2631,10 @@ Dentry* Client::link(Dir *dir, const string& name, Inode *in, Dentry *dn)
     dn->dir = dir;
     dir->dentries[dn->name] = dn;
     dir->dentry_list.push_back(&dn->item_dentry_list);
-    lru.lru_insert_mid(dn);    // mid or top?
+    if (in)
+      lru.lru_insert_mid(dn);    // mid or top?
+    else
+      lru.lru_insert_bot(dn);    // negative: age out before real dentries
 
     ldout(cct, 15) << "link dir " << dir->parent_inode << " '" << name << "' to inode " << in
 		   << " dn " << dn << " (new dn)" << dendl;
@@ -5135,6 +5140,29 @@ void Client::renew_caps(MetaSession *session)
 
 int Client::_do_lookup(Inode *dir, const string& name, InodeRef *target)
 {
+  pair<vinodeno_t, string> key(dir->vino(), name);
+  map<pair<vinodeno_t, string>, InflightMetaRequest*>::iterator q =
+    inflight_lookups.find(key);
+  if (q != inflight_lookups.end()) {
+    // an identical lookup is already on the wire; share its answer
+    InflightMetaRequest *ireq = q->second;
+    ireq->ref++;
+    ldout(cct, 10) << "_do_lookup joining in-flight lookup of " << name
+		   << " in " << dir->vino() << dendl;
+    while (!ireq->done)
+      ireq->cond.Wait(client_lock);
+    int r = ireq->result;
+    if (r == 0)
+      *target = ireq->target;
+    if (--ireq->ref == 0)
+      delete ireq;
+    ldout(cct, 10) << "_do_lookup coalesced res is " << r << dendl;
+    return r;
+  }
+
+  InflightMetaRequest *ireq = new InflightMetaRequest;
+  inflight_lookups[key] = ireq;
+
   int op = dir->snapid == CEPH_SNAPDIR ? CEPH_MDS_OP_LOOKUPSNAP : CEPH_MDS_OP_LOOKUP;
   MetaRequest *req = new MetaRequest(op);
   filepath path;
@@ -5147,6 +5175,15 @@ int Client::_do_lookup(Inode *dir, const string& name, InodeRef *target)
 
   int r = make_request(req, 0, 0, target);
   ldout(cct, 10) << "_do_lookup res is " << r << dendl;
+
+  inflight_lookups.erase(key);
+  ireq->done = true;
+  ireq->result = r;
+  if (r == 0)
+    ireq->target = *target;
+  ireq->cond.Signal();
+  if (--ireq->ref == 0)
+    delete ireq;
   return r;
 }
 
@@ -5222,6 +5259,9 @@ int Client::_lookup(Inode *dir, const string& dname, InodeRef *target)
     } else {
       ldout(cct, 20) << " no cap on " << dn->inode->vino() << dendl;
     }
+    // both the lease and the dir generation disown this dentry; let
+    // it drain out of the lru ahead of entries we still believe
+    lru.lru_bottouch(dn);
   } else {
     // can we conclude ENOENT locally?
     if (dir->caps_issued_mask(CEPH_CAP_FILE_SHARED) &&
@@ -5578,15 +5618,51 @@ int Client::_getattr(Inode *in, int mask, int uid, int gid, bool force)
   if (yes && !force)
     return 0;
 
+  if (!force) {
+    // piggyback on a getattr already in flight for this inode if it
+    // covers the caps we need; stat storms then cost one round trip
+    map<vinodeno_t, InflightMetaRequest*>::iterator q =
+      inflight_getattrs.find(in->vino());
+    if (q != inflight_getattrs.end() && (mask & ~q->second->mask) == 0) {
+      InflightMetaRequest *ireq = q->second;
+      ireq->ref++;
+      ldout(cct, 10) << "_getattr joining in-flight getattr on "
+		     << in->vino() << dendl;
+      while (!ireq->done)
+	ireq->cond.Wait(client_lock);
+      int res = ireq->result;
+      if (--ireq->ref == 0)
+	delete ireq;
+      ldout(cct, 10) << "_getattr coalesced result=" << res << dendl;
+      return res;
+    }
+  }
+
+  InflightMetaRequest *ireq = NULL;
+  if (inflight_getattrs.count(in->vino()) == 0) {
+    ireq = new InflightMetaRequest;
+    ireq->mask = mask;
+    inflight_getattrs[in->vino()] = ireq;
+  }
+
   MetaRequest *req = new MetaRequest(CEPH_MDS_OP_GETATTR);
   filepath path;
   in->make_nosnap_relative_path(path);
   req->set_filepath(path);
   req->set_inode(in);
   req->head.args.getattr.mask = mask;
-  
+
   int res = make_request(req, uid, gid);
   ldout(cct, 10) << "_getattr result=" << res << dendl;
+
+  if (ireq) {
+    inflight_getattrs.erase(in->vino());
+    ireq->done = true;
+    ireq->result = res;
+    ireq->cond.Signal();
+    if (--ireq->ref == 0)
+      delete ireq;
+  }
   return res;
 }
 
@@ -5833,7 +5909,13 @@ int Client::fill_stat(Inode *in, struct stat *st, frag_info_t *dirstat, nest_inf
 
 void Client::touch_dn(Dentry *dn)
 {
-  lru.lru_touch(dn);
+  if (dn->inode)
+    lru.lru_touch(dn);
+  else
+    // keep negative dentries below the lru midpoint: a tree scan can
+    // mint millions of them and they are cheap to refetch, so they
+    // should never push real dentries out of the cache
+    lru.lru_midtouch(dn);
 }
 
 int Client::chmod(const char *relpath, mode_t mode)
@@ -6186,6 +6268,7 @@ int Client::_readdir_get_frag(dir_result_t *dirp)
   req->set_filepath(path); 
   req->set_inode(diri.get());
   req->head.args.readdir.frag = fg;
+  req->head.args.readdir.max_bytes = cct->_conf->client_readdir_max_bytes;
   if (dirp->last_name.length()) {
     req->path2.set_path(dirp->last_name.c_str());
     req->readdir_start = dirp->last_name;
@@ -7129,22 +7212,26 @@ int Client::uninline_data(Inode *in, Context *onfinish)
 
 int Client::read(int fd, char *buf, loff_t size, loff_t offset)
 {
-  Mutex::Locker lock(client_lock);
-  tout(cct) << "read" << std::endl;
-  tout(cct) << fd << std::endl;
-  tout(cct) << size << std::endl;
-  tout(cct) << offset << std::endl;
+  bufferlist bl;
+  int r;
+  {
+    Mutex::Locker lock(client_lock);
+    tout(cct) << "read" << std::endl;
+    tout(cct) << fd << std::endl;
+    tout(cct) << size << std::endl;
+    tout(cct) << offset << std::endl;
 
-  Fh *f = get_filehandle(fd);
-  if (!f)
-    return -EBADF;
+    Fh *f = get_filehandle(fd);
+    if (!f)
+      return -EBADF;
 #if defined(__linux__) && defined(O_PATH)
-  if (f->flags & O_PATH)
-    return -EBADF;
+    if (f->flags & O_PATH)
+      return -EBADF;
 #endif
-  bufferlist bl;
-  int r = _read(f, offset, size, &bl);
-  ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+    r = _read(f, offset, size, &bl);
+    ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+  }
+  /* copy out to the caller without holding client_lock */
   if (r >= 0) {
     bl.copy(0, bl.length(), buf);
     r = bl.length();
@@ -7223,7 +7310,8 @@ retry:
   }
 
   if (!conf->client_debug_force_sync_read &&
-      (cct->_conf->client_oc && (have & CEPH_CAP_FILE_CACHE))) {
+      (cct->_conf->client_oc && (have & CEPH_CAP_FILE_CACHE)) &&
+      !(f->flags & O_DIRECT)) {
 
     if (f->flags & O_RSYNC) {
       _flush_range(in, offset, size);
@@ -7232,6 +7320,11 @@ retry:
     if (r < 0)
       goto done;
   } else {
+    if (cct->_conf->client_oc && (f->flags & O_DIRECT)) {
+      // cached writes through other handles must hit the osd before
+      // we read around the cache
+      _flush_range(in, offset, size);
+    }
     bool checkeof = false;
     r = _read_sync(f, offset, size, bl, &checkeof);
     if (r < 0)
@@ -7465,8 +7558,13 @@ void Client::sync_write_commit(InodeRef& in)
   in.reset(); // put inode inside client_lock
 }
 
-int Client::write(int fd, const char *buf, loff_t size, loff_t offset) 
+int Client::write(int fd, const char *buf, loff_t size, loff_t offset)
 {
+  /* copy the payload before taking client_lock */
+  bufferlist bl;
+  if (size > 0)
+    bl.append(buf, size);
+
   Mutex::Locker lock(client_lock);
   tout(cct) << "write" << std::endl;
   tout(cct) << fd << std::endl;
@@ -7480,7 +7578,7 @@ int Client::write(int fd, const char *buf, loff_t size, loff_t offset)
   if (fh->flags & O_PATH)
     return -EBADF;
 #endif
-  int r = _write(fh, offset, size, buf, NULL, 0);
+  int r = _write(fh, offset, size, bl);
   ldout(cct, 3) << "write(" << fd << ", \"...\", " << size << ", " << offset << ") = " << r << dendl;
   return r;
 }
@@ -7494,34 +7592,49 @@ int Client::pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset)
 
 int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write)
 {
-    Mutex::Locker lock(client_lock);
-    tout(cct) << fd << std::endl;
-    tout(cct) << offset << std::endl;
-
-    Fh *fh = get_filehandle(fd);
-    if (!fh)
-        return -EBADF;
-#if defined(__linux__) && defined(O_PATH)
-    if (fh->flags & O_PATH)
-        return -EBADF;
-#endif
     loff_t totallen = 0;
     for (unsigned i = 0; i < iovcnt; i++) {
         totallen += iov[i].iov_len;
     }
+
+    /* copy the payload before taking client_lock */
+    bufferlist wbl;
     if (write) {
-        int w = _write(fh, offset, totallen, NULL, iov, iovcnt);
-        ldout(cct, 3) << "pwritev(" << fd << ", \"...\", " << totallen << ", " << offset << ") = " << w << dendl;
-        return w;
-    } else {
-        bufferlist bl;
-        int r = _read(fh, offset, totallen, &bl);
+        for (unsigned i = 0; i < iovcnt; i++) {
+            if (iov[i].iov_len > 0)
+                wbl.append((const char *)iov[i].iov_base, iov[i].iov_len);
+        }
+    }
+
+    bufferlist bl;
+    int r;
+    {
+        Mutex::Locker lock(client_lock);
+        tout(cct) << fd << std::endl;
+        tout(cct) << offset << std::endl;
+
+        Fh *fh = get_filehandle(fd);
+        if (!fh)
+            return -EBADF;
+#if defined(__linux__) && defined(O_PATH)
+        if (fh->flags & O_PATH)
+            return -EBADF;
+#endif
+        if (write) {
+            int w = _write(fh, offset, totallen, wbl);
+            ldout(cct, 3) << "pwritev(" << fd << ", \"...\", " << totallen << ", " << offset << ") = " << w << dendl;
+            return w;
+        }
+        r = _read(fh, offset, totallen, &bl);
         ldout(cct, 3) << "preadv(" << fd << ", " <<  offset << ") = " << r << dendl;
+    }
+    /* copy out to the caller's iovs without holding client_lock */
+    if (r > 0) {
         int bufoff = 0;
         for (unsigned j = 0, resid = r; j < iovcnt && resid > 0; j++) {
                /*
-                * This piece of code aims to handle the case that bufferlist does not have enough data 
-                * to fill in the iov 
+                * This piece of code aims to handle the case that bufferlist does not have enough data
+                * to fill in the iov
                 */
                if (resid < iov[j].iov_len) {
                     bl.copy(bufoff, resid, (char *)iov[j].iov_base);
@@ -7532,12 +7645,16 @@ int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, in
                resid -= iov[j].iov_len;
                bufoff += iov[j].iov_len;
         }
-        return r;  
     }
+    return r;
 }
 
-int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
-                  const struct iovec *iov, int iovcnt)
+/* bl holds the payload, copied from the caller's memory *before*
+ * client_lock was taken (see write/pwritev/ll_write) -- the copy is
+ * needed anyway since the write may be resubmitted async, and doing it
+ * outside the lock keeps concurrent writers from serializing their
+ * memcpys on it */
+int Client::_write(Fh *f, int64_t offset, uint64_t size, bufferlist& bl)
 {
   if ((uint64_t)(offset+size) > mdsmap->get_max_filesize()) //too large!
     return -EFBIG;
@@ -7588,24 +7705,6 @@ int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
     assert(in->inline_version > 0);
   }
 
-  // copy into fresh buffer (since our write may be resub, async)
-  bufferlist bl;
-  bufferptr *bparr = NULL;
-  if (buf) {
-      bufferptr bp;
-      if (size > 0) bp = buffer::copy(buf, size);
-      bl.push_back( bp );
-  } else if (iov){
-      //iov case 
-      bparr = new bufferptr[iovcnt];
-      for (int i = 0; i < iovcnt; i++) {
-        if (iov[i].iov_len > 0) {
-            bparr[i] = buffer::copy((char*)iov[i].iov_base, iov[i].iov_len);
-        }
-        bl.push_back( bparr[i] );
-      }
-  }
-
   utime_t lat;
   uint64_t totalwritten;
   int have;
@@ -7652,7 +7751,8 @@ int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
     }
   }
 
-  if (cct->_conf->client_oc && (have & CEPH_CAP_FILE_BUFFER)) {
+  if (cct->_conf->client_oc && (have & CEPH_CAP_FILE_BUFFER) &&
+      !(f->flags & O_DIRECT)) {
     // do buffered write
     if (!in->oset.dirty_or_tx)
       get_cap_ref(in, CEPH_CAP_FILE_CACHE | CEPH_CAP_FILE_BUFFER);
@@ -7674,6 +7774,14 @@ int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
       _flush_range(in, offset, size);
     }
   } else {
+    if (cct->_conf->client_oc && (f->flags & O_DIRECT)) {
+      // keep the cache coherent with the data we are about to write
+      // around it: push out overlapping dirty buffers, then drop any
+      // clean copies so cached readers refetch from the osd
+      _flush_range(in, offset, size);
+      _invalidate_inode_cache(in, offset, size);
+    }
+
     // simple, non-atomic sync write
     Mutex flock("Client::_write flock");
     Cond cond;
@@ -7752,7 +7860,6 @@ done:
   }
 
   put_cap_ref(in, CEPH_CAP_FILE_WR);
-  delete[] bparr; 
   return r;
 }
 
@@ -7976,19 +8083,37 @@ int Client::statfs(const char *path, struct statvfs *stbuf)
 
   ceph_statfs stats;
 
-  Mutex lock("Client::statfs::lock");
-  Cond cond;
-  bool done;
-  int rval;
+  // df pollers (every container seems to grow one) can live with
+  // slightly stale usage numbers; don't bother the mon for every call
+  double ttl = cct->_conf->client_statfs_ttl;
+  utime_t now = ceph_clock_now(cct);
+  if (ttl > 0 &&
+      cached_statfs_stamp.sec() > 0 &&
+      now - cached_statfs_stamp <= ttl) {
+    ldout(cct, 10) << "statfs serving cached result, age "
+		   << (now - cached_statfs_stamp) << dendl;
+    stats = cached_statfs;
+  } else {
+    Mutex lock("Client::statfs::lock");
+    Cond cond;
+    bool done;
+    int rval;
 
-  objecter->get_fs_stats(stats, new C_SafeCond(&lock, &cond, &done, &rval));
+    objecter->get_fs_stats(stats, new C_SafeCond(&lock, &cond, &done, &rval));
 
-  client_lock.Unlock();
-  lock.Lock();
-  while (!done)
-    cond.Wait(lock);
-  lock.Unlock();
-  client_lock.Lock();
+    client_lock.Unlock();
+    lock.Lock();
+    while (!done)
+      cond.Wait(lock);
+    lock.Unlock();
+    client_lock.Lock();
+
+    if (rval < 0)
+      return rval;
+
+    cached_statfs = stats;
+    cached_statfs_stamp = ceph_clock_now(cct);
+  }
 
   memset(stbuf, 0, sizeof(*stbuf));
 
@@ -8012,7 +8137,7 @@ int Client::statfs(const char *path, struct statvfs *stbuf)
   stbuf->f_flag = 0;        // ??
   stbuf->f_namemax = NAME_MAX;
 
-  return rval;
+  return 0;
 }
 
 int Client::_do_filelock(Inode *in, Fh *fh, int lock_type, int op, int sleep,
@@ -10370,6 +10495,18 @@ int Client::ll_commit_blocks(Inode *in,
 }
 
 int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
+{
+  /* copy the payload before taking client_lock */
+  bufferlist bl;
+  if (len > 0)
+    bl.append(data, len);
+
+  return ll_write(fh, off, len, bl);
+}
+
+/* as above, but the payload was already copied into bl by the caller
+ * (outside client_lock); bl must not reference caller-owned memory */
+int Client::ll_write(Fh *fh, loff_t off, loff_t len, bufferlist& bl)
 {
   Mutex::Locker lock(client_lock);
   ldout(cct, 3) << "ll_write " << fh << " " << fh->inode->ino << " " << off <<
@@ -10379,7 +10516,7 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
   tout(cct) << off << std::endl;
   tout(cct) << len << std::endl;
 
-  int r = _write(fh, off, len, data, NULL, 0);
+  int r = _write(fh, off, len, bl);
   ldout(cct, 3) << "ll_write " << fh << " " << off << "~" << len << " = " << r
 		<< dendl;
   return r;
@@ -295,6 +295,22 @@ public:
   ceph_tid_t last_flush_seq;
   map<ceph_tid_t, MetaRequest*> mds_requests;
 
+  // coalescing of identical in-flight metadata requests.  when many
+  // threads stat or look up the same name at once (think parallel
+  // builds), the latecomers wait for the request that is already on
+  // the wire instead of each sending their own.
+  struct InflightMetaRequest {
+    int ref;
+    bool done;
+    int result;
+    int mask;         // getattr: caps mask being fetched
+    InodeRef target;  // lookup: resulting inode
+    Cond cond;
+    InflightMetaRequest() : ref(1), done(false), result(0), mask(0) {}
+  };
+  map<vinodeno_t, InflightMetaRequest*> inflight_getattrs;
+  map<pair<vinodeno_t, string>, InflightMetaRequest*> inflight_lookups;
+
   void dump_mds_requests(Formatter *f);
   void dump_mds_sessions(Formatter *f);
 
@@ -467,6 +483,10 @@ protected:
 
   Cond mount_cond, sync_cond;
 
+  // last statfs answer from the mon, served back within client_statfs_ttl
+  ceph_statfs cached_statfs;
+  utime_t cached_statfs_stamp;
+
 
   // friends
   friend class SyntheticClient;
@@ -688,8 +708,7 @@ private:
 
   loff_t _lseek(Fh *fh, loff_t offset, int whence);
   int _read(Fh *fh, int64_t offset, uint64_t size, bufferlist *bl);
-  int _write(Fh *fh, int64_t offset, uint64_t size, const char *buf,
-          const struct iovec *iov, int iovcnt);
+  int _write(Fh *fh, int64_t offset, uint64_t size, bufferlist& bl);
   int _preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write);
   int _flush(Fh *fh);
   int _fsync(Fh *fh, bool syncdataonly);
@@ -978,6 +997,7 @@ public:
 
   int ll_read(Fh *fh, loff_t off, loff_t len, bufferlist *bl);
   int ll_write(Fh *fh, loff_t off, loff_t len, const char *data);
+  int ll_write(Fh *fh, loff_t off, loff_t len, bufferlist& bl);
   loff_t ll_lseek(Fh *fh, loff_t offset, int whence);
   int ll_flush(Fh *fh);
   int ll_fsync(Fh *fh, bool syncdataonly);
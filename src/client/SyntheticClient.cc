@@ -138,6 +138,15 @@ void parse_syn_options(vector<const char*>& args)
         syn_iargs.push_back( atoi(args[++i]) );
         syn_iargs.push_back( atoi(args[++i]) );
         syn_iargs.push_back( atoi(args[++i]) );
+      } else if (strcmp(args[i],"mdsbench") == 0) {
+        syn_modes.push_back( SYNCLIENT_MODE_MDSBENCH );
+        syn_iargs.push_back( atoi(args[++i]) );  // ops
+        syn_iargs.push_back( atoi(args[++i]) );  // files
+        syn_iargs.push_back( atoi(args[++i]) );  // create %
+        syn_iargs.push_back( atoi(args[++i]) );  // stat %
+        syn_iargs.push_back( atoi(args[++i]) );  // readdir %
+        syn_iargs.push_back( atoi(args[++i]) );  // rename %
+        syn_iargs.push_back( atoi(args[++i]) );  // think time (us)
       } else if (strcmp(args[i],"makefiles") == 0) {
         syn_modes.push_back( SYNCLIENT_MODE_MAKEFILES );
         syn_iargs.push_back( atoi(args[++i]) );
@@ -522,6 +531,26 @@ int SyntheticClient::run()
       break;
 
 
+    case SYNCLIENT_MODE_MDSBENCH:
+      {
+        string sarg1 = get_sarg(0);
+        int iarg1 = iargs.front();  iargs.pop_front();
+        int iarg2 = iargs.front();  iargs.pop_front();
+        int iarg3 = iargs.front();  iargs.pop_front();
+        int iarg4 = iargs.front();  iargs.pop_front();
+        int iarg5 = iargs.front();  iargs.pop_front();
+        int iarg6 = iargs.front();  iargs.pop_front();
+        int iarg7 = iargs.front();  iargs.pop_front();
+        if (run_me()) {
+          dout(2) << "mdsbench " << sarg1 << " " << iarg1 << " " << iarg2
+		  << " " << iarg3 << "/" << iarg4 << "/" << iarg5 << "/" << iarg6
+		  << " " << iarg7 << dendl;
+          mds_bench(sarg1.c_str(), iarg1, iarg2, iarg3, iarg4, iarg5, iarg6, iarg7);
+        }
+	did_run_me();
+      }
+      break;
+
     case SYNCLIENT_MODE_THRASHLINKS:
       {
         string sarg1 = get_sarg(0);
@@ -1788,6 +1817,140 @@ int SyntheticClient::stat_dirs(const char *basedir, int dirs, int files, int dep
   
   return 0;
 }
+// log2-bucketed latency histogram: cheap to update per op, good
+// enough to read off approximate percentiles afterwards
+struct syn_lat_hist {
+  uint64_t count;
+  uint64_t sum_us;
+  uint64_t min_us, max_us;
+  uint64_t buckets[32];   // bucket i covers [2^i, 2^(i+1)) us
+
+  syn_lat_hist() : count(0), sum_us(0), min_us(0), max_us(0) {
+    memset(buckets, 0, sizeof(buckets));
+  }
+  void add(utime_t lat) {
+    uint64_t us = lat.to_nsec() / 1000;
+    if (!count || us < min_us)
+      min_us = us;
+    if (us > max_us)
+      max_us = us;
+    count++;
+    sum_us += us;
+    int b = 0;
+    while (us > 1 && b < 31) {
+      us >>= 1;
+      b++;
+    }
+    buckets[b]++;
+  }
+  uint64_t percentile(int pct) {
+    // upper edge of the bucket holding the pct'th sample
+    uint64_t need = (count * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b < 32; b++) {
+      seen += buckets[b];
+      if (seen >= need)
+	return (uint64_t)2 << b;
+    }
+    return max_us;
+  }
+  void report(int who, const char *op) {
+    if (!count)
+      return;
+    cout << "mdsbench client." << who << " op=" << op
+	 << " count=" << count
+	 << " avg_us=" << (sum_us / count)
+	 << " min_us=" << min_us
+	 << " p50_us=" << percentile(50)
+	 << " p90_us=" << percentile(90)
+	 << " p99_us=" << percentile(99)
+	 << " max_us=" << max_us
+	 << std::endl;
+  }
+};
+
+int SyntheticClient::mds_bench(const char *basedir, int ops, int files,
+			       int create_pct, int stat_pct, int readdir_pct, int rename_pct,
+			       int think_us)
+{
+  char d[500];
+  struct stat st;
+
+  client->mkdir(basedir, 0755);
+
+  int total_pct = create_pct + stat_pct + readdir_pct + rename_pct;
+  if (total_pct <= 0 || files <= 0) {
+    dout(0) << "mdsbench: bad op mix or file count" << dendl;
+    return -1;
+  }
+
+  syn_lat_hist create_lat, stat_lat, readdir_lat, rename_lat;
+  int created = 0;
+
+  utime_t run_s = ceph_clock_now(client->cct);
+  for (int i=0; i<ops; i++) {
+    if (time_to_stop()) break;
+
+    int r = rand() % total_pct;
+    utime_t s, e;
+
+    if (r < create_pct || created == 0) {
+      // create (also the fallback until something exists to operate on)
+      snprintf(d, sizeof(d), "%s/file.%d", basedir, created % files);
+      s = ceph_clock_now(client->cct);
+      client->mknod(d, 0644);
+      e = ceph_clock_now(client->cct);
+      e -= s;
+      create_lat.add(e);
+      created++;
+    } else if (r < create_pct + stat_pct) {
+      snprintf(d, sizeof(d), "%s/file.%d", basedir, rand() % MIN(created, files));
+      s = ceph_clock_now(client->cct);
+      client->lstat(d, &st);
+      e = ceph_clock_now(client->cct);
+      e -= s;
+      stat_lat.add(e);
+    } else if (r < create_pct + stat_pct + readdir_pct) {
+      list<string> contents;
+      s = ceph_clock_now(client->cct);
+      client->getdir(basedir, contents);
+      e = ceph_clock_now(client->cct);
+      e -= s;
+      readdir_lat.add(e);
+    } else {
+      int n = rand() % MIN(created, files);
+      snprintf(d, sizeof(d), "%s/file.%d", basedir, n);
+      char d2[500];
+      snprintf(d2, sizeof(d2), "%s/file.%d.renamed", basedir, n);
+      s = ceph_clock_now(client->cct);
+      client->rename(d, d2);
+      e = ceph_clock_now(client->cct);
+      e -= s;
+      rename_lat.add(e);
+      client->rename(d2, d);   // put it back, untimed
+    }
+
+    if (think_us > 0)
+      usleep(think_us);
+  }
+  utime_t run_e = ceph_clock_now(client->cct);
+  run_e -= run_s;
+
+  int who = client->get_nodeid().v;
+  cout << "mdsbench client." << who
+       << " ops=" << ops << " files=" << files
+       << " mix=" << create_pct << "/" << stat_pct << "/" << readdir_pct << "/" << rename_pct
+       << " think_us=" << think_us
+       << " elapsed_us=" << (run_e.to_nsec() / 1000)
+       << std::endl;
+  create_lat.report(who, "create");
+  stat_lat.report(who, "stat");
+  readdir_lat.report(who, "readdir");
+  rename_lat.report(who, "rename");
+
+  return 0;
+}
+
 int SyntheticClient::read_dirs(const char *basedir, int dirs, int files, int depth)
 {
   if (time_to_stop()) return 0;
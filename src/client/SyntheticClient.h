@@ -78,6 +78,8 @@
 #define SYNCLIENT_MODE_LOOKUPHASH     70
 #define SYNCLIENT_MODE_LOOKUPINO     71
 
+#define SYNCLIENT_MODE_MDSBENCH     75     // ops files create% stat% readdir% rename% think_us
+
 #define SYNCLIENT_MODE_TRUNCATE     200
 
 #define SYNCLIENT_MODE_FOO        100
@@ -229,6 +231,9 @@ class SyntheticClient {
 
 
   int make_dirs(const char *basedir, int dirs, int files, int depth);
+  int mds_bench(const char *basedir, int ops, int files,
+		int create_pct, int stat_pct, int readdir_pct, int rename_pct,
+		int think_us);
   int stat_dirs(const char *basedir, int dirs, int files, int depth);
   int read_dirs(const char *basedir, int dirs, int files, int depth);
   int make_files(int num, int count, int priv, bool more);
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 
 // ceph
@@ -452,10 +453,32 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
-    fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+  if (r < 0) {
     fuse_reply_err(req, -r);
+    return;
+  }
+
+  const std::list<bufferptr>& buffers = bl.buffers();
+  if (buffers.size() <= 1 || buffers.size() >= IOV_MAX) {
+    fuse_reply_buf(req, bl.c_str(), bl.length());
+    return;
+  }
+
+  /* reply straight from the cache buffers; c_str() would flatten a
+   * striped read into one more full-sized copy */
+  struct iovec *iov = new struct iovec[buffers.size()];
+  int n = 0;
+  for (std::list<bufferptr>::const_iterator p = buffers.begin();
+       p != buffers.end();
+       ++p) {
+    if (!p->length())
+      continue;
+    iov[n].iov_base = (void *)p->c_str();
+    iov[n].iov_len = p->length();
+    n++;
+  }
+  fuse_reply_iov(req, iov, n);
+  delete[] iov;
 }
 
 static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
@@ -470,6 +493,38 @@ static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
     fuse_reply_err(req, -r);
 }
 
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+static void fuse_ll_write_buf(fuse_req_t req, fuse_ino_t ino,
+			      struct fuse_bufvec *bufv, off_t off,
+			      struct fuse_file_info *fi)
+{
+  CephFuse::Handle *cfuse = (CephFuse::Handle *)fuse_req_userdata(req);
+  Fh *fh = reinterpret_cast<Fh*>(fi->fh);
+  size_t size = fuse_buf_size(bufv);
+
+  /* pull the data -- possibly a spliced pipe fd -- directly into the
+   * bufferlist that goes down the write path: one copy total, instead
+   * of libfuse copying to a flat buffer that we then copy again */
+  bufferptr bp = buffer::create(size);
+  struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+  dst.buf[0].mem = bp.c_str();
+  ssize_t len = fuse_buf_copy(&dst, bufv, (enum fuse_buf_copy_flags)0);
+  if (len < 0) {
+    fuse_reply_err(req, (int)-len);
+    return;
+  }
+
+  bufferlist bl;
+  bp.set_length(len);
+  bl.append(bp);
+  int r = cfuse->client->ll_write(fh, off, len, bl);
+  if (r >= 0)
+    fuse_reply_write(req, r);
+  else
+    fuse_reply_err(req, -r);
+}
+#endif
+
 static void fuse_ll_flush(fuse_req_t req, fuse_ino_t ino,
 			  struct fuse_file_info *fi)
 {
@@ -855,7 +910,7 @@ const static struct fuse_lowlevel_ops fuse_ll_oper = {
  poll: 0,
 #endif
 #if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
- write_buf: 0,
+ write_buf: fuse_ll_write_buf,
  retrieve_reply: 0,
  forget_multi: 0,
  flock: fuse_ll_flock,
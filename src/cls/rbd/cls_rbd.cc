@@ -2209,6 +2209,12 @@ int object_map_update(cls_method_context_t hctx, bufferlist *in, bufferlist *out
   }
 
   BitVector<2> object_map;
+  if (end_object_no > start_object_no) {
+    // only materialize the pages covering the update range so the cost
+    // of an update scales with the range, not the image size
+    object_map.set_data_window(start_object_no,
+			       end_object_no - start_object_no);
+  }
   bufferlist header_bl;
   r = cls_cxx_read(hctx, 0, object_map.get_header_length(), &header_bl);
   if (r < 0) {
@@ -422,55 +422,95 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 
   bufferlist bl;
 
-  map<string, bufferlist> keys;
   string start_key;
   encode_list_index_key(hctx, op.start_obj, &start_key);
-  rc = get_obj_vals(hctx, start_key, op.filter_prefix, op.num_entries + 1, &keys);
-  if (rc < 0)
-    return rc;
+
+  /* with a delimiter, a whole common-prefix subtree can be skipped with a
+   * single seek: return the subtree's first entry and restart the scan
+   * from the smallest key sorting after <prefix><delimiter>. Only the
+   * trivial ascii increment is handled here; for anything more exotic the
+   * gateway keeps doing the skipping itself */
+  string big_delim = op.delimiter;
+  if (!big_delim.empty()) {
+    char& last = big_delim[big_delim.size() - 1];
+    if ((unsigned char)last < 0x7f) {
+      last++;
+    } else {
+      big_delim.clear();
+    }
+  }
 
   std::map<string, struct rgw_bucket_dir_entry>& m = new_dir.m;
-  std::map<string, bufferlist>::iterator kiter = keys.begin();
-  uint32_t i;
 
+  uint32_t left = op.num_entries;
   bool done = false;
+  bool more = false;
+  bool seek;
 
-  for (i = 0; i < op.num_entries && kiter != keys.end(); ++i, ++kiter) {
-    struct rgw_bucket_dir_entry entry;
+  do {
+    seek = false;
 
-    if (!bi_is_objs_index(kiter->first)) {
-      done = true;
-      break;
-    }
+    map<string, bufferlist> keys;
+    rc = get_obj_vals(hctx, start_key, op.filter_prefix, left + 1, &keys);
+    if (rc < 0)
+      return rc;
 
-    bufferlist& entrybl = kiter->second;
-    bufferlist::iterator eiter = entrybl.begin();
-    try {
-      ::decode(entry, eiter);
-    } catch (buffer::error& err) {
-      CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
-      return -EINVAL;
-    }
+    std::map<string, bufferlist>::iterator kiter;
+    for (kiter = keys.begin(); kiter != keys.end(); ++kiter) {
+      struct rgw_bucket_dir_entry entry;
+
+      if (!bi_is_objs_index(kiter->first)) {
+        done = true;
+        break;
+      }
 
-    cls_rgw_obj_key key;
-    uint64_t ver;
-    decode_list_index_key(kiter->first, &key, &ver);
+      if (left == 0) {
+        more = true;
+        break;
+      }
+      left--;
 
-    if (!entry.is_valid()) {
-      CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
-      continue;
-    }
+      bufferlist& entrybl = kiter->second;
+      bufferlist::iterator eiter = entrybl.begin();
+      try {
+        ::decode(entry, eiter);
+      } catch (buffer::error& err) {
+        CLS_LOG(1, "ERROR: rgw_bucket_list(): failed to decode entry, key=%s\n", kiter->first.c_str());
+        return -EINVAL;
+      }
 
-    if (!op.list_versions && !entry.is_visible()) {
-      CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
-      continue;
-    }
-    m[kiter->first] = entry;
+      cls_rgw_obj_key key;
+      uint64_t ver;
+      decode_list_index_key(kiter->first, &key, &ver);
 
-    CLS_LOG(20, "got entry %s[%s] m.size()=%d\n", key.name.c_str(), key.instance.c_str(), (int)m.size());
-  }
+      if (!entry.is_valid()) {
+        CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
+        continue;
+      }
+
+      if (!op.list_versions && !entry.is_visible()) {
+        CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
+        continue;
+      }
+      m[kiter->first] = entry;
+
+      CLS_LOG(20, "got entry %s[%s] m.size()=%d\n", key.name.c_str(), key.instance.c_str(), (int)m.size());
+
+      if (!big_delim.empty()) {
+        size_t delim_pos = key.name.find(op.delimiter, op.filter_prefix.size());
+        if (delim_pos != string::npos) {
+          /* the gateway folds this entry into a common-prefix row; no
+           * point returning the rest of its subtree */
+          start_key = key.name.substr(0, delim_pos);
+          start_key.append(big_delim);
+          seek = true;
+          break;
+        }
+      }
+    }
+  } while (seek && !done);
 
-  ret.is_truncated = (kiter != keys.end() && !done);
+  ret.is_truncated = more && !done;
 
   ::encode(ret, *out);
   return 0;
@@ -280,6 +280,7 @@ void rgw_cls_list_op::generate_test_instances(list<rgw_cls_list_op*>& o)
   op->start_obj.name = "start_obj";
   op->num_entries = 100;
   op->filter_prefix = "filter_prefix";
+  op->delimiter = "/";
   o.push_back(op);
   o.push_back(new rgw_cls_list_op);
 }
@@ -288,6 +289,7 @@ void rgw_cls_list_op::dump(Formatter *f) const
 {
   f->dump_string("start_obj", start_obj.name);
   f->dump_unsigned("num_entries", num_entries);
+  f->dump_string("delimiter", delimiter);
 }
 
 void rgw_cls_list_ret::generate_test_instances(list<rgw_cls_list_ret*>& o)
@@ -43,3 +43,17 @@ time_t ceph_clock_gettime(CephContext *cct)
     ret += ((time_t)cct->_conf->clock_offset);
   return ret;
 }
+
+utime_t ceph_coarse_clock_now(CephContext *cct)
+{
+#if defined(__linux__) && defined(CLOCK_REALTIME_COARSE)
+  struct timespec tp;
+  clock_gettime(CLOCK_REALTIME_COARSE, &tp);
+  utime_t n(tp);
+  if (cct)
+    n += cct->_conf->clock_offset;
+  return n;
+#else
+  return ceph_clock_now(cct);
+#endif
+}
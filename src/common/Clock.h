@@ -24,4 +24,15 @@ class CephContext;
 extern utime_t ceph_clock_now(CephContext *cct);
 extern time_t ceph_clock_gettime(CephContext *cct);
 
+/**
+ * cheap tick-resolution timestamp (granularity ~1-4ms)
+ *
+ * Reads the kernel-maintained coarse clock, which costs a few ns and
+ * never enters the kernel.  Use this for high-frequency stamps like op
+ * tracking and queue timing; use ceph_clock_now() where the full
+ * resolution matters (commit timestamps, anything that goes on the
+ * wire or to disk).
+ */
+extern utime_t ceph_coarse_clock_now(CephContext *cct);
+
 #endif
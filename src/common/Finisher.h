@@ -15,6 +15,8 @@
 #ifndef CEPH_FINISHER_H
 #define CEPH_FINISHER_H
 
+#include <sstream>
+
 #include "include/atomic.h"
 #include "common/Mutex.h"
 #include "common/Cond.h"
@@ -159,6 +161,66 @@ class Finisher {
   }
 };
 
+/** @brief Affinity-sharded group of Finishers.
+ *
+ * Spreads completion work across several Finisher threads.  Callers
+ * supply an affinity key with every context; all contexts queued under
+ * one key complete on the same thread in queueing order, so per-key
+ * ordering is preserved while a slow callback only delays its own
+ * shard.  With a single shard this degenerates to a plain Finisher.
+ */
+class ShardedFinisher {
+  vector<Finisher*> shards;
+
+public:
+  ShardedFinisher(CephContext *cct, const string &name, int n) {
+    if (n < 1)
+      n = 1;
+    for (int i = 0; i < n; i++) {
+      ostringstream ss;
+      ss << name << "-" << i;
+      shards.push_back(new Finisher(cct, ss.str()));
+    }
+  }
+  ~ShardedFinisher() {
+    for (vector<Finisher*>::iterator p = shards.begin();
+	 p != shards.end();
+	 ++p)
+      delete *p;
+  }
+
+  /// the finisher a key maps to; stable for the life of this object
+  Finisher *get_shard(uint64_t key) {
+    return shards[(key * 2654435761ull) % shards.size()];
+  }
+
+  void queue(uint64_t key, Context *c, int r = 0) {
+    get_shard(key)->queue(c, r);
+  }
+  void queue(uint64_t key, vector<Context*>& ls) {
+    get_shard(key)->queue(ls);
+  }
+
+  void start() {
+    for (vector<Finisher*>::iterator p = shards.begin();
+	 p != shards.end();
+	 ++p)
+      (*p)->start();
+  }
+  void stop() {
+    for (vector<Finisher*>::iterator p = shards.begin();
+	 p != shards.end();
+	 ++p)
+      (*p)->stop();
+  }
+  void wait_for_empty() {
+    for (vector<Finisher*>::iterator p = shards.begin();
+	 p != shards.end();
+	 ++p)
+      (*p)->wait_for_empty();
+  }
+};
+
 /// Context that is completed asynchronously on the supplied finisher.
 class C_OnFinisher : public Context {
   Context *con;
@@ -59,7 +59,7 @@ FormatterAttrs::FormatterAttrs(const char *attr, ...)
   va_end(ap);
 }
 
-Formatter::Formatter() { }
+Formatter::Formatter() : m_sink(NULL), m_sink_threshold(0) { }
 
 Formatter::~Formatter() { }
 
@@ -238,6 +238,14 @@ void JSONFormatter::close_section()
   }
   m_ss << (entry.is_array ? ']' : '}');
   m_stack.pop_back();
+
+  if (m_sink && (size_t)m_ss.tellp() >= m_sink_threshold) {
+    // drain what we have so far; no string is pending here, so the
+    // buffered bytes are a well-formed prefix of the final output
+    m_sink->append(m_ss.str());
+    m_ss.clear();
+    m_ss.str("");
+  }
 }
 
 void JSONFormatter::finish_pending_string()
@@ -375,6 +383,12 @@ void XMLFormatter::close_section()
   m_ss << "</" << section << ">";
   if (m_pretty)
     m_ss << "\n";
+
+  if (m_sink && (size_t)m_ss.tellp() >= m_sink_threshold) {
+    m_sink->append(m_ss.str());
+    m_ss.clear();
+    m_ss.str("");
+  }
 }
 
 void XMLFormatter::dump_unsigned(const char *name, uint64_t u)
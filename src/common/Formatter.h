@@ -49,6 +49,18 @@ namespace ceph {
     }
     virtual void reset() = 0;
 
+    /*
+     * Bound the memory a big dump accumulates: when a sink is set, the
+     * formatter drains its buffered output into *bl each time a closed
+     * section leaves more than threshold bytes buffered.  The tail
+     * still comes out via the final flush().
+     */
+    void set_low_water(bufferlist *bl, size_t threshold)
+    {
+      m_sink = bl;
+      m_sink_threshold = threshold;
+    }
+
     virtual void open_array_section(const char *name) = 0;
     virtual void open_array_section_in_ns(const char *name, const char *ns) = 0;
     virtual void open_object_section(const char *name) = 0;
@@ -88,6 +100,10 @@ namespace ceph {
     {
       dump_string(name, s);
     }
+
+  protected:
+    bufferlist *m_sink;
+    size_t m_sink_threshold;
   };
 
   class JSONFormatter : public Formatter {
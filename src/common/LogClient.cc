@@ -106,7 +106,8 @@ LogChannel::LogChannel(CephContext *cct, LogClient *lc,
 LogClient::LogClient(CephContext *cct, Messenger *m, MonMap *mm,
 		     enum logclient_flag_t flags)
   : cct(cct), messenger(m), monmap(mm), is_mon(flags & FLAG_MON),
-    log_lock("LogClient::log_lock"), last_log_sent(0), last_log(0)
+    log_lock("LogClient::log_lock"), last_log_sent(0), last_log(0),
+    repeat_count(0)
 {
 }
 
@@ -210,12 +211,13 @@ Message *LogClient::get_mon_log_message()
 bool LogClient::are_pending()
 {
   Mutex::Locker l(log_lock);
-  return last_log > last_log_sent;
+  return last_log > last_log_sent || repeat_count > 0;
 }
 
 Message *LogClient::_get_mon_log_message()
 {
   assert(log_lock.is_locked());
+  _flush_repeats();
    if (log_queue.empty())
      return NULL;
 
@@ -272,6 +274,22 @@ void LogClient::_send_to_mon()
 version_t LogClient::queue(LogEntry &entry)
 {
   Mutex::Locker l(log_lock);
+
+  if (cct->_conf->clog_compress_repeats) {
+    if (entry.prio == last_queued.prio &&
+	entry.channel == last_queued.channel &&
+	entry.msg == last_queued.msg) {
+      // same as the last thing we queued; just count it.  a storm of
+      // identical messages (e.g. a flapping osd) then costs the mon one
+      // paxos commit per batch instead of one per message.
+      repeat_count++;
+      last_queued.stamp = entry.stamp;
+      return last_log;
+    }
+    _flush_repeats();
+    last_queued = entry;
+  }
+
   entry.seq = ++last_log;
   entry.who = messenger->get_myinst();
   log_queue.push_back(entry);
@@ -283,6 +301,23 @@ version_t LogClient::queue(LogEntry &entry)
   return entry.seq;
 }
 
+void LogClient::_flush_repeats()
+{
+  assert(log_lock.is_locked());
+  if (!repeat_count)
+    return;
+
+  LogEntry e = last_queued;
+  ostringstream ss;
+  ss << "last message repeated " << repeat_count << " times";
+  e.msg = ss.str();
+  repeat_count = 0;
+
+  e.seq = ++last_log;
+  e.who = messenger->get_myinst();
+  log_queue.push_back(e);
+}
+
 bool LogClient::handle_log_ack(MLogAck *m)
 {
   Mutex::Locker l(log_lock);
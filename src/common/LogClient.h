@@ -216,6 +216,7 @@ public:
 private:
   Message *_get_mon_log_message();
   void _send_to_mon();
+  void _flush_repeats();
 
   CephContext *cct;
   Messenger *messenger;
@@ -226,6 +227,13 @@ private:
   version_t last_log;
   std::deque<LogEntry> log_queue;
 
+  // compression of repeated messages: instead of queueing an entry
+  // identical to the last one we queued, count it, and emit a single
+  // 'message repeated N times' entry when something else comes along
+  // (or when the next batch goes to the mon).
+  LogEntry last_queued;
+  uint64_t repeat_count;
+
   std::map<std::string, LogChannelRef> channels;
 
 };
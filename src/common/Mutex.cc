@@ -14,6 +14,7 @@
 #include <string>
 
 #include "common/Mutex.h"
+#include "common/lock_contention.h"
 #include "common/perf_counters.h"
 #include "common/ceph_context.h"
 #include "common/config.h"
@@ -86,20 +87,27 @@ void Mutex::Lock(bool no_lockdep) {
 
   if (lockdep && g_lockdep && !no_lockdep) _will_lock();
 
-  if (logger && cct && cct->_conf->mutex_perf_counter) {
-    utime_t start;
-    // instrumented mutex enabled
-    start = ceph_clock_now(cct);
-    if (TryLock()) {
-      goto out;
-    }
+  {
+    bool instrument = (logger && cct && cct->_conf->mutex_perf_counter);
+    bool contention = (g_lock_contention && lock_contention_sample());
+    if (instrument || contention) {
+      utime_t start;
+      // instrumented mutex enabled
+      start = ceph_clock_now(cct);
+      if (TryLock()) {
+	goto out;
+      }
 
-    r = pthread_mutex_lock(&_m);
+      r = pthread_mutex_lock(&_m);
 
-    logger->tinc(l_mutex_wait,
-		 ceph_clock_now(cct) - start);
-  } else {
-    r = pthread_mutex_lock(&_m);
+      utime_t wait = ceph_clock_now(cct) - start;
+      if (instrument)
+	logger->tinc(l_mutex_wait, wait);
+      if (contention)
+	lock_contention_record(name, wait.to_nsec());
+    } else {
+      r = pthread_mutex_lock(&_m);
+    }
   }
 
   assert(r == 0);
@@ -1,4 +1,6 @@
 
+#include <string.h>
+
 #include "common/PrebufferedStreambuf.h"
 
 PrebufferedStreambuf::PrebufferedStreambuf(char *buf, size_t len)
@@ -59,5 +61,22 @@ std::string PrebufferedStreambuf::get_str() const
     return std::string();
   } else {
     return std::string(m_buf, this->pptr() - m_buf);
-  }  
+  }
+}
+
+size_t PrebufferedStreambuf::size() const
+{
+  if (m_overflow.size())
+    return m_buf_len + (this->pptr() - &m_overflow[0]);
+  return this->pptr() - m_buf;
+}
+
+void PrebufferedStreambuf::copy_to(char *out) const
+{
+  if (m_overflow.size()) {
+    memcpy(out, m_buf, m_buf_len);
+    memcpy(out + m_buf_len, &m_overflow[0], this->pptr() - &m_overflow[0]);
+  } else {
+    memcpy(out, m_buf, this->pptr() - m_buf);
+  }
 }
@@ -37,6 +37,12 @@ public:
 
   /// return a string copy (inefficiently)
   std::string get_str() const;
-};    
+
+  /// number of bytes buffered so far
+  size_t size() const;
+
+  /// copy buffered bytes to out, which must have room for size() of them
+  void copy_to(char *out) const;
+};
 
 #endif
@@ -17,6 +17,8 @@
 
 #include "common/Mutex.h"
 #include "common/Formatter.h"
+#include "common/Clock.h"
+#include "include/utime.h"
 
 #include <map>
 #include <utility>
@@ -42,14 +44,28 @@
  * Within a priority class, we schedule round robin based on the class
  * of type K used to enqueue items.  e.g. you could use entity_inst_t
  * to provide fairness for different clients.
+ *
+ * If a deadline (in seconds) is supplied, any item that has waited
+ * longer than the deadline is serviced before token accounting is
+ * consulted, oldest first.  This bounds the queueing delay that token
+ * starvation can impose on low-priority (e.g. recovery) items without
+ * giving them more than their share in the steady state.
  */
 template <typename T, typename K>
 class PrioritizedQueue {
   int64_t total_priority;
   int64_t max_tokens_per_subqueue;
   int64_t min_cost;
+  utime_t deadline;      ///< zero = no deadline pass
+
+  struct Item {
+    unsigned cost;
+    utime_t start;       ///< enqueue time, for the deadline pass
+    T item;
+    Item(unsigned c, utime_t s, const T& i) : cost(c), start(s), item(i) {}
+  };
 
-  typedef std::list<std::pair<unsigned, T> > ListPairs;
+  typedef std::list<Item> ListPairs;
   template <class F>
   static unsigned filter_list_pairs(
     ListPairs *l, F f,
@@ -59,15 +75,15 @@ class PrioritizedQueue {
       for (typename ListPairs::reverse_iterator i = l->rbegin();
 	   i != l->rend();
 	   ++i) {
-	if (f(i->second)) {
-	  out->push_front(i->second);
+	if (f(i->item)) {
+	  out->push_front(i->item);
 	}
       }
     }
     for (typename ListPairs::iterator i = l->begin();
 	 i != l->end();
       ) {
-      if (f(i->second)) {
+      if (f(i->item)) {
 	l->erase(i++);
 	++ret;
       } else {
@@ -116,18 +132,18 @@ class PrioritizedQueue {
 	tokens = 0;
     }
     void enqueue(K cl, unsigned cost, T item) {
-      q[cl].push_back(std::make_pair(cost, item));
+      q[cl].push_back(Item(cost, ceph_clock_now(NULL), item));
       if (cur == q.end())
 	cur = q.begin();
       size++;
     }
     void enqueue_front(K cl, unsigned cost, T item) {
-      q[cl].push_front(std::make_pair(cost, item));
+      q[cl].push_front(Item(cost, ceph_clock_now(NULL), item));
       if (cur == q.end())
 	cur = q.begin();
       size++;
     }
-    std::pair<unsigned, T> front() const {
+    const Item& front() const {
       assert(!(q.empty()));
       assert(cur != q.end());
       return cur->second.front();
@@ -180,7 +196,7 @@ class PrioritizedQueue {
 	       i->second.rbegin();
 	     j != i->second.rend();
 	     ++j) {
-	  out->push_front(j->second);
+	  out->push_front(j->item);
 	}
       }
       q.erase(i);
@@ -194,7 +210,7 @@ class PrioritizedQueue {
       f->dump_int("size", size);
       f->dump_int("num_keys", q.size());
       if (!empty())
-	f->dump_int("first_item_cost", front().first);
+	f->dump_int("first_item_cost", front().cost);
     }
   };
 
@@ -230,11 +246,13 @@ class PrioritizedQueue {
   }
 
 public:
-  PrioritizedQueue(unsigned max_per, unsigned min_c)
+  PrioritizedQueue(unsigned max_per, unsigned min_c, double deadline_s = 0)
     : total_priority(0),
       max_tokens_per_subqueue(max_per),
       min_cost(min_c)
-  {}
+  {
+    deadline.set_from_double(deadline_s);
+  }
 
   unsigned length() const {
     unsigned total = 0;
@@ -339,13 +357,39 @@ public:
     assert(!empty());
 
     if (!(high_queue.empty())) {
-      T ret = high_queue.rbegin()->second.front().second;
+      T ret = high_queue.rbegin()->second.front().item;
       high_queue.rbegin()->second.pop_front();
       if (high_queue.rbegin()->second.empty())
 	high_queue.erase(high_queue.rbegin()->first);
       return ret;
     }
 
+    if (!(deadline == utime_t())) {
+      // deadline pass: anything that has waited past the deadline goes
+      // first, oldest item first, regardless of token state
+      typename SubQueues::iterator oldest = queue.end();
+      utime_t now = ceph_clock_now(NULL);
+      for (typename SubQueues::iterator i = queue.begin();
+	   i != queue.end();
+	   ++i) {
+	assert(!(i->second.empty()));
+	if (now - i->second.front().start >= deadline &&
+	    (oldest == queue.end() ||
+	     i->second.front().start < oldest->second.front().start))
+	  oldest = i;
+      }
+      if (oldest != queue.end()) {
+	T ret = oldest->second.front().item;
+	unsigned cost = oldest->second.front().cost;
+	oldest->second.take_tokens(cost);
+	oldest->second.pop_front();
+	if (oldest->second.empty())
+	  remove_queue(oldest->first);
+	distribute_tokens(cost);
+	return ret;
+      }
+    }
+
     // if there are multiple buckets/subqueues with sufficient tokens,
     // we behave like a strict priority queue among all subqueues that
     // are eligible to run.
@@ -353,9 +397,9 @@ public:
 	 i != queue.end();
 	 ++i) {
       assert(!(i->second.empty()));
-      if (i->second.front().first < i->second.num_tokens()) {
-	T ret = i->second.front().second;
-	unsigned cost = i->second.front().first;
+      if (i->second.front().cost < i->second.num_tokens()) {
+	T ret = i->second.front().item;
+	unsigned cost = i->second.front().cost;
 	i->second.take_tokens(cost);
 	i->second.pop_front();
 	if (i->second.empty())
@@ -367,8 +411,8 @@ public:
 
     // if no subqueues have sufficient tokens, we behave like a strict
     // priority queue.
-    T ret = queue.rbegin()->second.front().second;
-    unsigned cost = queue.rbegin()->second.front().first;
+    T ret = queue.rbegin()->second.front().item;
+    unsigned cost = queue.rbegin()->second.front().cost;
     queue.rbegin()->second.pop_front();
     if (queue.rbegin()->second.empty())
       remove_queue(queue.rbegin()->first);
@@ -25,7 +25,20 @@
 
 class RWLock
 {
-  mutable pthread_rwlock_t L;
+  /* Readers spread over one or more cacheline-padded pthread_rwlock_t
+   * shards, selected by thread; writers take every shard in order.
+   * With the default single shard this is the plain old rwlock.
+   * Multiple shards pay off for read-mostly locks hot enough that read
+   * acquisitions alone bounce the lock's cacheline between cores
+   * (e.g. Objecter::rwlock); they make writers proportionally more
+   * expensive. */
+  struct shard_t {
+    pthread_rwlock_t L;
+    char pad[((sizeof(pthread_rwlock_t) / 64) + 1) * 64
+	     - sizeof(pthread_rwlock_t)];
+  };
+  mutable shard_t *shards;
+  int nshard;
   std::string name;
   mutable int id;
   mutable atomic_t nrlock, nwlock;
@@ -33,12 +46,26 @@ class RWLock
 
   std::string unique_name(const char* name) const;
 
+  shard_t &my_shard() const {
+    if (nshard == 1)
+      return shards[0];
+    return shards[(((unsigned long)pthread_self() * 2654435761ul) >> 16)
+		  % nshard];
+  }
+
 public:
   RWLock(const RWLock& other);
   const RWLock& operator=(const RWLock& other);
 
-  RWLock(const std::string &n, bool track_lock=true) : name(n), id(-1), nrlock(0), nwlock(0), track(track_lock) {
-    pthread_rwlock_init(&L, NULL);
+  RWLock(const std::string &n, bool track_lock=true, int read_shards=1)
+    : name(n), id(-1), nrlock(0), nwlock(0), track(track_lock) {
+    // without usage tracking unlock() cannot tell whether to release
+    // one shard (read) or all of them (write)
+    assert(read_shards == 1 || track_lock);
+    nshard = read_shards >= 1 ? read_shards : 1;
+    shards = new shard_t[nshard];
+    for (int i = 0; i < nshard; i++)
+      pthread_rwlock_init(&shards[i].L, NULL);
     if (g_lockdep) id = lockdep_register(name.c_str());
   }
 
@@ -56,15 +83,19 @@ public:
     // the object and we assume that there are no other users.
     if (track)
       assert(!is_locked());
-    pthread_rwlock_destroy(&L);
+    for (int i = 0; i < nshard; i++)
+      pthread_rwlock_destroy(&shards[i].L);
+    delete[] shards;
     if (g_lockdep) {
       lockdep_unregister(id);
     }
   }
 
   void unlock(bool lockdep=true) const {
+    bool write = false;
     if (track) {
       if (nwlock.read() > 0) {
+        write = true;
         nwlock.dec();
       } else {
         assert(nrlock.read() > 0);
@@ -72,21 +103,28 @@ public:
       }
     }
     if (lockdep && g_lockdep) id = lockdep_will_unlock(name.c_str(), id);
-    int r = pthread_rwlock_unlock(&L);
-    assert(r == 0);
+    if (write) {
+      for (int i = nshard - 1; i >= 0; i--) {
+	int r = pthread_rwlock_unlock(&shards[i].L);
+	assert(r == 0);
+      }
+    } else {
+      int r = pthread_rwlock_unlock(&my_shard().L);
+      assert(r == 0);
+    }
   }
 
   // read
   void get_read() const {
     if (g_lockdep) id = lockdep_will_lock(name.c_str(), id);
-    int r = pthread_rwlock_rdlock(&L);
+    int r = pthread_rwlock_rdlock(&my_shard().L);
     assert(r == 0);
     if (g_lockdep) id = lockdep_locked(name.c_str(), id);
     if (track)
       nrlock.inc();
   }
   bool try_get_read() const {
-    if (pthread_rwlock_tryrdlock(&L) == 0) {
+    if (pthread_rwlock_tryrdlock(&my_shard().L) == 0) {
       if (track)
          nrlock.inc();
       if (g_lockdep) id = lockdep_locked(name.c_str(), id);
@@ -101,21 +139,27 @@ public:
   // write
   void get_write(bool lockdep=true) {
     if (lockdep && g_lockdep) id = lockdep_will_lock(name.c_str(), id);
-    int r = pthread_rwlock_wrlock(&L);
-    assert(r == 0);
+    for (int i = 0; i < nshard; i++) {
+      int r = pthread_rwlock_wrlock(&shards[i].L);
+      assert(r == 0);
+    }
     if (g_lockdep) id = lockdep_locked(name.c_str(), id);
     if (track)
       nwlock.inc();
 
   }
   bool try_get_write(bool lockdep=true) {
-    if (pthread_rwlock_trywrlock(&L) == 0) {
-      if (lockdep && g_lockdep) id = lockdep_locked(name.c_str(), id);
-      if (track)
-         nwlock.inc();
-      return true;
+    for (int i = 0; i < nshard; i++) {
+      if (pthread_rwlock_trywrlock(&shards[i].L)) {
+	while (--i >= 0)
+	  pthread_rwlock_unlock(&shards[i].L);
+	return false;
+      }
     }
-    return false;
+    if (lockdep && g_lockdep) id = lockdep_locked(name.c_str(), id);
+    if (track)
+       nwlock.inc();
+    return true;
   }
   void put_write() {
     unlock();
@@ -11,12 +11,11 @@ Readahead::Readahead()
     m_readahead_max_bytes(NO_LIMIT),
     m_alignments(),
     m_lock("Readahead::m_lock"),
-    m_nr_consec_read(0),
-    m_consec_read_bytes(0),
-    m_last_pos(0),
-    m_readahead_pos(0),
-    m_readahead_trigger_pos(0),
-    m_readahead_size(0),
+    m_max_streams(1),
+    m_streams(1),
+    m_clock(0),
+    m_stream_hits(0),
+    m_stream_misses(0),
     m_pending(0),
     m_pending_lock("Readahead::m_pending_lock"),
     m_pending_cond() {
@@ -27,66 +26,128 @@ Readahead::~Readahead() {
 
 Readahead::extent_t Readahead::update(const vector<extent_t>& extents, uint64_t limit) {
   m_lock.Lock();
+  stream_t *stream = NULL;
   for (vector<extent_t>::const_iterator p = extents.begin(); p != extents.end(); ++p) {
-    _observe_read(p->first, p->second);
+    stream = _observe_read(p->first, p->second);
   }
-  if (m_readahead_pos >= limit) {
+  if (!stream || stream->readahead_pos >= limit) {
     m_lock.Unlock();
     return extent_t(0, 0);
   }
-  pair<uint64_t, uint64_t> extent = _compute_readahead(limit);
+  pair<uint64_t, uint64_t> extent = _compute_readahead(*stream, limit);
   m_lock.Unlock();
   return extent;
 }
 
 Readahead::extent_t Readahead::update(uint64_t offset, uint64_t length, uint64_t limit) {
   m_lock.Lock();
-  _observe_read(offset, length);
-  if (m_readahead_pos >= limit) {
+  stream_t *stream = _observe_read(offset, length);
+  if (stream->readahead_pos >= limit) {
     m_lock.Unlock();
     return extent_t(0, 0);
   }
-  extent_t extent = _compute_readahead(limit);
+  extent_t extent = _compute_readahead(*stream, limit);
   m_lock.Unlock();
   return extent;
 }
 
-void Readahead::_observe_read(uint64_t offset, uint64_t length) {
-  if (offset == m_last_pos) {
-    m_nr_consec_read++;
-    m_consec_read_bytes += length;
-  } else {
-    m_nr_consec_read = 0;
-    m_consec_read_bytes = 0;
-    m_readahead_trigger_pos = 0;
-    m_readahead_size = 0;
-    m_readahead_pos = 0;
+void Readahead::_reset_stream(stream_t &s, uint64_t offset, uint64_t length) {
+  s.nr_consec_read = 0;
+  s.consec_read_bytes = 0;
+  s.last_pos = offset + length;
+  s.stride = 0;
+  s.pending_stride = 0;
+  s.readahead_pos = 0;
+  s.readahead_trigger_pos = 0;
+  s.readahead_size = 0;
+  s.last_use = m_clock;
+}
+
+Readahead::stream_t *Readahead::_observe_read(uint64_t offset, uint64_t length) {
+  m_clock++;
+
+  // does this read continue a tracked stream?
+  for (vector<stream_t>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    if (offset == p->last_pos + p->stride) {
+      p->nr_consec_read++;
+      p->consec_read_bytes += length;
+      p->last_pos = offset + length;
+      p->pending_stride = 0;
+      p->last_use = m_clock;
+      m_stream_hits++;
+      return &*p;
+    }
   }
-  m_last_pos = offset + length;
+
+  // no; could it be a strided continuation of one?  a stream whose last
+  // read ended a bounded gap below this read either confirms a previously
+  // seen gap (establishing the stride) or records this gap as a candidate.
+  // a single tracked stream keeps the historical strictly sequential
+  // behaviour.
+  if (m_max_streams > 1) {
+    stream_t *train = NULL;
+    for (vector<stream_t>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+      if (p->last_use > 0 &&
+	  p->stride == 0 &&
+	  p->nr_consec_read == 0 &&
+	  offset > p->last_pos &&
+	  offset - p->last_pos <= MAX_STRIDE &&
+	  (!train || p->last_pos > train->last_pos)) {
+	train = &*p;
+      }
+    }
+    if (train) {
+      uint64_t gap = offset - train->last_pos;
+      train->consec_read_bytes += length;
+      train->last_pos = offset + length;
+      train->last_use = m_clock;
+      if (gap == train->pending_stride) {
+	// second identical gap; this is a strided stream
+	train->stride = gap;
+	train->nr_consec_read = 2;
+	m_stream_hits++;
+      } else {
+	train->pending_stride = gap;
+	m_stream_misses++;
+      }
+      return train;
+    }
+  }
+
+  // start tracking a new stream in place of the least recently used one
+  m_stream_misses++;
+  stream_t *lru = &m_streams[0];
+  for (vector<stream_t>::iterator p = m_streams.begin(); p != m_streams.end(); ++p) {
+    if (p->last_use < lru->last_use) {
+      lru = &*p;
+    }
+  }
+  _reset_stream(*lru, offset, length);
+  return lru;
 }
 
-Readahead::extent_t Readahead::_compute_readahead(uint64_t limit) {
+Readahead::extent_t Readahead::_compute_readahead(stream_t &s, uint64_t limit) {
   uint64_t readahead_offset = 0;
   uint64_t readahead_length = 0;
-  if (m_nr_consec_read >= m_trigger_requests) {
-    // currently reading sequentially
-    if (m_last_pos >= m_readahead_trigger_pos) {
+  if (s.nr_consec_read >= m_trigger_requests) {
+    // currently reading sequentially (or with a fixed stride)
+    if (s.last_pos >= s.readahead_trigger_pos) {
       // need to read ahead
-      if (m_readahead_size == 0) {
-	// initial readahead trigger
-	m_readahead_size = m_consec_read_bytes;
-	m_readahead_pos = m_last_pos;
+      if (s.readahead_size == 0) {
+	// initial readahead trigger; start with the span covered so far
+	s.readahead_size = s.consec_read_bytes + s.nr_consec_read * s.stride;
+	s.readahead_pos = s.last_pos + s.stride;
       } else {
 	// continuing readahead trigger
-	m_readahead_size *= 2;
-	if (m_last_pos > m_readahead_pos) {
-	  m_readahead_pos = m_last_pos;
+	s.readahead_size *= 2;
+	if (s.last_pos + s.stride > s.readahead_pos) {
+	  s.readahead_pos = s.last_pos + s.stride;
 	}
       }
-      m_readahead_size = MAX(m_readahead_size, m_readahead_min_bytes);
-      m_readahead_size = MIN(m_readahead_size, m_readahead_max_bytes);
-      readahead_offset = m_readahead_pos;
-      readahead_length = m_readahead_size;
+      s.readahead_size = MAX(s.readahead_size, m_readahead_min_bytes);
+      s.readahead_size = MIN(s.readahead_size, m_readahead_max_bytes);
+      readahead_offset = s.readahead_pos;
+      readahead_length = s.readahead_size;
 
       // Snap to the first alignment possible
       uint64_t readahead_end = readahead_offset + readahead_length;
@@ -108,15 +169,15 @@ Readahead::extent_t Readahead::_compute_readahead(uint64_t limit) {
 	  readahead_length = align_next - readahead_offset;
 	  break;
 	}
-	// Note that m_readahead_size should remain unadjusted.
+	// Note that s.readahead_size should remain unadjusted.
       }
 
-      if (m_readahead_pos + readahead_length > limit) {
-	readahead_length = limit - m_readahead_pos;
+      if (s.readahead_pos + readahead_length > limit) {
+	readahead_length = limit - s.readahead_pos;
       }
 
-      m_readahead_trigger_pos = m_readahead_pos + readahead_length / 2;
-      m_readahead_pos += readahead_length;
+      s.readahead_trigger_pos = s.readahead_pos + readahead_length / 2;
+      s.readahead_pos += readahead_length;
     }
   }
   return extent_t(readahead_offset, readahead_length);
@@ -171,3 +232,18 @@ void Readahead::set_alignments(const vector<uint64_t> &alignments) {
   m_alignments = alignments;
   m_lock.Unlock();
 }
+
+void Readahead::set_max_streams(int streams) {
+  m_lock.Lock();
+  m_max_streams = streams >= 1 ? streams : 1;
+  m_streams.clear();
+  m_streams.resize(m_max_streams);
+  m_lock.Unlock();
+}
+
+void Readahead::get_stream_counts(uint64_t *hits, uint64_t *misses) {
+  m_lock.Lock();
+  *hits = m_stream_hits;
+  *misses = m_stream_misses;
+  m_lock.Unlock();
+}
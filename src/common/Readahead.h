@@ -12,6 +12,11 @@
    on linear things such as RBD images or files.
    Unless otherwise specified, all methods are thread-safe.
 
+   By default a single, strictly sequential read stream is recognized.
+   set_max_streams() enables tracking of several interleaved streams, each of
+   which may be sequential or strided (reads of a fixed size separated by a
+   fixed gap).
+
    Minimum and maximum readahead sizes may be violated by up to 50\% if alignment is enabled.
    Minimum readahead size may be violated if the end of the readahead target is reached.
  */
@@ -94,18 +99,74 @@ public:
    */
   void set_alignments(const std::vector<uint64_t> &alignments);
 
+  /**
+     Sets the number of read streams tracked simultaneously.
+     With the default of 1, only a single strictly sequential stream is
+     recognized (the historical behaviour).  Larger values track several
+     interleaved streams, each sequential or strided; a read that continues
+     none of them replaces the least recently active stream.
+     Calling this discards all stream state.
+   */
+  void set_max_streams(int streams);
+
+  /**
+     Returns the total number of reads that continued a tracked stream (hits)
+     and the number that did not (misses) since construction.
+   */
+  void get_stream_counts(uint64_t *hits, uint64_t *misses);
+
 private:
+  /// State of one tracked read stream
+  struct stream_t {
+    /// Number of consecutive read requests in this stream
+    int nr_consec_read;
+
+    /// Number of bytes read by this stream's consecutive requests
+    uint64_t consec_read_bytes;
+
+    /// End offset of the last read in this stream
+    uint64_t last_pos;
+
+    /// Gap between consecutive reads; 0 for a sequential stream
+    uint64_t stride;
+
+    /// Candidate stride, promoted to \c stride once a second read confirms it
+    uint64_t pending_stride;
+
+    /// Position of the readahead for this stream
+    uint64_t readahead_pos;
+
+    /// When readahead is already triggered and the stream crosses this point, readahead is continued
+    uint64_t readahead_trigger_pos;
+
+    /// Size of the next readahead request (barring changes due to alignment, etc.)
+    uint64_t readahead_size;
+
+    /// Value of m_clock when this stream last matched a read, for LRU replacement
+    uint64_t last_use;
+  };
+
+  /// Largest gap recognized as a stride, in bytes
+  static const uint64_t MAX_STRIDE = 4 << 20;
+
   /**
-     Records that a read request has been received.
+     Resets \c s to track a new stream starting with the given read.
      m_lock must be held while calling.
    */
-  void _observe_read(uint64_t offset, uint64_t length);
+  void _reset_stream(stream_t &s, uint64_t offset, uint64_t length);
 
   /**
-     Computes the next readahead request.
+     Records that a read request has been received and returns the stream it
+     was attributed to.
+     m_lock must be held while calling.
+   */
+  stream_t *_observe_read(uint64_t offset, uint64_t length);
+
+  /**
+     Computes the next readahead request for stream \c s.
      m_lock must be held while calling.
   */
-  extent_t _compute_readahead(uint64_t limit);
+  extent_t _compute_readahead(stream_t &s, uint64_t limit);
 
   /// Number of sequential requests necessary to trigger readahead
   int m_trigger_requests;
@@ -122,23 +183,20 @@ private:
   /// Held while reading/modifying any state except m_pending
   Mutex m_lock;
 
-  /// Number of consecutive read requests in the current sequential stream
-  int m_nr_consec_read;
-
-  /// Number of bytes read in the current sequenial stream
-  uint64_t m_consec_read_bytes;
+  /// Number of streams tracked simultaneously
+  int m_max_streams;
 
-  /// Position of the read stream
-  uint64_t m_last_pos;
+  /// Tracked read streams
+  std::vector<stream_t> m_streams;
 
-  /// Position of the readahead stream
-  uint64_t m_readahead_pos;
+  /// Incremented for every observed read, for LRU stream replacement
+  uint64_t m_clock;
 
-  /// When readahead is already triggered and the read stream crosses this point, readahead is continued
-  uint64_t m_readahead_trigger_pos;
+  /// Number of reads that continued a tracked stream
+  uint64_t m_stream_hits;
 
-  /// Size of the next readahead request (barring changes due to alignment, etc.)
-  uint64_t m_readahead_size;
+  /// Number of reads that did not match any tracked stream
+  uint64_t m_stream_misses;
 
   /// Number of pending readahead requests, as determined by inc_pending() and dec_pending()
   int m_pending;
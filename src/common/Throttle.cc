@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <errno.h>
+#include <algorithm>
 
 #include "common/Throttle.h"
 #include "common/dout.h"
@@ -96,7 +97,11 @@ bool Throttle::_wait(int64_t c)
   if (_should_wait(c) || !cond.empty()) { // always wait behind other waiters.
     Cond *cv = new Cond;
     cond.push_back(cv);
-    do {
+    waiters.inc();
+    // recheck after queueing and before every wait: a lock-free put()
+    // subtracts from count before it looks for waiters, so either it
+    // sees us queued here or we see its new count
+    while (_should_wait(c) || cv != cond.front()) {
       if (!waited) {
 	ldout(cct, 2) << "_wait waiting..." << dendl;
 	if (logger)
@@ -104,7 +109,7 @@ bool Throttle::_wait(int64_t c)
       }
       waited = true;
       cv->Wait(lock);
-    } while (_should_wait(c) || cv != cond.front());
+    }
 
     if (waited) {
       ldout(cct, 3) << "_wait finished waiting" << dendl;
@@ -116,6 +121,7 @@ bool Throttle::_wait(int64_t c)
 
     delete cv;
     cond.pop_front();
+    waiters.dec();
 
     // wake up the next guy
     if (!cond.empty())
@@ -146,10 +152,7 @@ int64_t Throttle::take(int64_t c)
   }
   assert(c >= 0);
   ldout(cct, 10) << "take " << c << dendl;
-  {
-    Mutex::Locker l(lock);
-    count.add(c);
-  }
+  count.add(c);
   if (logger) {
     logger->inc(l_throttle_take);
     logger->inc(l_throttle_take_sum, c);
@@ -167,7 +170,22 @@ bool Throttle::get(int64_t c, int64_t m)
   assert(c >= 0);
   ldout(cct, 10) << "get " << c << " (" << count.read() << " -> " << (count.read() + c) << ")" << dendl;
   bool waited = false;
-  {
+  bool have = false;
+  if (m == 0 && 0 == waiters.read()) {
+    // uncontended fast path: nobody queued to stay fair behind, so try
+    // to take the slots with a CAS and skip the lock entirely
+    while (true) {
+      int64_t cur = count.read();
+      if (_should_wait_vals(cur, max.read(), c))
+	break;  // over budget; queue below
+      if (count.compare_and_swap(cur, cur + c)) {
+	have = true;
+	break;
+      }
+      // lost a race with another get/put; retry
+    }
+  }
+  if (!have) {
     Mutex::Locker l(lock);
     if (m) {
       assert(m > 0);
@@ -194,23 +212,27 @@ bool Throttle::get_or_fail(int64_t c)
   }
 
   assert (c >= 0);
-  Mutex::Locker l(lock);
-  if (_should_wait(c) || !cond.empty()) {
-    ldout(cct, 10) << "get_or_fail " << c << " failed" << dendl;
-    if (logger) {
-      logger->inc(l_throttle_get_or_fail_fail);
+  while (true) {
+    int64_t cur = count.read();
+    if (waiters.read() || _should_wait_vals(cur, max.read(), c)) {
+      // don't jump ahead of queued waiters
+      ldout(cct, 10) << "get_or_fail " << c << " failed" << dendl;
+      if (logger) {
+	logger->inc(l_throttle_get_or_fail_fail);
+      }
+      return false;
     }
-    return false;
-  } else {
-    ldout(cct, 10) << "get_or_fail " << c << " success (" << count.read() << " -> " << (count.read() + c) << ")" << dendl;
-    count.add(c);
-    if (logger) {
-      logger->inc(l_throttle_get_or_fail_success);
-      logger->inc(l_throttle_get);
-      logger->inc(l_throttle_get_sum, c);
-      logger->set(l_throttle_val, count.read());
+    if (count.compare_and_swap(cur, cur + c)) {
+      ldout(cct, 10) << "get_or_fail " << c << " success (" << cur << " -> " << (cur + c) << ")" << dendl;
+      if (logger) {
+	logger->inc(l_throttle_get_or_fail_success);
+	logger->inc(l_throttle_get);
+	logger->inc(l_throttle_get_sum, c);
+	logger->set(l_throttle_val, count.read());
+      }
+      return true;
     }
-    return true;
+    // lost a race with another get/put; retry
   }
 }
 
@@ -222,12 +244,17 @@ int64_t Throttle::put(int64_t c)
 
   assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.read() << " -> " << (count.read()-c) << ")" << dendl;
-  Mutex::Locker l(lock);
   if (c) {
-    if (!cond.empty())
-      cond.front()->SignalOne();
     assert(((int64_t)count.read()) >= c); //if count goes negative, we failed somewhere!
     count.sub(c);
+    // subtract before looking for waiters: _wait() queues itself
+    // before rechecking the count, so either we see the waiter here or
+    // it sees the slots we just released
+    if (waiters.read()) {
+      Mutex::Locker l(lock);
+      if (!cond.empty())
+	cond.front()->SignalOne();
+    }
     if (logger) {
       logger->inc(l_throttle_put);
       logger->inc(l_throttle_put_sum, c);
@@ -237,6 +264,101 @@ int64_t Throttle::put(int64_t c)
   return count.read();
 }
 
+#undef dout_prefix
+#define dout_prefix *_dout << "adaptive_throttle(" << name << " " << (void*)this << ") "
+
+// controller constants: cut hard on overshoot, creep back up while
+// comfortably under target.  the usual AIMD tradeoff -- convergence
+// speed is bounded by the sample window, stability by the dead band
+// between the increase threshold and the target.
+#define ADAPTIVE_THROTTLE_WINDOW          256   // samples per adjustment
+#define ADAPTIVE_THROTTLE_DECREASE_FACTOR 0.75
+#define ADAPTIVE_THROTTLE_INCREASE_THRESH 0.9   // of target
+#define ADAPTIVE_THROTTLE_INCREASE_SHIFT  5     // step = ceiling >> shift
+
+AdaptiveThrottle::AdaptiveThrottle(CephContext *cct, const std::string& n,
+				   int64_t m, bool use_perf)
+  : cct(cct),
+    name(n),
+    throttle(cct, n, m, use_perf),
+    sample_lock("AdaptiveThrottle::sample_lock"),
+    floor(0),
+    ceiling(m),
+    target(0),
+    percentile(0.99)
+{
+  samples.reserve(ADAPTIVE_THROTTLE_WINDOW);
+}
+
+void AdaptiveThrottle::set_policy(int64_t fl, int64_t cl, double target_secs,
+				  double pctl)
+{
+  assert(fl >= 0);
+  assert(cl >= fl);
+  assert(pctl > 0 && pctl <= 1);
+  Mutex::Locker l(sample_lock);
+  floor = std::max(fl, (int64_t)1);
+  ceiling = cl;
+  target = target_secs;
+  percentile = pctl;
+  samples.clear();
+  // start from the ceiling; the first overshoot will pull us down
+  throttle.reset_max(adaptive() ? ceiling : cl);
+}
+
+void AdaptiveThrottle::notify_latency(utime_t lat)
+{
+  if (!adaptive())
+    return;
+  Mutex::Locker l(sample_lock);
+  samples.push_back((double)lat);
+  if (samples.size() >= ADAPTIVE_THROTTLE_WINDOW) {
+    _adjust();
+    samples.clear();
+  }
+}
+
+void AdaptiveThrottle::_adjust()
+{
+  assert(sample_lock.is_locked());
+  assert(!samples.empty());
+  unsigned idx = (unsigned)(percentile * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+  double p = samples[idx];
+
+  int64_t cur = throttle.get_max();
+  int64_t adjusted = cur;
+  if (p > target) {
+    adjusted = (int64_t)(cur * ADAPTIVE_THROTTLE_DECREASE_FACTOR);
+  } else if (p < target * ADAPTIVE_THROTTLE_INCREASE_THRESH) {
+    adjusted = cur + std::max(ceiling >> ADAPTIVE_THROTTLE_INCREASE_SHIFT,
+			      (int64_t)1);
+  }
+  adjusted = std::max(floor, std::min(ceiling, adjusted));
+  if (adjusted != cur) {
+    ldout(cct, 10) << "_adjust p" << (percentile * 100) << " " << p
+		   << "s vs target " << target << "s, budget " << cur
+		   << " -> " << adjusted << dendl;
+    throttle.reset_max(adjusted);
+  }
+}
+
+bool AdaptiveThrottle::wait(int64_t m)
+{
+  if (!adaptive())
+    return throttle.wait(m);
+  if (m) {
+    Mutex::Locker l(sample_lock);
+    if (m != ceiling) {
+      ceiling = m;
+      floor = std::min(floor, ceiling);
+      int64_t cur = throttle.get_max();
+      throttle.reset_max(std::max(floor, std::min(ceiling, cur)));
+    }
+  }
+  return throttle.wait(0);
+}
+
 SimpleThrottle::SimpleThrottle(uint64_t max, bool ignore_enoent)
   : m_lock("SimpleThrottle"),
     m_max(max),
@@ -7,7 +7,9 @@
 #include "Mutex.h"
 #include "Cond.h"
 #include <list>
+#include <vector>
 #include "include/atomic.h"
+#include "include/utime.h"
 
 class CephContext;
 class PerfCounters;
@@ -25,6 +27,7 @@ class Throttle {
   const std::string name;
   PerfCounters *logger;
   ceph::atomic_t count, max;
+  ceph::atomic_t waiters;  // number of queued Conds; read outside the lock
   Mutex lock;
   list<Cond*> cond;
   const bool use_perf;
@@ -35,14 +38,15 @@ public:
 
 private:
   void _reset_max(int64_t m);
-  bool _should_wait(int64_t c) const {
-    int64_t m = max.read();
-    int64_t cur = count.read();
+  static bool _should_wait_vals(int64_t cur, int64_t m, int64_t c) {
     return
       m &&
       ((c <= m && cur + c > m) || // normally stay under max
        (c >= m && cur > m));     // except for large c
   }
+  bool _should_wait(int64_t c) const {
+    return _should_wait_vals(count.read(), max.read(), c);
+  }
 
   bool _wait(int64_t c);
 
@@ -110,6 +114,75 @@ public:
 };
 
 
+/**
+ * @class AdaptiveThrottle
+ * Throttle whose limit is a control output rather than a constant.
+ *
+ * Admission works exactly like Throttle, but the in-flight budget
+ * floats between a configured floor and ceiling, steered by completion
+ * latency samples fed back through notify_latency().  The controller
+ * keeps a window of recent samples and, each time the window fills,
+ * compares a high percentile of it against a latency target: while the
+ * percentile sits comfortably below target the budget grows additively,
+ * and when it overshoots the budget is cut multiplicatively (AIMD).
+ * The limit thus converges on whatever the backing device can sustain
+ * at the desired latency instead of a number tuned by hand per
+ * hardware generation.
+ *
+ * With no target configured (target <= 0) it behaves exactly like a
+ * plain Throttle pinned at the ceiling.
+ */
+class AdaptiveThrottle {
+  CephContext *cct;
+  const std::string name;
+  Throttle throttle;
+  Mutex sample_lock;
+  std::vector<double> samples;  ///< latency window, in seconds
+  int64_t floor;       ///< budget never adapts below this
+  int64_t ceiling;     ///< ... nor above this
+  double target;       ///< percentile latency target, in seconds; <= 0 off
+  double percentile;   ///< controlled percentile, in (0, 1]
+
+  void _adjust();
+
+public:
+  AdaptiveThrottle(CephContext *cct, const std::string& n, int64_t m = 0,
+		   bool use_perf = true);
+
+  /**
+   * configure (or reconfigure) the controller.
+   *
+   * @param fl budget floor; adaptation never starves the queue below this
+   * @param cl budget ceiling; also the static limit when off
+   * @param target_secs latency target for the controlled percentile,
+   *        in seconds; <= 0 disables adaptation
+   * @param pctl percentile to control, in (0, 1]
+   */
+  void set_policy(int64_t fl, int64_t cl, double target_secs, double pctl);
+
+  /**
+   * feed back one completion latency sample.  cheap; call from the
+   * completion path for every admitted item.
+   */
+  void notify_latency(utime_t lat);
+
+  bool adaptive() const { return target > 0; }
+
+  int64_t get_current() const { return throttle.get_current(); }
+  int64_t get_max() const { return throttle.get_max(); }
+  int64_t take(int64_t c = 1) { return throttle.take(c); }
+  bool get(int64_t c = 1) { return throttle.get(c); }
+  int64_t put(int64_t c = 1) { return throttle.put(c); }
+  bool should_wait(int64_t c) const { return throttle.should_wait(c); }
+
+  /**
+   * as Throttle::wait(), except that when adaptation is on a non-zero
+   * @p m moves the ceiling rather than stomping the adapted budget.
+   */
+  bool wait(int64_t m = 0);
+};
+
+
 /**
  * @class SimpleThrottle
  * This is a simple way to bound the number of concurrent operations.
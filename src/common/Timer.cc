@@ -41,14 +41,13 @@ public:
 };
 
 
-
-typedef std::multimap < utime_t, Context *> scheduled_map_t;
-typedef std::map < Context*, scheduled_map_t::iterator > event_lookup_map_t;
-
 SafeTimer::SafeTimer(CephContext *cct_, Mutex &l, bool safe_callbacks)
   : cct(cct_), lock(l),
     safe_callbacks(safe_callbacks),
     thread(NULL),
+    base(ceph_clock_now(cct_)),
+    last_tick(0),
+    wake_tick(0),
     stopping(false)
 {
 }
@@ -81,41 +80,145 @@ void SafeTimer::shutdown()
   }
 }
 
+/// last tick that began at or before t
+uint64_t SafeTimer::_tick_at(utime_t t) const
+{
+  if (t <= base)
+    return 0;
+  return (t - base).to_nsec() / TICK_NSEC;
+}
+
+/// first tick that begins at or after t; scheduling rounds up so that
+/// events never fire before their deadline
+uint64_t SafeTimer::_tick_after(utime_t t) const
+{
+  if (t <= base)
+    return 0;
+  return ((t - base).to_nsec() + TICK_NSEC - 1) / TICK_NSEC;
+}
+
+/* Pick the slot for an event due at the given tick.  The event lands in
+ * the lowest level whose span still covers the distance from last_tick,
+ * so it either fires directly from level 0 or cascades downward when
+ * its enclosing coarser slot matures. */
+SafeTimer::slot_t *SafeTimer::_slot_for(uint64_t tick)
+{
+  uint64_t delta = tick - last_tick;
+  int level = 0;
+  while (level < WHEEL_LEVELS - 1 &&
+	 delta >= ((uint64_t)1 << (WHEEL_BITS * (level + 1))))
+    level++;
+  return &wheel[level][(tick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+}
+
+/* Re-disperse a maturing higher-level slot.  Entries move down a level
+ * (or straight to level 0) based on how far off their deadlines now
+ * are; nothing in the slot can be in the past, since it would have been
+ * placed lower to begin with. */
+void SafeTimer::_cascade(int level, uint64_t t)
+{
+  slot_t tmp;
+  tmp.swap(wheel[level][(t >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+  while (!tmp.empty()) {
+    utime_t when = tmp.front().first;
+    Context *callback = tmp.front().second;
+    tmp.pop_front();
+
+    uint64_t tick = _tick_after(when);
+    if (tick < last_tick)
+      tick = last_tick;
+    slot_t *slot = _slot_for(tick);
+    slot->push_back(std::make_pair(when, callback));
+
+    event_info& info = events[callback];
+    info.slot = slot;
+    info.it = slot->end();
+    --info.it;
+  }
+}
+
+/* Earliest tick at which the thread has work: either a level 0 slot to
+ * fire or a higher-level slot to cascade.  Returns (uint64_t)-1 when
+ * there are no events at all.  This is an O(WHEEL_LEVELS * WHEEL_SIZE)
+ * scan of empty/non-empty flags, done once per sleep, not per event. */
+uint64_t SafeTimer::_next_due_tick() const
+{
+  if (events.empty())
+    return (uint64_t)-1;
+
+  uint64_t best = (uint64_t)-1;
+  for (int i = 0; i < WHEEL_SIZE; i++) {
+    uint64_t t = last_tick + i;
+    if (!wheel[0][t & WHEEL_MASK].empty()) {
+      best = t;
+      break;
+    }
+  }
+  for (int level = 1; level < WHEEL_LEVELS; level++) {
+    uint64_t cur = last_tick >> (WHEEL_BITS * level);
+    for (int i = 1; i <= WHEEL_SIZE; i++) {
+      uint64_t boundary = (cur + i) << (WHEEL_BITS * level);
+      if (boundary >= best)
+	break;
+      if (!wheel[level][(cur + i) & WHEEL_MASK].empty()) {
+	best = boundary;
+	break;
+      }
+    }
+  }
+  return best;
+}
+
 void SafeTimer::timer_thread()
 {
   lock.Lock();
   ldout(cct,10) << "timer_thread starting" << dendl;
   while (!stopping) {
     utime_t now = ceph_clock_now(cct);
-    
-    while (!schedule.empty()) {
-      scheduled_map_t::iterator p = schedule.begin();
-
-      // is the future now?
-      if (p->first > now)
+    uint64_t now_tick = _tick_at(now);
+
+    while (last_tick <= now_tick) {
+      uint64_t t = last_tick;
+
+      // pull maturing higher-level slots down into the wheel
+      for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+	if ((t & (((uint64_t)1 << (WHEEL_BITS * level)) - 1)) == 0)
+	  _cascade(level, t);
+      }
+
+      // everything in this slot is due now
+      slot_t *slot = &wheel[0][t & WHEEL_MASK];
+      while (!slot->empty()) {
+	Context *callback = slot->front().second;
+	slot->pop_front();
+	events.erase(callback);
+	ldout(cct,10) << "timer_thread executing " << callback << dendl;
+
+	if (!safe_callbacks)
+	  lock.Unlock();
+	callback->complete(0);
+	if (!safe_callbacks)
+	  lock.Lock();
+      }
+      last_tick = t + 1;
+
+      // recheck stopping if we dropped the lock
+      if (!safe_callbacks && stopping)
 	break;
-
-      Context *callback = p->second;
-      events.erase(callback);
-      schedule.erase(p);
-      ldout(cct,10) << "timer_thread executing " << callback << dendl;
-      
-      if (!safe_callbacks)
-	lock.Unlock();
-      callback->complete(0);
-      if (!safe_callbacks)
-	lock.Lock();
     }
-
-    // recheck stopping if we dropped the lock
     if (!safe_callbacks && stopping)
       break;
 
     ldout(cct,20) << "timer_thread going to sleep" << dendl;
-    if (schedule.empty())
+    wake_tick = _next_due_tick();
+    if (wake_tick == (uint64_t)-1) {
       cond.Wait(lock);
-    else
-      cond.WaitUntil(lock, schedule.begin()->first);
+    } else {
+      utime_t deadline = base;
+      deadline += (double)wake_tick * ((double)TICK_NSEC / 1000000000.0);
+      cond.WaitUntil(lock, deadline);
+    }
+    wake_tick = 0;
     ldout(cct,20) << "timer_thread awake" << dendl;
   }
   ldout(cct,10) << "timer_thread exiting" << dendl;
@@ -136,36 +239,42 @@ void SafeTimer::add_event_at(utime_t when, Context *callback)
   assert(lock.is_locked());
   ldout(cct,10) << "add_event_at " << when << " -> " << callback << dendl;
 
-  scheduled_map_t::value_type s_val(when, callback);
-  scheduled_map_t::iterator i = schedule.insert(s_val);
+  uint64_t tick = _tick_after(when);
+  if (tick < last_tick)
+    tick = last_tick;
+  slot_t *slot = _slot_for(tick);
+  slot->push_back(std::make_pair(when, callback));
 
-  event_lookup_map_t::value_type e_val(callback, i);
-  pair < event_lookup_map_t::iterator, bool > rval(events.insert(e_val));
+  event_info info;
+  info.slot = slot;
+  info.it = slot->end();
+  --info.it;
+  std::pair<event_lookup_map_t::iterator, bool> rval(
+    events.insert(std::make_pair(callback, info)));
 
   /* If you hit this, you tried to insert the same Context* twice. */
   assert(rval.second);
 
-  /* If the event we have just inserted comes before everything else, we need to
-   * adjust our timeout. */
-  if (i == schedule.begin())
+  /* If the event we have just inserted comes before the thread's next
+   * wakeup, we need to adjust its timeout. */
+  if (tick < wake_tick)
     cond.Signal();
-
 }
 
 bool SafeTimer::cancel_event(Context *callback)
 {
   assert(lock.is_locked());
-  
-  std::map<Context*, std::multimap<utime_t, Context*>::iterator>::iterator p = events.find(callback);
+
+  event_lookup_map_t::iterator p = events.find(callback);
   if (p == events.end()) {
     ldout(cct,10) << "cancel_event " << callback << " not found" << dendl;
     return false;
   }
 
-  ldout(cct,10) << "cancel_event " << p->second->first << " -> " << callback << dendl;
+  ldout(cct,10) << "cancel_event " << p->second.it->first << " -> " << callback << dendl;
   delete p->first;
 
-  schedule.erase(p->second);
+  p->second.slot->erase(p->second.it);
   events.erase(p);
   return true;
 }
@@ -174,12 +283,12 @@ void SafeTimer::cancel_all_events()
 {
   ldout(cct,10) << "cancel_all_events" << dendl;
   assert(lock.is_locked());
-  
+
   while (!events.empty()) {
-    std::map<Context*, std::multimap<utime_t, Context*>::iterator>::iterator p = events.begin();
-    ldout(cct,10) << " cancelled " << p->second->first << " -> " << p->first << dendl;
+    event_lookup_map_t::iterator p = events.begin();
+    ldout(cct,10) << " cancelled " << p->second.it->first << " -> " << p->first << dendl;
     delete p->first;
-    schedule.erase(p->second);
+    p->second.slot->erase(p->second.it);
     events.erase(p);
   }
 }
@@ -190,8 +299,10 @@ void SafeTimer::dump(const char *caller) const
     caller = "";
   ldout(cct,10) << "dump " << caller << dendl;
 
-  for (scheduled_map_t::const_iterator s = schedule.begin();
-       s != schedule.end();
-       ++s)
-    ldout(cct,10) << " " << s->first << "->" << s->second << dendl;
+  for (int level = 0; level < WHEEL_LEVELS; level++)
+    for (int i = 0; i < WHEEL_SIZE; i++)
+      for (slot_t::const_iterator s = wheel[level][i].begin();
+	   s != wheel[level][i].end();
+	   ++s)
+	ldout(cct,10) << " " << s->first << "->" << s->second << dendl;
 }
@@ -19,7 +19,10 @@
 #include "Mutex.h"
 #include "RWLock.h"
 
-#include <map>
+#include "include/unordered_map.h"
+
+#include <list>
+#include <utility>
 
 class CephContext;
 class Context;
@@ -42,10 +45,39 @@ class SafeTimer
   void timer_thread();
   void _shutdown();
 
-  std::multimap<utime_t, Context*> schedule;
-  std::map<Context*, std::multimap<utime_t, Context*>::iterator> events;
+  /* Events live in a hierarchical timing wheel.  Level 0 holds the next
+   * WHEEL_SIZE ticks at TICK_NSEC granularity; each higher level covers
+   * WHEEL_SIZE times the span of the level below.  Scheduling and
+   * cancelling are O(1); a distant event cascades down one level at a
+   * time as its deadline approaches.  Events never fire early, and fire
+   * at most one tick late. */
+  static const int WHEEL_BITS = 8;
+  static const int WHEEL_SIZE = 1 << WHEEL_BITS;
+  static const int WHEEL_MASK = WHEEL_SIZE - 1;
+  static const int WHEEL_LEVELS = 4;
+  static const uint64_t TICK_NSEC = 1000000ull;   ///< 1ms granularity
+
+  typedef std::list<std::pair<utime_t, Context*> > slot_t;
+
+  struct event_info {
+    slot_t *slot;
+    slot_t::iterator it;
+  };
+  typedef ceph::unordered_map<Context*, event_info> event_lookup_map_t;
+
+  slot_t wheel[WHEEL_LEVELS][WHEEL_SIZE];
+  event_lookup_map_t events;
+  utime_t base;        ///< wheel epoch; ticks count from here
+  uint64_t last_tick;  ///< every slot before this tick has been processed
+  uint64_t wake_tick;  ///< tick the timer thread is sleeping until
   bool stopping;
 
+  uint64_t _tick_at(utime_t t) const;
+  uint64_t _tick_after(utime_t t) const;
+  uint64_t _next_due_tick() const;
+  slot_t *_slot_for(uint64_t tick);
+  void _cascade(int level, uint64_t t);
+
   void dump(const char *caller = 0) const;
 
 public:
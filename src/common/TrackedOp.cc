@@ -90,7 +90,7 @@ void OpHistory::dump_ops(utime_t now, Formatter *f)
 
 void OpTracker::dump_historic_ops(Formatter *f)
 {
-  utime_t now = ceph_clock_now(cct);
+  utime_t now = ceph_coarse_clock_now(cct);
   history.dump_ops(now, f);
 }
 
@@ -99,7 +99,7 @@ void OpTracker::dump_ops_in_flight(Formatter *f)
   f->open_object_section("ops_in_flight"); // overall dump
   uint64_t total_ops_in_flight = 0;
   f->open_array_section("ops"); // list of TrackedOps
-  utime_t now = ceph_clock_now(cct);
+  utime_t now = ceph_coarse_clock_now(cct);
   for (uint32_t i = 0; i < num_optracker_shards; i++) {
     ShardedTrackingData* sdata = sharded_in_flight_list[i];
     assert(NULL != sdata); 
@@ -113,6 +113,11 @@ void OpTracker::dump_ops_in_flight(Formatter *f)
   }
   f->close_section(); // list of TrackedOps
   f->dump_int("num_ops", total_ops_in_flight);
+  uint64_t started = untracked_started.read();
+  uint64_t finished = untracked_finished.read();
+  f->dump_unsigned("sample_interval", sample_interval.read());
+  f->dump_unsigned("num_untracked_ops", started > finished ? started - finished : 0);
+  f->dump_unsigned("untracked_ops_total", started);
   f->close_section(); // overall dump
 }
 
@@ -135,7 +140,7 @@ void OpTracker::register_inflight_op(xlist<TrackedOp*>::item *i)
 void OpTracker::unregister_inflight_op(TrackedOp *i)
 {
   // caller checks;
-  assert(tracking_enabled);
+  assert(i->tracked);
 
   uint32_t shard_index = i->seq % num_optracker_shards;
   ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
@@ -146,7 +151,7 @@ void OpTracker::unregister_inflight_op(TrackedOp *i)
     i->xitem.remove_myself();
   }
   i->_unregistered();
-  utime_t now = ceph_clock_now(cct);
+  utime_t now = ceph_coarse_clock_now(cct);
   history.insert(now, TrackedOpRef(i));
 }
 
@@ -155,7 +160,7 @@ bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector)
   if (!tracking_enabled)
     return false;
 
-  utime_t now = ceph_clock_now(cct);
+  utime_t now = ceph_coarse_clock_now(cct);
   utime_t too_old = now;
   too_old -= complaint_time;
   utime_t oldest_op = now;
@@ -177,7 +182,7 @@ bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector)
   if (0 == total_ops_in_flight)
     return false;
 
-  utime_t oldest_secs = now - oldest_op;
+  utime_t oldest_secs = now > oldest_op ? now - oldest_op : utime_t();
 
   dout(10) << "ops_in_flight.size: " << total_ops_in_flight
            << "; oldest is " << oldest_secs
@@ -211,7 +216,8 @@ bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector)
         if (warned > log_threshold)
           break;
 
-        utime_t age = now - (*i)->get_initiated();
+        utime_t age = now > (*i)->get_initiated() ?
+          now - (*i)->get_initiated() : utime_t();
         stringstream ss;
         ss << "slow request " << age << " seconds old, received at "
            << (*i)->get_initiated() << ": ";
@@ -243,7 +249,7 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
 {
   h->clear();
 
-  utime_t now = ceph_clock_now(NULL);
+  utime_t now = ceph_coarse_clock_now(NULL);
   unsigned bin = 30;
   uint32_t lb = 1 << (bin-1);  // lower bound for this bin
   int count = 0;
@@ -255,7 +261,8 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
 
     for (xlist<TrackedOp*>::iterator i = sdata->ops_in_flight_sharded.begin();
                                                                !i.end(); ++i) {
-      utime_t age = now - (*i)->get_initiated();
+      utime_t age = now > (*i)->get_initiated() ?
+        now - (*i)->get_initiated() : utime_t();
       uint32_t ms = (long)(age * 1000.0);
       if (ms >= lb) {
         count++;
@@ -294,7 +301,8 @@ void OpTracker::_mark_event(TrackedOp *op, const string &evt,
 }
 
 void OpTracker::RemoveOnDelete::operator()(TrackedOp *op) {
-  if (!tracker->tracking_enabled) {
+  if (!op->tracked) {
+    tracker->account_untracked_finish();
     op->_unregistered();
     delete op;
     return;
@@ -306,10 +314,10 @@ void OpTracker::RemoveOnDelete::operator()(TrackedOp *op) {
 
 void TrackedOp::mark_event(const string &event)
 {
-  if (!tracker->tracking_enabled)
+  if (!tracked)
     return;
 
-  utime_t now = ceph_clock_now(g_ceph_context);
+  utime_t now = ceph_coarse_clock_now(g_ceph_context);
   {
     Mutex::Locker l(lock);
     events.push_back(make_pair(now, event));
@@ -324,7 +332,8 @@ void TrackedOp::dump(utime_t now, Formatter *f) const
   _dump_op_descriptor_unlocked(name);
   f->dump_string("description", name.str().c_str()); // this TrackedOp
   f->dump_stream("initiated_at") << get_initiated();
-  f->dump_float("age", now - get_initiated());
+  f->dump_float("age", now > get_initiated() ?
+		double(now - get_initiated()) : 0.0);
   f->dump_float("duration", get_duration());
   {
     f->open_array_section("type_data");
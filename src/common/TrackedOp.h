@@ -72,14 +72,19 @@ class OpTracker {
   OpHistory history;
   float complaint_time;
   int log_threshold;
+  atomic_t sample_interval;     ///< track every Nth op in full; 1 = all
+  atomic64_t all_ops;           ///< every op seen, sampled or not
+  atomic64_t untracked_started; ///< ops that got counter-only accounting
+  atomic64_t untracked_finished;
   void _mark_event(TrackedOp *op, const string &evt, utime_t now);
 
 public:
   bool tracking_enabled;
   CephContext *cct;
-  OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards) : seq(0), 
+  OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards) : seq(0),
                                      num_optracker_shards(num_shards),
 				     complaint_time(0), log_threshold(0),
+				     sample_interval(1),
 				     tracking_enabled(tracking), cct(cct_) {
 
     for (uint32_t i = 0; i < num_optracker_shards; i++) {
@@ -97,6 +102,27 @@ public:
   void set_history_size_and_duration(uint32_t new_size, uint32_t new_duration) {
     history.set_size_and_duration(new_size, new_duration);
   }
+  void set_sample_interval(uint32_t n) {
+    sample_interval.set(n ? n : 1);
+  }
+  /**
+   * Decide whether a newly created op gets full event tracking or just
+   * the atomic counters.  With an interval of 1 (the default) every op
+   * is tracked, preserving the old behavior.
+   */
+  bool should_track_new_op() {
+    if (!tracking_enabled)
+      return false;
+    uint32_t n = sample_interval.read();
+    uint64_t c = all_ops.inc();
+    return n <= 1 || (c % n) == 0;
+  }
+  void account_untracked_start() {
+    untracked_started.inc();
+  }
+  void account_untracked_finish() {
+    untracked_finished.inc();
+  }
   void dump_ops_in_flight(Formatter *f);
   void dump_historic_ops(Formatter *f);
   void register_inflight_op(xlist<TrackedOp*>::item *i);
@@ -114,7 +140,7 @@ public:
    */
   bool check_ops_in_flight(std::vector<string> &warning_strings);
   void mark_event(TrackedOp *op, const string &evt,
-                          utime_t time = ceph_clock_now(g_ceph_context));
+                          utime_t time = ceph_coarse_clock_now(g_ceph_context));
 
   void on_shutdown() {
     history.on_shutdown();
@@ -151,6 +177,7 @@ protected:
   uint64_t seq; /// a unique value set by the OpTracker
 
   uint32_t warn_interval_multiplier; // limits output of a given op warning
+  bool tracked; ///< in the sampled set; false means counter-only accounting
 
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
     xitem(this),
@@ -158,11 +185,15 @@ protected:
     initiated_at(initiated),
     lock("TrackedOp::lock"),
     seq(0),
-    warn_interval_multiplier(1)
+    warn_interval_multiplier(1),
+    tracked(tracker->should_track_new_op())
   {
-    tracker->register_inflight_op(&xitem);
-    if (tracker->tracking_enabled)
+    if (tracked) {
+      tracker->register_inflight_op(&xitem);
       events.push_back(make_pair(initiated_at, "initiated"));
+    } else {
+      tracker->account_untracked_start();
+    }
   }
 
   /// output any type-specific data you want to get when dump() is called
@@ -184,8 +215,10 @@ public:
   double get_duration() const {
     if (!events.empty() && events.rbegin()->second.compare("done") == 0)
       return events.rbegin()->first - get_initiated();
-    else
-      return ceph_clock_now(NULL) - get_initiated();
+    // the coarse clock can lag a precise initiated_at stamp by a tick;
+    // don't let the unsigned subtraction wrap
+    utime_t now = ceph_coarse_clock_now(NULL);
+    return now > get_initiated() ? double(now - get_initiated()) : 0.0;
   }
 
   void mark_event(const string &event);
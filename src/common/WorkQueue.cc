@@ -355,6 +355,12 @@ void ShardedThreadPool::start_threads()
 
     WorkThreadSharded *wt = new WorkThreadSharded(this, thread_index);
     ldout(cct, 10) << "start_threads creating and starting " << wt << dendl;
+    if (!thread_cpu_affinity.empty()) {
+      int cpuid = thread_cpu_affinity[thread_index % thread_cpu_affinity.size()];
+      ldout(cct, 10) << "start_threads pinning thread " << thread_index
+		     << " to cpu " << cpuid << dendl;
+      wt->set_affinity(cpuid);
+    }
     threads_shardedpool.push_back(wt);
     wt->create();
     thread_index++;
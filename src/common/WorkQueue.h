@@ -595,6 +595,7 @@ private:
   };
 
   vector<WorkThreadSharded*> threads_shardedpool;
+  vector<int> thread_cpu_affinity;
   void start_threads();
   void shardedthreadpool_worker(uint32_t thread_index);
   void set_wq(BaseShardedWQ* swq) {
@@ -622,6 +623,12 @@ public:
   /// wait for all work to complete
   void drain();
 
+  /// pin worker thread i to cpus[i % cpus.size()]; call before start()
+  void set_thread_cpu_affinity(const vector<int>& cpus) {
+    Mutex::Locker l(shardedpool_lock);
+    thread_cpu_affinity = cpus;
+  }
+
 };
 
 
@@ -68,6 +68,15 @@ public:
   }
   void clear();
 
+  /**
+   * Only materialize the pages covering the given element range when
+   * the vector is sized (directly or via decode_header).  Accessors and
+   * the ranged encode/decode calls may then only touch that window, but
+   * memory use and update cost scale with the window instead of the
+   * full table.  Must be set before the vector is sized.
+   */
+  void set_data_window(uint64_t offset, uint64_t length);
+
   void resize(uint64_t elements);
   uint64_t size() const;
 
@@ -103,15 +112,26 @@ private:
   uint64_t m_size;
   bool m_crc_enabled;
 
+  bool m_windowed;
+  uint64_t m_window_eoff;
+  uint64_t m_window_elen;
+  uint64_t m_data_offset;   ///< byte offset of m_data within the full table
+
   mutable __u32 m_header_crc;
   mutable std::vector<__u32> m_data_crcs;
 
+  uint64_t data_byte_length() const {
+    return (m_size + ELEMENTS_PER_BLOCK - 1) / ELEMENTS_PER_BLOCK;
+  }
+
   static void compute_index(uint64_t offset, uint64_t *index, uint64_t *shift);
 
 };
 
 template <uint8_t _b>
-BitVector<_b>::BitVector() : m_size(0), m_crc_enabled(true)
+BitVector<_b>::BitVector() : m_size(0), m_crc_enabled(true),
+			     m_windowed(false), m_window_eoff(0),
+			     m_window_elen(0), m_data_offset(0)
 {
 }
 
@@ -121,19 +141,43 @@ void BitVector<_b>::clear() {
   m_data_crcs.clear();
   m_size = 0;
   m_header_crc = 0;
+  m_windowed = false;
+  m_window_eoff = 0;
+  m_window_elen = 0;
+  m_data_offset = 0;
+}
+
+template <uint8_t _b>
+void BitVector<_b>::set_data_window(uint64_t offset, uint64_t length) {
+  assert(m_size == 0);
+  m_windowed = true;
+  m_window_eoff = offset;
+  m_window_elen = length;
 }
 
 template <uint8_t _b>
 void BitVector<_b>::resize(uint64_t size) {
   uint64_t buffer_size = (size + ELEMENTS_PER_BLOCK - 1) / ELEMENTS_PER_BLOCK;
-  if (buffer_size > m_data.length()) {
+  m_size = size;
+  if (m_windowed) {
+    // materialize only the pages covering the window
+    uint64_t eoff = MIN(m_window_eoff, size);
+    uint64_t elen = MIN(m_window_elen, size - eoff);
+    uint64_t byte_offset = 0;
+    uint64_t byte_length = 0;
+    if (elen > 0) {
+      get_data_extents(eoff, elen, &byte_offset, &byte_length);
+    }
+    m_data.clear();
+    m_data.append_zero(byte_length);
+    m_data_offset = byte_offset;
+  } else if (buffer_size > m_data.length()) {
     m_data.append_zero(buffer_size - m_data.length());
   } else if (buffer_size < m_data.length()) {
     bufferlist bl;
     bl.substr_of(m_data, 0, buffer_size);
     bl.swap(m_data);
   }
-  m_size = size;
 
   uint64_t block_count = (buffer_size + CEPH_PAGE_SIZE - 1) / CEPH_PAGE_SIZE;
   m_data_crcs.resize(block_count);
@@ -191,7 +235,8 @@ template <uint8_t _b>
 void BitVector<_b>::encode_data(bufferlist& bl, uint64_t byte_offset,
 				uint64_t byte_length) const {
   assert(byte_offset % CEPH_PAGE_SIZE == 0);
-  assert(byte_offset + byte_length == m_data.length() ||
+  assert(byte_offset >= m_data_offset);
+  assert(byte_offset + byte_length == m_data_offset + m_data.length() ||
 	 byte_length % CEPH_PAGE_SIZE == 0);
 
   uint64_t end_offset = byte_offset + byte_length;
@@ -199,7 +244,7 @@ void BitVector<_b>::encode_data(bufferlist& bl, uint64_t byte_offset,
     uint64_t len = MIN(CEPH_PAGE_SIZE, end_offset - byte_offset);
 
     bufferlist bit;
-    bit.substr_of(m_data, byte_offset, len);
+    bit.substr_of(m_data, byte_offset - m_data_offset, len);
     m_data_crcs[byte_offset / CEPH_PAGE_SIZE] = bit.crc32c(0);
 
     bl.claim_append(bit);
@@ -210,18 +255,19 @@ void BitVector<_b>::encode_data(bufferlist& bl, uint64_t byte_offset,
 template <uint8_t _b>
 void BitVector<_b>::decode_data(bufferlist::iterator& it, uint64_t byte_offset) {
   assert(byte_offset % CEPH_PAGE_SIZE == 0);
+  assert(byte_offset >= m_data_offset);
   if (it.end()) {
     return;
   }
 
   uint64_t end_offset = byte_offset + it.get_remaining();
-  if (end_offset > m_data.length()) {
+  if (end_offset > m_data_offset + m_data.length()) {
     throw buffer::end_of_buffer();
   }
 
   bufferlist data;
-  if (byte_offset > 0) {
-    data.substr_of(m_data, 0, byte_offset);
+  if (byte_offset > m_data_offset) {
+    data.substr_of(m_data, 0, byte_offset - m_data_offset);
   }
 
   while (byte_offset < end_offset) {
@@ -237,9 +283,10 @@ void BitVector<_b>::decode_data(bufferlist::iterator& it, uint64_t byte_offset)
     byte_offset += bit.length();
   }
 
-  if (m_data.length() > end_offset) {
+  if (m_data_offset + m_data.length() > end_offset) {
     bufferlist tail;
-    tail.substr_of(m_data, end_offset, m_data.length() - end_offset);
+    tail.substr_of(m_data, end_offset - m_data_offset,
+		   m_data_offset + m_data.length() - end_offset);
     data.append(tail);
   }
   assert(data.length() == m_data.length());
@@ -262,8 +309,8 @@ void BitVector<_b>::get_data_extents(uint64_t offset, uint64_t length,
   assert(*byte_offset <= end_offset);
 
   *byte_length = end_offset - *byte_offset;
-  if (*byte_offset + *byte_length > m_data.length()) {
-    *byte_length = m_data.length() - *byte_offset;
+  if (*byte_offset + *byte_length > data_byte_length()) {
+    *byte_length = data_byte_length() - *byte_offset;
   }
 }
 
@@ -292,7 +339,8 @@ void BitVector<_b>::decode_footer(bufferlist::iterator& it) {
       throw buffer::malformed_input("incorrect header CRC");
     }
 
-    uint64_t block_count = (m_data.length() + CEPH_PAGE_SIZE - 1) / CEPH_PAGE_SIZE;
+    uint64_t block_count =
+      (data_byte_length() + CEPH_PAGE_SIZE - 1) / CEPH_PAGE_SIZE;
     ::decode(m_data_crcs, footer_it);
     if (m_data_crcs.size() != block_count) {
       throw buffer::malformed_input("invalid data block CRCs");
@@ -302,11 +350,12 @@ void BitVector<_b>::decode_footer(bufferlist::iterator& it) {
 
 template <uint8_t _b>
 uint64_t BitVector<_b>::get_footer_offset() const {
-  return get_header_length() + m_data.length();
+  return get_header_length() + data_byte_length();
 }
 
 template <uint8_t _b>
 void BitVector<_b>::encode(bufferlist& bl) const {
+  assert(!m_windowed);
   encode_header(bl);
   encode_data(bl, 0, m_data.length());
   encode_footer(bl);
@@ -314,6 +363,7 @@ void BitVector<_b>::encode(bufferlist& bl) const {
 
 template <uint8_t _b>
 void BitVector<_b>::decode(bufferlist::iterator& it) {
+  assert(!m_windowed);
   decode_header(it);
 
   bufferlist data_bl;
@@ -364,6 +414,7 @@ BitVector<_b>::ConstReference::operator uint8_t() const {
   uint64_t index;
   uint64_t shift;
   this->m_bit_vector.compute_index(this->m_offset, &index, &shift);
+  index -= this->m_bit_vector.m_data_offset;
 
   return (this->m_bit_vector.m_data[index] >> shift) & MASK;
 }
@@ -379,6 +430,7 @@ BitVector<_b>::Reference::operator uint8_t() const {
   uint64_t index;
   uint64_t shift;
   this->m_bit_vector.compute_index(this->m_offset, &index, &shift);
+  index -= this->m_bit_vector.m_data_offset;
 
   return (this->m_bit_vector.m_data[index] >> shift) & MASK;
 }
@@ -388,6 +440,7 @@ typename BitVector<_b>::Reference& BitVector<_b>::Reference::operator=(uint8_t v
   uint64_t index;
   uint64_t shift;
   this->m_bit_vector.compute_index(this->m_offset, &index, &shift);
+  index -= this->m_bit_vector.m_data_offset;
 
   uint8_t mask = MASK << shift;
   char packed_value = (this->m_bit_vector.m_data[index] & ~mask) |
@@ -6,19 +6,23 @@
 
 void bloom_filter::encode(bufferlist& bl) const
 {
-  ENCODE_START(2, 2, bl);
+  // a decoder that doesn't know the blocked layout would probe the
+  // wrong bits, so blocked filters require compat 3; legacy-layout
+  // filters stay decodable by old code
+  ENCODE_START(3, blocked_ ? 3 : 2, bl);
   ::encode((uint64_t)salt_count_, bl);
   ::encode((uint64_t)insert_count_, bl);
   ::encode((uint64_t)target_element_count_, bl);
   ::encode((uint64_t)random_seed_, bl);
   bufferptr bp((const char*)bit_table_, table_size_);
   ::encode(bp, bl);
+  ::encode(blocked_, bl);
   ENCODE_FINISH(bl);
 }
 
 void bloom_filter::decode(bufferlist::iterator& p)
 {
-  DECODE_START(2, p);
+  DECODE_START(3, p);
   uint64_t v;
   ::decode(v, p);
   salt_count_ = v;
@@ -42,6 +46,12 @@ void bloom_filter::decode(bufferlist::iterator& p)
     bit_table_ = NULL;
   }
 
+  if (struct_v >= 3) {
+    ::decode(blocked_, p);
+  } else {
+    blocked_ = false;
+  }
+
   DECODE_FINISH(p);
 }
 
@@ -52,6 +62,7 @@ void bloom_filter::dump(Formatter *f) const
   f->dump_unsigned("insert_count", insert_count_);
   f->dump_unsigned("target_element_count", target_element_count_);
   f->dump_unsigned("random_seed", random_seed_);
+  f->dump_bool("blocked", blocked_);
 
   f->open_array_section("salt_table");
   for (std::vector<bloom_type>::const_iterator i = salt_.begin(); i != salt_.end(); ++i)
@@ -76,6 +87,9 @@ void bloom_filter::generate_test_instances(list<bloom_filter*>& ls)
   ls.back()->insert("baz");
   ls.back()->insert("boof");
   ls.back()->insert("boogggg");
+  ls.push_back(new bloom_filter(50, .5, 1, true));
+  ls.back()->insert("foo");
+  ls.back()->insert("bar");
 }
 
 
@@ -60,6 +60,11 @@ protected:
   std::size_t         insert_count_;  ///< insertion count
   std::size_t         target_element_count_;  ///< target number of unique insertions
   std::size_t         random_seed_;  ///< random seed
+  bool                blocked_;      ///< all probes for a key land in one cacheline
+
+  /// cacheline-sized probe blocks for the blocked layout
+  static const std::size_t block_shift = 6;
+  static const std::size_t block_size = 1 << block_shift;  // 64 bytes
 
 public:
 
@@ -69,16 +74,19 @@ public:
       table_size_(0),
       insert_count_(0),
       target_element_count_(0),
-      random_seed_(0)
+      random_seed_(0),
+      blocked_(false)
   {}
 
   bloom_filter(const std::size_t& predicted_inserted_element_count,
 	       const double& false_positive_probability,
-	       const std::size_t& random_seed)
+	       const std::size_t& random_seed,
+	       bool blocked = false)
     : bit_table_(0),
       insert_count_(0),
       target_element_count_(predicted_inserted_element_count),
-      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5)
+      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5),
+      blocked_(blocked)
   {
     assert(false_positive_probability > 0.0);
     find_optimal_parameters(predicted_inserted_element_count, false_positive_probability,
@@ -89,19 +97,25 @@ public:
   bloom_filter(const std::size_t& salt_count,
 	       std::size_t table_size,
 	       const std::size_t& random_seed,
-	       std::size_t target_element_count)
+	       std::size_t target_element_count,
+	       bool blocked = false)
     : bit_table_(0),
       salt_count_(salt_count),
       table_size_(table_size),
       insert_count_(0),
       target_element_count_(target_element_count),
-      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5)
+      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5),
+      blocked_(blocked)
   {
     init();
   }
 
   void init() {
     generate_unique_salt();
+    if (blocked_ && table_size_) {
+      // round up to whole probe blocks so every block is full-sized
+      table_size_ = (table_size_ + block_size - 1) & ~(block_size - 1);
+    }
     if (table_size_) {
       bit_table_ = new cell_type[table_size_];
       std::fill_n(bit_table_, table_size_, 0x00);
@@ -122,6 +136,7 @@ public:
       salt_count_ = filter.salt_count_;
       table_size_ = filter.table_size_;
       insert_count_ = filter.insert_count_;
+      blocked_ = filter.blocked_;
       target_element_count_ = filter.target_element_count_;
       random_seed_ = filter.random_seed_;
       delete[] bit_table_;
@@ -160,12 +175,21 @@ public:
    */
   inline void insert(uint32_t val) {
     assert(bit_table_);
-    std::size_t bit_index = 0;
-    std::size_t bit = 0;
-    for (std::size_t i = 0; i < salt_.size(); ++i)
-    {
-      compute_indices(hash_ap(val,salt_[i]),bit_index,bit);
-      bit_table_[bit_index >> 3] |= bit_mask[bit];
+    if (blocked_) {
+      std::size_t block = compute_block(block_hash(val));
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+	std::size_t bit = hash_ap(val,salt_[i]) & (block_size * bits_per_char - 1);
+	bit_table_[block + (bit >> 3)] |= bit_mask[bit & 7];
+      }
+    } else {
+      std::size_t bit_index = 0;
+      std::size_t bit = 0;
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+	compute_indices(hash_ap(val,salt_[i]),bit_index,bit);
+	bit_table_[bit_index >> 3] |= bit_mask[bit];
+      }
     }
     ++insert_count_;
   }
@@ -173,16 +197,46 @@ public:
   inline void insert(const unsigned char* key_begin, const std::size_t& length)
   {
     assert(bit_table_);
-    std::size_t bit_index = 0;
-    std::size_t bit = 0;
-    for (std::size_t i = 0; i < salt_.size(); ++i)
-    {
-      compute_indices(hash_ap(key_begin,length,salt_[i]),bit_index,bit);
-      bit_table_[bit_index >> 3] |= bit_mask[bit];
+    if (blocked_) {
+      std::size_t block = compute_block(block_hash(key_begin,length));
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+	std::size_t bit = hash_ap(key_begin,length,salt_[i]) &
+	  (block_size * bits_per_char - 1);
+	bit_table_[block + (bit >> 3)] |= bit_mask[bit & 7];
+      }
+    } else {
+      std::size_t bit_index = 0;
+      std::size_t bit = 0;
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+	compute_indices(hash_ap(key_begin,length,salt_[i]),bit_index,bit);
+	bit_table_[bit_index >> 3] |= bit_mask[bit];
+      }
     }
     ++insert_count_;
   }
 
+  /**
+   * batch insert of u32 values
+   *
+   * Prefetches a window ahead of the insertion point so the table
+   * lines for upcoming values are in flight while earlier values are
+   * being inserted.
+   */
+  inline void insert(const uint32_t *vals, std::size_t count)
+  {
+    const std::size_t window = 16;
+    std::size_t ahead = std::min(window, count);
+    for (std::size_t i = 0; i < ahead; ++i)
+      prefetch(vals[i]);
+    for (std::size_t i = 0; i < count; ++i) {
+      if (i + ahead < count)
+	prefetch(vals[i + ahead]);
+      insert(vals[i]);
+    }
+  }
+
   template<typename T>
   inline void insert(const T& t)
   {
@@ -224,6 +278,18 @@ public:
   {
     if (!bit_table_)
       return false;
+    if (blocked_) {
+      std::size_t block = compute_block(block_hash(val));
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+	std::size_t bit = hash_ap(val,salt_[i]) & (block_size * bits_per_char - 1);
+	if ((bit_table_[block + (bit >> 3)] & bit_mask[bit & 7]) == 0)
+	{
+	  return false;
+	}
+      }
+      return true;
+    }
     std::size_t bit_index = 0;
     std::size_t bit = 0;
     for (std::size_t i = 0; i < salt_.size(); ++i)
@@ -237,10 +303,72 @@ public:
     return true;
   }
 
+  /**
+   * batch query of u32 values
+   *
+   * Fills out[i] with contains(vals[i]), prefetching a window ahead
+   * so each miss overlaps the probes of earlier values instead of
+   * serializing.
+   */
+  inline void contains(const uint32_t *vals, std::size_t count, bool *out) const
+  {
+    const std::size_t window = 16;
+    std::size_t ahead = std::min(window, count);
+    for (std::size_t i = 0; i < ahead; ++i)
+      prefetch(vals[i]);
+    for (std::size_t i = 0; i < count; ++i) {
+      if (i + ahead < count)
+	prefetch(vals[i + ahead]);
+      out[i] = contains(vals[i]);
+    }
+  }
+
+  /**
+   * prefetch the table bytes a contains(val) probe will touch
+   *
+   * The probe positions are effectively random, so a batch of queries
+   * stalls on a cache miss per salt per query.  Calling this for each
+   * value in the batch before doing the contains() calls lets those
+   * misses resolve in parallel.  It recomputes the per-salt hashes
+   * (cheap ALU work) rather than growing the query interface.
+   *
+   * @param val integer value that will be queried
+   */
+  inline void prefetch(uint32_t val) const
+  {
+    if (!bit_table_)
+      return;
+    if (blocked_) {
+      // all probes live in one cacheline-sized block
+      __builtin_prefetch(&bit_table_[compute_block(block_hash(val))], 0, 1);
+      return;
+    }
+    std::size_t bit_index = 0;
+    std::size_t bit = 0;
+    for (std::size_t i = 0; i < salt_.size(); ++i)
+    {
+      compute_indices(hash_ap(val,salt_[i]),bit_index,bit);
+      __builtin_prefetch(&bit_table_[bit_index >> 3], 0, 1);
+    }
+  }
+
   inline virtual bool contains(const unsigned char* key_begin, const std::size_t length) const
   {
     if (!bit_table_)
       return false;
+    if (blocked_) {
+      std::size_t block = compute_block(block_hash(key_begin,length));
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+	std::size_t bit = hash_ap(key_begin,length,salt_[i]) &
+	  (block_size * bits_per_char - 1);
+	if ((bit_table_[block + (bit >> 3)] & bit_mask[bit & 7]) == 0)
+	{
+	  return false;
+	}
+      }
+      return true;
+    }
     std::size_t bit_index = 0;
     std::size_t bit = 0;
     for (std::size_t i = 0; i < salt_.size(); ++i)
@@ -361,6 +489,20 @@ public:
     return bit_table_;
   }
 
+  /**
+   * true if this filter uses the cacheline-blocked probe layout
+   *
+   * Blocked filters confine all of a key's probes to one 64-byte block
+   * chosen by a separate hash, so a query costs at most one cache miss
+   * instead of one per salt, at a small false-positive penalty.  The
+   * layout is fixed at construction (or taken from the encoding on
+   * decode) since it determines which bits the probes touch.
+   */
+  inline bool is_blocked() const
+  {
+    return blocked_;
+  }
+
 protected:
 
   inline virtual void compute_indices(const bloom_type& hash, std::size_t& bit_index, std::size_t& bit) const
@@ -369,6 +511,28 @@ protected:
     bit = bit_index & 7;
   }
 
+  /**
+   * hash used only for block selection in the blocked layout
+   *
+   * Perturbing the input decorrelates it from the per-salt probe
+   * hashes, which reuse the same salts.
+   */
+  inline bloom_type block_hash(uint32_t val) const
+  {
+    return hash_ap(val ^ 0x5bd1e995, salt_[0]);
+  }
+  inline bloom_type block_hash(const unsigned char* key_begin,
+			       const std::size_t& length) const
+  {
+    return hash_ap(key_begin, length, salt_[0] ^ 0x5bd1e995);
+  }
+
+  /// map a block-selection hash to the byte offset of its block
+  inline virtual std::size_t compute_block(const bloom_type& hash) const
+  {
+    return (hash % (table_size_ >> block_shift)) << block_shift;
+  }
+
   void generate_unique_salt()
   {
     /*
@@ -538,8 +702,10 @@ public:
 
   compressible_bloom_filter(const std::size_t& predicted_element_count,
 			    const double& false_positive_probability,
-			    const std::size_t& random_seed)
-    : bloom_filter(predicted_element_count, false_positive_probability, random_seed)
+			    const std::size_t& random_seed,
+			    bool blocked = false)
+    : bloom_filter(predicted_element_count, false_positive_probability,
+		   random_seed, blocked)
   {
     size_list.push_back(table_size_);
   }
@@ -547,8 +713,9 @@ public:
   compressible_bloom_filter(const std::size_t& salt_count,
 			    std::size_t table_size,
 			    const std::size_t& random_seed,
-			    std::size_t target_count)
-    : bloom_filter(salt_count, table_size, random_seed, target_count)
+			    std::size_t target_count,
+			    bool blocked = false)
+    : bloom_filter(salt_count, table_size, random_seed, target_count, blocked)
   {
     size_list.push_back(table_size_);
   }
@@ -571,6 +738,11 @@ public:
     std::size_t original_table_size = size_list.back();
     std::size_t new_table_size = static_cast<std::size_t>(size_list.back() * target_ratio);
 
+    if (blocked_) {
+      // keep whole probe blocks so in-block offsets survive the fold
+      new_table_size &= ~(block_size - 1);
+    }
+
     if ((!new_table_size) || (new_table_size >= original_table_size))
     {
       return false;
@@ -617,6 +789,18 @@ private:
     bit = bit_index & 7;
   }
 
+  inline virtual std::size_t compute_block(const bloom_type& hash) const
+  {
+    // compress() folds whole blocks, so chaining the block index
+    // through the size history lands on the folded block
+    std::size_t b = hash;
+    for (std::size_t i = 0; i < size_list.size(); ++i)
+    {
+      b %= size_list[i] >> block_shift;
+    }
+    return b << block_shift;
+  }
+
   std::vector<std::size_t> size_list;
 public:
   void encode(bufferlist& bl) const;
@@ -216,6 +216,46 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     }
   };
 
+  /*
+   * raw_combined is always placed within a single allocation along
+   * with the data buffer.  the data goes at the beginning, and
+   * raw_combined at the end, so that the buffer contents keep malloc's
+   * natural alignment.  this halves the allocator traffic for the
+   * (very common) small buffers coming out of encode and the
+   * messengers.
+   */
+  class buffer::raw_combined : public buffer::raw {
+  public:
+    raw_combined(char *dataptr, unsigned l) : raw(dataptr, l) {
+      inc_total_alloc(len);
+      bdout << "raw_combined " << this << " alloc " << (void *)data << " " << l << " " << buffer::get_total_alloc() << bendl;
+    }
+    ~raw_combined() {
+      dec_total_alloc(len);
+      bdout << "raw_combined " << this << " free " << (void *)data << " " << buffer::get_total_alloc() << bendl;
+    }
+    raw* clone_empty() {
+      return create(len);
+    }
+
+    static raw_combined *create(unsigned len) {
+      // pad the data out so the raw_combined object that follows it
+      // stays pointer-aligned
+      size_t datalen = ROUND_UP_TO(len, sizeof(void *));
+      char *p = (char *)malloc(datalen + sizeof(raw_combined));
+      if (!p)
+	throw bad_alloc();
+      return new (p + datalen) raw_combined(p, len);
+    }
+
+    static void operator delete(void *ptr) {
+      // the data pointer is the start of the single allocation; this
+      // fires after the dtor, like xio_msg_buffer's does
+      raw_combined *raw = (raw_combined *)ptr;
+      ::free((void *)raw->data);
+    }
+  };
+
   class buffer::raw_malloc : public buffer::raw {
   public:
     raw_malloc(unsigned l) : raw(l) {
@@ -610,12 +650,12 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
 #endif /* HAVE_XIO */
 
   buffer::raw* buffer::copy(const char *c, unsigned len) {
-    raw* r = new raw_char(len);
+    raw* r = raw_combined::create(len);
     memcpy(r->data, c, len);
     return r;
   }
   buffer::raw* buffer::create(unsigned len) {
-    return new raw_char(len);
+    return raw_combined::create(len);
   }
   buffer::raw* buffer::claim_char(unsigned len, char *buf) {
     return new raw_char(len, buf);
@@ -855,6 +895,12 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     maybe_inline_memcpy(dest, src, l, 64);
   }
 
+  void buffer::ptr::invalidate_crc()
+  {
+    if (_raw)
+      _raw->invalidate_crc();
+  }
+
   void buffer::ptr::zero(bool crc_reset)
   {
     if (crc_reset)
@@ -1477,6 +1523,29 @@ static simple_spinlock_t buffer_debug_lock = SIMPLE_SPINLOCK_INITIALIZER;
     append(bp);
   }
 
+  char *buffer::list::reserve_contiguous(unsigned len)
+  {
+    assert(len > 0);
+    if (!append_buffer.get_raw() ||
+	append_buffer.unused_tail_length() < len) {
+      // make a new append_buffer, rounded up like append() does so
+      // small reservations keep sharing one buffer
+      unsigned alen = CEPH_BUFFER_APPEND_SIZE * (((len-1) / CEPH_BUFFER_APPEND_SIZE) + 1);
+      append_buffer = create_aligned(alen, CEPH_BUFFER_APPEND_SIZE);
+      append_buffer.set_length(0);   // unused, so far.
+    }
+    return append_buffer.c_str() + append_buffer.length();
+  }
+
+  void buffer::list::append_reserved(unsigned len)
+  {
+    if (!len)
+      return;
+    assert(len <= append_buffer.unused_tail_length());
+    append_buffer.set_length(append_buffer.length() + len);
+    append(append_buffer, append_buffer.end() - len, len);	// add segment to the list
+  }
+
   
   /*
    * get a char
@@ -1895,6 +1964,12 @@ __u32 buffer::list::crc32c(__u32 crc) const
        ++it) {
     if (it->length()) {
       raw *r = it->get_raw();
+      if (it->length() < 256) {
+	// tiny fragment (message header and the like): computing the
+	// crc directly is cheaper than the raw's crc cache lock and map
+	crc = ceph_crc32c(crc, (unsigned char*)it->c_str(), it->length());
+	continue;
+      }
       pair<size_t, size_t> ofs(it->offset(), it->offset() + it->length());
       pair<uint32_t, uint32_t> ccrc;
       if (r->get_crc(ofs, &ccrc)) {
@@ -25,6 +25,7 @@
 #include "common/debug.h"
 #include "common/HeartbeatMap.h"
 #include "common/errno.h"
+#include "common/lock_contention.h"
 #include "common/lockdep.h"
 #include "common/Formatter.h"
 #include "log/Log.h"
@@ -280,6 +281,14 @@ void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
   }
   lgeneric_dout(this, 1) << "do_command '" << command << "' '"
 			 << ss.str() << dendl;
+  if (command == "perf dump_binary") {
+    // compact raw encoding for high-frequency scrapers; no Formatter
+    delete f;
+    _perf_counters_collection->dump_binary(*out);
+    lgeneric_dout(this, 1) << "do_command '" << command << "' '" << ss.str()
+			   << "result is " << out->length() << " bytes" << dendl;
+    return;
+  }
   if (command == "perfcounters_dump" || command == "1" ||
       command == "perf dump") {
     std::string logger;
@@ -288,6 +297,14 @@ void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
     cmd_getval(this, cmdmap, "counter", counter);
     _perf_counters_collection->dump_formatted(f, false, logger, counter);
   }
+  else if (command == "perf dump_delta") {
+    int64_t cursor = 0;
+    cmd_getval(this, cmdmap, "cursor", cursor);
+    _perf_counters_collection->dump_formatted_delta(f, (uint64_t)cursor);
+  }
+  else if (command == "lock_contention dump") {
+    lock_contention_dump(f);
+  }
   else if (command == "perfcounters_schema" || command == "2" ||
     command == "perf schema") {
     _perf_counters_collection->dump_formatted(f, true);
@@ -374,7 +391,23 @@ void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
         f->dump_string("option", *p);
       }
       f->close_section(); // unknown
-    } else if (command == "log flush") {
+    } else if (command == "lock_contention enable") {
+      int64_t interval = 1;
+      cmd_getval(this, cmdmap, "interval", interval);
+      if (interval < 1)
+	interval = 1;
+      lock_contention_enable((uint32_t)interval);
+      f->dump_string("success", "lock contention profiling enabled");
+    }
+    else if (command == "lock_contention disable") {
+      lock_contention_disable();
+      f->dump_string("success", "lock contention profiling disabled");
+    }
+    else if (command == "lock_contention reset") {
+      lock_contention_reset();
+      f->dump_string("success", "lock contention stats reset");
+    }
+    else if (command == "log flush") {
       _log->flush();
     }
     else if (command == "log dump") {
@@ -435,6 +468,8 @@ CephContext::CephContext(uint32_t module_type_)
   _admin_socket->register_command("perfcounters_dump", "perfcounters_dump", _admin_hook, "");
   _admin_socket->register_command("1", "1", _admin_hook, "");
   _admin_socket->register_command("perf dump", "perf dump name=logger,type=CephString,req=false name=counter,type=CephString,req=false", _admin_hook, "dump perfcounters value");
+  _admin_socket->register_command("perf dump_delta", "perf dump_delta name=cursor,type=CephInt,req=false", _admin_hook, "dump perfcounters changed since cursor (0 or omitted: full dump)");
+  _admin_socket->register_command("perf dump_binary", "perf dump_binary", _admin_hook, "dump perfcounters in a compact binary encoding");
   _admin_socket->register_command("perfcounters_schema", "perfcounters_schema", _admin_hook, "");
   _admin_socket->register_command("2", "2", _admin_hook, "");
   _admin_socket->register_command("perf schema", "perf schema", _admin_hook, "dump perfcounters schema");
@@ -445,6 +480,10 @@ CephContext::CephContext(uint32_t module_type_)
   _admin_socket->register_command("config diff",
       "config diff", _admin_hook,
       "dump diff of current config and default config");
+  _admin_socket->register_command("lock_contention enable", "lock_contention enable name=interval,type=CephInt,req=false", _admin_hook, "enable sampled lock contention profiling, timing every <interval>th acquisition");
+  _admin_socket->register_command("lock_contention disable", "lock_contention disable", _admin_hook, "disable lock contention profiling");
+  _admin_socket->register_command("lock_contention dump", "lock_contention dump", _admin_hook, "dump lock contention stats, ranked by total wait");
+  _admin_socket->register_command("lock_contention reset", "lock_contention reset", _admin_hook, "clear accumulated lock contention stats");
   _admin_socket->register_command("log flush", "log flush", _admin_hook, "flush log entries to log file");
   _admin_socket->register_command("log dump", "log dump", _admin_hook, "dump recent log entries to log file");
   _admin_socket->register_command("log reopen", "log reopen", _admin_hook, "reopen log file");
@@ -463,6 +502,8 @@ CephContext::~CephContext()
 
   _admin_socket->unregister_command("perfcounters_dump");
   _admin_socket->unregister_command("perf dump");
+  _admin_socket->unregister_command("perf dump_delta");
+  _admin_socket->unregister_command("perf dump_binary");
   _admin_socket->unregister_command("1");
   _admin_socket->unregister_command("perfcounters_schema");
   _admin_socket->unregister_command("perf schema");
@@ -472,6 +513,10 @@ CephContext::~CephContext()
   _admin_socket->unregister_command("config set");
   _admin_socket->unregister_command("config get");
   _admin_socket->unregister_command("config diff");
+  _admin_socket->unregister_command("lock_contention enable");
+  _admin_socket->unregister_command("lock_contention disable");
+  _admin_socket->unregister_command("lock_contention dump");
+  _admin_socket->unregister_command("lock_contention reset");
   _admin_socket->unregister_command("log flush");
   _admin_socket->unregister_command("log dump");
   _admin_socket->unregister_command("log reopen");
@@ -562,8 +562,15 @@ int md_config_t::parse_injectargs(std::vector<const char*>& args,
 
 void md_config_t::apply_changes(std::ostream *oss)
 {
-  Mutex::Locker l(lock);
-  _apply_changes(oss);
+  rev_obs_map_t robs;
+  {
+    Mutex::Locker l(lock);
+    _gather_change_observers(&robs, oss);
+  }
+  // make the callbacks without holding the config lock, so observers
+  // (and everyone else) can read the config in the meantime
+  for (rev_obs_map_t::const_iterator r = robs.begin(); r != robs.end(); ++r)
+    r->first->handle_conf_change(this, r->second);
 }
 
 bool md_config_t::_internal_field(const string& s)
@@ -573,17 +580,13 @@ bool md_config_t::_internal_field(const string& s)
   return false;
 }
 
-void md_config_t::_apply_changes(std::ostream *oss)
+void md_config_t::_gather_change_observers(rev_obs_map_t *robs,
+					   std::ostream *oss)
 {
-  /* Maps observers to the configuration options that they care about which
-   * have changed. */
-  typedef std::map < md_config_obs_t*, std::set <std::string> > rev_obs_map_t;
-
   expand_all_meta();
 
   // create the reverse observer mapping, mapping observers to the set of
   // changed keys that they'll get.
-  rev_obs_map_t robs;
   std::set <std::string> empty_set;
   char buf[128];
   char *bufptr = (char*)buf;
@@ -599,30 +602,24 @@ void md_config_t::_apply_changes(std::ostream *oss)
       range(observers.equal_range(key));
     for (obs_map_t::iterator r = range.first; r != range.second; ++r) {
       rev_obs_map_t::value_type robs_val(r->second, empty_set);
-      pair < rev_obs_map_t::iterator, bool > robs_ret(robs.insert(robs_val));
+      pair < rev_obs_map_t::iterator, bool > robs_ret(robs->insert(robs_val));
       std::set <std::string> &keys(robs_ret.first->second);
       keys.insert(key);
     }
   }
 
-  // Make any pending observer callbacks
-  for (rev_obs_map_t::const_iterator r = robs.begin(); r != robs.end(); ++r) {
-    md_config_obs_t *obs = r->first;
-    obs->handle_conf_change(this, r->second);
-  }
-
   changed.clear();
 }
 
 void md_config_t::call_all_observers()
 {
-  Mutex::Locker l(lock);
-
-  expand_all_meta();
-
   std::map<md_config_obs_t*,std::set<std::string> > obs;
-  for (obs_map_t::iterator r = observers.begin(); r != observers.end(); ++r)
-    obs[r->second].insert(r->first);
+  {
+    Mutex::Locker l(lock);
+    expand_all_meta();
+    for (obs_map_t::iterator r = observers.begin(); r != observers.end(); ++r)
+      obs[r->second].insert(r->first);
+  }
   for (std::map<md_config_obs_t*,std::set<std::string> >::iterator p = obs.begin();
        p != obs.end();
        ++p)
@@ -632,32 +629,37 @@ void md_config_t::call_all_observers()
 int md_config_t::injectargs(const std::string& s, std::ostream *oss)
 {
   int ret;
-  Mutex::Locker l(lock);
-  char b[s.length()+1];
-  strcpy(b, s.c_str());
-  std::vector<const char*> nargs;
-  char *p = b;
-  while (*p) {
-    nargs.push_back(p);
-    while (*p && *p != ' ') p++;
-    if (!*p)
-      break;
-    *p++ = 0;
-    while (*p && *p == ' ') p++;
-  }
-  ret = parse_injectargs(nargs, oss);
-  if (!nargs.empty()) {
-    *oss << " failed to parse arguments: ";
-    std::string prefix;
-    for (std::vector<const char*>::const_iterator i = nargs.begin();
-	 i != nargs.end(); ++i) {
-      *oss << prefix << *i;
-      prefix = ",";
+  rev_obs_map_t robs;
+  {
+    Mutex::Locker l(lock);
+    char b[s.length()+1];
+    strcpy(b, s.c_str());
+    std::vector<const char*> nargs;
+    char *p = b;
+    while (*p) {
+      nargs.push_back(p);
+      while (*p && *p != ' ') p++;
+      if (!*p)
+	break;
+      *p++ = 0;
+      while (*p && *p == ' ') p++;
+    }
+    ret = parse_injectargs(nargs, oss);
+    if (!nargs.empty()) {
+      *oss << " failed to parse arguments: ";
+      std::string prefix;
+      for (std::vector<const char*>::const_iterator i = nargs.begin();
+	   i != nargs.end(); ++i) {
+	*oss << prefix << *i;
+	prefix = ",";
+      }
+      *oss << "\n";
+      ret = -EINVAL;
     }
-    *oss << "\n";
-    ret = -EINVAL;
+    _gather_change_observers(&robs, oss);
   }
-  _apply_changes(oss);
+  for (rev_obs_map_t::const_iterator r = robs.begin(); r != robs.end(); ++r)
+    r->first->handle_conf_change(this, r->second);
   return ret;
 }
 
@@ -876,6 +878,7 @@ int md_config_t::set_val_impl(const char *val, const config_option *opt)
   if (ret)
     return ret;
   changed.insert(opt->name);
+  version.inc();
   return 0;
 }
 
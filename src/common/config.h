@@ -25,6 +25,7 @@ extern struct ceph_file_layout g_default_file_layout;
 #include "common/ConfUtils.h"
 #include "common/entity_name.h"
 #include "common/Mutex.h"
+#include "include/atomic.h"
 #include "log/SubsystemMap.h"
 #include "common/config_obs.h"
 #include "msg/msg_types.h"
@@ -64,7 +65,9 @@ extern const char *CEPH_CONF_FILE_DEFAULT;
  * In the old way, code would simply read the public variables of the
  * configuration, without taking a lock. In the new way, code registers a
  * configuration obserever which receives callbacks when a value changes. These
- * callbacks take place under the md_config_t lock.
+ * callbacks are made from the thread applying the change, after the
+ * md_config_t lock has been dropped, so observers may read the config (and
+ * take their own locks) freely.
  *
  * To prevent serious problems resulting from thread-safety issues, we disallow
  * changing std::string configuration values after
@@ -117,10 +120,15 @@ public:
 
   // Expand all metavariables. Make any pending observer callbacks.
   void apply_changes(std::ostream *oss);
-  void _apply_changes(std::ostream *oss);
   bool _internal_field(const string& k);
   void call_all_observers();
 
+  /// version number bumped on every successful value change.  It is
+  /// lock free to read, so hot paths can cache values they derive from
+  /// the config and revalidate with a single read per op instead of
+  /// re-parsing (or taking the lock).
+  uint64_t get_version() const { return version.read(); }
+
   // Called by the Ceph daemons to make configuration changes at runtime
   int injectargs(const std::string &s, std::ostream *oss);
 
@@ -163,6 +171,14 @@ public:
 private:
   void _show_config(std::ostream *out, Formatter *f);
 
+  /* Maps observers to the set of changed keys each will be told about. */
+  typedef std::map<md_config_obs_t*, std::set<std::string> > rev_obs_map_t;
+
+  // Expand metavariables and collect the observers owed a callback for
+  // the changed keys; must be called with the lock held.  The callbacks
+  // themselves are made by the caller after dropping the lock.
+  void _gather_change_observers(rev_obs_map_t *robs, std::ostream *oss);
+
   void _get_my_sections(std::vector <std::string> &sections) const;
 
   int _get_val_from_conf_file(const std::vector <std::string> &sections,
@@ -199,6 +215,10 @@ private:
   obs_map_t observers;
   changed_set_t changed;
 
+  // bumped (under the lock) on every successful value change; see
+  // get_version()
+  ceph::atomic64_t version;
+
 public:
   ceph::log::SubsystemMap subsys;
 
@@ -243,8 +263,8 @@ public:
 
   /** A lock that protects the md_config_t internals. It is
    * recursive, for simplicity.
-   * It is best if this lock comes first in the lock hierarchy. We will
-   * hold this lock when calling configuration observers.  */
+   * It is best if this lock comes first in the lock hierarchy. It is
+   * not held while calling configuration observers.  */
   mutable Mutex lock;
 
   friend class test_md_config_t;
@@ -56,6 +56,7 @@ OPTION(log_stop_at_utilization, OPT_FLOAT, .97)  // stop logging at (near) full
 // also, "default=daemon audit=local0" would mean
 //    "default all to 'daemon', override 'audit' with 'local0'
 OPTION(clog_to_monitors, OPT_STR, "default=true")
+OPTION(clog_compress_repeats, OPT_BOOL, true)  // collapse runs of identical messages
 OPTION(clog_to_syslog, OPT_STR, "false")
 OPTION(clog_to_syslog_level, OPT_STR, "info") // this level and above
 OPTION(clog_to_syslog_facility, OPT_STR, "default=daemon audit=local0")
@@ -147,11 +148,16 @@ OPTION(perf, OPT_BOOL, true)       // enable internal perf counters
 OPTION(ms_type, OPT_STR, "simple")   // messenger backend
 OPTION(ms_tcp_nodelay, OPT_BOOL, true)
 OPTION(ms_tcp_rcvbuf, OPT_INT, 0)
+OPTION(ms_tcp_sndbuf, OPT_INT, 0)
 OPTION(ms_tcp_prefetch_max_size, OPT_INT, 4096) // max prefetch size, we limit this to avoid extra memcpy
+OPTION(ms_recv_buffer_pool_size, OPT_INT, 8) // recycled recv buffers kept per connection, 0 = allocate per message
+OPTION(ms_recv_buffer_pool_max_size, OPT_U64, 256 << 10) // don't recycle recv buffers larger than this (in bytes)
 OPTION(ms_initial_backoff, OPT_DOUBLE, .2)
 OPTION(ms_max_backoff, OPT_DOUBLE, 15.0)
 OPTION(ms_crc_data, OPT_BOOL, true)
 OPTION(ms_crc_header, OPT_BOOL, true)
+OPTION(ms_compress_data, OPT_BOOL, false)  // snappy-compress data payloads to peers that support it
+OPTION(ms_compress_data_min_size, OPT_U64, 4096)  // don't bother compressing smaller payloads
 OPTION(ms_die_on_bad_msg, OPT_BOOL, false)
 OPTION(ms_die_on_unhandled_msg, OPT_BOOL, false)
 OPTION(ms_die_on_old_message, OPT_BOOL, false)     // assert if we get a dup incoming message and shouldn't have (may be triggered by pre-541cd3c64be0dfa04e8a2df39422e0eb9541a428 code)
@@ -182,6 +188,10 @@ OPTION(ms_async_set_affinity, OPT_BOOL, true)
 // If ms_async_affinity_cores is empty, all threads will be bind to current running
 // core
 OPTION(ms_async_affinity_cores, OPT_STR, "")
+// While the send queue is hot, coalesce message encodes into the pending
+// output buffer (up to this many bytes) and flush them with one sendmsg
+// instead of one small segment per message.  0 disables coalescing.
+OPTION(ms_async_send_coalesce_max_bytes, OPT_U32, 64 << 10)
 
 OPTION(inject_early_sigterm, OPT_BOOL, false)
 
@@ -211,10 +221,12 @@ OPTION(mon_osd_max_op_age, OPT_DOUBLE, 32)     // max op age before we get conce
 OPTION(mon_osd_max_split_count, OPT_INT, 32) // largest number of PGs per "involved" OSD to let split create
 OPTION(mon_osd_allow_primary_temp, OPT_BOOL, false)  // allow primary_temp to be set in the osdmap
 OPTION(mon_osd_allow_primary_affinity, OPT_BOOL, false)  // allow primary_affinity to be set in the osdmap
+OPTION(mon_osd_allow_pg_upmap, OPT_BOOL, false)  // allow pg_upmap exceptions to be set in the osdmap
 OPTION(mon_osd_prime_pg_temp, OPT_BOOL, false)  // prime osdmap with pg mapping changes
 OPTION(mon_osd_prime_pg_temp_max_time, OPT_FLOAT, .5)  // max time to spend priming
 OPTION(mon_osd_pool_ec_fast_read, OPT_BOOL, false) // whether turn on fast read on the pool or not
 OPTION(mon_stat_smooth_intervals, OPT_INT, 2)  // smooth stats over last N PGMap maps
+OPTION(mon_election_timeout, OPT_FLOAT, 5)  // on election proposer, max waiting time for all ACKs
 OPTION(mon_lease, OPT_FLOAT, 5)       // lease interval
 OPTION(mon_lease_renew_interval, OPT_FLOAT, 3) // on leader, to renew the lease
 OPTION(mon_lease_ack_timeout, OPT_FLOAT, 10.0) // on leader, if lease isn't acked by all peons
@@ -339,6 +351,8 @@ OPTION(client_readahead_max_periods, OPT_LONGLONG, 4)  // as multiple of file la
 OPTION(client_snapdir, OPT_STR, ".snap")
 OPTION(client_mountpoint, OPT_STR, "/")
 OPTION(client_notify_timeout, OPT_INT, 10) // in seconds
+OPTION(client_statfs_ttl, OPT_DOUBLE, 0) // seconds to serve statfs from cache; 0 = always ask the mon
+OPTION(client_readdir_max_bytes, OPT_INT, 512*1024) // readdir reply size we ask the mds for
 OPTION(osd_client_watch_timeout, OPT_INT, 30) // in seconds
 OPTION(client_caps_release_delay, OPT_INT, 5) // in seconds
 OPTION(client_quota, OPT_BOOL, false)
@@ -365,12 +379,15 @@ OPTION(client_try_dentry_invalidate, OPT_BOOL, true) // the client should try to
 OPTION(client_die_on_failed_remount, OPT_BOOL, true)
 OPTION(client_check_pool_perm, OPT_BOOL, true)
 
-OPTION(crush_location, OPT_STR, "")       // whitespace-separated list of key=value pairs describing crush location
+OPTION(crush_location, OPT_STR, "")       // whitespace-separated list of key=value pairs describing crush location; clients default to host=<hostname>
 
 OPTION(objecter_tick_interval, OPT_DOUBLE, 5.0)
 OPTION(objecter_timeout, OPT_DOUBLE, 10.0)    // before we ask for a map
 OPTION(objecter_inflight_op_bytes, OPT_U64, 1024*1024*100) // max in-flight data (both directions)
 OPTION(objecter_inflight_ops, OPT_U64, 1024)               // max in-flight ios
+OPTION(objecter_rwlock_shards, OPT_INT, 8)                 // reader shards for the main objecter lock; writes (map epoch changes) take all of them
+OPTION(objecter_op_batch_max, OPT_INT, 0)                  // opt-in: hold up to this many ops per osd session and send them as one burst; 0 sends each op immediately
+OPTION(objecter_op_batch_window, OPT_DOUBLE, .001)         // seconds to hold an incomplete batch before flushing it
 OPTION(objecter_completion_locks_per_session, OPT_U64, 32) // num of completion locks per each session, for serializing same object responses
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL, false)   // suppress watch pings
 
@@ -380,6 +397,7 @@ OPTION(filer_max_purge_ops, OPT_U32, 10)
 OPTION(journaler_allow_split_entries, OPT_BOOL, true)
 OPTION(journaler_write_head_interval, OPT_INT, 15)
 OPTION(journaler_prefetch_periods, OPT_INT, 10)   // * journal object size
+OPTION(journaler_prefetch_max_periods, OPT_INT, 64)  // * journal object size; cap for the adaptive prefetch window, <= prefetch_periods pins it
 OPTION(journaler_prezero_periods, OPT_INT, 5)     // * journal object size
 OPTION(journaler_batch_interval, OPT_DOUBLE, .001)   // seconds.. max add latency we artificially incur
 OPTION(journaler_batch_max, OPT_U64, 0)  // max bytes we'll delay flushing; disable, for now....
@@ -397,6 +415,7 @@ OPTION(mds_blacklist_interval, OPT_FLOAT, 24.0*60.0)  // how long to blacklist f
 OPTION(mds_session_timeout, OPT_FLOAT, 60)    // cap bits and leases time out if client idle
 OPTION(mds_sessionmap_keys_per_op, OPT_U32, 1024)    // how many sessions should I try to load/store in a single OMAP operation?
 OPTION(mds_revoke_cap_timeout, OPT_FLOAT, 60)    // detect clients which aren't revoking caps
+OPTION(mds_max_cap_releases_per_dispatch, OPT_U32, 10000)  // bound cap release work per dispatch so a mass release doesn't monopolize mds_lock
 OPTION(mds_recall_state_timeout, OPT_FLOAT, 60)    // detect clients which aren't trimming caps
 OPTION(mds_freeze_tree_timeout, OPT_FLOAT, 30)    // detecting freeze tree deadlock
 OPTION(mds_session_autoclose, OPT_FLOAT, 300) // autoclose idle session
@@ -417,6 +436,7 @@ OPTION(mds_log_segment_size, OPT_INT, 0)  // segment size for mds log,
 	      // defaults to g_default_file_layout.fl_object_size (4MB)
 OPTION(mds_log_max_segments, OPT_U32, 30)
 OPTION(mds_log_max_expiring, OPT_INT, 20)
+OPTION(mds_log_max_backtraces_per_expire, OPT_U32, 4096)  // bound backtrace ops issued per segment expire pass; 0 = unlimited
 OPTION(mds_bal_sample_interval, OPT_FLOAT, 3.0)  // every 5 seconds
 OPTION(mds_bal_replicate_threshold, OPT_FLOAT, 8000)
 OPTION(mds_bal_unreplicate_threshold, OPT_FLOAT, 0)
@@ -434,6 +454,7 @@ OPTION(mds_bal_idle_threshold, OPT_FLOAT, 0)
 OPTION(mds_bal_max, OPT_INT, -1)
 OPTION(mds_bal_max_until, OPT_INT, -1)
 OPTION(mds_bal_mode, OPT_INT, 0)
+OPTION(mds_bal_cpu_weight, OPT_DOUBLE, 0)  // popularity points charged per second of measured dispatch cpu; 0 = count-based load only
 OPTION(mds_bal_min_rebalance, OPT_FLOAT, .1)  // must be this much above average before we export anything
 OPTION(mds_bal_min_start, OPT_FLOAT, .2)      // if we need less than this, we don't do anything
 OPTION(mds_bal_need_min, OPT_FLOAT, .8)       // take within this range of what we need
@@ -521,6 +542,12 @@ OPTION(osd_agent_min_evict_effort, OPT_FLOAT, .1)
 OPTION(osd_agent_quantize_effort, OPT_FLOAT, .1)
 OPTION(osd_agent_delay_time, OPT_FLOAT, 5.0)
 
+// per-second budget for promotions happening in the background behind
+// a proxied read/write; 0 means unlimited.  promotions required for
+// correctness (e.g. writes that cannot be proxied) are never throttled
+OPTION(osd_tier_promote_max_objects_sec, OPT_U64, 25)
+OPTION(osd_tier_promote_max_bytes_sec, OPT_U64, 5 << 20)
+
 // osd ignore history.last_epoch_started in find_best_info
 OPTION(osd_find_best_info_ignore_history_les, OPT_BOOL, false)
 
@@ -539,6 +566,7 @@ OPTION(osd_max_write_size, OPT_INT, 90)
 OPTION(osd_max_pgls, OPT_U64, 1024) // max number of pgls entries to return
 OPTION(osd_client_message_size_cap, OPT_U64, 500*1024L*1024L) // client data allowed in-memory (in bytes)
 OPTION(osd_client_message_cap, OPT_U64, 100)              // num client messages allowed in-memory
+OPTION(osd_recovery_message_size_cap, OPT_U64, 0)         // low-priority (recovery/backfill) cluster data allowed in-memory (in bytes), 0 = share osd cluster throttle
 OPTION(osd_pg_bits, OPT_INT, 6)  // bits per osd
 OPTION(osd_pgp_bits, OPT_INT, 6)  // bits per osd
 OPTION(osd_crush_chooseleaf_type, OPT_INT, 1) // 1 = host
@@ -593,6 +621,7 @@ OPTION(osd_tier_default_cache_min_write_recency_for_promote, OPT_INT, 1) // numb
 OPTION(osd_map_dedup, OPT_BOOL, true)
 OPTION(osd_map_max_advance, OPT_INT, 200) // make this < cache_size!
 OPTION(osd_map_cache_size, OPT_INT, 500)
+OPTION(osd_map_cache_shards, OPT_INT, 8) // split the map cache lock this many ways
 OPTION(osd_map_message_max, OPT_INT, 100)  // max maps per MOSDMap message
 OPTION(osd_map_share_max_epochs, OPT_INT, 100)  // cap on # of inc maps we send to peers, clients
 OPTION(osd_inject_bad_map_crc_probability, OPT_FLOAT, 0)
@@ -601,6 +630,10 @@ OPTION(osd_op_threads, OPT_INT, 2)    // 0 == no threading
 OPTION(osd_peering_wq_batch_size, OPT_U64, 20)
 OPTION(osd_op_pq_max_tokens_per_priority, OPT_U64, 4194304)
 OPTION(osd_op_pq_min_cost, OPT_U64, 65536)
+// seconds an op (client or recovery) may wait in a shard queue before
+// it is serviced ahead of token accounting; 0 disables the deadline
+// pass and gives pure token-bucket behavior
+OPTION(osd_op_queue_deadline, OPT_FLOAT, 0)
 OPTION(osd_disk_threads, OPT_INT, 1)
 OPTION(osd_disk_thread_ioprio_class, OPT_STR, "") // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT, -1) // 0-7
@@ -608,6 +641,20 @@ OPTION(osd_recovery_threads, OPT_INT, 1)
 OPTION(osd_recover_clone_overlap, OPT_BOOL, true)   // preserve clone_overlap during recovery/migration
 OPTION(osd_op_num_threads_per_shard, OPT_INT, 2)
 OPTION(osd_op_num_shards, OPT_INT, 5)
+// comma-separated list of cpu ids; op shard worker thread i is pinned to
+// the (i % len)'th entry.  list cpus of one NUMA node per shard group
+// (osd_op_num_threads_per_shard consecutive threads serve one shard) to
+// keep a shard's queue, locks, and op data on one socket.  empty = no
+// pinning.
+OPTION(osd_op_shard_cpu_affinity, OPT_STR, "")
+// ops dequeued from an op shard per ordering-lock acquisition; they are
+// still processed one at a time, so this only amortizes queue locking
+OPTION(osd_op_dequeue_batch_size, OPT_U32, 4)
+// threads used to open and read in PGs at startup
+OPTION(osd_load_pgs_threads, OPT_INT, 4)
+// prefetch object metadata for ops queued behind a busy PG
+OPTION(osd_obc_prefetch, OPT_BOOL, true)
+OPTION(osd_obc_prefetch_max, OPT_U32, 16)   // max prefetches in flight
 
 // Only use clone_overlap for recovery if there are fewer than
 // osd_recover_clone_overlap_limit entries in the overlap set
@@ -621,6 +668,9 @@ OPTION(osd_recovery_thread_timeout, OPT_INT, 30)
 OPTION(osd_recovery_thread_suicide_timeout, OPT_INT, 300)
 OPTION(osd_recovery_sleep, OPT_FLOAT, 0)         // seconds to sleep between recovery ops
 OPTION(osd_snap_trim_sleep, OPT_FLOAT, 0)
+OPTION(osd_snap_trim_max_objects_per_tick, OPT_U64, 0) // per-pg trim budget, 0 = unlimited
+OPTION(osd_snap_trim_max_bytes_per_tick, OPT_U64, 0)   // per-pg trim budget, 0 = unlimited
+OPTION(osd_snap_trim_tick_interval, OPT_FLOAT, 1)      // trim budget refill interval (seconds)
 OPTION(osd_scrub_invalid_stats, OPT_BOOL, true)
 OPTION(osd_remove_thread_timeout, OPT_INT, 60*60)
 OPTION(osd_remove_thread_suicide_timeout, OPT_INT, 10*60*60)
@@ -631,6 +681,9 @@ OPTION(osd_heartbeat_interval, OPT_INT, 6)       // (seconds) how often we ping
 OPTION(osd_heartbeat_grace, OPT_INT, 20)         // (seconds) how long before we decide a peer has failed
 OPTION(osd_heartbeat_min_peers, OPT_INT, 10)     // minimum number of peers
 OPTION(osd_heartbeat_use_min_delay_socket, OPT_BOOL, false) // prio the heartbeat tcp socket and set dscp as CS6 on it if true
+OPTION(osd_cluster_crc_data, OPT_BOOL, true) // compute data crc on cluster-network messages; disable only if that network has transport-level protection (e.g. RoCE).  peers see the nocrc footer flag and skip verification, so mixed settings interoperate
+OPTION(osd_net_probe_inflight_bytes, OPT_U64, 64 << 20) // cap on unacked 'net_ping_test' probe payload in flight
+OPTION(osd_net_probe_timeout, OPT_INT, 30)   // (seconds) give up waiting for outstanding probe replies
 
 // max number of parallel snap trims/pg
 OPTION(osd_pg_max_concurrent_snap_trims, OPT_U64, 2)
@@ -665,6 +718,7 @@ OPTION(osd_scrub_max_interval, OPT_FLOAT, 7*60*60*24)  // regardless of load
 OPTION(osd_scrub_interval_randomize_ratio, OPT_FLOAT, 0.5) // randomize the scheduled scrub in the span of [min,min*(1+randomize_radio))
 OPTION(osd_scrub_chunk_min, OPT_INT, 5)
 OPTION(osd_scrub_chunk_max, OPT_INT, 25)
+OPTION(osd_scrub_yield_batch, OPT_U32, 16) // objects hashed per pg lock hold during scrub, 0 = never yield
 OPTION(osd_scrub_sleep, OPT_FLOAT, 0)   // sleep between [deep]scrub ops
 OPTION(osd_deep_scrub_interval, OPT_FLOAT, 60*60*24*7) // once a week
 OPTION(osd_deep_scrub_stride, OPT_INT, 524288)
@@ -703,6 +757,7 @@ OPTION(osd_debug_reject_backfill_probability, OPT_DOUBLE, 0)
 OPTION(osd_debug_inject_copyfrom_error, OPT_BOOL, false)  // inject failure during copyfrom completion
 OPTION(osd_debug_randomize_hobject_sort_order, OPT_BOOL, false)
 OPTION(osd_enable_op_tracker, OPT_BOOL, true) // enable/disable OSD op tracking
+OPTION(osd_op_tracker_sample_interval, OPT_U32, 1) // fully track every Nth op, count the rest
 OPTION(osd_num_op_tracker_shard, OPT_U32, 32) // The number of shards for holding the ops
 OPTION(osd_op_history_size, OPT_U32, 20)    // Max number of completed ops to track
 OPTION(osd_op_history_duration, OPT_U32, 600) // Oldest completed op to track
@@ -711,6 +766,7 @@ OPTION(osd_failsafe_full_ratio, OPT_FLOAT, .97) // what % full makes an OSD "ful
 OPTION(osd_failsafe_nearfull_ratio, OPT_FLOAT, .90) // what % full makes an OSD near full (failsafe)
 
 OPTION(osd_pg_object_context_cache_count, OPT_INT, 64)
+OPTION(osd_pg_object_context_cache_max_count, OPT_INT, 256) // let a pg with a poor hit rate grow its obc cache up to this; 0 to pin at the count above
 
 // determines whether PGLog::check() compares written out log to stored log
 OPTION(osd_debug_pg_log_writeout, OPT_BOOL, false)
@@ -743,6 +799,10 @@ OPTION(keyvaluestore_rocksdb_options, OPT_STR, "")
 OPTION(filestore_rocksdb_options, OPT_STR, "")
 // rocksdb options that will be used in monstore
 OPTION(mon_rocksdb_options, OPT_STR, "")
+// commit splittable transactions (background deletions) in sub-batches
+// of at most this many staged bytes, so they never stall other users of
+// a shared kv store for long; 0 disables splitting
+OPTION(rocksdb_transaction_split_size, OPT_U64, 16*1024*1024)
 
 /**
  * osd_*_priority adjust the relative priority of client io, recovery io,
@@ -772,6 +832,8 @@ OPTION(osd_recovery_op_warn_multiple, OPT_U32, 16)
 OPTION(osd_mon_shutdown_timeout, OPT_DOUBLE, 5)
 
 OPTION(osd_max_object_size, OPT_U64, 100*1024L*1024L*1024L) // OSD's maximum object size
+OPTION(osd_compression_algorithm, OPT_STR, "snappy") // algorithm for pools with the compress flag
+OPTION(osd_compression_min_size, OPT_U64, 4096) // don't compress full-object writes smaller than this
 OPTION(osd_max_object_name_len, OPT_U32, 2048) // max rados object name len
 OPTION(osd_max_attr_name_len, OPT_U32, 100)    // max rados attr name len; cannot go higher than 100 chars for file system backends
 OPTION(osd_max_attr_size, OPT_U64, 0)
@@ -789,9 +851,12 @@ OPTION(osd_bench_duration, OPT_U32, 30) // duration of 'osd bench', capped at 30
 OPTION(memstore_device_bytes, OPT_U64, 1024*1024*1024)
 OPTION(memstore_page_set, OPT_BOOL, true)
 OPTION(memstore_page_size, OPT_U64, 64 << 10)
+OPTION(memstore_huge_pages, OPT_BOOL, false)  // hugepage-align pages; needs memstore_page_size to be a 2MB multiple
 
 OPTION(newstore_max_dir_size, OPT_U32, 1000000)
 OPTION(newstore_onode_map_size, OPT_U32, 1024)   // onodes per collection
+OPTION(newstore_onode_cache_bytes, OPT_U64, 0)   // target bytes for cached onodes across all collections (0 = count limit only)
+OPTION(newstore_onode_cache_trim_interval, OPT_DOUBLE, 1)
 OPTION(newstore_backend, OPT_STR, "rocksdb")
 OPTION(newstore_backend_options, OPT_STR, "")
 OPTION(newstore_fail_eio, OPT_BOOL, true)
@@ -840,6 +905,8 @@ OPTION(filestore_wbthrottle_xfs_inodes_start_flusher, OPT_U64, 500)
 /// These must be less than the fd limit
 OPTION(filestore_wbthrottle_btrfs_inodes_hard_limit, OPT_U64, 5000)
 OPTION(filestore_wbthrottle_xfs_inodes_hard_limit, OPT_U64, 5000)
+OPTION(filestore_wbthrottle_flusher_threads, OPT_INT, 1)
+OPTION(filestore_wbthrottle_target_commit_latency, OPT_DOUBLE, 0) // >0: adapt dirty allowance to hold commits near this many seconds
 
 // Tests index failure paths
 OPTION(filestore_index_retry_probability, OPT_DOUBLE, 0)
@@ -848,7 +915,11 @@ OPTION(filestore_index_retry_probability, OPT_DOUBLE, 0)
 OPTION(filestore_debug_inject_read_err, OPT_BOOL, false)
 
 OPTION(filestore_debug_omap_check, OPT_BOOL, 0) // Expensive debugging check on sync
+OPTION(filestore_index_verify_object_names, OPT_BOOL, false) // regenerate and cross-check names while listing (expensive)
 OPTION(filestore_omap_header_cache_size, OPT_INT, 1024)
+OPTION(filestore_omap_header_cache_shards, OPT_INT, 32)
+OPTION(filestore_omap_parent_header_cache_size, OPT_U32, 1024) // cloned (parent) headers cached by seq
+OPTION(filestore_omap_flatten_chain_depth, OPT_INT, 16) // background-flatten omap clone chains deeper than this (0 = off)
 
 // Use omap for xattrs for attrs over
 // filestore_max_inline_xattr_size or
@@ -870,6 +941,8 @@ OPTION(filestore_max_alloc_hint_size, OPT_U64, 1ULL << 20) // bytes
 
 OPTION(filestore_max_sync_interval, OPT_DOUBLE, 5)    // seconds
 OPTION(filestore_min_sync_interval, OPT_DOUBLE, .01)  // seconds
+OPTION(filestore_incremental_sync, OPT_BOOL, false)   // fsync only dirtied files at commit when the namespace is unchanged
+OPTION(filestore_incremental_sync_max_objects, OPT_INT, 1024) // above this many dirty objects, syncfs instead
 OPTION(filestore_btrfs_snap, OPT_BOOL, true)
 OPTION(filestore_btrfs_clone_range, OPT_BOOL, true)
 OPTION(filestore_zfs_snap, OPT_BOOL, false) // zfsonlinux is still unstable
@@ -892,6 +965,9 @@ OPTION(filestore_queue_max_bytes, OPT_INT, 100 << 20)
 OPTION(filestore_queue_committing_max_ops, OPT_INT, 500)        // this is ON TOP of filestore_queue_max_*
 OPTION(filestore_queue_committing_max_bytes, OPT_INT, 100 << 20) //  "
 OPTION(filestore_op_threads, OPT_INT, 2)
+OPTION(filestore_async_read_threads, OPT_INT, 2)  // threads servicing queue_read/queue_getattr/queue_omap_get, 0 = inline
+OPTION(filestore_xattr_loc_cache_size, OPT_U32, 1024)  // objects whose inline-vs-omap xattr layout we cache, 0 = disable
+OPTION(filestore_collection_list_cursor_size, OPT_U32, 1024)  // listing tail entries kept for the next chunked collection_list, 0 = disable
 OPTION(filestore_op_thread_timeout, OPT_INT, 60)
 OPTION(filestore_op_thread_suicide_timeout, OPT_INT, 180)
 OPTION(filestore_commit_timeout, OPT_FLOAT, 600)
@@ -901,7 +977,8 @@ OPTION(filestore_split_multiple, OPT_INT, 2)
 OPTION(filestore_update_to, OPT_INT, 1000)
 OPTION(filestore_blackhole, OPT_BOOL, false)     // drop any new transactions on the floor
 OPTION(filestore_fd_cache_size, OPT_INT, 128)    // FD lru size
-OPTION(filestore_fd_cache_shards, OPT_INT, 16)   // FD number of shards
+OPTION(filestore_fd_cache_shards, OPT_INT, 32)   // FD number of shards
+OPTION(filestore_fd_cache_prewarm, OPT_BOOL, false) // persist hot fd set at umount, reopen at mount
 OPTION(filestore_dump_file, OPT_STR, "")         // file onto which store transaction dumps
 OPTION(filestore_kill_at, OPT_INT, 0)            // inject a failure at the n'th opportunity
 OPTION(filestore_inject_stall, OPT_INT, 0)       // artificially stall for N seconds in op queue thread
@@ -920,6 +997,10 @@ OPTION(keyvaluestore_op_thread_suicide_timeout, OPT_INT, 180)
 OPTION(keyvaluestore_default_strip_size, OPT_INT, 4096) // Only affect new object
 OPTION(keyvaluestore_max_expected_write_size, OPT_U64, 1ULL << 24) // bytes
 OPTION(keyvaluestore_header_cache_size, OPT_INT, 4096)    // Header cache size
+OPTION(keyvaluestore_header_cache_shards, OPT_INT, 16)    // Header cache shard count
+OPTION(keyvaluestore_compact_max_inflight_ops, OPT_INT, 10) // admit background compaction only at or below this queue depth
+OPTION(keyvaluestore_compact_begin_hour, OPT_INT, 0)  // window in which compaction is always admitted
+OPTION(keyvaluestore_compact_end_hour, OPT_INT, 0)    // begin == end disables the window
 OPTION(keyvaluestore_backend, OPT_STR, "leveldb")
 OPTION(keyvaluestore_dump_file, OPT_STR, "")         // file onto which store transaction dumps
 
@@ -929,16 +1010,26 @@ OPTION(journal_block_align, OPT_BOOL, true)
 OPTION(journal_write_header_frequency, OPT_U64, 0)
 OPTION(journal_max_write_bytes, OPT_INT, 10 << 20)
 OPTION(journal_max_write_entries, OPT_INT, 100)
+OPTION(journal_batch_interval, OPT_DOUBLE, 0)  // group commit window (seconds), 0 = submit immediately
+OPTION(journal_batch_min_bytes, OPT_U64, 65536)  // stop waiting for the window once this much is queued
 OPTION(journal_queue_max_ops, OPT_INT, 300)
 OPTION(journal_queue_max_bytes, OPT_INT, 32 << 20)
+// > 0 makes the journal byte budget adapt between
+// journal_queue_max_bytes/16 and journal_queue_max_bytes so the given
+// percentile of journal completion latency holds at this many seconds
+OPTION(journal_latency_target, OPT_DOUBLE, 0)
+OPTION(journal_latency_target_percentile, OPT_DOUBLE, 0.99)
 OPTION(journal_align_min_size, OPT_INT, 64 << 10)  // align data payloads >= this.
 OPTION(journal_replay_from, OPT_INT, 0)
+OPTION(journal_replay_threads, OPT_INT, 4)  // threads applying non-overlapping entries during replay
+OPTION(journal_replay_batch_entries, OPT_U32, 64)  // max entries gathered into one parallel replay batch
 OPTION(journal_zero_on_create, OPT_BOOL, false)
 OPTION(journal_ignore_corruption, OPT_BOOL, false) // assume journal is not corrupt
 OPTION(journal_discard, OPT_BOOL, false) //using ssd disk as journal, whether support discard nouse journal-data.
 
 OPTION(rados_mon_op_timeout, OPT_DOUBLE, 0) // how many seconds to wait for a response from the monitor before returning an error from a rados operation. 0 means on limit.
 OPTION(rados_osd_op_timeout, OPT_DOUBLE, 0) // how many seconds to wait for a response from osds before returning an error from a rados operation. 0 means no limit.
+OPTION(rados_finisher_shards, OPT_INT, 1) // number of aio callback threads; with more than one, callbacks for different aio completions may run concurrently (callbacks for one completion stay ordered on one thread)
 
 OPTION(rbd_op_threads, OPT_INT, 1)
 OPTION(rbd_op_thread_timeout, OPT_INT, 60)
@@ -950,8 +1041,13 @@ OPTION(rbd_cache_max_dirty, OPT_LONGLONG, 24<<20)    // dirty limit in bytes - s
 OPTION(rbd_cache_target_dirty, OPT_LONGLONG, 16<<20) // target dirty limit in bytes
 OPTION(rbd_cache_max_dirty_age, OPT_FLOAT, 1.0)      // seconds in cache before writeback starts
 OPTION(rbd_cache_max_dirty_object, OPT_INT, 0)       // dirty limit for objects - set to 0 for auto calculate from rbd_cache_size
+OPTION(rbd_cache_max_flush_bytes, OPT_LONGLONG, 0)   // writeback bytes the flusher keeps in flight - 0 means flush all excess dirty at once
+OPTION(rbd_lock_read_shards, OPT_INT, 4) // reader shards for the per-image rwlocks taken on every I/O (owner/md/snap/parent); 1 disables sharding
 OPTION(rbd_cache_block_writes_upfront, OPT_BOOL, false) // whether to block writes to the cache before the aio_write call completes (true), or block before the aio completion is called (false)
 OPTION(rbd_concurrent_management_ops, OPT_INT, 10) // how many operations can be in flight for a management operation like deleting or resizing an image
+OPTION(rbd_concurrent_diff_ops, OPT_INT, 0) // how many list_snaps calls diff_iterate keeps in flight - 0 = use rbd_concurrent_management_ops
+OPTION(rbd_management_op_latency_target_ms, OPT_INT, 0) // back off management op concurrency when per-op latency exceeds this - 0 = fixed concurrency
+OPTION(rbd_object_map_incremental_rebuild, OPT_BOOL, true) // only re-verify the objects recorded in the invalidation hint when rebuilding the object map - set to false to always scan the whole image
 OPTION(rbd_balance_snap_reads, OPT_BOOL, false)
 OPTION(rbd_localize_snap_reads, OPT_BOOL, false)
 OPTION(rbd_balance_parent_reads, OPT_BOOL, false)
@@ -959,7 +1055,9 @@ OPTION(rbd_localize_parent_reads, OPT_BOOL, true)
 OPTION(rbd_readahead_trigger_requests, OPT_INT, 10) // number of sequential requests necessary to trigger readahead
 OPTION(rbd_readahead_max_bytes, OPT_LONGLONG, 512 * 1024) // set to 0 to disable readahead
 OPTION(rbd_readahead_disable_after_bytes, OPT_LONGLONG, 50 * 1024 * 1024) // how many bytes are read in total before readahead is disabled
+OPTION(rbd_readahead_max_streams, OPT_INT, 4) // number of sequential or strided read streams tracked per image; 1 gives the old single-stream behavior
 OPTION(rbd_clone_copy_on_read, OPT_BOOL, false)
+OPTION(rbd_copyup_prefetch_objects, OPT_INT, 0) // copy up this many not-yet-copied objects past each copy-on-write (requires object map, 0 = disabled)
 OPTION(rbd_blacklist_on_break_lock, OPT_BOOL, true) // whether to blacklist clients whose lock was broken
 OPTION(rbd_blacklist_expire_seconds, OPT_INT, 0) // number of seconds to blacklist - set to 0 for OSD default
 OPTION(rbd_request_timed_out_seconds, OPT_INT, 30) // number of seconds before maint request times out
@@ -1024,6 +1122,7 @@ OPTION(rgw_data, OPT_STR, "/var/lib/ceph/radosgw/$cluster-$id")
 OPTION(rgw_enable_apis, OPT_STR, "s3, swift, swift_auth, admin")
 OPTION(rgw_cache_enabled, OPT_BOOL, true)   // rgw cache enabled
 OPTION(rgw_cache_lru_size, OPT_INT, 10000)   // num of entries in rgw cache
+OPTION(rgw_data_cache_size, OPT_U64, 0)   // bytes of object data to cache in the gateway, 0 disables
 OPTION(rgw_socket_path, OPT_STR, "")   // path to unix domain socket, if not specified, rgw will not run as external fcgi
 OPTION(rgw_host, OPT_STR, "")  // host for radosgw, can be an IP, default is 0.0.0.0
 OPTION(rgw_port, OPT_STR, "")  // port to listen, format as "8080" "5000", if not specified, rgw will not run external fcgi
@@ -1083,12 +1182,15 @@ OPTION(rgw_gc_max_objs, OPT_INT, 32)
 OPTION(rgw_gc_obj_min_wait, OPT_INT, 2 * 3600)    // wait time before object may be handled by gc
 OPTION(rgw_gc_processor_max_time, OPT_INT, 3600)  // total run time for a single gc processor work
 OPTION(rgw_gc_processor_period, OPT_INT, 3600)  // gc processor cycle time
+OPTION(rgw_gc_processor_threads, OPT_INT, 1)  // concurrent gc worker threads
+OPTION(rgw_gc_max_concurrent_io, OPT_INT, 10)  // object removals in flight per gc shard
 OPTION(rgw_s3_success_create_obj_status, OPT_INT, 0) // alternative success status response for create-obj (0 - default)
 OPTION(rgw_resolve_cname, OPT_BOOL, false)  // should rgw try to resolve hostname as a dns cname record
 OPTION(rgw_obj_stripe_size, OPT_INT, 4 << 20)
 OPTION(rgw_extended_http_attrs, OPT_STR, "") // list of extended attrs that can be set on objects (beyond the default)
 OPTION(rgw_exit_timeout_secs, OPT_INT, 120) // how many seconds to wait for process to go down before exiting unconditionally
-OPTION(rgw_get_obj_window_size, OPT_INT, 16 << 20) // window size in bytes for single get obj request
+OPTION(rgw_get_obj_window_size, OPT_INT, 16 << 20) // initial window size in bytes for single get obj request
+OPTION(rgw_get_obj_max_window_size, OPT_INT, 64 << 20) // ceiling the get obj window may grow to
 OPTION(rgw_get_obj_max_req_size, OPT_INT, 4 << 20) // max length of a single get obj rados op
 OPTION(rgw_relaxed_s3_bucket_names, OPT_BOOL, false) // enable relaxed bucket name rules for US region buckets
 OPTION(rgw_defer_to_bucket_acls, OPT_STR, "") // if the user has bucket perms, use those before key perms (recurse and full_control)
@@ -1097,6 +1199,7 @@ OPTION(rgw_md_log_max_shards, OPT_INT, 64) // max shards for metadata log
 OPTION(rgw_num_zone_opstate_shards, OPT_INT, 128) // max shards for keeping inter-region copy progress info
 OPTION(rgw_opstate_ratelimit_sec, OPT_INT, 30) // min time between opstate updates on a single upload (0 for disabling ratelimit)
 OPTION(rgw_curl_wait_timeout_ms, OPT_INT, 1000) // timeout for certain curl calls
+OPTION(rgw_curl_pool_size, OPT_INT, 32) // max number of idle curl handles kept for connection reuse
 OPTION(rgw_copy_obj_progress, OPT_BOOL, true) // should dump progress during long copy operations?
 OPTION(rgw_copy_obj_progress_every_bytes, OPT_INT, 1024 * 1024) // min bytes between copy progress output
 
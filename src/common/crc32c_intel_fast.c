@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "acconfig.h"
 #include "include/int_types.h"
 #include "common/crc32c_intel_baseline.h"
@@ -7,6 +9,44 @@ extern unsigned int crc32_iscsi_zero_00(unsigned char const *buffer, int len, un
 
 #ifdef HAVE_GOOD_YASM_ELF64
 
+/*
+ * Plain crc32 instruction loop for short and unaligned stretches.
+ * The 3-way streaming kernel in crc32c_intel_fast_asm.S wins on bulk
+ * data, but its setup swamps the actual work for the small crcs the
+ * messenger computes constantly (47 byte headers, footers) and for
+ * the odd tail bytes of unaligned buffers; for those, issue the
+ * instruction directly.  Only ever called behind the runtime sse4.2
+ * check in ceph_choose_crc32().
+ */
+static uint32_t crc32c_intel_insn(uint32_t crc, unsigned char const *buffer, unsigned len)
+{
+	while (len >= 8) {
+		uint64_t v, c = crc;
+		memcpy(&v, buffer, 8);
+		__asm__("crc32q %1, %0" : "+r" (c) : "rm" (v));
+		crc = (uint32_t)c;
+		buffer += 8;
+		len -= 8;
+	}
+	if (len >= 4) {
+		uint32_t v;
+		memcpy(&v, buffer, 4);
+		__asm__("crc32l %1, %0" : "+r" (crc) : "rm" (v));
+		buffer += 4;
+		len -= 4;
+	}
+	if (len >= 2) {
+		uint16_t v;
+		memcpy(&v, buffer, 2);
+		__asm__("crc32w %1, %0" : "+r" (crc) : "rm" (v));
+		buffer += 2;
+		len -= 2;
+	}
+	if (len)
+		__asm__("crc32b %1, %0" : "+r" (crc) : "rm" (*buffer));
+	return crc;
+}
+
 uint32_t ceph_crc32c_intel_fast(uint32_t crc, unsigned char const *buffer, unsigned len)
 {
 	uint32_t v;
@@ -19,15 +59,16 @@ uint32_t ceph_crc32c_intel_fast(uint32_t crc, unsigned char const *buffer, unsig
 	/*
 	 * the crc32_iscsi_00 method reads past buffer+len (because it
 	 * reads full words) which makes valgrind unhappy.  don't do
-	 * that.
+	 * that.  short buffers also don't amortize its setup; take the
+	 * plain instruction path for both.
 	 */
-	if (len < 16)
-		return ceph_crc32c_intel_baseline(crc, buffer, len);
+	if (len < 64)
+		return crc32c_intel_insn(crc, buffer, len);
 	left = ((unsigned long)buffer + len) & 7;
 	len -= left;
 	v = crc32_iscsi_00(buffer, len, crc);
 	if (left)
-		v = ceph_crc32c_intel_baseline(v, buffer + len, left);
+		v = crc32c_intel_insn(v, buffer + len, left);
 	return v;
 }
 
@@ -0,0 +1,110 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/lock_contention.h"
+#include "common/Formatter.h"
+#include "include/atomic.h"
+
+#include <algorithm>
+#include <map>
+#include <pthread.h>
+#include <vector>
+
+/******* Globals **********/
+bool g_lock_contention = false;
+
+struct lock_contention_stat_t {
+  uint64_t waits;
+  uint64_t wait_nsec;
+  uint64_t max_wait_nsec;
+  lock_contention_stat_t() : waits(0), wait_nsec(0), max_wait_nsec(0) {}
+};
+
+// plain pthread lock, not Mutex: Mutex::Lock() calls back in here
+static pthread_mutex_t contention_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, lock_contention_stat_t> contention_stats;
+static ceph::atomic_t contention_counter;
+static uint32_t contention_sample_interval = 1;
+
+void lock_contention_enable(uint32_t sample_interval)
+{
+  pthread_mutex_lock(&contention_lock);
+  contention_sample_interval = sample_interval ? sample_interval : 1;
+  pthread_mutex_unlock(&contention_lock);
+  g_lock_contention = true;
+}
+
+void lock_contention_disable()
+{
+  g_lock_contention = false;
+}
+
+void lock_contention_reset()
+{
+  pthread_mutex_lock(&contention_lock);
+  contention_stats.clear();
+  pthread_mutex_unlock(&contention_lock);
+}
+
+bool lock_contention_sample()
+{
+  uint32_t n = contention_sample_interval;
+  if (n <= 1)
+    return true;
+  return (contention_counter.inc() % n) == 0;
+}
+
+void lock_contention_record(const std::string &name, uint64_t wait_nsec)
+{
+  pthread_mutex_lock(&contention_lock);
+  lock_contention_stat_t &s = contention_stats[name];
+  s.waits++;
+  s.wait_nsec += wait_nsec;
+  if (wait_nsec > s.max_wait_nsec)
+    s.max_wait_nsec = wait_nsec;
+  pthread_mutex_unlock(&contention_lock);
+}
+
+struct SortByTotalWait {
+  typedef std::pair<std::string, lock_contention_stat_t> entry_t;
+  bool operator()(const entry_t &lhs, const entry_t &rhs) const {
+    return lhs.second.wait_nsec > rhs.second.wait_nsec;
+  }
+};
+
+void lock_contention_dump(ceph::Formatter *f)
+{
+  std::vector<std::pair<std::string, lock_contention_stat_t> > sorted;
+  uint32_t interval;
+  pthread_mutex_lock(&contention_lock);
+  sorted.assign(contention_stats.begin(), contention_stats.end());
+  interval = contention_sample_interval;
+  pthread_mutex_unlock(&contention_lock);
+  std::sort(sorted.begin(), sorted.end(), SortByTotalWait());
+
+  f->open_object_section("lock_contention");
+  f->dump_unsigned("enabled", g_lock_contention ? 1 : 0);
+  f->dump_unsigned("sample_interval", interval);
+  f->open_array_section("locks");
+  for (std::vector<std::pair<std::string,
+	 lock_contention_stat_t> >::iterator p = sorted.begin();
+       p != sorted.end(); ++p) {
+    f->open_object_section("lock");
+    f->dump_string("name", p->first);
+    f->dump_unsigned("contended_waits", p->second.waits);
+    f->dump_unsigned("total_wait_nsec", p->second.wait_nsec);
+    f->dump_unsigned("max_wait_nsec", p->second.max_wait_nsec);
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+}
@@ -0,0 +1,47 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_LOCK_CONTENTION_H
+#define CEPH_LOCK_CONTENTION_H
+
+#include <stdint.h>
+#include <string>
+
+namespace ceph {
+  class Formatter;
+}
+
+/*
+ * A sampled lock contention profiler, analogous in spirit to lockdep:
+ * a process-wide registry that Mutex::Lock() reports into, keyed by
+ * lock name, so contention on e.g. every PG lock aggregates into one
+ * ranked entry.  Off by default; when enabled, every Nth lock
+ * acquisition that actually blocks has its wait timed and recorded.
+ * Toggle and dump over the admin socket ("lock_contention *").
+ */
+
+extern bool g_lock_contention;
+
+extern void lock_contention_enable(uint32_t sample_interval);
+extern void lock_contention_disable();
+extern void lock_contention_reset();
+
+/// true if this acquisition is one of the sampled ones
+extern bool lock_contention_sample();
+/// record a blocked acquisition of the named lock
+extern void lock_contention_record(const std::string &name,
+				   uint64_t wait_nsec);
+
+/// dump recorded stats, ranked by total wait time
+extern void lock_contention_dump(ceph::Formatter *f);
+
+#endif
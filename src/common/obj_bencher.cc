@@ -25,6 +25,8 @@
 
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
+#include <algorithm>
 #include <sstream>
 #include <vector>
 
@@ -322,6 +324,50 @@ static T vec_stddev(vector<T>& v)
   return sqrt(stddev);
 }
 
+// nearest-rank percentile over a copy of the samples; the vectors
+// here hold one entry per completed op, so this is exact
+static double vec_percentile(vector<double> v, double centile)
+{
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(centile / 100.0 * v.size() + 0.5);
+  if (i)
+    --i;
+  if (i >= v.size())
+    i = v.size() - 1;
+  return v[i];
+}
+
+void ObjBencher::dump_latency_percentiles()
+{
+  if (!formatter) {
+    out(cout) << "Median Latency:         " << vec_percentile(data.history.latency, 50) << std::endl
+       << "99th Latency:           " << vec_percentile(data.history.latency, 99) << std::endl
+       << "99.9th Latency:         " << vec_percentile(data.history.latency, 99.9) << std::endl;
+  } else {
+    formatter->dump_format("median_latency", "%f", vec_percentile(data.history.latency, 50));
+    formatter->dump_format("latency_99", "%f", vec_percentile(data.history.latency, 99));
+    formatter->dump_format("latency_999", "%f", vec_percentile(data.history.latency, 99.9));
+  }
+}
+
+// open-loop pacing: hold the next issue until its scheduled arrival
+// time so a run measures queueing at a fixed offered rate instead of
+// whatever rate the cluster happens to saturate at
+void ObjBencher::pace_op(int opnum)
+{
+  if (target_iops <= 0)
+    return;
+  utime_t next = data.start_time;
+  next += (double)opnum / target_iops;
+  utime_t now = ceph_clock_now(cct);
+  if (now < next) {
+    utime_t diff = next - now;
+    usleep(diff.to_nsec() / 1000);
+  }
+}
+
 int ObjBencher::fetch_bench_metadata(const std::string& metadata_file, int* object_size, int* num_objects, int* prevPid) {
   int r = 0;
   bufferlist object_data;
@@ -395,6 +441,7 @@ int ObjBencher::write_bench(int secondsToRun,
   data.start_time = ceph_clock_now(cct);
   lock.Unlock();
   for (int i = 0; i<concurrentios; ++i) {
+    pace_op(i);
     start_times[i] = ceph_clock_now(cct);
     r = create_completion(i, _aio_cb, (void *)&lc);
     if (r < 0)
@@ -464,6 +511,7 @@ int ObjBencher::write_bench(int secondsToRun,
     timePassed = ceph_clock_now(cct) - data.start_time;
 
     //write new stuff to backend
+    pace_op(data.started);
     start_times[slot] = ceph_clock_now(cct);
     r = create_completion(slot, _aio_cb, &lc);
     if (r < 0)
@@ -546,6 +594,7 @@ int ObjBencher::write_bench(int secondsToRun,
     formatter->dump_format("max_latency:", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
   }
+  dump_latency_percentiles();
   //write object size/number data for read benchmarks
   ::encode(data.object_size, b_write);
   ::encode(data.finished, b_write);
@@ -615,6 +664,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
   //start initial reads
   for (int i = 0; i < concurrentios; ++i) {
     index[i] = i;
+    pace_op(i);
     start_times[i] = ceph_clock_now(cct);
     create_completion(i, _aio_cb, (void *)&lc);
     r = aio_read(name[i], i, contents[i], data.object_size);
@@ -683,6 +733,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     lock.Lock();
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -693,6 +744,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     release_completion(slot);
 
     //start new read and check data if requested
+    pace_op(data.started);
     start_times[slot] = ceph_clock_now(cct);
     create_completion(slot, _aio_cb, (void *)&lc);
     r = aio_read(newName, slot, contents[slot], data.object_size);
@@ -718,6 +770,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(cct) - start_times[slot];
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -774,6 +827,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
   }
+  dump_latency_percentiles();
 
   completions_done();
 
@@ -833,6 +887,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   //start initial reads
   for (int i = 0; i < concurrentios; ++i) {
     index[i] = i;
+    pace_op(i);
     start_times[i] = ceph_clock_now(g_ceph_context);
     create_completion(i, _aio_cb, (void *)&lc);
     r = aio_read(name[i], i, contents[i], data.object_size);
@@ -889,6 +944,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       goto ERR;
     }
 
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -914,6 +970,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     cur_contents->invalidate_crc();
 
     //start new read and check data if requested
+    pace_op(data.started);
     start_times[slot] = ceph_clock_now(g_ceph_context);
     create_completion(slot, _aio_cb, (void *)&lc);
     r = aio_read(newName, slot, contents[slot], data.object_size);
@@ -940,6 +997,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(g_ceph_context) - start_times[slot];
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -996,6 +1054,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
   }
+  dump_latency_percentiles();
   completions_done();
 
   return 0;
@@ -60,6 +60,7 @@ typedef std::pair<std::string, std::string> Object;
 
 class ObjBencher {
   bool show_time;
+  double target_iops = 0; // open-loop: schedule issues at this rate (0 = as fast as possible)
   Formatter *formatter = NULL;
   ostream *outstream = NULL;
 public:
@@ -80,6 +81,9 @@ protected:
   int clean_up(int num_objects, int prevPid, int concurrentios);
   bool more_objects_matching_prefix(const std::string& prefix, std::list<Object>* name);
 
+  void pace_op(int opnum);
+  void dump_latency_percentiles();
+
   virtual int completions_init(int concurrentios) = 0;
   virtual void completions_done() = 0;
 
@@ -113,6 +117,9 @@ public:
   void set_show_time(bool dt) {
     show_time = dt;
   }
+  void set_target_iops(double iops) {
+    target_iops = iops;
+  }
   void set_formatter(Formatter *f) {
     formatter = f;
   }
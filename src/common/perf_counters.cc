@@ -18,6 +18,7 @@
 #include "common/dout.h"
 #include "common/errno.h"
 #include "common/Formatter.h"
+#include "include/encoding.h"
 
 #include <errno.h>
 #include <map>
@@ -30,7 +31,8 @@ using std::ostringstream;
 
 PerfCountersCollection::PerfCountersCollection(CephContext *cct)
   : m_cct(cct),
-    m_lock("PerfCountersCollection")
+    m_lock("PerfCountersCollection"),
+    m_delta_seq(0)
 {
 }
 
@@ -131,12 +133,89 @@ void PerfCountersCollection::dump_formatted(
   f->close_section();
 }
 
+/**
+ * Serialize only the counters that changed since the snapshot
+ * identified by @p cursor.  A cursor of 0, a stale cursor, or a cursor
+ * issued to a different consumer degrades to a full dump.  Each call
+ * retires the old snapshot and returns the cursor for the new one, so
+ * the delta interface supports a single polling consumer; a second
+ * poller just keeps forcing full dumps.
+ *
+ * @param cursor sequence number from a previous call, or 0
+ * @return the cursor identifying the snapshot taken by this call
+ */
+uint64_t PerfCountersCollection::dump_formatted_delta(
+    Formatter *f,
+    uint64_t cursor)
+{
+  Mutex::Locker lck(m_lock);
+  bool full = (cursor == 0 || cursor != m_delta_seq);
+  ++m_delta_seq;
+
+  f->open_object_section("perfcounter_delta");
+  f->dump_unsigned("cursor", m_delta_seq);
+  f->dump_unsigned("full", full ? 1 : 0);
+  f->open_object_section("perfcounter_collection");
+
+  std::map<std::string,
+	   std::vector<std::pair<uint64_t, uint64_t> > > new_snap;
+  for (perf_counters_set_t::iterator l = m_loggers.begin();
+       l != m_loggers.end(); ++l) {
+    std::vector<std::pair<uint64_t, uint64_t> > &snap =
+      new_snap[(*l)->get_name()];
+    std::map<std::string,
+	     std::vector<std::pair<uint64_t, uint64_t> > >::iterator p =
+      m_delta_snap.find((*l)->get_name());
+    if (p != m_delta_snap.end())
+      snap.swap(p->second);
+    (*l)->dump_delta(f, snap, full);
+  }
+  // rebuilt from live loggers, so removed loggers drop out
+  m_delta_snap.swap(new_snap);
+
+  f->close_section();
+  f->close_section();
+  return m_delta_seq;
+}
+
+void PerfCountersCollection::dump_binary(bufferlist &bl)
+{
+  Mutex::Locker lck(m_lock);
+  __u8 v = 1;
+  ::encode(v, bl);
+  __u32 n = m_loggers.size();
+  ::encode(n, bl);
+  for (perf_counters_set_t::iterator l = m_loggers.begin();
+       l != m_loggers.end(); ++l) {
+    (*l)->dump_binary(bl);
+  }
+}
+
 // ---------------------------
 
 PerfCounters::~PerfCounters()
 {
 }
 
+uint64_t PerfCounters::read_cell_sum(int off) const
+{
+  uint64_t sum = 0;
+  for (unsigned s = 0; s < SHARDS; s++)
+    sum += m_cells[off * SHARDS + s].u64.read();
+  return sum;
+}
+
+pair<uint64_t,uint64_t> PerfCounters::read_cell_avg(int off) const
+{
+  uint64_t sum = 0, count = 0;
+  for (unsigned s = 0; s < SHARDS; s++) {
+    pair<uint64_t,uint64_t> a = m_cells[off * SHARDS + s].read_avg();
+    sum += a.first;
+    count += a.second;
+  }
+  return make_pair(sum, count);
+}
+
 void PerfCounters::inc(int idx, uint64_t amt)
 {
   if (!m_cct->_conf->perf)
@@ -147,12 +226,13 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
+  perf_counter_cell_d *cell = get_my_cell(idx - m_lower_bound - 1);
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt);
-    data.avgcount2.inc();
+    cell->avgcount.inc();
+    cell->u64.add(amt);
+    cell->avgcount2.inc();
   } else {
-    data.u64.add(amt);
+    cell->u64.add(amt);
   }
 }
 
@@ -167,7 +247,7 @@ void PerfCounters::dec(int idx, uint64_t amt)
   assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64.sub(amt);
+  get_my_cell(idx - m_lower_bound - 1)->u64.sub(amt);
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -180,12 +260,19 @@ void PerfCounters::set(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
+  // a set overrides whatever has been accumulated: the value lands in
+  // the first cell and the others are cleared so the summed read
+  // equals amt (modulo racing updates, which were racy before too)
+  int off = idx - m_lower_bound - 1;
+  for (unsigned s = 1; s < SHARDS; s++)
+    m_cells[off * SHARDS + s].reset();
+  perf_counter_cell_d &cell = m_cells[off * SHARDS];
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.set(amt);
-    data.avgcount2.inc();
+    cell.avgcount.inc();
+    cell.u64.set(amt);
+    cell.avgcount2.inc();
   } else {
-    data.u64.set(amt);
+    cell.u64.set(amt);
   }
 }
 
@@ -199,7 +286,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64.read();
+  return read_cell_sum(idx - m_lower_bound - 1);
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -212,12 +299,13 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
+  perf_counter_cell_d *cell = get_my_cell(idx - m_lower_bound - 1);
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt.to_nsec());
-    data.avgcount2.inc();
+    cell->avgcount.inc();
+    cell->u64.add(amt.to_nsec());
+    cell->avgcount2.inc();
   } else {
-    data.u64.add(amt.to_nsec());
+    cell->u64.add(amt.to_nsec());
   }
 }
 
@@ -231,7 +319,10 @@ void PerfCounters::tset(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  data.u64.set(amt.to_nsec());
+  int off = idx - m_lower_bound - 1;
+  for (unsigned s = 1; s < SHARDS; s++)
+    m_cells[off * SHARDS + s].reset();
+  m_cells[off * SHARDS].u64.set(amt.to_nsec());
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     assert(0);
 }
@@ -246,7 +337,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64.read();
+  uint64_t v = read_cell_sum(idx - m_lower_bound - 1);
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -262,18 +353,18 @@ pair<uint64_t, uint64_t> PerfCounters::get_tavg_ms(int idx) const
     return make_pair(0, 0);
   if (!(data.type & PERFCOUNTER_LONGRUNAVG))
     return make_pair(0, 0);
-  pair<uint64_t,uint64_t> a = data.read_avg();
+  pair<uint64_t,uint64_t> a = read_cell_avg(idx - m_lower_bound - 1);
   return make_pair(a.second, a.first / 1000000ull);
 }
 
 void PerfCounters::reset()
 {
-  perf_counter_data_vec_t::iterator d = m_data.begin();
-  perf_counter_data_vec_t::iterator d_end = m_data.end();
-
-  while (d != d_end) {
-    d->reset();
-    ++d;
+  for (unsigned i = 0; i < m_data.size(); i++) {
+    // plain values (non-counters) survive a reset, as before
+    if (m_data[i].type == PERFCOUNTER_U64)
+      continue;
+    for (unsigned s = 0; s < SHARDS; s++)
+      m_cells[i * SHARDS + s].reset();
   }
 }
 
@@ -308,7 +399,7 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
     } else {
       if (d->type & PERFCOUNTER_LONGRUNAVG) {
 	f->open_object_section(d->name);
-	pair<uint64_t,uint64_t> a = d->read_avg();
+	pair<uint64_t,uint64_t> a = read_cell_avg(d - m_data.begin());
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned("avgcount", a.second);
 	  f->dump_unsigned("sum", a.first);
@@ -322,7 +413,7 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
 	}
 	f->close_section();
       } else {
-	uint64_t v = d->u64.read();
+	uint64_t v = read_cell_sum(d - m_data.begin());
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -338,6 +429,81 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
   f->close_section();
 }
 
+void PerfCounters::dump_delta(Formatter *f,
+    std::vector<std::pair<uint64_t, uint64_t> > &snap, bool full)
+{
+  // a snapshot of the wrong shape (new logger, or counters added since)
+  // cannot be diffed against; emit everything
+  bool have_prev = !full && snap.size() == m_data.size();
+
+  std::vector<std::pair<uint64_t, uint64_t> > cur(m_data.size());
+  for (unsigned i = 0; i < m_data.size(); i++) {
+    if (m_data[i].type & PERFCOUNTER_LONGRUNAVG)
+      cur[i] = read_cell_avg(i);
+    else
+      cur[i] = make_pair(read_cell_sum(i), (uint64_t)0);
+  }
+
+  f->open_object_section(m_name.c_str());
+  for (unsigned i = 0; i < m_data.size(); i++) {
+    if (have_prev && cur[i] == snap[i])
+      continue;
+    const perf_counter_data_any_d &d = m_data[i];
+    if (d.type & PERFCOUNTER_LONGRUNAVG) {
+      f->open_object_section(d.name);
+      if (d.type & PERFCOUNTER_U64) {
+	f->dump_unsigned("avgcount", cur[i].second);
+	f->dump_unsigned("sum", cur[i].first);
+      } else if (d.type & PERFCOUNTER_TIME) {
+	f->dump_unsigned("avgcount", cur[i].second);
+	f->dump_format_unquoted("sum", "%" PRId64 ".%09" PRId64,
+				cur[i].first / 1000000000ull,
+				cur[i].first % 1000000000ull);
+      } else {
+	assert(0);
+      }
+      f->close_section();
+    } else {
+      if (d.type & PERFCOUNTER_U64) {
+	f->dump_unsigned(d.name, cur[i].first);
+      } else if (d.type & PERFCOUNTER_TIME) {
+	f->dump_format_unquoted(d.name, "%" PRId64 ".%09" PRId64,
+				cur[i].first / 1000000000ull,
+				cur[i].first % 1000000000ull);
+      } else {
+	assert(0);
+      }
+    }
+  }
+  f->close_section();
+
+  snap.swap(cur);
+}
+
+void PerfCounters::dump_binary(bufferlist &bl)
+{
+  ::encode(m_name, bl);
+  __u32 n = m_data.size();
+  ::encode(n, bl);
+  for (unsigned i = 0; i < m_data.size(); i++) {
+    const perf_counter_data_any_d &d = m_data[i];
+    std::string name(d.name);
+    ::encode(name, bl);
+    __u8 type = d.type;
+    ::encode(type, bl);
+    if (d.type & PERFCOUNTER_LONGRUNAVG) {
+      pair<uint64_t,uint64_t> a = read_cell_avg(i);
+      ::encode(a.first, bl);   // sum (nsec for TIME counters)
+      ::encode(a.second, bl);  // avgcount
+    } else {
+      uint64_t v = read_cell_sum(i);
+      ::encode(v, bl);
+      uint64_t zero = 0;
+      ::encode(zero, bl);
+    }
+  }
+}
+
 const std::string &PerfCounters::get_name() const
 {
   return m_name;
@@ -353,6 +519,7 @@ PerfCounters::PerfCounters(CephContext *cct, const std::string &name,
     m_lock(m_lock_name.c_str())
 {
   m_data.resize(upper_bound - lower_bound - 1);
+  m_cells.resize(m_data.size() * SHARDS);
 }
 
 PerfCountersBuilder::PerfCountersBuilder(CephContext *cct, const std::string &name,
@@ -22,6 +22,7 @@
 #include "include/utime.h"
 
 #include <stdint.h>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -97,6 +98,9 @@ public:
   void reset();
   void dump_formatted(ceph::Formatter *f, bool schema,
       const std::string &counter = "");
+  void dump_delta(ceph::Formatter *f,
+      std::vector<std::pair<uint64_t, uint64_t> > &snap, bool full);
+  void dump_binary(ceph::bufferlist &bl);
   pair<uint64_t, uint64_t> get_tavg_ms(int idx) const;
 
   const std::string& get_name() const;
@@ -110,51 +114,43 @@ private:
   PerfCounters(const PerfCounters &rhs);
   PerfCounters& operator=(const PerfCounters &rhs);
 
-  /** Represents a PerfCounters data element. */
+  /// number of value cells per counter; a power of two.  update
+  /// threads hash to a cell, readers sum across them, so hot counters
+  /// bumped from every shard thread never contend on one cacheline.
+  static const unsigned SHARDS = 8;
+
+  /** Describes a PerfCounters data element (values live in the cells). */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
       : name(NULL),
         description(NULL),
         nick(NULL),
-	type(PERFCOUNTER_NONE),
-	u64(0),
-	avgcount(0),
-	avgcount2(0)
+	type(PERFCOUNTER_NONE)
     {}
-    perf_counter_data_any_d(const perf_counter_data_any_d& other)
-      : name(other.name),
-        description(other.description),
-        nick(other.nick),
-	type(other.type),
-	u64(other.u64.read()) {
-      pair<uint64_t,uint64_t> a = other.read_avg();
-      u64.set(a.first);
-      avgcount.set(a.second);
-      avgcount2.set(a.second);
-    }
 
     const char *name;
     const char *description;
     const char *nick;
     enum perfcounter_type_d type;
+  };
+  typedef std::vector<perf_counter_data_any_d> perf_counter_data_vec_t;
+
+  /** One counter's value in one shard, padded out to a cacheline so
+   * neighbouring cells updated by other threads do not share it. */
+  struct perf_counter_cell_d {
     atomic64_t u64;
     atomic64_t avgcount;
     atomic64_t avgcount2;
+    char pad[64 - ((3 * sizeof(atomic64_t)) % 64)];
 
-    void reset()
-    {
-      if (type != PERFCOUNTER_U64) {
-	u64.set(0);
-	avgcount.set(0);
-	avgcount2.set(0);
-      }
+    perf_counter_cell_d() : u64(0), avgcount(0), avgcount2(0) {}
+    perf_counter_cell_d(const perf_counter_cell_d& other) {
+      pair<uint64_t,uint64_t> a = other.read_avg();
+      u64.set(a.first);
+      avgcount.set(a.second);
+      avgcount2.set(a.second);
     }
-
-    perf_counter_data_any_d& operator=(const perf_counter_data_any_d& other) {
-      name = other.name;
-      description = other.description;
-      nick = other.nick;
-      type = other.type;
+    perf_counter_cell_d& operator=(const perf_counter_cell_d& other) {
       pair<uint64_t,uint64_t> a = other.read_avg();
       u64.set(a.first);
       avgcount.set(a.second);
@@ -162,6 +158,13 @@ private:
       return *this;
     }
 
+    void reset()
+    {
+      u64.set(0);
+      avgcount.set(0);
+      avgcount2.set(0);
+    }
+
     /// read <sum, count> safely
     pair<uint64_t,uint64_t> read_avg() const {
       uint64_t sum, count;
@@ -172,7 +175,20 @@ private:
       return make_pair(sum, count);
     }
   };
-  typedef std::vector<perf_counter_data_any_d> perf_counter_data_vec_t;
+  typedef std::vector<perf_counter_cell_d> perf_counter_cell_vec_t;
+
+  /// cell for counter offset off in the shard the calling thread
+  /// hashes to; used on the update paths
+  perf_counter_cell_d *get_my_cell(int off) {
+    unsigned long v = (unsigned long)pthread_self();
+    unsigned shard = ((v * 2654435761ul) >> 16) & (SHARDS - 1);
+    return &m_cells[off * SHARDS + shard];
+  }
+
+  /// sum of u64 across all of a counter's cells
+  uint64_t read_cell_sum(int off) const;
+  /// sum of <sum, count> across all of a counter's cells
+  pair<uint64_t,uint64_t> read_cell_avg(int off) const;
 
   CephContext *m_cct;
   int m_lower_bound;
@@ -184,6 +200,7 @@ private:
   mutable Mutex m_lock;
 
   perf_counter_data_vec_t m_data;
+  perf_counter_cell_vec_t m_cells;  // m_data.size() * SHARDS entries
 
   friend class PerfCountersBuilder;
 };
@@ -214,6 +231,8 @@ public:
       bool schema,
       const std::string &logger = "",
       const std::string &counter = "");
+  uint64_t dump_formatted_delta(ceph::Formatter *f, uint64_t cursor);
+  void dump_binary(ceph::bufferlist &bl);
 private:
   CephContext *m_cct;
 
@@ -222,6 +241,14 @@ private:
 
   perf_counters_set_t m_loggers;
 
+  /// cursor state for dump_formatted_delta.  we retain one snapshot of
+  /// all counter values, keyed by logger name; a query presenting the
+  /// matching cursor gets only the counters that changed since that
+  /// snapshot was taken.  anything else degrades to a full dump.
+  uint64_t m_delta_seq;
+  std::map<std::string,
+	   std::vector<std::pair<uint64_t, uint64_t> > > m_delta_snap;
+
   friend class PerfCountersCollectionTest;
 };
 
@@ -1,4 +1,4 @@
-// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*- 
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 /*
  * Ceph - scalable distributed file system
@@ -7,82 +7,148 @@
  *
  * This is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
- * License version 2.1, as published by the Free Software 
+ * License version 2.1, as published by the Free Software
  * Foundation.  See file COPYING.
- * 
+ *
  */
 
 #ifndef CEPH_SHAREDCACHE_H
 #define CEPH_SHAREDCACHE_H
 
+#include <functional>
 #include <map>
 #include <list>
 #include <memory>
 #include <utility>
+#include <vector>
 #include "common/Mutex.h"
 #include "common/Cond.h"
+#include "include/atomic.h"
 
-template <class K, class V, class C = std::less<K> >
+template <class K, class V, class C = std::less<K>, class H = std::hash<K> >
 class SharedLRU {
   CephContext *cct;
   typedef ceph::shared_ptr<V> VPtr;
   typedef ceph::weak_ptr<V> WeakVPtr;
-  Mutex lock;
-  size_t max_size;
-  Cond cond;
-  unsigned size;
+
+  /* The cache is split into independently locked shards so that
+   * concurrent lookups of different keys need not serialize on a single
+   * mutex.  Keyed operations touch exactly one shard; ordered
+   * operations (lower_bound, get_next, cached_key_lower_bound) consult
+   * every shard and merge the results, so callers that lean on those
+   * should keep the shard count low. */
+  struct Shard {
+    Mutex lock;
+    Cond cond;
+    size_t max_size;
+    unsigned size;
+    map<K, typename list<pair<K, VPtr> >::iterator, C> contents;
+    list<pair<K, VPtr> > lru;
+    map<K, pair<WeakVPtr, V*>, C> weak_refs;
+
+    // lookup window for adaptive sizing
+    unsigned window_lookups;
+    unsigned window_misses;
+
+    Shard()
+      : lock("SharedLRU::Shard::lock"), max_size(0), size(0),
+	window_lookups(0), window_misses(0) {}
+  };
+  std::vector<Shard*> shards;
+  H hash;
+  size_t total_size;  ///< configured capacity summed over all shards
+  size_t adapt_min;   ///< adaptive sizing lower bound; see set_size_bounds()
+  size_t adapt_max;   ///< adaptive sizing upper bound; 0 disables adaptation
+
+  static const unsigned ADAPT_WINDOW = 1024;
+
 public:
-  int waiting;
+  // threads blocked in lookup/lower_bound waiting for a dying entry to
+  // finish being removed.  updated under different per-shard locks, so
+  // it must be atomic; readers (the tests) take no lock at all.
+  atomic_t waiting;
 private:
-  map<K, typename list<pair<K, VPtr> >::iterator, C> contents;
-  list<pair<K, VPtr> > lru;
 
-  map<K, pair<WeakVPtr, V*>, C> weak_refs;
+  Shard &shard(const K& key) {
+    return *shards[hash(key) % shards.size()];
+  }
+
+  size_t shard_share(size_t n) const {
+    return (n + shards.size() - 1) / shards.size();
+  }
 
-  void trim_cache(list<VPtr> *to_release) {
-    while (size > max_size) {
-      to_release->push_back(lru.back().second);
-      lru_remove(lru.back().first);
+  void trim_cache(Shard &s, list<VPtr> *to_release) {
+    while (s.size > s.max_size) {
+      to_release->push_back(s.lru.back().second);
+      lru_remove(s, s.lru.back().first);
     }
   }
 
-  void lru_remove(const K& key) {
+  void lru_remove(Shard &s, const K& key) {
     typename map<K, typename list<pair<K, VPtr> >::iterator, C>::iterator i =
-      contents.find(key);
-    if (i == contents.end())
+      s.contents.find(key);
+    if (i == s.contents.end())
       return;
-    lru.erase(i->second);
-    --size;
-    contents.erase(i);
+    s.lru.erase(i->second);
+    --s.size;
+    s.contents.erase(i);
   }
 
-  void lru_add(const K& key, const VPtr& val, list<VPtr> *to_release) {
+  void lru_add(Shard &s, const K& key, const VPtr& val, list<VPtr> *to_release) {
     typename map<K, typename list<pair<K, VPtr> >::iterator, C>::iterator i =
-      contents.find(key);
-    if (i != contents.end()) {
-      lru.splice(lru.begin(), lru, i->second);
+      s.contents.find(key);
+    if (i != s.contents.end()) {
+      s.lru.splice(s.lru.begin(), s.lru, i->second);
     } else {
-      ++size;
-      lru.push_front(make_pair(key, val));
-      contents[key] = lru.begin();
-      trim_cache(to_release);
+      ++s.size;
+      s.lru.push_front(make_pair(key, val));
+      s.contents[key] = s.lru.begin();
+      trim_cache(s, to_release);
     }
   }
 
+  /* Adaptive sizing: when bounds are set, a shard that keeps missing
+   * gets more slots, and a shard that is almost always hitting slowly
+   * gives memory back toward the lower bound.  Only window counters are
+   * kept; there is no extra per-entry state.  Called under s.lock. */
+  void note_lookup(Shard &s, bool hit, list<VPtr> *to_release) {
+    if (!adapt_max)
+      return;
+    s.window_lookups++;
+    if (!hit)
+      s.window_misses++;
+    if (s.window_lookups < ADAPT_WINDOW)
+      return;
+    size_t lo = shard_share(adapt_min);
+    size_t hi = shard_share(adapt_max);
+    if (s.window_misses * 4 >= s.window_lookups) {
+      // missing on a quarter or more of lookups; grant more slots
+      s.max_size = std::min(hi, s.max_size + s.max_size / 4 + 1);
+    } else if (s.window_misses * 32 <= s.window_lookups && s.max_size > lo) {
+      // nearly all hits; decay back toward the configured size
+      s.max_size = std::max(lo, s.max_size - std::max(s.max_size / 8,
+						      (size_t)1));
+      trim_cache(s, to_release);
+    }
+    s.window_lookups = 0;
+    s.window_misses = 0;
+  }
+
   void remove(const K& key, V *valptr) {
-    Mutex::Locker l(lock);
-    typename map<K, pair<WeakVPtr, V*>, C>::iterator i = weak_refs.find(key);
-    if (i != weak_refs.end() && i->second.second == valptr) {
-      weak_refs.erase(i);
+    Shard &s = shard(key);
+    Mutex::Locker l(s.lock);
+    typename map<K, pair<WeakVPtr, V*>, C>::iterator i = s.weak_refs.find(key);
+    if (i != s.weak_refs.end() && i->second.second == valptr) {
+      s.weak_refs.erase(i);
     }
-    cond.Signal();
+    s.cond.Signal();
   }
 
   class Cleanup {
   public:
-    SharedLRU<K, V, C> *cache;
+    SharedLRU<K, V, C, H> *cache;
     K key;
-    Cleanup(SharedLRU<K, V, C> *cache, K key) : cache(cache), key(key) {}
+    Cleanup(SharedLRU<K, V, C, H> *cache, K key) : cache(cache), key(key) {}
     void operator()(V *ptr) {
       cache->remove(key, ptr);
       delete ptr;
@@ -90,37 +156,54 @@ private:
   };
 
 public:
-  SharedLRU(CephContext *cct = NULL, size_t max_size = 20)
-    : cct(cct), lock("SharedLRU::lock"), max_size(max_size), 
-      size(0), waiting(0) {}
-  
+  SharedLRU(CephContext *cct = NULL, size_t max_size = 20, int num_shards = 1)
+    : cct(cct), total_size(max_size),
+      adapt_min(0), adapt_max(0), waiting(0) {
+    if (num_shards < 1)
+      num_shards = 1;
+    for (int i = 0; i < num_shards; ++i)
+      shards.push_back(new Shard);
+    for (int i = 0; i < num_shards; ++i)
+      shards[i]->max_size = shard_share(max_size);
+  }
+
   ~SharedLRU() {
-    contents.clear();
-    lru.clear();
-    if (!weak_refs.empty()) {
+    bool leaked = false;
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      shards[i]->contents.clear();
+      shards[i]->lru.clear();
+      if (!shards[i]->weak_refs.empty())
+	leaked = true;
+    }
+    if (leaked) {
       lderr(cct) << "leaked refs:\n";
       dump_weak_refs(*_dout);
       *_dout << dendl;
-      assert(weak_refs.empty());
+      assert(!leaked);
     }
+    for (unsigned i = 0; i < shards.size(); ++i)
+      delete shards[i];
   }
 
   /// adjust container comparator (for purposes of get_next sort order)
   void reset_comparator(C comp) {
     // get_next uses weak_refs; that's the only container we need to
     // reorder.
-    map<K, pair<WeakVPtr, V*>, C> temp;
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Shard &s = *shards[i];
+      map<K, pair<WeakVPtr, V*>, C> temp;
 
-    Mutex::Locker l(lock);
-    temp.swap(weak_refs);
+      Mutex::Locker l(s.lock);
+      temp.swap(s.weak_refs);
 
-    // reconstruct with new comparator
-    weak_refs = map<K, pair<WeakVPtr, V*>, C>(comp);
-    weak_refs.insert(temp.begin(), temp.end());
+      // reconstruct with new comparator
+      s.weak_refs = map<K, pair<WeakVPtr, V*>, C>(comp);
+      s.weak_refs.insert(temp.begin(), temp.end());
+    }
   }
 
   C get_comparator() {
-    return weak_refs.key_comp();
+    return shards[0]->weak_refs.key_comp();
   }
 
   void set_cct(CephContext *c) {
@@ -134,112 +217,194 @@ public:
   }
 
   void dump_weak_refs(ostream& out) {
-    for (typename map<K, pair<WeakVPtr, V*>, C>::iterator p = weak_refs.begin();
-	 p != weak_refs.end();
-	 ++p) {
-      out << __func__ << " " << this << " weak_refs: "
-	  << p->first << " = " << p->second.second
-	  << " with " << p->second.first.use_count() << " refs"
-	  << std::endl;
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      for (typename map<K, pair<WeakVPtr, V*>, C>::iterator p =
+	     shards[i]->weak_refs.begin();
+	   p != shards[i]->weak_refs.end();
+	   ++p) {
+	out << __func__ << " " << this << " weak_refs: "
+	    << p->first << " = " << p->second.second
+	    << " with " << p->second.first.use_count() << " refs"
+	    << std::endl;
+      }
     }
   }
 
   //clear all strong reference from the lru.
   void clear() {
-    while (true) {
-      VPtr val; // release any ref we have after we drop the lock
-      Mutex::Locker l(lock);
-      if (size == 0)
-        break;
-
-      val = lru.back().second;
-      lru_remove(lru.back().first);
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Shard &s = *shards[i];
+      while (true) {
+	VPtr val; // release any ref we have after we drop the lock
+	Mutex::Locker l(s.lock);
+	if (s.size == 0)
+	  break;
+
+	val = s.lru.back().second;
+	lru_remove(s, s.lru.back().first);
+      }
     }
   }
 
   void clear(const K& key) {
+    Shard &s = shard(key);
     VPtr val; // release any ref we have after we drop the lock
     {
-      Mutex::Locker l(lock);
-      if (weak_refs.count(key)) {
-	val = weak_refs[key].first.lock();
+      Mutex::Locker l(s.lock);
+      if (s.weak_refs.count(key)) {
+	val = s.weak_refs[key].first.lock();
       }
-      lru_remove(key);
+      lru_remove(s, key);
     }
   }
 
   void purge(const K &key) {
+    Shard &s = shard(key);
     VPtr val; // release any ref we have after we drop the lock
     {
-      Mutex::Locker l(lock);
-      if (weak_refs.count(key)) {
-	val = weak_refs[key].first.lock();
+      Mutex::Locker l(s.lock);
+      if (s.weak_refs.count(key)) {
+	val = s.weak_refs[key].first.lock();
       }
-      lru_remove(key);
-      weak_refs.erase(key);
+      lru_remove(s, key);
+      s.weak_refs.erase(key);
     }
   }
 
   void set_size(size_t new_size) {
     list<VPtr> to_release;
-    {
-      Mutex::Locker l(lock);
-      max_size = new_size;
-      trim_cache(&to_release);
+    total_size = new_size;
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Shard &s = *shards[i];
+      Mutex::Locker l(s.lock);
+      s.max_size = shard_share(new_size);
+      trim_cache(s, &to_release);
+    }
+  }
+
+  /**
+   * Let the cache grow and shrink between min and max in response to
+   * the observed hit rate, instead of staying pinned at the size given
+   * to set_size().  Pass max == 0 to disable adaptation.
+   */
+  void set_size_bounds(size_t min, size_t max) {
+    assert(!max || min <= max);
+    list<VPtr> to_release;
+    adapt_min = min;
+    adapt_max = max;
+    if (!max)
+      return;
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Shard &s = *shards[i];
+      Mutex::Locker l(s.lock);
+      s.max_size = std::max(shard_share(min),
+			    std::min(shard_share(max), s.max_size));
+      trim_cache(s, &to_release);
     }
   }
 
   // Returns K key s.t. key <= k for all currently cached k,v
   K cached_key_lower_bound() {
-    Mutex::Locker l(lock);
-    return weak_refs.begin()->first;
+    C comp = get_comparator();
+    K best = K();
+    bool found = false;
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Shard &s = *shards[i];
+      Mutex::Locker l(s.lock);
+      if (s.weak_refs.empty())
+	continue;
+      if (!found || comp(s.weak_refs.begin()->first, best)) {
+	best = s.weak_refs.begin()->first;
+	found = true;
+      }
+    }
+    return best;
   }
 
   VPtr lower_bound(const K& key) {
-    VPtr val;
+    C comp = get_comparator();
+    bool found = false;
+    K best_key = K();
+    VPtr best_val;
     list<VPtr> to_release;
-    {
-      Mutex::Locker l(lock);
-      ++waiting;
-      bool retry = false;
-      do {
-	retry = false;
-	if (weak_refs.empty())
-	  break;
-	typename map<K, pair<WeakVPtr, V*>, C>::iterator i =
-	  weak_refs.lower_bound(key);
-	if (i == weak_refs.end())
-	  --i;
-	val = i->second.first.lock();
-	if (val) {
-	  lru_add(i->first, val, &to_release);
-	} else {
-	  retry = true;
-	}
-	if (retry)
-	  cond.Wait(lock);
-      } while (retry);
-      --waiting;
+    for (unsigned sh = 0; sh < shards.size(); ++sh) {
+      Shard &s = *shards[sh];
+      K k = K();
+      VPtr val;
+      {
+	Mutex::Locker l(s.lock);
+	waiting.inc();
+	bool retry = false;
+	do {
+	  retry = false;
+	  if (s.weak_refs.empty())
+	    break;
+	  typename map<K, pair<WeakVPtr, V*>, C>::iterator i =
+	    s.weak_refs.lower_bound(key);
+	  if (i == s.weak_refs.end())
+	    --i;
+	  val = i->second.first.lock();
+	  if (val) {
+	    k = i->first;
+	    lru_add(s, i->first, val, &to_release);
+	  } else {
+	    retry = true;
+	  }
+	  if (retry)
+	    s.cond.Wait(s.lock);
+	} while (retry);
+	waiting.dec();
+      }
+      if (!val)
+	continue;
+      /* Prefer the smallest candidate at or above key; failing that,
+       * the largest candidate below it.  This matches the single-map
+       * behavior of falling back to the last element when nothing
+       * sorts after key. */
+      if (!found) {
+	best_key = k;
+	best_val = val;
+	found = true;
+	continue;
+      }
+      bool best_ge = !comp(best_key, key);
+      bool k_ge = !comp(k, key);
+      if (k_ge && !best_ge) {
+	best_key = k;
+	best_val = val;
+      } else if (k_ge == best_ge &&
+		 (k_ge ? comp(k, best_key) : comp(best_key, k))) {
+	best_key = k;
+	best_val = val;
+      }
     }
-    return val;
+    return best_val;
   }
   bool get_next(const K &key, pair<K, VPtr> *next) {
+    C comp = get_comparator();
+    bool found = false;
     pair<K, VPtr> r;
-    {
-      Mutex::Locker l(lock);
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Shard &s = *shards[i];
+      Mutex::Locker l(s.lock);
       VPtr next_val;
-      typename map<K, pair<WeakVPtr, V*>, C>::iterator i = weak_refs.upper_bound(key);
+      typename map<K, pair<WeakVPtr, V*>, C>::iterator p =
+	s.weak_refs.upper_bound(key);
 
-      while (i != weak_refs.end() &&
-	     !(next_val = i->second.first.lock()))
-	++i;
+      while (p != s.weak_refs.end() &&
+	     !(next_val = p->second.first.lock()))
+	++p;
 
-      if (i == weak_refs.end())
-	return false;
+      if (p == s.weak_refs.end())
+	continue;
 
-      if (next)
-	r = make_pair(i->first, next_val);
+      if (!found || comp(p->first, r.first)) {
+	r = make_pair(p->first, next_val);
+	found = true;
+      }
     }
+    if (!found)
+      return false;
     if (next)
       *next = r;
     return true;
@@ -256,56 +421,63 @@ public:
   }
 
   VPtr lookup(const K& key) {
+    Shard &s = shard(key);
     VPtr val;
     list<VPtr> to_release;
     {
-      Mutex::Locker l(lock);
-      ++waiting;
+      Mutex::Locker l(s.lock);
+      waiting.inc();
       bool retry = false;
       do {
 	retry = false;
-	typename map<K, pair<WeakVPtr, V*>, C>::iterator i = weak_refs.find(key);
-	if (i != weak_refs.end()) {
+	typename map<K, pair<WeakVPtr, V*>, C>::iterator i =
+	  s.weak_refs.find(key);
+	if (i != s.weak_refs.end()) {
 	  val = i->second.first.lock();
 	  if (val) {
-	    lru_add(key, val, &to_release);
+	    lru_add(s, key, val, &to_release);
 	  } else {
 	    retry = true;
 	  }
 	}
 	if (retry)
-	  cond.Wait(lock);
+	  s.cond.Wait(s.lock);
       } while (retry);
-      --waiting;
+      waiting.dec();
+      note_lookup(s, (bool)val, &to_release);
     }
     return val;
   }
   VPtr lookup_or_create(const K &key) {
+    Shard &s = shard(key);
     VPtr val;
     list<VPtr> to_release;
     {
-      Mutex::Locker l(lock);
+      Mutex::Locker l(s.lock);
       bool retry = false;
       do {
 	retry = false;
-	typename map<K, pair<WeakVPtr, V*>, C>::iterator i = weak_refs.find(key);
-	if (i != weak_refs.end()) {
+	typename map<K, pair<WeakVPtr, V*>, C>::iterator i =
+	  s.weak_refs.find(key);
+	if (i != s.weak_refs.end()) {
 	  val = i->second.first.lock();
 	  if (val) {
-	    lru_add(key, val, &to_release);
+	    lru_add(s, key, val, &to_release);
+	    note_lookup(s, true, &to_release);
 	    return val;
 	  } else {
 	    retry = true;
 	  }
 	}
 	if (retry)
-	  cond.Wait(lock);
+	  s.cond.Wait(s.lock);
       } while (retry);
 
+      note_lookup(s, false, &to_release);
       V *new_value = new V();
       VPtr new_val(new_value, Cleanup(this, key));
-      weak_refs.insert(make_pair(key, make_pair(new_val, new_value)));
-      lru_add(key, new_val, &to_release);
+      s.weak_refs.insert(make_pair(key, make_pair(new_val, new_value)));
+      lru_add(s, key, new_val, &to_release);
       return new_val;
     }
   }
@@ -317,8 +489,12 @@ public:
    * in the cache.
    */
   bool empty() {
-    Mutex::Locker l(lock);
-    return weak_refs.empty();
+    for (unsigned i = 0; i < shards.size(); ++i) {
+      Mutex::Locker l(shards[i]->lock);
+      if (!shards[i]->weak_refs.empty())
+	return false;
+    }
+    return true;
   }
 
   /***
@@ -334,25 +510,26 @@ public:
    * @return A reference to the map's value for the given key
    */
   VPtr add(const K& key, V *value, bool *existed = NULL) {
+    Shard &s = shard(key);
     VPtr val;
     list<VPtr> to_release;
     {
-      Mutex::Locker l(lock);
+      Mutex::Locker l(s.lock);
       typename map<K, pair<WeakVPtr, V*>, C>::iterator actual =
-	weak_refs.lower_bound(key);
-      if (actual != weak_refs.end() && actual->first == key) {
-        if (existed) 
+	s.weak_refs.lower_bound(key);
+      if (actual != s.weak_refs.end() && actual->first == key) {
+        if (existed)
           *existed = true;
 
         return actual->second.first.lock();
       }
 
-      if (existed)      
+      if (existed)
         *existed = false;
 
       val = VPtr(value, Cleanup(this, key));
-      weak_refs.insert(actual, make_pair(key, make_pair(val, value)));
-      lru_add(key, val, &to_release);
+      s.weak_refs.insert(actual, make_pair(key, make_pair(val, value)));
+      lru_add(s, key, val, &to_release);
     }
     return val;
   }
@@ -4,8 +4,10 @@
 #include "include/stringify.h"
 #include "CrushTester.h"
 #include "CrushTreeDumper.h"
+#include "common/Thread.h"
 
 #include <algorithm>
+#include <math.h>
 #include <stdlib.h>
 #include <boost/lexical_cast.hpp>
 #include <common/SubProcess.h>
@@ -442,6 +444,194 @@ bool CrushTester::check_name_maps(unsigned max_id) const
   return true;
 }
 
+namespace {
+  /*
+   * simulate the mappings for x in [x_begin, x_end) against ruleno with
+   * numrep replicas, accumulating per-device hit counts, result sizes and
+   * a bad mapping count.  calls crush_do_rule directly with local scratch
+   * space rather than going through CrushWrapper::do_rule, which would
+   * serialize every mapping on the mapper lock; the map itself is
+   * read-only here (the lock only matters for choose profiling, which
+   * the parallel path refuses to run under).
+   */
+  void simulate_mappings(CrushWrapper& crush, int ruleno, int numrep,
+			 int x_begin, int x_end,
+			 const vector<__u32>& weight,
+			 vector<int>& per, map<int,int>& sizes, int& bad)
+  {
+    const crush_map *map = crush.get_crush_map();
+    for (int x = x_begin; x < x_end; x++) {
+      int rawout[numrep];
+      int scratch[numrep * 3];
+      int n = crush_do_rule(map, ruleno, x, rawout, numrep,
+			    &weight[0], weight.size(), scratch);
+      if (n < 0)
+	n = 0;
+      bool has_item_none = false;
+      for (int i = 0; i < n; i++) {
+	if (rawout[i] != CRUSH_ITEM_NONE)
+	  per[rawout[i]]++;
+	else
+	  has_item_none = true;
+      }
+      sizes[n]++;
+      if (n != numrep || has_item_none)
+	bad++;
+    }
+  }
+
+  struct MappingThread : public Thread {
+    CrushWrapper *crush;
+    int ruleno, numrep;
+    int x_begin, x_end;
+    const vector<__u32> *weight;
+    vector<int> per;
+    map<int,int> sizes;
+    int bad;
+
+    MappingThread()
+      : crush(0), ruleno(0), numrep(0), x_begin(0), x_end(0),
+	weight(0), bad(0) {}
+
+    void *entry() {
+      simulate_mappings(*crush, ruleno, numrep, x_begin, x_end,
+			*weight, per, sizes, bad);
+      return 0;
+    }
+  };
+}
+
+void CrushTester::test_rule_parallel(int ruleno, int numrep,
+				     const vector<__u32>& weight)
+{
+  int num_objects_total = (max_x - min_x) + 1;
+  int nthreads = num_threads > 0 ? num_threads : 1;
+
+  int total_weight = 0;
+  for (unsigned i = 0; i < weight.size(); i++)
+    total_weight += weight[i];
+  if (total_weight == 0)
+    return;
+
+  vector<int> per(crush.get_max_devices());
+  map<int,int> sizes;
+  int bad = 0;
+
+  /*
+   * simulate in rounds so we can stop once the observed distribution
+   * stops moving; rounds are large enough that the cost of spawning
+   * the workers each time is noise.
+   */
+  int round_size = num_objects_total;
+  if (convergence_tolerance > 0)
+    round_size = max(1024 * nthreads, num_objects_total / 64);
+
+  vector<float> prev_proportions;
+  int x_done = min_x;
+  bool converged = false;
+  while (x_done <= max_x && !converged) {
+    int x_round_end = min(max_x + 1, x_done + round_size);
+    int share = (x_round_end - x_done + nthreads - 1) / nthreads;
+
+    MappingThread *workers = new MappingThread[nthreads];
+    int launched = 0;
+    for (int i = 0; i < nthreads; i++) {
+      int b = x_done + i * share;
+      int e = min(x_round_end, b + share);
+      if (b >= e)
+	break;
+      workers[i].crush = &crush;
+      workers[i].ruleno = ruleno;
+      workers[i].numrep = numrep;
+      workers[i].x_begin = b;
+      workers[i].x_end = e;
+      workers[i].weight = &weight;
+      workers[i].per.resize(per.size());
+      workers[i].create();
+      launched++;
+    }
+    for (int i = 0; i < launched; i++) {
+      workers[i].join();
+      for (unsigned j = 0; j < per.size(); j++)
+	per[j] += workers[i].per[j];
+      for (map<int,int>::iterator p = workers[i].sizes.begin();
+	   p != workers[i].sizes.end(); ++p)
+	sizes[p->first] += p->second;
+      bad += workers[i].bad;
+    }
+    delete[] workers;
+    x_done = x_round_end;
+
+    if (convergence_tolerance > 0 && x_done <= max_x) {
+      // compare the per-device proportions against the previous round
+      long total = 0;
+      for (unsigned j = 0; j < per.size(); j++)
+	total += per[j];
+      if (total > 0) {
+	vector<float> proportions(per.size());
+	for (unsigned j = 0; j < per.size(); j++)
+	  proportions[j] = (float)per[j] / (float)total;
+	if (!prev_proportions.empty()) {
+	  float worst = 0;
+	  for (unsigned j = 0; j < per.size(); j++)
+	    worst = max(worst, fabsf(proportions[j] - prev_proportions[j]));
+	  if (worst < convergence_tolerance)
+	    converged = true;
+	}
+	prev_proportions.swap(proportions);
+      }
+    }
+  }
+
+  int num_objects = x_done - min_x;
+
+  if (output_statistics && num_objects < num_objects_total)
+    err << "rule " << ruleno << " num_rep " << numrep
+	<< " converged after " << num_objects << "/" << num_objects_total
+	<< " samples" << std::endl;
+
+  // expectations scaled to the number of samples we actually took
+  float expected_objects =
+    min(numrep, get_maximum_affected_by_rule(ruleno)) * (float)num_objects;
+  vector<float> num_objects_expected(per.size());
+  for (unsigned i = 0; i < per.size(); i++)
+    num_objects_expected[i] =
+      ((float)weight[i] / (float)total_weight) * expected_objects;
+
+  for (unsigned i = 0; i < per.size(); i++)
+    if (output_utilization && !output_statistics)
+      err << "  device " << i
+      << ":\t" << per[i] << std::endl;
+
+  for (map<int,int>::iterator p = sizes.begin(); p != sizes.end(); ++p)
+    if (output_statistics)
+      err << "rule " << ruleno << " (" << crush.get_rule_name(ruleno)
+      << ") num_rep " << numrep
+      << " result size == " << p->first << ":\t"
+      << p->second << "/" << num_objects << std::endl;
+
+  if (output_statistics && bad > 0)
+    err << "rule " << ruleno << " num_rep " << numrep
+	<< " bad mappings: " << bad << "/" << num_objects << std::endl;
+
+  if (output_statistics)
+    for (unsigned i = 0; i < per.size(); i++) {
+      if (output_utilization) {
+	if (num_objects_expected[i] > 0 && per[i] > 0) {
+	  err << "  device " << i << ":\t"
+	      << "\t" << " stored " << ": " << per[i]
+	      << "\t" << " expected " << ": " << num_objects_expected[i]
+	      << std::endl;
+	}
+      } else if (output_utilization_all) {
+	err << "  device " << i << ":\t"
+	    << "\t" << " stored " << ": " << per[i]
+	    << "\t" << " expected " << ": " << num_objects_expected[i]
+	    << std::endl;
+      }
+    }
+}
+
 int CrushTester::test()
 {
   if (min_rule < 0 || max_rule < 0) {
@@ -504,6 +694,20 @@ int CrushTester::test()
       << std::endl;
 
     for (int nr = minr; nr <= maxr; nr++) {
+      /*
+       * fast path: fan the simulation out over worker threads, with an
+       * optional statistical early exit.  only the aggregate outputs are
+       * produced there; the per-x output modes and the rng simulator
+       * still need the ordered serial loop below.
+       */
+      if (use_crush &&
+	  (num_threads > 1 || convergence_tolerance > 0) &&
+	  !output_mappings && !output_bad_mappings && !output_data_file &&
+	  !output_choose_tries && num_batches == 1) {
+	test_rule_parallel(r, nr, weight);
+	continue;
+      }
+
       vector<int> per(crush.get_max_devices());
       map<int,int> sizes;
 
@@ -21,6 +21,9 @@ class CrushTester {
   int num_batches;
   bool use_crush;
 
+  int num_threads;
+  float convergence_tolerance;
+
   float mark_down_device_ratio;
   float mark_down_bucket_ratio;
 
@@ -74,6 +77,13 @@ class CrushTester {
    */
   int random_placement(int ruleno, vector<int>& out, int maxout, vector<__u32>& weight);
 
+  /*
+   * Parallel version of the plain statistics loop in test(): fans the value
+   * range out over num_threads workers and, if convergence_tolerance is set,
+   * stops early once the observed per-device distribution stops moving.
+   */
+  void test_rule_parallel(int ruleno, int numrep, const vector<__u32>& weight);
+
   // scaffolding to store data for off-line processing
    struct tester_data_set {
      vector <string> device_utilization;
@@ -172,6 +182,8 @@ public:
       min_rep(-1), max_rep(-1),
       num_batches(1),
       use_crush(true),
+      num_threads(1),
+      convergence_tolerance(0.0),
       mark_down_device_ratio(0.0),
       mark_down_bucket_ratio(1.0),
       output_utilization(false),
@@ -256,6 +268,25 @@ public:
     return num_batches;
   }
 
+  void set_num_threads(int t) {
+    num_threads = t;
+  }
+  int get_num_threads() const {
+    return num_threads;
+  }
+
+  /*
+   * tolerance on the per-device placement proportions; once a simulation
+   * round moves no device by more than this, stop sampling early.
+   * 0 disables the early exit.
+   */
+  void set_convergence_tolerance(float e) {
+    convergence_tolerance = e;
+  }
+  float get_convergence_tolerance() const {
+    return convergence_tolerance;
+  }
+
   void set_random_placement() {
     use_crush = false;
   }
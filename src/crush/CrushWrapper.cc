@@ -200,6 +200,7 @@ bool CrushWrapper::_maybe_remove_last_instance(CephContext *cct, int item, bool
     crush_bucket *t = get_bucket(item);
     ldout(cct, 5) << "_maybe_remove_last_instance removing bucket " << item << dendl;
     crush_remove_bucket(crush, t);
+    have_parent_map = false;
   }
   if ((item >= 0 || !unlink_only) && name_map.count(item)) {
     ldout(cct, 5) << "_maybe_remove_last_instance removing name for item " << item << dendl;
@@ -238,6 +239,7 @@ int CrushWrapper::remove_item(CephContext *cct, int item, bool unlink_only)
 	ldout(cct, 5) << "remove_item removing item " << item
 		      << " from bucket " << b->id << dendl;
 	crush_bucket_remove_item(crush, b, item);
+	have_parent_map = false;
 	adjust_item_weight(cct, b->id, b->weight);
 	ret = 0;
       }
@@ -300,6 +302,7 @@ int CrushWrapper::_remove_item_under(CephContext *cct, int item, int ancestor, b
     if (id == item) {
       ldout(cct, 5) << "_remove_item_under removing item " << item << " from bucket " << b->id << dendl;
       crush_bucket_remove_item(crush, b, item);
+      have_parent_map = false;
       adjust_item_weight(cct, b->id, b->weight);
       ret = 0;
     } else if (id < 0) {
@@ -629,6 +632,7 @@ int CrushWrapper::insert_item(CephContext *cct, int item, float weight, string n
 		  << " to bucket " << id << dendl;
     int r = crush_bucket_add_item(crush, b, cur, 0);
     assert (!r);
+    have_parent_map = false;
     break;
   }
 
@@ -786,18 +790,17 @@ int CrushWrapper::adjust_item_weight(CephContext *cct, int id, int weight)
 {
   ldout(cct, 5) << "adjust_item_weight " << id << " weight " << weight << dendl;
   int changed = 0;
-  for (int bidx = 0; bidx < crush->max_buckets; bidx++) {
-    crush_bucket *b = crush->buckets[bidx];
-    if (b == 0)
+  build_parent_map();
+  pair<multimap<int,int>::iterator, multimap<int,int>::iterator> r =
+    parent_map.equal_range(id);
+  for (multimap<int,int>::iterator p = r.first; p != r.second; ++p) {
+    crush_bucket *b = get_bucket(p->second);
+    if (IS_ERR(b))
       continue;
-    for (unsigned i = 0; i < b->size; i++) {
-      if (b->items[i] == id) {
-	int diff = crush_bucket_adjust_item_weight(crush, b, id, weight);
-	ldout(cct, 5) << "adjust_item_weight " << id << " diff " << diff << " in bucket " << bidx << dendl;
-	adjust_item_weight(cct, -1 - bidx, b->weight);
-	changed++;
-      }
-    }
+    int diff = crush_bucket_adjust_item_weight(crush, b, id, weight);
+    ldout(cct, 5) << "adjust_item_weight " << id << " diff " << diff << " in bucket " << p->second << dendl;
+    adjust_item_weight(cct, p->second, b->weight);
+    changed++;
   }
   if (!changed)
     return -ENOENT;
@@ -74,12 +74,31 @@ private:
       r[p->second] = p->first;
   }
 
+  /* child -> parent bucket edges, so weight adjustments can walk up the
+   * parent chain without scanning every bucket at each level.  built on
+   * demand; invalidated whenever the hierarchy changes (weight changes
+   * leave it alone, so reweight storms pay for one build). */
+  mutable bool have_parent_map;
+  mutable std::multimap<int, int> parent_map;
+  void build_parent_map() const {
+    if (have_parent_map) return;
+    parent_map.clear();
+    for (int bidx = 0; bidx < crush->max_buckets; bidx++) {
+      crush_bucket *b = crush->buckets[bidx];
+      if (b == 0)
+	continue;
+      for (unsigned i = 0; i < b->size; i++)
+	parent_map.insert(make_pair(b->items[i], b->id));
+    }
+    have_parent_map = true;
+  }
+
 public:
   CrushWrapper(const CrushWrapper& other);
   const CrushWrapper& operator=(const CrushWrapper& other);
 
   CrushWrapper() : mapper_lock("CrushWrapper::mapper_lock"),
-		   crush(0), have_rmaps(false) {
+		   crush(0), have_rmaps(false), have_parent_map(false) {
     create();
   }
   ~CrushWrapper() {
@@ -96,6 +115,7 @@ public:
     crush = crush_create();
     assert(crush);
     have_rmaps = false;
+    have_parent_map = false;
 
     set_tunables_default();
   }
@@ -868,6 +888,7 @@ private:
 
       // remove the bucket from the parent
       crush_bucket_remove_item(crush, parent_bucket, item);
+      have_parent_map = false;
     } else if (PTR_ERR(parent_bucket) != -ENOENT) {
       return PTR_ERR(parent_bucket);
     }
@@ -957,6 +978,7 @@ public:
     }
     crush_bucket *b = crush_make_bucket(crush, alg, hash, type, size, items, weights);
     assert(b);
+    have_parent_map = false;
     return crush_add_bucket(crush, bucketno, b, idout);
   }
   
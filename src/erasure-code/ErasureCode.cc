@@ -63,6 +63,29 @@ int ErasureCode::minimum_to_decode_with_cost(const set<int> &want_to_read,
                                              const map<int, int> &available,
                                              set<int> *minimum)
 {
+  // grow a candidate set in order of increasing cost and settle on the
+  // first one the code can satisfy the read from, so that expensive
+  // chunks are left out whenever a cheaper set can stand in for them
+  vector<pair<int, int> > by_cost;
+  for (map<int, int>::const_iterator i = available.begin();
+       i != available.end();
+       ++i)
+    by_cost.push_back(make_pair(i->second, i->first));
+  sort(by_cost.begin(), by_cost.end());
+
+  set<int> candidates;
+  for (vector<pair<int, int> >::iterator i = by_cost.begin();
+       i != by_cost.end();
+       ++i) {
+    candidates.insert(i->second);
+    if (candidates.size() < get_data_chunk_count() &&
+	!includes(candidates.begin(), candidates.end(),
+		  want_to_read.begin(), want_to_read.end()))
+      continue;
+    if (minimum_to_decode(want_to_read, candidates, minimum) == 0)
+      return 0;
+    minimum->clear();
+  }
   set <int> available_chunks;
   for (map<int, int>::const_iterator i = available.begin();
        i != available.end();
@@ -79,25 +102,53 @@ int ErasureCode::encode_prepare(const bufferlist &raw,
   unsigned blocksize = get_chunk_size(raw.length());
   unsigned padded_chunks = k - raw.length() / blocksize;
   bufferlist prepared = raw;
+  unsigned misaligned = 0;
 
   for (unsigned int i = 0; i < k - padded_chunks; i++) {
     bufferlist &chunk = encoded[chunk_index(i)];
     chunk.substr_of(prepared, i * blocksize, blocksize);
-    chunk.rebuild_aligned_size_and_memory(blocksize, SIMD_ALIGN);
-    assert(chunk.is_contiguous());
+    if (!chunk.is_contiguous() || !chunk.is_aligned(SIMD_ALIGN))
+      misaligned++;
   }
-  if (padded_chunks) {
-    unsigned remainder = raw.length() - (k - padded_chunks) * blocksize;
-    bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
+  if (misaligned && blocksize % SIMD_ALIGN == 0) {
+    // some chunks have to be copied to get contiguous aligned memory
+    // anyway (in practice an unaligned input misaligns all of them), so
+    // gather the whole input into a single aligned arena in one pass
+    // and hand out refs into it, instead of allocating and rebuilding
+    // every chunk on its own.  the padded tail is zeroed in place, so
+    // this is the only copy there is.
+    bufferptr arena(buffer::create_aligned(blocksize * k, SIMD_ALIGN));
+    raw.copy(0, raw.length(), arena.c_str());
+    if (raw.length() < blocksize * k)
+      arena.zero(raw.length(), blocksize * k - raw.length());
+    for (unsigned int i = 0; i < k; i++) {
+      bufferlist &chunk = encoded[chunk_index(i)];
+      chunk.clear();
+      chunk.push_back(bufferptr(arena, i * blocksize, blocksize));
+    }
+  } else {
+    if (misaligned) {
+      // blocksize is not a SIMD_ALIGN multiple, so interior offsets of
+      // a shared arena would not be aligned; rebuild chunk by chunk
+      for (unsigned int i = 0; i < k - padded_chunks; i++) {
+	bufferlist &chunk = encoded[chunk_index(i)];
+	chunk.rebuild_aligned_size_and_memory(blocksize, SIMD_ALIGN);
+	assert(chunk.is_contiguous());
+      }
+    }
+    if (padded_chunks) {
+      unsigned remainder = raw.length() - (k - padded_chunks) * blocksize;
+      bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
 
-    raw.copy((k - padded_chunks) * blocksize, remainder, buf.c_str());
-    buf.zero(remainder, blocksize - remainder);
-    encoded[chunk_index(k-padded_chunks)].push_back(buf);
+      raw.copy((k - padded_chunks) * blocksize, remainder, buf.c_str());
+      buf.zero(remainder, blocksize - remainder);
+      encoded[chunk_index(k-padded_chunks)].push_back(buf);
 
-    for (unsigned int i = k - padded_chunks + 1; i < k; i++) {
-      bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
-      buf.zero();
-      encoded[chunk_index(i)].push_back(buf);
+      for (unsigned int i = k - padded_chunks + 1; i < k; i++) {
+	bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
+	buf.zero();
+	encoded[chunk_index(i)].push_back(buf);
+      }
     }
   }
   for (unsigned int i = k; i < k + m; i++) {
@@ -125,6 +125,7 @@ private:
    * an abstract raw buffer.  with a reference count.
    */
   class raw;
+  class raw_combined;
   class raw_malloc;
   class raw_static;
   class raw_mmap_pages;
@@ -238,6 +239,7 @@ public:
     unsigned append(char c);
     unsigned append(const char *p, unsigned l);
     void copy_in(unsigned o, unsigned l, const char *src, bool crc_reset = true);
+    void invalidate_crc();
     void zero(bool crc_reset = true);
     void zero(unsigned o, unsigned l, bool crc_reset = true);
 
@@ -451,7 +453,17 @@ public:
     void append(const list& bl);
     void append(std::istream& in);
     void append_zero(unsigned len);
-    
+
+    /// reserve len contiguous bytes at the tail of the list and return
+    /// a raw cursor over them, so a run of small fixed-size appends is
+    /// bounds-checked once here instead of per field.  write at most
+    /// len bytes through the cursor, then commit them with
+    /// append_reserved(); no other append may touch the list in
+    /// between.
+    char *reserve_contiguous(unsigned len);
+    /// commit len bytes written through a reserve_contiguous() cursor
+    void append_reserved(unsigned len);
+
     /*
      * get a char
      */
@@ -68,6 +68,7 @@
 #define CEPH_FEATURE_OSD_PROXY_WRITE_FEATURES (1ULL<<52)
 #define CEPH_FEATURE_ERASURE_CODE_PLUGINS_V3 (1ULL<<53)
 #define CEPH_FEATURE_OSD_HITSET_GMT (1ULL<<54)
+#define CEPH_FEATURE_MSG_DATA_COMPRESS (1ULL<<55) /* peer can decompress msg data */
 
 #define CEPH_FEATURE_RESERVED2 (1ULL<<61)  /* slow down, we are almost out... */
 #define CEPH_FEATURE_RESERVED  (1ULL<<62)  /* DO NOT USE THIS ... last bit! */
@@ -158,6 +159,7 @@ static inline unsigned long long ceph_sanitize_features(unsigned long long f) {
          CEPH_FEATURE_ERASURE_CODE_PLUGINS_V3 |   \
          CEPH_FEATURE_OSD_PROXY_WRITE_FEATURES |         \
      CEPH_FEATURE_OSD_HITSET_GMT |                       \
+	 CEPH_FEATURE_MSG_DATA_COMPRESS |		 \
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
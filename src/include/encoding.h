@@ -105,6 +105,51 @@ WRITE_INTTYPE_ENCODER(int32_t, le32)
 WRITE_INTTYPE_ENCODER(uint16_t, le16)
 WRITE_INTTYPE_ENCODER(int16_t, le16)
 
+// -----------------------------------
+// reserved contiguous encoding
+//
+// A run of small fixed-size fields pays a bounds check (and possibly
+// an allocation) in bufferlist::append() per field.  When the total
+// size of the run is known up front, reserve it once and store
+// straight into the buffer instead.  The reservation is committed
+// when the encoder goes out of scope, so keep its scope inside the
+// surrounding ENCODE_START/ENCODE_FINISH pair and do not append to
+// the bufferlist through any other path while it is live.
+
+class contiguous_encoder {
+  bufferlist &bl;
+  char *start, *pos;
+public:
+  contiguous_encoder(bufferlist& bl_, unsigned len)
+    : bl(bl_), start(bl_.reserve_contiguous(len)), pos(start) {}
+  ~contiguous_encoder() {
+    bl.append_reserved(pos - start);
+  }
+  template<class T>
+  void put_raw(const T& t) {
+    memcpy(pos, (const char *)&t, sizeof(t));
+    pos += sizeof(t);
+  }
+  void put_u8(__u8 v) {
+    put_raw(v);
+  }
+  void put_le16(uint16_t v) {
+    ceph_le16 e;
+    e = v;
+    put_raw(e);
+  }
+  void put_le32(uint32_t v) {
+    ceph_le32 e;
+    e = v;
+    put_raw(e);
+  }
+  void put_le64(uint64_t v) {
+    ceph_le64 e;
+    e = v;
+    put_raw(e);
+  }
+};
+
 #ifdef ENCODE_DUMP
 # include <stdio.h>
 # include <sys/types.h>
@@ -0,0 +1,169 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Red Hat
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_FLAT_MAP_H
+#define CEPH_FLAT_MAP_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "encoding.h"
+
+/**
+ * flat_map_t - sorted-vector map
+ *
+ * A minimal std::map lookalike backed by a single sorted vector.  It
+ * implements just enough of the map interface to serve as an
+ * interval_set backend: lookups are a binary search over contiguous
+ * memory and the whole map is one allocation, which beats the
+ * node-per-entry rbtree when maps are small and copied often (the
+ * common case for per-op extent sets).  Insert/erase are O(n), so it
+ * is a poor fit for large maps with heavy middle churn -- those should
+ * stay on std::map.
+ *
+ * Unlike std::map, insertion and erasure invalidate iterators.
+ * value_type is pair<K,V>, not pair<const K,V>; callers must not
+ * modify keys through iterators.
+ *
+ * The encoders below produce the same byte stream as the std::map
+ * encoders in encoding.h, so switching backends never changes an
+ * on-wire or on-disk format.
+ */
+template<typename K, typename V>
+class flat_map_t {
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K,V> value_type;
+
+private:
+  typedef std::vector<value_type> vec_t;
+  vec_t v;
+
+  struct key_less {
+    bool operator()(const value_type& p, const K& k) const {
+      return p.first < k;
+    }
+  };
+
+public:
+  typedef typename vec_t::iterator iterator;
+  typedef typename vec_t::const_iterator const_iterator;
+
+  iterator begin() { return v.begin(); }
+  iterator end() { return v.end(); }
+  const_iterator begin() const { return v.begin(); }
+  const_iterator end() const { return v.end(); }
+
+  size_t size() const { return v.size(); }
+  bool empty() const { return v.empty(); }
+  void clear() { v.clear(); }
+  void swap(flat_map_t& other) { v.swap(other.v); }
+  void reserve(size_t n) { v.reserve(n); }
+
+  bool operator==(const flat_map_t& other) const {
+    return v == other.v;
+  }
+
+  iterator lower_bound(const K& k) {
+    return std::lower_bound(v.begin(), v.end(), k, key_less());
+  }
+  const_iterator lower_bound(const K& k) const {
+    return std::lower_bound(v.begin(), v.end(), k, key_less());
+  }
+
+  iterator find(const K& k) {
+    iterator p = lower_bound(k);
+    if (p != v.end() && p->first == k)
+      return p;
+    return v.end();
+  }
+  const_iterator find(const K& k) const {
+    const_iterator p = lower_bound(k);
+    if (p != v.end() && p->first == k)
+      return p;
+    return v.end();
+  }
+
+  size_t count(const K& k) const {
+    return find(k) != v.end() ? 1 : 0;
+  }
+
+  V& operator[](const K& k) {
+    iterator p = lower_bound(k);
+    if (p == v.end() || p->first != k)
+      p = v.insert(p, value_type(k, V()));
+    return p->second;
+  }
+
+  void erase(iterator p) {
+    v.erase(p);
+  }
+  size_t erase(const K& k) {
+    iterator p = find(k);
+    if (p == v.end())
+      return 0;
+    v.erase(p);
+    return 1;
+  }
+};
+
+// match the std::map encoding in encoding.h byte for byte
+template<typename K, typename V>
+inline void encode(const flat_map_t<K,V>& m, bufferlist& bl)
+{
+  __u32 n = (__u32)(m.size());
+  encode(n, bl);
+  for (typename flat_map_t<K,V>::const_iterator p = m.begin();
+       p != m.end(); ++p) {
+    encode(p->first, bl);
+    encode(p->second, bl);
+  }
+}
+template<typename K, typename V>
+inline void encode_nohead(const flat_map_t<K,V>& m, bufferlist& bl)
+{
+  for (typename flat_map_t<K,V>::const_iterator p = m.begin();
+       p != m.end(); ++p) {
+    encode(p->first, bl);
+    encode(p->second, bl);
+  }
+}
+template<typename K, typename V>
+inline void decode(flat_map_t<K,V>& m, bufferlist::iterator& p)
+{
+  __u32 n;
+  decode(n, p);
+  m.clear();
+  m.reserve(n);
+  while (n--) {
+    K k;
+    decode(k, p);
+    decode(m[k], p);
+  }
+}
+template<typename K, typename V>
+inline void decode_nohead(int n, flat_map_t<K,V>& m, bufferlist::iterator& p)
+{
+  m.clear();
+  m.reserve(n);
+  while (n--) {
+    K k;
+    decode(k, p);
+    decode(m[k], p);
+  }
+}
+
+#endif
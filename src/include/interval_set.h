@@ -1,4 +1,4 @@
-// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*- 
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 /*
  * Ceph - scalable distributed file system
@@ -7,9 +7,9 @@
  *
  * This is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Lesser General Public
- * License version 2.1, as published by the Free Software 
+ * License version 2.1, as published by the Free Software
  * Foundation.  See file COPYING.
- * 
+ *
  */
 
 
@@ -22,6 +22,8 @@
 using namespace std;
 
 #include "encoding.h"
+#include "flat_map.h"   // alternate backend; must precede the templates
+                        // below so its encoders are visible to them
 
 #ifndef MIN
 # define MIN(a,b)  ((a)<=(b) ? (a):(b))
@@ -31,7 +33,14 @@ using namespace std;
 #endif
 
 
-template<typename T>
+/*
+ * The backing container is pluggable: any sorted start->len map with a
+ * std::map-like interface works.  std::map is the default; sets that
+ * stay small and are copied a lot (e.g. per-op modified ranges) can use
+ * flat_map_t to keep all intervals in one contiguous allocation.  The
+ * wire encoding is identical for every backend.
+ */
+template<typename T, typename Map = std::map<T,T> >
 class interval_set {
  public:
 
@@ -40,7 +49,7 @@ class interval_set {
   class iterator : public std::iterator <std::forward_iterator_tag, T>
   {
     public:
-        explicit iterator(typename std::map<T,T>::iterator iter)
+        explicit iterator(typename Map::iterator iter)
           : _iter(iter)
         { }
 
@@ -90,17 +99,17 @@ class interval_set {
                 return prev;
         }
 
-    friend class interval_set<T>::const_iterator;
+    friend class interval_set<T,Map>::const_iterator;
 
     protected:
-        typename map<T,T>::iterator _iter;
-    friend class interval_set<T>;
+        typename Map::iterator _iter;
+    friend class interval_set<T,Map>;
   };
 
   class const_iterator : public std::iterator <std::forward_iterator_tag, T>
   {
     public:
-        explicit const_iterator(typename std::map<T,T>::const_iterator iter)
+        explicit const_iterator(typename Map::const_iterator iter)
           : _iter(iter)
         { }
 
@@ -150,7 +159,7 @@ class interval_set {
         }
 
     protected:
-        typename map<T,T>::const_iterator _iter;
+        typename Map::const_iterator _iter;
   };
 
   interval_set() : _size(0) {}
@@ -160,26 +169,26 @@ class interval_set {
     return m.size();
   }
 
-  typename interval_set<T>::iterator begin() {
-    return typename interval_set<T>::iterator(m.begin());
+  typename interval_set<T,Map>::iterator begin() {
+    return typename interval_set<T,Map>::iterator(m.begin());
   }
 
-  typename interval_set<T>::iterator end() {
-    return typename interval_set<T>::iterator(m.end());
+  typename interval_set<T,Map>::iterator end() {
+    return typename interval_set<T,Map>::iterator(m.end());
   }
 
-  typename interval_set<T>::const_iterator begin() const {
-    return typename interval_set<T>::const_iterator(m.begin());
+  typename interval_set<T,Map>::const_iterator begin() const {
+    return typename interval_set<T,Map>::const_iterator(m.begin());
   }
 
-  typename interval_set<T>::const_iterator end() const {
-    return typename interval_set<T>::const_iterator(m.end());
+  typename interval_set<T,Map>::const_iterator end() const {
+    return typename interval_set<T,Map>::const_iterator(m.end());
   }
 
   // helpers
  private:
-  typename map<T,T>::const_iterator find_inc(T start) const {
-    typename map<T,T>::const_iterator p = m.lower_bound(start);  // p->first >= start
+  typename Map::const_iterator find_inc(T start) const {
+    typename Map::const_iterator p = m.lower_bound(start);  // p->first >= start
     if (p != m.begin() &&
         (p == m.end() || p->first > start)) {
       p--;   // might overlap?
@@ -188,9 +197,9 @@ class interval_set {
     }
     return p;
   }
-  
-  typename map<T,T>::iterator find_inc_m(T start) {
-    typename map<T,T>::iterator p = m.lower_bound(start);
+
+  typename Map::iterator find_inc_m(T start) {
+    typename Map::iterator p = m.lower_bound(start);
     if (p != m.begin() &&
         (p == m.end() || p->first > start)) {
       p--;   // might overlap?
@@ -199,9 +208,9 @@ class interval_set {
     }
     return p;
   }
-  
-  typename map<T,T>::const_iterator find_adj(T start) const {
-    typename map<T,T>::const_iterator p = m.lower_bound(start);
+
+  typename Map::const_iterator find_adj(T start) const {
+    typename Map::const_iterator p = m.lower_bound(start);
     if (p != m.begin() &&
         (p == m.end() || p->first > start)) {
       p--;   // might touch?
@@ -210,9 +219,9 @@ class interval_set {
     }
     return p;
   }
-  
-  typename map<T,T>::iterator find_adj_m(T start) {
-    typename map<T,T>::iterator p = m.lower_bound(start);
+
+  typename Map::iterator find_adj_m(T start) {
+    typename Map::iterator p = m.lower_bound(start);
     if (p != m.begin() &&
         (p == m.end() || p->first > start)) {
       p--;   // might touch?
@@ -221,7 +230,11 @@ class interval_set {
     }
     return p;
   }
-  
+
+  // other backends of the same interval type may poke at our m
+  // (intersection_of and friends work across backends)
+  template<typename U, typename M> friend class interval_set;
+
  public:
   bool operator==(const interval_set& other) const {
     return _size == other._size && m == other.m;
@@ -240,7 +253,7 @@ class interval_set {
   void decode(bufferlist::iterator& bl) {
     ::decode(m, bl);
     _size = 0;
-    for (typename map<T,T>::const_iterator p = m.begin();
+    for (typename Map::const_iterator p = m.begin();
          p != m.end();
          p++)
       _size += p->second;
@@ -248,7 +261,7 @@ class interval_set {
   void decode_nohead(int n, bufferlist::iterator& bl) {
     ::decode_nohead(n, m, bl);
     _size = 0;
-    for (typename map<T,T>::const_iterator p = m.begin();
+    for (typename Map::const_iterator p = m.begin();
          p != m.end();
          p++)
       _size += p->second;
@@ -260,7 +273,7 @@ class interval_set {
   }
 
   bool contains(T i) const {
-    typename map<T,T>::const_iterator p = find_inc(i);
+    typename Map::const_iterator p = find_inc(i);
     if (p == m.end()) return false;
     if (p->first > i) return false;
     if (p->first+p->second <= i) return false;
@@ -268,7 +281,7 @@ class interval_set {
     return true;
   }
   bool contains(T start, T len) const {
-    typename map<T,T>::const_iterator p = find_inc(start);
+    typename Map::const_iterator p = find_inc(start);
     if (p == m.end()) return false;
     if (p->first > start) return false;
     if (p->first+p->second <= start) return false;
@@ -291,12 +304,12 @@ class interval_set {
   }
   T range_start() const {
     assert(!empty());
-    typename map<T,T>::const_iterator p = m.begin();
+    typename Map::const_iterator p = m.begin();
     return p->first;
   }
   T range_end() const {
     assert(!empty());
-    typename map<T,T>::const_iterator p = m.end();
+    typename Map::const_iterator p = m.end();
     p--;
     return p->first+p->second;
   }
@@ -304,23 +317,23 @@ class interval_set {
   // interval start after p (where p not in set)
   bool starts_after(T i) const {
     assert(!contains(i));
-    typename map<T,T>::const_iterator p = find_inc(i);
+    typename Map::const_iterator p = find_inc(i);
     if (p == m.end()) return false;
     return true;
   }
   T start_after(T i) const {
     assert(!contains(i));
-    typename map<T,T>::const_iterator p = find_inc(i);
+    typename Map::const_iterator p = find_inc(i);
     return p->first;
   }
 
   // interval end that contains start
   T end_after(T start) const {
     assert(contains(start));
-    typename map<T,T>::const_iterator p = find_inc(start);
+    typename Map::const_iterator p = find_inc(start);
     return p->first+p->second;
   }
-  
+
   void insert(T val) {
     insert(val, 1);
   }
@@ -329,31 +342,34 @@ class interval_set {
     //cout << "insert " << start << "~" << len << endl;
     assert(len > 0);
     _size += len;
-    typename map<T,T>::iterator p = find_adj_m(start);
+    typename Map::iterator p = find_adj_m(start);
     if (p == m.end()) {
       m[start] = len;                  // new interval
     } else {
       if (p->first < start) {
-        
+
         if (p->first + p->second != start) {
           //cout << "p is " << p->first << "~" << p->second << ", start is " << start << ", len is " << len << endl;
           assert(0);
         }
-        
+
         assert(p->first + p->second == start);
         p->second += len;               // append to end
-        
-        typename map<T,T>::iterator n = p;
+
+        typename Map::iterator n = p;
         n++;
-        if (n != m.end() && 
+        if (n != m.end() &&
             start+len == n->first) {   // combine with next, too!
           p->second += n->second;
           m.erase(n);
         }
       } else {
         if (start+len == p->first) {
-          m[start] = len + p->second;  // append to front 
+          // append to front; erase before re-inserting so a vector-backed
+          // Map never sees p after an insertion invalidates it
+          T nl = len + p->second;
           m.erase(p);
+          m[start] = nl;
         } else {
           assert(p->first > start+len);
           m[start] = len;              // new interval
@@ -362,13 +378,13 @@ class interval_set {
     }
   }
 
-  void swap(interval_set<T>& other) {
+  void swap(interval_set<T,Map>& other) {
     m.swap(other.m);
     int64_t t = _size;
     _size = other._size;
     other._size = t;
-  }    
-  
+  }
+
   void erase(iterator &i) {
     _size -= i.get_len();
     assert(_size >= 0);
@@ -380,7 +396,7 @@ class interval_set {
   }
 
   void erase(T start, T len) {
-    typename map<T,T>::iterator p = find_inc_m(start);
+    typename Map::iterator p = find_inc_m(start);
 
     _size -= len;
     assert(_size >= 0);
@@ -391,8 +407,8 @@ class interval_set {
     T before = start - p->first;
     assert(p->second >= before+len);
     T after = p->second - before - len;
-    
-    if (before) 
+
+    if (before)
       p->second = before;        // shorten bit before
     else
       m.erase(p);
@@ -401,34 +417,37 @@ class interval_set {
   }
 
 
-  void subtract(const interval_set &a) {
-    for (typename map<T,T>::const_iterator p = a.m.begin();
+  template<typename M2>
+  void subtract(const interval_set<T,M2> &a) {
+    for (typename M2::const_iterator p = a.m.begin();
          p != a.m.end();
          p++)
       erase(p->first, p->second);
   }
 
-  void insert(const interval_set &a) {
-    for (typename map<T,T>::const_iterator p = a.m.begin();
+  template<typename M2>
+  void insert(const interval_set<T,M2> &a) {
+    for (typename M2::const_iterator p = a.m.begin();
          p != a.m.end();
          p++)
       insert(p->first, p->second);
   }
 
 
-  void intersection_of(const interval_set &a, const interval_set &b) {
-    assert(&a != this);
-    assert(&b != this);
+  template<typename M1, typename M2>
+  void intersection_of(const interval_set<T,M1> &a, const interval_set<T,M2> &b) {
+    assert((const void*)&a != (const void*)this);
+    assert((const void*)&b != (const void*)this);
     clear();
 
-    typename map<T,T>::const_iterator pa = a.m.begin();
-    typename map<T,T>::const_iterator pb = b.m.begin();
-    
+    typename M1::const_iterator pa = a.m.begin();
+    typename M2::const_iterator pb = b.m.begin();
+
     while (pa != a.m.end() && pb != b.m.end()) {
       // passing?
-      if (pa->first + pa->second <= pb->first) 
+      if (pa->first + pa->second <= pb->first)
         { pa++;  continue; }
-      if (pb->first + pb->second <= pa->first) 
+      if (pb->first + pb->second <= pa->first)
         { pb++;  continue; }
       T start = MAX(pa->first, pb->first);
       T en = MIN(pa->first+pa->second, pb->first+pb->second);
@@ -437,25 +456,26 @@ class interval_set {
       if (pa->first+pa->second > pb->first+pb->second)
         pb++;
       else
-        pa++; 
+        pa++;
     }
   }
-  void intersection_of(const interval_set& b) {
+  template<typename M2>
+  void intersection_of(const interval_set<T,M2>& b) {
     interval_set a;
     swap(a);
     intersection_of(a, b);
   }
 
-  void union_of(const interval_set &a, const interval_set &b) {
-    assert(&a != this);
-    assert(&b != this);
+  template<typename M1, typename M2>
+  void union_of(const interval_set<T,M1> &a, const interval_set<T,M2> &b) {
+    assert((const void*)&a != (const void*)this);
+    assert((const void*)&b != (const void*)this);
     clear();
-    
+
     //cout << "union_of" << endl;
 
     // a
-    m = a.m;
-    _size = a._size;
+    insert(a);
 
     // - (a*b)
     interval_set ab;
@@ -466,28 +486,31 @@ class interval_set {
     insert(b);
     return;
   }
-  void union_of(const interval_set &b) {
+  template<typename M2>
+  void union_of(const interval_set<T,M2> &b) {
     interval_set a;
-    swap(a);    
+    swap(a);
     union_of(a, b);
   }
 
-  bool subset_of(const interval_set &big) const {
-    for (typename map<T,T>::const_iterator i = m.begin();
+  template<typename M2>
+  bool subset_of(const interval_set<T,M2> &big) const {
+    for (typename Map::const_iterator i = m.begin();
          i != m.end();
-         i++) 
+         i++)
       if (!big.contains(i->first, i->second)) return false;
     return true;
-  }  
+  }
 
   /*
    * build a subset of @other, starting at or after @start, and including
    * @len worth of values, skipping holes.  e.g.,
    *  span_of([5~10,20~5], 8, 5) -> [8~2,20~3]
    */
-  void span_of(const interval_set &other, T start, T len) {
+  template<typename M2>
+  void span_of(const interval_set<T,M2> &other, T start, T len) {
     clear();
-    typename map<T,T>::const_iterator p = other.find_inc(start);
+    typename M2::const_iterator p = other.find_inc(start);
     if (p == other.m.end())
       return;
     if (p->first < start) {
@@ -518,15 +541,15 @@ class interval_set {
 private:
   // data
   int64_t _size;
-  map<T,T> m;   // map start -> len
+  Map m;   // map start -> len
 };
 
 
-template<class T>
-inline ostream& operator<<(ostream& out, const interval_set<T> &s) {
+template<class T, class Map>
+inline ostream& operator<<(ostream& out, const interval_set<T,Map> &s) {
   out << "[";
   const char *prequel = "";
-  for (typename interval_set<T>::const_iterator i = s.begin();
+  for (typename interval_set<T,Map>::const_iterator i = s.begin();
        i != s.end();
        ++i)
   {
@@ -537,13 +560,13 @@ inline ostream& operator<<(ostream& out, const interval_set<T> &s) {
   return out;
 }
 
-template<class T>
-inline void encode(const interval_set<T>& s, bufferlist& bl)
+template<class T, class Map>
+inline void encode(const interval_set<T,Map>& s, bufferlist& bl)
 {
   s.encode(bl);
 }
-template<class T>
-inline void decode(interval_set<T>& s, bufferlist::iterator& p)
+template<class T, class Map>
+inline void decode(interval_set<T,Map>& s, bufferlist::iterator& p)
 {
   s.decode(p);
 }
@@ -1853,6 +1853,30 @@ CEPH_RADOS_API int rados_aio_stat(rados_ioctx_t io, const char *o,
 		                  rados_completion_t completion,
 		                  uint64_t *psize, time_t *pmtime);
 
+/**
+ * Asynchronously get object stats (size/mtime) for a batch of objects
+ *
+ * The completion fires once all the stats have completed; its return
+ * value is 0 or the first error encountered.  Per-object results are
+ * stored into prvals, so individual missing objects (-ENOENT) can be
+ * told apart without one completion per object.
+ *
+ * @param io ioctx
+ * @param completion what to do when the batch is complete
+ * @param oids object names
+ * @param num_oids number of objects
+ * @param psizes where to store object sizes, one per object
+ * @param pmtimes where to store modification times, one per object
+ * @param prvals where to store per-object results, one per object
+ * @returns 0 on success, negative error code on failure
+ */
+CEPH_RADOS_API int rados_aio_stat_batch(rados_ioctx_t io,
+                                        rados_completion_t completion,
+                                        const char * const *oids,
+                                        size_t num_oids,
+                                        uint64_t *psizes, time_t *pmtimes,
+                                        int *prvals);
+
 /**
  * Cancel async operation
  *
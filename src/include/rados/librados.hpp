@@ -943,6 +943,27 @@ namespace librados
 		    ObjectReadOperation *op, int flags,
 		    bufferlist *pbl);
 
+    /**
+     * Schedule a batch of read operations, one per object, sharing a
+     * single completion
+     *
+     * Results are delivered through the out parameters bound into each
+     * ObjectReadOperation.  The completion fires once every operation
+     * in the batch has completed, and its return value is 0 or the
+     * first error encountered.  This is much cheaper than one
+     * completion per object when scanning metadata (stat, xattrs,
+     * omap) across many objects.
+     *
+     * @param ops the objects and the operation to perform on each; the
+     *            operations must remain valid until this call returns
+     * @param c what to do when the operations are complete
+     * @param flags operation flags (librados::OPERATION_*)
+     * @returns 0 on success, negative error code on failure
+     */
+    int aio_operate_many(
+      const std::vector<std::pair<std::string, ObjectReadOperation*> >& ops,
+      AioCompletion *c, int flags=0);
+
     // watch/notify
     int watch2(const std::string& o, uint64_t *handle,
 	       librados::WatchCtx2 *ctx);
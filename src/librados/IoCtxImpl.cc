@@ -106,7 +106,8 @@ void librados::IoCtxImpl::complete_aio_write(AioCompletionImpl *c)
     ldout(client->cct, 20) << " waking waiters on seq " << waiters->first << dendl;
     for (std::list<AioCompletionImpl*>::iterator it = waiters->second.begin();
 	 it != waiters->second.end(); ++it) {
-      client->finisher.queue(new C_AioCompleteAndSafe(*it));
+      client->finisher.queue((uint64_t)(uintptr_t)*it,
+			     new C_AioCompleteAndSafe(*it));
       (*it)->put();
     }
     aio_write_waiters.erase(waiters++);
@@ -126,7 +127,7 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
   if (aio_write_list.empty()) {
     ldout(client->cct, 20) << "flush_aio_writes_async no writes. (tid "
 			   << seq << ")" << dendl;
-    client->finisher.queue(new C_AioCompleteAndSafe(c));
+    client->finisher.queue((uint64_t)(uintptr_t)c, new C_AioCompleteAndSafe(c));
   } else {
     ldout(client->cct, 20) << "flush_aio_writes_async " << aio_write_list.size()
 			   << " writes in flight; waiting on tid " << seq << dendl;
@@ -585,6 +586,40 @@ int librados::IoCtxImpl::aio_operate_read(const object_t &oid,
   return 0;
 }
 
+int librados::IoCtxImpl::aio_operate_read_many(
+  const vector<pair<object_t, ::ObjectOperation*> >& ops,
+  AioCompletionImpl *c, int flags)
+{
+  if (ops.empty())
+    return -EINVAL;
+
+  c->is_read = true;
+  c->io = this;
+
+  // all reads share one completion.  per-op results are delivered
+  // through the out params bound into each ObjectOperation; the
+  // completion's return value is 0 or the first error.
+  C_GatherBuilder gather(client->cct, new C_aio_Ack(c));
+  std::list<Objecter::Op*> prepared;
+  for (vector<pair<object_t, ::ObjectOperation*> >::const_iterator p = ops.begin();
+       p != ops.end();
+       ++p) {
+    prepared.push_back(objecter->prepare_read_op(p->first, oloc, *p->second,
+						 snap_seq, NULL, flags,
+						 gather.new_sub()));
+  }
+  gather.activate();
+
+  for (std::list<Objecter::Op*>::iterator p = prepared.begin();
+       p != prepared.end();
+       ++p) {
+    // note: c->tid ends up as the last op, so aio_cancel() on a batch is
+    // best effort only
+    c->tid = objecter->op_submit(*p);
+  }
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_operate(const object_t& oid,
 				     ::ObjectOperation *o, AioCompletionImpl *c,
 				     const SnapContext& snap_context, int flags)
@@ -1316,10 +1351,10 @@ void librados::IoCtxImpl::C_aio_Ack::finish(int r)
   }
 
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->finisher.queue((uint64_t)(uintptr_t)c, new C_AioComplete(c));
   }
   if (c->is_read && c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioSafe(c));
+    c->io->client->finisher.queue((uint64_t)(uintptr_t)c, new C_AioSafe(c));
   }
 
   c->put_unlock();
@@ -1346,7 +1381,7 @@ void librados::IoCtxImpl::C_aio_stat_Ack::finish(int r)
   }
 
   if (c->callback_complete) {
-    c->io->client->finisher.queue(new C_AioComplete(c));
+    c->io->client->finisher.queue((uint64_t)(uintptr_t)c, new C_AioComplete(c));
   }
 
   c->put_unlock();
@@ -1370,7 +1405,7 @@ void librados::IoCtxImpl::C_aio_Safe::finish(int r)
   c->cond.Signal();
 
   if (c->callback_safe) {
-    c->io->client->finisher.queue(new C_AioSafe(c));
+    c->io->client->finisher.queue((uint64_t)(uintptr_t)c, new C_AioSafe(c));
   }
 
   c->io->complete_aio_write(c);
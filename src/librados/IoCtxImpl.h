@@ -149,6 +149,9 @@ struct librados::IoCtxImpl {
 		  int flags);
   int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
 		       AioCompletionImpl *c, int flags, bufferlist *pbl);
+  int aio_operate_read_many(
+    const std::vector<std::pair<object_t, ::ObjectOperation*> >& ops,
+    AioCompletionImpl *c, int flags);
 
   struct C_aio_Ack : public Context {
     librados::AioCompletionImpl *c;
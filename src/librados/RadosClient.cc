@@ -77,7 +77,7 @@ librados::RadosClient::RadosClient(CephContext *cct_)
     timer(cct, lock),
     refcnt(1),
     log_last_version(0), log_cb(NULL), log_cb_arg(NULL),
-    finisher(cct)
+    finisher(cct, "radosclient", cct->_conf->rados_finisher_shards)
 {
 }
 
@@ -223,7 +223,7 @@ int librados::RadosClient::connect()
 
   err = -ENOMEM;
   objecter = new (std::nothrow) Objecter(cct, messenger, &monclient,
-			  &finisher,
+			  finisher.get_shard(0),
 			  cct->_conf->rados_mon_op_timeout,
 			  cct->_conf->rados_osd_op_timeout);
   if (!objecter)
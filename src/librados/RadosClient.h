@@ -15,6 +15,7 @@
 #define CEPH_LIBRADOS_RADOSCLIENT_H
 
 #include "common/Cond.h"
+#include "common/Finisher.h"
 #include "common/Mutex.h"
 #include "common/RWLock.h"
 #include "common/Timer.h"
@@ -73,7 +74,7 @@ private:
   int wait_for_osdmap();
 
 public:
-  Finisher finisher;
+  ShardedFinisher finisher;
 
   RadosClient(CephContext *cct_);
   ~RadosClient();
@@ -1402,6 +1402,22 @@ int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				       translate_flags(flags), pbl);
 }
 
+int librados::IoCtx::aio_operate_many(
+  const std::vector<std::pair<std::string, ObjectReadOperation*> >& ops,
+  AioCompletion *c, int flags)
+{
+  vector<pair<object_t, ::ObjectOperation*> > obj_ops;
+  obj_ops.reserve(ops.size());
+  for (std::vector<std::pair<std::string, ObjectReadOperation*> >::const_iterator p = ops.begin();
+       p != ops.end();
+       ++p) {
+    obj_ops.push_back(make_pair(object_t(p->first),
+				(::ObjectOperation*)p->second->impl));
+  }
+  return io_ctx_impl->aio_operate_read_many(obj_ops, c->pc,
+					    translate_flags(flags));
+}
+
 
 void librados::IoCtx::snap_set_read(snap_t seq)
 {
@@ -3874,6 +3890,31 @@ extern "C" int rados_aio_stat(rados_ioctx_t io, const char *o,
   return retval;
 }
 
+extern "C" int rados_aio_stat_batch(rados_ioctx_t io,
+				    rados_completion_t completion,
+				    const char * const *oids,
+				    size_t num_oids,
+				    uint64_t *psizes, time_t *pmtimes,
+				    int *prvals)
+{
+  tracepoint(librados, rados_aio_stat_batch_enter, io, completion, num_oids);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+
+  // the out params are bound into each op and owned by the objecter
+  // once submitted, so the ops themselves need only live to submission
+  vector<pair<object_t, ::ObjectOperation*> > obj_ops(num_oids);
+  ::ObjectOperation *ops = new ::ObjectOperation[num_oids];
+  for (size_t i = 0; i < num_oids; i++) {
+    ops[i].stat(&psizes[i], &pmtimes[i], &prvals[i]);
+    obj_ops[i] = make_pair(object_t(oids[i]), &ops[i]);
+  }
+  int retval = ctx->aio_operate_read_many(
+    obj_ops, (librados::AioCompletionImpl*)completion, 0);
+  delete[] ops;
+  tracepoint(librados, rados_aio_stat_batch_exit, retval);
+  return retval;
+}
+
 extern "C" int rados_aio_cancel(rados_ioctx_t io, rados_completion_t completion)
 {
   librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
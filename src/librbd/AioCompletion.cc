@@ -26,7 +26,7 @@ namespace librbd {
 
   void AioCompletion::finish_adding_requests(CephContext *cct)
   {
-    ldout(cct, 20) << "AioCompletion::finish_adding_requests " << (void*)this << " pending " << pending_count << dendl;
+    ldout(cct, 20) << "AioCompletion::finish_adding_requests " << (void*)this << " pending " << pending_count.read() << dendl;
     unblock(cct);
   }
 
@@ -61,6 +61,20 @@ namespace librbd {
 		       << " bytes to bl " << (void*)read_bl << dendl;
 	read_bl->claim(bl);
       }
+      if (read_iov) {
+	// scatter the result directly into the caller's segments; the
+	// result may be shorter than the iovecs if the read was clipped
+	uint64_t offset = 0;
+	uint64_t remaining = bl.length();
+	for (int i = 0; i < read_iov_cnt && remaining > 0; ++i) {
+	  uint64_t len = MIN(remaining, (uint64_t)read_iov[i].iov_len);
+	  bl.copy(offset, len, static_cast<char *>(read_iov[i].iov_base));
+	  offset += len;
+	  remaining -= len;
+	}
+	ldout(cct, 20) << "AioCompletion::finalize() copied resulting " << offset
+		       << " bytes to iovec " << (void*)read_iov << dendl;
+      }
     }
   }
 
@@ -102,32 +116,42 @@ namespace librbd {
   {
     lderr(cct) << "AioCompletion::fail() " << this << ": " << cpp_strerror(r)
                << dendl;
-    lock.Lock();
-    assert(pending_count == 0);
+    // no requests were ever sent; only our initial count remains
+    assert(pending_count.read() == 1);
     rval = r;
+    lock.Lock();
     complete(cct);
-    put_unlock();
+    lock.Unlock();
+    put();
   }
 
   void AioCompletion::complete_request(CephContext *cct, ssize_t r)
   {
     ldout(cct, 20) << "AioCompletion::complete_request() "
 		   << (void *)this << " complete_cb=" << (void *)complete_cb
-		   << " pending " << pending_count << dendl;
-    lock.Lock();
-    if (rval >= 0) {
-      if (r < 0 && r != -EEXIST)
-	rval = r;
-      else if (r > 0)
-	rval += r;
+		   << " pending " << pending_count.read() << dendl;
+    if (r < 0 && r != -EEXIST) {
+      // first error wins; errors after it change nothing, and bytes
+      // folded in below are ignored once an error is recorded
+      error_rval.compare_and_swap(0, (uint64_t)(int64_t)r);
+    } else if (r > 0) {
+      bytes_done.add(r);
     }
-    assert(pending_count);
-    int count = --pending_count;
-    if (!count && blockers == 0) {
+    complete_if_done(cct);
+    put();
+  }
+
+  void AioCompletion::complete_if_done(CephContext *cct)
+  {
+    assert(pending_count.read() > 0);
+    if (pending_count.dec() == 0) {
+      ssize_t e = (ssize_t)(int64_t)error_rval.read();
+      lock.Lock();
+      rval = e ? e : (ssize_t)bytes_done.read();
       finalize(cct, rval);
       complete(cct);
+      lock.Unlock();
     }
-    put_unlock();
   }
 
   bool AioCompletion::is_complete() {
@@ -3,8 +3,11 @@
 #ifndef CEPH_LIBRBD_AIOCOMPLETION_H
 #define CEPH_LIBRBD_AIOCOMPLETION_H
 
+#include <sys/uio.h>
+
 #include "common/Cond.h"
 #include "common/Mutex.h"
+#include "include/atomic.h"
 #include "common/ceph_context.h"
 #include "common/perf_counters.h"
 #include "include/Context.h"
@@ -36,10 +39,12 @@ namespace librbd {
    *
    * The retrying of individual requests is handled at a lower level,
    * so all AioCompletion cares about is the count of outstanding
-   * requests. Note that this starts at 1 to prevent the reference
-   * count from reaching 0 while more requests are being added. When
-   * all requests have been added, finish_adding_requests() releases
-   * this initial reference.
+   * requests.  pending_count starts at 1 so that it cannot reach 0
+   * while requests are still being added; finish_adding_requests()
+   * drops that initial count (copy-up blockers are held the same
+   * way).  Requests complete lock-free: per-request results fold into
+   * bytes_done/error_rval with atomics, and whoever drops
+   * pending_count to 0 computes rval and fires the callback.
    */
   struct AioCompletion {
     Mutex lock;
@@ -49,9 +54,10 @@ namespace librbd {
     callback_t complete_cb;
     void *complete_arg;
     rbd_completion_t rbd_comp;
-    int pending_count;   ///< number of requests
-    uint32_t blockers;
-    int ref;
+    atomic_t pending_count; ///< requests in flight, +1 while requests are being added
+    atomic64_t bytes_done;  ///< bytes from successful requests
+    atomic64_t error_rval;  ///< first request error, or 0
+    atomic_t ref;
     bool released;
     ImageCtx *ictx;
     utime_t start_time;
@@ -61,16 +67,19 @@ namespace librbd {
     bufferlist *read_bl;
     char *read_buf;
     size_t read_buf_len;
+    const struct iovec *read_iov; ///< caller-owned; must stay valid until completion
+    int read_iov_cnt;
 
     AsyncOperation async_op;
 
     AioCompletion() : lock("AioCompletion::lock", true, false),
 		      done(false), rval(0), complete_cb(NULL),
 		      complete_arg(NULL), rbd_comp(NULL),
-		      pending_count(0), blockers(1),
+		      pending_count(1),
 		      ref(1), released(false), ictx(NULL),
 		      aio_type(AIO_TYPE_NONE),
-		      read_bl(NULL), read_buf(NULL), read_buf_len(0) {
+		      read_bl(NULL), read_buf(NULL), read_buf_len(0),
+		      read_iov(NULL), read_iov_cnt(0) {
     }
     ~AioCompletion() {
     }
@@ -78,9 +87,7 @@ namespace librbd {
     int wait_for_complete();
 
     void add_request() {
-      lock.Lock();
-      pending_count++;
-      lock.Unlock();
+      pending_count.inc();
       get();
     }
 
@@ -108,47 +115,32 @@ namespace librbd {
     }
 
     void complete_request(CephContext *cct, ssize_t r);
+    void complete_if_done(CephContext *cct);
 
     bool is_complete();
 
     ssize_t get_return_value();
 
     void get() {
-      lock.Lock();
-      assert(ref > 0);
-      ref++;
-      lock.Unlock();
+      assert(ref.read() > 0);
+      ref.inc();
     }
     void release() {
-      lock.Lock();
       assert(!released);
       released = true;
-      put_unlock();
+      put();
     }
     void put() {
-      lock.Lock();
-      put_unlock();
-    }
-    void put_unlock() {
-      assert(ref > 0);
-      int n = --ref;
-      lock.Unlock();
-      if (!n)
+      assert(ref.read() > 0);
+      if (ref.dec() == 0)
 	delete this;
     }
 
     void block() {
-      Mutex::Locker l(lock);
-      ++blockers;
+      pending_count.inc();
     }
     void unblock(CephContext *cct) {
-      Mutex::Locker l(lock);
-      assert(blockers > 0);
-      --blockers;
-      if (pending_count == 0 && blockers == 0) {
-        finalize(cct, rval);
-        complete(cct);
-      }
+      complete_if_done(cct);
     }
   };
 
@@ -279,13 +279,13 @@ namespace librbd {
 
   AbstractWrite::AbstractWrite(ImageCtx *ictx, const std::string &oid,
                                uint64_t object_no, uint64_t object_off,
-                               uint64_t len, const ::SnapContext &snapc,
+                               uint64_t len, const WriteSnapContextRef &snapc,
                                Context *completion, bool hide_enoent)
     : AioRequest(ictx, oid, object_no, object_off, len, CEPH_NOSNAP, completion,
                  hide_enoent),
-      m_state(LIBRBD_AIO_WRITE_FLAT), m_snap_seq(snapc.seq.val)
+      m_state(LIBRBD_AIO_WRITE_FLAT), m_snapc(snapc)
   {
-    m_snaps.insert(m_snaps.end(), snapc.snaps.begin(), snapc.snaps.end());
+    assert(m_snapc);
   }
 
   void AbstractWrite::guard_write()
@@ -473,8 +473,11 @@ namespace librbd {
 
     librados::AioCompletion *rados_completion =
       librados::Rados::aio_create_completion(this, NULL, rados_req_cb);
-    int r = m_ictx->data_ctx.aio_operate(m_oid, rados_completion, &m_write,
-					 m_snap_seq, m_snaps);
+    // librados takes a non-const reference but never modifies the snap
+    // vector, so the shared context stays immutable
+    int r = m_ictx->data_ctx.aio_operate(
+      m_oid, rados_completion, &m_write, m_snapc->seq,
+      const_cast<std::vector<librados::snap_t> &>(m_snapc->snaps));
     assert(r == 0);
     rados_completion->release();
   }
@@ -499,6 +502,10 @@ namespace librbd {
 
       m_ictx->copyup_list_lock.Unlock();
       new_req->send();
+
+      // the write pattern is marching into parent-backed territory;
+      // optionally copy up the objects just ahead of it
+      CopyupRequest::maybe_prefetch(m_ictx, m_object_no);
     } else {
       it->second->append_request(this);
       m_ictx->copyup_list_lock.Unlock();
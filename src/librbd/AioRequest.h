@@ -12,6 +12,7 @@
 #include "include/Context.h"
 #include "include/rados/librados.hpp"
 #include "librbd/ObjectMap.h"
+#include "librbd/WriteSnapContext.h"
 
 namespace librbd {
 
@@ -116,7 +117,8 @@ namespace librbd {
   class AbstractWrite : public AioRequest {
   public:
     AbstractWrite(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
-                  uint64_t object_off, uint64_t len, const ::SnapContext &snapc,
+                  uint64_t object_off, uint64_t len,
+                  const WriteSnapContextRef &snapc,
 		  Context *completion, bool hide_enoent);
     virtual ~AbstractWrite() {}
 
@@ -175,8 +177,7 @@ namespace librbd {
   protected:
     write_state_d m_state;
     librados::ObjectWriteOperation m_write;
-    uint64_t m_snap_seq;
-    std::vector<librados::snap_t> m_snaps;
+    WriteSnapContextRef m_snapc;
 
     virtual void add_write_ops(librados::ObjectWriteOperation *wr) = 0;
     virtual const char* get_write_type() const = 0;
@@ -197,7 +198,7 @@ namespace librbd {
   public:
     AioWrite(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
              uint64_t object_off, const ceph::bufferlist &data,
-             const ::SnapContext &snapc, Context *completion)
+             const WriteSnapContextRef &snapc, Context *completion)
       : AbstractWrite(ictx, oid, object_no, object_off, data.length(), snapc,
 		      completion, false),
 	m_write_data(data), m_op_flags(0) {
@@ -226,7 +227,7 @@ namespace librbd {
   class AioRemove : public AbstractWrite {
   public:
     AioRemove(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
-	      const ::SnapContext &snapc, Context *completion)
+	      const WriteSnapContextRef &snapc, Context *completion)
       : AbstractWrite(ictx, oid, object_no, 0, 0, snapc, completion, true),
         m_object_state(OBJECT_NONEXISTENT) {
     }
@@ -272,7 +273,7 @@ namespace librbd {
   class AioTrim : public AbstractWrite {
   public:
     AioTrim(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
-            const ::SnapContext &snapc, Context *completion)
+            const WriteSnapContextRef &snapc, Context *completion)
       : AbstractWrite(ictx, oid, object_no, 0, 0, snapc, completion, true) {
     }
 
@@ -297,7 +298,7 @@ namespace librbd {
   class AioTruncate : public AbstractWrite {
   public:
     AioTruncate(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
-                uint64_t object_off, const ::SnapContext &snapc,
+                uint64_t object_off, const WriteSnapContextRef &snapc,
                 Context *completion)
       : AbstractWrite(ictx, oid, object_no, object_off, 0, snapc, completion,
                       true) {
@@ -322,7 +323,7 @@ namespace librbd {
   public:
     AioZero(ImageCtx *ictx, const std::string &oid, uint64_t object_no,
             uint64_t object_off, uint64_t object_len,
-            const ::SnapContext &snapc, Context *completion)
+            const WriteSnapContextRef &snapc, Context *completion)
       : AbstractWrite(ictx, oid, object_no, object_off, object_len, snapc,
                       completion, true) {
     }
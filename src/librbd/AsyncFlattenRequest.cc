@@ -21,7 +21,7 @@ namespace librbd {
 class AsyncFlattenObjectContext : public C_AsyncObjectThrottle {
 public:
   AsyncFlattenObjectContext(AsyncObjectThrottle &throttle, ImageCtx *image_ctx,
-                            uint64_t object_size, ::SnapContext snapc,
+                            uint64_t object_size, WriteSnapContextRef snapc,
                             uint64_t object_no)
     : C_AsyncObjectThrottle(throttle, *image_ctx), m_object_size(object_size),
       m_snapc(snapc), m_object_no(object_no)
@@ -55,7 +55,7 @@ public:
 
 private:
   uint64_t m_object_size;
-  ::SnapContext m_snapc;
+  WriteSnapContextRef m_snapc;
   uint64_t m_object_no;
 };
 
@@ -4,8 +4,8 @@
 #define CEPH_LIBRBD_ASYNC_FLATTEN_REQUEST_H
 
 #include "librbd/AsyncRequest.h"
+#include "librbd/WriteSnapContext.h"
 #include "librbd/parent_types.h"
-#include "common/snap_types.h"
 
 namespace librbd {
 
@@ -17,7 +17,8 @@ class AsyncFlattenRequest : public AsyncRequest
 public:
   AsyncFlattenRequest(ImageCtx &image_ctx, Context *on_finish,
 		      uint64_t object_size, uint64_t overlap_objects,
-		      const ::SnapContext &snapc, ProgressContext &prog_ctx)
+		      const WriteSnapContextRef &snapc,
+		      ProgressContext &prog_ctx)
     : AsyncRequest(image_ctx, on_finish), m_object_size(object_size),
       m_overlap_objects(overlap_objects), m_snapc(snapc), m_prog_ctx(prog_ctx),
       m_ignore_enoent(false)
@@ -65,7 +66,7 @@ private:
 
   uint64_t m_object_size;
   uint64_t m_overlap_objects;
-  ::SnapContext m_snapc;
+  WriteSnapContextRef m_snapc;
   ProgressContext &m_prog_ctx;
   State m_state;
 
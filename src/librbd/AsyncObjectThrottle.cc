@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 #include "librbd/AsyncObjectThrottle.h"
 #include "include/rbd/librbd.hpp"
+#include "common/Clock.h"
 #include "common/RWLock.h"
 #include "librbd/AsyncRequest.h"
 #include "librbd/ImageCtx.h"
@@ -11,8 +12,9 @@ namespace librbd
 {
 
 void C_AsyncObjectThrottle::finish(int r) {
+  utime_t elapsed = ceph_clock_now(m_image_ctx.cct) - m_start_time;
   RWLock::RLocker l(m_image_ctx.owner_lock);
-  m_finisher.finish_op(r);
+  m_finisher.finish_op(r, elapsed);
 }
 
 AsyncObjectThrottle::AsyncObjectThrottle(const AsyncRequest* async_request,
@@ -25,7 +27,11 @@ AsyncObjectThrottle::AsyncObjectThrottle(const AsyncRequest* async_request,
     m_async_request(async_request), m_image_ctx(image_ctx),
     m_context_factory(context_factory), m_ctx(ctx), m_prog_ctx(prog_ctx),
     m_object_no(object_no), m_end_object_no(end_object_no), m_current_ops(0),
-    m_ret(0)
+    m_ret(0), m_max_concurrent(0), m_target_concurrent(0),
+    m_ops_since_adjust(0),
+    m_latency_target(
+      image_ctx.management_op_latency_target_ms / 1000.0),
+    m_latency_avg(0)
 {
 }
 
@@ -34,6 +40,8 @@ void AsyncObjectThrottle::start_ops(uint64_t max_concurrent) {
   bool complete;
   {
     Mutex::Locker l(m_lock);
+    m_max_concurrent = max_concurrent;
+    m_target_concurrent = max_concurrent;
     for (uint64_t i = 0; i < max_concurrent; ++i) {
       start_next_op();
       if (m_ret < 0 && m_current_ops == 0) {
@@ -48,7 +56,7 @@ void AsyncObjectThrottle::start_ops(uint64_t max_concurrent) {
   }
 }
 
-void AsyncObjectThrottle::finish_op(int r) {
+void AsyncObjectThrottle::finish_op(int r, const utime_t &elapsed) {
   assert(m_image_ctx.owner_lock.is_locked());
   bool complete;
   {
@@ -58,7 +66,14 @@ void AsyncObjectThrottle::finish_op(int r) {
       m_ret = r;
     }
 
-    start_next_op();
+    adjust_concurrency(elapsed);
+    while (m_current_ops < m_target_concurrent) {
+      uint64_t prev_ops = m_current_ops;
+      start_next_op();
+      if (m_current_ops == prev_ops) {
+	break;
+      }
+    }
     complete = (m_current_ops == 0);
   }
   if (complete) {
@@ -81,6 +96,7 @@ void AsyncObjectThrottle::start_next_op() {
 
     uint64_t ono = m_object_no++;
     C_AsyncObjectThrottle *ctx = m_context_factory(*this, ono);
+    ctx->set_start_time(ceph_clock_now(m_image_ctx.cct));
 
     int r = ctx->send();
     if (r < 0) {
@@ -100,4 +116,32 @@ void AsyncObjectThrottle::start_next_op() {
   }
 }
 
+void AsyncObjectThrottle::adjust_concurrency(const utime_t &elapsed) {
+  assert(m_lock.is_locked());
+  if (m_latency_target <= 0) {
+    return;
+  }
+
+  double sample = elapsed;
+  if (m_latency_avg <= 0) {
+    m_latency_avg = sample;
+  } else {
+    m_latency_avg = (0.75 * m_latency_avg) + (0.25 * sample);
+  }
+
+  // additive increase / multiplicative decrease against the latency
+  // ceiling, at most once per window of completions so a single slow
+  // batch doesn't collapse the concurrency all the way to one
+  if (++m_ops_since_adjust < m_target_concurrent) {
+    return;
+  }
+  m_ops_since_adjust = 0;
+
+  if (m_latency_avg > m_latency_target) {
+    m_target_concurrent = MAX(m_target_concurrent / 2, 1);
+  } else if (m_target_concurrent < m_max_concurrent) {
+    ++m_target_concurrent;
+  }
+}
+
 } // namespace librbd
@@ -5,6 +5,7 @@
 
 #include "include/int_types.h"
 #include "include/Context.h"
+#include "include/utime.h"
 
 #include <boost/function.hpp>
 #include "include/assert.h"
@@ -18,7 +19,7 @@ struct ImageCtx;
 class AsyncObjectThrottleFinisher {
 public:
   virtual ~AsyncObjectThrottleFinisher() {};
-  virtual void finish_op(int r) = 0;
+  virtual void finish_op(int r, const utime_t &elapsed) = 0;
 };
 
 class C_AsyncObjectThrottle : public Context {
@@ -31,6 +32,10 @@ public:
 
   virtual int send() = 0;
 
+  void set_start_time(const utime_t &start_time) {
+    m_start_time = start_time;
+  }
+
 protected:
   ImageCtx &m_image_ctx;
 
@@ -38,6 +43,7 @@ protected:
 
 private:
   AsyncObjectThrottleFinisher &m_finisher;
+  utime_t m_start_time;
 };
 
 class AsyncObjectThrottle : public AsyncObjectThrottleFinisher {
@@ -51,7 +57,7 @@ public:
 		      uint64_t end_object_no);
 
   void start_ops(uint64_t max_concurrent);
-  virtual void finish_op(int r);
+  virtual void finish_op(int r, const utime_t &elapsed);
 
 private:
   Mutex m_lock;
@@ -65,7 +71,14 @@ private:
   uint64_t m_current_ops;
   int m_ret;
 
+  uint64_t m_max_concurrent;
+  uint64_t m_target_concurrent;
+  uint64_t m_ops_since_adjust;
+  double m_latency_target;
+  double m_latency_avg;
+
   void start_next_op();
+  void adjust_concurrency(const utime_t &elapsed);
 };
 
 } // namespace librbd
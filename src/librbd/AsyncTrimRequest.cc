@@ -27,7 +27,7 @@ namespace librbd
 class C_CopyupObject : public C_AsyncObjectThrottle {
 public:
   C_CopyupObject(AsyncObjectThrottle &throttle, ImageCtx *image_ctx,
-                 ::SnapContext snapc, uint64_t object_no)
+                 WriteSnapContextRef snapc, uint64_t object_no)
     : C_AsyncObjectThrottle(throttle, *image_ctx), m_snapc(snapc),
       m_object_no(object_no)
   {
@@ -47,7 +47,7 @@ public:
     return 0;
   }
 private:
-  ::SnapContext m_snapc;
+  WriteSnapContextRef m_snapc;
   uint64_t m_object_no;
 };
 
@@ -171,14 +171,14 @@ void AsyncTrimRequest::send_copyup_objects() {
     return;
   }
 
-  ::SnapContext snapc;
+  WriteSnapContextRef snapc;
   bool has_snapshots;
   uint64_t parent_overlap;
   {
     RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
     RWLock::RLocker parent_locker(m_image_ctx.parent_lock);
 
-    snapc = m_image_ctx.snapc;
+    snapc = m_image_ctx.write_snapc;
     has_snapshots = !m_image_ctx.snaps.empty();
     int r = m_image_ctx.get_parent_overlap(m_image_ctx.get_copyup_snap_id(),
                                            &parent_overlap);
@@ -321,10 +321,10 @@ void AsyncTrimRequest::send_clean_boundary() {
 			    << " length=" << delete_len << dendl;
   m_state = STATE_CLEAN_BOUNDARY;
 
-  ::SnapContext snapc;
+  WriteSnapContextRef snapc;
   {
     RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
-    snapc = m_image_ctx.snapc;
+    snapc = m_image_ctx.write_snapc;
   }
 
   // discard the weird boundary
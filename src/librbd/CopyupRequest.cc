@@ -188,6 +188,65 @@ private:
     aio_read(m_ictx->parent, m_image_extents, NULL, &m_copyup_data, comp, 0);
   }
 
+  void CopyupRequest::maybe_prefetch(ImageCtx *ictx, uint64_t object_no)
+  {
+    uint32_t count = ictx->copyup_prefetch_objects;
+    if (count == 0) {
+      return;
+    }
+
+    CephContext *cct = ictx->cct;
+    std::vector<CopyupRequest*> reqs;
+    for (uint64_t objectno = object_no + 1; objectno <= object_no + count;
+	 ++objectno) {
+      vector<pair<uint64_t,uint64_t> > image_extents;
+      {
+	RWLock::RLocker snap_locker(ictx->snap_lock);
+	RWLock::RLocker parent_locker(ictx->parent_lock);
+	if (ictx->parent == NULL) {
+	  return;
+	}
+
+	uint64_t parent_overlap;
+	if (ictx->get_parent_overlap(CEPH_NOSNAP, &parent_overlap) < 0) {
+	  return;
+	}
+	Striper::extent_to_file(cct, &ictx->layout, objectno, 0,
+				ictx->layout.fl_object_size, image_extents);
+	if (ictx->prune_parent_extents(image_extents, parent_overlap) == 0) {
+	  // past the parent overlap -- nothing further to copy up
+	  return;
+	}
+      }
+
+      // only prefetch objects the object map knows are still backed by
+      // the parent; without the object map we cannot tell and would
+      // waste parent reads probing
+      if (ictx->object_map.object_may_exist(objectno)) {
+	continue;
+      }
+
+      Mutex::Locker copyup_locker(ictx->copyup_list_lock);
+      if (ictx->copyup_list.size() >= ictx->concurrent_management_ops) {
+	// enough copyups in flight already; don't pile on speculatively
+	return;
+      }
+      if (ictx->copyup_list.count(objectno) == 0) {
+	ldout(cct, 20) << __func__ << " prefetching copyup for object "
+		       << objectno << dendl;
+	CopyupRequest *new_req = new CopyupRequest(
+	  ictx, ictx->get_object_name(objectno), objectno, image_extents);
+	ictx->copyup_list[objectno] = new_req;
+	reqs.push_back(new_req);
+      }
+    }
+
+    // kick off the parent reads outside copyup_list_lock
+    for (size_t i = 0; i < reqs.size(); ++i) {
+      reqs[i]->send();
+    }
+  }
+
   void CopyupRequest::queue_send()
   {
     // TODO: once the ObjectCacher allows reentrant read requests, the finisher
@@ -25,6 +25,8 @@ namespace librbd {
     void send();
     void queue_send();
 
+    static void maybe_prefetch(ImageCtx *ictx, uint64_t object_no);
+
   private:
     /**
      * Copyup requests go through the following state machine to read from the
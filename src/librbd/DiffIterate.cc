@@ -48,6 +48,10 @@ public:
       m_callback_arg(callback_arg), m_pending_ops(0), m_return_value(0),
       m_next_request(0), m_waiting_request(0)
   {
+    m_max_ops = image_ctx.concurrent_diff_ops;
+    if (m_max_ops == 0) {
+      m_max_ops = image_ctx.concurrent_management_ops;
+    }
   }
 
   int invoke_callback() {
@@ -88,7 +92,7 @@ public:
 
   uint64_t start_op() {
     Mutex::Locker locker(m_lock);
-    while (m_pending_ops >= m_image_ctx.concurrent_management_ops) {
+    while (m_pending_ops >= m_max_ops) {
         m_cond.Wait(m_lock);
     }
     ++m_pending_ops;
@@ -116,6 +120,7 @@ private:
   void *m_callback_arg;
 
   uint32_t m_pending_ops;
+  uint32_t m_max_ops;
   int m_return_value;
 
   uint64_t m_next_request;
@@ -57,6 +57,7 @@ public:
 		     const char *snap, IoCtx& p, bool ro)
     : cct((CephContext*)p.cct()),
       perfcounter(NULL),
+      write_snapc(new WriteSnapContext()),
       snap_id(CEPH_NOSNAP),
       snap_exists(true),
       read_only(ro),
@@ -66,11 +67,15 @@ public:
       image_watcher(NULL),
       refresh_seq(0),
       last_refresh(0),
-      owner_lock(unique_lock_name("librbd::ImageCtx::owner_lock", this)),
-      md_lock(unique_lock_name("librbd::ImageCtx::md_lock", this)),
+      owner_lock(unique_lock_name("librbd::ImageCtx::owner_lock", this),
+		 true, cct->_conf->rbd_lock_read_shards),
+      md_lock(unique_lock_name("librbd::ImageCtx::md_lock", this),
+	      true, cct->_conf->rbd_lock_read_shards),
       cache_lock(unique_lock_name("librbd::ImageCtx::cache_lock", this)),
-      snap_lock(unique_lock_name("librbd::ImageCtx::snap_lock", this)),
-      parent_lock(unique_lock_name("librbd::ImageCtx::parent_lock", this)),
+      snap_lock(unique_lock_name("librbd::ImageCtx::snap_lock", this),
+		true, cct->_conf->rbd_lock_read_shards),
+      parent_lock(unique_lock_name("librbd::ImageCtx::parent_lock", this),
+		  true, cct->_conf->rbd_lock_read_shards),
       refresh_lock(unique_lock_name("librbd::ImageCtx::refresh_lock", this)),
       object_map_lock(unique_lock_name("librbd::ImageCtx::object_map_lock", this)),
       async_ops_lock(unique_lock_name("librbd::ImageCtx::async_ops_lock", this)),
@@ -217,6 +222,7 @@ public:
       ldout(cct, 10) << " cache bytes " << cache_size
 	<< " -> about " << obj << " objects" << dendl;
       object_cacher->set_max_objects(obj);
+      object_cacher->set_max_flush_bytes(cache_max_flush_bytes);
 
       object_set = new ObjectCacher::ObjectSet(NULL, data_ctx.get_id(), 0);
       object_set->return_enoent = true;
@@ -230,6 +236,7 @@ public:
 
     readahead.set_trigger_requests(readahead_trigger_requests);
     readahead.set_max_readahead_size(readahead_max_bytes);
+    readahead.set_max_streams(readahead_max_streams);
 
     return 0;
   }
@@ -292,6 +299,8 @@ public:
     plb.add_u64_counter(l_librbd_resize, "resize", "Resizes");
     plb.add_u64_counter(l_librbd_readahead, "readahead", "Read ahead");
     plb.add_u64_counter(l_librbd_readahead_bytes, "readahead_bytes", "Data size in read ahead");
+    plb.add_u64(l_librbd_readahead_stream_hits, "readahead_stream_hits", "Reads continuing a tracked stream");
+    plb.add_u64(l_librbd_readahead_stream_misses, "readahead_stream_misses", "Reads not matching any tracked stream");
 
     perfcounter = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perfcounter);
@@ -464,6 +473,12 @@ public:
     snap_ids.erase(in_snap_name);
   }
 
+  void ImageCtx::update_write_snapc()
+  {
+    assert(snap_lock.is_wlocked());
+    write_snapc.reset(new WriteSnapContext(snapc));
+  }
+
   uint64_t ImageCtx::get_image_size(snap_t in_snap_id) const
   {
     assert(snap_lock.is_locked());
@@ -843,8 +858,11 @@ public:
         "rbd_cache_target_dirty", false)(
         "rbd_cache_max_dirty_age", false)(
         "rbd_cache_max_dirty_object", false)(
+        "rbd_cache_max_flush_bytes", false)(
         "rbd_cache_block_writes_upfront", false)(
         "rbd_concurrent_management_ops", false)(
+        "rbd_concurrent_diff_ops", false)(
+        "rbd_management_op_latency_target_ms", false)(
         "rbd_balance_snap_reads", false)(
         "rbd_localize_snap_reads", false)(
         "rbd_balance_parent_reads", false)(
@@ -852,7 +870,9 @@ public:
         "rbd_readahead_trigger_requests", false)(
         "rbd_readahead_max_bytes", false)(
         "rbd_readahead_disable_after_bytes", false)(
+        "rbd_readahead_max_streams", false)(
         "rbd_clone_copy_on_read", false)(
+        "rbd_copyup_prefetch_objects", false)(
         "rbd_blacklist_on_break_lock", false)(
         "rbd_blacklist_expire_seconds", false)(
         "rbd_request_timed_out_seconds", false);
@@ -909,8 +929,11 @@ public:
     ASSIGN_OPTION(cache_target_dirty);
     ASSIGN_OPTION(cache_max_dirty_age);
     ASSIGN_OPTION(cache_max_dirty_object);
+    ASSIGN_OPTION(cache_max_flush_bytes);
     ASSIGN_OPTION(cache_block_writes_upfront);
     ASSIGN_OPTION(concurrent_management_ops);
+    ASSIGN_OPTION(concurrent_diff_ops);
+    ASSIGN_OPTION(management_op_latency_target_ms);
     ASSIGN_OPTION(balance_snap_reads);
     ASSIGN_OPTION(localize_snap_reads);
     ASSIGN_OPTION(balance_parent_reads);
@@ -918,7 +941,9 @@ public:
     ASSIGN_OPTION(readahead_trigger_requests);
     ASSIGN_OPTION(readahead_max_bytes);
     ASSIGN_OPTION(readahead_disable_after_bytes);
+    ASSIGN_OPTION(readahead_max_streams);
     ASSIGN_OPTION(clone_copy_on_read);
+    ASSIGN_OPTION(copyup_prefetch_objects);
     ASSIGN_OPTION(blacklist_on_break_lock);
     ASSIGN_OPTION(blacklist_expire_seconds);
     ASSIGN_OPTION(request_timed_out_seconds);
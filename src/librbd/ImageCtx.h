@@ -29,6 +29,7 @@
 #include "librbd/LibrbdWriteback.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/SnapInfo.h"
+#include "librbd/WriteSnapContext.h"
 #include "librbd/parent_types.h"
 
 class CephContext;
@@ -50,6 +51,9 @@ namespace librbd {
     ::SnapContext snapc;
     std::vector<librados::snap_t> snaps; // this mirrors snapc.snaps, but is in
                                         // a format librados can understand
+    WriteSnapContextRef write_snapc; // immutable snapshot of snapc shared with
+                                    // in-flight writes; replaced, never
+                                    // modified in place
     std::map<librados::snap_t, SnapInfo> snap_info;
     std::map<std::string, librados::snap_t> snap_ids;
     uint64_t snap_id;
@@ -144,8 +148,11 @@ namespace librbd {
     uint64_t cache_target_dirty;
     double cache_max_dirty_age;
     uint32_t cache_max_dirty_object;
+    uint64_t cache_max_flush_bytes;
     bool cache_block_writes_upfront;
     uint32_t concurrent_management_ops;
+    uint32_t concurrent_diff_ops;
+    uint32_t management_op_latency_target_ms;
     bool balance_snap_reads;
     bool localize_snap_reads;
     bool balance_parent_reads;
@@ -153,7 +160,9 @@ namespace librbd {
     uint32_t readahead_trigger_requests;
     uint64_t readahead_max_bytes;
     uint64_t readahead_disable_after_bytes;
+    uint32_t readahead_max_streams;
     bool clone_copy_on_read;
+    uint32_t copyup_prefetch_objects;
     bool blacklist_on_break_lock;
     uint32_t blacklist_expire_seconds;
     uint32_t request_timed_out_seconds;
@@ -199,6 +208,7 @@ namespace librbd {
 		  uint64_t in_size, parent_info parent,
                   uint8_t protection_status, uint64_t flags);
     void rm_snap(std::string in_snap_name, librados::snap_t id);
+    void update_write_snapc();
     uint64_t get_image_size(librados::snap_t in_snap_id) const;
     bool test_features(uint64_t test_features) const;
     int get_flags(librados::snap_t in_snap_id, uint64_t *flags) const;
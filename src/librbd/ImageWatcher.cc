@@ -37,6 +37,7 @@ ImageWatcher::ImageWatcher(ImageCtx &image_ctx)
     m_watch_state(WATCH_STATE_UNREGISTERED),
     m_lock_owner_state(LOCK_OWNER_STATE_NOT_LOCKED),
     m_task_finisher(new TaskFinisher<Task>(*m_image_ctx.cct)),
+    m_remote_task_finisher(new TaskFinisher<Task>(*m_image_ctx.cct)),
     m_async_request_lock(unique_lock_name("librbd::ImageWatcher::m_async_request_lock", this)),
     m_aio_request_lock(unique_lock_name("librbd::ImageWatcher::m_aio_request_lock", this)),
     m_owner_client_id_lock(unique_lock_name("librbd::ImageWatcher::m_owner_client_id_lock", this))
@@ -45,6 +46,8 @@ ImageWatcher::ImageWatcher(ImageCtx &image_ctx)
 
 ImageWatcher::~ImageWatcher()
 {
+  // remote requests can schedule completions on the primary task finisher
+  delete m_remote_task_finisher;
   delete m_task_finisher;
   {
     RWLock::RLocker l(m_watch_lock);
@@ -100,6 +103,7 @@ int ImageWatcher::unregister_watch() {
 
   cancel_async_requests();
   m_task_finisher->cancel_all();
+  m_remote_task_finisher->cancel_all();
 
   int r = 0;
   {
@@ -1005,6 +1009,43 @@ void ImageWatcher::handle_payload(const UnknownPayload &payload,
   }
 }
 
+struct ImageWatcher::HandleDeferredPayloadVisitor
+  : public boost::static_visitor<void> {
+  ImageWatcher *image_watcher;
+  uint64_t notify_id;
+  uint64_t handle;
+
+  HandleDeferredPayloadVisitor(ImageWatcher *image_watcher_,
+			       uint64_t notify_id_, uint64_t handle_)
+    : image_watcher(image_watcher_), notify_id(notify_id_), handle(handle_)
+  {
+  }
+
+  template <typename Payload>
+  inline void operator()(const Payload &payload) const {
+    bufferlist out;
+    image_watcher->handle_payload(payload, &out);
+    image_watcher->acknowledge_notify(notify_id, handle, out);
+  }
+};
+
+void ImageWatcher::defer_handle_payload(const NotifyMessage &notify_message,
+					uint64_t notify_id, uint64_t handle) {
+  // the rados notify callback thread delivers notifications serially:
+  // execute remote requests on a dedicated finisher so lock handoff
+  // messages aren't delayed behind them, and ack once they've run
+  FunctionContext *ctx = new FunctionContext(
+    boost::bind(&ImageWatcher::handle_deferred_payload, this, notify_message,
+		notify_id, handle));
+  m_remote_task_finisher->queue(ctx);
+}
+
+void ImageWatcher::handle_deferred_payload(const NotifyMessage &notify_message,
+					   uint64_t notify_id, uint64_t handle) {
+  apply_visitor(HandleDeferredPayloadVisitor(this, notify_id, handle),
+		notify_message.payload);
+}
+
 void ImageWatcher::handle_notify(uint64_t notify_id, uint64_t handle,
 				 bufferlist &bl) {
   NotifyMessage notify_message;
@@ -178,14 +178,42 @@ namespace librbd {
 	image_watcher->acknowledge_notify(notify_id, handle, out);
       }
 
+      // remote requests run synchronous image operations -- move them off
+      // the notify delivery thread so lock handoff messages queued behind
+      // them are processed immediately
+      inline void operator()(const WatchNotify::FlattenPayload &payload) const {
+	defer(payload);
+      }
+      inline void operator()(const WatchNotify::ResizePayload &payload) const {
+	defer(payload);
+      }
+      inline void operator()(const WatchNotify::SnapCreatePayload &payload) const {
+	defer(payload);
+      }
+      inline void operator()(const WatchNotify::SnapRemovePayload &payload) const {
+	defer(payload);
+      }
+      inline void operator()(const WatchNotify::RebuildObjectMapPayload &payload) const {
+	defer(payload);
+      }
+
       template <typename Payload>
       inline void operator()(const Payload &payload) const {
 	bufferlist out;
 	image_watcher->handle_payload(payload, &out);
 	image_watcher->acknowledge_notify(notify_id, handle, out);
       }
+
+    private:
+      template <typename Payload>
+      inline void defer(const Payload &payload) const {
+	image_watcher->defer_handle_payload(WatchNotify::NotifyMessage(payload),
+					    notify_id, handle);
+      }
     };
 
+    struct HandleDeferredPayloadVisitor;
+
     ImageCtx &m_image_ctx;
 
     RWLock m_watch_lock;
@@ -196,6 +224,7 @@ namespace librbd {
     LockOwnerState m_lock_owner_state;
 
     TaskFinisher<Task> *m_task_finisher;
+    TaskFinisher<Task> *m_remote_task_finisher;
 
     RWLock m_async_request_lock;
     std::map<WatchNotify::AsyncRequestId, AsyncRequest> m_async_requests;
@@ -276,6 +305,11 @@ namespace librbd {
     void handle_payload(const WatchNotify::UnknownPayload& payload,
 		        bufferlist *out);
 
+    void defer_handle_payload(const WatchNotify::NotifyMessage &notify_message,
+			      uint64_t notify_id, uint64_t handle);
+    void handle_deferred_payload(const WatchNotify::NotifyMessage &notify_message,
+				 uint64_t notify_id, uint64_t handle);
+
     void handle_notify(uint64_t notify_id, uint64_t handle, bufferlist &bl);
     void handle_error(uint64_t cookie, int err);
     void acknowledge_notify(uint64_t notify_id, uint64_t handle,
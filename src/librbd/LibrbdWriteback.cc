@@ -164,8 +164,11 @@ namespace librbd {
     m_writes[oid.name].push(result);
     ldout(m_ictx->cct, 20) << "write will wait for result " << result << dendl;
     C_OrderedWrite *req_comp = new C_OrderedWrite(m_ictx->cct, result, this);
-    AioWrite *req = new AioWrite(m_ictx, oid.name, object_no, off, bl, snapc,
-                                 req_comp);
+    // the cache captured this snap context when the write was buffered, so
+    // convert it rather than using the image's current write context
+    WriteSnapContextRef write_snapc(new WriteSnapContext(snapc));
+    AioWrite *req = new AioWrite(m_ictx, oid.name, object_no, off, bl,
+                                 write_snapc, req_comp);
     req->send();
     return ++m_tid;
   }
@@ -16,8 +16,15 @@
 
 namespace librbd {
 
+namespace {
+
+const std::string REBUILD_HINT_KEY("rebuild_hint");
+
+} // anonymous namespace
+
 ObjectMap::ObjectMap(ImageCtx &image_ctx)
-  : m_image_ctx(image_ctx), m_snap_id(CEPH_NOSNAP), m_enabled(false)
+  : m_image_ctx(image_ctx), m_snap_id(CEPH_NOSNAP), m_enabled(false),
+    m_rebuild_hint_valid(false), m_rebuild_hint_start(0), m_rebuild_hint_end(0)
 {
 }
 
@@ -162,6 +169,7 @@ void ObjectMap::refresh(uint64_t snap_id)
   assert(m_image_ctx.snap_lock.is_wlocked());
   RWLock::WLocker l(m_image_ctx.object_map_lock);
   m_snap_id = snap_id;
+  m_rebuild_hint_valid = false;
 
   if ((m_image_ctx.features & RBD_FEATURE_OBJECT_MAP) == 0 ||
       (m_image_ctx.snap_id == snap_id && !m_image_ctx.snap_exists)) {
@@ -232,6 +240,35 @@ void ObjectMap::refresh(uint64_t snap_id)
     ldout(cct, 1) << "object map larger than current object count: "
                   << m_object_map.size() << " != " << num_objs << dendl;
   }
+
+  // load the incremental rebuild hint recorded when the map was invalidated
+  m_rebuild_hint_valid = false;
+  uint64_t snap_flags = 0;
+  m_image_ctx.get_flags(snap_id, &snap_flags);
+  if (snap_id == CEPH_NOSNAP &&
+      (snap_flags & RBD_FLAG_OBJECT_MAP_INVALID) != 0) {
+    std::set<std::string> keys;
+    keys.insert(REBUILD_HINT_KEY);
+    std::map<std::string, bufferlist> vals;
+    r = m_image_ctx.md_ctx.omap_get_vals_by_keys(m_image_ctx.header_oid, keys,
+                                                 &vals);
+    if (r == 0 && vals.count(REBUILD_HINT_KEY) > 0) {
+      try {
+        bufferlist::iterator it = vals[REBUILD_HINT_KEY].begin();
+        ::decode(m_rebuild_hint_start, it);
+        ::decode(m_rebuild_hint_end, it);
+        m_rebuild_hint_valid = (m_rebuild_hint_start < m_rebuild_hint_end);
+      } catch (const buffer::error &err) {
+        lderr(cct) << "corrupt object map rebuild hint" << dendl;
+      }
+      ldout(cct, 10) << "object map rebuild hint: "
+                     << (m_rebuild_hint_valid ?
+                           stringify(m_rebuild_hint_start) + "~" +
+                             stringify(m_rebuild_hint_end -
+                                       m_rebuild_hint_start) : "invalid")
+                     << dendl;
+    }
+  }
 }
 
 void ObjectMap::rollback(uint64_t snap_id) {
@@ -499,6 +536,12 @@ void ObjectMap::aio_update(uint64_t snap_id, uint64_t start_object_no,
 void ObjectMap::invalidate(uint64_t snap_id) {
   assert(m_image_ctx.snap_lock.is_wlocked());
   assert(m_image_ctx.object_map_lock.is_wlocked());
+
+  if (snap_id == CEPH_NOSNAP) {
+    // scope of the damage is unknown -- force a full rebuild
+    invalidate_rebuild_hint();
+  }
+
   uint64_t flags;
   m_image_ctx.get_flags(snap_id, &flags);
   if ((flags & RBD_FLAG_OBJECT_MAP_INVALID) != 0) {
@@ -542,6 +585,59 @@ void ObjectMap::invalidate(uint64_t snap_id) {
   }
 }
 
+bool ObjectMap::get_rebuild_hint(uint64_t *start_object_no,
+                                 uint64_t *end_object_no) {
+  RWLock::RLocker l(m_image_ctx.object_map_lock);
+  if (!m_rebuild_hint_valid) {
+    return false;
+  }
+  *start_object_no = m_rebuild_hint_start;
+  *end_object_no = m_rebuild_hint_end;
+  return true;
+}
+
+void ObjectMap::clear_rebuild_hint(librados::ObjectWriteOperation *op) {
+  RWLock::WLocker l(m_image_ctx.object_map_lock);
+  m_rebuild_hint_valid = false;
+
+  std::set<std::string> keys;
+  keys.insert(REBUILD_HINT_KEY);
+  op->omap_rm_keys(keys);
+}
+
+void ObjectMap::invalidate_rebuild_hint() {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+  m_rebuild_hint_valid = false;
+
+  std::set<std::string> keys;
+  keys.insert(REBUILD_HINT_KEY);
+  int r = m_image_ctx.md_ctx.omap_rm_keys(m_image_ctx.header_oid, keys);
+  if (r < 0 && r != -ENOENT) {
+    lderr(m_image_ctx.cct) << "failed to clear object map rebuild hint: "
+                           << cpp_strerror(r) << dendl;
+  }
+}
+
+void ObjectMap::update_rebuild_hint(uint64_t start_object_no,
+                                    uint64_t end_object_no,
+                                    librados::ObjectWriteOperation *op) {
+  RWLock::WLocker l(m_image_ctx.object_map_lock);
+  if (m_rebuild_hint_valid) {
+    start_object_no = MIN(start_object_no, m_rebuild_hint_start);
+    end_object_no = MAX(end_object_no, m_rebuild_hint_end);
+  }
+  m_rebuild_hint_valid = true;
+  m_rebuild_hint_start = start_object_no;
+  m_rebuild_hint_end = end_object_no;
+
+  bufferlist bl;
+  ::encode(start_object_no, bl);
+  ::encode(end_object_no, bl);
+  std::map<std::string, bufferlist> vals;
+  vals[REBUILD_HINT_KEY] = bl;
+  op->omap_set(vals);
+}
+
 void ObjectMap::resize(uint64_t num_objs, uint8_t defualt_state) {
   size_t orig_object_map_size = m_object_map.size();
   m_object_map.resize(num_objs);
@@ -590,7 +686,24 @@ bool ObjectMap::Request::should_complete(int r) {
 }
 
 bool ObjectMap::Request::invalidate() {
+  uint64_t start_object_no;
+  uint64_t end_object_no;
+  bool range_known = get_invalidate_range(&start_object_no, &end_object_no);
+
   if (m_image_ctx.test_flags(RBD_FLAG_OBJECT_MAP_INVALID)) {
+    if (range_known) {
+      // map already flagged invalid -- just widen the incremental
+      // rebuild hint to cover this failed update
+      librados::ObjectWriteOperation op;
+      m_image_ctx.object_map.update_rebuild_hint(start_object_no,
+                                                 end_object_no, &op);
+
+      librados::AioCompletion *comp = librados::Rados::aio_create_completion();
+      int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp,
+                                             &op);
+      assert(r == 0);
+      comp->release();
+    }
     return true;
   }
 
@@ -612,6 +725,12 @@ bool ObjectMap::Request::invalidate() {
   librados::ObjectWriteOperation op;
   m_image_ctx.image_watcher->assert_header_locked(&op);
   cls_client::set_flags(&op, CEPH_NOSNAP, flags, flags);
+  if (range_known) {
+    m_image_ctx.object_map.update_rebuild_hint(start_object_no, end_object_no,
+                                               &op);
+  } else {
+    m_image_ctx.object_map.clear_rebuild_hint(&op);
+  }
 
   librados::AioCompletion *rados_completion = create_callback_completion();
   int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid,
@@ -58,6 +58,9 @@ public:
 
   bool enabled() const;
 
+  bool get_rebuild_hint(uint64_t *start_object_no, uint64_t *end_object_no);
+  void clear_rebuild_hint(librados::ObjectWriteOperation *op);
+
 private:
 
   class Request : public AsyncRequest {
@@ -75,6 +78,10 @@ private:
       return false;
     }
     virtual bool should_complete(int r);
+    virtual bool get_invalidate_range(uint64_t *start_object_no,
+                                      uint64_t *end_object_no) {
+      return false;
+    }
     virtual int filter_return_code(int r) {
       // never propagate an error back to the caller
       return 0;
@@ -131,6 +138,15 @@ private:
     virtual void send();
   protected:
     virtual void finish(ObjectMap *object_map);
+    virtual bool get_invalidate_range(uint64_t *start_object_no,
+                                      uint64_t *end_object_no) {
+      if (m_snap_id != CEPH_NOSNAP) {
+        return false;
+      }
+      *start_object_no = m_start_object_no;
+      *end_object_no = m_end_object_no;
+      return true;
+    }
   private:
     uint64_t m_start_object_no;
     uint64_t m_end_object_no;
@@ -143,8 +159,20 @@ private:
   uint64_t m_snap_id;
   bool m_enabled;
 
+  // contiguous range of objects whose map updates failed since the map
+  // was invalidated -- everything else was kept in sync, so a rebuild
+  // only needs to re-verify this range.  mirrors an omap key on the
+  // image header; absence of the key forces a full rebuild
+  bool m_rebuild_hint_valid;
+  uint64_t m_rebuild_hint_start;
+  uint64_t m_rebuild_hint_end;
+
   void invalidate(uint64_t snap_id);
   void resize(uint64_t num_objs, uint8_t default_state);
+
+  void invalidate_rebuild_hint();
+  void update_rebuild_hint(uint64_t start_object_no, uint64_t end_object_no,
+                           librados::ObjectWriteOperation *op);
 };
 
 } // namespace librbd
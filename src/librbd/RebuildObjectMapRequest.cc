@@ -288,7 +288,22 @@ void RebuildObjectMapRequest::send_verify_objects() {
                                            m_image_ctx.get_image_size(snap_id));
   }
 
-  if (num_objects == 0) {
+  uint64_t verify_start = 0;
+  uint64_t verify_end = num_objects;
+  uint64_t hint_start;
+  uint64_t hint_end;
+  if (snap_id == CEPH_NOSNAP &&
+      cct->_conf->rbd_object_map_incremental_rebuild &&
+      m_image_ctx.object_map.get_rebuild_hint(&hint_start, &hint_end)) {
+    // only objects covered by failed map updates need re-verification --
+    // everything else was kept in sync while the map was flagged invalid
+    verify_start = MIN(hint_start, num_objects);
+    verify_end = MIN(hint_end, num_objects);
+    ldout(cct, 5) << this << " incremental rebuild: objects " << verify_start
+                  << "~" << (verify_end - verify_start) << dendl;
+  }
+
+  if (num_objects == 0 || verify_start >= verify_end) {
     send_save_object_map();
     return;
   }
@@ -301,7 +316,7 @@ void RebuildObjectMapRequest::send_verify_objects() {
       boost::lambda::_1, &m_image_ctx, snap_id, boost::lambda::_2));
   AsyncObjectThrottle *throttle = new AsyncObjectThrottle(
     this, m_image_ctx, context_factory, create_callback_context(), &m_prog_ctx,
-    0, num_objects);
+    verify_start, verify_end);
   throttle->start_ops(cct->_conf->rbd_concurrent_management_ops);
 }
 
@@ -335,6 +350,10 @@ void RebuildObjectMapRequest::send_update_header() {
 
   uint64_t flags = RBD_FLAG_OBJECT_MAP_INVALID | RBD_FLAG_FAST_DIFF_INVALID;
   cls_client::set_flags(&op, m_image_ctx.snap_id, 0, flags);
+  if (m_image_ctx.snap_id == CEPH_NOSNAP) {
+    // drop the incremental rebuild hint atomically with the flags
+    m_image_ctx.object_map.clear_rebuild_hint(&op);
+  }
 
   librados::AioCompletion *comp = create_callback_completion();
   int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp, &op);
@@ -0,0 +1,37 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#ifndef CEPH_LIBRBD_WRITESNAPCONTEXT_H
+#define CEPH_LIBRBD_WRITESNAPCONTEXT_H
+
+#include "include/int_types.h"
+
+#include <vector>
+
+#include "include/memory.h"
+#include "include/rados/librados.hpp"
+
+#include "common/snap_types.h"
+
+namespace librbd {
+
+  /**
+   * Immutable snapshot of the image's write snap context, pre-converted
+   * to the format librados expects.  A new instance is published (under
+   * ImageCtx::snap_lock) whenever the snap context changes; in-flight
+   * object requests keep a shared reference to the instance that was
+   * current when they were issued instead of copying the snap vector.
+   */
+  struct WriteSnapContext {
+    uint64_t seq;
+    std::vector<librados::snap_t> snaps;
+
+    WriteSnapContext() : seq(0) {}
+    explicit WriteSnapContext(const ::SnapContext &snapc)
+      : seq(snapc.seq.val),
+	snaps(snapc.snaps.begin(), snapc.snaps.end()) {}
+  };
+
+  typedef ceph::shared_ptr<const WriteSnapContext> WriteSnapContextRef;
+}
+
+#endif
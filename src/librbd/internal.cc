@@ -2072,6 +2072,7 @@ reprotect_and_return_err:
 
 	ictx->snapc.seq = snap_id;
 	ictx->snapc.snaps.swap(snaps);
+	ictx->update_write_snapc();
 	ictx->data_ctx.selfmanaged_snap_set_write_ctx(ictx->snapc.seq,
 						      ictx->snaps);
       }
@@ -2332,6 +2333,7 @@ reprotect_and_return_err:
       }
 
       ictx->snapc = new_snapc;
+      ictx->update_write_snapc();
 
       if (ictx->snap_id != CEPH_NOSNAP &&
 	  ictx->get_snap_id(ictx->snap_name) != ictx->snap_id) {
@@ -2828,7 +2830,7 @@ reprotect_and_return_err:
 
     uint64_t object_size;
     uint64_t overlap_objects;
-    ::SnapContext snapc;
+    WriteSnapContextRef snapc;
 
     {
       uint64_t overlap;
@@ -2849,7 +2851,7 @@ reprotect_and_return_err:
 	return -EROFS;
       }
 
-      snapc = ictx->snapc;
+      snapc = ictx->write_snapc;
       assert(ictx->parent != NULL);
       r = ictx->get_parent_overlap(CEPH_NOSNAP, &overlap);
       assert(r == 0);
@@ -3465,10 +3467,21 @@ reprotect_and_return_err:
 
   void aio_write(ImageCtx *ictx, uint64_t off, size_t len, const char *buf,
 		 AioCompletion *c, int op_flags)
+  {
+    bufferlist bl;
+    if (len > 0) {
+      bl.append(buf, len);
+    }
+    aio_write(ictx, off, len, bl, c, op_flags);
+  }
+
+  void aio_write(ImageCtx *ictx, uint64_t off, size_t len,
+		 const bufferlist &data_bl, AioCompletion *c, int op_flags)
   {
     CephContext *cct = ictx->cct;
     ldout(cct, 20) << "aio_write " << ictx << " off = " << off << " len = "
-		   << len << " buf = " << (void*)buf << dendl;
+		   << len << dendl;
+    assert(data_bl.length() >= len);
 
     c->get();
     int r = ictx_check(ictx);
@@ -3481,7 +3494,7 @@ reprotect_and_return_err:
     RWLock::RLocker md_locker(ictx->md_lock);
 
     uint64_t clip_len = len;
-    ::SnapContext snapc;
+    WriteSnapContextRef snapc;
     {
       // prevent image size from changing between computing clip and recording
       // pending async operation
@@ -3497,7 +3510,7 @@ reprotect_and_return_err:
         return;
       }
 
-      snapc = ictx->snapc;
+      snapc = ictx->write_snapc;
 
       c->init_time(ictx, AIO_TYPE_WRITE);
     }
@@ -3505,8 +3518,11 @@ reprotect_and_return_err:
     if (ictx->image_watcher->is_lock_supported() &&
 	!ictx->image_watcher->is_lock_owner()) {
       c->put();
+      typedef void (*aio_write_bl_t)(ImageCtx *, uint64_t, size_t,
+				     const bufferlist &, AioCompletion *, int);
       ictx->image_watcher->request_lock(
-	boost::bind(&librbd::aio_write, ictx, off, len, buf, _1, op_flags), c);
+	boost::bind(static_cast<aio_write_bl_t>(&librbd::aio_write), ictx, off,
+		    len, data_bl, _1, op_flags), c);
       return;
     }
 
@@ -3520,12 +3536,14 @@ reprotect_and_return_err:
     for (vector<ObjectExtent>::iterator p = extents.begin(); p != extents.end(); ++p) {
       ldout(cct, 20) << " oid " << p->oid << " " << p->offset << "~" << p->length
 		     << " from " << p->buffer_extents << dendl;
-      // assemble extent
+      // assemble extent without copying the data
       bufferlist bl;
       for (vector<pair<uint64_t,uint64_t> >::iterator q = p->buffer_extents.begin();
 	   q != p->buffer_extents.end();
 	   ++q) {
-	bl.append(buf + q->first, q->second);
+	bufferlist sub_bl;
+	sub_bl.substr_of(data_bl, q->first, q->second);
+	bl.claim_append(sub_bl);
       }
 
       C_AioWrite *req_comp = new C_AioWrite(cct, c);
@@ -3620,7 +3638,7 @@ reprotect_and_return_err:
     RWLock::RLocker md_locker(ictx->md_lock);
 
     uint64_t clip_len = len;
-    ::SnapContext snapc;
+    WriteSnapContextRef snapc;
     {
       // prevent image size from changing between computing clip and recording
       // pending async operation
@@ -3637,7 +3655,7 @@ reprotect_and_return_err:
       }
 
       // TODO: check for snap
-      snapc = ictx->snapc;
+      snapc = ictx->write_snapc;
 
       c->init_time(ictx, AIO_TYPE_DISCARD);
     }
@@ -3746,6 +3764,11 @@ reprotect_and_return_err:
     uint64_t readahead_offset = readahead_extent.first;
     uint64_t readahead_length = readahead_extent.second;
 
+    uint64_t stream_hits, stream_misses;
+    ictx->readahead.get_stream_counts(&stream_hits, &stream_misses);
+    ictx->perfcounter->set(l_librbd_readahead_stream_hits, stream_hits);
+    ictx->perfcounter->set(l_librbd_readahead_stream_misses, stream_misses);
+
     if (readahead_length > 0) {
       ldout(ictx->cct, 20) << "(readahead logical) " << readahead_offset << "~" << readahead_length << dendl;
       map<object_t,vector<ObjectExtent> > readahead_object_extents;
@@ -40,6 +40,8 @@ enum {
 
   l_librbd_readahead,
   l_librbd_readahead_bytes,
+  l_librbd_readahead_stream_hits,
+  l_librbd_readahead_stream_misses,
 
   l_librbd_last,
 };
@@ -197,6 +199,8 @@ namespace librbd {
 
   void aio_write(ImageCtx *ictx, uint64_t off, size_t len, const char *buf,
 		 AioCompletion *c, int op_flags);
+  void aio_write(ImageCtx *ictx, uint64_t off, size_t len,
+		 const bufferlist &data_bl, AioCompletion *c, int op_flags);
   void aio_discard(ImageCtx *ictx, uint64_t off, uint64_t len, AioCompletion *c);
   void aio_read(ImageCtx *ictx, uint64_t off, size_t len,
 	        char *buf, bufferlist *pbl, AioCompletion *c, int op_flags);
@@ -82,15 +82,25 @@ public:
     : m_ictx(ictx), m_off(off), m_len(len), m_buf(buf), m_comp(c),
       m_op_flags(op_flags) {
   }
+  C_AioWriteWQ(librbd::ImageCtx *ictx, uint64_t off, size_t len,
+               const bufferlist &bl, librbd::AioCompletion *c, int op_flags)
+    : m_ictx(ictx), m_off(off), m_len(len), m_buf(NULL), m_bl(bl), m_comp(c),
+      m_op_flags(op_flags) {
+  }
 protected:
   virtual void finish(int r) {
-    librbd::aio_write(m_ictx, m_off, m_len, m_buf, m_comp, m_op_flags);
+    if (m_buf != NULL) {
+      librbd::aio_write(m_ictx, m_off, m_len, m_buf, m_comp, m_op_flags);
+    } else {
+      librbd::aio_write(m_ictx, m_off, m_len, m_bl, m_comp, m_op_flags);
+    }
   }
 private:
   librbd::ImageCtx *m_ictx;
   uint64_t m_off;
   uint64_t m_len;
   const char *m_buf;
+  bufferlist m_bl;
   librbd::AioCompletion *m_comp;
   int m_op_flags;
 };
@@ -147,6 +157,17 @@ void submit_aio_write(librbd::ImageCtx *ictx, uint64_t off, size_t len,
   }
 }
 
+void submit_aio_write(librbd::ImageCtx *ictx, uint64_t off, size_t len,
+                      const bufferlist &bl, librbd::AioCompletion *c,
+                      int op_flags) {
+  if (ictx->non_blocking_aio) {
+    ictx->aio_work_queue->queue(new C_AioWriteWQ(ictx, off, len, bl, c,
+                                                 op_flags));
+  } else {
+    librbd::aio_write(ictx, off, len, bl, c, op_flags);
+  }
+}
+
 void submit_aio_discard(librbd::ImageCtx *ictx, uint64_t off, uint64_t len,
                         librbd::AioCompletion *c) {
   if (ictx->non_blocking_aio) {
@@ -1881,6 +1902,44 @@ extern "C" int rbd_aio_write2(rbd_image_t image, uint64_t off, size_t len,
   return 0;
 }
 
+extern "C" int rbd_aio_writev(rbd_image_t image, const struct iovec *iov,
+			      int iovcnt, uint64_t off, rbd_completion_t c)
+{
+  librbd::ImageCtx *ictx = (librbd::ImageCtx *)image;
+  librbd::RBD::AioCompletion *comp = (librbd::RBD::AioCompletion *)c;
+
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len + len < len) {
+      return -EINVAL;
+    }
+    len += iov[i].iov_len;
+  }
+
+  tracepoint(librbd, aio_write_enter, ictx, ictx->name.c_str(),
+	      ictx->snap_name.c_str(), ictx->read_only, off, len, NULL,
+	      comp->pc);
+
+  // reference the caller's segments directly -- the caller must keep them
+  // valid until the completion fires
+  bufferlist bl;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len > 0) {
+      bl.push_back(buffer::create_static(
+        iov[i].iov_len, static_cast<char *>(iov[i].iov_base)));
+    }
+  }
+  if (ictx->object_cacher != NULL) {
+    // the cache retains write buffers beyond the aio completion, after
+    // which the caller is free to reuse them -- take our one copy here
+    bl.rebuild();
+  }
+
+  submit_aio_write(ictx, off, len, bl, get_aio_completion(comp), 0);
+  tracepoint(librbd, aio_write_exit, 0);
+  return 0;
+}
+
 
 extern "C" int rbd_aio_discard(rbd_image_t image, uint64_t off, uint64_t len,
 			       rbd_completion_t c)
@@ -1917,6 +1976,35 @@ extern "C" int rbd_aio_read2(rbd_image_t image, uint64_t off, size_t len,
   return 0;
 }
 
+extern "C" int rbd_aio_readv(rbd_image_t image, const struct iovec *iov,
+			     int iovcnt, uint64_t off, rbd_completion_t c)
+{
+  librbd::ImageCtx *ictx = (librbd::ImageCtx *)image;
+  librbd::RBD::AioCompletion *comp = (librbd::RBD::AioCompletion *)c;
+
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len + len < len) {
+      return -EINVAL;
+    }
+    len += iov[i].iov_len;
+  }
+
+  tracepoint(librbd, aio_read_enter, ictx, ictx->name.c_str(),
+	      ictx->snap_name.c_str(), ictx->read_only, off, len, NULL,
+	      comp->pc);
+
+  // the result is scattered straight into the caller's segments on
+  // completion -- the iovec array must stay valid until then
+  librbd::AioCompletion *aio_comp = get_aio_completion(comp);
+  aio_comp->read_iov = iov;
+  aio_comp->read_iov_cnt = iovcnt;
+
+  submit_aio_read(ictx, off, len, NULL, NULL, aio_comp, 0);
+  tracepoint(librbd, aio_read_exit, 0);
+  return 0;
+}
+
 extern "C" int rbd_flush(rbd_image_t image)
 {
   librbd::ImageCtx *ictx = (librbd::ImageCtx *)image;
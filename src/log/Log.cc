@@ -161,8 +161,13 @@ void Log::submit_entry(Entry *e)
   while (m_new.m_len > m_max_new)
     pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
 
+  // the flusher drains the whole queue each pass, so it only needs a
+  // signal when the queue goes from empty to non-empty; skipping the
+  // rest saves a futex op per entry when logging is hot
+  bool was_empty = m_new.empty();
   m_new.enqueue(e);
-  pthread_cond_signal(&m_cond_flusher);
+  if (was_empty)
+    pthread_cond_signal(&m_cond_flusher);
   m_queue_mutex_holder = 0;
   pthread_mutex_unlock(&m_queue_mutex);
 }
@@ -227,26 +232,40 @@ void Log::_flush(EntryQueue *t, EntryQueue *requeue, bool crash)
       buflen += snprintf(buf + buflen, sizeof(buf)-buflen, " %lx %2d ",
 			(unsigned long)e->m_thread, e->m_prio);
 
-      // FIXME: this is slow
-      string s = e->get_str();
+      // gather the header and message into one buffer, so the common
+      // case is a single write(2) per line and no heap copy of the
+      // message out of the entry's streambuf
+      size_t msglen = e->m_streambuf.size();
+      size_t line_len = buflen + msglen;
+      char stack_line[4400];
+      char *dyn_line = NULL;
+      char *line = stack_line;
+      if (line_len + 1 > sizeof(stack_line)) {
+	dyn_line = new char[line_len + 1];
+	line = dyn_line;
+      }
+      memcpy(line, buf, buflen);
+      e->m_streambuf.copy_to(line + buflen);
 
       if (do_fd) {
-	int r = safe_write(m_fd, buf, buflen);
-	if (r >= 0)
-	  r = safe_write(m_fd, s.data(), s.size());
-	if (r >= 0)
-	  r = write(m_fd, "\n", 1);
+	line[line_len] = '\n';
+	int r = safe_write(m_fd, line, line_len + 1);
 	if (r < 0)
 	  cerr << "problem writing to " << m_log_file << ": " << cpp_strerror(r) << std::endl;
       }
 
+      if (do_syslog || do_stderr)
+	line[line_len] = '\0';
+
       if (do_syslog) {
-	syslog(LOG_USER, "%s%s", buf, s.c_str());
+	syslog(LOG_USER, "%s", line);
       }
 
       if (do_stderr) {
-	cerr << buf << s << std::endl;
+	cerr << line << std::endl;
       }
+
+      delete[] dyn_line;
     }
 
     requeue->enqueue(e);
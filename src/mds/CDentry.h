@@ -147,6 +147,7 @@ protected:
 
 public:
   elist<CDentry*>::item item_dirty;
+  elist<CDentry*>::item item_dir_dirty;
   elist<CDentry*>::item item_stray;
 
 protected:
@@ -181,6 +181,7 @@ ostream& CDir::print_db_line_prefix(ostream& out)
 
 CDir::CDir(CInode *in, frag_t fg, MDCache *mdcache, bool auth) :
   dirty_rstat_inodes(member_offset(CInode, dirty_rstat_item)),
+  dirty_dentries(member_offset(CDentry, item_dir_dirty)),
   item_dirty(this), item_new(this),
   pop_me(ceph_clock_now(g_ceph_context)),
   pop_nested(ceph_clock_now(g_ceph_context)),
@@ -636,7 +637,8 @@ void CDir::add_to_bloom(CDentry *dn)
       return;
     unsigned size = get_num_head_items() + get_num_snap_items();
     if (size < 100) size = 100;
-    bloom = new bloom_filter(size, 1.0 / size, 0);
+    // in-memory only, so we can use the cacheline-blocked layout
+    bloom = new bloom_filter(size, 1.0 / size, 0, true);
   }
   /* This size and false positive probability is completely random.*/
   bloom->insert(dn->name.c_str(), dn->name.size());
@@ -841,8 +843,10 @@ void CDir::steal_dentry(CDentry *dn)
     dn->dir->adjust_nested_auth_pins(-ap, -dap, NULL);
   }
 
-  if (dn->is_dirty()) 
+  if (dn->is_dirty()) {
     num_dirty++;
+    dirty_dentries.push_back(&dn->item_dir_dirty);
+  }
 
   dn->dir = this;
 }
@@ -977,9 +981,11 @@ void CDir::split(int bits, list<CDir*>& subs, list<MDSInternalContextBase*>& wai
   // repartition dentries
   while (!items.empty()) {
     CDir::map_t::iterator p = items.begin();
-    
+
     CDentry *dn = p->second;
-    frag_t subfrag = inode->pick_dirfrag(dn->name);
+    // the fragtree was already split by adjust_dir_fragments, and the
+    // dentry caches its name hash -- don't rehash every name here
+    frag_t subfrag = inode->dirfragtree[dn->hash];
     int n = (subfrag.value() & (subfrag.mask() ^ frag.mask())) >> subfrag.mask_shift();
     dout(15) << " subfrag " << subfrag << " n=" << n << " for " << p->first << dendl;
     CDir *f = subfrags[n];
@@ -1991,10 +1997,25 @@ void CDir::_omap_commit(int op_prio)
     stale_items.clear();
   }
 
-  for (map_t::iterator p = items.begin();
-      p != items.end(); ) {
-    CDentry *dn = p->second;
-    ++p;
+  // a snap purge or fragmentation has to visit every dentry in the
+  // fragment; otherwise only the dirty ones need to be written
+  bool walk_all = snaps || state_test(CDir::STATE_FRAGMENTING);
+
+  map_t::iterator p = items.begin();
+  elist<CDentry*>::iterator dp = dirty_dentries.begin();
+  while (true) {
+    CDentry *dn;
+    if (walk_all) {
+      if (p == items.end())
+	break;
+      dn = p->second;
+      ++p;
+    } else {
+      if (dp.end())
+	break;
+      dn = *dp;
+      ++dp;
+    }
 
     string key;
     dn->key().encode(key);
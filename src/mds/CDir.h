@@ -173,7 +173,10 @@ public:
   compact_map<snapid_t,old_rstat_t> dirty_old_rstat;  // [value.first,key]
 
   // my inodes with dirty rstat data
-  elist<CInode*> dirty_rstat_inodes;     
+  elist<CInode*> dirty_rstat_inodes;
+
+  // my dirty dentries, so that commit need not walk the whole fragment
+  elist<CDentry*> dirty_dentries;
 
   void resync_accounted_fragstat();
   void resync_accounted_rstat();
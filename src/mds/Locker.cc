@@ -3162,12 +3162,27 @@ void Locker::handle_client_cap_release(MClientCapRelease *m)
 
   Session *session = static_cast<Session *>(m->get_connection()->get_priv());
 
-  for (vector<ceph_mds_cap_item>::iterator p = m->caps.begin(); p != m->caps.end(); ++p) {
-    _do_cap_release(client, inodeno_t((uint64_t)p->ino) , p->cap_id, p->migrate_seq, p->seq);
+  // a client dropping its whole cache (e.g. on unmount) can send hundreds of
+  // thousands of releases; process a bounded batch per dispatch and requeue
+  // the rest so other work can interleave
+  unsigned num = cap_release_batch_size(g_conf->mds_max_cap_releases_per_dispatch,
+					m->caps.size());
+  for (unsigned i = 0; i < num; ++i) {
+    ceph_mds_cap_item& item = m->caps[i];
+    _do_cap_release(client, inodeno_t((uint64_t)item.ino), item.cap_id,
+		    item.migrate_seq, item.seq);
   }
 
   if (session) {
-    session->notify_cap_release(m->caps.size());
+    session->notify_cap_release(num);
+  }
+
+  if (num < m->caps.size()) {
+    dout(10) << "handle_client_cap_release processed " << num << "/"
+	     << m->caps.size() << ", requeueing remainder" << dendl;
+    m->caps.erase(m->caps.begin(), m->caps.begin() + num);
+    mds->queue_waiter(new C_MDS_RetryMessage(mds, m));
+    return;
   }
 
   m->put();
@@ -188,6 +188,12 @@ public:
   void get_late_revoking_clients(std::list<client_t> *result) const;
   bool any_late_revoking_caps(xlist<Capability*> const &revoking) const;
 
+  /// releases to process from one MClientCapRelease in one dispatch;
+  /// max == 0 means unbounded (process the whole message)
+  static unsigned cap_release_batch_size(unsigned max, unsigned total) {
+    return (max && max < total) ? max : total;
+  }
+
  protected:
   void adjust_cap_wanted(Capability *cap, int wanted, int issue_seq);
   void handle_client_caps(class MClientCaps *m);
@@ -266,8 +266,9 @@ bool MDCache::shutdown()
 void MDCache::add_inode(CInode *in) 
 {
   // add to lru, inode map
-  assert(inode_map.count(in->vino()) == 0);  // should be no dup inos!
-  inode_map[ in->vino() ] = in;
+  ceph::unordered_map<vinodeno_t,CInode*> &shard = inode_map_shard(in->vino());
+  assert(shard.count(in->vino()) == 0);  // should be no dup inos!
+  shard[ in->vino() ] = in;
 
   if (in->ino() < MDS_INO_SYSTEM_BASE) {
     if (in->ino() == MDS_INO_ROOT)
@@ -307,7 +308,7 @@ void MDCache::remove_inode(CInode *o)
   o->item_open_file.remove_myself();
 
   // remove from inode map
-  inode_map.erase(o->vino());    
+  inode_map_shard(o->vino()).erase(o->vino());
 
   if (o->ino() < MDS_INO_SYSTEM_BASE) {
     if (o == root) root = 0;
@@ -3679,8 +3680,9 @@ void MDCache::trim_unlinked_inodes()
 {
   dout(7) << "trim_unlinked_inodes" << dendl;
   list<CInode*> q;
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-       p != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map[s].begin();
+       p != inode_map[s].end();
        ++p) {
     CInode *in = p->second;
     if (in->get_parent_dn() == NULL && !in->is_base()) {
@@ -4476,8 +4478,9 @@ void MDCache::rejoin_scour_survivor_replicas(mds_rank_t from, MMDSCacheRejoin *a
 {
   dout(10) << "rejoin_scour_survivor_replicas from mds." << from << dendl;
 
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-       p != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map[s].begin();
+       p != inode_map[s].end();
        ++p) {
     CInode *in = p->second;
     
@@ -5366,8 +5369,9 @@ void MDCache::choose_lock_states_and_reconnect_caps()
 
   map<client_t,MClientSnap*> splits;
 
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator i = inode_map.begin();
-       i != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator i = inode_map[s].begin();
+       i != inode_map[s].end();
        ++i) {
     CInode *in = i->second;
  
@@ -5910,8 +5914,9 @@ void MDCache::reissue_all_caps()
 {
   dout(10) << "reissue_all_caps" << dendl;
 
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-       p != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map[s].begin();
+       p != inode_map[s].end();
        ++p) {
     CInode *in = p->second;
     if (in->is_head() && in->is_any_caps()) {
@@ -5995,8 +6000,9 @@ void MDCache::_queued_file_recover_cow(CInode *in, MutationRef& mut)
 void MDCache::identify_files_to_recover(vector<CInode*>& recover_q, vector<CInode*>& check_q)
 {
   dout(10) << "identify_files_to_recover" << dendl;
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-       p != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map[s].begin();
+       p != inode_map[s].end();
        ++p) {
     CInode *in = p->second;
     if (!in->is_auth())
@@ -6682,28 +6688,30 @@ void MDCache::trim_non_auth()
 
   if (lru.lru_get_size() == 0) {
     // root, stray, etc.?
-    ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-    while (p != inode_map.end()) {
-      ceph::unordered_map<vinodeno_t,CInode*>::iterator next = p;
-      ++next;
-      CInode *in = p->second;
-      if (!in->is_auth()) {
-	list<CDir*> ls;
-	in->get_dirfrags(ls);
-	for (list<CDir*>::iterator p = ls.begin();
-	     p != ls.end();
-	     ++p) {
-	  dout(10) << " removing " << **p << dendl;
-	  assert((*p)->get_num_ref() == 1);  // SUBTREE
-	  remove_subtree((*p));
-	  in->close_dirfrag((*p)->dirfrag().frag);
+    for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s) {
+      ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map[s].begin();
+      while (p != inode_map[s].end()) {
+	ceph::unordered_map<vinodeno_t,CInode*>::iterator next = p;
+	++next;
+	CInode *in = p->second;
+	if (!in->is_auth()) {
+	  list<CDir*> ls;
+	  in->get_dirfrags(ls);
+	  for (list<CDir*>::iterator p = ls.begin();
+	       p != ls.end();
+	       ++p) {
+	    dout(10) << " removing " << **p << dendl;
+	    assert((*p)->get_num_ref() == 1);  // SUBTREE
+	    remove_subtree((*p));
+	    in->close_dirfrag((*p)->dirfrag().frag);
+	  }
+	  dout(10) << " removing " << *in << dendl;
+	  assert(!in->get_parent_dn());
+	  assert(in->get_num_ref() == 0);
+	  remove_inode(in);
 	}
-	dout(10) << " removing " << *in << dendl;
-	assert(!in->get_parent_dn());
-	assert(in->get_num_ref() == 0);
-	remove_inode(in);
+	p = next;
       }
-      p = next;
     }
   }
 
@@ -7184,7 +7192,7 @@ void MDCache::check_memory_usage()
   static MemoryModel::snap baseline = last;
 
   // check client caps
-  int num_inodes = inode_map.size();
+  int num_inodes = get_num_inodes();
   float caps_per_inode = (float)num_caps / (float)num_inodes;
   //float cap_rate = (float)num_inodes_with_caps / (float)inode_map.size();
 
@@ -7195,7 +7203,7 @@ void MDCache::check_memory_usage()
 	   << ", malloc " << last.malloc << " mmap " << last.mmap
 	   << ", baseline " << baseline.get_heap()
 	   << ", buffers " << (buffer::get_total_alloc() >> 10)
-	   << ", " << num_inodes_with_caps << " / " << inode_map.size() << " inodes have caps"
+	   << ", " << num_inodes_with_caps << " / " << num_inodes << " inodes have caps"
 	   << ", " << num_caps << " caps, " << caps_per_inode << " caps per inode"
 	   << dendl;
 
@@ -11328,8 +11336,9 @@ void MDCache::force_readonly()
   mds->server->force_clients_readonly();
 
   // revoke write caps
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-       p != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map[s].begin();
+       p != inode_map[s].end();
        ++p) {
     CInode *in = p->second;
     if (in->is_head())
@@ -11480,9 +11489,10 @@ void MDCache::show_subtrees(int dbl)
 void MDCache::show_cache()
 {
   dout(7) << "show_cache" << dendl;
-  
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator it = inode_map.begin();
-       it != inode_map.end();
+
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator it = inode_map[s].begin();
+       it != inode_map[s].end();
        ++it) {
     // unlinked?
     if (!it->second->parent)
@@ -11545,8 +11555,9 @@ void MDCache::dump_cache(const char *fn, Formatter *f)
     }
   }
   
-  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator it = inode_map.begin();
-       it != inode_map.end();
+  for (unsigned s = 0; s < NUM_INODE_MAP_SHARDS; ++s)
+  for (ceph::unordered_map<vinodeno_t,CInode*>::iterator it = inode_map[s].begin();
+       it != inode_map[s].end();
        ++it) {
     CInode *in = it->second;
     if (f) {
@@ -122,7 +122,14 @@ class MDCache {
   // -- my cache --
   LRU lru;   // dentry lru for expiring items from cache
  protected:
-  ceph::unordered_map<vinodeno_t,CInode*> inode_map;  // map of inodes by ino
+  // the inode map is sharded by ino so that no single hash table grows to
+  // tens of millions of entries -- one monolithic map stalls the MDS for
+  // seconds (all under mds_lock) when it rehashes at large cache sizes
+  static const unsigned NUM_INODE_MAP_SHARDS = 32;
+  ceph::unordered_map<vinodeno_t,CInode*> inode_map[NUM_INODE_MAP_SHARDS];
+  ceph::unordered_map<vinodeno_t,CInode*>& inode_map_shard(vinodeno_t vino) {
+    return inode_map[vino.ino.val % NUM_INODE_MAP_SHARDS];
+  }
   CInode *root;                            // root inode
   CInode *myin;                            // .ceph/mds%d dir
 
@@ -242,7 +249,12 @@ public:
 
 
 public:
-  int get_num_inodes() { return inode_map.size(); }
+  int get_num_inodes() {
+    int n = 0;
+    for (unsigned i = 0; i < NUM_INODE_MAP_SHARDS; ++i)
+      n += inode_map[i].size();
+    return n;
+  }
   int get_num_dentries() { return lru.lru_get_size(); }
 
 
@@ -685,14 +697,16 @@ public:
 
   // inode_map
   bool have_inode(vinodeno_t vino) {
-    return inode_map.count(vino) ? true:false;
+    return get_inode(vino) != NULL;
   }
   bool have_inode(inodeno_t ino, snapid_t snap=CEPH_NOSNAP) {
     return have_inode(vinodeno_t(ino, snap));
   }
   CInode* get_inode(vinodeno_t vino) {
-    if (have_inode(vino))
-      return inode_map[vino];
+    ceph::unordered_map<vinodeno_t,CInode*> &shard = inode_map_shard(vino);
+    ceph::unordered_map<vinodeno_t,CInode*>::iterator p = shard.find(vino);
+    if (p != shard.end())
+      return p->second;
     return NULL;
   }
   CInode* get_inode(inodeno_t ino, snapid_t s=CEPH_NOSNAP) {
@@ -1109,11 +1123,20 @@ public:
   void show_subtrees(int dbl=10);
 
   CInode *hack_pick_random_inode() {
-    assert(!inode_map.empty());
-    int n = rand() % inode_map.size();
-    ceph::unordered_map<vinodeno_t,CInode*>::iterator p = inode_map.begin();
-    while (n--) ++p;
-    return p->second;
+    int total = get_num_inodes();
+    assert(total > 0);
+    int n = rand() % total;
+    for (unsigned i = 0; i < NUM_INODE_MAP_SHARDS; ++i) {
+      if (n < (int)inode_map[i].size()) {
+	ceph::unordered_map<vinodeno_t,CInode*>::iterator p =
+	  inode_map[i].begin();
+	while (n--) ++p;
+	return p->second;
+      }
+      n -= inode_map[i].size();
+    }
+    assert(0);
+    return NULL;
   }
   void scrub_dentry(const string& path, Formatter *f, Context *fin);
   void scrub_dentry_work(MDRequestRef& mdr);
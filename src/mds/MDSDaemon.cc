@@ -1063,6 +1063,18 @@ void MDSDaemon::respawn()
 
 
 
+/*
+ * All messages are handled under mds_lock.  Note that fast dispatch
+ * (processing on the messenger threads, ahead of the lock) is not a good
+ * fit here, tempting as it looks for client requests: session lookup,
+ * completed-request replay checks and stale-message triage all read
+ * SessionMap/mdsmap state that mds_lock guards, message decode already
+ * happens on the messenger side, and queueing requests separately from
+ * the session/caps messages on the same connection would break the
+ * per-connection ordering those paths rely on.  With a single messenger
+ * dispatch thread feeding us, a pre-lock queue would add reordering
+ * hazards without adding any parallelism.
+ */
 bool MDSDaemon::ms_dispatch(Message *m)
 {
   Mutex::Locker l(mds_lock);
@@ -205,6 +205,8 @@ struct MDRequestImpl : public MutationImpl, public TrackedOp {
   bool o_trunc;           ///< request is an O_TRUNC mutation
   bool has_completed;     ///< request has already completed
 
+  uint64_t dispatch_cycles;  ///< tsc cycles spent dispatching this request
+
   bufferlist reply_extra_bl;
 
   // inos we did a embedded cap release on, and may need to eval if we haven't since reissued
@@ -306,6 +308,7 @@ struct MDRequestImpl : public MutationImpl, public TrackedOp {
     tracei(NULL), tracedn(NULL), alloc_ino(0), used_prealloc_ino(0),
     snap_caps(0), getattr_caps(0),
     did_early_reply(false), o_trunc(false), has_completed(false),
+    dispatch_cycles(0),
     slave_request(NULL), internal_op(params.internal_op), internal_op_finish(NULL),
     internal_op_private(NULL),
     retry(0),
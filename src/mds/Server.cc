@@ -52,6 +52,7 @@
 
 #include "include/filepath.h"
 #include "common/errno.h"
+#include "common/Cycles.h"
 #include "common/Timer.h"
 #include "common/perf_counters.h"
 #include "include/compat.h"
@@ -286,8 +287,23 @@ void Server::handle_client_session(MClientSession *m)
     pv = mds->sessionmap.mark_projected(session);
     sseq = mds->sessionmap.set_state(session, Session::STATE_OPENING);
     mds->sessionmap.touch_session(session);
-    mdlog->start_submit_entry(new ESession(m->get_source_inst(), true, pv, m->client_meta),
-			      new C_MDS_session_finish(mds, session, sseq, true, pv));
+
+    {
+      // delegate the session's initial ino range up front and journal
+      // it with the ESession, so the first creates find their inos
+      // already preallocated instead of growing their own journal
+      // events with the delegation
+      interval_set<inodeno_t> inos;
+      version_t piv = 0;
+      int got = g_conf->mds_client_prealloc_inos - session->get_num_projected_prealloc_inos();
+      if (got > 0) {
+	mds->inotable->project_alloc_ids(inos, got);
+	session->pending_prealloc_inos.insert(inos);
+	piv = mds->inotable->get_projected_version();
+      }
+      mdlog->start_submit_entry(new ESession(m->get_source_inst(), true, pv, m->client_meta, inos, piv),
+				new C_MDS_session_finish(mds, session, sseq, true, pv, inos, piv));
+    }
     mdlog->flush();
     break;
 
@@ -378,7 +394,10 @@ void Server::_session_logged(Session *session, uint64_t state_seq, bool open, ve
   mds->sessionmap.mark_dirty(session);
 
   if (piv) {
-    mds->inotable->apply_release_ids(inos);
+    if (open)
+      mds->inotable->apply_alloc_ids(inos);
+    else
+      mds->inotable->apply_release_ids(inos);
     assert(mds->inotable->get_version() == piv);
   }
 
@@ -389,6 +408,10 @@ void Server::_session_logged(Session *session, uint64_t state_seq, bool open, ve
     // close must have been canceled (by an import?), or any number of other things..
   } else if (open) {
     assert(session->is_opening());
+    if (inos.size()) {
+      session->pending_prealloc_inos.subtract(inos);
+      session->info.prealloc_inos.insert(inos);
+    }
     mds->sessionmap.set_state(session, Session::STATE_OPEN);
     mds->sessionmap.touch_session(session);
     assert(session->connection != NULL);
@@ -1113,6 +1136,17 @@ void Server::reply_client_request(MDRequestRef& mdr, MClientReply *reply)
   CInode *tracei = mdr->tracei;
   CDentry *tracedn = mdr->tracedn;
 
+  // charge the measured dispatch cpu time back into popularity, so the
+  // balancer sees cost-weighted load rather than a bare request count
+  if (g_conf->mds_bal_cpu_weight > 0 && mdr->dispatch_cycles && tracei) {
+    CDentry *pdn = tracei->get_parent_dn();
+    if (pdn)
+      mds->balancer->hit_dir(ceph_clock_now(g_ceph_context), pdn->get_dir(),
+			     req->may_write() ? META_POP_IWR : META_POP_IRD, -1,
+			     Cycles::to_seconds(mdr->dispatch_cycles) *
+			     g_conf->mds_bal_cpu_weight);
+  }
+
   bool is_replay = mdr->client_request->is_replay();
   bool did_early_reply = mdr->did_early_reply;
   Session *session = mdr->session;
@@ -1477,6 +1511,10 @@ void Server::dispatch_client_request(MDRequestRef& mdr)
     }
   }
 
+  // time the handler so the balancer can weigh this request by measured
+  // cpu cost; a request may be dispatched several times, so accumulate
+  uint64_t start_cycles = Cycles::rdtsc();
+
   switch (req->get_op()) {
   case CEPH_MDS_OP_LOOKUPHASH:
   case CEPH_MDS_OP_LOOKUPINO:
@@ -1581,6 +1619,8 @@ void Server::dispatch_client_request(MDRequestRef& mdr)
     dout(1) << " unknown client op " << req->get_op() << dendl;
     respond_to_request(mdr, -EOPNOTSUPP);
   }
+
+  mdr->dispatch_cycles += Cycles::rdtsc() - start_cycles;
 }
 
 
@@ -3305,7 +3345,19 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
   }
   
   __u8 complete = (end && offset_str.empty());  // FIXME: what purpose does this serve
-  
+
+  // the client will ask for the next fragment as soon as it consumes this
+  // reply; start fetching it now so that request finds a complete dirfrag
+  if (end && !fg.is_rightmost()) {
+    frag_t nextfg = diri->dirfragtree[fg.next().value()];
+    CDir *nextdir = diri->get_dirfrag(nextfg);
+    if (nextdir && nextdir->is_auth() && !nextdir->is_complete() &&
+	nextdir->can_auth_pin()) {
+      dout(10) << " prefetching next frag " << *nextdir << dendl;
+      nextdir->fetch(0);
+    }
+  }
+
   // finish final blob
   ::encode(numfiles, dirbl);
   ::encode(end, dirbl);
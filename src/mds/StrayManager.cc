@@ -387,9 +387,15 @@ void StrayManager::_advance()
  */
 bool StrayManager::_consume(CDentry *dn, bool trunc, uint32_t ops_required)
 {
-  const int files_avail = g_conf->mds_max_purge_files - files_purging;
-
-  if (files_avail <= 0) {
+  // mds_max_purge_files is a floor, not a hard cap: if the op budget
+  // (which is scaled from the pool size) is mostly idle, admit more files
+  // so that a mass deletion of small files drains at the op limit instead
+  // of serializing behind the file count
+  uint64_t max_files = g_conf->mds_max_purge_files;
+  if (ops_required > 0 && ops_in_flight < max_purge_ops)
+    max_files = MAX(max_files, (max_purge_ops - ops_in_flight) / ops_required);
+
+  if (files_purging >= max_files) {
     dout(20) << __func__ << ": throttling on max files" << dendl;
     return false;
   } else {
@@ -50,6 +50,15 @@ class ESession : public LogEvent {
     open(o),
     cmapv(v),
     inos(i), inotablev(iv) { }
+  ESession(const entity_inst_t& inst, bool o, version_t v,
+	   const std::map<std::string, std::string> &cm,
+	   const interval_set<inodeno_t>& i, version_t iv) :
+    LogEvent(EVENT_SESSION),
+    client_inst(inst),
+    open(o),
+    cmapv(v),
+    inos(i), inotablev(iv),
+    client_metadata(cm) { }
 
   void encode(bufferlist& bl) const;
   void decode(bufferlist::iterator& bl);
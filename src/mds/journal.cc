@@ -194,11 +194,21 @@ void LogSegment::try_to_expire(MDSRank *mds, MDSGatherBuilder &gather_bld, int o
 
   assert(g_conf->mds_kill_journal_expire_at != 3);
 
-  // backtraces to be stored/updated
+  // backtraces to be stored/updated.  a rename-heavy segment can list tens
+  // of thousands of these; issue a bounded number of ops per pass.  stored
+  // backtraces drop off the list, so the expire retry submits the rest.
+  unsigned max_backtraces = g_conf->mds_log_max_backtraces_per_expire;
+  unsigned num_backtraces = 0;
   for (elist<CInode*>::iterator p = dirty_parent_inodes.begin(); !p.end(); ++p) {
     CInode *in = *p;
     assert(in->is_auth());
     if (in->can_auth_pin()) {
+      if (max_backtraces && num_backtraces >= max_backtraces) {
+	dout(15) << "try_to_expire hit backtrace op limit " << max_backtraces
+		 << ", deferring the rest" << dendl;
+	break;
+      }
+      num_backtraces++;
       dout(15) << "try_to_expire waiting for storing backtrace on " << *in << dendl;
       in->store_backtrace(gather_bld.new_sub(), op_prio);
     } else {
@@ -1636,6 +1646,8 @@ void ESession::replay(MDSRank *mds)
       session = mds->sessionmap.get_or_add_session(client_inst);
       mds->sessionmap.set_state(session, Session::STATE_OPEN);
       session->set_client_metadata(client_metadata);
+      if (inos.size() && inotablev)
+	session->info.prealloc_inos.insert(inos);
       dout(10) << " opened session " << session->info.inst << dendl;
     } else {
       session = mds->sessionmap.get_session(client_inst.name);
@@ -1668,8 +1680,10 @@ void ESession::replay(MDSRank *mds)
     } else {
       dout(10) << "ESession.replay inotable " << mds->inotable->get_version()
 	       << " < " << inotablev << " " << (open ? "add":"remove") << dendl;
-      assert(!open);  // for now
-      mds->inotable->replay_release_ids(inos);
+      if (open)
+	mds->inotable->replay_alloc_ids(inos);
+      else
+	mds->inotable->replay_release_ids(inos);
       assert(mds->inotable->get_version() == inotablev);
     }
   }
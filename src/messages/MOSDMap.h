@@ -26,10 +26,18 @@ class MOSDMap : public Message {
 
  public:
   uuid_d fsid;
+  uint64_t encode_features;  // features the map blobs were encoded with, if known
   map<epoch_t, bufferlist> maps;
   map<epoch_t, bufferlist> incremental_maps;
   epoch_t oldest_map, newest_map;
 
+  // the feature bits that affect how the map blobs themselves are
+  // encoded; differences in any other features never force a reencode
+  static uint64_t get_map_features(uint64_t f) {
+    return f & (CEPH_FEATURE_PGID64 | CEPH_FEATURE_PGPOOL3 |
+		CEPH_FEATURE_OSDENC | CEPH_FEATURE_OSDMAP_ENC);
+  }
+
   epoch_t get_first() const {
     epoch_t e = 0;
     map<epoch_t, bufferlist>::const_iterator i = maps.begin();
@@ -56,10 +64,11 @@ class MOSDMap : public Message {
   }
 
 
-  MOSDMap() : Message(CEPH_MSG_OSD_MAP, HEAD_VERSION) { }
-  MOSDMap(const uuid_d &f)
+  MOSDMap() : Message(CEPH_MSG_OSD_MAP, HEAD_VERSION),
+	      encode_features(0) { }
+  MOSDMap(const uuid_d &f, uint64_t ef=0)
     : Message(CEPH_MSG_OSD_MAP, HEAD_VERSION),
-      fsid(f),
+      fsid(f), encode_features(ef),
       oldest_map(0), newest_map(0) { }
 private:
   ~MOSDMap() {}
@@ -92,34 +101,41 @@ public:
       else if ((features & CEPH_FEATURE_OSDENC) == 0)
 	header.version = 2;  // old pg_pool_t
 
-      // reencode maps using old format
-      //
-      // FIXME: this can probably be done more efficiently higher up
-      // the stack, or maybe replaced with something that only
-      // includes the pools the client cares about.
-      for (map<epoch_t,bufferlist>::iterator p = incremental_maps.begin();
-	   p != incremental_maps.end();
-	   ++p) {
-	OSDMap::Incremental inc;
-	bufferlist::iterator q = p->second.begin();
-	inc.decode(q);
-	p->second.clear();
-	if (inc.fullmap.length()) {
-	  // embedded full map?
+      if (encode_features &&
+	  get_map_features(encode_features) == get_map_features(features)) {
+	// whoever built this message already encoded the blobs for this
+	// class of client (e.g. via the mon's reencode cache); don't
+	// decode and reencode them all over again here.
+      } else {
+	// reencode maps using old format
+	//
+	// FIXME: this can probably be done more efficiently higher up
+	// the stack, or maybe replaced with something that only
+	// includes the pools the client cares about.
+	for (map<epoch_t,bufferlist>::iterator p = incremental_maps.begin();
+	     p != incremental_maps.end();
+	     ++p) {
+	  OSDMap::Incremental inc;
+	  bufferlist::iterator q = p->second.begin();
+	  inc.decode(q);
+	  p->second.clear();
+	  if (inc.fullmap.length()) {
+	    // embedded full map?
+	    OSDMap m;
+	    m.decode(inc.fullmap);
+	    inc.fullmap.clear();
+	    m.encode(inc.fullmap, features);
+	  }
+	  inc.encode(p->second, features);
+	}
+	for (map<epoch_t,bufferlist>::iterator p = maps.begin();
+	     p != maps.end();
+	     ++p) {
 	  OSDMap m;
-	  m.decode(inc.fullmap);
-	  inc.fullmap.clear();
-	  m.encode(inc.fullmap, features);
+	  m.decode(p->second);
+	  p->second.clear();
+	  m.encode(p->second, features);
 	}
-	inc.encode(p->second, features);
-      }
-      for (map<epoch_t,bufferlist>::iterator p = maps.begin();
-	   p != maps.end();
-	   ++p) {
-	OSDMap m;
-	m.decode(p->second);
-	p->second.clear();
-	m.encode(p->second, features);
       }
     }
     ::encode(incremental_maps, payload);
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Red Hat
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MOSDNETPING_H
+#define CEPH_MOSDNETPING_H
+
+#include "common/Clock.h"
+
+#include "msg/Message.h"
+
+/*
+ * Network self-test probe, sent over the *cluster* messenger (not the
+ * heartbeat messengers) so that it exercises the same connection and
+ * serialization path that replication traffic uses.  A PING may carry
+ * a bulk data payload for throughput measurement; the PING_REPLY
+ * echoes the probe id, sequence number and stamp but not the payload.
+ *
+ * Unlike MOSDPing we deliberately keep the default message priority:
+ * the point is to measure how probe bytes fare on the path client data
+ * takes, not to jump the queue the way failure detection does.
+ */
+class MOSDNetPing : public Message {
+
+  static const int HEAD_VERSION = 1;
+  static const int COMPAT_VERSION = 1;
+
+ public:
+  enum {
+    PING = 0,
+    PING_REPLY = 1,
+  };
+  const char *get_op_name(int op) const {
+    switch (op) {
+    case PING: return "ping";
+    case PING_REPLY: return "ping_reply";
+    default: return "???";
+    }
+  }
+
+  uuid_d fsid;
+  __u8 op;
+  uint64_t probe_id;    ///< distinguishes probes; stale replies are dropped
+  uint64_t seq;         ///< sequence within the probe
+  utime_t stamp;        ///< sender's send time, echoed in the reply
+
+  MOSDNetPing(const uuid_d& f, __u8 o, uint64_t pid, uint64_t s, utime_t t)
+    : Message(MSG_OSD_NET_PING, HEAD_VERSION, COMPAT_VERSION),
+      fsid(f), op(o), probe_id(pid), seq(s), stamp(t)
+  { }
+  MOSDNetPing()
+    : Message(MSG_OSD_NET_PING, HEAD_VERSION, COMPAT_VERSION),
+      op(0), probe_id(0), seq(0)
+  {}
+private:
+  ~MOSDNetPing() {}
+
+public:
+  void decode_payload() {
+    bufferlist::iterator p = payload.begin();
+    ::decode(fsid, p);
+    ::decode(op, p);
+    ::decode(probe_id, p);
+    ::decode(seq, p);
+    ::decode(stamp, p);
+  }
+  void encode_payload(uint64_t features) {
+    ::encode(fsid, payload);
+    ::encode(op, payload);
+    ::encode(probe_id, payload);
+    ::encode(seq, payload);
+    ::encode(stamp, payload);
+  }
+
+  const char *get_type_name() const { return "osd_net_ping"; }
+  void print(ostream& out) const {
+    out << "osd_net_ping(" << get_op_name(op)
+	<< " probe " << probe_id
+	<< " seq " << seq
+	<< " stamp " << stamp
+	<< " payload " << data.length()
+	<< ")";
+  }
+};
+
+#endif
@@ -58,6 +58,9 @@ private:
 
   osd_reqid_t reqid; // reqid explicitly set by sender
 
+  __u32 partial_decode_off; // where decode_payload() stopped
+  bool final_decode_needed; // true until finish_decode() runs
+
 public:
   friend class MOSDOpReply;
 
@@ -101,7 +104,8 @@ public:
   utime_t get_mtime() { return mtime; }
 
   MOSDOp()
-    : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION) { }
+    : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION),
+      partial_decode_off(0), final_decode_needed(false) { }
   MOSDOp(int inc, long tid,
          object_t& _oid, object_locator_t& _oloc, pg_t& _pgid, epoch_t _osdmap_epoch,
 	 int _flags, uint64_t feat)
@@ -109,7 +113,8 @@ public:
       client_inc(inc),
       osdmap_epoch(_osdmap_epoch), flags(_flags), retry_attempt(-1),
       oid(_oid), oloc(_oloc), pgid(_pgid),
-      features(feat) {
+      features(feat),
+      partial_decode_off(0), final_decode_needed(false) {
     set_tid(tid);
   }
 private:
@@ -320,8 +325,13 @@ struct ceph_osd_request_head {
       retry_attempt = -1;
       features = 0;
       reqid = osd_reqid_t();
+
+      OSDOp::split_osd_op_vector_in_data(ops, data);
+      final_decode_needed = false;
     } else {
-      // new decode 
+      // new decode: just the fields we need to route the op.  the
+      // rest waits for finish_decode() on whatever thread ends up
+      // consuming the message.
       ::decode(client_inc, p);
       ::decode(osdmap_epoch, p);
       ::decode(flags, p);
@@ -340,34 +350,48 @@ struct ceph_osd_request_head {
 
       ::decode(oid, p);
 
-      //::decode(ops, p);
-      __u16 num_ops;
-      ::decode(num_ops, p);
-      ops.resize(num_ops);
-      for (unsigned i = 0; i < num_ops; i++)
-	::decode(ops[i].op, p);
-
-      ::decode(snapid, p);
-      ::decode(snap_seq, p);
-      ::decode(snaps, p);
-
-      if (header.version >= 4)
-	::decode(retry_attempt, p);
-      else
-	retry_attempt = -1;
-
-      if (header.version >= 5)
-	::decode(features, p);
-      else
-	features = 0;
-
-      if (header.version >= 6)
-	::decode(reqid, p);
-      else
-	reqid = osd_reqid_t();
+      partial_decode_off = p.get_off();
+      final_decode_needed = true;
     }
+  }
+
+  bool supports_lazy_decode() const { return true; }
+
+  void finish_decode() {
+    if (!final_decode_needed)
+      return;
+    assert(header.version >= 2);
+    bufferlist::iterator p = payload.begin();
+    p.advance(partial_decode_off);
+
+    //::decode(ops, p);
+    __u16 num_ops;
+    ::decode(num_ops, p);
+    ops.resize(num_ops);
+    for (unsigned i = 0; i < num_ops; i++)
+      ::decode(ops[i].op, p);
+
+    ::decode(snapid, p);
+    ::decode(snap_seq, p);
+    ::decode(snaps, p);
+
+    if (header.version >= 4)
+      ::decode(retry_attempt, p);
+    else
+      retry_attempt = -1;
+
+    if (header.version >= 5)
+      ::decode(features, p);
+    else
+      features = 0;
+
+    if (header.version >= 6)
+      ::decode(reqid, p);
+    else
+      reqid = osd_reqid_t();
 
     OSDOp::split_osd_op_vector_in_data(ops, data);
+    final_decode_needed = false;
   }
 
   void clear_buffers() {
@@ -382,6 +406,14 @@ struct ceph_osd_request_head {
       out << oloc.nspace << "/";
     out << oid;
 
+    if (final_decode_needed) {
+      // the interesting bits are still sitting in the payload
+      out << " (undecoded) " << pgid
+	  << " " << ceph_osd_flag_string(get_flags())
+	  << " e" << osdmap_epoch << ")";
+      return;
+    }
+
 #if 0
     out << " ";
     if (may_read())
@@ -56,7 +56,10 @@ class MOSDPing : public Message {
   MOSDPing(const uuid_d& f, epoch_t e, __u8 o, utime_t s)
     : Message(MSG_OSD_PING, HEAD_VERSION, COMPAT_VERSION),
       fsid(f), map_epoch(e), peer_as_of_epoch(0), op(o), stamp(s)
-  { }
+  {
+    // failure detection should never queue behind anything
+    set_priority(CEPH_MSG_PRIO_HIGHEST);
+  }
   MOSDPing()
     : Message(MSG_OSD_PING, HEAD_VERSION, COMPAT_VERSION)
   {}
@@ -22,6 +22,8 @@ class MPGStats : public PaxosServiceMessage {
 public:
   uuid_d fsid;
   map<pg_t,pg_stat_t> pg_stat;
+  /// pre-encoded pg_stat_t values, spliced in alongside pg_stat
+  map<pg_t,bufferlist> pg_stat_enc;
   osd_stat_t osd_stat;
   epoch_t epoch;
   utime_t had_map_for;
@@ -40,14 +42,31 @@ private:
 public:
   const char *get_type_name() const { return "pg_stats"; }
   void print(ostream& out) const {
-    out << "pg_stats(" << pg_stat.size() << " pgs tid " << get_tid() << " v " << version << ")";
+    out << "pg_stats(" << (pg_stat.size() + pg_stat_enc.size())
+	<< " pgs tid " << get_tid() << " v " << version << ")";
   }
 
   void encode_payload(uint64_t features) {
     paxos_encode();
     ::encode(fsid, payload);
     ::encode(osd_stat, payload);
-    ::encode(pg_stat, payload);
+    // splice the pre-encoded values in alongside pg_stat; the wire
+    // format is identical to encoding one combined map, so the
+    // receiver just decodes map<pg_t,pg_stat_t>
+    __u32 n = pg_stat.size() + pg_stat_enc.size();
+    ::encode(n, payload);
+    for (map<pg_t,pg_stat_t>::iterator p = pg_stat.begin();
+	 p != pg_stat.end();
+	 ++p) {
+      ::encode(p->first, payload);
+      ::encode(p->second, payload);
+    }
+    for (map<pg_t,bufferlist>::iterator p = pg_stat_enc.begin();
+	 p != pg_stat_enc.end();
+	 ++p) {
+      ::encode(p->first, payload);
+      payload.append(p->second);
+    }
     ::encode(epoch, payload);
     ::encode(had_map_for, payload);
   }
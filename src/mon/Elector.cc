@@ -120,10 +120,21 @@ void Elector::defer(int who)
 
 void Elector::reset_timer(double plus)
 {
+  /**
+   * This class is responsible for casting the election timer; the
+   * full interval is the grace period for ranks lower than ours to
+   * counter-propose before we declare victory with a mere majority.
+   * We cannot shortcut it: a mon that already acked us will re-defer
+   * to a lower-ranked proposer in the same epoch, so overlapping
+   * majorities with conflicting acks are possible and only the
+   * everyone-acked case (see handle_ack) is exclusive.  Sites that
+   * care about failover latency tune mon_election_timeout down
+   * instead of piggybacking on the lease interval.
+   */
   // set the timer
   cancel_timer();
   expire_event = new C_ElectionExpire(this);
-  mon->timer.add_event_after(g_conf->mon_lease + plus,
+  mon->timer.add_event_after(g_conf->mon_election_timeout + plus,
 			     expire_event);
 }
 
@@ -656,8 +656,11 @@ void MonClient::_reopen_session(int rank, string name)
   ::encode(global_id, m->auth_payload);
   _send_mon_message(m, true);
 
-  if (!sub_have.empty())
+  // resubscribe from scratch on the new session
+  if (!sub_sent.empty() || !sub_new.empty()) {
+    _sub_renew_all();
     _renew_subs();
+  }
 }
 
 
@@ -710,8 +713,12 @@ void MonClient::tick()
 		   << "; renew after: " << sub_renew_after << ") -- " 
 		   << (now > sub_renew_after ? "yes" : "no") 
 		   << dendl;
-    if (now > sub_renew_after)
+    if (now > sub_renew_after) {
+      // lease refresh: the mon times out subs it hasn't heard about,
+      // so this one has to carry the full set
+      _sub_renew_all();
       _renew_subs();
+    }
 
     cur_con->send_keepalive();
 
@@ -748,7 +755,7 @@ void MonClient::schedule_tick()
 void MonClient::_renew_subs()
 {
   assert(monc_lock.is_locked());
-  if (sub_have.empty()) {
+  if (sub_new.empty()) {
     ldout(cct, 10) << "renew_subs - empty" << dendl;
     return;
   }
@@ -760,9 +767,17 @@ void MonClient::_renew_subs()
     if (sub_renew_sent == utime_t())
       sub_renew_sent = ceph_clock_now(cct);
 
+    // only send the delta; anything in sub_sent is already registered
+    // with the mon and refreshed on the renew interval
     MMonSubscribe *m = new MMonSubscribe;
-    m->what = sub_have;
+    m->what = sub_new;
     _send_mon_message(m);
+
+    for (map<string,ceph_mon_subscribe_item>::iterator p = sub_new.begin();
+	 p != sub_new.end();
+	 ++p)
+      sub_sent[p->first] = p->second;
+    sub_new.clear();
   }
 }
 
@@ -4154,6 +4154,15 @@ void Monitor::handle_timecheck(MonOpRequestRef op)
   }
 }
 
+/*
+ * Note that subscriptions are (deliberately) handled by whichever
+ * monitor the client happens to be connected to, leader or peon; the
+ * maps we hand out are committed, which the paxos lease makes safe to
+ * read on a peon.  Since clients pick their monitor (pseudo)randomly,
+ * this spreads the post-epoch-change map fan-out across the whole
+ * quorum instead of funneling it through the leader like proper
+ * updates.  Don't "fix" this by forwarding subscriptions.
+ */
 void Monitor::handle_subscribe(MonOpRequestRef op)
 {
   MMonSubscribe *m = static_cast<MMonSubscribe*>(op->get_req());
@@ -4203,8 +4212,6 @@ void Monitor::handle_subscribe(MonOpRequestRef op)
     }
   }
 
-  // ???
-
   if (reply)
     m->get_connection()->send_message(new MMonSubscribeAck(monmap->get_fsid(), (int)g_conf->mon_subscribe_interval));
 
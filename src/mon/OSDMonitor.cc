@@ -76,6 +76,8 @@ OSDMonitor::OSDMonitor(CephContext *cct, Monitor *mn, Paxos *p, const string& se
  : PaxosService(mn, p, service_name),
    inc_osd_cache(g_conf->mon_osd_cache_size),
    full_osd_cache(g_conf->mon_osd_cache_size),
+   inc_osd_reencode_cache(g_conf->mon_osd_cache_size),
+   full_osd_reencode_cache(g_conf->mon_osd_cache_size),
    thrash_map(0), thrash_last_up_osd(-1),
    op_tracker(cct, true, 1)
 {}
@@ -1218,7 +1220,8 @@ void OSDMonitor::share_map_with_random_osd()
 
   dout(10) << "committed, telling random " << s->inst << " all about it" << dendl;
   // whatev, they'll request more if they need it
-  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch());
+  MOSDMap *m = build_incremental(osdmap.get_epoch() - 1, osdmap.get_epoch(),
+				 s->con->get_features());
   s->con->send_message(m);
   // NOTE: do *not* record osd has up to this epoch (as we do
   // elsewhere) as they may still need to request older values.
@@ -2343,25 +2346,25 @@ void OSDMonitor::send_latest(MonOpRequestRef op, epoch_t start)
 }
 
 
-MOSDMap *OSDMonitor::build_latest_full()
+MOSDMap *OSDMonitor::build_latest_full(uint64_t features)
 {
-  MOSDMap *r = new MOSDMap(mon->monmap->fsid);
-  get_version_full(osdmap.get_epoch(), r->maps[osdmap.get_epoch()]);
+  MOSDMap *r = new MOSDMap(mon->monmap->fsid, features);
+  get_version_full(osdmap.get_epoch(), features, r->maps[osdmap.get_epoch()]);
   r->oldest_map = get_first_committed();
   r->newest_map = osdmap.get_epoch();
   return r;
 }
 
-MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
+MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to, uint64_t features)
 {
   dout(10) << "build_incremental [" << from << ".." << to << "]" << dendl;
-  MOSDMap *m = new MOSDMap(mon->monmap->fsid);
+  MOSDMap *m = new MOSDMap(mon->monmap->fsid, features);
   m->oldest_map = get_first_committed();
   m->newest_map = osdmap.get_epoch();
 
   for (epoch_t e = to; e >= from && e > 0; e--) {
     bufferlist bl;
-    int err = get_version(e, bl);
+    int err = get_version(e, features, bl);
     if (err == 0) {
       assert(bl.length());
       // if (get_version(e, bl) > 0) {
@@ -2371,7 +2374,7 @@ MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to)
     } else {
       assert(err == -ENOENT);
       assert(!bl.length());
-      get_version_full(e, bl);
+      get_version_full(e, features, bl);
       if (bl.length() > 0) {
       //else if (get_version("full", e, bl) > 0) {
       dout(20) << "build_incremental   full " << e << " "
@@ -2389,7 +2392,7 @@ void OSDMonitor::send_full(MonOpRequestRef op)
 {
   op->mark_osdmon_event(__func__);
   dout(5) << "send_full to " << op->get_req()->get_orig_source_inst() << dendl;
-  mon->send_reply(op, build_latest_full());
+  mon->send_reply(op, build_latest_full(op->get_session()->con->get_features()));
 }
 
 void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
@@ -2409,6 +2412,8 @@ void OSDMonitor::send_incremental(epoch_t first,
   dout(5) << "send_incremental [" << first << ".." << osdmap.get_epoch() << "]"
 	  << " to " << session->inst << dendl;
 
+  uint64_t features = session->con->get_features();
+
   if (first <= session->osd_epoch) {
     dout(10) << __func__ << session->inst << " should already have epoch "
 	     << session->osd_epoch << dendl;
@@ -2418,14 +2423,14 @@ void OSDMonitor::send_incremental(epoch_t first,
   if (first < get_first_committed()) {
     first = get_first_committed();
     bufferlist bl;
-    int err = get_version_full(first, bl);
+    int err = get_version_full(first, features, bl);
     assert(err == 0);
     assert(bl.length());
 
     dout(20) << "send_incremental starting with base full "
 	     << first << " " << bl.length() << " bytes" << dendl;
 
-    MOSDMap *m = new MOSDMap(osdmap.get_fsid());
+    MOSDMap *m = new MOSDMap(osdmap.get_fsid(), features);
     m->oldest_map = first;
     m->newest_map = osdmap.get_epoch();
     m->maps[first] = bl;
@@ -2443,7 +2448,7 @@ void OSDMonitor::send_incremental(epoch_t first,
 
   while (first <= osdmap.get_epoch()) {
     epoch_t last = MIN(first + g_conf->osd_map_message_max, osdmap.get_epoch());
-    MOSDMap *m = build_incremental(first, last);
+    MOSDMap *m = build_incremental(first, last, features);
 
     if (req) {
       // send some maps.  it may not be all of them, but it will get them
@@ -2485,6 +2490,59 @@ int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
     return ret;
 }
 
+int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
+{
+  uint64_t sig = MOSDMap::get_map_features(features);
+  if (sig == MOSDMap::get_map_features((uint64_t)-1))
+    return get_version(ver, bl);  // canonical encoding will do
+
+  if (inc_osd_reencode_cache.lookup(make_pair(ver, sig), &bl))
+    return 0;
+
+  bufferlist orig;
+  int ret = get_version(ver, orig);
+  if (ret)
+    return ret;
+
+  // reencode for this class of old client, once, and share the result
+  // with everyone else at the same feature level
+  OSDMap::Incremental inc;
+  bufferlist::iterator q = orig.begin();
+  inc.decode(q);
+  if (inc.fullmap.length()) {
+    // embedded full map?
+    OSDMap m;
+    m.decode(inc.fullmap);
+    inc.fullmap.clear();
+    m.encode(inc.fullmap, features);
+  }
+  inc.encode(bl, features);
+  inc_osd_reencode_cache.add(make_pair(ver, sig), bl);
+  return 0;
+}
+
+int OSDMonitor::get_version_full(version_t ver, uint64_t features,
+				 bufferlist& bl)
+{
+  uint64_t sig = MOSDMap::get_map_features(features);
+  if (sig == MOSDMap::get_map_features((uint64_t)-1))
+    return get_version_full(ver, bl);
+
+  if (full_osd_reencode_cache.lookup(make_pair(ver, sig), &bl))
+    return 0;
+
+  bufferlist orig;
+  int ret = get_version_full(ver, orig);
+  if (ret)
+    return ret;
+
+  OSDMap m;
+  m.decode(orig);
+  m.encode(bl, features);
+  full_osd_reencode_cache.add(make_pair(ver, sig), bl);
+  return 0;
+}
+
 epoch_t OSDMonitor::blacklist(const entity_addr_t& a, utime_t until)
 {
   dout(10) << "blacklist " << a << " until " << until << dendl;
@@ -2515,7 +2573,8 @@ void OSDMonitor::check_sub(Subscription *sub)
     if (sub->next >= 1)
       send_incremental(sub->next, sub->session, sub->incremental_onetime);
     else
-      sub->session->con->send_message(build_latest_full());
+      sub->session->con->send_message(
+	  build_latest_full(sub->session->con->get_features()));
     if (sub->onetime)
       mon->session_map.remove_sub(sub);
     else
@@ -2882,7 +2941,7 @@ namespace {
     CACHE_MIN_FLUSH_AGE, CACHE_MIN_EVICT_AGE,
     ERASURE_CODE_PROFILE, MIN_READ_RECENCY_FOR_PROMOTE,
     WRITE_FADVISE_DONTNEED, MIN_WRITE_RECENCY_FOR_PROMOTE,
-    FAST_READ};
+    FAST_READ, QOS_MAX_IOPS, QOS_MAX_BPS};
 
   std::set<osd_pool_get_choices>
     subtract_second_from_first(const std::set<osd_pool_get_choices>& first,
@@ -3353,7 +3412,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       ("min_read_recency_for_promote", MIN_READ_RECENCY_FOR_PROMOTE)
       ("write_fadvise_dontneed", WRITE_FADVISE_DONTNEED)
       ("min_write_recency_for_promote", MIN_WRITE_RECENCY_FOR_PROMOTE)
-      ("fast_read", FAST_READ);
+      ("fast_read", FAST_READ)
+      ("qos_max_iops", QOS_MAX_IOPS)
+      ("qos_max_bps", QOS_MAX_BPS);
 
     typedef std::set<osd_pool_get_choices> choices_set_t;
 
@@ -3512,6 +3573,12 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
           case FAST_READ:
             f->dump_int("fast_read", p->fast_read);
             break;
+	  case QOS_MAX_IOPS:
+	    f->dump_unsigned("qos_max_iops", p->qos_max_iops);
+	    break;
+	  case QOS_MAX_BPS:
+	    f->dump_unsigned("qos_max_bps", p->qos_max_bps);
+	    break;
 	}
 	f->close_section();
 	f->flush(rdata);
@@ -3613,6 +3680,12 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
           case FAST_READ:
             ss << "fast_read: " << p->fast_read << "\n";
             break;
+	  case QOS_MAX_IOPS:
+	    ss << "qos_max_iops: " << p->qos_max_iops << "\n";
+	    break;
+	  case QOS_MAX_BPS:
+	    ss << "qos_max_bps: " << p->qos_max_bps << "\n";
+	    break;
 	}
 	rdata.append(ss.str());
 	ss.str("");
@@ -4846,7 +4919,18 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
     }
     p.crush_ruleset = n;
   } else if (var == "hashpspool" || var == "nodelete" || var == "nopgchange" ||
-	     var == "nosizechange") {
+	     var == "nosizechange" || var == "compress") {
+    if (var == "compress" && !p.is_replicated()) {
+      ss << "compress is only supported on replicated pools";
+      return -EINVAL;
+    }
+    if (var == "compress" && (p.is_tier() || p.has_tiers()) &&
+	(val == "true" || (interr.empty() && n == 1))) {
+      // copy-get cannot read compressed objects, so promotion and
+      // flush between the tiers would permanently fail
+      ss << "compress cannot be set on a pool in a cache tier relationship";
+      return -EINVAL;
+    }
     uint64_t flag = pg_pool_t::get_flag_by_name(var);
     // make sure we only compare against 'n' if we didn't receive a string
     if (val == "true" || (interr.empty() && n == 1)) {
@@ -5001,6 +5085,26 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
     } else if (val == "false" || (interr.empty() && n == 0)) {
       p.fast_read = false;
     }
+  } else if (var == "qos_max_iops") {
+    if (interr.length()) {
+      ss << "error parsing int '" << val << "': " << interr;
+      return -EINVAL;
+    }
+    if (n < 0) {
+      ss << "qos_max_iops must be >= 0 (0 = unlimited)";
+      return -EINVAL;
+    }
+    p.qos_max_iops = n;
+  } else if (var == "qos_max_bps") {
+    if (interr.length()) {
+      ss << "error parsing int '" << val << "': " << interr;
+      return -EINVAL;
+    }
+    if (n < 0) {
+      ss << "qos_max_bps must be >= 0 (0 = unlimited)";
+      return -EINVAL;
+    }
+    p.qos_max_bps = n;
   } else {
     ss << "unrecognized variable '" << var << "'";
     return -EINVAL;
@@ -6173,6 +6277,83 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
     pending_inc.new_primary_temp[pgid] = osd;
     ss << "set " << pgid << " primary_temp mapping to " << osd;
     goto update;
+  } else if (prefix == "osd pg-upmap") {
+    string pgidstr;
+    if (!cmd_getval(g_ceph_context, cmdmap, "pgid", pgidstr)) {
+      ss << "unable to parse 'pgid' value '"
+         << cmd_vartype_stringify(cmdmap["pgid"]) << "'";
+      err = -EINVAL;
+      goto reply;
+    }
+    pg_t pgid;
+    if (!pgid.parse(pgidstr.c_str())) {
+      ss << "invalid pgid '" << pgidstr << "'";
+      err = -EINVAL;
+      goto reply;
+    }
+    PGMap& pg_map = mon->pgmon()->pg_map;
+    if (!pg_map.pg_stat.count(pgid)) {
+      ss << "pg " << pgid << " does not exist";
+      err = -ENOENT;
+      goto reply;
+    }
+
+    vector<string> id_vec;
+    vector<int32_t> new_pg_upmap;
+    if (!cmd_getval(g_ceph_context, cmdmap, "id", id_vec)) {
+      ss << "unable to parse 'id' value(s) '"
+         << cmd_vartype_stringify(cmdmap["id"]) << "'";
+      err = -EINVAL;
+      goto reply;
+    }
+    for (unsigned i = 0; i < id_vec.size(); i++) {
+      int32_t osd = parse_osd_id(id_vec[i].c_str(), &ss);
+      if (osd < 0) {
+        err = -EINVAL;
+        goto reply;
+      }
+      if (!osdmap.exists(osd)) {
+        ss << "osd." << osd << " does not exist";
+        err = -ENOENT;
+        goto reply;
+      }
+
+      new_pg_upmap.push_back(osd);
+    }
+
+    if (!g_conf->mon_osd_allow_pg_upmap) {
+      ss << "you must enable 'mon osd allow pg upmap = true' on the mons before you can set pg_upmap exceptions.  note that all clients must understand the new osdmap encoding or they will compute stale mappings for excepted pgs.";
+      err = -EPERM;
+      goto reply;
+    }
+
+    pending_inc.new_pg_upmap[pgid] = new_pg_upmap;
+    ss << "set " << pgid << " pg_upmap mapping to " << new_pg_upmap;
+    goto update;
+  } else if (prefix == "osd rm-pg-upmap") {
+    string pgidstr;
+    if (!cmd_getval(g_ceph_context, cmdmap, "pgid", pgidstr)) {
+      ss << "unable to parse 'pgid' value '"
+         << cmd_vartype_stringify(cmdmap["pgid"]) << "'";
+      err = -EINVAL;
+      goto reply;
+    }
+    pg_t pgid;
+    if (!pgid.parse(pgidstr.c_str())) {
+      ss << "invalid pgid '" << pgidstr << "'";
+      err = -EINVAL;
+      goto reply;
+    }
+    if (!osdmap.have_pg_upmap(pgid) &&
+        pending_inc.new_pg_upmap.count(pgid) == 0) {
+      ss << "no pg_upmap exception for " << pgid;
+      err = 0;
+      goto reply;
+    }
+
+    pending_inc.new_pg_upmap[pgid].clear();
+    ss << "cleared " << pgid << " pg_upmap mapping";
+    goto update;
   } else if (prefix == "osd primary-affinity") {
     int64_t id;
     if (!cmd_getval(g_ceph_context, cmdmap, "id", id)) {
@@ -7593,6 +7774,20 @@ bool OSDMonitor::_check_become_tier(
     return false;
   }
 
+  // copy-get cannot read compressed objects, so promotion from a
+  // compressed base (and flush from a compressed tier) would
+  // permanently fail
+  if (base_pool->has_flag(pg_pool_t::FLAG_COMPRESS)) {
+    *ss << "pool '" << base_pool_name << "' has compress set";
+    *err = -EINVAL;
+    return false;
+  }
+  if (tier_pool->has_flag(pg_pool_t::FLAG_COMPRESS)) {
+    *ss << "pool '" << tier_pool_name << "' has compress set";
+    *err = -EINVAL;
+    return false;
+  }
+
   *err = 0;
   return true;
 }
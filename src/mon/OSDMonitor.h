@@ -140,6 +140,12 @@ private:
   SimpleLRU<version_t, bufferlist> inc_osd_cache;
   SimpleLRU<version_t, bufferlist> full_osd_cache;
 
+  // map blobs reencoded for pre-OSDMAP_ENC clients, keyed by (version,
+  // significant feature bits) so each old format is built only once
+  // per epoch no matter how many stale clients subscribe
+  SimpleLRU<pair<version_t,uint64_t>, bufferlist> inc_osd_reencode_cache;
+  SimpleLRU<pair<version_t,uint64_t>, bufferlist> full_osd_reencode_cache;
+
   void check_failures(utime_t now);
   bool check_failure(utime_t now, int target_osd, failure_info_t& fi);
 
@@ -223,8 +229,8 @@ private:
   bool can_mark_in(int o);
 
   // ...
-  MOSDMap *build_latest_full();
-  MOSDMap *build_incremental(epoch_t first, epoch_t last);
+  MOSDMap *build_latest_full(uint64_t features);
+  MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features);
   void send_full(MonOpRequestRef op);
   void send_incremental(MonOpRequestRef op, epoch_t first);
   // @param req an optional op request, if the osdmaps are replies to it. so
@@ -425,6 +431,8 @@ private:
 
   int get_version(version_t ver, bufferlist& bl) override;
   int get_version_full(version_t ver, bufferlist& bl) override;
+  int get_version(version_t ver, uint64_t features, bufferlist& bl);
+  int get_version_full(version_t ver, uint64_t features, bufferlist& bl);
 
   epoch_t blacklist(const entity_addr_t& a, utime_t until);
 
@@ -361,6 +361,11 @@ void PGMap::calc_stats()
   pg_sum = pool_stat_t();
   osd_sum = osd_stat_t();
   pg_by_osd.clear();
+  inactive_pgs.clear();
+  unclean_pgs.clear();
+  degraded_pgs.clear();
+  undersized_pgs.clear();
+  stale_pgs.clear();
 
   for (ceph::unordered_map<pg_t,pg_stat_t>::iterator p = pg_stat.begin();
        p != pg_stat.end();
@@ -468,6 +473,17 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s, bool nocreating,
   num_pg++;
   num_pg_by_state[s.state]++;
 
+  if (!(s.state & PG_STATE_ACTIVE))
+    inactive_pgs.insert(pgid);
+  if (!(s.state & PG_STATE_CLEAN))
+    unclean_pgs.insert(pgid);
+  if (s.state & PG_STATE_DEGRADED)
+    degraded_pgs.insert(pgid);
+  if (s.state & PG_STATE_UNDERSIZED)
+    undersized_pgs.insert(pgid);
+  if (s.state & PG_STATE_STALE)
+    stale_pgs.insert(pgid);
+
   if (!nocreating) {
     if (s.state & PG_STATE_CREATING) {
       creating_pgs.insert(pgid);
@@ -504,6 +520,17 @@ void PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s, bool nocreating,
   if (--num_pg_by_state[s.state] == 0)
     num_pg_by_state.erase(s.state);
 
+  if (!(s.state & PG_STATE_ACTIVE))
+    inactive_pgs.erase(pgid);
+  if (!(s.state & PG_STATE_CLEAN))
+    unclean_pgs.erase(pgid);
+  if (s.state & PG_STATE_DEGRADED)
+    degraded_pgs.erase(pgid);
+  if (s.state & PG_STATE_UNDERSIZED)
+    undersized_pgs.erase(pgid);
+  if (s.state & PG_STATE_STALE)
+    stale_pgs.erase(pgid);
+
   if (!nocreating) {
     if (s.state & PG_STATE_CREATING) {
       creating_pgs.erase(pgid);
@@ -910,9 +937,26 @@ void PGMap::get_stuck_stats(int types, utime_t cutoff,
 			    ceph::unordered_map<pg_t, pg_stat_t>& stuck_pgs) const
 {
   assert(types != 0);
-  for (ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.begin();
-       i != pg_stat.end();
-       ++i) {
+
+  // only pgs in the candidate sets can match, so gather those instead of
+  // walking every pg_stat entry
+  set<pg_t> candidates;
+  if (types & STUCK_INACTIVE)
+    candidates.insert(inactive_pgs.begin(), inactive_pgs.end());
+  if (types & STUCK_UNCLEAN)
+    candidates.insert(unclean_pgs.begin(), unclean_pgs.end());
+  if (types & STUCK_DEGRADED)
+    candidates.insert(degraded_pgs.begin(), degraded_pgs.end());
+  if (types & STUCK_UNDERSIZED)
+    candidates.insert(undersized_pgs.begin(), undersized_pgs.end());
+  if (types & STUCK_STALE)
+    candidates.insert(stale_pgs.begin(), stale_pgs.end());
+
+  for (set<pg_t>::const_iterator p = candidates.begin();
+       p != candidates.end();
+       ++p) {
+    ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.find(*p);
+    assert(i != pg_stat.end());
     utime_t val = cutoff; // don't care about >= cutoff so that is infinity
 
     if ((types & STUCK_INACTIVE) && ! (i->second.state & PG_STATE_ACTIVE)) {
@@ -123,6 +123,14 @@ public:
   ceph::unordered_map<int,int> blocked_by_sum;
   ceph::unordered_map<int,set<pg_t> > pg_by_osd;
 
+  // pgs currently in a state that could become "stuck", so that the
+  // stuck-pg checks only look at candidates instead of every pg_stat
+  set<pg_t> inactive_pgs;
+  set<pg_t> unclean_pgs;
+  set<pg_t> degraded_pgs;
+  set<pg_t> undersized_pgs;
+  set<pg_t> stale_pgs;
+
   utime_t stamp;
 
   // recent deltas, and summation
@@ -786,8 +786,9 @@ bool PGMonitor::prepare_pg_stats(MonOpRequestRef op)
     pending_inc.update_stat(from, stats->epoch, osd_stat_t());
   }
   
-  if (pg_map.osd_stat.count(from))
-    dout(10) << " got osd." << from << " " << stats->osd_stat << " (was " << pg_map.osd_stat[from] << ")" << dendl;
+  ceph::unordered_map<int,osd_stat_t>::iterator s = pg_map.osd_stat.find(from);
+  if (s != pg_map.osd_stat.end())
+    dout(10) << " got osd." << from << " " << stats->osd_stat << " (was " << s->second << ")" << dendl;
   else
     dout(10) << " got osd." << from << " " << stats->osd_stat << " (first report)" << dendl;
 
@@ -801,20 +802,23 @@ bool PGMonitor::prepare_pg_stats(MonOpRequestRef op)
     pg_t pgid = p->first;
     ack->pg_stat[pgid] = make_pair(p->second.reported_seq, p->second.reported_epoch);
 
-    if (pg_map.pg_stat.count(pgid) &&
-        pg_map.pg_stat[pgid].get_version_pair() > p->second.get_version_pair()) {
-      dout(15) << " had " << pgid << " from " << pg_map.pg_stat[pgid].reported_epoch << ":"
-	       << pg_map.pg_stat[pgid].reported_seq << dendl;
+    // a big cluster sends us a lot of these; look each map up just once
+    ceph::unordered_map<pg_t,pg_stat_t>::iterator t = pg_map.pg_stat.find(pgid);
+    if (t != pg_map.pg_stat.end() &&
+        t->second.get_version_pair() > p->second.get_version_pair()) {
+      dout(15) << " had " << pgid << " from " << t->second.reported_epoch << ":"
+	       << t->second.reported_seq << dendl;
       continue;
     }
-    if (pending_inc.pg_stat_updates.count(pgid) && 
-        pending_inc.pg_stat_updates[pgid].get_version_pair() > p->second.get_version_pair()) {
-      dout(15) << " had " << pgid << " from " << pending_inc.pg_stat_updates[pgid].reported_epoch << ":"
-	       << pending_inc.pg_stat_updates[pgid].reported_seq << " (pending)" << dendl;
+    map<pg_t,pg_stat_t>::iterator q = pending_inc.pg_stat_updates.find(pgid);
+    if (q != pending_inc.pg_stat_updates.end() &&
+        q->second.get_version_pair() > p->second.get_version_pair()) {
+      dout(15) << " had " << pgid << " from " << q->second.reported_epoch << ":"
+	       << q->second.reported_seq << " (pending)" << dendl;
       continue;
     }
 
-    if (pg_map.pg_stat.count(pgid) == 0) {
+    if (t == pg_map.pg_stat.end()) {
       dout(15) << " got " << pgid << " reported at " << p->second.reported_epoch << ":"
 	       << p->second.reported_seq
 	       << " state " << pg_state_string(p->second.state)
@@ -822,13 +826,16 @@ bool PGMonitor::prepare_pg_stats(MonOpRequestRef op)
 	       << dendl;
       continue;
     }
-      
+
     dout(15) << " got " << pgid
 	     << " reported at " << p->second.reported_epoch << ":" << p->second.reported_seq
-	     << " state " << pg_state_string(pg_map.pg_stat[pgid].state)
+	     << " state " << pg_state_string(t->second.state)
 	     << " -> " << pg_state_string(p->second.state)
 	     << dendl;
-    pending_inc.pg_stat_updates[pgid] = p->second;
+    if (q != pending_inc.pg_stat_updates.end())
+      q->second = p->second;
+    else
+      pending_inc.pg_stat_updates[pgid] = p->second;
 
     /*
     // we don't care much about consistency, here; apply to live map.
@@ -1565,6 +1572,9 @@ bool PGMonitor::preprocess_command(MonOpRequestRef op)
 	copy(dumpcontents.begin(), dumpcontents.end(),
 	     inserter(what, what.end()));
       }
+      // stream into the reply payload as we go; a full dump of a large
+      // cluster is otherwise buffered whole in the formatter
+      f->set_low_water(&rdata, 1 << 20);
       if (what.count("all")) {
 	f->open_object_section("pg_map");
 	pg_map.dump(f.get());
@@ -1592,7 +1602,7 @@ bool PGMonitor::preprocess_command(MonOpRequestRef op)
 	  f->close_section();
 	}
       }
-      f->flush(ds);
+      f->flush(rdata);
     } else {
       if (what.count("all")) {
 	pg_map.dump(ds);
@@ -1648,8 +1658,9 @@ bool PGMonitor::preprocess_command(MonOpRequestRef op)
       states.pop_back();
     }
     if (f && !pgs.empty()){
+      f->set_low_water(&rdata, 1 << 20);
       pg_map.dump_filtered_pg_stats(f.get(),pgs);
-      f->flush(ds);
+      f->flush(rdata);
     } else if (!pgs.empty()){
       pg_map.dump_filtered_pg_stats(ds,pgs);
     }
@@ -655,6 +655,10 @@ void Paxos::begin(bufferlist& v)
   logger->inc(l_paxos_begin_bytes, t->get_bytes());
   utime_t start = ceph_clock_now(NULL);
 
+  // this write stays synchronous on purpose: our own acceptance only
+  // counts once the pending value is durable, so we cannot send begins
+  // (or count ourselves toward the majority) before it lands.  only the
+  // commit is async (see commit_start).
   get_store()->apply_transaction(t);
 
   utime_t end = ceph_clock_now(NULL);
@@ -734,6 +738,8 @@ void Paxos::handle_begin(MonOpRequestRef op)
   logger->inc(l_paxos_begin_bytes, t->get_bytes());
   utime_t start = ceph_clock_now(NULL);
 
+  // synchronous on purpose: we must not ack the accept until the value
+  // is durable, or a crash after the ack could break our promise
   get_store()->apply_transaction(t);
 
   utime_t end = ceph_clock_now(NULL);
@@ -583,6 +583,13 @@ private:
    * This is the transaction that is under construction and pending
    * proposal.  We will add operations to it until we decide it is
    * time to start a paxos round.
+   *
+   * Note that exactly one proposal is ever in flight: everything that
+   * accumulates here while a round is committing goes out as a single
+   * batched proposal when finish_round() calls propose_pending().  We
+   * used to pipeline multiple proposals and it was a reliable source of
+   * subtle recovery bugs, so throughput under churn comes from batching
+   * (many service updates per round trip), not from pipelining.
    */
   MonitorDBStore::TransactionRef pending_proposal;
 
@@ -61,6 +61,7 @@ using namespace std;
 #include "messages/MOSDFailure.h"
 #include "messages/MOSDMarkMeDown.h"
 #include "messages/MOSDPing.h"
+#include "messages/MOSDNetPing.h"
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
 #include "messages/MOSDSubOp.h"
@@ -160,6 +161,7 @@ using namespace std;
 #include "messages/MTimeCheck.h"
 
 #include "common/config.h"
+#include "compressor/SnappyCompressor.h"
 
 #include "messages/MOSDPGPush.h"
 #include "messages/MOSDPGPushReply.h"
@@ -242,6 +244,69 @@ void Message::encode(uint64_t features, int crcflags)
   }
 }
 
+void maybe_compress_message_data(CephContext *cct, Message *m)
+{
+  static SnappyCompressor codec;  // stateless, so safe to share
+
+  ceph_msg_footer &footer = m->get_footer();
+  if (m->is_data_compressed()) {
+    // a previous send attempt already compressed the data; encode()
+    // recomputed the crc over it but cleared our footer flag
+    footer.flags = (unsigned)footer.flags | CEPH_MSG_FOOTER_DATA_COMPRESSED;
+    return;
+  }
+  if ((uint64_t)m->get_data_len() <
+      cct->_conf->ms_compress_data_min_size)
+    return;
+
+  bufferlist cdata;
+  if (codec.compress(m->get_data(), cdata) < 0)
+    return;
+  if (cdata.length() >= m->get_data().length()) {
+    // incompressible (already compressed or encrypted, say); leaving the
+    // flag unset means the peer treats it as a plain raw payload
+    ldout(cct, 20) << "maybe_compress_message_data " << *m << " didn't shrink ("
+		   << m->get_data_len() << " -> " << cdata.length()
+		   << "), sending raw" << dendl;
+    return;
+  }
+  ldout(cct, 20) << "maybe_compress_message_data " << *m << " "
+		 << m->get_data_len() << " -> " << cdata.length() << dendl;
+  m->set_data(cdata);
+  m->set_data_compressed();
+  m->get_header().data_len = cdata.length();
+  m->calc_header_crc();  // data_len is covered by the header crc
+  footer.flags = (unsigned)footer.flags | CEPH_MSG_FOOTER_DATA_COMPRESSED;
+  if ((footer.flags & CEPH_MSG_FOOTER_NOCRC) == 0)
+    footer.data_crc = cdata.crc32c(0);
+}
+
+void maybe_decompress_message_data(CephContext *cct, Message *m)
+{
+  static SnappyCompressor codec;
+
+  if (!m->is_data_compressed())
+    return;
+  // the message was compressed for an earlier send attempt, but this
+  // session no longer allows compressed data (the feature bit or
+  // ms_compress_data went away across a reconnect).  restore the raw
+  // payload before it goes out; otherwise the peer would consume the
+  // snappy image as object data, with a valid crc over the wrong bytes.
+  bufferlist raw;
+  int r = codec.decompress(m->get_data(), raw);
+  assert(r >= 0);  // we compressed it ourselves
+  ldout(cct, 20) << "maybe_decompress_message_data " << *m << " "
+		 << m->get_data_len() << " -> " << raw.length() << dendl;
+  m->set_data(raw);
+  m->clear_data_compressed();
+  m->get_header().data_len = raw.length();
+  m->calc_header_crc();
+  ceph_msg_footer &footer = m->get_footer();
+  footer.flags = (unsigned)footer.flags & ~CEPH_MSG_FOOTER_DATA_COMPRESSED;
+  if ((footer.flags & CEPH_MSG_FOOTER_NOCRC) == 0)
+    footer.data_crc = raw.crc32c(0);
+}
+
 void Message::dump(Formatter *f) const
 {
   stringstream ss;
@@ -294,6 +359,26 @@ Message *decode_message(CephContext *cct, int crcflags,
     }
   }
 
+  if (footer.flags & CEPH_MSG_FOOTER_DATA_COMPRESSED) {
+    // the data crc above was verified over the wire (compressed) bytes;
+    // the flag implies snappy (see CEPH_FEATURE_MSG_DATA_COMPRESS)
+    static SnappyCompressor codec;
+    bufferlist raw;
+    if (data.length() < 8 ||  // decompress() peeks at the first 8 bytes
+	codec.decompress(data, raw) < 0) {
+      if (cct) {
+	ldout(cct, 0) << "failed to decompress data payload" << dendl;
+	ldout(cct, 20) << " ";
+	data.hexdump(*_dout);
+	*_dout << dendl;
+      }
+      return 0;
+    }
+    data.swap(raw);
+    header.data_len = data.length();
+    footer.flags = (unsigned)footer.flags & ~CEPH_MSG_FOOTER_DATA_COMPRESSED;
+  }
+
   // make message
   Message *m = 0;
   int type = header.type;
@@ -419,6 +504,9 @@ Message *decode_message(CephContext *cct, int crcflags,
   case MSG_OSD_PING:
     m = new MOSDPing();
     break;
+  case MSG_OSD_NET_PING:
+    m = new MOSDNetPing();
+    break;
   case CEPH_MSG_OSD_OP:
     m = new MOSDOp();
     break;
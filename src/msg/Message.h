@@ -117,6 +117,8 @@
 #define MSG_OSD_REPOP         112
 #define MSG_OSD_REPOPREPLY    113
 
+#define MSG_OSD_NET_PING      114
+
 
 // *** MDS ***
 
@@ -223,6 +225,11 @@ protected:
 
   uint32_t magic;
 
+  /* true if the data segment holds a compressed image of the original
+   * payload; encode() resets the footer flags, so this is what lets a
+   * re-send re-mark CEPH_MSG_FOOTER_DATA_COMPRESSED on the wire. */
+  bool data_compressed;
+
   bi::list_member_hook<> dispatch_q;
 
 public:
@@ -263,6 +270,7 @@ public:
   Message()
     : connection(NULL),
       magic(0),
+      data_compressed(false),
       completion_hook(NULL),
       byte_throttler(NULL),
       msg_throttler(NULL),
@@ -273,6 +281,7 @@ public:
   Message(int t, int version=1, int compat_version=0)
     : connection(NULL),
       magic(0),
+      data_compressed(false),
       completion_hook(NULL),
       byte_throttler(NULL),
       msg_throttler(NULL),
@@ -376,6 +385,9 @@ public:
   }
 
   bufferlist& get_data() { return data; }
+  bool is_data_compressed() const { return data_compressed; }
+  void set_data_compressed() { data_compressed = true; }
+  void clear_data_compressed() { data_compressed = false; }
   void claim_data(bufferlist& bl,
 		  unsigned int flags = buffer::list::CLAIM_DEFAULT) {
     if (byte_throttler)
@@ -449,6 +461,19 @@ public:
   // virtual bits
   virtual void decode_payload() = 0;
   virtual void encode_payload(uint64_t features) = 0;
+  /**
+   * lazy decode
+   *
+   * A message type may decode only the fields needed to route it in
+   * decode_payload() and defer the rest, so that a large decode does
+   * not block the reader thread.  Such types return true from
+   * supports_lazy_decode(), and whoever consumes the message body
+   * must call finish_decode() first (before clear_payload()).
+   * finish_decode() is idempotent and may throw buffer::error on a
+   * corrupt payload, just like decode_payload().
+   */
+  virtual bool supports_lazy_decode() const { return false; }
+  virtual void finish_decode() {}
   virtual const char *get_type_name() const = 0;
   virtual void print(ostream& out) const {
     out << get_type_name() << " magic: " << magic;
@@ -464,6 +489,24 @@ extern Message *decode_message(CephContext *cct, int crcflags,
 			       ceph_msg_header &header,
 			       ceph_msg_footer& footer, bufferlist& front,
 			       bufferlist& middle, bufferlist& data);
+
+/**
+ * Replace m's data segment with a snappy-compressed image and mark the
+ * footer with CEPH_MSG_FOOTER_DATA_COMPRESSED.  Call after encode() (which
+ * resets the footer flags) and before the message is signed, since the
+ * signature covers the footer crcs.  If the data doesn't shrink the message
+ * is left untouched and goes out raw.  Only call this for connections that
+ * negotiated CEPH_FEATURE_MSG_DATA_COMPRESS.
+ */
+extern void maybe_compress_message_data(CephContext *cct, Message *m);
+/**
+ * Undo maybe_compress_message_data() on a message compressed for an
+ * earlier send attempt.  Call instead of it when the connection no longer
+ * allows compressed data (feature or option lost across a reconnect), so
+ * a requeued message is restored to its raw payload before going out.
+ * No-op if the data is not compressed.
+ */
+extern void maybe_decompress_message_data(CephContext *cct, Message *m);
 inline ostream& operator<<(ostream& out, Message& m) {
   m.print(out);
   if (m.get_header().version)
@@ -82,6 +82,26 @@ public:
     Throttle *throttler_bytes;
     Throttle *throttler_messages;
 
+    /**
+     * Optional byte throttlers for specific priority classes.  When a
+     * class throttler is set, messages in that class are charged to it
+     * instead of throttler_bytes, so bulk traffic (recovery, backfill)
+     * and urgent traffic (acks, pings) get independent byte budgets
+     * and one class cannot starve the other at the reader.  A class
+     * left NULL falls back to throttler_bytes.
+     */
+    Throttle *throttler_bytes_low;   ///< priority <= CEPH_MSG_PRIO_LOW
+    Throttle *throttler_bytes_high;  ///< priority >= CEPH_MSG_PRIO_HIGH
+
+    /// pick the byte throttler for a message of the given priority
+    Throttle *get_byte_throttler(int prio) const {
+      if (prio >= CEPH_MSG_PRIO_HIGH && throttler_bytes_high)
+	return throttler_bytes_high;
+      if (prio <= CEPH_MSG_PRIO_LOW && throttler_bytes_low)
+	return throttler_bytes_low;
+      return throttler_bytes;
+    }
+
     /// Specify features supported locally by the endpoint.
     uint64_t features_supported;
     /// Specify features any remotes must have to talk to this endpoint.
@@ -91,6 +111,8 @@ public:
       : lossy(false), server(false), standby(false), resetcheck(true),
 	throttler_bytes(NULL),
 	throttler_messages(NULL),
+	throttler_bytes_low(NULL),
+	throttler_bytes_high(NULL),
 	features_supported(CEPH_FEATURES_SUPPORTED_DEFAULT),
 	features_required(0) {}
   private:
@@ -98,6 +120,8 @@ public:
       : lossy(l), server(s), standby(st), resetcheck(r),
 	throttler_bytes(NULL),
 	throttler_messages(NULL),
+	throttler_bytes_low(NULL),
+	throttler_bytes_high(NULL),
 	features_supported(sup | CEPH_FEATURES_SUPPORTED_DEFAULT),
 	features_required(req) {}
 
@@ -299,7 +323,9 @@ public:
    * @note The Messenger does not take ownership of the Throttle pointers, but
    * you must not destroy them before you destroy the Messenger.
    */
-  virtual void set_policy_throttlers(int type, Throttle *bytes, Throttle *msgs=NULL) = 0;
+  virtual void set_policy_throttlers(int type, Throttle *bytes, Throttle *msgs=NULL,
+				     Throttle *bytes_low=NULL,
+				     Throttle *bytes_high=NULL) = 0;
   /**
    * Set the default send priority
    *
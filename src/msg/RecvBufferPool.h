@@ -0,0 +1,68 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Red Hat
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_RECVBUFFERPOOL_H
+#define CEPH_MSG_RECVBUFFERPOOL_H
+
+#include <vector>
+
+#include "include/buffer.h"
+
+/**
+ * A small per-connection pool of receive buffers.
+ *
+ * The read paths allocate a fresh buffer for every message, and on a
+ * busy OSD that malloc/free pair per message is a measurable allocator
+ * cost.  The pool keeps references to the last few buffers it handed
+ * out; once the message consuming a buffer drops it (leaving the pool's
+ * reference as the only one), the same raw buffer is handed out again.
+ * On a miss the freshly allocated buffer replaces a pool slot round
+ * robin, so the slot sizes adapt to the message sizes the connection
+ * actually sees.
+ *
+ * Only the reading thread of a connection may call alloc(), so the pool
+ * needs no locking.
+ */
+class RecvBufferPool {
+  std::vector<bufferptr> buffers;
+  unsigned max_len;   ///< don't pool buffers larger than this
+  unsigned victim;    ///< round-robin replacement cursor
+
+ public:
+  RecvBufferPool(int slots, unsigned ml)
+    : buffers(slots > 0 ? slots : 0), max_len(ml), victim(0) {}
+
+  bufferptr alloc(unsigned len) {
+    if (buffers.empty() || !len || len > max_len)
+      return buffer::create_page_aligned(len);
+    for (unsigned i = 0; i < buffers.size(); ++i) {
+      bufferptr &p = buffers[i];
+      if (p.have_raw() && p.raw_nref() == 1 && p.raw_length() >= len) {
+	bufferptr b = p;
+	b.set_offset(0);
+	b.set_length(len);
+	// the raw is about to be overwritten with new bytes; don't let
+	// it serve crcs cached from its previous contents
+	b.invalidate_crc();
+	return b;
+      }
+    }
+    bufferptr b = buffer::create_page_aligned(len);
+    buffers[victim] = b;
+    victim = (victim + 1) % buffers.size();
+    return b;
+  }
+};
+
+#endif
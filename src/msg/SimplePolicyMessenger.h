@@ -96,16 +96,22 @@ public:
    */
   void set_policy_throttlers(int type,
 			     Throttle *byte_throttle,
-			     Throttle *msg_throttle) {
+			     Throttle *msg_throttle,
+			     Throttle *byte_throttle_low = NULL,
+			     Throttle *byte_throttle_high = NULL) {
     Mutex::Locker l(policy_lock);
     map<int, Policy>::iterator iter =
       policy_map.find(type);
     if (iter != policy_map.end()) {
       iter->second.throttler_bytes = byte_throttle;
       iter->second.throttler_messages = msg_throttle;
+      iter->second.throttler_bytes_low = byte_throttle_low;
+      iter->second.throttler_bytes_high = byte_throttle_high;
     } else {
       default_policy.throttler_bytes = byte_throttle;
       default_policy.throttler_messages = msg_throttle;
+      default_policy.throttler_bytes_low = byte_throttle_low;
+      default_policy.throttler_bytes_high = byte_throttle_high;
     }
   }
 
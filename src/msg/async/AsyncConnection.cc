@@ -150,7 +150,8 @@ class C_clean_handler : public EventCallback {
   }
 };
 
-static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
+static void alloc_aligned_buffer(RecvBufferPool &pool, bufferlist& data,
+                                 unsigned len, unsigned off)
 {
   // create a buffer to read into that matches the data alignment
   unsigned left = len;
@@ -158,30 +159,34 @@ static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
     // head
     unsigned head = 0;
     head = MIN(CEPH_PAGE_SIZE - (off & ~CEPH_PAGE_MASK), left);
-    bufferptr bp = buffer::create(head);
+    bufferptr bp = pool.alloc(head);
     data.push_back(bp);
     left -= head;
   }
   unsigned middle = left & CEPH_PAGE_MASK;
   if (middle > 0) {
-    bufferptr bp = buffer::create_page_aligned(middle);
+    bufferptr bp = pool.alloc(middle);
     data.push_back(bp);
     left -= middle;
   }
   if (left) {
-    bufferptr bp = buffer::create(left);
+    bufferptr bp = pool.alloc(left);
     data.push_back(bp);
   }
 }
 
-AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, EventCenter *c, PerfCounters *p)
-  : Connection(cct, m), async_msgr(m), logger(p), global_seq(0), connect_seq(0), peer_global_seq(0),
+AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, Worker *w)
+  : Connection(cct, m), async_msgr(m), logger(w->get_perf_counter()),
+    global_seq(0), connect_seq(0), peer_global_seq(0),
     out_seq(0), ack_left(0), in_seq(0), state(STATE_NONE), state_after_send(0), sd(-1), port(-1),
     write_lock("AsyncConnection::write_lock"), can_write(NOWRITE),
     open_write(false), keepalive(false), lock("AsyncConnection::lock"), recv_buf(NULL),
     recv_max_prefetch(MIN(msgr->cct->_conf->ms_tcp_prefetch_max_size, TCP_PREFETCH_MIN_SIZE)),
     recv_start(0), recv_end(0), got_bad_auth(false), authorizer(NULL), replacing(false),
-    is_reset_from_peer(false), once_ready(false), state_buffer(NULL), state_offset(0), net(cct), center(c)
+    is_reset_from_peer(false), once_ready(false), state_buffer(NULL), state_offset(0), net(cct),
+    center(&w->center), worker(w),
+    recv_pool(cct->_conf->ms_recv_buffer_pool_size,
+              cct->_conf->ms_recv_buffer_pool_max_size)
 {
   read_handler.reset(new C_handle_read(this));
   write_handler.reset(new C_handle_write(this));
@@ -194,6 +199,7 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, EventCente
   // double recv_max_prefetch see "read_until"
   recv_buf = new char[2*recv_max_prefetch];
   state_buffer = new char[4096];
+  worker->references.inc();
   logger->inc(l_msgr_created_connections);
 }
 
@@ -206,6 +212,7 @@ AsyncConnection::~AsyncConnection()
     delete[] recv_buf;
   if (state_buffer)
     delete[] state_buffer;
+  worker->references.dec();
 }
 
 /* return -1 means `fd` occurs error or closed, it should be closed
@@ -590,7 +597,7 @@ void AsyncConnection::process()
           front.clear();
           middle.clear();
           data.clear();
-          recv_stamp = ceph_clock_now(async_msgr->cct);
+          recv_stamp = ceph_coarse_clock_now(async_msgr->cct);
           current_header = header;
           state = STATE_OPEN_MESSAGE_THROTTLE_MESSAGE;
           break;
@@ -622,14 +629,16 @@ void AsyncConnection::process()
         {
           uint64_t message_size = current_header.front_len + current_header.middle_len + current_header.data_len;
           if (message_size) {
-            if (policy.throttler_bytes) {
+            // charge the byte throttler matching this message's priority class
+            Throttle *byte_throttler = policy.get_byte_throttler(current_header.priority);
+            if (byte_throttler) {
               ldout(async_msgr->cct, 10) << __func__ << " wants " << message_size << " bytes from policy throttler "
-                                         << policy.throttler_bytes->get_current() << "/"
-                                         << policy.throttler_bytes->get_max() << dendl;
-              if (!policy.throttler_bytes->get_or_fail(message_size)) {
+                                         << byte_throttler->get_current() << "/"
+                                         << byte_throttler->get_max() << dendl;
+              if (!byte_throttler->get_or_fail(message_size)) {
                 ldout(async_msgr->cct, 10) << __func__ << " wants " << message_size << " bytes from policy throttler "
-                                           << policy.throttler_bytes->get_current() << "/"
-                                           << policy.throttler_bytes->get_max() << " failed, just wait." << dendl;
+                                           << byte_throttler->get_current() << "/"
+                                           << byte_throttler->get_max() << " failed, just wait." << dendl;
                 // following thread pool deal with th full message queue isn't a
                 // short time, so we can wait a ms.
                 if (register_time_events.empty())
@@ -639,7 +648,7 @@ void AsyncConnection::process()
             }
           }
 
-          throttle_stamp = ceph_clock_now(msgr->cct);
+          throttle_stamp = ceph_coarse_clock_now(msgr->cct);
           state = STATE_OPEN_MESSAGE_READ_FRONT;
           break;
         }
@@ -650,7 +659,7 @@ void AsyncConnection::process()
           int front_len = current_header.front_len;
           if (front_len) {
             if (!front.length()) {
-              bufferptr ptr = buffer::create(front_len);
+              bufferptr ptr = recv_pool.alloc(front_len);
               front.push_back(ptr);
             }
             r = read_until(front_len, front.c_str());
@@ -673,7 +682,7 @@ void AsyncConnection::process()
           int middle_len = current_header.middle_len;
           if (middle_len) {
             if (!middle.length()) {
-              bufferptr ptr = buffer::create(middle_len);
+              bufferptr ptr = recv_pool.alloc(middle_len);
               middle.push_back(ptr);
             }
             r = read_until(middle_len, middle.c_str());
@@ -709,7 +718,7 @@ void AsyncConnection::process()
               data_blp = data_buf.begin();
             } else {
               ldout(async_msgr->cct,20) << __func__ << " allocating new rx buffer at offset " << data_off << dendl;
-              alloc_aligned_buffer(data_buf, data_len, data_off);
+              alloc_aligned_buffer(recv_pool, data_buf, data_len, data_off);
               data_blp = data_buf.begin();
             }
           }
@@ -801,7 +810,8 @@ void AsyncConnection::process()
               goto fail;
             }
           }
-          message->set_byte_throttler(policy.throttler_bytes);
+          message->set_byte_throttler(
+              policy.get_byte_throttler(current_header.priority));
           message->set_message_throttler(policy.throttler_messages);
 
           // store reservation size in message, so we don't get confused
@@ -811,7 +821,7 @@ void AsyncConnection::process()
 
           message->set_recv_stamp(recv_stamp);
           message->set_throttle_stamp(throttle_stamp);
-          message->set_recv_complete_stamp(ceph_clock_now(async_msgr->cct));
+          message->set_recv_complete_stamp(ceph_coarse_clock_now(async_msgr->cct));
 
           // check received seq#.  if it is old, drop the message.  
           // note that incoming messages may skip ahead.  this is convenient for the client
@@ -926,12 +936,13 @@ void AsyncConnection::process()
   if (state > STATE_OPEN_MESSAGE_THROTTLE_BYTES &&
       state <= STATE_OPEN_MESSAGE_READ_FOOTER_AND_DISPATCH) {
     uint64_t message_size = current_header.front_len + current_header.middle_len + current_header.data_len;
-    if (policy.throttler_bytes) {
+    Throttle *byte_throttler = policy.get_byte_throttler(current_header.priority);
+    if (byte_throttler) {
       ldout(async_msgr->cct,10) << __func__ << " releasing " << message_size
                           << " bytes to policy throttler "
-                          << policy.throttler_bytes->get_current() << "/"
-                          << policy.throttler_bytes->get_max() << dendl;
-      policy.throttler_bytes->put(message_size);
+                          << byte_throttler->get_current() << "/"
+                          << byte_throttler->get_max() << dendl;
+      byte_throttler->put(message_size);
     }
   }
   fault();
@@ -2208,6 +2219,17 @@ void AsyncConnection::prepare_send_message(uint64_t features, Message *m, buffer
   // encode and copy out of *m
   m->encode(features, msgr->crcflags);
 
+  // compress the data payload?  this must happen after encode() (which
+  // resets the footer flags) and before write_message() signs the message.
+  // if the guard fails but the message was compressed for an earlier send
+  // attempt, restore the raw payload -- the peer can no longer decompress
+  // it.
+  if (async_msgr->cct->_conf->ms_compress_data &&
+      (features & CEPH_FEATURE_MSG_DATA_COMPRESS))
+    maybe_compress_message_data(async_msgr->cct, m);
+  else
+    maybe_decompress_message_data(async_msgr->cct, m);
+
   bl.append(m->get_payload());
   bl.append(m->get_middle());
   bl.append(m->get_data());
@@ -2294,6 +2316,19 @@ int AsyncConnection::write_message(Message *m, bufferlist& bl)
   logger->inc(l_msgr_send_bytes, complete_bl.length());
   ldout(async_msgr->cct, 20) << __func__ << " sending " << m->get_seq()
                              << " " << m << dendl;
+  // If more messages are already queued behind us the caller will issue
+  // another write_message right away; stash this encode in outcoming_bl and
+  // let the last one flush everything with a single sendmsg, rather than
+  // emitting one small segment per message.
+  uint64_t coalesce_max = async_msgr->cct->_conf->ms_async_send_coalesce_max_bytes;
+  if (coalesce_max && !out_q.empty() &&
+      outcoming_bl.length() + complete_bl.length() <= coalesce_max) {
+    ldout(async_msgr->cct, 20) << __func__ << " coalescing " << m->get_seq()
+                               << " " << m << " with queued output" << dendl;
+    _try_send(complete_bl, false);
+    m->put();
+    return 0;
+  }
   int rc = _try_send(complete_bl);
   if (rc < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " error sending " << m << ", "
@@ -2463,7 +2498,7 @@ void AsyncConnection::local_deliver()
     Message *m = local_messages.front();
     local_messages.pop_front();
     m->set_connection(this);
-    m->set_recv_stamp(ceph_clock_now(async_msgr->cct));
+    m->set_recv_stamp(ceph_coarse_clock_now(async_msgr->cct));
     ldout(async_msgr->cct, 10) << __func__ << " " << *m << " local deliver " << dendl;
     async_msgr->ms_fast_preprocess(m);
     write_lock.Unlock();
@@ -28,12 +28,14 @@ using namespace std;
 #include "common/perf_counters.h"
 #include "include/buffer.h"
 #include "msg/Connection.h"
+#include "msg/RecvBufferPool.h"
 #include "msg/Messenger.h"
 
 #include "Event.h"
 #include "net_handler.h"
 
 class AsyncMessenger;
+class Worker;
 
 /*
  * AsyncConnection maintains a logic session between two endpoints. In other
@@ -114,7 +116,7 @@ class AsyncConnection : public Connection {
   }
 
  public:
-  AsyncConnection(CephContext *cct, AsyncMessenger *m, EventCenter *c, PerfCounters *p);
+  AsyncConnection(CephContext *cct, AsyncMessenger *m, Worker *w);
   ~AsyncConnection();
 
   ostream& _conn_prefix(std::ostream *_dout);
@@ -289,6 +291,8 @@ class AsyncConnection : public Connection {
   uint64_t state_offset;
   NetHandler net;
   EventCenter *center;
+  Worker *worker;
+  RecvBufferPool recv_pool;  // recycled message buffers, event thread only
   ceph::shared_ptr<AuthSessionHandler> session_security;
 
  public:
@@ -64,8 +64,10 @@ class Worker : public Thread {
 
  public:
   EventCenter center;
+  atomic_t references;  ///< connections assigned to this worker
   Worker(CephContext *c, WorkerPool *p, int i)
-    : cct(c), pool(p), done(false), id(i), perf_logger(NULL), center(c) {
+    : cct(c), pool(p), done(false), id(i), perf_logger(NULL), center(c),
+      references(0) {
     center.init(InitEventNumber);
     char name[128];
     sprintf(name, "AsyncMessenger::Worker-%d", id);
@@ -143,7 +145,17 @@ class WorkerPool: CephContext::AssociatedSingletonObject {
   virtual ~WorkerPool();
   void start();
   Worker *get_worker() {
-    return workers[(seq++)%workers.size()];
+    // least-loaded placement: a handful of hot connections can
+    // otherwise pile up on one event thread while the rest idle.
+    // ties rotate round-robin via seq.
+    Worker *w = workers[(seq++)%workers.size()];
+    for (vector<Worker*>::iterator p = workers.begin();
+	 p != workers.end();
+	 ++p) {
+      if ((*p)->references.read() < w->references.read())
+	w = *p;
+    }
+    return w;
   }
   int get_cpuid(int id) {
     if (coreids.empty())
@@ -251,7 +263,7 @@ public:
   Connection *create_anon_connection() {
     Mutex::Locker l(lock);
     Worker *w = pool->get_worker();
-    return new AsyncConnection(cct, this, &w->center, w->get_perf_counter());
+    return new AsyncConnection(cct, this, w);
   }
 
   /**
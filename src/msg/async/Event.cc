@@ -233,14 +233,15 @@ uint64_t EventCenter::create_time_event(uint64_t microseconds, EventCallbackRef
 
   event.id = id;
   event.time_cb = ctxt;
-  time_events[expire].push_back(event);
+  list<TimeEvent> &bucket = time_events[expire];
+  bucket.push_back(event);
+  time_event_ids[id] = make_pair(expire, --bucket.end());
   if (expire < next_time)
     wakeup();
 
   return id;
 }
 
-// TODO: Ineffective implementation now!
 void EventCenter::delete_time_event(uint64_t id)
 {
   Mutex::Locker l(time_lock);
@@ -248,19 +249,17 @@ void EventCenter::delete_time_event(uint64_t id)
   if (id >= time_event_next_id)
     return ;
 
+  map<uint64_t, pair<utime_t, list<TimeEvent>::iterator> >::iterator p =
+    time_event_ids.find(id);
+  if (p == time_event_ids.end())
+    return ;
 
-  for (map<utime_t, list<TimeEvent> >::iterator it = time_events.begin();
-       it != time_events.end(); ++it) {
-    for (list<TimeEvent>::iterator j = it->second.begin();
-         j != it->second.end(); ++j) {
-      if (j->id == id) {
-        it->second.erase(j);
-        if (it->second.empty())
-          time_events.erase(it);
-        return ;
-      }
-    }
-  }
+  map<utime_t, list<TimeEvent> >::iterator it = time_events.find(p->second.first);
+  assert(it != time_events.end());
+  it->second.erase(p->second.second);
+  if (it->second.empty())
+    time_events.erase(it);
+  time_event_ids.erase(p);
 }
 
 void EventCenter::wakeup()
@@ -294,11 +293,17 @@ int EventCenter::process_time_events()
    * indefinitely, and practice suggests it is. */
   if (now < last_time) {
     map<utime_t, list<TimeEvent> > changed;
+    list<TimeEvent> &all = changed[utime_t()];
     for (map<utime_t, list<TimeEvent> >::iterator it = time_events.begin();
          it != time_events.end(); ++it) {
-      changed[utime_t()].swap(it->second);
+      all.splice(all.end(), it->second);
     }
     time_events.swap(changed);
+    // everything now lives under the zero key; repoint the id index
+    time_event_ids.clear();
+    list<TimeEvent> &l = time_events[utime_t()];
+    for (list<TimeEvent>::iterator j = l.begin(); j != l.end(); ++j)
+      time_event_ids[j->id] = make_pair(utime_t(), j);
   }
   last_time = now;
 
@@ -308,6 +313,9 @@ int EventCenter::process_time_events()
        it != time_events.end(); ) {
     prev = it;
     if (cur >= it->first) {
+      for (list<TimeEvent>::iterator j = it->second.begin();
+           j != it->second.end(); ++j)
+        time_event_ids.erase(j->id);
       need_process.splice(need_process.end(), it->second);
       ++it;
       time_events.erase(prev);
@@ -414,7 +422,12 @@ int EventCenter::process_events(int timeout_microseconds)
 void EventCenter::dispatch_event_external(EventCallbackRef e)
 {
   external_lock.Lock();
+  bool wake = external_events.empty();
   external_events.push_back(e);
   external_lock.Unlock();
-  wakeup();
+  // every empty->non-empty transition wakes the owner, so a non-empty
+  // queue always has a notify in flight; submitters joining a burst
+  // can skip the write to the wakeup pipe
+  if (wake)
+    wakeup();
 }
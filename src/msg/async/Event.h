@@ -107,6 +107,8 @@ class EventCenter {
   FileEvent *file_events;
   EventDriver *driver;
   map<utime_t, list<TimeEvent> > time_events;
+  // id -> position in time_events, so cancel doesn't scan every bucket
+  map<uint64_t, pair<utime_t, list<TimeEvent>::iterator> > time_event_ids;
   uint64_t time_event_next_id;
   time_t last_time; // last time process time event
   utime_t next_time; // next wake up time
@@ -90,6 +90,14 @@ void NetHandler::set_socket_options(int sd)
       ldout(cct, 0) << "couldn't set SO_RCVBUF to " << size << ": " << cpp_strerror(r) << dendl;
     }
   }
+  if (cct->_conf->ms_tcp_sndbuf) {
+    int size = cct->_conf->ms_tcp_sndbuf;
+    int r = ::setsockopt(sd, SOL_SOCKET, SO_SNDBUF, (void*)&size, sizeof(size));
+    if (r < 0)  {
+      r = -errno;
+      ldout(cct, 0) << "couldn't set SO_SNDBUF to " << size << ": " << cpp_strerror(r) << dendl;
+    }
+  }
 
   // block ESIGPIPE
 #ifdef CEPH_USE_SO_NOSIGPIPE
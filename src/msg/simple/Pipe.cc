@@ -68,6 +68,8 @@ Pipe::Pipe(SimpleMessenger *r, int st, PipeConnection *con)
     conn_id(r->dispatch_queue.get_id()),
     recv_ofs(0),
     recv_len(0),
+    recv_pool(r->cct->_conf->ms_recv_buffer_pool_size,
+	      r->cct->_conf->ms_recv_buffer_pool_max_size),
     sd(-1), port(0),
     peer_type(-1),
     pipe_lock("SimpleMessenger::Pipe::pipe_lock"),
@@ -823,6 +825,14 @@ void Pipe::set_socket_options()
       ldout(msgr->cct,0) << "couldn't set SO_RCVBUF to " << size << ": " << cpp_strerror(r) << dendl;
     }
   }
+  if (msgr->cct->_conf->ms_tcp_sndbuf) {
+    int size = msgr->cct->_conf->ms_tcp_sndbuf;
+    int r = ::setsockopt(sd, SOL_SOCKET, SO_SNDBUF, (void*)&size, sizeof(size));
+    if (r < 0)  {
+      r = -errno;
+      ldout(msgr->cct,0) << "couldn't set SO_SNDBUF to " << size << ": " << cpp_strerror(r) << dendl;
+    }
+  }
 
   // block ESIGPIPE
 #ifdef CEPH_USE_SO_NOSIGPIPE
@@ -1783,6 +1793,17 @@ void Pipe::writer()
 	// encode and copy out of *m
 	m->encode(features, msgr->crcflags);
 
+	// compress the data payload?  this must happen after encode() (which
+	// resets the footer flags) and before the message is signed below.
+	// if the guard fails but the message was compressed for an earlier
+	// send attempt, restore the raw payload -- the peer can no longer
+	// decompress it.
+	if (msgr->cct->_conf->ms_compress_data &&
+	    (features & CEPH_FEATURE_MSG_DATA_COMPRESS))
+	  maybe_compress_message_data(msgr->cct, m);
+	else
+	  maybe_decompress_message_data(msgr->cct, m);
+
 	// prepare everything
 	const ceph_msg_header& header = m->get_header();
 	const ceph_msg_footer& footer = m->get_footer();
@@ -1808,10 +1829,15 @@ void Pipe::writer()
 	blist.append(m->get_middle());
 	blist.append(m->get_data());
 
+	// if more output is already queued, tell the kernel not to
+	// push this message out on its own; the next send follows
+	// immediately
+	bool more = is_queued();
+
         pipe_lock.Unlock();
 
         ldout(msgr->cct,20) << "writer sending " << m->get_seq() << " " << m << dendl;
-	int rc = write_message(header, footer, blist);
+	int rc = write_message(header, footer, blist, more);
 
 	pipe_lock.Lock();
 	if (rc < 0) {
@@ -1851,7 +1877,8 @@ void Pipe::unlock_maybe_reap()
   }
 }
 
-static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
+static void alloc_aligned_buffer(RecvBufferPool &pool, bufferlist& data,
+				 unsigned len, unsigned off)
 {
   // create a buffer to read into that matches the data alignment
   unsigned left = len;
@@ -1859,18 +1886,18 @@ static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
     // head
     unsigned head = 0;
     head = MIN(CEPH_PAGE_SIZE - (off & ~CEPH_PAGE_MASK), left);
-    bufferptr bp = buffer::create(head);
+    bufferptr bp = pool.alloc(head);
     data.push_back(bp);
     left -= head;
   }
   unsigned middle = left & CEPH_PAGE_MASK;
   if (middle > 0) {
-    bufferptr bp = buffer::create_page_aligned(middle);
+    bufferptr bp = pool.alloc(middle);
     data.push_back(bp);
     left -= middle;
   }
   if (left) {
-    bufferptr bp = buffer::create(left);
+    bufferptr bp = pool.alloc(left);
     data.push_back(bp);
   }
 }
@@ -1923,7 +1950,9 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
   unsigned data_len, data_off;
   int aborted;
   Message *message;
-  utime_t recv_stamp = ceph_clock_now(msgr->cct);
+  // charge the byte throttler matching this message's priority class
+  Throttle *policy_byte_throttler = policy.get_byte_throttler(header.priority);
+  utime_t recv_stamp = ceph_coarse_clock_now(msgr->cct);
 
   if (policy.throttler_messages) {
     ldout(msgr->cct,10) << "reader wants " << 1 << " message from policy throttler "
@@ -1934,11 +1963,11 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
 
   uint64_t message_size = header.front_len + header.middle_len + header.data_len;
   if (message_size) {
-    if (policy.throttler_bytes) {
+    if (policy_byte_throttler) {
       ldout(msgr->cct,10) << "reader wants " << message_size << " bytes from policy throttler "
-	       << policy.throttler_bytes->get_current() << "/"
-	       << policy.throttler_bytes->get_max() << dendl;
-      policy.throttler_bytes->get(message_size);
+	       << policy_byte_throttler->get_current() << "/"
+	       << policy_byte_throttler->get_max() << dendl;
+      policy_byte_throttler->get(message_size);
     }
 
     // throttle total bytes waiting for dispatch.  do this _after_ the
@@ -1951,12 +1980,12 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
     msgr->dispatch_throttler.get(message_size);
   }
 
-  utime_t throttle_stamp = ceph_clock_now(msgr->cct);
+  utime_t throttle_stamp = ceph_coarse_clock_now(msgr->cct);
 
   // read front
   front_len = header.front_len;
   if (front_len) {
-    bufferptr bp = buffer::create(front_len);
+    bufferptr bp = recv_pool.alloc(front_len);
     if (tcp_read(bp.c_str(), front_len) < 0)
       goto out_dethrottle;
     front.push_back(bp);
@@ -1966,7 +1995,7 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
   // read middle
   middle_len = header.middle_len;
   if (middle_len) {
-    bufferptr bp = buffer::create(middle_len);
+    bufferptr bp = recv_pool.alloc(middle_len);
     if (tcp_read(bp.c_str(), middle_len) < 0)
       goto out_dethrottle;
     middle.push_back(bp);
@@ -2009,7 +2038,7 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
       } else {
 	if (!newbuf.length()) {
 	  ldout(msgr->cct,20) << "reader allocating new rx buffer at offset " << offset << dendl;
-	  alloc_aligned_buffer(newbuf, data_len, data_off);
+	  alloc_aligned_buffer(recv_pool, newbuf, data_len, data_off);
 	  blp = newbuf.begin();
 	  blp.advance(offset);
 	}
@@ -2077,7 +2106,7 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
     } 
   }
 
-  message->set_byte_throttler(policy.throttler_bytes);
+  message->set_byte_throttler(policy_byte_throttler);
   message->set_message_throttler(policy.throttler_messages);
 
   // store reservation size in message, so we don't get confused
@@ -2086,7 +2115,7 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
 
   message->set_recv_stamp(recv_stamp);
   message->set_throttle_stamp(throttle_stamp);
-  message->set_recv_complete_stamp(ceph_clock_now(msgr->cct));
+  message->set_recv_complete_stamp(ceph_coarse_clock_now(msgr->cct));
 
   *pm = message;
   return 0;
@@ -2100,11 +2129,11 @@ int Pipe::read_message(Message **pm, AuthSessionHandler* auth_handler)
     policy.throttler_messages->put();
   }
   if (message_size) {
-    if (policy.throttler_bytes) {
+    if (policy_byte_throttler) {
       ldout(msgr->cct,10) << "reader releasing " << message_size << " bytes to policy throttler "
-			  << policy.throttler_bytes->get_current() << "/"
-			  << policy.throttler_bytes->get_max() << dendl;
-      policy.throttler_bytes->put(message_size);
+			  << policy_byte_throttler->get_current() << "/"
+			  << policy_byte_throttler->get_max() << dendl;
+      policy_byte_throttler->put(message_size);
     }
 
     msgr->dispatch_throttle_release(message_size);
@@ -2223,7 +2252,8 @@ int Pipe::write_keepalive2(char tag, const utime_t& t)
 }
 
 
-int Pipe::write_message(const ceph_msg_header& header, const ceph_msg_footer& footer, bufferlist& blist)
+int Pipe::write_message(const ceph_msg_header& header, const ceph_msg_footer& footer, bufferlist& blist,
+			bool more)
 {
   int ret;
 
@@ -2336,7 +2366,7 @@ int Pipe::write_message(const ceph_msg_header& header, const ceph_msg_footer& fo
   }
 
   // send
-  if (do_sendmsg(&msg, msglen))
+  if (do_sendmsg(&msg, msglen, more))
     goto fail;
 
   ret = 0;
@@ -20,6 +20,7 @@
 
 #include "msg/msg_types.h"
 #include "msg/Messenger.h"
+#include "msg/RecvBufferPool.h"
 #include "PipeConnection.h"
 
 
@@ -149,6 +150,7 @@ class DispatchQueue;
     int recv_max_prefetch;
     int recv_ofs;
     int recv_len;
+    RecvBufferPool recv_pool;  // recycled message buffers, reader thread only
 
     enum {
       STATE_ACCEPTING,
@@ -230,7 +232,8 @@ class DispatchQueue;
 
     int read_message(Message **pm,
 		     AuthSessionHandler *session_security_copy);
-    int write_message(const ceph_msg_header& h, const ceph_msg_footer& f, bufferlist& body);
+    int write_message(const ceph_msg_header& h, const ceph_msg_footer& f, bufferlist& body,
+		      bool more=false);
     /**
      * Write the given data (of length len) to the Pipe's socket. This function
      * will loop until all passed data has been written out.
@@ -17,6 +17,8 @@
 
 #include "common/debug.h"
 #include "common/config.h"
+#include "common/errno.h"
+#include "common/perf_counters.h"
 #include "include/assert.h"
 
 #define dout_subsys ceph_subsys_filestore
@@ -64,7 +66,8 @@ bool DBObjectMap::check(std::ostream &out)
     _Header header;
     assert(header.num_children == 1);
     header.num_children = 0; // Hack for leaf node
-    bufferlist bl = iter->value();
+    bufferlist bl;
+    bl.append(iter->value_as_ptr());
     while (true) {
       bufferlist::iterator bliter = bl.begin();
       header.decode(bliter);
@@ -433,6 +436,11 @@ bufferlist DBObjectMap::DBObjectMapIteratorImpl::value()
   return cur_iter->value();
 }
 
+bufferptr DBObjectMap::DBObjectMapIteratorImpl::value_as_ptr()
+{
+  return cur_iter->value_as_ptr();
+}
+
 int DBObjectMap::DBObjectMapIteratorImpl::status()
 {
   return r;
@@ -517,6 +525,12 @@ int DBObjectMap::clear(const ghobject_t &oid,
 		       const SequencerPosition *spos)
 {
   KeyValueDB::Transaction t = db->get_transaction();
+  // clearing is replay-tolerant: re-running after a partially applied
+  // clear just re-deletes what is left (worst case a crash in the
+  // window strands an unreferenced header, never user-visible keys),
+  // so let the backend commit it in bounded sub-batches instead of
+  // one giant stalling batch
+  t->set_splittable();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -933,7 +947,15 @@ int DBObjectMap::clone(const ghobject_t &oid,
   t->set(xattr_prefix(source), to_set);
   t->set(xattr_prefix(destination), to_set);
   t->rmkeys_by_prefix(xattr_prefix(parent));
-  return db->submit_transaction(t);
+  int r = db->submit_transaction(t);
+  if (r == 0) {
+    // each clone pushes both leaves one level below the old leaf; queue
+    // a background flatten if the chain has grown past the threshold
+    int depth = 1 + chain_depth(parent);
+    note_chain_depth(oid, depth);
+    note_chain_depth(target, depth);
+  }
+  return r;
 }
 
 int DBObjectMap::upgrade_to_v2()
@@ -962,7 +984,8 @@ int DBObjectMap::upgrade_to_v2()
 
       // decode header to get oid
       _Header hdr;
-      bufferlist bl = iter->value();
+      bufferlist bl;
+      bl.append(iter->value_as_ptr());
       bufferlist::iterator bliter = bl.begin();
       hdr.decode(bliter);
 
@@ -1027,9 +1050,153 @@ int DBObjectMap::init(bool do_upgrade)
     state.seq = 1;
   }
   dout(20) << "(init)dbobjectmap: seq is " << state.seq << dendl;
+
+  if (!logger) {
+    PerfCountersBuilder plb(g_ceph_context, "dbobjectmap",
+			    l_dbobjectmap_first, l_dbobjectmap_last);
+    plb.add_u64(l_dbobjectmap_max_chain_depth, "max_chain_depth",
+		"Deepest clone chain seen since start");
+    plb.add_u64_counter(l_dbobjectmap_flatten_queued, "flatten_queued",
+			"Clone chains queued for flattening");
+    plb.add_u64_counter(l_dbobjectmap_flattens, "flattens",
+			"Clone chains flattened");
+    logger = plb.create_perf_counters();
+    g_ceph_context->get_perfcounters_collection()->add(logger);
+  }
+  if (g_conf->filestore_omap_flatten_chain_depth > 0 &&
+      !flatten_thread.is_started())
+    flatten_thread.create();
   return 0;
 }
 
+DBObjectMap::~DBObjectMap()
+{
+  {
+    Mutex::Locker l(flatten_lock);
+    flatten_stop = true;
+    flatten_cond.Signal();
+  }
+  if (flatten_thread.is_started())
+    flatten_thread.join();
+  if (logger) {
+    g_ceph_context->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+}
+
+void DBObjectMap::flatten_thread_entry()
+{
+  Mutex::Locker l(flatten_lock);
+  while (!flatten_stop) {
+    if (flatten_queue.empty()) {
+      flatten_cond.Wait(flatten_lock);
+      continue;
+    }
+    ghobject_t oid = flatten_queue.front();
+    flatten_queue.pop_front();
+    flatten_queued.erase(oid);
+    flatten_lock.Unlock();
+    int r = flatten(oid);
+    if (r < 0 && r != -ENOENT)
+      derr << __func__ << " flatten of " << oid << " failed: "
+	   << cpp_strerror(r) << dendl;
+    flatten_lock.Lock();
+  }
+}
+
+int DBObjectMap::chain_depth(Header header)
+{
+  int depth = 1;
+  while (header->parent) {
+    Header parent = lookup_parent(header);
+    if (!parent)
+      break;
+    header.swap(parent);
+    ++depth;
+  }
+  return depth;
+}
+
+void DBObjectMap::note_chain_depth(const ghobject_t &oid, int depth)
+{
+  int max = g_conf->filestore_omap_flatten_chain_depth;
+  Mutex::Locker l(flatten_lock);
+  if (depth > deepest_chain) {
+    deepest_chain = depth;
+    if (logger)
+      logger->set(l_dbobjectmap_max_chain_depth, depth);
+  }
+  if (max <= 0 || depth <= max)
+    return;
+  if (!flatten_thread.is_started() || flatten_stop)
+    return;
+  if (flatten_queued.count(oid))
+    return;
+  dout(10) << __func__ << " " << oid << " chain depth " << depth
+	   << " > " << max << ", queueing flatten" << dendl;
+  flatten_queued.insert(oid);
+  flatten_queue.push_back(oid);
+  if (logger)
+    logger->inc(l_dbobjectmap_flatten_queued);
+  flatten_cond.Signal();
+}
+
+int DBObjectMap::flatten(const ghobject_t &oid)
+{
+  MapHeaderLock hl(this, oid);
+  Header header = lookup_map_header(hl, oid);
+  if (!header)
+    return -ENOENT;
+  if (!header->parent)
+    return 0;  // already flat
+
+  dout(10) << __func__ << " " << oid << " seq " << header->seq << dendl;
+
+  // materialize the merged key space; scope the iterator so the chain
+  // headers it pins are released before _clear walks them below
+  map<string, bufferlist> values;
+  {
+    DBObjectMapIterator iter = _get_iterator(header);
+    for (iter->seek_to_first(); iter->valid(); iter->next())
+      values.insert(make_pair(iter->key(), iter->value()));
+    if (iter->status() < 0)
+      return iter->status();
+  }
+  bufferlist user_header;
+  int r = _get_header(header, &user_header);
+  if (r < 0)
+    return r;
+  map<string, bufferlist> xattrs;
+  KeyValueDB::Iterator xattr_iter = db->get_iterator(xattr_prefix(header));
+  for (xattr_iter->seek_to_first();
+       xattr_iter->valid();
+       xattr_iter->next())
+    xattrs.insert(make_pair(xattr_iter->key(), xattr_iter->value()));
+
+  // swap in a parentless header carrying the same spos guard, then
+  // drop our reference on the old chain
+  KeyValueDB::Transaction t = db->get_transaction();
+  Header newheader = generate_new_header(oid, Header());
+  newheader->spos = header->spos;
+  remove_map_header(hl, oid, header, t);
+  set_map_header(hl, oid, *newheader, t);
+  if (!values.empty())
+    t->set(user_prefix(newheader), values);
+  if (!xattrs.empty())
+    t->set(xattr_prefix(newheader), xattrs);
+  if (user_header.length())
+    _set_header(newheader, user_header, t);
+  assert(header->num_children > 0);
+  header->num_children--;
+  r = _clear(header, t);
+  if (r < 0)
+    return r;
+  r = db->submit_transaction(t);
+  if (r == 0 && logger)
+    logger->inc(l_dbobjectmap_flattens);
+  return r;
+}
+
 int DBObjectMap::sync(const ghobject_t *oid,
 		      const SequencerPosition *spos) {
   KeyValueDB::Transaction t = db->get_transaction();
@@ -1080,13 +1247,10 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
   assert(l.get_locked() == oid);
 
   _Header *header = new _Header();
-  {
-    Mutex::Locker l(cache_lock);
-    if (caches.lookup(oid, header)) {
-      assert(!in_use.count(header->seq));
-      in_use.insert(header->seq);
-      return Header(header, RemoveOnDelete(this));
-    }
+  if (caches.lookup(oid, header)) {
+    assert(!in_use.count(header->seq));
+    in_use.insert(header->seq);
+    return Header(header, RemoveOnDelete(this));
   }
 
   map<string, bufferlist> out;
@@ -1101,10 +1265,7 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
   Header ret(header, RemoveOnDelete(this));
   bufferlist::iterator iter = out.begin()->second.begin();
   ret->decode(iter);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, *ret);
-  }
+  caches.add(oid, *ret);
 
   assert(!in_use.count(header->seq));
   in_use.insert(header->seq);
@@ -1134,12 +1295,25 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   Mutex::Locker l(header_lock);
   while (in_use.count(input->parent))
     header_cond.Wait(header_lock);
-  map<string, bufferlist> out;
-  set<string> keys;
-  keys.insert(HEADER_KEY);
 
   dout(20) << "lookup_parent: parent " << input->parent
        << " for seq " << input->seq << dendl;
+
+  {
+    Mutex::Locker pl(parent_cache_lock);
+    _Header cached;
+    if (parent_caches.lookup(input->parent, &cached)) {
+      dout(20) << "lookup_parent: parent seq " << cached.seq
+	   << " cached, parent " << cached.parent << dendl;
+      Header header = Header(new _Header(cached), RemoveOnDelete(this));
+      in_use.insert(header->seq);
+      return header;
+    }
+  }
+
+  map<string, bufferlist> out;
+  set<string> keys;
+  keys.insert(HEADER_KEY);
   int r = db->get(sys_parent_prefix(input), keys, &out);
   if (r < 0) {
     assert(0);
@@ -1156,6 +1330,11 @@ DBObjectMap::Header DBObjectMap::lookup_parent(Header input)
   header->decode(iter);
   dout(20) << "lookup_parent: parent seq is " << header->seq << " with parent "
        << header->parent << dendl;
+  {
+    Mutex::Locker pl(parent_cache_lock);
+    parent_caches.clear(header->seq);
+    parent_caches.add(header->seq, *header);
+  }
   in_use.insert(header->seq);
   return header;
 }
@@ -1177,6 +1356,10 @@ DBObjectMap::Header DBObjectMap::lookup_create_map_header(
 void DBObjectMap::clear_header(Header header, KeyValueDB::Transaction t)
 {
   dout(20) << "clear_header: clearing seq " << header->seq << dendl;
+  {
+    Mutex::Locker pl(parent_cache_lock);
+    parent_caches.clear(header->seq);
+  }
   t->rmkeys_by_prefix(user_prefix(header));
   t->rmkeys_by_prefix(sys_prefix(header));
   t->rmkeys_by_prefix(complete_prefix(header));
@@ -1192,6 +1375,11 @@ void DBObjectMap::set_header(Header header, KeyValueDB::Transaction t)
   map<string, bufferlist> to_write;
   header->encode(to_write[HEADER_KEY]);
   t->set(sys_prefix(header), to_write);
+  {
+    Mutex::Locker pl(parent_cache_lock);
+    parent_caches.clear(header->seq);
+    parent_caches.add(header->seq, *header);
+  }
 }
 
 void DBObjectMap::remove_map_header(
@@ -1206,10 +1394,7 @@ void DBObjectMap::remove_map_header(
   set<string> to_remove;
   to_remove.insert(map_header_key(oid));
   t->rmkeys(HOBJECT_TO_SEQ, to_remove);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.clear(oid);
-  }
+  caches.clear(oid);
 }
 
 void DBObjectMap::set_map_header(
@@ -1224,10 +1409,7 @@ void DBObjectMap::set_map_header(
   map<string, bufferlist> to_set;
   header.encode(to_set[map_header_key(oid)]);
   t->set(HOBJECT_TO_SEQ, to_set);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, header);
-  }
+  caches.add(oid, header);
 }
 
 bool DBObjectMap::check_spos(const ghobject_t &oid,
@@ -1255,7 +1437,8 @@ int DBObjectMap::list_objects(vector<ghobject_t> *out)
 {
   KeyValueDB::Iterator iter = db->get_iterator(HOBJECT_TO_SEQ);
   for (iter->seek_to_first(); iter->valid(); iter->next()) {
-    bufferlist bl = iter->value();
+    bufferlist bl;
+    bl.append(iter->value_as_ptr());
     bufferlist::iterator bliter = bl.begin();
     _Header header;
     header.decode(bliter);
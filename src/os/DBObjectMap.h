@@ -4,6 +4,7 @@
 
 #include "include/buffer.h"
 #include <set>
+#include <list>
 #include <map>
 #include <string>
 
@@ -16,9 +17,20 @@
 #include "osd/osd_types.h"
 #include "common/Mutex.h"
 #include "common/Cond.h"
+#include "common/Thread.h"
 #include "common/simple_cache.hpp"
 #include <boost/optional/optional_io.hpp>
 
+class PerfCounters;
+
+enum {
+  l_dbobjectmap_first = 34500,
+  l_dbobjectmap_max_chain_depth,
+  l_dbobjectmap_flatten_queued,
+  l_dbobjectmap_flattens,
+  l_dbobjectmap_last,
+};
+
 /**
  * DBObjectMap: Implements ObjectMap in terms of KeyValueDB
  *
@@ -114,10 +126,20 @@ public:
   };
 
   DBObjectMap(KeyValueDB *db) : db(db), header_lock("DBOBjectMap"),
-                                cache_lock("DBObjectMap::CacheLock"),
-                                caches(g_conf->filestore_omap_header_cache_size)
+                                logger(NULL),
+                                caches(g_conf->filestore_omap_header_cache_size,
+                                       g_conf->filestore_omap_header_cache_shards),
+                                parent_cache_lock("DBObjectMap::ParentCacheLock"),
+                                parent_caches(
+                                  g_conf->filestore_omap_parent_header_cache_size),
+                                flatten_lock("DBObjectMap::FlattenLock"),
+                                flatten_stop(false),
+                                flatten_thread(this),
+                                deepest_chain(1)
     {}
 
+  ~DBObjectMap();
+
   int set_keys(
     const ghobject_t &oid,
     const map<string, bufferlist> &set,
@@ -326,8 +348,100 @@ public:
 private:
   /// Implicit lock on Header->seq
   typedef ceph::shared_ptr<_Header> Header;
-  Mutex cache_lock;
-  SimpleLRU<ghobject_t, _Header, ghobject_t::BitwiseComparator> caches;
+
+  PerfCounters *logger;  ///< clone chain depth and flatten stats
+
+  /**
+   * Sharded write-through cache of per-object map headers.  Lookups
+   * vastly outnumber invalidations, so shard by object hash to keep
+   * omap ops on different objects from serializing on one cache lock.
+   */
+  struct HeaderCache {
+    struct Shard {
+      Mutex lock;
+      SimpleLRU<ghobject_t, _Header, ghobject_t::BitwiseComparator> cache;
+      explicit Shard(size_t max)
+	: lock("DBObjectMap::HeaderCache::Shard::lock"), cache(max) {}
+    };
+    vector<Shard*> shards;
+    HeaderCache(size_t size, int nshards) {
+      if (nshards < 1)
+	nshards = 1;
+      for (int i = 0; i < nshards; ++i)
+	shards.push_back(new Shard(MAX(size / nshards, (size_t)1)));
+    }
+    ~HeaderCache() {
+      while (!shards.empty()) {
+	delete shards.back();
+	shards.pop_back();
+      }
+    }
+    Shard &shard(const ghobject_t &oid) {
+      return *shards[oid.hobj.get_hash() % shards.size()];
+    }
+    bool lookup(const ghobject_t &oid, _Header *h) {
+      Shard &s = shard(oid);
+      Mutex::Locker l(s.lock);
+      return s.cache.lookup(oid, h);
+    }
+    void add(const ghobject_t &oid, const _Header &h) {
+      Shard &s = shard(oid);
+      Mutex::Locker l(s.lock);
+      s.cache.clear(oid);
+      s.cache.add(oid, h);
+    }
+    void clear(const ghobject_t &oid) {
+      Shard &s = shard(oid);
+      Mutex::Locker l(s.lock);
+      s.cache.clear(oid);
+    }
+  } caches;
+
+  /**
+   * Cache of parent (cloned) headers by seq, so walking a clone chain
+   * does not pay a KV round trip per level.  Parent headers are only
+   * rewritten or cleared while a live Header for that seq pins it in
+   * in_use, which blocks concurrent lookup_parent until the enclosing
+   * transaction has been submitted, so write-through stays coherent.
+   */
+  Mutex parent_cache_lock;
+  SimpleLRU<uint64_t, _Header> parent_caches;
+
+  /**
+   * Background flattening of deep clone chains.  Every omap read on a
+   * cloned object walks the parent chain, so snapshot-heavy objects
+   * get O(depth) slower with every clone.  clone() measures the
+   * resulting depth; chains deeper than
+   * filestore_omap_flatten_chain_depth are queued here and a worker
+   * rewrites them as materialized, parentless maps.  @see flatten
+   */
+  Mutex flatten_lock;
+  Cond flatten_cond;
+  list<ghobject_t> flatten_queue;
+  set<ghobject_t, ghobject_t::BitwiseComparator> flatten_queued;
+  bool flatten_stop;
+  class FlattenThread : public Thread {
+    DBObjectMap *map;
+  public:
+    FlattenThread(DBObjectMap *m) : map(m) {}
+    void *entry() {
+      map->flatten_thread_entry();
+      return NULL;
+    }
+  } flatten_thread;
+  int deepest_chain;  ///< deepest chain seen, under flatten_lock
+
+  void flatten_thread_entry();
+
+  /// length of the parent chain rooted at header, in headers
+  int chain_depth(Header header);
+
+  /// note a chain of the given depth ending at oid; queues a flatten
+  /// if it is past the configured limit
+  void note_chain_depth(const ghobject_t &oid, int depth);
+
+  /// rewrite oid's map as a single parentless header
+  int flatten(const ghobject_t &oid);
 
   string map_header_key(const ghobject_t &oid);
   string header_key(uint64_t seq);
@@ -388,6 +502,7 @@ private:
     int next();
     string key();
     bufferlist value();
+    bufferptr value_as_ptr();
     int status();
 
     bool on_parent() {
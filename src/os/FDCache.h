@@ -21,12 +21,18 @@
 #include "common/hobject.h"
 #include "common/Mutex.h"
 #include "common/Cond.h"
-#include "common/shared_cache.hpp"
+#include "osd/osd_types.h"
 #include "include/compat.h"
 #include "include/intarith.h"
+#include "include/Spinlock.h"
 
 /**
  * FD Cache
+ *
+ * Sharded fd cache.  Each shard is a small open-addressed hash table
+ * with CLOCK eviction, protected by a spinlock: the critical sections
+ * are a handful of probes, so lookups on the hot path spin briefly
+ * instead of sleeping on a per-shard mutex under heavy op thread load.
  */
 class FDCache : public md_config_obs_t {
 public:
@@ -48,44 +54,226 @@ public:
       VOID_TEMP_FAILURE_RETRY(::close(fd));
     }
   };
+  typedef ceph::shared_ptr<FD> FDRef;
 
 private:
+  struct Entry {
+    enum { FREE, USED, TOMB } state;
+    coll_t cid;
+    ghobject_t hoid;
+    FDRef fd;
+    bool ref;           ///< CLOCK referenced bit
+    Entry() : state(FREE), ref(false) {}
+  };
+
+  struct Shard {
+    Spinlock lock;
+    vector<Entry> slots;
+    size_t max_entries;
+    size_t count;       ///< USED slots
+    size_t tombs;       ///< TOMB slots
+    size_t hand;        ///< CLOCK hand
+    unsigned slot_bits; ///< log2(slots.size())
+
+    Shard() : max_entries(0), count(0), tombs(0), hand(0), slot_bits(0) {}
+
+    /// keep the table at most a quarter full so probe chains stay short
+    static size_t table_size(size_t max) {
+      size_t n = 8;
+      while (n < max * 4)
+	n <<= 1;
+      return n;
+    }
+
+    void init(size_t max) {
+      max_entries = MAX(max, (size_t)1);
+      slots.resize(table_size(max_entries));
+      slot_bits = 0;
+      while (((size_t)1 << slot_bits) < slots.size())
+	++slot_bits;
+    }
+
+    size_t first_slot(const ghobject_t &hoid) const {
+      // the low hash bits picked the shard, and multiplication mod 2^32
+      // only moves entropy upward, so masking the product's low bits
+      // would leave every object in this shard on the same slot.  take
+      // the product's high bits instead (Fibonacci hashing).
+      uint32_t h = hoid.hobj.get_hash() * 2654435761u;
+      return h >> (32 - slot_bits);
+    }
+
+    /// returns the USED entry for hoid, or NULL.  lock must be held.
+    Entry *find(const ghobject_t &hoid) {
+      size_t i = first_slot(hoid);
+      while (true) {
+	Entry &e = slots[i];
+	if (e.state == Entry::FREE)
+	  return NULL;
+	if (e.state == Entry::USED && e.hoid == hoid)
+	  return &e;
+	i = (i + 1) & (slots.size() - 1);
+      }
+    }
+
+    /// evict one unreferenced entry, giving each a second chance
+    void evict_one() {
+      while (true) {
+	Entry &e = slots[hand];
+	hand = (hand + 1) & (slots.size() - 1);
+	if (e.state != Entry::USED)
+	  continue;
+	if (e.ref) {
+	  e.ref = false;
+	  continue;
+	}
+	// holders of the FDRef keep the fd open; we just drop our ref
+	e.state = Entry::TOMB;
+	e.fd.reset();
+	--count;
+	++tombs;
+	return;
+      }
+    }
+
+    /// insert hoid, which must not be present.  lock must be held.
+    void insert(const coll_t &cid, const ghobject_t &hoid, const FDRef &fd) {
+      while (count >= max_entries)
+	evict_one();
+      size_t i = first_slot(hoid);
+      while (slots[i].state == Entry::USED)
+	i = (i + 1) & (slots.size() - 1);
+      Entry &e = slots[i];
+      if (e.state == Entry::TOMB)
+	--tombs;
+      e.state = Entry::USED;
+      e.cid = cid;
+      e.hoid = hoid;
+      e.fd = fd;
+      e.ref = false;
+      ++count;
+    }
+
+    /// re-place all USED entries, dropping tombstones
+    void rebuild(size_t new_capacity) {
+      vector<Entry> old;
+      old.swap(slots);
+      slots.resize(new_capacity);
+      count = 0;
+      tombs = 0;
+      hand = 0;
+      for (vector<Entry>::iterator p = old.begin(); p != old.end(); ++p) {
+	if (p->state != Entry::USED)
+	  continue;
+	size_t i = first_slot(p->hoid);
+	while (slots[i].state == Entry::USED)
+	  i = (i + 1) & (slots.size() - 1);
+	slots[i] = *p;
+	++count;
+      }
+    }
+
+    /// tombstones lengthen probe chains; fold them away when they pile up
+    void maybe_rebuild() {
+      if (tombs > slots.size() / 4)
+	rebuild(slots.size());
+    }
+
+    FDRef lookup(const ghobject_t &hoid) {
+      Spinlock::Locker l(lock);
+      Entry *e = find(hoid);
+      if (!e)
+	return FDRef();
+      e->ref = true;
+      return e->fd;
+    }
+
+    FDRef add(const coll_t &cid, const ghobject_t &hoid, int fd,
+	      bool *existed) {
+      Spinlock::Locker l(lock);
+      Entry *e = find(hoid);
+      if (e) {
+	*existed = true;
+	e->ref = true;
+	return e->fd;
+      }
+      *existed = false;
+      FDRef ref(new FD(fd));
+      insert(cid, hoid, ref);
+      maybe_rebuild();
+      return ref;
+    }
+
+    void clear(const ghobject_t &hoid) {
+      Spinlock::Locker l(lock);
+      Entry *e = find(hoid);
+      if (!e)
+	return;
+      e->state = Entry::TOMB;
+      e->fd.reset();
+      --count;
+      ++tombs;
+      maybe_rebuild();
+    }
+
+    void set_size(size_t max) {
+      Spinlock::Locker l(lock);
+      max_entries = MAX(max, (size_t)1);
+      while (count > max_entries)
+	evict_one();
+      size_t want = table_size(max_entries);
+      if (want != slots.size())
+	rebuild(want);
+      else
+	maybe_rebuild();
+    }
+
+    void dump_hot(list<pair<coll_t, ghobject_t> > *ls) {
+      Spinlock::Locker l(lock);
+      for (vector<Entry>::iterator p = slots.begin(); p != slots.end(); ++p)
+	if (p->state == Entry::USED)
+	  ls->push_back(make_pair(p->cid, p->hoid));
+    }
+  };
+
   CephContext *cct;
   const int registry_shards;
-  SharedLRU<ghobject_t, FD, ghobject_t::BitwiseComparator> *registry;
+  Shard *registry;
 
 public:
   FDCache(CephContext *cct) : cct(cct),
   registry_shards(cct->_conf->filestore_fd_cache_shards) {
     assert(cct);
     cct->_conf->add_observer(this);
-    registry = new SharedLRU<ghobject_t, FD, ghobject_t::BitwiseComparator>[registry_shards];
-    for (int i = 0; i < registry_shards; ++i) {
-      registry[i].set_cct(cct);
-      registry[i].set_size(
+    registry = new Shard[registry_shards];
+    for (int i = 0; i < registry_shards; ++i)
+      registry[i].init(
           MAX((cct->_conf->filestore_fd_cache_size / registry_shards), 1));
-    }
   }
   ~FDCache() {
     cct->_conf->remove_observer(this);
     delete[] registry;
   }
-  typedef ceph::shared_ptr<FD> FDRef;
 
   FDRef lookup(const ghobject_t &hoid) {
     int registry_id = hoid.hobj.get_hash() % registry_shards;
     return registry[registry_id].lookup(hoid);
   }
 
-  FDRef add(const ghobject_t &hoid, int fd, bool *existed) {
+  FDRef add(const coll_t &cid, const ghobject_t &hoid, int fd, bool *existed) {
     int registry_id = hoid.hobj.get_hash() % registry_shards;
-    return registry[registry_id].add(hoid, new FD(fd), existed);
+    return registry[registry_id].add(cid, hoid, fd, existed);
   }
 
   /// clear cached fd for hoid, subsequent lookups will get an empty FD
   void clear(const ghobject_t &hoid) {
     int registry_id = hoid.hobj.get_hash() % registry_shards;
-    registry[registry_id].purge(hoid);
+    registry[registry_id].clear(hoid);
+  }
+
+  /// everything currently cached, for persisting a hot set across restarts
+  void dump_hot(list<pair<coll_t, ghobject_t> > *ls) {
+    for (int i = 0; i < registry_shards; ++i)
+      registry[i].dump_hot(ls);
   }
 
   /// md_config_obs_t
@@ -956,6 +956,7 @@ void FileJournal::queue_completions_thru(uint64_t seq)
     if (logger) {
       logger->tinc(l_os_j_lat, lat);
     }
+    throttle_bytes.notify_latency(lat);
     if (next.finish)
       finisher->queue(next.finish);
     if (next.tracked_op)
@@ -1251,8 +1252,22 @@ void FileJournal::write_thread_entry()
 	dout(20) << "write_thread_entry woke up" << dendl;
 	continue;
       }
+      // group commit: dwell briefly so more entries can coalesce into
+      // the single prepared write (and single aio submission) below
+      if (g_conf->journal_batch_interval > 0 && !writeq.empty()) {
+	utime_t until = ceph_clock_now(NULL);
+	until += g_conf->journal_batch_interval;
+	while (!write_stop &&
+	       throttle_bytes.get_current() < g_conf->journal_batch_min_bytes &&
+	       ceph_clock_now(NULL) < until) {
+	  dout(20) << "write_thread_entry batching until " << until
+		   << " (" << throttle_bytes.get_current() << " bytes queued)"
+		   << dendl;
+	  writeq_cond.WaitUntil(writeq_lock, until);
+	}
+      }
     }
-    
+
 #ifdef HAVE_LIBAIO
     if (aio) {
       Mutex::Locker locker(aio_lock);
@@ -1421,7 +1436,10 @@ int FileJournal::write_aio_bl(off64_t& pos, bufferlist& bl, uint64_t seq)
   align_bl(pos, bl);
 
   dout(20) << "write_aio_bl " << pos << "~" << bl.length() << " seq " << seq << dendl;
-  
+
+  // prepare all the iocbs first so the whole batch goes to the kernel
+  // in a single io_submit call
+  vector<iocb*> piocbs;
   while (bl.length() > 0) {
     int max = MIN(bl.buffers().size(), IOV_MAX-1);
     iovec *iov = new iovec[max];
@@ -1451,24 +1469,26 @@ int FileJournal::write_aio_bl(off64_t& pos, bufferlist& bl, uint64_t seq)
     aio_num++;
     aio_bytes += aio.len;
 
-    iocb *piocb = &aio.iocb;
-    int attempts = 10;
-    do {
-      int r = io_submit(aio_ctx, 1, &piocb);
-      if (r < 0) {
-	derr << "io_submit to " << aio.off << "~" << aio.len
-	     << " got " << cpp_strerror(r) << dendl;
-	if (r == -EAGAIN && attempts-- > 0) {
-	  usleep(500);
-	  continue;
-	}
-	assert(0 == "io_submit got unexpected error");
-      } else {
-	break;
-      }
-    } while (true);
+    piocbs.push_back(&aio.iocb);
     pos += aio.len;
   }
+
+  int done = 0;
+  int attempts = 10;
+  while (done < (int)piocbs.size()) {
+    int r = io_submit(aio_ctx, piocbs.size() - done, &piocbs[done]);
+    if (r < 0) {
+      derr << "io_submit of " << (piocbs.size() - done) << " aios"
+	   << " got " << cpp_strerror(r) << dendl;
+      if (r == -EAGAIN && attempts-- > 0) {
+	usleep(500);
+	continue;
+      }
+      assert(0 == "io_submit got unexpected error");
+    }
+    // the kernel may accept only part of the batch
+    done += r;
+  }
   write_finish_cond.Signal();
   return 0;
 }
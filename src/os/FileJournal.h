@@ -282,8 +282,10 @@ private:
   uint64_t writing_seq;
 
   
-  // throttle
-  Throttle throttle_ops, throttle_bytes;
+  // throttle.  ops stays a static limit; the byte budget can adapt to
+  // a journal completion latency target (see journal_latency_target).
+  Throttle throttle_ops;
+  AdaptiveThrottle throttle_bytes;
 
   void put_throttle(uint64_t ops, uint64_t bytes);
 
@@ -391,6 +393,16 @@ private:
     write_thread(this),
     write_finish_thread(this) {
 
+      if (g_conf->journal_latency_target > 0) {
+	// adapt the byte budget to the latency target; keep a floor so
+	// a transient stall cannot choke admission off entirely
+	throttle_bytes.set_policy(
+	  g_conf->journal_queue_max_bytes / 16,
+	  g_conf->journal_queue_max_bytes,
+	  g_conf->journal_latency_target,
+	  g_conf->journal_latency_target_percentile);
+      }
+
       if (aio && !directio) {
         derr << "FileJournal::_open_any: aio not supported without directio; disabling aio" << dendl;
         aio = false;
@@ -304,11 +304,15 @@ int FileStore::lfn_open(coll_t cid,
                      << "):" << cpp_strerror(-r) << dendl;
       goto fail;
     }
+    list_cursor_cache.invalidate(cid);
+    // a new directory entry (and possibly an index split) is not
+    // covered by an fsync of the file itself
+    _dirty_sync_all();
   }
 
   if (!replaying) {
     bool existed;
-    *outfd = fdcache.add(oid, fd, &existed);
+    *outfd = fdcache.add(cid, oid, fd, &existed);
     if (existed) {
       TEMP_FAILURE_RETRY(::close(fd));
     }
@@ -434,7 +438,8 @@ int FileStore::lfn_link(coll_t c, coll_t newcid, const ghobject_t& o, const ghob
       assert(!m_filestore_fail_eio || r != -EIO);
       return r;
     }
-  }    
+  }
+  _dirty_sync_all();
   return 0;
 }
 
@@ -469,6 +474,7 @@ int FileStore::lfn_unlink(coll_t cid, const ghobject_t& o,
 	if (r == -ENOENT) {
 	  wbthrottle.clear_object(o); // should be only non-cache ref
 	  fdcache.clear(o);
+	  xattr_loc_cache.clear(o);
 	} else {
 	  assert(!m_filestore_fail_eio || r != -EIO);
 	}
@@ -492,6 +498,7 @@ int FileStore::lfn_unlink(coll_t cid, const ghobject_t& o,
       }
       wbthrottle.clear_object(o); // should be only non-cache ref
       fdcache.clear(o);
+      xattr_loc_cache.clear(o);
     } else {
       /* Ensure that replay of this op doesn't result in the object_map
        * going away.
@@ -505,6 +512,8 @@ int FileStore::lfn_unlink(coll_t cid, const ghobject_t& o,
     dout(25) << __func__ << " index unlink failed " << cpp_strerror(r) << dendl;
     return r;
   }
+  list_cursor_cache.invalidate(cid);
+  _dirty_sync_all();
   return 0;
 }
 
@@ -523,9 +532,13 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   force_sync(false), 
   sync_entry_timeo_lock("sync_entry_timeo_lock"),
   timer(g_ceph_context, sync_entry_timeo_lock),
-  stop(false), sync_thread(this),
+  stop(false),
+  dirty_sync_lock("FileStore::dirty_sync_lock"),
+  dirty_sync_full(false),
+  sync_thread(this),
   fdcache(g_ceph_context),
   wbthrottle(g_ceph_context),
+  xattr_loc_cache(g_conf->filestore_xattr_loc_cache_size),
   default_osr("default"),
   throttle_ops(g_ceph_context, "filestore_ops",g_conf->filestore_queue_max_ops),
   throttle_bytes(g_ceph_context, "filestore_bytes",g_conf->filestore_queue_max_bytes),
@@ -542,6 +555,9 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   m_filestore_fiemap_threshold(g_conf->filestore_fiemap_threshold),
   m_filestore_max_sync_interval(g_conf->filestore_max_sync_interval),
   m_filestore_min_sync_interval(g_conf->filestore_min_sync_interval),
+  m_filestore_incremental_sync(g_conf->filestore_incremental_sync),
+  m_filestore_incremental_sync_max_objects(
+    g_conf->filestore_incremental_sync_max_objects),
   m_filestore_fail_eio(g_conf->filestore_fail_eio),
   m_filestore_fadvise(g_conf->filestore_fadvise),
   do_update(do_update),
@@ -609,6 +625,9 @@ FileStore::FileStore(const std::string &base, const std::string &jdev, osflagbit
   g_ceph_context->get_perfcounters_collection()->add(logger);
   g_ceph_context->_conf->add_observer(this);
 
+  for (int i = 0; i < g_conf->filestore_async_read_threads; i++)
+    read_finishers.push_back(new Finisher(g_ceph_context));
+
   superblock.compat_features = get_fs_initial_compat_set();
 }
 
@@ -617,6 +636,11 @@ FileStore::~FileStore()
   g_ceph_context->_conf->remove_observer(this);
   g_ceph_context->get_perfcounters_collection()->remove(logger);
 
+  for (vector<Finisher*>::iterator p = read_finishers.begin();
+       p != read_finishers.end();
+       ++p)
+    delete *p;
+
   if (journal)
     journal->logger = NULL;
   delete logger;
@@ -1631,6 +1655,10 @@ int FileStore::mount()
   op_tp.start();
   op_finisher.start();
   ondisk_finisher.start();
+  for (vector<Finisher*>::iterator p = read_finishers.begin();
+       p != read_finishers.end();
+       ++p)
+    (*p)->start();
 
   timer.init();
 
@@ -1644,6 +1672,9 @@ int FileStore::mount()
     }
   }
 
+  if (g_conf->filestore_fd_cache_prewarm)
+    _prewarm_fdcache();
+
   // all okay.
   return 0;
 
@@ -1700,6 +1731,58 @@ void FileStore::init_temp_collections()
   }
 }
 
+void FileStore::_persist_fdcache_hot_set()
+{
+  list<pair<coll_t, ghobject_t> > ls;
+  fdcache.dump_hot(&ls);
+  if (ls.empty())
+    return;
+  bufferlist bl;
+  ::encode(ls, bl);
+  char fn[PATH_MAX];
+  snprintf(fn, sizeof(fn), "%s/fdcache_hot_set", basedir.c_str());
+  int r = bl.write_file(fn, 0644);
+  if (r < 0)
+    derr << __func__ << " failed to write " << fn << ": "
+	 << cpp_strerror(r) << dendl;
+  else
+    dout(10) << __func__ << " persisted " << ls.size() << " entries" << dendl;
+}
+
+void FileStore::_prewarm_fdcache()
+{
+  char fn[PATH_MAX];
+  snprintf(fn, sizeof(fn), "%s/fdcache_hot_set", basedir.c_str());
+  bufferlist bl;
+  string err;
+  if (bl.read_file(fn, &err) < 0)
+    return;
+  ::unlink(fn);  // stale once consumed
+
+  list<pair<coll_t, ghobject_t> > ls;
+  try {
+    bufferlist::iterator p = bl.begin();
+    ::decode(ls, p);
+  } catch (buffer::error& e) {
+    dout(0) << __func__ << " corrupt hot set, ignoring" << dendl;
+    return;
+  }
+
+  // objects (or whole collections) may be gone by now; just skip those
+  unsigned opened = 0;
+  for (list<pair<coll_t, ghobject_t> >::iterator p = ls.begin();
+       p != ls.end();
+       ++p) {
+    FDRef fd;
+    if (lfn_open(p->first, p->second, false, &fd) == 0) {
+      lfn_close(fd);
+      ++opened;
+    }
+  }
+  dout(10) << __func__ << " reopened " << opened << " of " << ls.size()
+	   << " hot fds" << dendl;
+}
+
 int FileStore::umount() 
 {
   dout(5) << "umount " << basedir << dendl;
@@ -1708,6 +1791,9 @@ int FileStore::umount()
   sync();
   do_force_sync();
 
+  if (g_conf->filestore_fd_cache_prewarm)
+    _persist_fdcache_hot_set();
+
   lock.Lock();
   stop = true;
   sync_cond.Signal();
@@ -1722,6 +1808,10 @@ int FileStore::umount()
 
   op_finisher.stop();
   ondisk_finisher.stop();
+  for (vector<Finisher*>::iterator p = read_finishers.begin();
+       p != read_finishers.end();
+       ++p)
+    (*p)->stop();
 
   if (fsid_fd >= 0) {
     VOID_TEMP_FAILURE_RETRY(::close(fsid_fd));
@@ -1965,14 +2055,18 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
 
     if (m_filestore_journal_parallel) {
       dout(5) << "queue_transactions (parallel) " << o->op << " " << o->tls << dendl;
-      
+      tracepoint(objectstore, journal_submit, osr->get_name().c_str(),
+		 o->op, tbl.length());
+
       _op_journal_transactions(tbl, data_align, o->op, ondisk, osd_op);
       
       // queue inside submit_manager op submission lock
       queue_op(osr, o);
     } else if (m_filestore_journal_writeahead) {
       dout(5) << "queue_transactions (writeahead) " << o->op << " " << o->tls << dendl;
-      
+      tracepoint(objectstore, journal_submit, osr->get_name().c_str(),
+		 o->op, tbl.length());
+
       osr->queue_journal(o->op);
 
       _op_journal_transactions(tbl, data_align, o->op,
@@ -2040,6 +2134,7 @@ int FileStore::queue_transactions(Sequencer *posr, list<Transaction*> &tls,
 void FileStore::_journaled_ahead(OpSequencer *osr, Op *o, Context *ondisk)
 {
   dout(5) << "_journaled_ahead " << o << " seq " << o->op << " " << *osr << " " << o->tls << dendl;
+  tracepoint(objectstore, journal_committed, osr->get_name().c_str(), o->op);
 
   // this should queue in order because the journal does it's completions in order.
   queue_op(osr, o);
@@ -2965,6 +3060,104 @@ int FileStore::read(
   }
 }
 
+struct C_FileStoreRead : public Context {
+  FileStore *fs;
+  coll_t cid;
+  ghobject_t oid;
+  uint64_t offset;
+  size_t len;
+  bufferlist *pbl;
+  Context *onfinish;
+  uint32_t op_flags;
+  C_FileStoreRead(FileStore *fs, coll_t cid, const ghobject_t& oid,
+		  uint64_t offset, size_t len, bufferlist *pbl,
+		  Context *onfinish, uint32_t op_flags)
+    : fs(fs), cid(cid), oid(oid), offset(offset), len(len),
+      pbl(pbl), onfinish(onfinish), op_flags(op_flags) {}
+  void finish(int) {
+    int r = fs->read(cid, oid, offset, len, *pbl, op_flags);
+    onfinish->complete(r);
+  }
+};
+
+struct C_FileStoreGetattr : public Context {
+  FileStore *fs;
+  coll_t cid;
+  ghobject_t oid;
+  string name;
+  bufferptr *value;
+  Context *onfinish;
+  C_FileStoreGetattr(FileStore *fs, coll_t cid, const ghobject_t& oid,
+		     const char *name, bufferptr *value, Context *onfinish)
+    : fs(fs), cid(cid), oid(oid), name(name), value(value),
+      onfinish(onfinish) {}
+  void finish(int) {
+    int r = fs->getattr(cid, oid, name.c_str(), *value);
+    onfinish->complete(r);
+  }
+};
+
+struct C_FileStoreOmapGet : public Context {
+  FileStore *fs;
+  coll_t cid;
+  ghobject_t oid;
+  bufferlist *header;
+  map<string, bufferlist> *out;
+  Context *onfinish;
+  C_FileStoreOmapGet(FileStore *fs, coll_t cid, const ghobject_t& oid,
+		     bufferlist *header, map<string, bufferlist> *out,
+		     Context *onfinish)
+    : fs(fs), cid(cid), oid(oid), header(header), out(out),
+      onfinish(onfinish) {}
+  void finish(int) {
+    int r = fs->omap_get(cid, oid, header, out);
+    onfinish->complete(r);
+  }
+};
+
+void FileStore::queue_read(coll_t cid, const ghobject_t& oid,
+			   uint64_t offset, size_t len,
+			   bufferlist *pbl, Context *onfinish,
+			   uint32_t op_flags)
+{
+  if (read_finishers.empty()) {
+    ObjectStore::queue_read(cid, oid, offset, len, pbl, onfinish, op_flags);
+    return;
+  }
+  dout(15) << "queue_read " << cid << "/" << oid << " "
+	   << offset << "~" << len << dendl;
+  read_finishers[oid.hobj.get_hash() % read_finishers.size()]->queue(
+    new C_FileStoreRead(this, cid, oid, offset, len, pbl, onfinish, op_flags));
+}
+
+void FileStore::queue_getattr(coll_t cid, const ghobject_t& oid,
+			      const char *name, bufferptr *value,
+			      Context *onfinish)
+{
+  if (read_finishers.empty()) {
+    ObjectStore::queue_getattr(cid, oid, name, value, onfinish);
+    return;
+  }
+  dout(15) << "queue_getattr " << cid << "/" << oid << " '" << name << "'"
+	   << dendl;
+  read_finishers[oid.hobj.get_hash() % read_finishers.size()]->queue(
+    new C_FileStoreGetattr(this, cid, oid, name, value, onfinish));
+}
+
+void FileStore::queue_omap_get(coll_t cid, const ghobject_t& oid,
+			       bufferlist *header,
+			       map<string, bufferlist> *out,
+			       Context *onfinish)
+{
+  if (read_finishers.empty()) {
+    ObjectStore::queue_omap_get(cid, oid, header, out, onfinish);
+    return;
+  }
+  dout(15) << "queue_omap_get " << cid << "/" << oid << dendl;
+  read_finishers[oid.hobj.get_hash() % read_finishers.size()]->queue(
+    new C_FileStoreOmapGet(this, cid, oid, header, out, onfinish));
+}
+
 int FileStore::_do_fiemap(int fd, uint64_t offset, size_t len,
                           map<uint64_t, uint64_t> *m)
 {
@@ -3129,6 +3322,8 @@ int FileStore::_truncate(coll_t cid, const ghobject_t& oid, uint64_t size)
 {
   dout(15) << "truncate " << cid << "/" << oid << " size " << size << dendl;
   int r = lfn_truncate(cid, oid, size);
+  if (r >= 0)
+    _dirty_sync_object(cid, oid);
   dout(10) << "truncate " << cid << "/" << oid << " size " << size << " = " << r << dendl;
   return r;
 }
@@ -3199,6 +3394,9 @@ int FileStore::_write(coll_t cid, const ghobject_t& oid,
 			  fadvise_flags & CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
   lfn_close(fd);
 
+  if (r >= 0)
+    _dirty_sync_object(cid, oid);
+
  out:
   dout(10) << "write " << cid << "/" << oid << " " << offset << "~" << len << " = " << r << dendl;
   return r;
@@ -3248,6 +3446,8 @@ int FileStore::_zero(coll_t cid, const ghobject_t& oid, uint64_t offset, size_t
   }
 
  out:
+  if (ret >= 0)
+    _dirty_sync_object(cid, oid);
   dout(20) << "zero " << cid << "/" << oid << " " << offset << "~" << len << " = " << ret << dendl;
   return ret;
 }
@@ -3260,6 +3460,8 @@ int FileStore::_clone(coll_t cid, const ghobject_t& oldoid, const ghobject_t& ne
   if (_check_replay_guard(cid, newoid, spos) < 0)
     return 0;
 
+  xattr_loc_cache.clear(newoid);
+
   int r;
   FDRef o, n;
   {
@@ -3324,6 +3526,8 @@ int FileStore::_clone(coll_t cid, const ghobject_t& oldoid, const ghobject_t& ne
  out:
   lfn_close(o);
  out2:
+  if (r >= 0)
+    _dirty_sync_object(cid, newoid);
   dout(10) << "clone " << cid << "/" << oldoid << " -> " << cid << "/" << newoid << " = " << r << dendl;
   assert(!m_filestore_fail_eio || r != -EIO);
   return r;
@@ -3541,6 +3745,8 @@ int FileStore::_clone_range(coll_t cid, const ghobject_t& oldoid, const ghobject
  out:
   lfn_close(o);
  out2:
+  if (r >= 0)
+    _dirty_sync_object(cid, newoid);
   dout(10) << "clone_range " << cid << "/" << oldoid << " -> " << cid << "/" << newoid << " "
 	   << srcoff << "~" << len << " to " << dstoff << " = " << r << dendl;
   return r;
@@ -3566,6 +3772,69 @@ private:
   int m_commit_timeo;
 };
 
+void FileStore::_dirty_sync_object(coll_t cid, const ghobject_t &oid)
+{
+  if (!m_filestore_incremental_sync)
+    return;
+  Mutex::Locker l(dirty_sync_lock);
+  dirty_sync_objects.insert(make_pair(cid, oid));
+}
+
+void FileStore::_dirty_sync_all()
+{
+  if (!m_filestore_incremental_sync)
+    return;
+  Mutex::Locker l(dirty_sync_lock);
+  dirty_sync_full = true;
+}
+
+// fsync just the files dirtied since the last commit when we can,
+// falling back to a full syncfs when the namespace changed or the
+// dirty set is too large for per-file fsyncs to beat syncfs
+int FileStore::_sync_dirty_set()
+{
+  set<pair<coll_t, ghobject_t>, DirtySyncComparator> dirty;
+  bool full;
+  {
+    Mutex::Locker l(dirty_sync_lock);
+    dirty.swap(dirty_sync_objects);
+    full = dirty_sync_full;
+    dirty_sync_full = false;
+  }
+  if (!m_filestore_incremental_sync || full ||
+      dirty.size() > (size_t)m_filestore_incremental_sync_max_objects) {
+    dout(10) << __func__ << " full syncfs, " << dirty.size()
+	     << " dirty objects, namespace dirty = " << (int)full << dendl;
+    return backend->syncfs();
+  }
+  dout(10) << __func__ << " fsyncing " << dirty.size() << " objects" << dendl;
+  for (set<pair<coll_t, ghobject_t>, DirtySyncComparator>::iterator p =
+	 dirty.begin();
+       p != dirty.end();
+       ++p) {
+    FDRef fd;
+    int r = lfn_open(p->first, p->second, false, &fd);
+    if (r == -ENOENT) {
+      // removed or renamed since it was dirtied.  a rename
+      // (collection_move_rename) keeps the dirty data live under a name
+      // we no longer have, so we cannot just skip it -- fall back to
+      // syncfs for this commit to cover whatever the file became
+      dout(10) << __func__ << " " << p->first << "/" << p->second
+	       << " went away, falling back to syncfs" << dendl;
+      return backend->syncfs();
+    }
+    if (r < 0)
+      return r;
+    r = ::fsync(**fd);
+    if (r < 0)
+      r = -errno;
+    lfn_close(fd);
+    if (r < 0)
+      return r;
+  }
+  return 0;
+}
+
 void FileStore::sync_entry()
 {
   lock.Lock();
@@ -3661,10 +3930,10 @@ void FileStore::sync_entry()
 	op_tp.unpause();
 
 	object_map->sync();
-	int err = backend->syncfs();
+	int err = _sync_dirty_set();
 	if (err < 0) {
-	  derr << "syncfs got " << cpp_strerror(err) << dendl;
-	  assert(0 == "syncfs returned error");
+	  derr << "sync got " << cpp_strerror(err) << dendl;
+	  assert(0 == "sync returned error");
 	}
 
 	err = write_op_seq(op_fd, cp);
@@ -3687,6 +3956,7 @@ void FileStore::sync_entry()
       logger->inc(l_os_commit);
       logger->tinc(l_os_commit_lat, lat);
       logger->tinc(l_os_commit_len, dur);
+      wbthrottle.notify_sync_latency(lat);
 
       apply_manager.commit_finish();
       wbthrottle.clear();
@@ -4122,6 +4392,8 @@ int FileStore::_setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr
   set<string> omap_remove;
   map<string, bufferptr> inline_set;
   map<string, bufferptr> inline_to_set;
+  XattrLocState xs;
+  bool cached = false;
   FDRef fd;
   int spill_out = -1;
   bool incomplete_inline = false;
@@ -4131,17 +4403,28 @@ int FileStore::_setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr
     goto out;
   }
 
-  char buf[2];
-  r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
-  if (r >= 0 && !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)))
-    spill_out = 0;
-  else
-    spill_out = 1;
+  cached = xattr_loc_cache.lookup(oid, &xs);
+  if (cached) {
+    spill_out = xs.spill_out ? 1 : 0;
+    // the logic below only looks at which names are inline
+    for (set<string>::iterator p = xs.inline_names.begin();
+	 p != xs.inline_names.end();
+	 ++p)
+      inline_set[*p];
+  } else {
+    char buf[2];
+    r = chain_fgetxattr(**fd, XATTR_SPILL_OUT_NAME, buf, sizeof(buf));
+    if (r >= 0 && !strncmp(buf, XATTR_NO_SPILL_OUT, sizeof(XATTR_NO_SPILL_OUT)))
+      spill_out = 0;
+    else
+      spill_out = 1;
 
-  r = _fgetattrs(**fd, inline_set);
-  incomplete_inline = (r == -E2BIG);
-  assert(!m_filestore_fail_eio || r != -EIO);
+    r = _fgetattrs(**fd, inline_set);
+    incomplete_inline = (r == -E2BIG);
+    assert(!m_filestore_fail_eio || r != -EIO);
+  }
   dout(15) << "setattrs " << cid << "/" << oid
+	   << (cached ? " (cached attr locations)" : "")
     	   << (incomplete_inline ? " (incomplete_inline, forcing omap)" : "")
 	   << dendl;
 
@@ -4207,9 +4490,28 @@ int FileStore::_setattrs(coll_t cid, const ghobject_t& oid, map<string,bufferptr
       goto out_close;
     }
   }
+
+  // remember where everything ended up for the next update
+  if (!incomplete_inline) {
+    xs.spill_out = (spill_out == 1) || !omap_set.empty();
+    xs.inline_names.clear();
+    for (map<string, bufferptr>::iterator p = inline_set.begin();
+	 p != inline_set.end();
+	 ++p)
+      xs.inline_names.insert(p->first);
+    xattr_loc_cache.clear(oid);
+    xattr_loc_cache.add(oid, xs);
+  } else {
+    xattr_loc_cache.clear(oid);
+  }
+
  out_close:
+  if (r < 0)
+    xattr_loc_cache.clear(oid);
   lfn_close(fd);
  out:
+  if (r >= 0)
+    _dirty_sync_object(cid, oid);
   dout(10) << "setattrs " << cid << "/" << oid << " = " << r << dendl;
   return r;
 }
@@ -4223,6 +4525,8 @@ int FileStore::_rmattr(coll_t cid, const ghobject_t& oid, const char *name,
   bool spill_out = true;
   bufferptr bp;
 
+  xattr_loc_cache.clear(oid);
+
   int r = lfn_open(cid, oid, false, &fd);
   if (r < 0) {
     goto out;
@@ -4256,6 +4560,8 @@ int FileStore::_rmattr(coll_t cid, const ghobject_t& oid, const char *name,
  out_close:
   lfn_close(fd);
  out:
+  if (r >= 0)
+    _dirty_sync_object(cid, oid);
   dout(10) << "rmattr " << cid << "/" << oid << " '" << name << "' = " << r << dendl;
   return r;
 }
@@ -4265,6 +4571,8 @@ int FileStore::_rmattrs(coll_t cid, const ghobject_t& oid,
 {
   dout(15) << "rmattrs " << cid << "/" << oid << dendl;
 
+  xattr_loc_cache.clear(oid);
+
   map<string,bufferptr> aset;
   FDRef fd;
   set<string> omap_attrs;
@@ -4324,6 +4632,8 @@ int FileStore::_rmattrs(coll_t cid, const ghobject_t& oid,
  out_close:
   lfn_close(fd);
  out:
+  if (r >= 0)
+    _dirty_sync_object(cid, oid);
   dout(10) << "rmattrs " << cid << "/" << oid << " = " << r << dendl;
   return r;
 }
@@ -4554,6 +4864,14 @@ int FileStore::collection_list(coll_t c, ghobject_t start, ghobject_t end,
     }
   }
 
+  unsigned cursor_size = g_conf->filestore_collection_list_cursor_size;
+  if (cursor_size &&
+      list_cursor_cache.fetch(c, start, end, sort_bitwise, max, ls, next)) {
+    dout(20) << __func__ << " served " << ls->size()
+	     << " entries from cursor cache, next " << *next << dendl;
+    return 0;
+  }
+
   Index index;
   int r = get_index(c, &index);
   if (r < 0)
@@ -4562,6 +4880,36 @@ int FileStore::collection_list(coll_t c, ghobject_t start, ghobject_t end,
   assert(NULL != index.index);
   RWLock::RLocker l((index.index)->access_lock);
 
+  if (cursor_size) {
+    // over-fetch so the next chunked call can be served from the tail
+    // we sorted anyway instead of re-walking the index
+    vector<ghobject_t> buf;
+    ghobject_t buf_next;
+    r = index->collection_list_partial(start, end, sort_bitwise,
+				       MAX((unsigned)max, cursor_size),
+				       &buf, &buf_next);
+    if (r < 0) {
+      assert(!m_filestore_fail_eio || r != -EIO);
+      return r;
+    }
+    if (!buf_next.is_max()) {
+      buf_next.hobj.pool = pool;
+      buf_next.set_shard(shard);
+    }
+    if ((int)buf.size() <= max) {
+      ls->insert(ls->end(), buf.begin(), buf.end());
+      *next = buf_next;
+    } else {
+      ls->insert(ls->end(), buf.begin(), buf.begin() + max);
+      *next = buf[max];
+      list_cursor_cache.store(c, *next, end, sort_bitwise,
+			      buf.begin() + max, buf.end(), buf_next);
+    }
+    dout(20) << "objects: " << *ls << dendl;
+    dout(20) << "  next " << *next << dendl;
+    return 0;
+  }
+
   r = index->collection_list_partial(start, end, sort_bitwise, max, ls, next);
 
   if (r < 0) {
@@ -4798,6 +5146,7 @@ int FileStore::_create_collection(
   r = init_index(c);
   if (r < 0)
     return r;
+  _dirty_sync_all();
 
   // create parallel temp collection, too
   if (!c.is_meta() && !c.is_temp()) {
@@ -4834,6 +5183,7 @@ int FileStore::_destroy_collection(coll_t c)
     r = -errno;
     goto out;
   }
+  _dirty_sync_all();
 
  out:
   // destroy parallel temp collection, too
@@ -4847,6 +5197,7 @@ int FileStore::_destroy_collection(coll_t c)
   }
 
  out_final:
+  list_cursor_cache.invalidate(c);
   dout(10) << "_destroy_collection " << fn << " = " << r << dendl;
   return r;
 }
@@ -4887,6 +5238,8 @@ int FileStore::_collection_add(coll_t c, coll_t oldcid, const ghobject_t& o,
   if (replaying && !backend->can_checkpoint() &&
       r == -EEXIST)    // crashed between link() and set_replay_guard()
     r = 0;
+  if (r == 0)
+    list_cursor_cache.invalidate(c);
 
   _inject_failure();
 
@@ -4908,6 +5261,10 @@ int FileStore::_collection_move_rename(coll_t oldcid, const ghobject_t& oldoid,
   int r = 0;
   int dstcmp, srccmp;
 
+  // the destination name inherits the source's attrs
+  xattr_loc_cache.clear(o);
+  list_cursor_cache.invalidate(c);
+
   if (replaying) {
     /* If the destination collection doesn't exist during replay,
      * we need to delete the src object and continue on
@@ -5153,6 +5510,10 @@ int FileStore::_split_collection(coll_t cid,
       r = from->split(rem, bits, to.index);
     }
 
+    _dirty_sync_all();
+    list_cursor_cache.invalidate(cid);
+    list_cursor_cache.invalidate(dest);
+
     _close_replay_guard(cid, spos);
     _close_replay_guard(dest, spos);
   }
@@ -35,6 +35,7 @@ using namespace std;
 #include "common/WorkQueue.h"
 
 #include "common/Mutex.h"
+#include "common/simple_cache.hpp"
 #include "HashIndex.h"
 #include "IndexManager.h"
 #include "ObjectMap.h"
@@ -146,11 +147,18 @@ private:
   }
   void init_temp_collections();
 
+  // fdcache hot set persisted across restarts
+  void _persist_fdcache_hot_set();
+  void _prewarm_fdcache();
+
   // ObjectMap
   boost::scoped_ptr<ObjectMap> object_map;
   
   Finisher ondisk_finisher;
 
+  // async reads (queue_read et al), sharded by object hash
+  vector<Finisher*> read_finishers;
+
   // helper fns
   int get_cdir(coll_t cid, char *s, int len);
   
@@ -170,6 +178,28 @@ private:
 
   list<Context*> sync_waiters;
   bool stop;
+
+  // incremental sync bookkeeping: objects whose file was dirtied
+  // since the last commit, and a flag forcing a full syncfs whenever
+  // the namespace changed (creates, unlinks, collection ops) since we
+  // cannot cheaply enumerate the directories those touch
+  struct DirtySyncComparator {
+    bool operator()(const pair<coll_t, ghobject_t>& l,
+		    const pair<coll_t, ghobject_t>& r) const {
+      if (l.first < r.first)
+	return true;
+      if (r.first < l.first)
+	return false;
+      return cmp_bitwise(l.second, r.second) < 0;
+    }
+  };
+  Mutex dirty_sync_lock;
+  set<pair<coll_t, ghobject_t>, DirtySyncComparator> dirty_sync_objects;
+  bool dirty_sync_full;
+  void _dirty_sync_object(coll_t cid, const ghobject_t &oid);
+  void _dirty_sync_all();
+  int _sync_dirty_set();
+
   void sync_entry();
   struct SyncThread : public Thread {
     FileStore *fs;
@@ -329,6 +359,79 @@ private:
   FDCache fdcache;
   WBThrottle wbthrottle;
 
+  /// which xattrs live inline vs spilled out to omap, cached per object
+  /// so _setattrs need not re-read the whole chain on every update.
+  /// Ops on one object are serialized by its sequencer; any path that
+  /// mutates attrs outside _setattrs just invalidates the entry.
+  struct XattrLocState {
+    bool spill_out;
+    set<string> inline_names;
+    XattrLocState() : spill_out(false) {}
+  };
+  SimpleLRU<ghobject_t, XattrLocState, ghobject_t::BitwiseComparator> xattr_loc_cache;
+
+  /**
+   * Tail of the most recent sorted listing, so the next chunked
+   * collection_list (scrub, backfill) picks up where the previous call
+   * left off instead of re-listing and re-sorting the same subdirs.
+   * A single entry suffices for the sequential cursor pattern; any op
+   * that adds or removes an object in the collection invalidates it.
+   */
+  struct ListCursorCache {
+    Mutex lock;
+    bool valid;
+    coll_t cid;
+    ghobject_t start;          ///< only serve a listing starting here
+    ghobject_t end;
+    bool sort_bitwise;
+    list<ghobject_t> entries;  ///< sorted tail beginning at start
+    ghobject_t index_next;     ///< where the index listing left off
+    ListCursorCache()
+      : lock("FileStore::ListCursorCache::lock"), valid(false),
+	sort_bitwise(false) {}
+    bool fetch(coll_t c, const ghobject_t &s, const ghobject_t &e,
+	       bool sort, int max, vector<ghobject_t> *ls,
+	       ghobject_t *next) {
+      Mutex::Locker l(lock);
+      if (!valid || !(cid == c) || start != s || end != e ||
+	  sort != sort_bitwise)
+	return false;
+      int n = 0;
+      while (!entries.empty() && n < max) {
+	ls->push_back(entries.front());
+	entries.pop_front();
+	++n;
+      }
+      if (!entries.empty()) {
+	*next = entries.front();
+	start = entries.front();
+      } else {
+	*next = index_next;
+	valid = false;
+      }
+      return true;
+    }
+    void store(coll_t c, const ghobject_t &s, const ghobject_t &e,
+	       bool sort,
+	       vector<ghobject_t>::const_iterator first,
+	       vector<ghobject_t>::const_iterator last,
+	       const ghobject_t &inext) {
+      Mutex::Locker l(lock);
+      valid = true;
+      cid = c;
+      start = s;
+      end = e;
+      sort_bitwise = sort;
+      entries.assign(first, last);
+      index_next = inext;
+    }
+    void invalidate(coll_t c) {
+      Mutex::Locker l(lock);
+      if (valid && cid == c)
+	valid = false;
+    }
+  } list_cursor_cache;
+
   Sequencer default_osr;
   deque<OpSequencer*> op_queue;
   Throttle throttle_ops, throttle_bytes;
@@ -542,6 +645,18 @@ public:
     bufferlist& bl,
     uint32_t op_flags = 0,
     bool allow_eio = false);
+  void queue_read(
+    coll_t cid, const ghobject_t& oid,
+    uint64_t offset, size_t len,
+    bufferlist *pbl, Context *onfinish,
+    uint32_t op_flags = 0);
+  void queue_getattr(
+    coll_t cid, const ghobject_t& oid, const char *name,
+    bufferptr *value, Context *onfinish);
+  void queue_omap_get(
+    coll_t cid, const ghobject_t& oid,
+    bufferlist *header, map<string, bufferlist> *out,
+    Context *onfinish);
   int _do_fiemap(int fd, uint64_t offset, size_t len,
                  map<uint64_t, uint64_t> *m);
   int _do_seek_hole_data(int fd, uint64_t offset, size_t len,
@@ -697,6 +812,8 @@ private:
   int m_filestore_fiemap_threshold;
   double m_filestore_max_sync_interval;
   double m_filestore_min_sync_interval;
+  bool m_filestore_incremental_sync;
+  int m_filestore_incremental_sync_max_objects;
   bool m_filestore_fail_eio;
   bool m_filestore_fadvise;
   int do_update;
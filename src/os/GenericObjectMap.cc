@@ -807,6 +807,25 @@ int GenericObjectMap::scan(Header header,
                            set<string> *out_keys,
                            map<string, bufferlist> *out_values)
 {
+  if (!header->parent) {
+    // No parent to fall through to, so we can batch all the lookups
+    // into a single multi-key fetch instead of paying an iterator
+    // seek per key.
+    map<string, bufferlist> values;
+    int r = db->get(user_prefix(header, prefix), in_keys, &values);
+    if (r < 0)
+      return r;
+    for (map<string, bufferlist>::iterator i = values.begin();
+         i != values.end();
+         ++i) {
+      if (out_keys)
+        out_keys->insert(i->first);
+      if (out_values)
+        out_values->insert(*i);
+    }
+    return 0;
+  }
+
   ObjectMap::ObjectMapIterator db_iter = _get_iterator(header, prefix);
   for (set<string>::const_iterator key_iter = in_keys.begin();
        key_iter != in_keys.end();
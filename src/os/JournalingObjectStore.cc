@@ -4,6 +4,7 @@
 
 #include "common/errno.h"
 #include "common/debug.h"
+#include "common/Thread.h"
 
 #define dout_subsys ceph_subsys_journal
 #undef dout_prefix
@@ -65,40 +66,121 @@ int JournalingObjectStore::journal_replay(uint64_t fs_op_seq)
   replaying = true;
 
   int count = 0;
-  while (1) {
-    bufferlist bl;
-    uint64_t seq = op_seq + 1;
-    if (!journal->read_entry(bl, seq)) {
-      dout(3) << "journal_replay: end of journal, done." << dendl;
-      break;
-    }
 
-    if (seq <= op_seq) {
-      dout(3) << "journal_replay: skipping old op seq " << seq << " <= " << op_seq << dendl;
-      continue;
-    }
-    assert(op_seq == seq-1);
-    
-    dout(3) << "journal_replay: applying op seq " << seq << dendl;
-    bufferlist::iterator p = bl.begin();
+  // We gather consecutive entries whose collection footprints are
+  // pairwise disjoint and apply each batch in parallel; entries that
+  // overlap (or whose footprint we cannot determine) start a new batch,
+  // so conflicting transactions are still applied strictly in order.
+  struct ReplayEntry {
+    uint64_t seq;
     list<Transaction*> tls;
-    while (!p.end()) {
-      Transaction *t = new Transaction(p);
-      tls.push_back(t);
+    set<coll_t> colls;
+  };
+  struct ReplayThread : public Thread {
+    JournalingObjectStore *store;
+    vector<ReplayEntry*> entries;
+    explicit ReplayThread(JournalingObjectStore *s) : store(s) {}
+    void *entry() {
+      for (vector<ReplayEntry*>::iterator p = entries.begin();
+	   p != entries.end();
+	   ++p) {
+	dout(3) << "journal_replay: applying op seq " << (*p)->seq << dendl;
+	store->apply_manager.op_apply_start((*p)->seq);
+	int r = store->do_transactions((*p)->tls, (*p)->seq);
+	store->apply_manager.op_apply_finish((*p)->seq);
+	dout(3) << "journal_replay: op seq " << (*p)->seq << " r = " << r
+		<< dendl;
+      }
+      return 0;
     }
+  };
+
+  int nthreads = MAX(g_conf->journal_replay_threads, 1);
+  unsigned batch_max = MAX(g_conf->journal_replay_batch_entries, 1u);
+
+  ReplayEntry *pending = NULL;
+  bool journal_done = false;
+  while (!journal_done || pending) {
+    // gather a batch of entries with disjoint collection footprints
+    vector<ReplayEntry*> batch;
+    set<coll_t> batch_colls;
+    while (batch.size() < batch_max) {
+      ReplayEntry *e = pending;
+      pending = NULL;
+      if (!e) {
+	if (journal_done)
+	  break;
+	bufferlist bl;
+	uint64_t seq = op_seq + 1;
+	if (!journal->read_entry(bl, seq)) {
+	  dout(3) << "journal_replay: end of journal, done." << dendl;
+	  journal_done = true;
+	  break;
+	}
+	if (seq <= op_seq) {
+	  dout(3) << "journal_replay: skipping old op seq " << seq << " <= " << op_seq << dendl;
+	  continue;
+	}
+	assert(op_seq == seq-1);
+
+	e = new ReplayEntry;
+	e->seq = seq;
+	bufferlist::iterator p = bl.begin();
+	while (!p.end()) {
+	  Transaction *t = new Transaction(p);
+	  t->get_collections(&e->colls);
+	  e->tls.push_back(t);
+	}
+	op_seq = seq;
+      }
 
-    apply_manager.op_apply_start(seq);
-    int r = do_transactions(tls, seq);
-    apply_manager.op_apply_finish(seq);
-
-    op_seq = seq;
-
-    while (!tls.empty()) {
-      delete tls.front(); 
-      tls.pop_front();
+      // an entry with no discernible footprint orders against everything
+      bool conflict = e->colls.empty();
+      for (set<coll_t>::iterator c = e->colls.begin();
+	   !conflict && c != e->colls.end();
+	   ++c)
+	conflict = batch_colls.count(*c);
+      if (conflict && !batch.empty()) {
+	pending = e;  // starts the next batch
+	break;
+      }
+      batch_colls.insert(e->colls.begin(), e->colls.end());
+      batch.push_back(e);
+      if (conflict)  // footprint unknown; apply it alone
+	break;
     }
+    if (batch.empty())
+      continue;
 
-    dout(3) << "journal_replay: r = " << r << ", op_seq now " << op_seq << dendl;
+    int n = MIN(nthreads, (int)batch.size());
+    vector<ReplayThread*> workers;
+    for (int i = 0; i < n; i++)
+      workers.push_back(new ReplayThread(this));
+    for (unsigned i = 0; i < batch.size(); i++)
+      workers[i % n]->entries.push_back(batch[i]);
+    if (n > 1) {
+      dout(10) << "journal_replay: applying " << batch.size()
+	       << " non-overlapping entries with " << n << " threads" << dendl;
+      for (int i = 0; i < n; i++)
+	workers[i]->create();
+      for (int i = 0; i < n; i++)
+	workers[i]->join();
+    } else {
+      workers[0]->entry();
+    }
+    for (int i = 0; i < n; i++)
+      delete workers[i];
+
+    for (vector<ReplayEntry*>::iterator i = batch.begin();
+	 i != batch.end();
+	 ++i) {
+      while (!(*i)->tls.empty()) {
+	delete (*i)->tls.front();
+	(*i)->tls.pop_front();
+      }
+      delete *i;
+    }
+    dout(3) << "journal_replay: op_seq now " << op_seq << dendl;
   }
 
   replaying = false;
@@ -4,6 +4,7 @@
 #define KEY_VALUE_DB_H
 
 #include "include/buffer.h"
+#include "include/assert.h"
 #include <set>
 #include <map>
 #include <string>
@@ -20,7 +21,12 @@ using std::string;
 class KeyValueDB {
 public:
   class TransactionImpl {
+  protected:
+    uint64_t approx_size;  ///< see get_approximate_size()
+    bool splittable;       ///< see set_splittable()
   public:
+    TransactionImpl() : approx_size(0), splittable(false) {}
+
     /// Set Keys
     void set(
       const string &prefix,                 ///< [in] Prefix for keys
@@ -60,6 +66,34 @@ public:
       const string &prefix ///< [in] Prefix by which to remove keys
       ) = 0;
 
+    /// Merge value into key, using the operator registered for the
+    /// prefix via set_merge_operator().  Mixing set() and merge() on
+    /// the same key within one transaction is backend-dependent; use
+    /// merge() consistently for merged keys.
+    virtual void merge(
+      const string &prefix,   ///< [in] Prefix for the key
+      const string &k,	      ///< [in] Key to merge into
+      const bufferlist &bl    ///< [in] Value to merge
+      ) {
+      assert(0 == "merge not supported by this backend");
+    }
+
+    /// Running estimate of the encoded bytes staged in this
+    /// transaction.  Backends keep it current as ops are added;
+    /// backends that do not account report 0.
+    uint64_t get_approximate_size() const { return approx_size; }
+
+    /// Declare that this transaction does not need whole-batch
+    /// atomicity.  The submit path may then commit it as several
+    /// bounded sub-batches, in op order, returning only after the
+    /// last one is submitted (and, for sync submits, durable -- which
+    /// orders everything before it).  Only flag transactions whose
+    /// callers tolerate replay after a prefix of the ops has been
+    /// applied, e.g. idempotent background deletions.  Backends
+    /// without split support commit the batch whole as usual.
+    void set_splittable() { splittable = true; }
+    bool is_splittable() const { return splittable; }
+
     virtual ~TransactionImpl() {}
   };
   typedef ceph::shared_ptr< TransactionImpl > Transaction;
@@ -74,6 +108,63 @@ public:
   virtual int open(ostream &out) = 0;
   virtual int create_and_open(ostream &out) = 0;
 
+  /// Route all keys whose prefix begins with the given string into a
+  /// separate column family (or equivalent keyspace) with
+  /// backend-specific tuning options, so that e.g. short-lived and
+  /// long-lived key classes do not share compaction.  Must be called
+  /// after init() and before open()/create_and_open().  Backends
+  /// without column family support keep everything in one keyspace.
+  virtual int set_column_family(const string &prefix_class,
+				const string &options) {
+    return -EOPNOTSUPP;
+  }
+
+  /// caller-supplied merge semantics for Transaction::merge(), so that
+  /// e.g. counters can be bumped without a synchronous read of the old
+  /// value first
+  class MergeOperator {
+  public:
+    /// merge into a value that did not previously exist
+    virtual void merge_nonexistent(
+      const char *rdata, size_t rlen,
+      std::string *new_value) = 0;
+    /// merge the merge operand into an existing value
+    virtual void merge(
+      const char *ldata, size_t llen,
+      const char *rdata, size_t rlen,
+      std::string *new_value) = 0;
+    /// stable name, recorded by backends that persist merge state
+    virtual string name() const = 0;
+    virtual ~MergeOperator() {}
+  };
+
+  /// register a merge operator for all keys with the given prefix;
+  /// must be called before open()/create_and_open().  Backends that
+  /// cannot defer the merge fall back to read-modify-write at
+  /// Transaction::merge() time.
+  virtual int set_merge_operator(const string &prefix,
+				 ceph::shared_ptr<MergeOperator> mop) {
+    return -EOPNOTSUPP;
+  }
+
+  /// Admission control for background compaction.  Backends with an
+  /// async compaction queue consult the governor before running each
+  /// queued range and hold the work while the store is reported busy,
+  /// so compaction stops landing on top of the op load it is
+  /// competing with.  Explicit compact() calls are never throttled.
+  class CompactionGovernor {
+  public:
+    /// true if background compaction may run now
+    virtual bool can_compact() = 0;
+    /// how long to wait before asking again, in seconds
+    virtual double recheck_interval() { return 5.0; }
+    virtual ~CompactionGovernor() {}
+  };
+
+  /// set the (caller-owned) compaction admission policy, or NULL to
+  /// always admit; ignored by backends without background compaction
+  virtual void set_compaction_governor(CompactionGovernor *g) {}
+
   virtual Transaction get_transaction() = 0;
   virtual int submit_transaction(Transaction) = 0;
   virtual int submit_transaction_sync(Transaction t) {
@@ -116,6 +207,16 @@ public:
     virtual string key() = 0;
     virtual pair<string,string> raw_key() = 0;
     virtual bufferlist value() = 0;
+    /// reference the backend's value buffer directly where possible
+    /// instead of copying; only valid until the iterator is
+    /// repositioned
+    virtual bufferptr value_as_ptr() {
+      bufferlist bl = value();
+      if (!bl.length())
+	return bufferptr();
+      bl.rebuild();
+      return bl.buffers().front();
+    }
     virtual int status() = 0;
     virtual ~WholeSpaceIteratorImpl() { }
   };
@@ -166,6 +267,9 @@ public:
     bufferlist value() {
       return generic_iter->value();
     }
+    bufferptr value_as_ptr() {
+      return generic_iter->value_as_ptr();
+    }
     int status() {
       return generic_iter->status();
     }
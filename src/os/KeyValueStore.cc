@@ -128,9 +128,8 @@ int StripObjectMap::lookup_strip_header(const coll_t &cid,
                                         StripObjectHeaderRef *strip_header)
 {
   {
-    Mutex::Locker l(lock);
     pair<coll_t, StripObjectHeaderRef> p;
-    if (caches.lookup(oid, &p)) {
+    if (get_cache(oid).lookup(oid, &p)) {
       if (p.first == cid) {
         *strip_header = p.second;
         return 0;
@@ -161,10 +160,7 @@ int StripObjectMap::lookup_strip_header(const coll_t &cid,
   tmp->cid = cid;
   tmp->header = header;
 
-  {
-    Mutex::Locker l(lock);
-    caches.add(oid, make_pair(cid, tmp));
-  }
+  get_cache(oid).add(oid, make_pair(cid, tmp));
   *strip_header = tmp;
   dout(10) << "lookup_strip_header done " << " cid " << cid << " oid "
            << oid << dendl;
@@ -538,6 +534,7 @@ KeyValueStore::KeyValueStore(const std::string &base,
   throttle_ops(g_ceph_context, "keyvaluestore_ops", g_conf->keyvaluestore_queue_max_ops),
   throttle_bytes(g_ceph_context, "keyvaluestore_bytes", g_conf->keyvaluestore_queue_max_bytes),
   op_finisher(g_ceph_context),
+  compaction_governor(this),
   op_tp(g_ceph_context, "KeyValueStore::op_tp",
         g_conf->keyvaluestore_op_threads, "keyvaluestore_op_threads"),
   op_wq(this, g_conf->keyvaluestore_op_thread_timeout,
@@ -588,6 +585,24 @@ KeyValueStore::~KeyValueStore()
   }
 }
 
+bool KeyValueStore::CompactionGovernor::can_compact()
+{
+  // inside the nightly window compaction is always admitted,
+  // regardless of load; begin == end disables the window
+  int b = g_conf->keyvaluestore_compact_begin_hour;
+  int e = g_conf->keyvaluestore_compact_end_hour;
+  if (b != e) {
+    struct tm bdt;
+    time_t tt = time(NULL);
+    localtime_r(&tt, &bdt);
+    if (b < e ? (bdt.tm_hour >= b && bdt.tm_hour < e)
+	      : (bdt.tm_hour >= b || bdt.tm_hour < e))
+      return true;
+  }
+  return store->throttle_ops.get_current() <=
+    g_conf->keyvaluestore_compact_max_inflight_ops;
+}
+
 int KeyValueStore::statfs(struct statfs *buf)
 {
   int r = backend->db->get_statfs(buf);
@@ -963,6 +978,8 @@ int KeyValueStore::mount()
       goto close_current_fd;
     }
 
+    store->set_compaction_governor(&compaction_governor);
+
     // get collection list
     set<string> keys;
     keys.insert("collections");
@@ -123,17 +123,32 @@ class StripObjectMap: public GenericObjectMap {
     set<string> *keys
     );
 
-  Mutex lock;
   void invalidate_cache(const coll_t &c, const ghobject_t &oid) {
-    Mutex::Locker l(lock);
-    caches.clear(oid);
+    get_cache(oid).clear(oid);
   }
 
-  RandomCache<ghobject_t, pair<coll_t, StripObjectHeaderRef> > caches;
-  StripObjectMap(KeyValueDB *db): GenericObjectMap(db),
-                                  lock("StripObjectMap::lock"),
-                                  caches(g_conf->keyvaluestore_header_cache_size)
-  {}
+  // Header cache is sharded by object hash so that concurrent lookups
+  // on different objects don't serialize on a single cache lock.
+  vector<RandomCache<ghobject_t, pair<coll_t, StripObjectHeaderRef> >*> caches;
+  RandomCache<ghobject_t, pair<coll_t, StripObjectHeaderRef> >&
+  get_cache(const ghobject_t &oid) {
+    return *caches[oid.hobj.get_hash() % caches.size()];
+  }
+  StripObjectMap(KeyValueDB *db): GenericObjectMap(db)
+  {
+    size_t shards = MAX(1, g_conf->keyvaluestore_header_cache_shards);
+    size_t per_shard = MAX(1, g_conf->keyvaluestore_header_cache_size / shards);
+    for (size_t i = 0; i < shards; ++i)
+      caches.push_back(
+        new RandomCache<ghobject_t, pair<coll_t, StripObjectHeaderRef> >(
+          per_shard));
+  }
+  ~StripObjectMap() {
+    for (vector<RandomCache<ghobject_t,
+                            pair<coll_t, StripObjectHeaderRef> >*>::iterator
+           i = caches.begin(); i != caches.end(); ++i)
+      delete *i;
+  }
 };
 
 
@@ -434,6 +449,15 @@ class KeyValueStore : public ObjectStore,
   Throttle throttle_ops, throttle_bytes;
   Finisher op_finisher;
 
+  // admit background kv compaction only when the op queue is shallow,
+  // or unconditionally inside the configured nightly window
+  class CompactionGovernor : public KeyValueDB::CompactionGovernor {
+    KeyValueStore *store;
+  public:
+    explicit CompactionGovernor(KeyValueStore *s) : store(s) {}
+    bool can_compact();
+  } compaction_governor;
+
   ThreadPool op_tp;
   struct OpWQ : public ThreadPool::WorkQueue<OpSequencer> {
     KeyValueStore *store;
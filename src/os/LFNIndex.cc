@@ -426,9 +426,14 @@ int LFNIndex::list_objects(const vector<string> &to_list, int max_objs,
 	r = -errno;
 	goto cleanup;
       } else if (r > 0) {
-	string long_name = lfn_generate_object_name(obj);
-	if (!lfn_must_hash(long_name)) {
-	  assert(long_name == short_name);
+	// regenerating the long name for every entry just to check the
+	// round trip is expensive on big directories; only do so when
+	// explicitly debugging the index
+	if (g_conf->filestore_index_verify_object_names) {
+	  string long_name = lfn_generate_object_name(obj);
+	  if (!lfn_must_hash(long_name)) {
+	    assert(long_name == short_name);
+	  }
 	}
 	if (index_version == HASH_INDEX_TAG)
 	  get_hobject_from_oinfo(to_list_path.c_str(), short_name.c_str(), &obj);
@@ -735,10 +740,10 @@ int LFNIndex::lfn_get_name(const vector<string> &path,
     if (mangled_name)
       *mangled_name = full_name;
     if (out_path)
-      *out_path = get_full_path(path, full_name);
+      *out_path = subdir_path + "/" + full_name;
     if (exists) {
       struct stat buf;
-      string full_path = get_full_path(path, full_name);
+      string full_path = subdir_path + "/" + full_name;
       maybe_inject_failure();
       r = ::stat(full_path.c_str(), &buf);
       if (r < 0) {
@@ -759,7 +764,7 @@ int LFNIndex::lfn_get_name(const vector<string> &path,
   char buf[FILENAME_MAX_LEN + 1];
   for ( ; ; ++i) {
     candidate = lfn_get_short_name(oid, i);
-    candidate_path = get_full_path(path, candidate);
+    candidate_path = subdir_path + "/" + candidate;
     r = chain_getxattr(candidate_path.c_str(), get_lfn_attr().c_str(),
 		       buf, sizeof(buf));
     if (r < 0) {
@@ -1311,11 +1316,18 @@ const string &LFNIndex::get_base_path()
 string LFNIndex::get_full_path_subdir(const vector<string> &rel)
 {
   string retval = get_base_path();
+  size_t length = retval.size();
+  for (vector<string>::const_iterator i = rel.begin();
+       i != rel.end();
+       ++i)
+    length += 1 + SUBDIR_PREFIX.size() + i->size();
+  retval.reserve(length);
   for (vector<string>::const_iterator i = rel.begin();
        i != rel.end();
        ++i) {
     retval += "/";
-    retval += mangle_path_component(*i);
+    retval += SUBDIR_PREFIX;
+    retval += *i;
   }
   return retval;
 }
@@ -168,6 +168,7 @@ void LevelDBStore::LevelDBTransactionImpl::set(
   bat.Delete(leveldb::Slice(key));
   bat.Put(leveldb::Slice(key),
 	  leveldb::Slice(val.c_str(), val.length()));
+  approx_size += key.size() + val.length();
 }
 
 void LevelDBStore::LevelDBTransactionImpl::rmkey(const string &prefix,
@@ -175,6 +176,7 @@ void LevelDBStore::LevelDBTransactionImpl::rmkey(const string &prefix,
 {
   string key = combine_strings(prefix, k);
   bat.Delete(leveldb::Slice(key));
+  approx_size += key.size();
 }
 
 void LevelDBStore::LevelDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
@@ -185,24 +187,59 @@ void LevelDBStore::LevelDBTransactionImpl::rmkeys_by_prefix(const string &prefix
        it->next()) {
     string key = combine_strings(prefix, it->key());
     bat.Delete(key);
+    approx_size += key.size();
   }
 }
 
+void LevelDBStore::LevelDBTransactionImpl::merge(
+  const string &prefix,
+  const string &k,
+  const bufferlist &to_merge_bl)
+{
+  KeyValueDB::MergeOperator *mop = db->get_merge_operator(prefix);
+  assert(mop);
+
+  // read-modify-write fallback.  merged keys are only updated under
+  // the caller's own serialization, so this is no worse than the
+  // read-modify-write the caller would otherwise do itself.
+  bufferlist cur;
+  int r = db->get(prefix, k, &cur);
+  //bufferlist::c_str() is non-constant, so we need to make a copy
+  bufferlist val = to_merge_bl;
+  string new_value;
+  if (r == -ENOENT) {
+    mop->merge_nonexistent(val.c_str(), val.length(), &new_value);
+  } else {
+    mop->merge(cur.c_str(), cur.length(),
+	       val.c_str(), val.length(),
+	       &new_value);
+  }
+  bufferlist new_bl;
+  new_bl.append(new_value);
+  set(prefix, k, new_bl);
+}
+
 int LevelDBStore::get(
     const string &prefix,
     const std::set<string> &keys,
     std::map<string, bufferlist> *out)
 {
   utime_t start = ceph_clock_now(g_ceph_context);
-  KeyValueDB::Iterator it = get_iterator(prefix);
+  // leveldb has no batched lookup, but a point Get can be answered
+  // from the bloom filter and block cache without materializing an
+  // iterator per key the way lower_bound does
   for (std::set<string>::const_iterator i = keys.begin();
        i != keys.end();
        ++i) {
-    it->lower_bound(*i);
-    if (it->valid() && it->key() == *i) {
-      out->insert(make_pair(*i, it->value()));
-    } else if (!it->valid())
-      break;
+    std::string value;
+    leveldb::Status s = db->Get(leveldb::ReadOptions(),
+				leveldb::Slice(combine_strings(prefix, *i)),
+				&value);
+    if (s.ok()) {
+      bufferlist bl;
+      bl.append(value);
+      out->insert(make_pair(*i, bl));
+    }
   }
   utime_t lat = ceph_clock_now(g_ceph_context) - start;
   logger->inc(l_leveldb_gets);
@@ -251,6 +288,17 @@ void LevelDBStore::compact_thread_entry()
   compact_queue_lock.Lock();
   while (!compact_queue_stop) {
     while (!compact_queue.empty()) {
+      if (compaction_governor && !compaction_governor->can_compact()) {
+	// hold queued work while the governor reports the store busy;
+	// ranges keep merging in the queue while we wait
+	utime_t interval;
+	interval.set_from_double(compaction_governor->recheck_interval());
+	compact_queue_cond.WaitInterval(g_ceph_context, compact_queue_lock,
+					interval);
+	if (compact_queue_stop)
+	  break;
+	continue;
+      }
       pair<string,string> range = compact_queue.front();
       compact_queue.pop_front();
       logger->set(l_leveldb_compact_queue_len, compact_queue.size());
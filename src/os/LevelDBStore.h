@@ -57,6 +57,8 @@ class LevelDBStore : public KeyValueDB {
 #endif
   boost::scoped_ptr<leveldb::DB> db;
 
+  vector<pair<string, ceph::shared_ptr<KeyValueDB::MergeOperator> > > merge_ops;
+
   int do_open(ostream &out, bool create_if_missing);
 
   // manage async compactions
@@ -74,6 +76,7 @@ class LevelDBStore : public KeyValueDB {
     }
     friend class LevelDBStore;
   } compact_thread;
+  KeyValueDB::CompactionGovernor *compaction_governor;
 
   void compact_thread_entry();
 
@@ -104,6 +107,11 @@ public:
     compact_range_async(combine_strings(prefix, start),
 			combine_strings(prefix, end));
   }
+  void set_compaction_governor(KeyValueDB::CompactionGovernor *g) {
+    Mutex::Locker l(compact_queue_lock);
+    compaction_governor = g;
+    compact_queue_cond.Signal();
+  }
 
 
   /**
@@ -155,6 +163,7 @@ public:
     compact_queue_lock("LevelDBStore::compact_thread_lock"),
     compact_queue_stop(false),
     compact_thread(this),
+    compaction_governor(NULL),
     options()
   {}
 
@@ -163,6 +172,24 @@ public:
   static int _test_init(const string& dir);
   int init(string option_str="");
 
+  int set_merge_operator(const string &prefix,
+			 ceph::shared_ptr<KeyValueDB::MergeOperator> mop) {
+    // leveldb has no native merge; Transaction::merge() falls back to
+    // read-modify-write using the registered operator
+    merge_ops.push_back(make_pair(prefix, mop));
+    return 0;
+  }
+
+  /// merge operator registered for the given prefix, if any
+  KeyValueDB::MergeOperator *get_merge_operator(const string &prefix) {
+    for (unsigned i = 0; i < merge_ops.size(); ++i) {
+      if (prefix.compare(0, merge_ops[i].first.length(),
+			 merge_ops[i].first) == 0)
+	return merge_ops[i].second.get();
+    }
+    return NULL;
+  }
+
   /// Opens underlying db
   int open(ostream &out) {
     return do_open(out, false);
@@ -189,6 +216,10 @@ public:
     void rmkeys_by_prefix(
       const string &prefix
       );
+    void merge(
+      const string &prefix,
+      const string &k,
+      const bufferlist &bl);
   };
 
   KeyValueDB::Transaction get_transaction() {
@@ -279,6 +310,11 @@ public:
     bufferlist value() {
       return to_bufferlist(dbiter->value());
     }
+    bufferptr value_as_ptr() {
+      leveldb::Slice val = dbiter->value();
+      return bufferptr(buffer::create_static(val.size(),
+					     (char*)val.data()));
+    }
     int status() {
       return dbiter->status().ok() ? 0 : -1;
     }
@@ -129,7 +129,8 @@ public:
     // can avoid allocations in read/write()
     static thread_local PageSet::page_vector tls_pages;
 
-    PageSetObject(size_t page_size) : data(page_size), data_len(0) {}
+    PageSetObject(size_t page_size, bool huge_pages)
+      : data(page_size, huge_pages), data_len(0) {}
 
     size_t get_size() const override { return data_len; }
 
@@ -169,7 +170,8 @@ public:
 
     ObjectRef create_object() const {
       if (use_page_set)
-        return new PageSetObject(cct->_conf->memstore_page_size);
+        return new PageSetObject(cct->_conf->memstore_page_size,
+                                 cct->_conf->memstore_huge_pages);
       return new BufferlistObject();
     }
 
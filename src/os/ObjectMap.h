@@ -146,6 +146,15 @@ public:
     virtual int next() = 0;
     virtual string key() = 0;
     virtual bufferlist value() = 0;
+    /// value without an intermediate copy where the backend supports
+    /// it; the result is only valid until the iterator is repositioned
+    virtual bufferptr value_as_ptr() {
+      bufferlist bl = value();
+      if (!bl.length())
+	return bufferptr();
+      bl.rebuild();
+      return bl.buffers().front();
+    }
     virtual int status() = 0;
     virtual ~ObjectMapIteratorImpl() {}
   };
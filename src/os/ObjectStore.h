@@ -439,6 +439,11 @@ public:
     __le32 coll_id;
     __le32 object_id;
 
+    // memoized encoded size of the index maps; valid only while the
+    // entry count still matches index_bytes_entries
+    uint64_t index_bytes;
+    size_t index_bytes_entries;
+
     bufferlist data_bl;
     bufferlist op_bl;
 
@@ -529,6 +534,8 @@ public:
       std::swap(object_index, other.object_index);
       std::swap(coll_id, other.coll_id);
       std::swap(object_id, other.object_id);
+      std::swap(index_bytes, other.index_bytes);
+      std::swap(index_bytes_entries, other.index_bytes_entries);
       op_bl.swap(other.op_bl);
       data_bl.swap(other.data_bl);
     }
@@ -694,14 +701,20 @@ public:
         return 1 + 8 + 8 + 4 + 4 + 4 + 4 + 4 + tbl.length();
       else {
         //layout: data_bl + op_bl + coll_index + object_index + data
-        //TODO: maybe we need better way to get encoded bytes;
-        bufferlist bl;
-        ::encode(coll_index, bl);
-        ::encode(object_index, bl);
+        // encoding the index maps just to size them is wasteful; they
+        // only change when an entry is added, so memoize by entry count
+        size_t entries = coll_index.size() + object_index.size();
+        if (entries != index_bytes_entries) {
+          bufferlist bl;
+          ::encode(coll_index, bl);
+          ::encode(object_index, bl);
+          index_bytes = bl.length();
+          index_bytes_entries = entries;
+        }
 
         return data_bl.length() +
           op_bl.length() +
-          bl.length() +
+          index_bytes +
           sizeof(data);
       }
     }
@@ -751,6 +764,15 @@ public:
     int get_num_ops() {
       return data.ops;
     }
+    /// Collections touched by this transaction (decodes tbl if needed)
+    void get_collections(set<coll_t> *out) {
+      if (use_tbl)
+	_build_actions_from_tbl();
+      for (map<coll_t, __le32>::iterator p = coll_index.begin();
+	   p != coll_index.end();
+	   ++p)
+	out->insert(p->first);
+    }
 
     void set_osr(void *s) {
       osr = s;
@@ -1458,13 +1480,17 @@ public:
       osr(NULL),
       use_tbl(false),
       coll_id(0),
-      object_id(0) { }
+      object_id(0),
+      index_bytes(0),
+      index_bytes_entries((size_t)-1) { }
 
     Transaction(bufferlist::iterator &dp) :
       osr(NULL),
       use_tbl(false),
       coll_id(0),
-      object_id(0) {
+      object_id(0),
+      index_bytes(0),
+      index_bytes_entries((size_t)-1) {
       decode(dp);
     }
 
@@ -1472,7 +1498,9 @@ public:
       osr(NULL),
       use_tbl(false),
       coll_id(0),
-      object_id(0) {
+      object_id(0),
+      index_bytes(0),
+      index_bytes_entries((size_t)-1) {
       bufferlist::iterator dp = nbl.begin();
       decode(dp);
     }
@@ -1539,6 +1567,7 @@ public:
         use_tbl = false;
         coll_id = coll_index.size();
         object_id = object_index.size();
+        index_bytes_entries = (size_t)-1;
 	decoded = true;
       }
 
@@ -1936,6 +1965,40 @@ public:
 			      bool sort_bitwise, int max,
 			      vector<ghobject_t> *ls, ghobject_t *next) = 0;
 
+  /**
+   * Asynchronous read interface
+   *
+   * Queue a read without blocking the calling thread; onfinish is
+   * completed with the usual return code once the output parameters
+   * have been populated.  The default implementations perform the
+   * synchronous call and complete the context inline, which is already
+   * "native" for stores that never block (e.g. MemStore); stores doing
+   * real I/O should override these and hand the work to their own
+   * threads.  The output parameters must remain valid until onfinish
+   * is completed.
+   */
+  virtual void queue_read(
+    coll_t cid, const ghobject_t& oid,
+    uint64_t offset, size_t len,
+    bufferlist *pbl, Context *onfinish,
+    uint32_t op_flags = 0) {
+    int r = read(cid, oid, offset, len, *pbl, op_flags);
+    onfinish->complete(r);
+  }
+  virtual void queue_getattr(
+    coll_t cid, const ghobject_t& oid, const char *name,
+    bufferptr *value, Context *onfinish) {
+    int r = getattr(cid, oid, name, *value);
+    onfinish->complete(r);
+  }
+  virtual void queue_omap_get(
+    coll_t cid, const ghobject_t& oid,
+    bufferlist *header, map<string, bufferlist> *out,
+    Context *onfinish) {
+    int r = omap_get(cid, oid, header, out);
+    onfinish->complete(r);
+  }
+
   /// OMAP
   /// Get omap contents
   virtual int omap_get(
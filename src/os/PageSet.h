@@ -19,13 +19,22 @@
 #include <atomic>
 #include <cassert>
 #include <mutex>
+#include <new>
 #include <vector>
+#include <stdlib.h>
+#include <sys/mman.h>
 #include <boost/intrusive/avl_set.hpp>
 #include <boost/intrusive_ptr.hpp>
 
 #include "include/encoding.h"
+#include "include/page.h"
 #include "include/Spinlock.h"
 
+// size of an x86_64 transparent hugepage; pages whose size is a
+// multiple of this are aligned so the kernel can actually back them
+// with hugepages
+#define PAGESET_HUGE_PAGE_SIZE (2u << 20)
+
 
 struct Page {
   char *const data;
@@ -62,11 +71,23 @@ struct Page {
     ::decode(offset, p);
   }
 
-  static Ref create(size_t page_size, uint64_t offset = 0) {
-    // allocate the Page and its data in a single buffer
-    auto buffer = new char[page_size + sizeof(Page)];
+  static Ref create(size_t page_size, uint64_t offset = 0,
+                    bool huge_pages = false) {
+    // allocate the Page and its data in a single buffer, aligned to
+    // the page (or hugepage) boundary so the data never straddles an
+    // extra hardware page
+    const bool huge = huge_pages && (page_size % PAGESET_HUGE_PAGE_SIZE == 0);
+    const size_t align = huge ? PAGESET_HUGE_PAGE_SIZE : CEPH_PAGE_SIZE;
+    void *buffer;
+    if (::posix_memalign(&buffer, align, page_size + sizeof(Page)))
+      throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    if (huge)
+      ::madvise(buffer, page_size, MADV_HUGEPAGE);
+#endif
     // place the Page structure at the end of the buffer
-    return new (buffer + page_size) Page(buffer, offset);
+    auto data = static_cast<char*>(buffer);
+    return new (data + page_size) Page(data, offset);
   }
 
   // copy disabled
@@ -77,7 +98,7 @@ struct Page {
   Page(char *data, uint64_t offset) : data(data), offset(offset), nrefs(1) {}
 
   static void operator delete(void *p) {
-    delete[] reinterpret_cast<Page*>(p)->data;
+    ::free(reinterpret_cast<Page*>(p)->data);
   }
 };
 
@@ -99,6 +120,7 @@ class PageSet {
 
   page_set pages;
   size_t page_size;
+  bool huge_pages;
 
   typedef Spinlock lock_type;
   lock_type mutex;
@@ -126,9 +148,11 @@ class PageSet {
   }
 
  public:
-  PageSet(size_t page_size) : page_size(page_size) {}
+  PageSet(size_t page_size, bool huge_pages = false)
+    : page_size(page_size), huge_pages(huge_pages) {}
   PageSet(PageSet &&rhs)
-    : pages(std::move(rhs.pages)), page_size(rhs.page_size) {}
+    : pages(std::move(rhs.pages)), page_size(rhs.page_size),
+      huge_pages(rhs.huge_pages) {}
   ~PageSet() {
     free_pages(pages.begin(), pages.end());
   }
@@ -158,7 +182,7 @@ class PageSet {
       typename page_set::insert_commit_data commit;
       auto insert = pages.insert_check(cur, page_offset, page_cmp(), commit);
       if (insert.second) {
-        auto page = Page::create(page_size, page_offset);
+        auto page = Page::create(page_size, page_offset, huge_pages);
         cur = pages.insert_commit(*page, commit);
 
         // assume that the caller will write to the range [offset,length),
@@ -217,7 +241,7 @@ class PageSet {
     ::decode(count, p);
     auto cur = pages.end();
     for (unsigned i = 0; i < count; i++) {
-      auto page = Page::create(page_size);
+      auto page = Page::create(page_size, 0, huge_pages);
       page->decode(p, page_size);
       cur = pages.insert_before(cur, *page);
     }
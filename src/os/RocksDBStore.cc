@@ -14,6 +14,7 @@
 #include "rocksdb/slice.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/filter_policy.h"
+#include "rocksdb/merge_operator.h"
 #include "rocksdb/utilities/convenience.h"
 using std::string;
 #include "common/perf_counters.h"
@@ -106,21 +107,207 @@ int RocksDBStore::init(string _options_str)
   return 0;
 }
 
+// routes rocksdb merge calls to the operator registered for the key's
+// prefix.  the key keeps its prefix\0key form, so we can dispatch the
+// same way the transaction ops do.
+class MergeOperatorRouter : public rocksdb::AssociativeMergeOperator {
+  RocksDBStore &store;
+  string nm;
+public:
+  explicit MergeOperatorRouter(RocksDBStore &_store) : store(_store) {
+    // rocksdb persists the operator name and refuses to open if it
+    // changes, so derive it from the registered operators
+    nm = "ceph";
+    for (unsigned i = 0; i < store.merge_ops.size(); ++i) {
+      nm += ",";
+      nm += store.merge_ops[i].first;
+      nm += ":";
+      nm += store.merge_ops[i].second->name();
+    }
+  }
+  const char *Name() const {
+    return nm.c_str();
+  }
+  bool Merge(const rocksdb::Slice& key,
+	     const rocksdb::Slice* existing_value,
+	     const rocksdb::Slice& value,
+	     std::string* new_value,
+	     rocksdb::Logger* logger) const {
+    string prefix;
+    if (RocksDBStore::split_key(key, &prefix, NULL) < 0)
+      return false;
+    KeyValueDB::MergeOperator *mop = store.get_merge_operator(prefix);
+    if (!mop)
+      return false;
+    if (existing_value)
+      mop->merge(existing_value->data(), existing_value->size(),
+		 value.data(), value.size(),
+		 new_value);
+    else
+      mop->merge_nonexistent(value.data(), value.size(), new_value);
+    return true;
+  }
+};
+
+int RocksDBStore::set_merge_operator(
+  const string &prefix,
+  ceph::shared_ptr<KeyValueDB::MergeOperator> mop)
+{
+  if (db) {
+    // the merge operator is bound when the db is opened
+    return -EINVAL;
+  }
+  merge_ops.push_back(make_pair(prefix, mop));
+  return 0;
+}
+
+KeyValueDB::MergeOperator *RocksDBStore::get_merge_operator(
+  const string &prefix)
+{
+  for (unsigned i = 0; i < merge_ops.size(); ++i) {
+    if (prefix.compare(0, merge_ops[i].first.length(),
+		       merge_ops[i].first) == 0)
+      return merge_ops[i].second.get();
+  }
+  return NULL;
+}
+
+int RocksDBStore::set_column_family(const string &prefix_class,
+				    const string &options)
+{
+  if (db) {
+    // column families are bound when the db is opened
+    return -EINVAL;
+  }
+  for (vector<ColumnFamily>::iterator p = column_families.begin();
+       p != column_families.end();
+       ++p) {
+    if (p->prefix == prefix_class) {
+      p->options = options;
+      return 0;
+    }
+  }
+  column_families.push_back(ColumnFamily(prefix_class, options));
+  return 0;
+}
+
+rocksdb::ColumnFamilyHandle *RocksDBStore::get_cf_handle(const string &prefix)
+{
+  for (vector<ColumnFamily>::iterator p = column_families.begin();
+       p != column_families.end();
+       ++p) {
+    if (prefix.compare(0, p->prefix.length(), p->prefix) == 0)
+      return p->handle;
+  }
+  return NULL;
+}
+
 int RocksDBStore::do_open(ostream &out, bool create_if_missing)
 {
   rocksdb::Options opt;
   rocksdb::Status status;
 
-  int r = ParseOptionsFromString(options_str, opt); 
+  int r = ParseOptionsFromString(options_str, opt);
   if (r != 0) {
     return -EINVAL;
   }
   opt.create_if_missing = create_if_missing;
+  if (!merge_ops.empty()) {
+    // shared by every column family; dispatch is by key prefix
+    opt.merge_operator.reset(new MergeOperatorRouter(*this));
+  }
 
-  status = rocksdb::DB::Open(opt, path, &db);
-  if (!status.ok()) {
-    derr << status.ToString() << dendl;
-    return -EINVAL;
+  // always enumerate what is on disk first: rocksdb refuses the plain
+  // single-family Open() when extra column families exist, and a prefix
+  // class that is no longer assigned (e.g. after a rollback) must keep
+  // routing to the family that still holds its keys
+  std::vector<std::string> existing;
+  rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(opt), path, &existing);
+  if (existing.empty())
+    existing.push_back(rocksdb::kDefaultColumnFamilyName);
+
+  if (column_families.empty() && existing.size() == 1) {
+    status = rocksdb::DB::Open(opt, path, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+  } else {
+    // we must open every column family present on disk, and create any
+    // assigned ones that do not exist yet
+    std::vector<rocksdb::ColumnFamilyDescriptor> descs;
+    for (std::vector<std::string>::iterator p = existing.begin();
+	 p != existing.end();
+	 ++p) {
+      rocksdb::ColumnFamilyOptions cf_opt(opt);
+      for (vector<ColumnFamily>::iterator q = column_families.begin();
+	   q != column_families.end();
+	   ++q) {
+	if (q->prefix == *p && q->options.length()) {
+	  status = rocksdb::GetColumnFamilyOptionsFromString(
+	    cf_opt, q->options, &cf_opt);
+	  if (!status.ok()) {
+	    derr << __func__ << " invalid options for column family " << *p
+		 << ": " << status.ToString() << dendl;
+	    return -EINVAL;
+	  }
+	}
+      }
+      descs.push_back(rocksdb::ColumnFamilyDescriptor(*p, cf_opt));
+    }
+
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    status = rocksdb::DB::Open(opt, path, descs, &handles, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+    cf_handles = handles;
+    for (unsigned i = 0; i < handles.size(); ++i) {
+      bool assigned = false;
+      for (vector<ColumnFamily>::iterator q = column_families.begin();
+	   q != column_families.end();
+	   ++q) {
+	if (q->prefix == existing[i]) {
+	  q->handle = handles[i];
+	  assigned = true;
+	}
+      }
+      if (!assigned && existing[i] != rocksdb::kDefaultColumnFamilyName) {
+	// the prefix class was unassigned (rollback), but its keys are
+	// still in this family; keep routing reads and writes to it so
+	// the default family cannot shadow them with stale data
+	derr << __func__ << " column family " << existing[i]
+	     << " has no assigned prefix class, keeping its keys routed"
+	     << " to it" << dendl;
+	column_families.push_back(ColumnFamily(existing[i], string()));
+	column_families.back().handle = handles[i];
+      }
+    }
+
+    for (vector<ColumnFamily>::iterator q = column_families.begin();
+	 q != column_families.end();
+	 ++q) {
+      if (q->handle)
+	continue;
+      rocksdb::ColumnFamilyOptions cf_opt(opt);
+      if (q->options.length()) {
+	status = rocksdb::GetColumnFamilyOptionsFromString(
+	  cf_opt, q->options, &cf_opt);
+	if (!status.ok()) {
+	  derr << __func__ << " invalid options for column family "
+	       << q->prefix << ": " << status.ToString() << dendl;
+	  return -EINVAL;
+	}
+      }
+      status = db->CreateColumnFamily(cf_opt, q->prefix, &q->handle);
+      if (!status.ok()) {
+	derr << __func__ << " failed to create column family " << q->prefix
+	     << ": " << status.ToString() << dendl;
+	return -EINVAL;
+      }
+      cf_handles.push_back(q->handle);
+    }
   }
 
   PerfCountersBuilder plb(g_ceph_context, "rocksdb", l_rocksdb_first, l_rocksdb_last);
@@ -133,6 +320,7 @@ int RocksDBStore::do_open(ostream &out, bool create_if_missing)
   plb.add_u64_counter(l_rocksdb_compact_range, "rocksdb_compact_range", "Compactions by range");
   plb.add_u64_counter(l_rocksdb_compact_queue_merge, "rocksdb_compact_queue_merge", "Mergings of ranges in compaction queue");
   plb.add_u64(l_rocksdb_compact_queue_len, "rocksdb_compact_queue_len", "Length of compaction queue");
+  plb.add_u64_counter(l_rocksdb_txn_splits, "rocksdb_transaction_splits", "Sub-batches split off splittable transactions");
   logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 
@@ -159,6 +347,11 @@ RocksDBStore::~RocksDBStore()
   close();
   delete logger;
 
+  // column family handles must go before the db they belong to
+  for (unsigned i = 0; i < cf_handles.size(); ++i)
+    delete cf_handles[i];
+  cf_handles.clear();
+
   // Ensure db is destroyed before dependent db_cache and filterpolicy
   delete db;
 }
@@ -187,7 +380,18 @@ int RocksDBStore::submit_transaction(KeyValueDB::Transaction t)
     static_cast<RocksDBTransactionImpl *>(t.get());
   rocksdb::WriteOptions woptions;
   woptions.disableWAL = disableWAL;
-  rocksdb::Status s = db->Write(woptions, _t->bat);
+  // a splittable transaction commits as a series of bounded Writes so
+  // other users of the store can interleave; op order is preserved and
+  // the caller only sees completion once the final batch is in
+  rocksdb::Status s = rocksdb::Status::OK();
+  for (vector<rocksdb::WriteBatch*>::iterator p = _t->split_bats.begin();
+       s.ok() && p != _t->split_bats.end();
+       ++p) {
+    s = db->Write(woptions, *p);
+    logger->inc(l_rocksdb_txn_splits);
+  }
+  if (s.ok())
+    s = db->Write(woptions, _t->bat);
   utime_t lat = ceph_clock_now(g_ceph_context) - start;
   logger->inc(l_rocksdb_txns);
   logger->tinc(l_rocksdb_submit_latency, lat);
@@ -200,9 +404,19 @@ int RocksDBStore::submit_transaction_sync(KeyValueDB::Transaction t)
   RocksDBTransactionImpl * _t =
     static_cast<RocksDBTransactionImpl *>(t.get());
   rocksdb::WriteOptions woptions;
-  woptions.sync = true;
   woptions.disableWAL = disableWAL;
-  rocksdb::Status s = db->Write(woptions, _t->bat);
+  // sub-batches go in without sync; the final sync Write acts as the
+  // barrier, since the WAL orders everything written before it
+  rocksdb::Status s = rocksdb::Status::OK();
+  for (vector<rocksdb::WriteBatch*>::iterator p = _t->split_bats.begin();
+       s.ok() && p != _t->split_bats.end();
+       ++p) {
+    s = db->Write(woptions, *p);
+    logger->inc(l_rocksdb_txn_splits);
+  }
+  woptions.sync = true;
+  if (s.ok())
+    s = db->Write(woptions, _t->bat);
   utime_t lat = ceph_clock_now(g_ceph_context) - start;
   logger->inc(l_rocksdb_txns);
   logger->tinc(l_rocksdb_submit_sync_latency, lat);
@@ -229,11 +443,28 @@ RocksDBStore::RocksDBTransactionImpl::RocksDBTransactionImpl(RocksDBStore *_db)
 {
   db = _db;
   bat = new rocksdb::WriteBatch();
+  cur_bat_size = 0;
 }
 RocksDBStore::RocksDBTransactionImpl::~RocksDBTransactionImpl()
 {
+  for (vector<rocksdb::WriteBatch*>::iterator p = split_bats.begin();
+       p != split_bats.end();
+       ++p)
+    delete *p;
   delete bat;
 }
+
+void RocksDBStore::RocksDBTransactionImpl::account(uint64_t bytes)
+{
+  approx_size += bytes;
+  cur_bat_size += bytes;
+  uint64_t max = db->cct->_conf->rocksdb_transaction_split_size;
+  if (is_splittable() && max && cur_bat_size >= max) {
+    split_bats.push_back(bat);
+    bat = new rocksdb::WriteBatch();
+    cur_bat_size = 0;
+  }
+}
 void RocksDBStore::RocksDBTransactionImpl::set(
   const string &prefix,
   const string &k,
@@ -242,42 +473,107 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   string key = combine_strings(prefix, k);
   //bufferlist::c_str() is non-constant, so we need to make a copy
   bufferlist val = to_set_bl;
-  bat->Delete(rocksdb::Slice(key));
-  bat->Put(rocksdb::Slice(key),
-	  rocksdb::Slice(val.c_str(), val.length()));
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf) {
+    bat->Delete(cf, rocksdb::Slice(key));
+    bat->Put(cf, rocksdb::Slice(key),
+	     rocksdb::Slice(val.c_str(), val.length()));
+  } else {
+    bat->Delete(rocksdb::Slice(key));
+    bat->Put(rocksdb::Slice(key),
+	     rocksdb::Slice(val.c_str(), val.length()));
+  }
+  account(key.size() + val.length());
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
-  bat->Delete(combine_strings(prefix, k));
+  string key = combine_strings(prefix, k);
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf)
+    bat->Delete(cf, key);
+  else
+    bat->Delete(key);
+  account(key.size());
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
   KeyValueDB::Iterator it = db->get_iterator(prefix);
   for (it->seek_to_first();
        it->valid();
        it->next()) {
-    bat->Delete(combine_strings(prefix, it->key()));
+    string key = combine_strings(prefix, it->key());
+    if (cf)
+      bat->Delete(cf, key);
+    else
+      bat->Delete(key);
+    // each delete stands alone, so a splittable transaction may be
+    // cut in the middle of the prefix sweep
+    account(key.size());
   }
 }
 
+void RocksDBStore::RocksDBTransactionImpl::merge(
+  const string &prefix,
+  const string &k,
+  const bufferlist &to_merge_bl)
+{
+  string key = combine_strings(prefix, k);
+  //bufferlist::c_str() is non-constant, so we need to make a copy
+  bufferlist val = to_merge_bl;
+  rocksdb::ColumnFamilyHandle *cf = db->get_cf_handle(prefix);
+  if (cf)
+    bat->Merge(cf, rocksdb::Slice(key),
+	       rocksdb::Slice(val.c_str(), val.length()));
+  else
+    bat->Merge(rocksdb::Slice(key),
+	       rocksdb::Slice(val.c_str(), val.length()));
+  account(key.size() + val.length());
+}
+
 int RocksDBStore::get(
     const string &prefix,
     const std::set<string> &keys,
     std::map<string, bufferlist> *out)
 {
   utime_t start = ceph_clock_now(g_ceph_context);
-  KeyValueDB::Iterator it = get_iterator(prefix);
+  // issue all the lookups as a single MultiGet so rocksdb can batch
+  // the memtable/sst probes instead of us paying a seek per key
+  std::vector<std::string> ks;
+  ks.reserve(keys.size());
   for (std::set<string>::const_iterator i = keys.begin();
        i != keys.end();
        ++i) {
-    it->lower_bound(*i);
-    if (it->valid() && it->key() == *i) {
-      out->insert(make_pair(*i, it->value()));
-    } else if (!it->valid())
-      break;
+    ks.push_back(combine_strings(prefix, *i));
+  }
+  std::vector<rocksdb::Slice> slices;
+  slices.reserve(ks.size());
+  for (std::vector<std::string>::const_iterator i = ks.begin();
+       i != ks.end();
+       ++i) {
+    slices.push_back(rocksdb::Slice(*i));
+  }
+  std::vector<std::string> values;
+  std::vector<rocksdb::Status> statuses;
+  rocksdb::ColumnFamilyHandle *cf = get_cf_handle(prefix);
+  if (cf) {
+    std::vector<rocksdb::ColumnFamilyHandle*> cfs(slices.size(), cf);
+    statuses = db->MultiGet(rocksdb::ReadOptions(), cfs, slices, &values);
+  } else {
+    statuses = db->MultiGet(rocksdb::ReadOptions(), slices, &values);
+  }
+  unsigned j = 0;
+  for (std::set<string>::const_iterator i = keys.begin();
+       i != keys.end();
+       ++i, ++j) {
+    if (statuses[j].ok()) {
+      bufferlist bl;
+      bl.append(values[j]);
+      out->insert(make_pair(*i, bl));
+    }
   }
   utime_t lat = ceph_clock_now(g_ceph_context) - start;
   logger->inc(l_rocksdb_gets);
@@ -317,7 +613,12 @@ int RocksDBStore::split_key(rocksdb::Slice in, string *prefix, string *key)
 void RocksDBStore::compact()
 {
   logger->inc(l_rocksdb_compact);
-  db->CompactRange(NULL, NULL);
+  if (cf_handles.empty()) {
+    db->CompactRange(NULL, NULL);
+  } else {
+    for (unsigned i = 0; i < cf_handles.size(); ++i)
+      db->CompactRange(cf_handles[i], NULL, NULL);
+  }
 }
 
 
@@ -326,6 +627,17 @@ void RocksDBStore::compact_thread_entry()
   compact_queue_lock.Lock();
   while (!compact_queue_stop) {
     while (!compact_queue.empty()) {
+      if (compaction_governor && !compaction_governor->can_compact()) {
+	// hold queued work while the governor reports the store busy;
+	// ranges keep merging in the queue while we wait
+	utime_t interval;
+	interval.set_from_double(compaction_governor->recheck_interval());
+	compact_queue_cond.WaitInterval(g_ceph_context, compact_queue_lock,
+					interval);
+	if (compact_queue_stop)
+	  break;
+	continue;
+      }
       pair<string,string> range = compact_queue.front();
       compact_queue.pop_front();
       logger->set(l_rocksdb_compact_queue_len, compact_queue.size());
@@ -392,7 +704,11 @@ void RocksDBStore::compact_range(const string& start, const string& end)
 {
     rocksdb::Slice cstart(start);
     rocksdb::Slice cend(end);
-    db->CompactRange(&cstart, &cend);
+    rocksdb::ColumnFamilyHandle *cf = get_cf_handle(start);
+    if (cf)
+      db->CompactRange(cf, &cstart, &cend);
+    else
+      db->CompactRange(&cstart, &cend);
 }
 RocksDBStore::RocksDBWholeSpaceIteratorImpl::~RocksDBWholeSpaceIteratorImpl()
 {
@@ -476,6 +792,11 @@ bufferlist RocksDBStore::RocksDBWholeSpaceIteratorImpl::value()
 {
   return to_bufferlist(dbiter->value());
 }
+bufferptr RocksDBStore::RocksDBWholeSpaceIteratorImpl::value_as_ptr()
+{
+  rocksdb::Slice val = dbiter->value();
+  return bufferptr(buffer::create_static(val.size(), (char*)val.data()));
+}
 int RocksDBStore::RocksDBWholeSpaceIteratorImpl::status()
 {
   return dbiter->status().ok() ? 0 : -1;
@@ -491,10 +812,17 @@ string RocksDBStore::past_prefix(const string &prefix)
 
 RocksDBStore::WholeSpaceIterator RocksDBStore::_get_iterator()
 {
+  if (cf_handles.empty()) {
+    return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBWholeSpaceIteratorImpl(
+	db->NewIterator(rocksdb::ReadOptions())
+      )
+    );
+  }
+  std::vector<rocksdb::Iterator*> iters;
+  db->NewIterators(rocksdb::ReadOptions(), cf_handles, &iters);
   return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
-    new RocksDBWholeSpaceIteratorImpl(
-      db->NewIterator(rocksdb::ReadOptions())
-    )
+    new RocksDBMergedIteratorImpl(iters)
   );
 }
 
@@ -506,9 +834,16 @@ RocksDBStore::WholeSpaceIterator RocksDBStore::_get_snapshot_iterator()
   snapshot = db->GetSnapshot();
   options.snapshot = snapshot;
 
+  if (cf_handles.empty()) {
+    return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
+      new RocksDBSnapshotIteratorImpl(db, snapshot,
+	db->NewIterator(options))
+    );
+  }
+  std::vector<rocksdb::Iterator*> iters;
+  db->NewIterators(options, cf_handles, &iters);
   return std::shared_ptr<KeyValueDB::WholeSpaceIteratorImpl>(
-    new RocksDBSnapshotIteratorImpl(db, snapshot,
-      db->NewIterator(options))
+    new RocksDBMergedSnapshotIteratorImpl(db, snapshot, iters)
   );
 }
 
@@ -516,3 +851,188 @@ RocksDBStore::RocksDBSnapshotIteratorImpl::~RocksDBSnapshotIteratorImpl()
 {
   db->ReleaseSnapshot(snapshot);
 }
+
+RocksDBStore::RocksDBMergedIteratorImpl::~RocksDBMergedIteratorImpl()
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    delete iters[i];
+}
+
+void RocksDBStore::RocksDBMergedIteratorImpl::_pick_smallest()
+{
+  cur = -1;
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    if (!iters[i]->Valid())
+      continue;
+    if (cur < 0 || iters[i]->key().compare(iters[cur]->key()) < 0)
+      cur = i;
+  }
+}
+
+void RocksDBStore::RocksDBMergedIteratorImpl::_pick_largest()
+{
+  cur = -1;
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    if (!iters[i]->Valid())
+      continue;
+    if (cur < 0 || iters[i]->key().compare(iters[cur]->key()) > 0)
+      cur = i;
+  }
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::seek_to_first()
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->SeekToFirst();
+  forward = true;
+  _pick_smallest();
+  return status();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::seek_to_first(const string &prefix)
+{
+  rocksdb::Slice slice_prefix(prefix);
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->Seek(slice_prefix);
+  forward = true;
+  _pick_smallest();
+  return status();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::seek_to_last()
+{
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->SeekToLast();
+  forward = false;
+  _pick_largest();
+  return status();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::seek_to_last(const string &prefix)
+{
+  string limit = past_prefix(prefix);
+  rocksdb::Slice slice_limit(limit);
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    iters[i]->Seek(slice_limit);
+    if (!iters[i]->Valid())
+      iters[i]->SeekToLast();
+    else
+      iters[i]->Prev();
+  }
+  forward = false;
+  _pick_largest();
+  return status();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::upper_bound(const string &prefix,
+							 const string &after)
+{
+  lower_bound(prefix, after);
+  if (valid()) {
+    pair<string,string> key = raw_key();
+    if (key.first == prefix && key.second == after)
+      next();
+  }
+  return status();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::lower_bound(const string &prefix,
+							 const string &to)
+{
+  string bound = combine_strings(prefix, to);
+  rocksdb::Slice slice_bound(bound);
+  for (unsigned i = 0; i < iters.size(); ++i)
+    iters[i]->Seek(slice_bound);
+  forward = true;
+  _pick_smallest();
+  return status();
+}
+
+bool RocksDBStore::RocksDBMergedIteratorImpl::valid()
+{
+  return cur >= 0 && iters[cur]->Valid();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::next()
+{
+  if (!valid())
+    return status();
+  if (!forward) {
+    // the other iterators sit at or before the current key; reseat
+    // everything to the first key after it
+    string k = iters[cur]->key().ToString();
+    rocksdb::Slice sk(k);
+    for (unsigned i = 0; i < iters.size(); ++i) {
+      iters[i]->Seek(sk);
+      if (iters[i]->Valid() && iters[i]->key().compare(sk) == 0)
+	iters[i]->Next();
+    }
+    forward = true;
+  } else {
+    iters[cur]->Next();
+  }
+  _pick_smallest();
+  return status();
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::prev()
+{
+  if (!valid())
+    return status();
+  if (forward) {
+    // reseat everything to the last key before the current one
+    string k = iters[cur]->key().ToString();
+    rocksdb::Slice sk(k);
+    for (unsigned i = 0; i < iters.size(); ++i) {
+      iters[i]->Seek(sk);
+      if (iters[i]->Valid())
+	iters[i]->Prev();
+      else
+	iters[i]->SeekToLast();
+    }
+    forward = false;
+  } else {
+    iters[cur]->Prev();
+  }
+  _pick_largest();
+  return status();
+}
+
+string RocksDBStore::RocksDBMergedIteratorImpl::key()
+{
+  string out_key;
+  split_key(iters[cur]->key(), 0, &out_key);
+  return out_key;
+}
+
+pair<string,string> RocksDBStore::RocksDBMergedIteratorImpl::raw_key()
+{
+  string prefix, key;
+  split_key(iters[cur]->key(), &prefix, &key);
+  return make_pair(prefix, key);
+}
+
+bufferlist RocksDBStore::RocksDBMergedIteratorImpl::value()
+{
+  return to_bufferlist(iters[cur]->value());
+}
+
+bufferptr RocksDBStore::RocksDBMergedIteratorImpl::value_as_ptr()
+{
+  rocksdb::Slice val = iters[cur]->value();
+  return bufferptr(buffer::create_static(val.size(), (char*)val.data()));
+}
+
+int RocksDBStore::RocksDBMergedIteratorImpl::status()
+{
+  for (unsigned i = 0; i < iters.size(); ++i) {
+    if (!iters[i]->status().ok())
+      return -1;
+  }
+  return 0;
+}
+
+RocksDBStore::RocksDBMergedSnapshotIteratorImpl::~RocksDBMergedSnapshotIteratorImpl()
+{
+  db->ReleaseSnapshot(snapshot);
+}
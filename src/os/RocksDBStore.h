@@ -32,12 +32,14 @@ enum {
   l_rocksdb_compact_range,
   l_rocksdb_compact_queue_merge,
   l_rocksdb_compact_queue_len,
+  l_rocksdb_txn_splits,
   l_rocksdb_last,
 };
 
 namespace rocksdb{
   class DB;
   class Cache;
+  class ColumnFamilyHandle;
   class FilterPolicy;
   class Snapshot;
   class Slice;
@@ -56,6 +58,27 @@ class RocksDBStore : public KeyValueDB {
   string options_str;
   int do_open(ostream &out, bool create_if_missing);
 
+  /// a prefix class routed to its own column family
+  struct ColumnFamily {
+    string prefix;   ///< prefix class; doubles as the cf name
+    string options;  ///< tuning options, parsed at open
+    rocksdb::ColumnFamilyHandle *handle;
+    ColumnFamily(const string &p, const string &o)
+      : prefix(p), options(o), handle(NULL) {}
+  };
+  vector<ColumnFamily> column_families;        ///< routed prefix classes
+  vector<rocksdb::ColumnFamilyHandle*> cf_handles;  ///< all open handles
+
+  /// column family owning the given prefix (or combined key), if any
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const string &prefix);
+
+  vector<pair<string, ceph::shared_ptr<KeyValueDB::MergeOperator> > > merge_ops;
+
+  /// merge operator registered for the given prefix, if any
+  KeyValueDB::MergeOperator *get_merge_operator(const string &prefix);
+
+  friend class MergeOperatorRouter;
+
   // manage async compactions
   Mutex compact_queue_lock;
   Cond compact_queue_cond;
@@ -71,6 +94,7 @@ class RocksDBStore : public KeyValueDB {
     }
     friend class RocksDBStore;
   } compact_thread;
+  KeyValueDB::CompactionGovernor *compaction_governor;
 
   void compact_thread_entry();
 
@@ -87,6 +111,9 @@ public:
   int ParseOptionsFromString(const string opt_str, rocksdb::Options &opt);
   static int _test_init(const string& dir);
   int init(string options_str);
+  int set_column_family(const string &prefix_class, const string &options);
+  int set_merge_operator(const string &prefix,
+			 ceph::shared_ptr<KeyValueDB::MergeOperator> mop);
   /// compact rocksdb for all keys with a given prefix
   void compact_prefix(const string& prefix) {
     compact_range(prefix, past_prefix(prefix));
@@ -101,6 +128,11 @@ public:
   void compact_range_async(const string& prefix, const string& start, const string& end) {
     compact_range_async(combine_strings(prefix, start), combine_strings(prefix, end));
   }
+  void set_compaction_governor(KeyValueDB::CompactionGovernor *g) {
+    Mutex::Locker l(compact_queue_lock);
+    compaction_governor = g;
+    compact_queue_cond.Signal();
+  }
   int get_info_log_level(string info_log_level);
 
   RocksDBStore(CephContext *c, const string &path) :
@@ -111,6 +143,7 @@ public:
     compact_queue_lock("RocksDBStore::compact_thread_lock"),
     compact_queue_stop(false),
     compact_thread(this),
+    compaction_governor(NULL),
     compact_on_mount(false),
     disableWAL(false)
   {}
@@ -132,10 +165,17 @@ public:
   class RocksDBTransactionImpl : public KeyValueDB::TransactionImpl {
   public:
     rocksdb::WriteBatch *bat;
+    /// sub-batches split off ahead of bat, oldest first; only a
+    /// splittable transaction ever has any (see set_splittable())
+    vector<rocksdb::WriteBatch*> split_bats;
     RocksDBStore *db;
+    uint64_t cur_bat_size;  ///< approx bytes staged in bat
 
     RocksDBTransactionImpl(RocksDBStore *_db);
     ~RocksDBTransactionImpl();
+    /// track staged bytes; cut a sub-batch when a splittable
+    /// transaction crosses rocksdb_transaction_split_size
+    void account(uint64_t bytes);
     void set(
       const string &prefix,
       const string &k,
@@ -146,6 +186,10 @@ public:
     void rmkeys_by_prefix(
       const string &prefix
       );
+    void merge(
+      const string &prefix,
+      const string &k,
+      const bufferlist &bl);
   };
 
   KeyValueDB::Transaction get_transaction() {
@@ -183,6 +227,7 @@ public:
     string key();
     pair<string,string> raw_key();
     bufferlist value();
+    bufferptr value_as_ptr();
     int status();
   };
 
@@ -197,6 +242,49 @@ public:
     ~RocksDBSnapshotIteratorImpl();
   };
 
+  /// merges per-column-family iterators back into one sorted key space.
+  /// keys keep their full prefix\0key form in every cf, so an n-way
+  /// merge on the raw key restores the single-keyspace ordering.
+  class RocksDBMergedIteratorImpl : public KeyValueDB::WholeSpaceIteratorImpl {
+  protected:
+    vector<rocksdb::Iterator*> iters;
+    int cur;       ///< iterator we are positioned on, or -1
+    bool forward;  ///< direction of the last positioning operation
+    void _pick_smallest();
+    void _pick_largest();
+  public:
+    RocksDBMergedIteratorImpl(const vector<rocksdb::Iterator*> &its) :
+      iters(its), cur(-1), forward(true) { }
+    ~RocksDBMergedIteratorImpl();
+
+    int seek_to_first();
+    int seek_to_first(const string &prefix);
+    int seek_to_last();
+    int seek_to_last(const string &prefix);
+    int upper_bound(const string &prefix, const string &after);
+    int lower_bound(const string &prefix, const string &to);
+    bool valid();
+    int next();
+    int prev();
+    string key();
+    pair<string,string> raw_key();
+    bufferlist value();
+    bufferptr value_as_ptr();
+    int status();
+  };
+
+  class RocksDBMergedSnapshotIteratorImpl : public RocksDBMergedIteratorImpl {
+    rocksdb::DB *db;
+    const rocksdb::Snapshot *snapshot;
+  public:
+    RocksDBMergedSnapshotIteratorImpl(rocksdb::DB *db,
+				      const rocksdb::Snapshot *s,
+				      const vector<rocksdb::Iterator*> &its) :
+      RocksDBMergedIteratorImpl(its), db(db), snapshot(s) { }
+
+    ~RocksDBMergedSnapshotIteratorImpl();
+  };
+
   /// Utility
   static string combine_strings(const string &prefix, const string &value);
   static int split_key(rocksdb::Slice in, string *prefix, string *key);
@@ -7,6 +7,7 @@
 #include "common/perf_counters.h"
 
 WBThrottle::WBThrottle(CephContext *cct) :
+  limit_scale(1.0),
   cur_ios(0), cur_size(0),
   cct(cct),
   logger(NULL),
@@ -49,7 +50,11 @@ void WBThrottle::start()
     Mutex::Locker l(lock);
     stopping = false;
   }
-  create();
+  int nthreads = MAX(cct->_conf->filestore_wbthrottle_flusher_threads, 1);
+  for (int i = 0; i < nthreads; ++i) {
+    flushers.push_back(new FlusherThread(this));
+    flushers.back()->create();
+  }
 }
 
 void WBThrottle::stop()
@@ -60,7 +65,11 @@ void WBThrottle::stop()
     cond.Signal();
   }
 
-  join();
+  while (!flushers.empty()) {
+    flushers.back()->join();
+    delete flushers.back();
+    flushers.pop_back();
+  }
 }
 
 const char** WBThrottle::get_tracked_conf_keys() const
@@ -150,12 +159,12 @@ bool WBThrottle::get_next_should_flush(
 }
 
 
-void *WBThrottle::entry()
+void *WBThrottle::flusher_entry()
 {
   Mutex::Locker l(lock);
   boost::tuple<ghobject_t, FDRef, PendingWB> wb;
   while (get_next_should_flush(&wb)) {
-    clearing = wb.get<0>();
+    clearing.insert(wb.get<0>());
     cur_ios -= wb.get<2>().ios;
     logger->dec(l_wbthrottle_ios_dirtied, wb.get<2>().ios);
     logger->inc(l_wbthrottle_ios_wb, wb.get<2>().ios);
@@ -177,13 +186,31 @@ void *WBThrottle::entry()
     }
 #endif
     lock.Lock();
-    clearing = ghobject_t();
+    clearing.erase(wb.get<0>());
     cond.Signal();
     wb = boost::tuple<ghobject_t, FDRef, PendingWB>();
   }
   return 0;
 }
 
+void WBThrottle::notify_sync_latency(utime_t lat)
+{
+  Mutex::Locker l(lock);
+  double target = cct->_conf->filestore_wbthrottle_target_commit_latency;
+  if (target <= 0) {
+    limit_scale = 1.0;
+    return;
+  }
+  // AIMD: halve the dirty allowance when a commit overshoots the target,
+  // creep back up while commits stay under it
+  if ((double)lat > target) {
+    limit_scale = MAX(limit_scale / 2, 1.0 / 64);
+    cond.Signal();  // limits dropped, flushers may now have work
+  } else {
+    limit_scale = MIN(limit_scale + 1.0 / 32, 1.0);
+  }
+}
+
 void WBThrottle::queue_wb(
   FDRef fd, const ghobject_t &hoid, uint64_t offset, uint64_t len,
   bool nocache)
@@ -241,7 +268,7 @@ void WBThrottle::clear()
 void WBThrottle::clear_object(const ghobject_t &hoid)
 {
   Mutex::Locker l(lock);
-  while (clearing == hoid)
+  while (clearing.count(hoid))
     cond.Wait(lock);
   ceph::unordered_map<ghobject_t, pair<PendingWB, FDRef> >::iterator i =
     pending_wbs.find(hoid);
@@ -43,8 +43,9 @@ enum {
  *
  * Tracks, throttles, and flushes outstanding IO
  */
-class WBThrottle : Thread, public md_config_obs_t {
-  ghobject_t clearing;
+class WBThrottle : public md_config_obs_t {
+  /// objects currently being flushed by a flusher thread
+  set<ghobject_t, ghobject_t::BitwiseComparator> clearing;
   /* *_limits.first is the start_flusher limit and
    * *_limits.second is the hard limit
    */
@@ -58,6 +59,10 @@ class WBThrottle : Thread, public md_config_obs_t {
   /// Limits on unflushed objects
   pair<uint64_t, uint64_t> fd_limits;
 
+  /// scale applied to the start_flusher limits, adapted from observed
+  /// commit latency when filestore_wbthrottle_target_commit_latency is set
+  double limit_scale;
+
   uint64_t cur_ios;  /// Currently unflushed IOs
   uint64_t cur_size; /// Currently unflushed bytes
 
@@ -115,6 +120,15 @@ class WBThrottle : Thread, public md_config_obs_t {
 
   ceph::unordered_map<ghobject_t, pair<PendingWB, FDRef> > pending_wbs;
 
+  struct FlusherThread : public Thread {
+    WBThrottle *wbt;
+    explicit FlusherThread(WBThrottle *w) : wbt(w) {}
+    void *entry() {
+      return wbt->flusher_entry();
+    }
+  };
+  vector<FlusherThread*> flushers;
+
   /// get next flush to perform
   bool get_next_should_flush(
     boost::tuple<ghobject_t, FDRef, PendingWB> *next ///< [out] next to flush
@@ -129,10 +143,13 @@ private:
   FS fs;
 
   void set_from_conf();
+  uint64_t scaled(uint64_t limit) const {
+    return MAX((uint64_t)(limit * limit_scale), (uint64_t)1);
+  }
   bool beyond_limit() const {
-    if (cur_ios < io_limits.first &&
-	pending_wbs.size() < fd_limits.first &&
-	cur_size < size_limits.first)
+    if (cur_ios < scaled(io_limits.first) &&
+	pending_wbs.size() < scaled(fd_limits.first) &&
+	cur_size < scaled(size_limits.first))
       return false;
     else
       return true;
@@ -169,13 +186,16 @@ public:
   /// Block until there is throttle available
   void throttle();
 
+  /// Feed back an observed commit latency to adapt the dirty allowance
+  void notify_sync_latency(utime_t lat);
+
   /// md_config_obs_t
   const char** get_tracked_conf_keys() const;
   void handle_conf_change(const md_config_t *conf,
 			  const std::set<std::string> &changed);
 
-  /// Thread
-  void *entry();
+  /// flusher thread body
+  void *flusher_entry();
 };
 
 #endif
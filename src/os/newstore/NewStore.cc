@@ -344,7 +344,8 @@ NewStore::Onode::Onode(const ghobject_t& o, const string& k)
     key(k),
     dirty(false),
     exists(true),
-    flush_lock("NewStore::Onode::flush_lock") {
+    flush_lock("NewStore::Onode::flush_lock"),
+    cached_bytes(0) {
 }
 
 // OnodeHashLRU
@@ -352,11 +353,31 @@ NewStore::Onode::Onode(const ghobject_t& o, const string& k)
 #undef dout_prefix
 #define dout_prefix *_dout << "newstore.lru(" << this << ") "
 
+void NewStore::OnodeHashLRU::_account(Onode *o)
+{
+  // resample the footprint; the onode may have grown or shrunk since
+  // we last charged it
+  size_t nb = o->get_mem_usage();
+  if (nb > o->cached_bytes)
+    stats->bytes.add(nb - o->cached_bytes);
+  else
+    stats->bytes.sub(o->cached_bytes - nb);
+  o->cached_bytes = nb;
+}
+
+void NewStore::OnodeHashLRU::_unaccount(Onode *o)
+{
+  stats->count.dec();
+  stats->bytes.sub(o->cached_bytes);
+  o->cached_bytes = 0;
+}
+
 void NewStore::OnodeHashLRU::_touch(OnodeRef o)
 {
   lru_list_t::iterator p = lru.iterator_to(*o);
   lru.erase(p);
   lru.push_front(*o);
+  _account(o.get());
 }
 
 void NewStore::OnodeHashLRU::add(const ghobject_t& oid, OnodeRef o)
@@ -366,6 +387,8 @@ void NewStore::OnodeHashLRU::add(const ghobject_t& oid, OnodeRef o)
   assert(onode_map.count(oid) == 0);
   onode_map[oid] = o;
   lru.push_back(*o);
+  stats->count.inc();
+  _account(o.get());
 }
 
 NewStore::OnodeRef NewStore::OnodeHashLRU::lookup(const ghobject_t& oid)
@@ -386,6 +409,10 @@ void NewStore::OnodeHashLRU::clear()
 {
   Mutex::Locker l(lock);
   dout(10) << __func__ << dendl;
+  for (ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.begin();
+       p != onode_map.end();
+       ++p)
+    _unaccount(p->second.get());
   lru.clear();
   onode_map.clear();
 }
@@ -399,6 +426,7 @@ void NewStore::OnodeHashLRU::remove(const ghobject_t& oid)
     return;
   }
   dout(30) << __func__ << " " << oid << " hit " << p->second << dendl;
+  _unaccount(p->second.get());
   lru_list_t::iterator pi = lru.iterator_to(*p->second);
   lru.erase(pi);
   onode_map.erase(p);
@@ -415,6 +443,7 @@ void NewStore::OnodeHashLRU::rename(const ghobject_t& old_oid,
 
   assert(po != onode_map.end());
   if (pn != onode_map.end()) {
+    _unaccount(pn->second.get());
     lru_list_t::iterator p = lru.iterator_to(*pn->second);
     lru.erase(p);
     onode_map.erase(pn);
@@ -480,6 +509,7 @@ int NewStore::OnodeHashLRU::trim(int max)
       assert(num == 1);
     }
     o->get();  // paranoia
+    _unaccount(o);
     onode_map.erase(o->oid);
     o->put();
     --num;
@@ -499,7 +529,7 @@ NewStore::Collection::Collection(NewStore *ns, coll_t c)
   : store(ns),
     cid(c),
     lock("NewStore::Collection::lock"),
-    onode_map()
+    onode_map(&ns->onode_cache_stats)
 {
 }
 
@@ -607,6 +637,9 @@ NewStore::NewStore(CephContext *cct, const string& path)
     kv_sync_thread(this),
     kv_lock("NewStore::kv_lock"),
     kv_stop(false),
+    onode_trim_thread(this),
+    onode_trim_lock("NewStore::onode_trim_lock"),
+    onode_trim_stop(false),
     logger(NULL),
     default_osr("default"),
     reap_lock("NewStore::reap_lock")
@@ -1005,6 +1038,7 @@ int NewStore::mount()
   fsync_tp.start();
   wal_tp.start();
   kv_sync_thread.create();
+  onode_trim_thread.create();
 
   mounted = true;
   return 0;
@@ -1036,6 +1070,8 @@ int NewStore::umount()
   _aio_stop();
   dout(20) << __func__ << " stopping kv thread" << dendl;
   _kv_stop();
+  dout(20) << __func__ << " stopping onode trim thread" << dendl;
+  _onode_trim_stop();
   dout(20) << __func__ << " draining wal_wq" << dendl;
   wal_wq.drain();
   dout(20) << __func__ << " stopping wal_tp" << dendl;
@@ -2547,6 +2583,47 @@ void NewStore::_kv_sync_thread()
   dout(10) << __func__ << " finish" << dendl;
 }
 
+void NewStore::_onode_trim_thread()
+{
+  dout(10) << __func__ << " start" << dendl;
+  onode_trim_lock.Lock();
+  while (!onode_trim_stop) {
+    uint64_t target = g_conf->newstore_onode_cache_bytes;
+    while (target && onode_cache_stats.bytes.read() > target) {
+      onode_trim_lock.Unlock();
+      list<CollectionRef> ls;
+      {
+	RWLock::RLocker l(coll_lock);
+	for (ceph::unordered_map<coll_t,CollectionRef>::iterator p =
+	       coll_map.begin();
+	     p != coll_map.end();
+	     ++p)
+	  ls.push_back(p->second);
+      }
+      // shave the coldest quarter of each collection per pass until we
+      // are back under target or everything left is pinned
+      int trimmed = 0;
+      for (list<CollectionRef>::iterator p = ls.begin();
+	   p != ls.end() && onode_cache_stats.bytes.read() > target;
+	   ++p)
+	trimmed += (*p)->onode_map.trim((*p)->onode_map.get_size() * 3 / 4);
+      dout(20) << __func__ << " trimmed " << trimmed << " onodes, "
+	       << onode_cache_stats.bytes.read() << " bytes cached, target "
+	       << target << dendl;
+      onode_trim_lock.Lock();
+      if (!trimmed || onode_trim_stop)
+	break;
+    }
+    if (onode_trim_stop)
+      break;
+    utime_t interval;
+    interval.set_from_double(g_conf->newstore_onode_cache_trim_interval);
+    onode_trim_cond.WaitInterval(g_ceph_context, onode_trim_lock, interval);
+  }
+  onode_trim_lock.Unlock();
+  dout(10) << __func__ << " finish" << dendl;
+}
+
 wal_op_t *NewStore::_get_wal_op(TransContext *txc)
 {
   if (!txc->wal_txn) {
@@ -2585,8 +2662,9 @@ int NewStore::_wal_finish(TransContext *txc)
 int NewStore::_do_wal_transaction(wal_transaction_t& wt,
 				  TransContext *txc)
 {
-  vector<int> sync_fds;
-  sync_fds.reserve(wt.ops.size());
+  // one open fd per fragment touched, so a run of small overwrites to
+  // the same fragment costs a single open and a single fdatasync
+  map<pair<uint32_t,uint32_t>, int> sync_fds;
 
   // read all the overlay data first for apply
   _do_read_all_overlays(wt);
@@ -2610,9 +2688,18 @@ int NewStore::_do_wal_transaction(wal_transaction_t& wt,
 	    p->data.rebuild();
 	  }
 	}
-	int fd = _open_fid(p->fid, flags);
-	if (fd < 0)
-	  return fd;
+	pair<uint32_t,uint32_t> f(p->fid.fset, p->fid.fno);
+	int fd;
+	bool reused = false;
+	map<pair<uint32_t,uint32_t>, int>::iterator sp = sync_fds.find(f);
+	if (!(flags & O_DIRECT) && sp != sync_fds.end()) {
+	  fd = sp->second;
+	  reused = true;
+	} else {
+	  fd = _open_fid(p->fid, flags);
+	  if (fd < 0)
+	    return fd;
+	}
 #ifdef HAVE_LIBAIO
 	if (g_conf->newstore_aio && txc && (flags & O_DIRECT)) {
 	  txc->pending_aios.push_back(FS::aio_t(txc, fd));
@@ -2636,10 +2723,12 @@ int NewStore::_do_wal_transaction(wal_transaction_t& wt,
 		 << cpp_strerror(r) << dendl;
 	    return r;
 	  }
-	  if (!(flags & O_DIRECT))
-	    sync_fds.push_back(fd);
-	  else
+	  if (!(flags & O_DIRECT)) {
+	    if (!reused)
+	      sync_fds[f] = fd;
+	  } else {
 	    VOID_TEMP_FAILURE_RETRY(::close(fd));
+	  }
 	}
       }
       break;
@@ -2647,9 +2736,17 @@ int NewStore::_do_wal_transaction(wal_transaction_t& wt,
       {
 	dout(20) << __func__ << " zero " << p->fid << " "
 		 << p->offset << "~" << p->length << dendl;
-	int fd = _open_fid(p->fid, O_RDWR);
-	if (fd < 0)
-	  return fd;
+	pair<uint32_t,uint32_t> f(p->fid.fset, p->fid.fno);
+	int fd;
+	map<pair<uint32_t,uint32_t>, int>::iterator sp = sync_fds.find(f);
+	if (sp != sync_fds.end()) {
+	  fd = sp->second;
+	} else {
+	  fd = _open_fid(p->fid, O_RDWR);
+	  if (fd < 0)
+	    return fd;
+	  sync_fds[f] = fd;
+	}
 	int r = fs->zero(fd, p->offset, p->length);
 	if (r < 0) {
 	  derr << __func__ << " zero on " << fd << " got: "
@@ -2657,7 +2754,6 @@ int NewStore::_do_wal_transaction(wal_transaction_t& wt,
 	  return r;
 	}
 	// FIXME: do aio fdatasync?
-	sync_fds.push_back(fd);
       }
       break;
     case wal_op_t::OP_TRUNCATE:
@@ -2694,12 +2790,12 @@ int NewStore::_do_wal_transaction(wal_transaction_t& wt,
     }
   }
 
-  for (vector<int>::iterator p = sync_fds.begin();
+  for (map<pair<uint32_t,uint32_t>, int>::iterator p = sync_fds.begin();
        p != sync_fds.end();
        ++p) {
-    int r = ::fdatasync(*p);
+    int r = ::fdatasync(p->second);
     assert(r == 0);
-    VOID_TEMP_FAILURE_RETRY(::close(*p));
+    VOID_TEMP_FAILURE_RETRY(::close(p->second));
   }
 
   return 0;
@@ -3518,7 +3614,7 @@ int NewStore::_do_write(TransContext *txc,
 
     f.length = length;
     o->onode.size = length;
-    fd = _create_fid(txc, &f.fid, O_RDWR);
+    fd = _create_fid(txc, &f.fid, flags);
     if (fd < 0) {
       r = fd;
       goto out;
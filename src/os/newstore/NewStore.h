@@ -56,8 +56,23 @@ public:
     Cond flush_cond;   ///< wait here for unapplied txns, fsyncs
     set<TransContext*> flush_txns;   ///< fsyncing or committing or wal txns
 
+    size_t cached_bytes;  ///< last footprint charged to the cache
+
     Onode(const ghobject_t& o, const string& k);
 
+    /// approximate in-memory footprint, for cache accounting
+    size_t get_mem_usage() {
+      size_t s = sizeof(Onode) + key.length();
+      for (map<string,bufferptr>::iterator p = onode.attrs.begin();
+	   p != onode.attrs.end();
+	   ++p)
+	s += p->first.length() + p->second.length();
+      s += onode.data_map.size() * sizeof(fragment_t);
+      s += onode.overlay_map.size() * sizeof(overlay_t);
+      s += onode.shared_overlays.size() * sizeof(uint64_t);
+      return s;
+    }
+
     void flush() {
       Mutex::Locker l(flush_lock);
       while (!flush_txns.empty())
@@ -73,6 +88,12 @@ public:
   };
   typedef boost::intrusive_ptr<Onode> OnodeRef;
 
+  /// memory accounting shared by every collection's onode cache
+  struct OnodeCacheStats {
+    atomic64_t count;  ///< cached onodes
+    atomic64_t bytes;  ///< approximate bytes held by cached onodes
+  };
+
   struct OnodeHashLRU {
     typedef boost::intrusive::list<
       Onode,
@@ -82,19 +103,27 @@ public:
 	&Onode::lru_item> > lru_list_t;
 
     Mutex lock;
+    OnodeCacheStats *stats;                              ///< global accounting
     ceph::unordered_map<ghobject_t,OnodeRef> onode_map;  ///< forward lookups
     lru_list_t lru;                                      ///< lru
 
-    OnodeHashLRU() : lock("NewStore::OnodeHashLRU::lock") {}
+    explicit OnodeHashLRU(OnodeCacheStats *s)
+      : lock("NewStore::OnodeHashLRU::lock"), stats(s) {}
 
     void add(const ghobject_t& oid, OnodeRef o);
     void _touch(OnodeRef o);
+    void _account(Onode *o);
+    void _unaccount(Onode *o);
     OnodeRef lookup(const ghobject_t& o);
     void remove(const ghobject_t& o);
     void rename(const ghobject_t& old_oid, const ghobject_t& new_oid);
     void clear();
     bool get_next(const ghobject_t& after, pair<ghobject_t,OnodeRef> *next);
     int trim(int max=-1);
+    uint64_t get_size() {
+      Mutex::Locker l(lock);
+      return onode_map.size();
+    }
   };
 
   struct Collection {
@@ -198,6 +227,7 @@ public:
 
     boost::intrusive::list_member_hook<> wal_queue_item;
     wal_transaction_t *wal_txn; ///< wal transaction (if any)
+    set<pair<uint32_t,uint32_t> > wal_fids; ///< fragments wal_txn touches
     unsigned num_fsyncs_completed;
 
     list<FS::aio_t> pending_aios;    ///< not yet submitted
@@ -276,13 +306,13 @@ public:
 
     Sequencer *parent;
 
-    Mutex wal_apply_lock;
+    /// fragments with a wal apply in flight; guarded by the wal_tp lock
+    set<pair<uint32_t,uint32_t> > wal_applying_fids;
 
     OpSequencer()
 	//set the qlock to to PTHREAD_MUTEX_RECURSIVE mode
       : qlock("NewStore::OpSequencer::qlock", true, false),
-	parent(NULL),
-	wal_apply_lock("NewStore::OpSequencer::wal_apply_lock") {
+	parent(NULL) {
     }
     ~OpSequencer() {
       assert(q.empty());
@@ -365,12 +395,14 @@ public:
   };
 
   class WALWQ : public ThreadPool::WorkQueue<TransContext> {
-    // We need to order WAL items within each Sequencer.  To do that,
-    // queue each txc under osr, and queue the osr's here.  When we
-    // dequeue an txc, requeue the osr if there are more pending, and
+    // We need to order WAL items that touch the same fragments.  To do
+    // that, queue each txc under osr, and queue the osr's here.  When
+    // we dequeue an txc, requeue the osr if there are more pending, and
     // do it at the end of the list so that the next thread does not
-    // get a conflicted txc.  Hold an osr mutex while doing the wal to
-    // preserve the ordering.
+    // get a conflicted txc.  A txc is only handed out while no earlier
+    // txc from the same osr with an overlapping fid set is still
+    // applying, so non-conflicting txcs apply concurrently while
+    // overwrites of the same fragment stay ordered.
   public:
     typedef boost::intrusive::list<
       OpSequencer,
@@ -392,6 +424,11 @@ public:
       return wal_queue.empty();
     }
     bool _enqueue(TransContext *i) {
+      assert(i->wal_fids.empty());
+      for (list<wal_op_t>::iterator p = i->wal_txn->ops.begin();
+	   p != i->wal_txn->ops.end();
+	   ++p)
+	i->wal_fids.insert(make_pair(p->fid.fset, p->fid.fno));
       if (i->osr->wal_q.empty()) {
 	wal_queue.push_back(*i->osr);
       }
@@ -401,26 +438,47 @@ public:
     void _dequeue(TransContext *p) {
       assert(0 == "not needed, not implemented");
     }
+    bool _conflicts(TransContext *i) {
+      for (set<pair<uint32_t,uint32_t> >::iterator p = i->wal_fids.begin();
+	   p != i->wal_fids.end();
+	   ++p) {
+	if (i->osr->wal_applying_fids.count(*p))
+	  return true;
+      }
+      return false;
+    }
     TransContext *_dequeue() {
-      if (wal_queue.empty())
-	return NULL;
-      OpSequencer *osr = &wal_queue.front();
-      TransContext *i = &osr->wal_q.front();
-      osr->wal_q.pop_front();
-      wal_queue.pop_front();
-      if (!osr->wal_q.empty()) {
-	// requeue at the end to minimize contention
-	wal_queue.push_back(*i->osr);
+      for (wal_osr_queue_t::iterator q = wal_queue.begin();
+	   q != wal_queue.end();
+	   ++q) {
+	TransContext *i = &q->wal_q.front();
+	if (_conflicts(i))
+	  continue;
+	OpSequencer *osr = &*q;
+	osr->wal_q.pop_front();
+	wal_queue.erase(q);
+	if (!osr->wal_q.empty()) {
+	  // requeue at the end to minimize contention
+	  wal_queue.push_back(*osr);
+	}
+	osr->wal_applying_fids.insert(i->wal_fids.begin(), i->wal_fids.end());
+	return i;
       }
-
-      // preserve wal ordering for this sequencer by taking the lock
-      // while still holding the queue lock
-      i->osr->wal_apply_lock.Lock();
-      return i;
+      // everything still queued conflicts with an in-flight apply
+      return NULL;
     }
     void _process(TransContext *i, ThreadPool::TPHandle &handle) {
       store->_wal_apply(i);
-      i->osr->wal_apply_lock.Unlock();
+    }
+    void _process_finish(TransContext *i) {
+      // called with the pool lock held; release our fid claims and let
+      // any txc that was blocked on them get picked up
+      for (set<pair<uint32_t,uint32_t> >::iterator p = i->wal_fids.begin();
+	   p != i->wal_fids.end();
+	   ++p)
+	i->osr->wal_applying_fids.erase(*p);
+      i->wal_fids.clear();
+      _wake();
     }
     void _clear() {
       assert(wal_queue.empty());
@@ -445,6 +503,15 @@ public:
     }
   };
 
+  struct OnodeTrimThread : public Thread {
+    NewStore *store;
+    OnodeTrimThread(NewStore *s) : store(s) {}
+    void *entry() {
+      store->_onode_trim_thread();
+      return NULL;
+    }
+  };
+
   struct AioCompletionThread : public Thread {
     NewStore *store;
     AioCompletionThread(NewStore *s) : store(s) {}
@@ -502,6 +569,12 @@ private:
   deque<TransContext*> kv_queue, kv_committing;
   deque<TransContext*> wal_cleanup_queue, wal_cleaning;
 
+  OnodeCacheStats onode_cache_stats;
+  OnodeTrimThread onode_trim_thread;
+  Mutex onode_trim_lock;
+  Cond onode_trim_cond;
+  bool onode_trim_stop;
+
   Logger *logger;
 
   Sequencer default_osr;
@@ -565,6 +638,17 @@ private:
   int _aio_start();
   void _aio_stop();
 
+  void _onode_trim_thread();
+  void _onode_trim_stop() {
+    {
+      Mutex::Locker l(onode_trim_lock);
+      onode_trim_stop = true;
+      onode_trim_cond.Signal();
+    }
+    onode_trim_thread.join();
+    onode_trim_stop = false;
+  }
+
   void _kv_sync_thread();
   void _kv_stop() {
     {
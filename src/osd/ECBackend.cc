@@ -1061,6 +1061,16 @@ void ECBackend::handle_sub_read_reply(
   assert(siter->second.count(op.tid));
   siter->second.erase(op.tid);
 
+  // note how long this shard took, for steering degraded reads
+  {
+    double sample = (double)(ceph_clock_now(cct) - rop.sent);
+    map<pg_shard_t, double>::iterator l = peer_read_latency.find(from);
+    if (l == peer_read_latency.end())
+      peer_read_latency[from] = sample;
+    else
+      l->second = l->second * .75 + sample * .25;
+  }
+
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
   unsigned is_complete = 0;
@@ -1475,9 +1485,61 @@ int ECBackend::get_min_avail_to_read_shards(
   if (r < 0)
     return r;
 
+  if (!do_redundant_reads && need != want && have.size() > need.size()) {
+    // we will have to decode no matter which shards we read, so any k
+    // of them will do; prefer the peers that have been answering our
+    // sub-reads quickly, as long as the plugin agrees it can decode
+    // from that subset
+    vector<pair<double, int> > by_latency;
+    for (set<int>::iterator i = have.begin(); i != have.end(); ++i) {
+      map<pg_shard_t, double>::iterator l =
+	peer_read_latency.find(shards[shard_id_t(*i)]);
+      by_latency.push_back(
+	make_pair(l == peer_read_latency.end() ? 0.0 : l->second, *i));
+    }
+    sort(by_latency.begin(), by_latency.end());
+    set<int> fastest;
+    for (vector<pair<double, int> >::iterator i = by_latency.begin();
+	 i != by_latency.end() && fastest.size() < need.size();
+	 ++i)
+      fastest.insert(i->second);
+    set<int> fast_need;
+    if (ec_impl->minimum_to_decode(want, fastest, &fast_need) == 0)
+      need.swap(fast_need);
+  }
+
+  if (for_recovery && need != want && have.size() > need.size()) {
+    // recovery can usually repair from more than one shard set.  price
+    // each candidate by its distance from us in the crush hierarchy so
+    // that repair reads stay host- or rack-local when they can, with
+    // the observed sub-read latency breaking ties, and let the plugin
+    // pick the cheapest set it can decode from.
+    OSDMapRef osdmap = get_osdmap();
+    multimap<string,string> loc;
+    map<string,string> here = osdmap->crush->get_full_location(
+      get_parent()->whoami());
+    loc.insert(here.begin(), here.end());
+    map<int, int> costs;
+    for (set<int>::iterator i = have.begin(); i != have.end(); ++i) {
+      pg_shard_t peer = shards[shard_id_t(*i)];
+      int d = osdmap->crush->get_common_ancestor_distance(
+	cct, peer.osd, loc);
+      int cost = (d < 0 ? 0xffff : d) << 10;
+      map<pg_shard_t, double>::iterator l = peer_read_latency.find(peer);
+      if (l != peer_read_latency.end())
+	cost += std::min((int)(l->second * 1000.0), 1023);
+      costs[*i] = cost;
+      dout(20) << __func__ << ": shard " << *i << " on " << peer
+	       << " cost " << cost << dendl;
+    }
+    set<int> cheap_need;
+    if (ec_impl->minimum_to_decode_with_cost(want, costs, &cheap_need) == 0)
+      need.swap(cheap_need);
+  }
+
   if (do_redundant_reads) {
       need.swap(have);
-  } 
+  }
 
   if (!to_read)
     return 0;
@@ -1545,6 +1607,7 @@ void ECBackend::start_read_op(
   op.op = _op;
   op.do_redundant_reads = do_redundant_reads;
   op.for_recovery = for_recovery;
+  op.sent = ceph_clock_now(cct);
   dout(10) << __func__ << ": starting " << op << dendl;
 
   map<pg_shard_t, ECSubRead> messages;
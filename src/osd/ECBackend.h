@@ -310,6 +310,8 @@ public:
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+
+    utime_t sent;
   };
   friend struct FinishReadOp;
   void filter_read_op(
@@ -319,6 +321,10 @@ public:
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   map<ceph_tid_t, ReadOp> tid_to_read_map;
   map<pg_shard_t, set<ceph_tid_t> > shard_to_read_map;
+
+  /// decaying average of sub-read round trip time per shard, used to
+  /// prefer responsive peers when any k shards will do (degraded reads)
+  map<pg_shard_t, double> peer_read_latency;
   void start_read_op(
     int priority,
     map<hobject_t, read_request_t, hobject_t::BitwiseComparator> &to_read,
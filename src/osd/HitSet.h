@@ -62,6 +62,8 @@ public:
     virtual bool is_full() const = 0;
     virtual void insert(const hobject_t& o) = 0;
     virtual bool contains(const hobject_t& o) const = 0;
+    /// hint that contains(o) is about to be called; may warm caches
+    virtual void prefetch(const hobject_t& o) const {}
     virtual unsigned insert_count() const = 0;
     virtual unsigned approx_unique_insert_count() const = 0;
     virtual void encode(bufferlist &bl) const = 0;
@@ -146,6 +148,11 @@ public:
   bool contains(const hobject_t& o) const {
     return impl->contains(o);
   }
+  /// hint that contains(o) is coming; lets batched queries to several
+  /// hit set generations overlap their cache misses
+  void prefetch(const hobject_t& o) const {
+    impl->prefetch(o);
+  }
 
   unsigned insert_count() const {
     return impl->insert_count();
@@ -436,6 +443,9 @@ public:
   bool contains(const hobject_t& o) const {
     return bloom.contains(o.get_hash());
   }
+  void prefetch(const hobject_t& o) const {
+    bloom.prefetch(o.get_hash());
+  }
   unsigned insert_count() const {
     return bloom.element_count();
   }
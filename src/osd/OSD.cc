@@ -58,6 +58,7 @@
 #include "messages/MGenericMessage.h"
 #include "messages/MPing.h"
 #include "messages/MOSDPing.h"
+#include "messages/MOSDNetPing.h"
 #include "messages/MOSDFailure.h"
 #include "messages/MOSDMarkMeDown.h"
 #include "messages/MOSDOp.h"
@@ -124,6 +125,7 @@
 #include "auth/AuthAuthorizeHandler.h"
 
 #include "common/errno.h"
+#include "common/strtol.h"
 
 #include "objclass/objclass.h"
 
@@ -136,6 +138,7 @@
 
 #ifdef WITH_LTTNG
 #include "tracing/osd.h"
+#include "tracing/pg.h"
 #else
 #define tracepoint(...)
 #endif
@@ -226,13 +229,23 @@ OSDService::OSDService(OSD *osd) :
   agent_stop_flag(false),
   agent_timer_lock("OSD::agent_timer_lock"),
   agent_timer(osd->client_messenger->cct, agent_timer_lock),
+  promote_throttle_lock("OSDService::promote_throttle_lock"),
+  promote_ops_avail(cct->_conf->osd_tier_promote_max_objects_sec),
+  promote_bytes_avail(cct->_conf->osd_tier_promote_max_bytes_sec),
   objecter(new Objecter(osd->client_messenger->cct, osd->objecter_messenger, osd->monc, NULL, 0, 0)),
   objecter_finisher(osd->client_messenger->cct),
+  obc_prefetch_finisher(cct),
   watch_lock("OSD::watch_lock"),
   watch_timer(osd->client_messenger->cct, watch_lock),
   next_notif_id(0),
+  watch_notify_finisher(cct),
+  qos_lock("OSDService::qos_lock"),
+  qos_retry_lock("OSDService::qos_retry_lock"),
+  qos_retry_timer(cct, qos_retry_lock, false),
   backfill_request_lock("OSD::backfill_request_lock"),
   backfill_request_timer(cct, backfill_request_lock, false),
+  snap_trim_request_lock("OSD::snap_trim_request_lock"),
+  snap_trim_request_timer(cct, snap_trim_request_lock, false),
   last_tid(0),
   tid_lock("OSDService::tid_lock"),
   reserver_finisher(cct),
@@ -242,7 +255,8 @@ OSDService::OSDService(OSD *osd) :
 		  cct->_conf->osd_min_recovery_priority),
   pg_temp_lock("OSDService::pg_temp_lock"),
   map_cache_lock("OSDService::map_lock"),
-  map_cache(cct, cct->_conf->osd_map_cache_size),
+  map_cache(cct, cct->_conf->osd_map_cache_size,
+	    cct->_conf->osd_map_cache_shards),
   map_bl_cache(cct->_conf->osd_map_cache_size),
   map_bl_inc_cache(cct->_conf->osd_map_cache_size),
   in_progress_split_lock("OSDService::in_progress_split_lock"),
@@ -462,11 +476,21 @@ void OSDService::shutdown()
 
   objecter->shutdown();
   objecter_finisher.stop();
+  obc_prefetch_finisher.stop();
+  watch_notify_finisher.stop();
 
   {
     Mutex::Locker l(backfill_request_lock);
     backfill_request_timer.shutdown();
   }
+  {
+    Mutex::Locker l(snap_trim_request_lock);
+    snap_trim_request_timer.shutdown();
+  }
+  {
+    Mutex::Locker l(qos_retry_lock);
+    qos_retry_timer.shutdown();
+  }
   osdmap = OSDMapRef();
   next_osdmap = OSDMapRef();
 }
@@ -475,6 +499,8 @@ void OSDService::init()
 {
   reserver_finisher.start();
   objecter_finisher.start();
+  obc_prefetch_finisher.start();
+  watch_notify_finisher.start();
   objecter->set_client_incarnation(0);
   objecter->start();
   watch_timer.init();
@@ -483,6 +509,45 @@ void OSDService::init()
   agent_thread.create();
 }
 
+struct C_PrefetchObc : public Context {
+  OSDService *service;
+  coll_t cid;
+  ghobject_t oid;
+  C_PrefetchObc(OSDService *s, coll_t c, const ghobject_t& o)
+    : service(s), cid(c), oid(o) {}
+  void finish(int) {
+    // warm the object_info attr (and the caches under it); errors
+    // (e.g. object does not exist) are fine, do_op will find out for
+    // itself
+    bufferlist bl;
+    service->store->getattr(cid, oid, OI_ATTR, bl);
+    service->obc_prefetch_inflight.dec();
+  }
+};
+
+void OSDService::queue_obc_prefetch(coll_t c, const ghobject_t& oid)
+{
+  if ((uint32_t)obc_prefetch_inflight.read() >=
+      cct->_conf->osd_obc_prefetch_max)
+    return;
+  obc_prefetch_inflight.inc();
+  obc_prefetch_finisher.queue(new C_PrefetchObc(this, c, oid));
+}
+
+struct C_SendNotifyBatch : public Context {
+  NotifyBatch *batch;
+  explicit C_SendNotifyBatch(NotifyBatch *batch) : batch(batch) {}
+  void finish(int) {
+    batch->send();
+    delete batch;
+  }
+};
+
+void OSDService::queue_notify_batch(NotifyBatch *batch)
+{
+  watch_notify_finisher.queue(new C_SendNotifyBatch(batch));
+}
+
 void OSDService::activate_map()
 {
   // wake/unwake the tiering agent
@@ -909,6 +974,55 @@ void OSDService::share_map_peer(int peer, Connection *con, OSDMapRef map)
   }
 }
 
+double OSDService::pool_qos_delay(int64_t poolid, uint64_t bytes)
+{
+  OSDMapRef curmap = get_osdmap();
+  if (!curmap)
+    return 0;
+  const pg_pool_t *p = curmap->get_pg_pool(poolid);
+  if (!p || !p->has_qos())
+    return 0;
+
+  // this OSD's fair share of the pool-wide limit; with CRUSH spreading
+  // primaries evenly this needs no coordination beyond the map itself
+  unsigned up = MAX(curmap->get_num_up_osds(), 1);
+  double iops_rate = p->qos_max_iops ? (double)p->qos_max_iops / up : 0;
+  double bps_rate = p->qos_max_bps ? (double)p->qos_max_bps / up : 0;
+
+  Mutex::Locker l(qos_lock);
+  PoolQoSBucket &b = qos_buckets[poolid];
+  utime_t now = ceph_clock_now(cct);
+  if (b.last_refill == utime_t())
+    b.last_refill = now;
+  double elapsed = now - b.last_refill;
+  b.last_refill = now;
+
+  // refill; burst is capped at one second's worth of budget
+  if (iops_rate)
+    b.iops_tokens = MIN(b.iops_tokens + elapsed * iops_rate, iops_rate);
+  if (bps_rate)
+    b.bps_tokens = MIN(b.bps_tokens + elapsed * bps_rate, bps_rate);
+
+  // an op bigger than the whole burst is admitted on a full bucket and
+  // leaves it in debt, so a single large op cannot stall forever
+  double delay = 0;
+  if (iops_rate && b.iops_tokens < 1.0)
+    delay = MAX(delay, (1.0 - b.iops_tokens) / iops_rate);
+  if (bps_rate) {
+    double want = MIN((double)bytes, bps_rate);
+    if (b.bps_tokens < want)
+      delay = MAX(delay, (want - b.bps_tokens) / bps_rate);
+  }
+  if (delay > 0)
+    return delay;
+
+  if (iops_rate)
+    b.iops_tokens -= 1.0;
+  if (bps_rate)
+    b.bps_tokens -= (double)bytes;
+  return 0;
+}
+
 bool OSDService::can_inc_scrubs_pending()
 {
   bool can_inc = false;
@@ -1534,6 +1648,11 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   hb_back_server_messenger(hb_back_serverm),
   heartbeat_thread(this),
   heartbeat_dispatcher(this),
+  net_probe_lock("OSD::net_probe_lock"),
+  net_probe_in_progress(false), net_probe_id(0),
+  net_probe_payload_len(0), net_probe_received(0),
+  net_probe_throttle(cct, "osd_net_probe",
+		     cct->_conf->osd_net_probe_inflight_bytes),
   finished_lock("OSD::finished_lock"),
   op_tracker(cct, cct->_conf->osd_enable_op_tracker, 
                   cct->_conf->osd_num_op_tracker_shard),
@@ -1584,6 +1703,7 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
                                          cct->_conf->osd_op_log_threshold);
   op_tracker.set_history_size_and_duration(cct->_conf->osd_op_history_size,
                                            cct->_conf->osd_op_history_duration);
+  op_tracker.set_sample_interval(cct->_conf->osd_op_tracker_sample_interval);
 }
 
 OSD::~OSD()
@@ -1744,6 +1864,14 @@ bool OSD::asok_command(string command, cmdmap_t& cmdmap, string format,
     f->close_section();
   } else if (command == "get_latest_osdmap") {
     get_latest_osdmap();
+  } else if (command == "net_ping_test") {
+    int64_t peer = -1;
+    int64_t count = 100;
+    int64_t size = 65536;
+    cmd_getval(cct, cmdmap, "peer", peer);
+    cmd_getval(cct, cmdmap, "count", count);
+    cmd_getval(cct, cmdmap, "size", size);
+    net_ping_test(peer, count, size, f, ss);
   } else {
     assert(0 == "broken asok registration");
   }
@@ -1779,6 +1907,8 @@ int OSD::init()
   tick_timer.init();
   tick_timer_without_osd_lock.init();
   service.backfill_request_timer.init();
+  service.snap_trim_request_timer.init();
+  service.qos_retry_timer.init();
 
   // mount.
   dout(2) << "mounting " << dev_path << " "
@@ -1913,6 +2043,28 @@ int OSD::init()
   update_log_config();
 
   osd_tp.start();
+  {
+    // pin op shard workers before the threads start so that affinity is
+    // applied on thread entry and shard state is first-touched locally
+    vector<int> shard_cpus;
+    list<string> cpu_strs;
+    get_str_list(cct->_conf->osd_op_shard_cpu_affinity, cpu_strs);
+    for (list<string>::iterator i = cpu_strs.begin();
+	 i != cpu_strs.end();
+	 ++i) {
+      string err;
+      int cpuid = strict_strtol(i->c_str(), 10, &err);
+      if (!err.empty()) {
+	derr << "bad cpu id '" << *i << "' in osd_op_shard_cpu_affinity: "
+	     << err << dendl;
+	shard_cpus.clear();
+	break;
+      }
+      shard_cpus.push_back(cpuid);
+    }
+    if (!shard_cpus.empty())
+      osd_op_tp.set_thread_cpu_affinity(shard_cpus);
+  }
   osd_op_tp.start();
   recovery_tp.start();
   disk_tp.start();
@@ -2018,6 +2170,15 @@ void OSD::final_init()
 				     "force osd to update the latest map from "
 				     "the mon");
   assert(r == 0);
+  r = admin_socket->register_command("net_ping_test",
+				     "net_ping_test " \
+				     "name=peer,type=CephInt,range=0 " \
+				     "name=count,type=CephInt,range=1,req=false " \
+				     "name=size,type=CephInt,range=0,req=false",
+				     asok_hook,
+				     "measure round-trip latency and throughput "
+				     "to a peer osd over the cluster messenger");
+  assert(r == 0);
 
   test_ops_hook = new TestOpsSocketHook(&(this->service), this->store);
   // Note: pools are CephString instead of CephPoolname because
@@ -2192,6 +2353,8 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_copyfrom, "copyfrom", "Rados \"copy-from\" operations");
 
   osd_plb.add_u64_counter(l_osd_tier_promote, "tier_promote", "Tier promotions");
+  osd_plb.add_u64_counter(l_osd_tier_promote_throttle, "tier_promote_throttle",
+			  "Optional tier promotions skipped by the promote throttle");
   osd_plb.add_u64_counter(l_osd_tier_flush, "tier_flush", "Tier flushes");
   osd_plb.add_u64_counter(l_osd_tier_flush_fail, "tier_flush_fail", "Failed tier flushes");
   osd_plb.add_u64_counter(l_osd_tier_try_flush, "tier_try_flush", "Tier flush attempts");
@@ -2317,6 +2480,7 @@ int OSD::shutdown()
   cct->get_admin_socket()->unregister_command("dump_watchers");
   cct->get_admin_socket()->unregister_command("dump_reservations");
   cct->get_admin_socket()->unregister_command("get_latest_osdmap");
+  cct->get_admin_socket()->unregister_command("net_ping_test");
   delete asok_hook;
   asok_hook = NULL;
 
@@ -2810,6 +2974,83 @@ PG *OSD::_lookup_lock_pg_with_map_lock_held(spg_t pgid)
   return pg;
 }
 
+void OSD::_load_pg(spg_t pgid, atomic_t *has_upgraded)
+{
+  if (pgid.preferred() >= 0) {
+    dout(10) << __func__ << ": skipping localized PG " << pgid << dendl;
+    // FIXME: delete it too, eventually
+    return;
+  }
+
+  dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
+  bufferlist bl;
+  epoch_t map_epoch = PG::peek_map_epoch(store, pgid, &bl);
+
+  PG *pg = NULL;
+  if (map_epoch > 0) {
+    OSDMapRef pgosdmap = service.try_get_map(map_epoch);
+    if (!pgosdmap) {
+      if (!osdmap->have_pg_pool(pgid.pool())) {
+	derr << __func__ << ": could not find map for epoch " << map_epoch
+	     << " on pg " << pgid << ", but the pool is not present in the "
+	     << "current map, so this is probably a result of bug 10617.  "
+	     << "Skipping the pg for now, you can use ceph_objectstore_tool "
+	     << "to clean it up later." << dendl;
+	return;
+      } else {
+	derr << __func__ << ": have pgid " << pgid << " at epoch "
+	     << map_epoch << ", but missing map.  Crashing."
+	     << dendl;
+	assert(0 == "Missing map in load_pgs");
+      }
+    }
+    pg = _open_lock_pg(pgosdmap, pgid);
+  } else {
+    pg = _open_lock_pg(osdmap, pgid);
+  }
+  // there can be no waiters here, so we don't call wake_pg_waiters
+
+  // read pg state, log
+  pg->read_state(store, bl);
+
+  if (pg->must_upgrade()) {
+    if (!pg->can_upgrade()) {
+      derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
+	   << " an older version first." << dendl;
+      assert(0 == "PG too old to upgrade");
+    }
+    if (has_upgraded->inc() == 1) {
+      derr << "PGs are upgrading" << dendl;
+    }
+    dout(10) << "PG " << pg->info.pgid
+	     << " must upgrade..." << dendl;
+    pg->upgrade(store);
+  }
+
+  service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
+
+  // generate state for PG's current mapping
+  int primary, up_primary;
+  vector<int> acting, up;
+  pg->get_osdmap()->pg_to_up_acting_osds(
+    pgid.pgid, &up, &up_primary, &acting, &primary);
+  pg->init_primary_up_acting(
+    up,
+    acting,
+    up_primary,
+    primary);
+  int role = OSDMap::calc_pg_role(whoami, pg->acting);
+  pg->set_role(role);
+
+  pg->reg_next_scrub();
+
+  PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
+  pg->handle_loaded(&rctx);
+
+  dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
+  pg->unlock();
+}
+
 void OSD::load_pgs()
 {
   assert(osd_lock.is_locked());
@@ -2846,84 +3087,43 @@ void OSD::load_pgs()
     dout(10) << "load_pgs ignoring unrecognized " << *it << dendl;
   }
 
-  bool has_upgraded = false;
-  for (set<spg_t>::iterator i = pgs.begin(); i != pgs.end(); ++i) {
-    spg_t pgid(*i);
-
-    if (pgid.preferred() >= 0) {
-      dout(10) << __func__ << ": skipping localized PG " << pgid << dendl;
-      // FIXME: delete it too, eventually
-      continue;
-    }
-
-    dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
-    bufferlist bl;
-    epoch_t map_epoch = PG::peek_map_epoch(store, pgid, &bl);
-
-    PG *pg = NULL;
-    if (map_epoch > 0) {
-      OSDMapRef pgosdmap = service.try_get_map(map_epoch);
-      if (!pgosdmap) {
-	if (!osdmap->have_pg_pool(pgid.pool())) {
-	  derr << __func__ << ": could not find map for epoch " << map_epoch
-	       << " on pg " << pgid << ", but the pool is not present in the "
-	       << "current map, so this is probably a result of bug 10617.  "
-	       << "Skipping the pg for now, you can use ceph_objectstore_tool "
-	       << "to clean it up later." << dendl;
-	  continue;
-	} else {
-	  derr << __func__ << ": have pgid " << pgid << " at epoch "
-	       << map_epoch << ", but missing map.  Crashing."
-	       << dendl;
-	  assert(0 == "Missing map in load_pgs");
-	}
-      }
-      pg = _open_lock_pg(pgosdmap, pgid);
-    } else {
-      pg = _open_lock_pg(osdmap, pgid);
-    }
-    // there can be no waiters here, so we don't call wake_pg_waiters
-
-    // read pg state, log
-    pg->read_state(store, bl);
-
-    if (pg->must_upgrade()) {
-      if (!pg->can_upgrade()) {
-	derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
-	     << " an older version first." << dendl;
-	assert(0 == "PG too old to upgrade");
-      }
-      if (!has_upgraded) {
-	derr << "PGs are upgrading" << dendl;
-	has_upgraded = true;
+  atomic_t has_upgraded;
+  int nthreads = cct->_conf->osd_load_pgs_threads;
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads == 1 || pgs.size() <= 1) {
+    for (set<spg_t>::iterator i = pgs.begin(); i != pgs.end(); ++i)
+      _load_pg(*i, &has_upgraded);
+  } else {
+    // read_state dominates load time and is independent per PG; the
+    // shared structures we touch (pg_map, the map cache, split and
+    // scrub tracking) take their own locks, so PGs can be opened from
+    // several threads.
+    struct PGLoaderThread : public Thread {
+      OSD *osd;
+      vector<spg_t> pgids;
+      atomic_t *has_upgraded;
+      PGLoaderThread(OSD *o, atomic_t *hu) : osd(o), has_upgraded(hu) {}
+      void *entry() {
+	for (vector<spg_t>::iterator i = pgids.begin();
+	     i != pgids.end();
+	     ++i)
+	  osd->_load_pg(*i, has_upgraded);
+	return 0;
       }
-      dout(10) << "PG " << pg->info.pgid
-	       << " must upgrade..." << dendl;
-      pg->upgrade(store);
+    };
+    vector<PGLoaderThread*> loaders;
+    for (int i = 0; i < nthreads; ++i)
+      loaders.push_back(new PGLoaderThread(this, &has_upgraded));
+    unsigned n = 0;
+    for (set<spg_t>::iterator i = pgs.begin(); i != pgs.end(); ++i)
+      loaders[n++ % nthreads]->pgids.push_back(*i);
+    for (int i = 0; i < nthreads; ++i)
+      loaders[i]->create();
+    for (int i = 0; i < nthreads; ++i) {
+      loaders[i]->join();
+      delete loaders[i];
     }
-
-    service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
-
-    // generate state for PG's current mapping
-    int primary, up_primary;
-    vector<int> acting, up;
-    pg->get_osdmap()->pg_to_up_acting_osds(
-      pgid.pgid, &up, &up_primary, &acting, &primary);
-    pg->init_primary_up_acting(
-      up,
-      acting,
-      up_primary,
-      primary);
-    int role = OSDMap::calc_pg_role(whoami, pg->acting);
-    pg->set_role(role);
-
-    pg->reg_next_scrub();
-
-    PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
-    pg->handle_loaded(&rctx);
-
-    dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
-    pg->unlock();
   }
   {
     RWLock::RLocker l(pg_map_lock);
@@ -2931,7 +3131,8 @@ void OSD::load_pgs()
   }
 
   // clean up old infos object?
-  if (has_upgraded && store->exists(coll_t::meta(), OSD::make_infos_oid())) {
+  if (has_upgraded.read() &&
+      store->exists(coll_t::meta(), OSD::make_infos_oid())) {
     dout(1) << __func__ << " removing legacy infos object" << dendl;
     ObjectStore::Transaction t;
     t.remove(coll_t::meta(), OSD::make_infos_oid());
@@ -3778,6 +3979,166 @@ void OSD::handle_osd_ping(MOSDPing *m)
   m->put();
 }
 
+void OSD::handle_net_ping(MOSDNetPing *m)
+{
+  if (superblock.cluster_fsid != m->fsid) {
+    dout(20) << "handle_net_ping from " << m->get_source_inst()
+	     << " bad fsid " << m->fsid << " != " << superblock.cluster_fsid << dendl;
+    m->put();
+    return;
+  }
+
+  switch (m->op) {
+
+  case MOSDNetPing::PING:
+    {
+      // echo the stamp and ids only; the reply carries no payload, so
+      // bulk transfer is measured in the probing osd's send direction
+      Message *r = new MOSDNetPing(monc->get_fsid(), MOSDNetPing::PING_REPLY,
+				   m->probe_id, m->seq, m->stamp);
+      m->get_connection()->send_message(r);
+    }
+    break;
+
+  case MOSDNetPing::PING_REPLY:
+    {
+      Mutex::Locker l(net_probe_lock);
+      if (!net_probe_in_progress || m->probe_id != net_probe_id) {
+	dout(20) << "handle_net_ping stale reply " << *m << dendl;
+	break;
+      }
+      utime_t now = ceph_clock_now(cct);
+      net_probe_rtts.push_back((double)(now - m->stamp));
+      net_probe_throttle.put(net_probe_payload_len ? net_probe_payload_len : 1);
+      ++net_probe_received;
+      net_probe_cond.Signal();
+    }
+    break;
+  }
+
+  m->put();
+}
+
+static double rtt_percentile(const vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0.0;
+  size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+void OSD::net_ping_test(int64_t peer, int64_t count, int64_t size,
+			Formatter *f, ostream& ss)
+{
+  if (count < 1)
+    count = 1;
+  if (count > 100000)
+    count = 100000;
+  if (size < 0)
+    size = 0;
+  if ((uint64_t)size > cct->_conf->osd_net_probe_inflight_bytes)
+    size = cct->_conf->osd_net_probe_inflight_bytes;
+
+  OSDMapRef curmap = service.get_osdmap();
+  if (peer < 0 || !curmap->is_up(peer)) {
+    ss << "osd." << peer << " is not up";
+    return;
+  }
+  if (peer == whoami) {
+    ss << "refusing to ping myself";
+    return;
+  }
+  ConnectionRef con = service.get_con_osd_cluster(peer, curmap->get_epoch());
+  if (!con) {
+    ss << "could not get cluster connection to osd." << peer;
+    return;
+  }
+
+  uint64_t probe;
+  {
+    Mutex::Locker l(net_probe_lock);
+    if (net_probe_in_progress) {
+      ss << "a net ping test is already in progress";
+      return;
+    }
+    net_probe_in_progress = true;
+    probe = ++net_probe_id;
+    net_probe_payload_len = size;
+    net_probe_received = 0;
+    net_probe_rtts.clear();
+    net_probe_rtts.reserve(count);
+  }
+
+  dout(10) << "net_ping_test osd." << peer << " count " << count
+	   << " size " << size << dendl;
+
+  bufferlist payload;
+  if (size) {
+    bufferptr bp(size);
+    bp.zero();
+    payload.push_back(bp);
+  }
+
+  utime_t start = ceph_clock_now(cct);
+  for (int64_t i = 0; i < count; ++i) {
+    // block here, not in the messenger, so that probe payload in
+    // flight stays bounded and cannot starve real traffic of memory
+    net_probe_throttle.get(size ? size : 1);
+    MOSDNetPing *p = new MOSDNetPing(monc->get_fsid(), MOSDNetPing::PING,
+				     probe, i, ceph_clock_now(cct));
+    if (size)
+      p->set_data(payload);
+    con->send_message(p);
+  }
+
+  uint64_t received;
+  vector<double> rtts;
+  utime_t end;
+  {
+    Mutex::Locker l(net_probe_lock);
+    utime_t deadline = ceph_clock_now(cct);
+    deadline += cct->_conf->osd_net_probe_timeout;
+    while (net_probe_received < (uint64_t)count &&
+	   ceph_clock_now(cct) < deadline) {
+      net_probe_cond.WaitInterval(cct, net_probe_lock, utime_t(1, 0));
+    }
+    end = ceph_clock_now(cct);
+    received = net_probe_received;
+    rtts.swap(net_probe_rtts);
+    net_probe_in_progress = false;
+  }
+  // replies that never came are still holding throttle budget
+  net_probe_throttle.put((size ? size : 1) * (count - received));
+
+  sort(rtts.begin(), rtts.end());
+  double elapsed = (double)(end - start);
+
+  f->open_object_section("net_ping_test");
+  f->dump_int("peer", peer);
+  f->dump_int("count", count);
+  f->dump_int("payload_bytes", size);
+  f->dump_unsigned("replies", received);
+  f->dump_unsigned("lost", count - received);
+  f->dump_float("elapsed_sec", elapsed);
+  if (elapsed > 0)
+    f->dump_float("throughput_mb_sec",
+		  (double)received * size / elapsed / (1024.0 * 1024.0));
+  f->open_object_section("rtt_ms");
+  if (!rtts.empty()) {
+    double sum = 0.0;
+    for (vector<double>::iterator p = rtts.begin(); p != rtts.end(); ++p)
+      sum += *p;
+    f->dump_float("min", rtts.front() * 1000.0);
+    f->dump_float("avg", sum / rtts.size() * 1000.0);
+    f->dump_float("p50", rtt_percentile(rtts, 0.5) * 1000.0);
+    f->dump_float("p90", rtt_percentile(rtts, 0.9) * 1000.0);
+    f->dump_float("p99", rtt_percentile(rtts, 0.99) * 1000.0);
+    f->dump_float("max", rtts.back() * 1000.0);
+  }
+  f->close_section();
+  f->close_section();
+}
+
 void OSD::heartbeat_entry()
 {
   Mutex::Locker l(heartbeat_lock);
@@ -4024,6 +4385,8 @@ void OSD::tick_without_osd_lock()
   assert(tick_timer_lock.is_locked());
   dout(5) << "tick_without_osd_lock" << dendl;
 
+  service.promote_throttle_refresh();
+
   if (!scrub_random_backoff()) {
     sched_scrub();
   }
@@ -4677,7 +5040,11 @@ void OSD::send_pg_stats(const utime_t &now)
       }
       pg->pg_stats_publish_lock.Lock();
       if (pg->pg_stats_publish_valid) {
-	m->pg_stat[pg->info.pgid.pgid] = pg->pg_stats_publish;
+	// encode once per stat change; reports repeat the same stats
+	// until the mon acks, so reuse the cached encoding
+	if (!pg->pg_stats_publish_enc.length())
+	  ::encode(pg->pg_stats_publish, pg->pg_stats_publish_enc);
+	m->pg_stat_enc[pg->info.pgid.pgid] = pg->pg_stats_publish_enc;
 	dout(25) << " sending " << pg->info.pgid << " " << pg->pg_stats_publish.reported_epoch << ":"
 		 << pg->pg_stats_publish.reported_seq << dendl;
       } else {
@@ -5486,6 +5853,11 @@ void OSD::ms_fast_dispatch(Message *m)
     m->put();
     return;
   }
+  if (m->get_type() == MSG_OSD_NET_PING) {
+    // not an op; handled entirely in the fast path
+    handle_net_ping(static_cast<MOSDNetPing*>(m));
+    return;
+  }
   OpRequestRef op = op_tracker.create_request<OpRequest>(m);
   {
 #ifdef WITH_LTTNG
@@ -6216,9 +6588,16 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-	get_map_bl(e - 1, obl);
-	o->decode(obl);
+	OSDMapRef prev = service.try_get_map(e - 1);
+	if (prev) {
+	  // share the previous (immutable, cached) map's sub-structures;
+	  // apply_incremental clones only the ones the delta touches
+	  o->lazy_copy_from(*prev);
+	} else {
+	  bufferlist obl;
+	  get_map_bl(e - 1, obl);
+	  o->decode(obl);
+	}
       }
 
       OSDMap::Incremental inc;
@@ -6538,7 +6917,8 @@ bool OSD::advance_pg(
   epoch_t osd_epoch, PG *pg,
   ThreadPool::TPHandle &handle,
   PG::RecoveryCtx *rctx,
-  set<boost::intrusive_ptr<PG> > *new_pgs)
+  set<boost::intrusive_ptr<PG> > *new_pgs,
+  map<epoch_t, OSDMapRef> *advance_maps)
 {
   assert(pg->is_locked());
   epoch_t next_epoch = pg->get_osdmap()->get_epoch() + 1;
@@ -6559,7 +6939,19 @@ bool OSD::advance_pg(
   for (;
        next_epoch <= osd_epoch && next_epoch <= max;
        ++next_epoch) {
-    OSDMapRef nextmap = service.try_get_map(next_epoch);
+    // the pgs in one peering_wq batch mostly advance through the same
+    // epochs; resolve each map once per batch instead of once per pg
+    OSDMapRef nextmap;
+    if (advance_maps) {
+      map<epoch_t, OSDMapRef>::iterator p = advance_maps->find(next_epoch);
+      if (p != advance_maps->end())
+	nextmap = p->second;
+    }
+    if (!nextmap) {
+      nextmap = service.try_get_map(next_epoch);
+      if (nextmap && advance_maps)
+	(*advance_maps)[next_epoch] = nextmap;
+    }
     if (!nextmap) {
       dout(20) << __func__ << " missing map " << next_epoch << dendl;
       // make sure max is bumped up so that we can get past any
@@ -8011,8 +8403,10 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     return;
   }
 
-  // we don't need encoded payload anymore
-  m->clear_payload();
+  // note: everything up to the misdirect checks below only looks at
+  // the routing prefix that decode_payload() filled in; the deferred
+  // part of the decode waits until we know we are actually going to
+  // queue the op.  see MOSDOp::finish_decode().
 
   // object name too long?
   unsigned max_name_len = MIN(g_conf->osd_max_object_name_len,
@@ -8046,6 +8440,73 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     client_session->put();
   }
 
+  // calc actual pgid
+  pg_t _pgid = m->get_pg();
+  int64_t pool = _pgid.pool();
+  if ((m->get_flags() & CEPH_OSD_FLAG_PGOP) == 0 &&
+      osdmap->have_pg_pool(pool))
+    _pgid = osdmap->raw_pg_to_pg(_pgid);
+
+  spg_t pgid;
+  if (!osdmap->get_primary_shard(_pgid, &pgid)) {
+    // missing pool or acting set empty -- drop
+    return;
+  }
+
+  OSDMapRef send_map = service.try_get_map(m->get_map_epoch());
+  // check send epoch
+  if (!send_map) {
+    dout(7) << "don't have sender's osdmap; assuming it was valid and that"
+	    << " client will resend" << dendl;
+    return;
+  }
+  if (!send_map->have_pg_pool(pgid.pool())) {
+    dout(7) << "dropping request; pool did not exist" << dendl;
+    clog->warn() << m->get_source_inst() << " invalid " << m->get_reqid()
+		      << " pg " << m->get_pg()
+		      << " to osd." << whoami
+		      << " in e" << osdmap->get_epoch()
+		      << ", client e" << m->get_map_epoch()
+		      << " when pool " << m->get_pg().pool() << " did not exist"
+		      << "\n";
+    return;
+  }
+  if (!send_map->osd_is_valid_op_target(pgid.pgid, whoami)) {
+    dout(7) << "we are invalid target" << dendl;
+    clog->warn() << m->get_source_inst() << " misdirected " << m->get_reqid()
+		      << " pg " << m->get_pg()
+		      << " to osd." << whoami
+		      << " in e" << osdmap->get_epoch()
+		      << ", client e" << m->get_map_epoch()
+		      << " pg " << pgid
+		      << " features " << m->get_connection()->get_features()
+		      << "\n";
+    service.reply_op_error(op, -ENXIO);
+    return;
+  }
+
+  // check against current map too
+  if (!osdmap->have_pg_pool(pgid.pool()) ||
+      !osdmap->osd_is_valid_op_target(pgid.pgid, whoami)) {
+    dout(7) << "dropping; no longer have PG (or pool); client will retarget"
+	    << dendl;
+    return;
+  }
+
+  // the op is really for us -- now pay for the rest of the decode,
+  // before we throw the payload away; see MOSDOp::finish_decode()
+  try {
+    m->finish_decode();
+  } catch (const buffer::error &e) {
+    derr << __func__ << " failed to decode " << *m << ": " << e.what()
+	 << dendl;
+    service.reply_op_error(op, -EINVAL);
+    return;
+  }
+
+  // we don't need encoded payload anymore
+  m->clear_payload();
+
   if (op->rmw_flags == 0) {
     int r = init_op_flags(op);
     if (r) {
@@ -8062,9 +8523,6 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     }
   }
 
-  // calc actual pgid
-  pg_t _pgid = m->get_pg();
-  int64_t pool = _pgid.pool();
   if (op->may_write()) {
     // full?
     if ((service.check_failsafe_full() ||
@@ -8082,11 +8540,11 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     }
     // pool is full ?
     map<int64_t, epoch_t> &pool_last_map_marked_full = superblock.pool_last_map_marked_full;
-    if (pi->has_flag(pg_pool_t::FLAG_FULL) || 
+    if (pi->has_flag(pg_pool_t::FLAG_FULL) ||
        (pool_last_map_marked_full.count(pool) && (m->get_map_epoch() < pool_last_map_marked_full[pool]))) {
       return;
     }
-    
+
     // invalid?
     if (m->get_snapid() != CEPH_NOSNAP) {
       service.reply_op_error(op, -EINVAL);
@@ -8105,56 +8563,6 @@ void OSD::handle_op(OpRequestRef& op, OSDMapRef& osdmap)
     }
   }
 
-  if ((m->get_flags() & CEPH_OSD_FLAG_PGOP) == 0 &&
-      osdmap->have_pg_pool(pool))
-    _pgid = osdmap->raw_pg_to_pg(_pgid);
-
-  spg_t pgid;
-  if (!osdmap->get_primary_shard(_pgid, &pgid)) {
-    // missing pool or acting set empty -- drop
-    return;
-  }
-
-  OSDMapRef send_map = service.try_get_map(m->get_map_epoch());
-  // check send epoch
-  if (!send_map) {
-    dout(7) << "don't have sender's osdmap; assuming it was valid and that"
-	    << " client will resend" << dendl;
-    return;
-  }
-  if (!send_map->have_pg_pool(pgid.pool())) {
-    dout(7) << "dropping request; pool did not exist" << dendl;
-    clog->warn() << m->get_source_inst() << " invalid " << m->get_reqid()
-		      << " pg " << m->get_pg()
-		      << " to osd." << whoami
-		      << " in e" << osdmap->get_epoch()
-		      << ", client e" << m->get_map_epoch()
-		      << " when pool " << m->get_pg().pool() << " did not exist"
-		      << "\n";
-    return;
-  }
-  if (!send_map->osd_is_valid_op_target(pgid.pgid, whoami)) {
-    dout(7) << "we are invalid target" << dendl;
-    clog->warn() << m->get_source_inst() << " misdirected " << m->get_reqid()
-		      << " pg " << m->get_pg()
-		      << " to osd." << whoami
-		      << " in e" << osdmap->get_epoch()
-		      << ", client e" << m->get_map_epoch()
-		      << " pg " << pgid
-		      << " features " << m->get_connection()->get_features()
-		      << "\n";
-    service.reply_op_error(op, -ENXIO);
-    return;
-  }
-
-  // check against current map too
-  if (!osdmap->have_pg_pool(pgid.pool()) ||
-      !osdmap->osd_is_valid_op_target(pgid.pgid, whoami)) {
-    dout(7) << "dropping; no longer have PG (or pool); client will retarget"
-	    << dendl;
-    return;
-  }
-
   PG *pg = get_pg_or_queue_for_pg(pgid, op);
   if (pg) {
     op->send_map_update = share_map.should_send;
@@ -8230,6 +8638,7 @@ void OSD::enqueue_op(PG *pg, OpRequestRef& op)
 	   << " cost " << op->get_req()->get_cost()
 	   << " latency " << latency
 	   << " " << *(op->get_req()) << dendl;
+  pg->maybe_prefetch_obc(op);
   pg->queue_op(op);
 }
 
@@ -8239,6 +8648,10 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
 
   ShardData* sdata = shard_list[shard_index];
   assert(NULL != sdata);
+  uint32_t batch_size = osd->cct->_conf->osd_op_dequeue_batch_size;
+  if (batch_size < 1)
+    batch_size = 1;
+  list<PGRef> to_process;
   sdata->sdata_op_ordering_lock.Lock();
   if (sdata->pqueue.empty()) {
     sdata->sdata_op_ordering_lock.Unlock();
@@ -8252,26 +8665,82 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
       return;
     }
   }
-  pair<PGRef, PGQueueable> item = sdata->pqueue.dequeue();
-  sdata->pg_for_processing[&*(item.first)].push_back(item.second);
+  // grab a batch under a single ordering-lock hold; each dequeued op is
+  // staged in its pg's pg_for_processing list and processed in order
+  // below.
+  while (!sdata->pqueue.empty() && to_process.size() < batch_size) {
+    pair<PGRef, PGQueueable> item = sdata->pqueue.dequeue();
+    sdata->pg_for_processing[&*(item.first)].push_back(item.second);
+    to_process.push_back(item.first);
+  }
   sdata->sdata_op_ordering_lock.Unlock();
   ThreadPool::TPHandle tp_handle(osd->cct, hb, timeout_interval, 
     suicide_interval);
 
-  (item.first)->lock_suspend_timeout(tp_handle);
+  for (list<PGRef>::iterator i = to_process.begin();
+       i != to_process.end();
+       ++i) {
+    _process_staged(*i, sdata, tp_handle);
+    tp_handle.reset_tp_timeout();
+  }
+}
+
+void OSD::ShardedOpWQ::_process_staged(PGRef pg, ShardData *sdata,
+				       ThreadPool::TPHandle &tp_handle) {
+  // during map churn the queues fill up with client ops for pgs that a
+  // newer map has moved elsewhere.  those ops are doomed -- the pg will
+  // drop them in can_discard_request() once it catches up -- but each
+  // one would still pay for the pg lock to get there, and during
+  // peering that lock is exactly what everything is contending on.
+  // discard them here against the freshest published map instead so a
+  // post-rebalance backlog drains without touching the pg at all.
+  {
+    bool discard = false;
+    {
+      Mutex::Locker l(sdata->sdata_op_ordering_lock);
+      if (!sdata->pg_for_processing.count(&*pg))
+	return;
+      assert(sdata->pg_for_processing[&*pg].size());
+      boost::optional<OpRequestRef> _op =
+	sdata->pg_for_processing[&*pg].front().maybe_get_op();
+      if (_op && (*_op)->get_req()->get_type() == CEPH_MSG_OSD_OP) {
+	OSDMapRef curmap = osd->service.get_osdmap();
+	if (curmap &&
+	    curmap->get_epoch() > (*_op)->sent_epoch &&
+	    !curmap->osd_is_valid_op_target(pg->info.pgid.pgid,
+					    osd->whoami)) {
+	  lgeneric_subdout(osd->cct, osd, 7)
+	    << "discarding queued " << *(*_op)->get_req()
+	    << " -- not a valid op target for " << pg->info.pgid
+	    << " in e" << curmap->get_epoch()
+	    << ", client will retarget" << dendl;
+	  sdata->pg_for_processing[&*pg].pop_front();
+	  if (!(sdata->pg_for_processing[&*pg].size()))
+	    sdata->pg_for_processing.erase(&*pg);
+	  discard = true;
+	}
+      }
+    }
+    if (discard)
+      return;
+  }
+
+  tracepoint(pg, lock_enter, pg->info.pgid.pool(), pg->info.pgid.ps());
+  pg->lock_suspend_timeout(tp_handle);
+  tracepoint(pg, lock_acquired, pg->info.pgid.pool(), pg->info.pgid.ps());
 
   boost::optional<PGQueueable> op;
   {
     Mutex::Locker l(sdata->sdata_op_ordering_lock);
-    if (!sdata->pg_for_processing.count(&*(item.first))) {
-      (item.first)->unlock();
+    if (!sdata->pg_for_processing.count(&*pg)) {
+      pg->unlock();
       return;
     }
-    assert(sdata->pg_for_processing[&*(item.first)].size());
-    op = sdata->pg_for_processing[&*(item.first)].front();
-    sdata->pg_for_processing[&*(item.first)].pop_front();
-    if (!(sdata->pg_for_processing[&*(item.first)].size()))
-      sdata->pg_for_processing.erase(&*(item.first));
+    assert(sdata->pg_for_processing[&*pg].size());
+    op = sdata->pg_for_processing[&*pg].front();
+    sdata->pg_for_processing[&*pg].pop_front();
+    if (!(sdata->pg_for_processing[&*pg].size()))
+      sdata->pg_for_processing.erase(&*pg);
   }  
 
   // osd:opwq_process marks the point at which an operation has been dequeued
@@ -8296,7 +8765,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
   delete f;
   *_dout << dendl;
 
-  op->run(osd, item.first, tp_handle);
+  op->run(osd, pg, tp_handle);
 
   {
 #ifdef WITH_LTTNG
@@ -8309,7 +8778,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb )
         reqid.name._num, reqid.tid, reqid.inc);
   }
 
-  (item.first)->unlock();
+  pg->unlock();
 }
 
 void OSD::ShardedOpWQ::_enqueue(pair<PGRef, PGQueueable> item) {
@@ -8456,6 +8925,7 @@ void OSD::process_peering_events(
   bool need_up_thru = false;
   epoch_t same_interval_since = 0;
   OSDMapRef curmap = service.get_osdmap();
+  map<epoch_t, OSDMapRef> advance_maps;
   PG::RecoveryCtx rctx = create_context();
   rctx.handle = &handle;
   for (list<PG*>::const_iterator i = pgs.begin();
@@ -8469,7 +8939,8 @@ void OSD::process_peering_events(
       pg->unlock();
       continue;
     }
-    if (!advance_pg(curmap->get_epoch(), pg, handle, &rctx, &split_pgs)) {
+    if (!advance_pg(curmap->get_epoch(), pg, handle, &rctx, &split_pgs,
+		    &advance_maps)) {
       // we need to requeue the PG explicitly since we didn't actually
       // handle an event
       peering_wq.queue(pg);
@@ -8507,6 +8978,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_min_recovery_priority",
     "osd_op_complaint_time", "osd_op_log_threshold",
     "osd_op_history_size", "osd_op_history_duration",
+    "osd_op_tracker_sample_interval",
     "osd_map_cache_size",
     "osd_map_max_advance",
     "osd_pg_epoch_persisted_max_stale",
@@ -8543,6 +9015,9 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
     op_tracker.set_history_size_and_duration(cct->_conf->osd_op_history_size,
                                              cct->_conf->osd_op_history_duration);
   }
+  if (changed.count("osd_op_tracker_sample_interval")) {
+    op_tracker.set_sample_interval(cct->_conf->osd_op_tracker_sample_interval);
+  }
   if (changed.count("osd_disk_thread_ioprio_class") ||
       changed.count("osd_disk_thread_ioprio_priority")) {
     set_disk_tp_priority();
@@ -27,6 +27,7 @@
 #include "common/WorkQueue.h"
 #include "common/LogClient.h"
 #include "common/AsyncReserver.h"
+#include "common/Throttle.h"
 #include "common/ceph_context.h"
 
 #include "os/ObjectStore.h"
@@ -125,6 +126,7 @@ enum {
   l_osd_copyfrom,
 
   l_osd_tier_promote,
+  l_osd_tier_promote_throttle,
   l_osd_tier_flush,
   l_osd_tier_flush_fail,
   l_osd_tier_try_flush,
@@ -764,25 +766,105 @@ public:
     flush_mode_high_count --;
   }
 
+  // -- promote throttle --
+  // Budget for promotions that happen in the background behind a
+  // proxied read or write.  Refilled once per tick; once an interval's
+  // budget is spent further optional promotions are skipped and misses
+  // keep being served from the base tier.
+  Mutex promote_throttle_lock;
+  uint64_t promote_ops_avail;
+  uint64_t promote_bytes_avail;
+
+  /// refill the per-interval promotion budget (called from tick)
+  void promote_throttle_refresh() {
+    Mutex::Locker l(promote_throttle_lock);
+    promote_ops_avail = cct->_conf->osd_tier_promote_max_objects_sec;
+    promote_bytes_avail = cct->_conf->osd_tier_promote_max_bytes_sec;
+  }
+
+  /// true if an optional promotion should be skipped this interval.
+  /// charges one op; bytes are charged when the copy completes, so we
+  /// may overshoot the byte budget by what is in flight.
+  bool promote_throttle() {
+    uint64_t max_ops = cct->_conf->osd_tier_promote_max_objects_sec;
+    uint64_t max_bytes = cct->_conf->osd_tier_promote_max_bytes_sec;
+    if (!max_ops && !max_bytes)
+      return false;
+    Mutex::Locker l(promote_throttle_lock);
+    if (max_ops && !promote_ops_avail)
+      return true;
+    if (max_bytes && !promote_bytes_avail)
+      return true;
+    if (max_ops)
+      --promote_ops_avail;
+    return false;
+  }
+
+  /// account bytes copied by a finished promotion against the budget
+  void promote_finish(uint64_t bytes) {
+    Mutex::Locker l(promote_throttle_lock);
+    promote_bytes_avail -= std::min(bytes, promote_bytes_avail);
+  }
 
   // -- Objecter, for teiring reads/writes from/to other OSDs --
   Objecter *objecter;
   Finisher objecter_finisher;
 
+  // -- object context prefetch --
+  Finisher obc_prefetch_finisher;
+  atomic_t obc_prefetch_inflight;
+  void queue_obc_prefetch(coll_t c, const ghobject_t& oid);
+
 
   // -- Watch --
   Mutex watch_lock;
   SafeTimer watch_timer;
   uint64_t next_notif_id;
+  Finisher watch_notify_finisher; ///< sends batched notify fan-out
   uint64_t get_next_id(epoch_t cur_epoch) {
     Mutex::Locker l(watch_lock);
     return (((uint64_t)cur_epoch) << 32) | ((uint64_t)(next_notif_id++));
   }
+  /// send batch's messages from the finisher, off the PG lock
+  void queue_notify_batch(NotifyBatch *batch);
+
+  // -- per-pool QoS --
+  /**
+   * lazy token bucket per pool with a QoS descriptor.  refilled from
+   * the wall clock on every check, so no timer is needed; burst is
+   * capped at one second's worth of budget.  the pool-wide limit from
+   * pg_pool_t is divided by the number of up OSDs -- with CRUSH
+   * spreading primaries evenly that approximates this OSD's fair share
+   * without any extra coordination beyond the osdmap itself.
+   */
+  struct PoolQoSBucket {
+    double iops_tokens;
+    double bps_tokens;
+    utime_t last_refill;
+    PoolQoSBucket() : iops_tokens(0), bps_tokens(0) {}
+  };
+  Mutex qos_lock;
+  map<int64_t, PoolQoSBucket> qos_buckets;
+  /**
+   * charge one op of @p bytes against @p poolid's budget.
+   *
+   * @returns 0 if the op was admitted (and the tokens deducted), else
+   * the time in seconds until enough tokens will have accrued
+   */
+  double pool_qos_delay(int64_t poolid, uint64_t bytes);
+  /// requeues ops parked on a pg's waiting_for_qos list once the
+  /// pool's bucket has refilled
+  Mutex qos_retry_lock;
+  SafeTimer qos_retry_timer;
 
   // -- Backfill Request Scheduling --
   Mutex backfill_request_lock;
   SafeTimer backfill_request_timer;
 
+  // -- Snap Trim Scheduling --
+  Mutex snap_trim_request_lock;
+  SafeTimer snap_trim_request_timer;
+
   // -- tids --
   // for ops i issue
   ceph_tid_t last_tid;
@@ -1543,6 +1625,22 @@ public:
   struct HeartbeatDispatcher : public Dispatcher {
     OSD *osd;
     HeartbeatDispatcher(OSD *o) : Dispatcher(cct), osd(o) {}
+
+    // handle pings in the reader thread itself, so failure detection
+    // latency does not depend on a dispatch queue hop
+    bool ms_can_fast_dispatch_any() const { return true; }
+    bool ms_can_fast_dispatch(Message *m) const {
+      switch (m->get_type()) {
+      case CEPH_MSG_PING:
+      case MSG_OSD_PING:
+	return true;
+      default:
+	return false;
+      }
+    }
+    void ms_fast_dispatch(Message *m) {
+      osd->heartbeat_dispatch(m);
+    }
     bool ms_dispatch(Message *m) {
       return osd->heartbeat_dispatch(m);
     }
@@ -1559,6 +1657,25 @@ public:
   } heartbeat_dispatcher;
 
 private:
+  // -- net ping test --
+  // Bounded messenger-level latency/throughput probe against a peer
+  // osd, driven by the 'net_ping_test' asok command.  Probes travel
+  // over the cluster messenger so they exercise the connection and
+  // serialization path replication traffic uses, unlike the heartbeat
+  // messengers.  Only one probe runs at a time.
+  Mutex net_probe_lock;
+  Cond net_probe_cond;
+  bool net_probe_in_progress;
+  uint64_t net_probe_id;           ///< generation; stale replies are ignored
+  uint64_t net_probe_payload_len;  ///< per-ping payload bytes
+  uint64_t net_probe_received;
+  vector<double> net_probe_rtts;   ///< round trips, in seconds
+  Throttle net_probe_throttle;     ///< caps probe payload in flight
+
+  void handle_net_ping(class MOSDNetPing *m);
+  void net_ping_test(int64_t peer, int64_t count, int64_t size,
+		     Formatter *f, ostream& ss);
+
   // -- waiters --
   list<OpRequestRef> finished;
   Mutex finished_lock;
@@ -1601,10 +1718,10 @@ private:
       PrioritizedQueue< pair<PGRef, PGQueueable>, entity_inst_t> pqueue;
       ShardData(
 	string lock_name, string ordering_lock,
-	uint64_t max_tok_per_prio, uint64_t min_cost)
+	uint64_t max_tok_per_prio, uint64_t min_cost, double deadline)
 	: sdata_lock(lock_name.c_str()),
 	  sdata_op_ordering_lock(ordering_lock.c_str()),
-	  pqueue(max_tok_per_prio, min_cost) {}
+	  pqueue(max_tok_per_prio, min_cost, deadline) {}
     };
     
     vector<ShardData*> shard_list;
@@ -1624,8 +1741,9 @@ private:
 	  "OSD:ShardedOpWQ:order:", i);
 	ShardData* one_shard = new ShardData(
 	  lock_name, order_lock,
-	  osd->cct->_conf->osd_op_pq_max_tokens_per_priority, 
-	  osd->cct->_conf->osd_op_pq_min_cost);
+	  osd->cct->_conf->osd_op_pq_max_tokens_per_priority,
+	  osd->cct->_conf->osd_op_pq_min_cost,
+	  osd->cct->_conf->osd_op_queue_deadline);
 	shard_list.push_back(one_shard);
       }
     }
@@ -1638,6 +1756,8 @@ private:
     }
 
     void _process(uint32_t thread_index, heartbeat_handle_d *hb);
+    void _process_staged(PGRef pg, ShardData *sdata,
+			 ThreadPool::TPHandle &tp_handle);
     void _enqueue(pair <PGRef, PGQueueable> item);
     void _enqueue_front(pair <PGRef, PGQueueable> item);
       
@@ -1819,7 +1939,8 @@ private:
     epoch_t advance_to, PG *pg,
     ThreadPool::TPHandle &handle,
     PG::RecoveryCtx *rctx,
-    set<boost::intrusive_ptr<PG> > *split_pgs
+    set<boost::intrusive_ptr<PG> > *split_pgs,
+    map<epoch_t, OSDMapRef> *advance_maps ///< [in,out] batch-shared epoch->map cache
   );
   void advance_map();
   void consume_map();
@@ -1905,6 +2026,7 @@ protected:
     PG::CephPeeringEvtRef evt);
   
   void load_pgs();
+  void _load_pg(spg_t pgid, atomic_t *has_upgraded);
   void build_past_intervals_parallel();
 
   void calc_priors_during(
@@ -2288,6 +2410,7 @@ protected:
     case MSG_OSD_EC_READ:
     case MSG_OSD_EC_READ_REPLY:
     case MSG_OSD_REP_SCRUB:
+    case MSG_OSD_NET_PING:
       return true;
     default:
       return false;
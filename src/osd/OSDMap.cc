@@ -415,7 +415,7 @@ void OSDMap::Incremental::encode(bufferlist& bl, uint64_t features) const
   ENCODE_START(8, 7, bl);
 
   {
-    ENCODE_START(3, 1, bl); // client-usable data
+    ENCODE_START(4, 1, bl); // client-usable data
     ::encode(fsid, bl);
     ::encode(epoch, bl);
     ::encode(modified, bl);
@@ -436,6 +436,7 @@ void OSDMap::Incremental::encode(bufferlist& bl, uint64_t features) const
     ::encode(new_primary_affinity, bl);
     ::encode(new_erasure_code_profiles, bl);
     ::encode(old_erasure_code_profiles, bl);
+    ::encode(new_pg_upmap, bl);
     ENCODE_FINISH(bl); // client-usable data
   }
 
@@ -593,7 +594,7 @@ void OSDMap::Incremental::decode(bufferlist::iterator& bl)
     return;
   }
   {
-    DECODE_START(3, bl); // client-usable data
+    DECODE_START(4, bl); // client-usable data
     ::decode(fsid, bl);
     ::decode(epoch, bl);
     ::decode(modified, bl);
@@ -622,6 +623,10 @@ void OSDMap::Incremental::decode(bufferlist::iterator& bl)
       new_erasure_code_profiles.clear();
       old_erasure_code_profiles.clear();
     }
+    if (struct_v >= 4)
+      ::decode(new_pg_upmap, bl);
+    else
+      new_pg_upmap.clear();
     DECODE_FINISH(bl); // client-usable data
   }
 
@@ -785,6 +790,20 @@ void OSDMap::Incremental::dump(Formatter *f) const
   }
   f->close_section(); // primary_temp
 
+  f->open_array_section("new_pg_upmap");
+  for (map<pg_t,vector<int32_t> >::const_iterator p = new_pg_upmap.begin();
+       p != new_pg_upmap.end();
+       ++p) {
+    f->open_object_section("pg");
+    f->dump_stream("pgid") << p->first;
+    f->open_array_section("osds");
+    for (vector<int>::const_iterator q = p->second.begin(); q != p->second.end(); ++q)
+      f->dump_int("osd", *q);
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+
   f->open_array_section("new_up_thru");
   for (map<int32_t,uint32_t>::const_iterator p = new_up_thru.begin(); p != new_up_thru.end(); ++p) {
     f->open_object_section("osd");
@@ -927,6 +946,7 @@ void OSDMap::set_max_osd(int m)
   if (osd_primary_affinity)
     osd_primary_affinity->resize(m, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
 
+  invalidate_mapping_cache();
   calc_num_osds();
 }
 
@@ -1125,7 +1145,10 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   // do addrs match?
   if (o->max_osd != n->max_osd)
     diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+  for (int i = 0;
+       n->osd_addrs != o->osd_addrs &&  // unless already shared
+       i < o->max_osd && i < n->max_osd;
+       i++) {
     if ( n->osd_addrs->client_addr[i] &&  o->osd_addrs->client_addr[i] &&
 	*n->osd_addrs->client_addr[i] == *o->osd_addrs->client_addr[i])
       n->osd_addrs->client_addr[i] = o->osd_addrs->client_addr[i];
@@ -1153,27 +1176,39 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   }
 
   // does crush match?
-  bufferlist oc, nc;
-  ::encode(*o->crush, oc);
-  ::encode(*n->crush, nc);
-  if (oc.contents_equal(nc)) {
-    n->crush = o->crush;
+  if (o->crush != n->crush) {
+    bufferlist oc, nc;
+    ::encode(*o->crush, oc);
+    ::encode(*n->crush, nc);
+    if (oc.contents_equal(nc)) {
+      n->crush = o->crush;
+    }
   }
 
   // does pg_temp match?
-  if (o->pg_temp->size() == n->pg_temp->size()) {
+  if (o->pg_temp != n->pg_temp &&
+      o->pg_temp->size() == n->pg_temp->size()) {
     if (*o->pg_temp == *n->pg_temp)
       n->pg_temp = o->pg_temp;
   }
 
   // does primary_temp match?
-  if (o->primary_temp->size() == n->primary_temp->size()) {
+  if (o->primary_temp != n->primary_temp &&
+      o->primary_temp->size() == n->primary_temp->size()) {
     if (*o->primary_temp == *n->primary_temp)
       n->primary_temp = o->primary_temp;
   }
 
+  // does pg_upmap match?
+  if (o->pg_upmap != n->pg_upmap &&
+      o->pg_upmap->size() == n->pg_upmap->size()) {
+    if (*o->pg_upmap == *n->pg_upmap)
+      n->pg_upmap = o->pg_upmap;
+  }
+
   // do uuids match?
-  if (o->osd_uuid->size() == n->osd_uuid->size() &&
+  if (o->osd_uuid != n->osd_uuid &&
+      o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
 }
@@ -1205,6 +1240,15 @@ void OSDMap::remove_redundant_temporaries(CephContext *cct, const OSDMap& osdmap
       }
     }
   }
+  for (map<pg_t,vector<int32_t> >::iterator p = osdmap.pg_upmap->begin();
+       p != osdmap.pg_upmap->end();
+       ++p) {
+    if (!osdmap.have_pg_pool(p->first.pool())) {
+      ldout(cct, 10) << " removing pg_upmap " << p->first
+		     << " for inexistent pool " << p->first.pool() << dendl;
+      pending_inc->new_pg_upmap[p->first].clear();
+    }
+  }
   if (!osdmap.primary_temp->empty()) {
     OSDMap templess;
     templess.deepish_copy_from(osdmap);
@@ -1256,6 +1300,31 @@ void OSDMap::remove_down_temps(CephContext *cct,
   }
 }
 
+void OSDMap::_dup_shared_substructures(const Incremental& inc)
+{
+  // if our shared_ptr sub-structures are shared with another (immutable)
+  // map -- see lazy_copy_from() -- clone the ones this incremental will
+  // mutate in place, and only those.
+  bool full = inc.fullmap.length() > 0;
+  if (!osd_addrs.unique() &&
+      (full || inc.new_max_osd >= 0 ||
+       !inc.new_up_client.empty() || !inc.new_up_cluster.empty()))
+    osd_addrs.reset(new addrs_s(*osd_addrs));
+  if (!pg_temp.unique() && (full || !inc.new_pg_temp.empty()))
+    pg_temp.reset(new map<pg_t,vector<int32_t> >(*pg_temp));
+  if (!primary_temp.unique() && (full || !inc.new_primary_temp.empty()))
+    primary_temp.reset(new map<pg_t,int32_t>(*primary_temp));
+  if (!pg_upmap.unique() && (full || !inc.new_pg_upmap.empty()))
+    pg_upmap.reset(new map<pg_t,vector<int32_t> >(*pg_upmap));
+  if (!osd_uuid.unique() &&
+      (full || inc.new_max_osd >= 0 ||
+       !inc.new_state.empty() || !inc.new_uuid.empty()))
+    osd_uuid.reset(new vector<uuid_d>(*osd_uuid));
+  if (osd_primary_affinity && !osd_primary_affinity.unique() &&
+      (full || inc.new_max_osd >= 0 || !inc.new_primary_affinity.empty()))
+    osd_primary_affinity.reset(new vector<__u32>(*osd_primary_affinity));
+}
+
 int OSDMap::apply_incremental(const Incremental &inc)
 {
   new_blacklist_entries = false;
@@ -1263,9 +1332,12 @@ int OSDMap::apply_incremental(const Incremental &inc)
     fsid = inc.fsid;
   else if (inc.fsid != fsid)
     return -EINVAL;
-  
+
   assert(inc.epoch == epoch+1);
 
+  _dup_shared_substructures(inc);
+  invalidate_mapping_cache();
+
   epoch++;
   modified = inc.modified;
 
@@ -1417,6 +1489,16 @@ int OSDMap::apply_incremental(const Incremental &inc)
       (*primary_temp)[p->first] = p->second;
   }
 
+  // mapping exceptions
+  for (map<pg_t,vector<int32_t> >::const_iterator p = inc.new_pg_upmap.begin();
+       p != inc.new_pg_upmap.end();
+       ++p) {
+    if (p->second.empty())
+      pg_upmap->erase(p->first);
+    else
+      (*pg_upmap)[p->first] = p->second;
+  }
+
   // blacklist
   for (map<entity_addr_t,utime_t>::const_iterator p = inc.new_blacklist.begin();
        p != inc.new_blacklist.end();
@@ -1518,10 +1600,37 @@ int OSDMap::_pg_to_osds(const pg_pool_t& pool, pg_t pg,
   ps_t pps = pool.raw_pg_to_pps(pg);  // placement ps
   unsigned size = pool.get_size();
 
-  // what crush rule?
-  int ruleno = crush->find_rule(pool.get_crush_ruleset(), pool.get_type(), size);
-  if (ruleno >= 0)
-    crush->do_rule(ruleno, pps, *osds, size, osd_weight);
+  // did we map this pg already on this map?
+  MappingCache::Shard& cache =
+    mapping_cache->shard[pg.ps() % MAPPING_CACHE_SHARDS];
+  bool cached = false;
+  {
+    Spinlock::Locker l(cache.lock);
+    ceph::unordered_map<pg_t,vector<int> >::iterator p = cache.raw.find(pg);
+    if (p != cache.raw.end()) {
+      *osds = p->second;
+      cached = true;
+    }
+  }
+  if (!cached) {
+    // what crush rule?
+    int ruleno = crush->find_rule(pool.get_crush_ruleset(), pool.get_type(), size);
+    if (ruleno >= 0)
+      crush->do_rule(ruleno, pps, *osds, size, osd_weight);
+
+    Spinlock::Locker l(cache.lock);
+    cache.raw[pg] = *osds;
+  }
+
+  // explicit mapping exception?  note that this is applied after the
+  // raw crush mapping (and its cache), so exceptions don't perturb the
+  // cache and cheap exception churn stays cheap.
+  if (!pg_upmap->empty()) {
+    map<pg_t,vector<int32_t> >::const_iterator u =
+      pg_upmap->find(pool.raw_pg_to_pg(pg));
+    if (u != pg_upmap->end())
+      osds->assign(u->second.begin(), u->second.end());
+  }
 
   _remove_nonexistent_osds(pool, *osds);
 
@@ -1888,7 +1997,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
   ENCODE_START(8, 7, bl);
 
   {
-    ENCODE_START(3, 1, bl); // client-usable data
+    ENCODE_START(4, 1, bl); // client-usable data
     // base
     ::encode(fsid, bl);
     ::encode(epoch, bl);
@@ -1920,6 +2029,7 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     crush->encode(cbl);
     ::encode(cbl, bl);
     ::encode(erasure_code_profiles, bl);
+    ::encode(*pg_upmap, bl);
     ENCODE_FINISH(bl); // client-usable data
   }
 
@@ -1977,6 +2087,9 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
 {
   __u32 n, t;
   __u16 v;
+
+  invalidate_mapping_cache();
+
   ::decode(v, p);
 
   // base
@@ -2080,6 +2193,7 @@ void OSDMap::decode_classic(bufferlist::iterator& p)
     osd_addrs->hb_front_addr.resize(osd_addrs->hb_back_addr.size());
 
   osd_primary_affinity.reset();
+  pg_upmap->clear();
 
   post_decode();
 }
@@ -2097,6 +2211,8 @@ void OSDMap::decode(bufferlist::iterator& bl)
   size_t tail_offset = 0;
   bufferlist crc_front, crc_tail;
 
+  invalidate_mapping_cache();
+
   DECODE_START_LEGACY_COMPAT_LEN(8, 7, 7, bl); // wrapper
   if (struct_v < 7) {
     int struct_v_size = sizeof(struct_v);
@@ -2108,7 +2224,7 @@ void OSDMap::decode(bufferlist::iterator& bl)
    * Since we made it past that hurdle, we can use our normal paths.
    */
   {
-    DECODE_START(3, bl); // client-usable data
+    DECODE_START(4, bl); // client-usable data
     // base
     ::decode(fsid, bl);
     ::decode(epoch, bl);
@@ -2147,6 +2263,10 @@ void OSDMap::decode(bufferlist::iterator& bl)
     } else {
       erasure_code_profiles.clear();
     }
+    if (struct_v >= 4)
+      ::decode(*pg_upmap, bl);
+    else
+      pg_upmap->clear();
     DECODE_FINISH(bl); // client-usable data
   }
 
@@ -2312,6 +2432,20 @@ void OSDMap::dump(Formatter *f) const
   }
   f->close_section(); // primary_temp
 
+  f->open_array_section("pg_upmap");
+  for (map<pg_t,vector<int32_t> >::const_iterator p = pg_upmap->begin();
+       p != pg_upmap->end();
+       ++p) {
+    f->open_object_section("osds");
+    f->dump_stream("pgid") << p->first;
+    f->open_array_section("osds");
+    for (vector<int>::const_iterator q = p->second.begin(); q != p->second.end(); ++q)
+      f->dump_int("osd", *q);
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+
   f->open_object_section("blacklist");
   for (ceph::unordered_map<entity_addr_t,utime_t>::const_iterator p = blacklist.begin();
        p != blacklist.end();
@@ -2458,6 +2592,11 @@ void OSDMap::print(ostream& out) const
       ++p)
     out << "primary_temp " << p->first << " " << p->second << "\n";
 
+  for (map<pg_t,vector<int32_t> >::const_iterator p = pg_upmap->begin();
+       p != pg_upmap->end();
+       ++p)
+    out << "pg_upmap " << p->first << " " << p->second << "\n";
+
   for (ceph::unordered_map<entity_addr_t,utime_t>::const_iterator p = blacklist.begin();
        p != blacklist.end();
        ++p)
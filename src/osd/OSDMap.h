@@ -30,6 +30,7 @@
 #include "msg/Message.h"
 #include "common/Mutex.h"
 #include "common/Clock.h"
+#include "include/Spinlock.h"
 
 #include "include/ceph_features.h"
 
@@ -142,6 +143,7 @@ public:
     map<pg_t,vector<int32_t> > new_pg_temp;     // [] to remove
     map<pg_t, int32_t> new_primary_temp;            // [-1] to remove
     map<int32_t,uint32_t> new_primary_affinity;
+    map<pg_t,vector<int32_t> > new_pg_upmap;    // [] to remove
     map<int32_t,epoch_t> new_up_thru;
     map<int32_t,pair<epoch_t,epoch_t> > new_last_clean_interval;
     map<int32_t,epoch_t> new_lost;
@@ -231,6 +233,11 @@ private:
   ceph::shared_ptr< map<pg_t,int32_t > > primary_temp;  // temp primary mapping (e.g. while we rebuild)
   ceph::shared_ptr< vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
+  // explicit, persistent per-pg mapping exceptions, consulted after
+  // crush; set by an administrator or external balancer to fix the
+  // imbalances that reweighting cannot
+  ceph::shared_ptr< map<pg_t,vector<int32_t> > > pg_upmap;
+
   map<int64_t,pg_pool_t> pools;
   map<int64_t,string> pool_name;
   map<string,map<string,string> > erasure_code_profiles;
@@ -250,12 +257,35 @@ private:
   mutable bool crc_defined;
   mutable uint32_t crc;
 
+  /*
+   * Cache of raw crush placements, so repeated mapping calls for the
+   * same pg against the same (immutable once published) map are a hash
+   * lookup instead of a crush_do_rule() walk.  The cache is shared
+   * across copies of the map; mutators must detach it with
+   * invalidate_mapping_cache() rather than clear it in place, or they
+   * would corrupt the copy they were forked from.
+   */
+  static const unsigned MAPPING_CACHE_SHARDS = 16;
+  struct MappingCache {
+    struct Shard {
+      Spinlock lock;
+      ceph::unordered_map<pg_t, vector<int> > raw;
+    } shard[MAPPING_CACHE_SHARDS];
+  };
+  mutable ceph::shared_ptr<MappingCache> mapping_cache;
+
   void _calc_up_osd_features();
+  void _dup_shared_substructures(const Incremental& inc);
 
  public:
   bool have_crc() const { return crc_defined; }
   uint32_t get_crc() const { return crc; }
 
+  /// detach the crush placement cache; see MappingCache above
+  void invalidate_mapping_cache() {
+    mapping_cache.reset(new MappingCache);
+  }
+
   ceph::shared_ptr<CrushWrapper> crush;       // hierarchical map
 
   friend class OSDMonitor;
@@ -269,11 +299,13 @@ private:
 	     osd_addrs(new addrs_s),
 	     pg_temp(new map<pg_t,vector<int32_t> >),
 	     primary_temp(new map<pg_t,int32_t>),
+	     pg_upmap(new map<pg_t,vector<int32_t> >),
 	     osd_uuid(new vector<uuid_d>),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
 	     cached_up_osd_features(0),
 	     crc_defined(false), crc(0),
+	     mapping_cache(new MappingCache),
 	     crush(new CrushWrapper) {
     memset(&fsid, 0, sizeof(fsid));
   }
@@ -290,6 +322,7 @@ public:
     *this = o;
     primary_temp.reset(new map<pg_t,int32_t>(*o.primary_temp));
     pg_temp.reset(new map<pg_t,vector<int32_t> >(*o.pg_temp));
+    pg_upmap.reset(new map<pg_t,vector<int32_t> >(*o.pg_upmap));
     osd_uuid.reset(new vector<uuid_d>(*o.osd_uuid));
 
     // NOTE: this still references shared entity_addr_t's.
@@ -299,6 +332,19 @@ public:
     // allocate a new CrushWrapper, though.
   }
 
+  /**
+   * shallow copy that shares the large sub-structures with the source
+   *
+   * The source must remain immutable for as long as this map is alive
+   * (e.g., a map sitting in the OSDService map cache).  Only
+   * apply_incremental() may be used to mutate the result: it will clone
+   * any shared sub-structure before touching it, so applying a delta
+   * costs work proportional to the delta, not to the map size.
+   */
+  void lazy_copy_from(const OSDMap& o) {
+    *this = o;
+  }
+
   // map info
   const uuid_d& get_fsid() const { return fsid; }
   void set_fsid(uuid_d& f) { fsid = f; }
@@ -338,6 +384,12 @@ public:
   unsigned get_num_pg_temp() const {
     return pg_temp->size();
   }
+  unsigned get_num_pg_upmap() const {
+    return pg_upmap->size();
+  }
+  bool have_pg_upmap(pg_t pg) const {
+    return pg_upmap->count(pg);
+  }
 
   int get_flags() const { return flags; }
   bool test_flag(int f) const { return flags & f; }
@@ -368,6 +420,7 @@ public:
     osd_weight[o] = w;
     if (w)
       osd_state[o] |= CEPH_OSD_EXISTS;
+    invalidate_mapping_cache();
   }
   unsigned get_weight(int o) const {
     assert(o < max_osd);
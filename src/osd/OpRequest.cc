@@ -11,6 +11,7 @@
 #include "messages/MOSDSubOp.h"
 #include "messages/MOSDRepOp.h"
 #include "include/assert.h"
+#include "include/Spinlock.h"
 #include "osd/osd_types.h"
 
 #ifdef WITH_LTTNG
@@ -19,6 +20,47 @@
 #define tracepoint(...)
 #endif
 
+// recycled OpRequest slots; freed objects are threaded into a singly
+// linked list through their first word, so the pool itself never
+// allocates.
+#define OPREQUEST_POOL_MAX 1024
+
+static Spinlock op_pool_lock;
+static void *op_pool_head = NULL;
+static unsigned op_pool_size = 0;
+
+void *OpRequest::operator new(size_t size)
+{
+  if (size != sizeof(OpRequest))   // a derived class; not poolable
+    return ::operator new(size);
+  op_pool_lock.lock();
+  if (op_pool_head) {
+    void *p = op_pool_head;
+    op_pool_head = *reinterpret_cast<void**>(p);
+    --op_pool_size;
+    op_pool_lock.unlock();
+    return p;
+  }
+  op_pool_lock.unlock();
+  return ::operator new(size);
+}
+
+void OpRequest::operator delete(void *ptr)
+{
+  if (!ptr)
+    return;
+  op_pool_lock.lock();
+  if (op_pool_size < OPREQUEST_POOL_MAX) {
+    *reinterpret_cast<void**>(ptr) = op_pool_head;
+    op_pool_head = ptr;
+    ++op_pool_size;
+    op_pool_lock.unlock();
+    return;
+  }
+  op_pool_lock.unlock();
+  ::operator delete(ptr);
+}
+
 OpRequest::OpRequest(Message *req, OpTracker *tracker) :
   TrackedOp(tracker, req->get_recv_stamp()),
   rmw_flags(0), request(req),
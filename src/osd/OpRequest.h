@@ -84,6 +84,12 @@ struct OpRequest : public TrackedOp {
     return request->get_connection()->has_feature(f);
   }
 
+  // OpRequests are allocated and freed at very high rates on the op
+  // path; recycle raw slots through a bounded freelist instead of
+  // hitting the heap for every client op.
+  void *operator new(size_t size);
+  void operator delete(void *ptr);
+
 private:
   Message *request; /// the logical request we are tracking
   osd_reqid_t reqid;
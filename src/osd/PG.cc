@@ -195,6 +195,8 @@ PG::PG(OSDService *o, OSDMapRef curmap,
   missing_loc(this),
   recovery_item(this), stat_queue_item(this),
   snap_trim_queued(false),
+  snap_trim_retry_scheduled(false),
+  qos_retry_scheduled(false),
   scrub_queued(false),
   recovery_ops_active(0),
   role(0),
@@ -2554,6 +2556,7 @@ void PG::publish_stats_to_osd()
     pg_stats_publish_valid = true;
     pg_stats_publish = info.stats;
     pg_stats_publish.stats.add(unstable_stats);
+    pg_stats_publish_enc.clear();  // re-encoded lazily on next report
 
     dout(15) << "publish_stats_to_osd " << pg_stats_publish.reported_epoch
 	     << ":" << pg_stats_publish.reported_seq << dendl;
@@ -3376,6 +3379,34 @@ void PG::schedule_backfill_full_retry()
       RequestBackfill()));
 }
 
+void PG::schedule_snap_trim_retry(double delay)
+{
+  assert(is_locked());
+  if (snap_trim_retry_scheduled) {
+    dout(10) << __func__ << " -- already scheduled" << dendl;
+    return;
+  }
+  dout(10) << __func__ << " in " << delay << "s" << dendl;
+  snap_trim_retry_scheduled = true;
+  Mutex::Locker lock(osd->snap_trim_request_lock);
+  osd->snap_trim_request_timer.add_event_after(
+    delay, new QueueSnapTrimRetry(this));
+}
+
+void PG::schedule_qos_retry(double delay)
+{
+  assert(is_locked());
+  if (qos_retry_scheduled) {
+    dout(20) << __func__ << " -- already scheduled" << dendl;
+    return;
+  }
+  dout(20) << __func__ << " in " << delay << "s" << dendl;
+  qos_retry_scheduled = true;
+  Mutex::Locker lock(osd->qos_retry_lock);
+  osd->qos_retry_timer.add_event_after(
+    delay, new QueueQoSRetry(this));
+}
+
 void PG::clear_scrub_reserved()
 {
   scrubber.reserved_peers.clear();
@@ -3530,8 +3561,14 @@ void PG::_scan_snaps(ScrubMap &smap)
 }
 
 /*
- * build a scrub map over a chunk without releasing the lock
+ * build a scrub map over a chunk
  * only used by chunky scrub
+ *
+ * The object hashing is pure ObjectStore I/O, so we drop the PG lock
+ * between batches of osd_scrub_yield_batch objects to let client ops
+ * interleave.  Writes to the chunk itself are already blocked by the
+ * scrubber range.  Returns -EAGAIN if the interval changed while the
+ * lock was dropped; the caller must not touch scrub state in that case.
  */
 int PG::build_scrub_map_chunk(
   ScrubMap &map,
@@ -3558,7 +3595,26 @@ int PG::build_scrub_map_chunk(
   }
 
 
-  get_pgbackend()->be_scan_list(map, ls, deep, seed, handle);
+  unsigned batch = cct->_conf->osd_scrub_yield_batch;
+  if (batch == 0 || ls.size() <= batch) {
+    get_pgbackend()->be_scan_list(map, ls, deep, seed, handle);
+  } else {
+    epoch_t reset_epoch = last_peering_reset;
+    vector<hobject_t>::iterator p = ls.begin();
+    while (p != ls.end()) {
+      vector<hobject_t> chunk;
+      while (p != ls.end() && chunk.size() < batch)
+	chunk.push_back(*p++);
+      unlock();
+      get_pgbackend()->be_scan_list(map, chunk, deep, seed, handle);
+      lock();
+      if (last_peering_reset != reset_epoch || deleting) {
+	dout(10) << __func__ << " interval changed while lock was dropped, "
+		 << "aborting" << dendl;
+	return -EAGAIN;
+      }
+    }
+  }
   _scan_rollback_obs(rollback_obs, handle);
   _scan_snaps(map);
 
@@ -3638,9 +3694,14 @@ void PG::replica_scrub(
     return;
   }
 
-  build_scrub_map_chunk(
-    map, msg->start, msg->end, msg->deep, msg->seed,
-    handle);
+  if (build_scrub_map_chunk(
+	map, msg->start, msg->end, msg->deep, msg->seed,
+	handle) == -EAGAIN) {
+    // interval changed while the lock was dropped; the primary will
+    // restart the scrub in the new interval
+    dout(10) << "replica_scrub interval changed mid-chunk, bailing" << dendl;
+    return;
+  }
 
   vector<OSDOp> scrub(1);
   scrub[0].op.op = CEPH_OSD_OP_SCRUB_MAP;
@@ -3687,6 +3748,13 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
   assert(scrub_queued);
   scrub_queued = false;
 
+  if (scrubber.building_map) {
+    // a chunk scan is in flight with the pg lock dropped; that thread
+    // will drive the state machine forward when it finishes
+    dout(10) << "scrub -- chunk scan in progress, deferring" << dendl;
+    return;
+  }
+
   if (!is_primary() || !is_active() || !is_clean() || !is_scrubbing()) {
     dout(10) << "scrub -- not primary or active or not clean" << dendl;
     state_clear(PG_STATE_SCRUBBING);
@@ -3947,10 +4015,18 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         assert(last_update_applied >= scrubber.subset_last_update);
 
         // build my own scrub map
+        scrubber.building_map = true;
         ret = build_scrub_map_chunk(scrubber.primary_scrubmap,
                                     scrubber.start, scrubber.end,
                                     scrubber.deep, scrubber.seed,
 				    handle);
+        scrubber.building_map = false;
+        if (ret == -EAGAIN) {
+          // interval changed while the lock was dropped; on_change has
+          // already cleared the scrub state, so just bail out
+          dout(10) << "scrub interval changed mid-chunk, bailing" << dendl;
+          return;
+        }
         if (ret < 0) {
           dout(5) << "error building scrub map: " << ret << ", aborting" << dendl;
           scrub_clear_state();
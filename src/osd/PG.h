@@ -238,7 +238,15 @@ protected:
    * get() should be called on pointer copy (to another thread, etc.).
    * put() should be called on destruction of some previously copied pointer.
    * put_unlock() when done with the current pointer (_most common_).
-   */  
+   *
+   * note: this is deliberately a plain mutex with no shared (reader)
+   * mode.  client reads mutate state guarded only by the exclusive PG
+   * lock -- ObjectContext::RWState and its waiter lists, object and pg
+   * stats -- and the shard queues assume a single dequeuer per PG for
+   * per-client op ordering, so a read-side fast path under a shared
+   * lock is not sound without first making all of that independently
+   * thread safe.
+   */
   mutable Mutex _lock;
   atomic_t ref;
 
@@ -437,6 +445,8 @@ public:
    * (if they have one) */
   xlist<PG*>::item recovery_item, stat_queue_item;
   bool snap_trim_queued;
+  bool snap_trim_retry_scheduled;
+  bool qos_retry_scheduled;
   bool scrub_queued;
 
   int recovery_ops_active;
@@ -759,6 +769,7 @@ protected:
   list<OpRequestRef>            waiting_for_active;
 
   list<OpRequestRef>            waiting_for_cache_not_full;
+  list<OpRequestRef>            waiting_for_qos;
   list<OpRequestRef>            waiting_for_all_missing;
   map<hobject_t, list<OpRequestRef>, hobject_t::BitwiseComparator> waiting_for_unreadable_object,
 			     waiting_for_degraded_object,
@@ -793,6 +804,7 @@ protected:
   Mutex pg_stats_publish_lock;
   bool pg_stats_publish_valid;
   pg_stat_t pg_stats_publish;
+  bufferlist pg_stats_publish_enc; ///< cached encoding; empty = stale
 
   // for ordering writes
   ceph::shared_ptr<ObjectStore::Sequencer> osr;
@@ -1065,6 +1077,7 @@ public:
       reserved(false), reserve_failed(false),
       epoch_start(0),
       active(false), queue_snap_trim(false),
+      building_map(false),
       waiting_on(0), shallow_errors(0), deep_errors(0), fixed(0),
       must_scrub(false), must_deep_scrub(false), must_repair(false),
       num_digest_updates_pending(0),
@@ -1082,6 +1095,11 @@ public:
     // common to both scrubs
     bool active;
     bool queue_snap_trim;
+    // true while a BUILD_MAP chunk scan is in flight; the scan drops the
+    // pg lock between batches, so no other thread may enter the state
+    // machine until the scanning thread clears this.  Deliberately not
+    // cleared by reset() -- only the scanning thread may clear it.
+    bool building_map;
     int waiting_on;
     set<pg_shard_t> waiting_on_whom;
     int shallow_errors;
@@ -1270,6 +1288,34 @@ public:
   void reject_reservation();
   void schedule_backfill_full_retry();
 
+  /// requeue snap trim once the per-tick trim budget refills
+  void schedule_snap_trim_retry(double delay);
+  struct QueueSnapTrimRetry : Context {
+    PGRef pg;
+    explicit QueueSnapTrimRetry(PG *pg) : pg(pg) {}
+    void finish(int r) {
+      pg->lock();
+      pg->snap_trim_retry_scheduled = false;
+      if (!pg->deleting)
+	pg->queue_snap_trim();
+      pg->unlock();
+    }
+  };
+
+  /// requeue ops parked for pool QoS once the token bucket refills
+  void schedule_qos_retry(double delay);
+  struct QueueQoSRetry : Context {
+    PGRef pg;
+    explicit QueueQoSRetry(PG *pg) : pg(pg) {}
+    void finish(int r) {
+      pg->lock();
+      pg->qos_retry_scheduled = false;
+      if (!pg->deleting)
+	pg->requeue_ops(pg->waiting_for_qos);
+      pg->unlock();
+    }
+  };
+
   // -- recovery state --
 
   template <class EVT>
@@ -2287,6 +2333,11 @@ public:
     ThreadPool::TPHandle &handle
   ) = 0;
 
+  /// hint that op was queued; called *without* the PG lock, so
+  /// implementations may only touch internally-locked structures
+  virtual void maybe_prefetch_obc(OpRequestRef& op) {}
+
+
   virtual void do_op(OpRequestRef& op) = 0;
   virtual void do_sub_op(OpRequestRef op) = 0;
   virtual void do_sub_op_reply(OpRequestRef op) = 0;
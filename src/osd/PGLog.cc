@@ -51,7 +51,8 @@ void PGLog::IndexedLog::filter_log(spg_t pgid, const OSDMap &map, const string &
   pg_log_t::filter_log(pgid, map, hit_set_namespace, *this, out, reject);
 
   *this = out;
-  index();
+  invalidate_index();
+  reset_rollback_info_trimmed_to_riter();
 }
 
 void PGLog::IndexedLog::split_into(
@@ -80,8 +81,10 @@ void PGLog::IndexedLog::split_into(
 
   olog->can_rollback_to = can_rollback_to;
 
-  olog->index();
-  index();
+  olog->invalidate_index();
+  olog->reset_rollback_info_trimmed_to_riter();
+  invalidate_index();
+  reset_rollback_info_trimmed_to_riter();
 }
 
 void PGLog::IndexedLog::trim(
@@ -374,20 +377,19 @@ void PGLog::_merge_object_divergent_entries(
 	   << " last_divergent_update: " << last_divergent_update
 	   << dendl;
 
-  ceph::unordered_map<hobject_t, pg_log_entry_t*>::const_iterator objiter =
-    log.objects.find(hoid);
-  if (objiter != log.objects.end() &&
-      objiter->second->version >= first_divergent_update) {
+  pg_log_entry_t *objent = log.get_object_entry(hoid);
+  if (objent &&
+      objent->version >= first_divergent_update) {
     /// Case 1)
-    assert(objiter->second->version > last_divergent_update);
+    assert(objent->version > last_divergent_update);
 
     dout(10) << __func__ << ": more recent entry found: "
-	     << *objiter->second << ", already merged" << dendl;
+	     << *objent << ", already merged" << dendl;
 
     // ensure missing has been updated appropriately
-    if (objiter->second->is_update()) {
+    if (objent->is_update()) {
       assert(missing.is_missing(hoid) &&
-	     missing.missing[hoid].need == objiter->second->version);
+	     missing.missing[hoid].need == objent->version);
     } else {
       assert(!missing.is_missing(hoid));
     }
@@ -524,7 +526,8 @@ void PGLog::rewind_divergent_log(ObjectStore::Transaction& t, eversion_t newhead
   if (info.last_complete > newhead)
     info.last_complete = newhead;
 
-  log.index();
+  log.invalidate_index();
+  log.reset_rollback_info_trimmed_to_riter();
 
   map<eversion_t, hobject_t> new_priors;
   _merge_divergent_entries(
@@ -670,9 +673,10 @@ void PGLog::merge_log(ObjectStore::Transaction& t,
     }
 
     // splice
-    log.log.splice(log.log.end(), 
+    log.log.splice(log.log.end(),
 		   olog.log, from, to);
-    log.index();   
+    log.invalidate_index();
+    log.reset_rollback_info_trimmed_to_riter();
 
     info.last_update = log.head = olog.head;
 
@@ -921,7 +925,8 @@ void PGLog::read_log(ObjectStore *store, coll_t pg_coll,
     }
   }
   log.head = info.last_update;
-  log.index();
+  log.invalidate_index();
+  log.reset_rollback_info_trimmed_to_riter();
 
   // build missing
   if (info.last_complete < info.last_update) {
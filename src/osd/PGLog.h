@@ -53,11 +53,24 @@ struct PGLog {
   /**
    * IndexLog - adds in-memory index of the log, by oid.
    * plus some methods to manipulate it all.
+   *
+   * The indices are materialized lazily: bulk log rewrites (claim,
+   * split, filter, read_log) only invalidate them, and each map is
+   * rebuilt from the log on first lookup.  indexed_data tracks which
+   * maps are current; the per-entry index/unindex helpers only touch
+   * maps that are.
    */
   struct IndexedLog : public pg_log_t {
-    ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
-    ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+    static const __u16 INDEXED_OBJECTS = 1 << 0;
+    static const __u16 INDEXED_CALLER_OPS = 1 << 1;
+    static const __u16 INDEXED_EXTRA_CALLER_OPS = 1 << 2;
+    static const __u16 INDEXED_ALL =
+      INDEXED_OBJECTS | INDEXED_CALLER_OPS | INDEXED_EXTRA_CALLER_OPS;
+
+    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
+    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
+    mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
+    mutable __u16 indexed_data;
 
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to;  // not inclusive of referenced item
@@ -73,11 +86,59 @@ struct PGLog {
      * tail, and rbegin() works nicely for head.
      */
     list<pg_log_entry_t>::reverse_iterator rollback_info_trimmed_to_riter;
+
+    // materialize one index map from the log.  const because lookups on
+    // a logically-const log may trigger a rebuild.
+    void index_objects() const {
+      objects.clear();
+      for (list<pg_log_entry_t>::const_iterator i = log.begin();
+	   i != log.end();
+	   ++i) {
+	objects[i->soid] = const_cast<pg_log_entry_t*>(&(*i));
+      }
+      indexed_data |= INDEXED_OBJECTS;
+    }
+    void index_caller_ops() const {
+      caller_ops.clear();
+      for (list<pg_log_entry_t>::const_iterator i = log.begin();
+	   i != log.end();
+	   ++i) {
+	if (i->reqid_is_indexed()) {
+	  //assert(caller_ops.count(i->reqid) == 0);  // divergent merge_log indexes new before unindexing old
+	  caller_ops[i->reqid] = const_cast<pg_log_entry_t*>(&(*i));
+	}
+      }
+      indexed_data |= INDEXED_CALLER_OPS;
+    }
+    void index_extra_caller_ops() const {
+      extra_caller_ops.clear();
+      for (list<pg_log_entry_t>::const_iterator i = log.begin();
+	   i != log.end();
+	   ++i) {
+	for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
+	       i->extra_reqids.begin();
+	     j != i->extra_reqids.end();
+	     ++j) {
+	  extra_caller_ops.insert(
+	    make_pair(j->first, const_cast<pg_log_entry_t*>(&(*i))));
+	}
+      }
+      indexed_data |= INDEXED_EXTRA_CALLER_OPS;
+    }
+
   public:
+    void reset_rollback_info_trimmed_to_riter() {
+      rollback_info_trimmed_to_riter = log.rbegin();
+      while (rollback_info_trimmed_to_riter != log.rend() &&
+	     rollback_info_trimmed_to_riter->version > rollback_info_trimmed_to)
+	++rollback_info_trimmed_to_riter;
+    }
+
     void advance_rollback_info_trimmed_to(eversion_t to, LogEntryHandler *h);
 
     /****/
     IndexedLog() :
+      indexed_data(0),
       complete_to(log.end()),
       last_requested(0),
       rollback_info_trimmed_to_riter(log.rbegin())
@@ -92,7 +153,8 @@ struct PGLog {
       head = o.head;
       rollback_info_trimmed_to = head;
       tail = o.tail;
-      index();
+      invalidate_index();
+      reset_rollback_info_trimmed_to_riter();
     }
 
     void split_into(
@@ -121,10 +183,28 @@ struct PGLog {
     }
 
     bool logged_object(const hobject_t& oid) const {
+      if (!(indexed_data & INDEXED_OBJECTS))
+	index_objects();
       return objects.count(oid);
     }
+    /// return the log entry the object index maps oid to, or NULL
+    pg_log_entry_t *get_object_entry(const hobject_t& oid) const {
+      if (!(indexed_data & INDEXED_OBJECTS))
+	index_objects();
+      ceph::unordered_map<hobject_t,pg_log_entry_t*>::const_iterator p =
+	objects.find(oid);
+      if (p == objects.end())
+	return NULL;
+      return p->second;
+    }
     bool logged_req(const osd_reqid_t &r) const {
-      return caller_ops.count(r) || extra_caller_ops.count(r);
+      if (!(indexed_data & INDEXED_CALLER_OPS))
+	index_caller_ops();
+      if (caller_ops.count(r))
+	return true;
+      if (!(indexed_data & INDEXED_EXTRA_CALLER_OPS))
+	index_extra_caller_ops();
+      return extra_caller_ops.count(r);
     }
     bool get_request(
       const osd_reqid_t &r,
@@ -132,6 +212,8 @@ struct PGLog {
       version_t *user_version) const {
       assert(replay_version);
       assert(user_version);
+      if (!(indexed_data & INDEXED_CALLER_OPS))
+	index_caller_ops();
       ceph::unordered_map<osd_reqid_t,pg_log_entry_t*>::const_iterator p;
       p = caller_ops.find(r);
       if (p != caller_ops.end()) {
@@ -142,6 +224,8 @@ struct PGLog {
 
       // warning: we will return *a* request for this reqid, but not
       // necessarily the most recent.
+      if (!(indexed_data & INDEXED_EXTRA_CALLER_OPS))
+	index_extra_caller_ops();
       p = extra_caller_ops.find(r);
       if (p != extra_caller_ops.end()) {
 	for (vector<pair<osd_reqid_t, version_t> >::const_iterator i =
@@ -164,7 +248,7 @@ struct PGLog {
 			   vector<pair<osd_reqid_t, version_t> > *pls) const {
       // make sure object is present at least once before we do an
       // O(n) search.
-      if (objects.count(oid) == 0)
+      if (!logged_object(oid))
 	return;
       for (list<pg_log_entry_t>::const_reverse_iterator i = log.rbegin();
            i != log.rend();
@@ -183,72 +267,72 @@ struct PGLog {
       }
     }
 
-    void index() {
+    /// eagerly (re)build all index maps; callers that read the maps
+    /// directly must call this first
+    void index() const {
+      index_objects();
+      index_caller_ops();
+      index_extra_caller_ops();
+    }
+
+    /// drop the index maps; they are rebuilt lazily on next lookup
+    void invalidate_index() {
       objects.clear();
       caller_ops.clear();
       extra_caller_ops.clear();
-      for (list<pg_log_entry_t>::iterator i = log.begin();
-           i != log.end();
-           ++i) {
-        objects[i->soid] = &(*i);
-	if (i->reqid_is_indexed()) {
+      indexed_data = 0;
+    }
+
+    void index(pg_log_entry_t& e) {
+      if (indexed_data & INDEXED_OBJECTS) {
+	if (objects.count(e.soid) == 0 ||
+	    objects[e.soid]->version < e.version)
+	  objects[e.soid] = &e;
+      }
+      if (indexed_data & INDEXED_CALLER_OPS) {
+	if (e.reqid_is_indexed()) {
 	  //assert(caller_ops.count(i->reqid) == 0);  // divergent merge_log indexes new before unindexing old
-	  caller_ops[i->reqid] = &(*i);
+	  caller_ops[e.reqid] = &e;
 	}
+      }
+      if (indexed_data & INDEXED_EXTRA_CALLER_OPS) {
 	for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	       i->extra_reqids.begin();
-	     j != i->extra_reqids.end();
+	       e.extra_reqids.begin();
+	     j != e.extra_reqids.end();
 	     ++j) {
-	  extra_caller_ops.insert(make_pair(j->first, &(*i)));
+	  extra_caller_ops.insert(make_pair(j->first, &e));
 	}
       }
-
-      rollback_info_trimmed_to_riter = log.rbegin();
-      while (rollback_info_trimmed_to_riter != log.rend() &&
-	     rollback_info_trimmed_to_riter->version > rollback_info_trimmed_to)
-	++rollback_info_trimmed_to_riter;
-    }
-
-    void index(pg_log_entry_t& e) {
-      if (objects.count(e.soid) == 0 || 
-          objects[e.soid]->version < e.version)
-        objects[e.soid] = &e;
-      if (e.reqid_is_indexed()) {
-	//assert(caller_ops.count(i->reqid) == 0);  // divergent merge_log indexes new before unindexing old
-	caller_ops[e.reqid] = &e;
-      }
-      for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	     e.extra_reqids.begin();
-	   j != e.extra_reqids.end();
-	   ++j) {
-	extra_caller_ops.insert(make_pair(j->first, &e));
-      }
     }
     void unindex() {
-      objects.clear();
-      caller_ops.clear();
-      extra_caller_ops.clear();
+      invalidate_index();
     }
     void unindex(pg_log_entry_t& e) {
       // NOTE: this only works if we remove from the _tail_ of the log!
-      if (objects.count(e.soid) && objects[e.soid]->version == e.version)
-        objects.erase(e.soid);
-      if (e.reqid_is_indexed()) {
-	if (caller_ops.count(e.reqid) &&  // divergent merge_log indexes new before unindexing old
-	    caller_ops[e.reqid] == &e)
-	  caller_ops.erase(e.reqid);
+      if (indexed_data & INDEXED_OBJECTS) {
+	if (objects.count(e.soid) && objects[e.soid]->version == e.version)
+	  objects.erase(e.soid);
       }
-      for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	     e.extra_reqids.begin();
-	   j != e.extra_reqids.end();
-	   ++j) {
-	for (ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*>::iterator k =
-	       extra_caller_ops.find(j->first);
-	     k != extra_caller_ops.end() && k->first == j->first;
-	     ++k) {
-	  if (k->second == &e) {
-	    extra_caller_ops.erase(k);
-	    break;
+      if (indexed_data & INDEXED_CALLER_OPS) {
+	if (e.reqid_is_indexed()) {
+	  if (caller_ops.count(e.reqid) &&  // divergent merge_log indexes new before unindexing old
+	      caller_ops[e.reqid] == &e)
+	    caller_ops.erase(e.reqid);
+	}
+      }
+      if (indexed_data & INDEXED_EXTRA_CALLER_OPS) {
+	for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
+	       e.extra_reqids.begin();
+	     j != e.extra_reqids.end();
+	     ++j) {
+	  for (ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*>::iterator k =
+		 extra_caller_ops.find(j->first);
+	       k != extra_caller_ops.end() && k->first == j->first;
+	       ++k) {
+	    if (k->second == &e) {
+	      extra_caller_ops.erase(k);
+	      break;
+	    }
 	  }
 	}
       }
@@ -273,16 +357,20 @@ struct PGLog {
       assert(head.version == 0 || e.version.version > head.version);
       head = e.version;
 
-      // to our index
-      objects[e.soid] = &(log.back());
-      if (e.reqid_is_indexed()) {
-	caller_ops[e.reqid] = &(log.back());
+      // to our index, for the maps that are materialized
+      if (indexed_data & INDEXED_OBJECTS)
+	objects[e.soid] = &(log.back());
+      if (indexed_data & INDEXED_CALLER_OPS) {
+	if (e.reqid_is_indexed())
+	  caller_ops[e.reqid] = &(log.back());
       }
-      for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
-	     e.extra_reqids.begin();
-	   j != e.extra_reqids.end();
-	   ++j) {
-	extra_caller_ops.insert(make_pair(j->first, &(log.back())));
+      if (indexed_data & INDEXED_EXTRA_CALLER_OPS) {
+	for (vector<pair<osd_reqid_t, version_t> >::const_iterator j =
+	       e.extra_reqids.begin();
+	     j != e.extra_reqids.end();
+	     ++j) {
+	  extra_caller_ops.insert(make_pair(j->first, &(log.back())));
+	}
       }
     }
 
@@ -1477,11 +1477,11 @@ void ReplicatedBackend::prepare_pull(
 	     << " at version " << pmissing.missing.find(soid)->second.have
 	     << " rather than at version " << v << dendl;
     v = pmissing.missing.find(soid)->second.have;
-    assert(get_parent()->get_log().get_log().objects.count(soid) &&
-	   (get_parent()->get_log().get_log().objects.find(soid)->second->op ==
+    assert(get_parent()->get_log().get_log().get_object_entry(soid) &&
+	   (get_parent()->get_log().get_log().get_object_entry(soid)->op ==
 	    pg_log_entry_t::LOST_REVERT) &&
-	   (get_parent()->get_log().get_log().objects.find(
-	     soid)->second->reverting_to ==
+	   (get_parent()->get_log().get_log().get_object_entry(
+	     soid)->reverting_to ==
 	    v));
   }
 
@@ -1522,6 +1522,23 @@ void ReplicatedBackend::prepare_pull(
   op.recovery_progress.data_recovered_to = 0;
   op.recovery_progress.first = true;
 
+  // if we still have a stale copy with a deep-scrub omap digest,
+  // advertise it so the pullee can skip an unchanged omap entirely
+  {
+    bufferlist bv;
+    int gr = store->getattr(coll, ghobject_t(soid), OI_ATTR, bv);
+    if (gr >= 0) {
+      object_info_t stale_oi(bv);
+      if (stale_oi.is_omap_digest()) {
+	op.puller_omap_digest = stale_oi.omap_digest;
+	op.puller_omap_digest_present = true;
+	dout(10) << __func__ << " advertising omap digest 0x"
+		 << std::hex << stale_oi.omap_digest << std::dec
+		 << " of stale local " << soid << dendl;
+      }
+    }
+  }
+
   assert(!pulling.count(soid));
   pull_from_peer[fromshard].insert(soid);
   PullInfo &pi = pulling[soid];
@@ -1684,6 +1701,7 @@ void ReplicatedBackend::submit_push_data(
   bool first,
   bool complete,
   bool cache_dont_need,
+  bool omap_unchanged,
   const interval_set<uint64_t> &intervals_included,
   bufferlist data_included,
   bufferlist omap_header,
@@ -1705,10 +1723,22 @@ void ReplicatedBackend::submit_push_data(
   }
 
   if (first) {
-    t->remove(coll, ghobject_t(target_oid));
-    t->touch(coll, ghobject_t(target_oid));
-    t->truncate(coll, ghobject_t(target_oid), recovery_info.size);
-    t->omap_setheader(coll, ghobject_t(target_oid), omap_header);
+    if (omap_unchanged && target_oid == recovery_info.soid) {
+      // the pushed object's omap matched our stale copy's digest and
+      // was not transferred; rebuild data and attrs in place so the
+      // local omap survives
+      dout(10) << __func__ << ": keeping local omap of "
+	       << target_oid << dendl;
+      t->truncate(coll, ghobject_t(target_oid), 0);
+      t->truncate(coll, ghobject_t(target_oid), recovery_info.size);
+      t->rmattrs(coll, ghobject_t(target_oid));
+      t->omap_setheader(coll, ghobject_t(target_oid), omap_header);
+    } else {
+      t->remove(coll, ghobject_t(target_oid));
+      t->touch(coll, ghobject_t(target_oid));
+      t->truncate(coll, ghobject_t(target_oid), recovery_info.size);
+      t->omap_setheader(coll, ghobject_t(target_oid), omap_header);
+    }
   }
   uint64_t off = 0;
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL;
@@ -1853,6 +1883,7 @@ bool ReplicatedBackend::handle_pull_response(
 
   submit_push_data(pi.recovery_info, first,
 		   complete, pi.cache_dont_need,
+		   pop.omap_unchanged,
 		   data_included, data,
 		   pop.omap_header,
 		   pop.attrset,
@@ -1897,6 +1928,7 @@ void ReplicatedBackend::handle_push(
 		   first,
 		   complete,
 		   true, // must be replicate
+		   false, // replicas never advertise an omap digest
 		   pop.data_included,
 		   data,
 		   pop.omap_header,
@@ -2272,6 +2304,27 @@ void ReplicatedBackend::handle_pull(pg_shard_t peer, PullOp &op, PushOp *reply)
       assert(recovery_info.clone_subset.empty());
     }
 
+    // if the puller advertised a whole-object omap digest matching
+    // ours, the omap is unchanged and need not be transferred.  Only
+    // do this when the data fits in one chunk: the puller keeps its
+    // omap by rebuilding the object in place, which needs the whole
+    // push to be first and complete.
+    if (progress.first && op.puller_omap_digest_present &&
+	(uint64_t)st.st_size <= cct->_conf->osd_recovery_max_chunk) {
+      bufferlist bv;
+      if (store->getattr(coll, ghobject_t(soid), OI_ATTR, bv) >= 0) {
+	object_info_t oi(bv);
+	if (oi.is_omap_digest() &&
+	    oi.omap_digest == op.puller_omap_digest) {
+	  dout(10) << __func__ << " " << soid << " omap digest 0x"
+		   << std::hex << oi.omap_digest << std::dec
+		   << " matches puller's, skipping omap" << dendl;
+	  progress.omap_complete = true;
+	  reply->omap_unchanged = true;
+	}
+      }
+    }
+
     r = build_push_op(recovery_info, progress, 0, reply);
     if (r < 0)
       prep_push_op_blank(soid, reply);
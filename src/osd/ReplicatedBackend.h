@@ -270,6 +270,7 @@ private:
 			bool first,
 			bool complete,
 			bool cache_dont_need,
+			bool omap_unchanged,
 			const interval_set<uint64_t> &intervals_included,
 			bufferlist data_included,
 			bufferlist omap_header,
@@ -24,6 +24,7 @@
 
 #include "common/errno.h"
 #include "common/perf_counters.h"
+#include "compressor/Compressor.h"
 
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
@@ -203,7 +204,7 @@ void ReplicatedPG::on_local_recover(
   if (pg_log.get_missing().is_missing(recovery_info.soid) &&
       pg_log.get_missing().missing.find(recovery_info.soid)->second.need > recovery_info.version) {
     assert(is_primary());
-    const pg_log_entry_t *latest = pg_log.get_log().objects.find(recovery_info.soid)->second;
+    const pg_log_entry_t *latest = pg_log.get_log().get_object_entry(recovery_info.soid);
     if (latest->op == pg_log_entry_t::LOST_REVERT &&
 	latest->reverting_to == recovery_info.version) {
       dout(10) << " got old revert version " << recovery_info.version
@@ -1326,12 +1327,22 @@ ReplicatedPG::ReplicatedPG(OSDService *o, OSDMapRef curmap,
   pending_backfill_updates(hobject_t::Comparator(true)),
   new_backfill(false),
   temp_seq(0),
+  compressor(NULL),
   snap_trimmer_machine(this)
-{ 
+{
   missing_loc.set_backend_predicates(
     pgbackend->get_is_readable_predicate(),
     pgbackend->get_is_recoverable_predicate());
   snap_trimmer_machine.initiate();
+  if (g_conf->osd_pg_object_context_cache_max_count)
+    object_contexts.set_size_bounds(
+      g_conf->osd_pg_object_context_cache_count,
+      g_conf->osd_pg_object_context_cache_max_count);
+}
+
+ReplicatedPG::~ReplicatedPG()
+{
+  delete compressor;
 }
 
 void ReplicatedPG::get_src_oloc(const object_t& oid, const object_locator_t& oloc, object_locator_t& src_oloc)
@@ -1341,6 +1352,30 @@ void ReplicatedPG::get_src_oloc(const object_t& oid, const object_locator_t& olo
     src_oloc.key = oid.name;
 }
 
+void ReplicatedPG::maybe_prefetch_obc(OpRequestRef& op)
+{
+  if (!cct->_conf->osd_obc_prefetch)
+    return;
+  if (op->get_req()->get_type() != CEPH_MSG_OSD_OP)
+    return;
+  // only worth it if the op is going to sit in the queue; someone
+  // holding the PG lock right now is a cheap (racy, but harmless)
+  // proxy for that
+  if (!is_locked())
+    return;
+  MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
+  if (m->get_oid().name.empty())
+    return;
+  hobject_t head(m->get_oid(), m->get_object_locator().key,
+		 CEPH_NOSNAP, m->get_pg().ps(),
+		 info.pgid.pool(), m->get_object_locator().nspace);
+  // we are called without the PG lock; object_contexts has its own
+  // locking, and the prefetch itself only warms caches
+  if (object_contexts.lookup(head))
+    return;
+  osd->queue_obc_prefetch(coll, ghobject_t(head));
+}
+
 void ReplicatedPG::do_request(
   OpRequestRef& op,
   ThreadPool::TPHandle &handle)
@@ -1496,6 +1531,25 @@ void ReplicatedPG::do_op(OpRequestRef& op)
     return;
   }
 
+  // pool over its QoS limit?  park the op and let a timer requeue it
+  // once the token bucket has refilled; the shard worker moves on to
+  // other pgs.  ops behind a parked op queue up behind it here, so
+  // per-client ordering holds, and tokens are only deducted when
+  // pool_qos_delay() admits, so a requeued op is never charged twice.
+  if (pool.info.has_qos()) {
+    double delay = 0;
+    if (!waiting_for_qos.empty() ||
+	(delay = osd->pool_qos_delay(info.pgid.pool(),
+				     m->get_data_len())) > 0) {
+      dout(20) << __func__ << " waiting for pool qos budget" << dendl;
+      waiting_for_qos.push_back(op);
+      op->mark_delayed("waiting for pool qos budget");
+      if (delay > 0)
+	schedule_qos_retry(delay);
+      return;
+    }
+  }
+
   // order this op as a write?
   bool write_ordered =
     op->may_write() ||
@@ -2119,21 +2173,16 @@ bool ReplicatedPG::maybe_promote(ObjectContextRef obc,
 
   switch (recency) {
   case 0:
-    promote_object(obc, missing_oid, oloc, promote_op);
     break;
   case 1:
     // Check if in the current hit set
-    if (in_hit_set) {
-      promote_object(obc, missing_oid, oloc, promote_op);
-    } else {
+    if (!in_hit_set) {
       // not promoting
       return false;
     }
     break;
   default:
-    if (in_hit_set) {
-      promote_object(obc, missing_oid, oloc, promote_op);
-    } else {
+    if (!in_hit_set) {
       // Check if in other hit sets
       map<time_t,HitSetRef>::iterator itor;
       bool in_other_hit_sets = false;
@@ -2150,9 +2199,7 @@ bool ReplicatedPG::maybe_promote(ObjectContextRef obc,
           }
         }
       }
-      if (in_other_hit_sets) {
-        promote_object(obc, missing_oid, oloc, promote_op);
-      } else {
+      if (!in_other_hit_sets) {
 	// not promoting
         return false;
       }
@@ -2160,6 +2207,16 @@ bool ReplicatedPG::maybe_promote(ObjectContextRef obc,
     break;
   }
 
+  // if there is no promote_op the client is already being served by a
+  // proxied read or write, so this promotion is only an optimization
+  // and can wait for budget
+  if (!promote_op && osd->promote_throttle()) {
+    dout(10) << __func__ << " promote throttled for " << missing_oid << dendl;
+    osd->logger->inc(l_osd_tier_promote_throttle);
+    return false;
+  }
+
+  promote_object(obc, missing_oid, oloc, promote_op);
   return true;
 }
 
@@ -2527,6 +2584,7 @@ public:
     ReplicatedPG::CopyResults *results_data = results.get<1>();
     int r = results.get<0>();
     pg->finish_promote(r, results_data, obc);
+    pg->osd->promote_finish(results_data->object_size);
     pg->osd->logger->tinc(l_osd_tier_promote_lat, ceph_clock_now(NULL) - start);
   }
 };
@@ -3799,6 +3857,36 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       assert(src_obc);
     }
 
+    // partial overwrites of a compressed image must rewrite it raw
+    // first; the op below then proceeds as if it had never been
+    // compressed
+    if (obs.exists && !obs.oi.is_whiteout() && obs.oi.is_compressed()) {
+      switch (op.op) {
+      case CEPH_OSD_OP_WRITE:
+      case CEPH_OSD_OP_APPEND:
+      case CEPH_OSD_OP_ZERO:
+      case CEPH_OSD_OP_TRUNCATE:
+      case CEPH_OSD_OP_TRIMTRUNC:
+      case CEPH_OSD_OP_CLONERANGE:
+	result = inflate_object(ctx);
+	break;
+      case CEPH_OSD_OP_TMAPGET:
+      case CEPH_OSD_OP_TMAPPUT:
+      case CEPH_OSD_OP_TMAPUP:
+	// tmap is deprecated; don't teach it about compression
+	result = -EOPNOTSUPP;
+	break;
+      }
+      if (result < 0)
+	goto fail;
+    }
+    if (op.op == CEPH_OSD_OP_CLONERANGE &&
+	src_obc && src_obc->obs.oi.is_compressed()) {
+      // clonerange would copy the compressed bytes verbatim
+      result = -EOPNOTSUPP;
+      goto fail;
+    }
+
     // munge -1 truncate to 0 truncate
     if (ceph_osd_op_uses_extent(op.op) &&
         op.extent.truncate_seq == 1 &&
@@ -3839,6 +3927,19 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	__u32 seq = oi.truncate_seq;
 	uint64_t size = oi.size;
 	tracepoint(osd, do_osd_op_pre_read, soid.oid.name.c_str(), soid.snap.val, size, seq, op.extent.offset, op.extent.length, op.extent.truncate_size, op.extent.truncate_seq);
+	if (oi.is_compressed()) {
+	  // stored as a compressed image; decompress it and serve the
+	  // requested extent of the logical object
+	  result = read_compressed(ctx, op.extent.offset, op.extent.length,
+				   op.flags, &osd_op.outdata);
+	  if (result >= 0 && first_read) {
+	    first_read = false;
+	    ctx->data_off = op.extent.offset;
+	  }
+	  ctx->delta_stats.num_rd_kb += SHIFT_ROUND_UP(op.extent.length, 10);
+	  ctx->delta_stats.num_rd++;
+	  break;
+	}
 	bool trimmed_read = false;
 	// are we beyond truncate_size?
 	if ( (seq < op.extent.truncate_seq) &&
@@ -3961,6 +4062,21 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	    make_pair(&osd_op.outdata, new ToSparseReadResult(osd_op.outdata,
 							      op.extent.length))));
 	dout(10) << " async_read (was sparse_read) noted for " << soid << dendl;
+      } else if (oi.is_compressed()) {
+	// the on-disk extents describe the compressed image; decompress
+	// and return the requested range as a single dense extent
+	bufferlist data_bl;
+	result = read_compressed(ctx, op.extent.offset, op.extent.length,
+				 op.flags, &data_bl);
+	if (result < 0)
+	  break;
+	map<uint64_t, uint64_t> m;
+	if (op.extent.length)
+	  m[op.extent.offset] = op.extent.length;
+	::encode(m, osd_op.outdata);
+	::encode_destructively(data_bl, osd_op.outdata);
+	dout(10) << " sparse_read got " << op.extent.length
+		 << " bytes from object " << soid << dendl;
       } else {
 	// read into a buffer
 	bufferlist bl;
@@ -4053,18 +4169,32 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	}
 	tracepoint(osd, do_osd_op_pre_call, soid.oid.name.c_str(), soid.snap.val, cname.c_str(), mname.c_str());
 
-	ClassHandler::ClassData *cls;
-	result = osd->class_handler->open_class(cname, &cls);
-	assert(result == 0);   // init_op_flags() already verified this works.
+	ClassHandler::ClassMethod *method;
+	int flags;
+	if (ctx->cls_method &&
+	    cname == ctx->cls_cname && mname == ctx->cls_mname) {
+	  // consecutive calls to the same method on this object share
+	  // one resolution (and skip the handler mutex entirely)
+	  method = ctx->cls_method;
+	  flags = ctx->cls_flags;
+	} else {
+	  ClassHandler::ClassData *cls;
+	  result = osd->class_handler->open_class(cname, &cls);
+	  assert(result == 0);   // init_op_flags() already verified this works.
 
-	ClassHandler::ClassMethod *method = cls->get_method(mname.c_str());
-	if (!method) {
-	  dout(10) << "call method " << cname << "." << mname << " does not exist" << dendl;
-	  result = -EOPNOTSUPP;
-	  break;
-	}
+	  method = cls->get_method(mname.c_str());
+	  if (!method) {
+	    dout(10) << "call method " << cname << "." << mname << " does not exist" << dendl;
+	    result = -EOPNOTSUPP;
+	    break;
+	  }
 
-	int flags = method->get_flags();
+	  flags = method->get_flags();
+	  ctx->cls_method = method;
+	  ctx->cls_cname = cname;
+	  ctx->cls_mname = mname;
+	  ctx->cls_flags = flags;
+	}
 	if (flags & CLS_METHOD_WR)
 	  ctx->user_modify = true;
 
@@ -4100,9 +4230,16 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	tracepoint(osd, do_osd_op_pre_stat, soid.oid.name.c_str(), soid.snap.val);
 
 	if (obs.exists && !oi.is_whiteout()) {
-	  ::encode(oi.size, osd_op.outdata);
+	  uint64_t size = oi.size;
+	  if (oi.is_compressed()) {
+	    // report the logical, not the stored, size
+	    result = get_logical_size(ctx, &size);
+	    if (result < 0)
+	      break;
+	  }
+	  ::encode(size, osd_op.outdata);
 	  ::encode(oi.mtime, osd_op.outdata);
-	  dout(10) << "stat oi has " << oi.size << " " << oi.mtime << dendl;
+	  dout(10) << "stat oi has " << size << " " << oi.mtime << dendl;
 	} else {
 	  result = -ENOENT;
 	  dout(10) << "stat oi object does not exist" << dendl;
@@ -4421,7 +4558,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
           dout(20) << " clone " << *clone_iter << " snaps " << ci.snaps << dendl;
 
-          map<snapid_t, interval_set<uint64_t> >::const_iterator coi;
+          map<snapid_t, extent_set_t>::const_iterator coi;
           coi = ssc->snapset.clone_overlap.find(ci.cloneid);
           if (coi == ssc->snapset.clone_overlap.end()) {
             osd->clog->error() << "osd." << osd->whoami << ": inconsistent clone_overlap found for oid "
@@ -4429,9 +4566,9 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
             result = -EINVAL;
             break;
           }
-          const interval_set<uint64_t> &o = coi->second;
+          const extent_set_t &o = coi->second;
           ci.overlap.reserve(o.num_intervals());
-          for (interval_set<uint64_t>::const_iterator r = o.begin();
+          for (extent_set_t::const_iterator r = o.begin();
                r != o.end(); ++r) {
             ci.overlap.push_back(pair<uint64_t,uint64_t>(r.get_start(), r.get_len()));
           }
@@ -4690,18 +4827,27 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	    }
 	    t->setattrs(soid, to_set);
 	  }
+	  maybe_create_new_object(ctx);
+	  obs.oi.set_data_digest(osd_op.indata.crc32c(-1));
+	  write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
+	      0, op.extent.length, true, op.extent.length != oi.size ? true : false);
 	} else {
 	  ctx->mod_desc.mark_unrollbackable();
-	  t->write(soid, 0, op.extent.length, osd_op.indata, op.flags);
-	  if (obs.exists && op.extent.length < oi.size) {
-	    t->truncate(soid, op.extent.length);
+	  bufferlist cbl;
+	  bufferlist *storebl = &osd_op.indata;
+	  if (maybe_compress_full_write(ctx, osd_op.indata, &cbl))
+	    storebl = &cbl;
+	  t->write(soid, 0, storebl->length(), *storebl, op.flags);
+	  if (obs.exists && storebl->length() < oi.size) {
+	    t->truncate(soid, storebl->length());
 	  }
+	  maybe_create_new_object(ctx);
+	  // oi.size and the digest track the bytes actually stored, so
+	  // recovery and scrub stay oblivious to compression
+	  obs.oi.set_data_digest(storebl->crc32c(-1));
+	  write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
+	      0, storebl->length(), true, storebl->length() != oi.size ? true : false);
 	}
-	maybe_create_new_object(ctx);
-	obs.oi.set_data_digest(osd_op.indata.crc32c(-1));
-
-	write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
-	    0, op.extent.length, true, op.extent.length != oi.size ? true : false);
       }
       break;
 
@@ -4726,7 +4872,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	if (obs.exists && !oi.is_whiteout()) {
 	  ctx->mod_desc.mark_unrollbackable();
 	  t->zero(soid, op.extent.offset, op.extent.length);
-	  interval_set<uint64_t> ch;
+	  extent_set_t ch;
 	  ch.insert(op.extent.offset, op.extent.length);
 	  ctx->modified_ranges.union_of(ch);
 	  ctx->delta_stats.num_wr++;
@@ -4806,7 +4952,7 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
 	t->truncate(soid, op.extent.offset);
 	if (oi.size > op.extent.offset) {
-	  interval_set<uint64_t> trim;
+	  extent_set_t trim;
 	  trim.insert(op.extent.offset, oi.size-op.extent.offset);
 	  ctx->modified_ranges.union_of(trim);
 	}
@@ -5603,7 +5749,7 @@ inline int ReplicatedPG::_delete_oid(OpContext *ctx, bool no_whiteout)
   }
 
   if (oi.size > 0) {
-    interval_set<uint64_t> ch;
+    extent_set_t ch;
     ch.insert(0, oi.size);
     ctx->modified_ranges.union_of(ch);
   }
@@ -5739,9 +5885,9 @@ int ReplicatedPG::_rollback_to(OpContext *ctx, ceph_osd_op& op)
       t->clone(rollback_to_sobject, soid);
       snapset.head_exists = true;
 
-      map<snapid_t, interval_set<uint64_t> >::iterator iter =
+      map<snapid_t, extent_set_t>::iterator iter =
 	snapset.clone_overlap.lower_bound(snapid);
-      interval_set<uint64_t> overlaps = iter->second;
+      extent_set_t overlaps = iter->second;
       assert(iter != snapset.clone_overlap.end());
       for ( ;
 	    iter != snapset.clone_overlap.end();
@@ -5749,7 +5895,7 @@ int ReplicatedPG::_rollback_to(OpContext *ctx, ceph_osd_op& op)
 	overlaps.intersection_of(iter->second);
 
       if (obs.oi.size > 0) {
-	interval_set<uint64_t> modified;
+	extent_set_t modified;
 	modified.insert(0, obs.oi.size);
 	overlaps.intersection_of(modified);
 	modified.subtract(overlaps);
@@ -5769,6 +5915,12 @@ int ReplicatedPG::_rollback_to(OpContext *ctx, ceph_osd_op& op)
 	obs.oi.set_omap_digest(rollback_to->obs.oi.omap_digest);
       else
 	obs.oi.clear_omap_digest();
+      // the clone's data and attrs (including any compression header)
+      // were cloned wholesale, so just carry the flag over
+      if (rollback_to->obs.oi.is_compressed())
+	obs.oi.set_flag(object_info_t::FLAG_COMPRESSED);
+      else
+	obs.oi.clear_flag(object_info_t::FLAG_COMPRESSED);
       snapset.head_exists = true;
     }
   }
@@ -5930,7 +6082,7 @@ void ReplicatedPG::make_writeable(OpContext *ctx)
     hobject_t last_clone_oid = soid;
     last_clone_oid.snap = ctx->new_snapset.clone_overlap.rbegin()->first;
     if (is_present_clone(last_clone_oid)) {
-      interval_set<uint64_t> &newest_overlap = ctx->new_snapset.clone_overlap.rbegin()->second;
+      extent_set_t &newest_overlap = ctx->new_snapset.clone_overlap.rbegin()->second;
       ctx->modified_ranges.intersection_of(newest_overlap);
       // modified_ranges is still in use by the clone
       add_interval_usage(ctx->modified_ranges, ctx->delta_stats);
@@ -5947,10 +6099,10 @@ void ReplicatedPG::make_writeable(OpContext *ctx)
 
 
 void ReplicatedPG::write_update_size_and_usage(object_stat_sum_t& delta_stats, object_info_t& oi,
-					       interval_set<uint64_t>& modified, uint64_t offset,
+					       extent_set_t& modified, uint64_t offset,
 					       uint64_t length, bool count_bytes, bool force_changesize)
 {
-  interval_set<uint64_t> ch;
+  extent_set_t ch;
   if (length)
     ch.insert(offset, length);
   modified.union_of(ch);
@@ -5965,13 +6117,147 @@ void ReplicatedPG::write_update_size_and_usage(object_stat_sum_t& delta_stats, o
     delta_stats.num_wr_kb += SHIFT_ROUND_UP(length, 10);
 }
 
-void ReplicatedPG::add_interval_usage(interval_set<uint64_t>& s, object_stat_sum_t& delta_stats)
+void ReplicatedPG::add_interval_usage(extent_set_t& s, object_stat_sum_t& delta_stats)
 {
-  for (interval_set<uint64_t>::const_iterator p = s.begin(); p != s.end(); ++p) {
+  for (extent_set_t::const_iterator p = s.begin(); p != s.end(); ++p) {
     delta_stats.num_bytes += p.get_len();
   }
 }
 
+Compressor *ReplicatedPG::get_compressor()
+{
+  // snappy is the only engine we have; refuse anything else so that we
+  // never store an image we cannot read back
+  if (cct->_conf->osd_compression_algorithm != "snappy") {
+    derr << __func__ << ": unsupported osd_compression_algorithm "
+	 << cct->_conf->osd_compression_algorithm << dendl;
+    return NULL;
+  }
+  if (!compressor)
+    compressor = Compressor::create(cct->_conf->osd_compression_algorithm);
+  return compressor;
+}
+
+bool ReplicatedPG::maybe_compress_full_write(OpContext *ctx, bufferlist &in,
+					     bufferlist *out)
+{
+  object_info_t &oi = ctx->new_obs.oi;
+  if (pool.info.has_flag(pg_pool_t::FLAG_COMPRESS) &&
+      in.length() >= cct->_conf->osd_compression_min_size) {
+    Compressor *c = get_compressor();
+    if (c && c->compress(in, *out) == 0 && out->length() < in.length()) {
+      dout(10) << __func__ << " " << oi.soid << " " << in.length()
+	       << " -> " << out->length() << " bytes" << dendl;
+      bufferlist hbl;
+      ::encode(cct->_conf->osd_compression_algorithm, hbl);
+      ::encode((uint64_t)in.length(), hbl);
+      setattr_maybe_cache(ctx->obc, ctx, ctx->op_t, COMP_ATTR, hbl);
+      oi.set_flag(object_info_t::FLAG_COMPRESSED);
+      return true;
+    }
+    dout(20) << __func__ << " " << oi.soid << " did not pay off" << dendl;
+    out->clear();
+  }
+  if (oi.is_compressed()) {
+    // replacing a compressed image with a raw one
+    rmattr_maybe_cache(ctx->obc, ctx, ctx->op_t, COMP_ATTR);
+    oi.clear_flag(object_info_t::FLAG_COMPRESSED);
+  }
+  return false;
+}
+
+int ReplicatedPG::get_logical_size(OpContext *ctx, uint64_t *psize)
+{
+  bufferlist hbl;
+  int r = getattr_maybe_cache(ctx->obc, COMP_ATTR, &hbl);
+  if (r < 0)
+    return r;
+  try {
+    string alg;
+    bufferlist::iterator p = hbl.begin();
+    ::decode(alg, p);
+    ::decode(*psize, p);
+  } catch (buffer::error& e) {
+    return -EIO;
+  }
+  return 0;
+}
+
+int ReplicatedPG::read_compressed(OpContext *ctx, uint64_t &offset,
+				  uint64_t &length, uint32_t op_flags,
+				  bufferlist *out)
+{
+  object_info_t &oi = ctx->new_obs.oi;
+  const hobject_t& soid = oi.soid;
+  string alg;
+  uint64_t logical = 0;
+  bufferlist hbl;
+  int r = getattr_maybe_cache(ctx->obc, COMP_ATTR, &hbl);
+  if (r >= 0) {
+    try {
+      bufferlist::iterator p = hbl.begin();
+      ::decode(alg, p);
+      ::decode(logical, p);
+    } catch (buffer::error& e) {
+      r = -EIO;
+    }
+  }
+  if (r < 0) {
+    osd->clog->error() << info.pgid << " missing or corrupt " << COMP_ATTR
+		       << " attr on compressed object " << soid << "\n";
+    return -EIO;
+  }
+  if (alg != "snappy") {
+    osd->clog->error() << info.pgid << " cannot decompress " << soid
+		       << ": unsupported algorithm " << alg << "\n";
+    return -EIO;
+  }
+  if (!compressor)
+    compressor = Compressor::create(alg);
+  bufferlist cbl;
+  r = pgbackend->objects_read_sync(soid, 0, oi.size, op_flags, &cbl);
+  if (r < 0)
+    return r;
+  bufferlist raw;
+  if (compressor->decompress(cbl, raw) < 0 || raw.length() != logical) {
+    osd->clog->error() << info.pgid << " failed to decompress " << soid << "\n";
+    return -EIO;
+  }
+  dout(10) << __func__ << " " << soid << " " << oi.size << " -> "
+	   << logical << " bytes" << dendl;
+  if (offset >= logical) {
+    length = 0;
+    return 0;
+  }
+  if (length == 0 || offset + length > logical)
+    length = logical - offset;
+  out->substr_of(raw, offset, length);
+  return 0;
+}
+
+int ReplicatedPG::inflate_object(OpContext *ctx)
+{
+  object_info_t &oi = ctx->new_obs.oi;
+  const hobject_t& soid = oi.soid;
+  uint64_t offset = 0, length = 0;
+  bufferlist raw;
+  int r = read_compressed(ctx, offset, length, 0, &raw);
+  if (r < 0)
+    return r;
+  dout(10) << __func__ << " " << soid << " " << oi.size << " -> "
+	   << raw.length() << " bytes" << dendl;
+  PGBackend::PGTransaction *t = ctx->op_t;
+  ctx->mod_desc.mark_unrollbackable();
+  // raw is always longer than the compressed image, so this covers it
+  t->write(soid, 0, raw.length(), raw, 0);
+  rmattr_maybe_cache(ctx->obc, ctx, t, COMP_ATTR);
+  oi.clear_flag(object_info_t::FLAG_COMPRESSED);
+  oi.set_data_digest(raw.crc32c(-1));
+  write_update_size_and_usage(ctx->delta_stats, oi, ctx->modified_ranges,
+			      0, raw.length(), false, true);
+  return 0;
+}
+
 void ReplicatedPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
 {
   entity_name_t entity = ctx->reqid.name;
@@ -6026,29 +6312,38 @@ void ReplicatedPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
     watch->connect(conn, i->second);
   }
 
-  for (list<notify_info_t>::iterator p = ctx->notifies.begin();
-       p != ctx->notifies.end();
-       ++p) {
-    dout(10) << "do_osd_op_effects, notify " << *p << dendl;
-    ConnectionRef conn(ctx->op->get_req()->get_connection());
-    NotifyRef notif(
-      Notify::makeNotifyRef(
-	conn,
-	ctx->reqid.name.num(),
-	p->bl,
-	p->timeout,
-	p->cookie,
-	osd->get_next_id(get_osdmap()->get_epoch()),
-	ctx->obc->obs.oi.user_version,
-	osd));
-    for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
-	   ctx->obc->watchers.begin();
-	 i != ctx->obc->watchers.end();
-	 ++i) {
-      dout(10) << "starting notify on watch " << i->first << dendl;
-      i->second->start_notify(notif);
+  if (!ctx->notifies.empty()) {
+    NotifyBatch *batch = new NotifyBatch;
+    for (list<notify_info_t>::iterator p = ctx->notifies.begin();
+	 p != ctx->notifies.end();
+	 ++p) {
+      dout(10) << "do_osd_op_effects, notify " << *p << dendl;
+      ConnectionRef conn(ctx->op->get_req()->get_connection());
+      NotifyRef notif(
+	Notify::makeNotifyRef(
+	  conn,
+	  ctx->reqid.name.num(),
+	  p->bl,
+	  p->timeout,
+	  p->cookie,
+	  osd->get_next_id(get_osdmap()->get_epoch()),
+	  ctx->obc->obs.oi.user_version,
+	  osd));
+      for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
+	     ctx->obc->watchers.begin();
+	   i != ctx->obc->watchers.end();
+	   ++i) {
+	dout(10) << "starting notify on watch " << i->first << dendl;
+	i->second->start_notify(notif, batch);
+      }
+      notif->init();
+    }
+    // submit the fan-out off the PG lock, one pass per connection
+    if (batch->empty()) {
+      delete batch;
+    } else {
+      osd->queue_notify_batch(batch);
     }
-    notif->init();
   }
 
   for (list<OpContext::NotifyAck>::iterator p = ctx->notify_acks.begin();
@@ -6448,6 +6743,13 @@ int ReplicatedPG::fill_in_copy_get(
       oi.is_omap())
       return -EOPNOTSUPP;
 
+  if (oi.is_compressed()) {
+    // the copy machinery would ship the compressed bytes with raw
+    // semantics; until it learns to decompress into the stream, a
+    // compressed object cannot be a copy/flush/promote source
+    return -EOPNOTSUPP;
+  }
+
   MOSDOp *op = reinterpret_cast<MOSDOp*>(ctx->op->get_req());
   uint64_t features = op->get_features();
 
@@ -7006,6 +7308,8 @@ void ReplicatedPG::finish_copyfrom(OpContext *ctx)
 
   obs.oi.set_data_digest(cb->results->data_digest);
   obs.oi.set_omap_digest(cb->results->omap_digest);
+  // whatever we replaced, the copied-in data is raw
+  obs.oi.clear_flag(object_info_t::FLAG_COMPRESSED);
 
   ctx->extra_reqids = cb->results->reqids;
 
@@ -7024,7 +7328,7 @@ void ReplicatedPG::finish_copyfrom(OpContext *ctx)
     obs.oi.clear_flag(object_info_t::FLAG_OMAP);
   }
 
-  interval_set<uint64_t> ch;
+  extent_set_t ch;
   if (obs.oi.size > 0)
     ch.insert(0, obs.oi.size);
   ctx->modified_ranges.union_of(ch);
@@ -7732,6 +8036,15 @@ void ReplicatedPG::repop_all_applied(RepGather *repop)
 {
   dout(10) << __func__ << ": repop tid " << repop->rep_tid << " all applied "
 	   << dendl;
+  {
+#ifdef WITH_LTTNG
+    osd_reqid_t reqid;
+    if (repop->ctx->op)
+      reqid = repop->ctx->op->get_reqid();
+#endif
+    tracepoint(osd, repop_all_applied, reqid.name._type,
+        reqid.name._num, reqid.tid, reqid.inc, repop->rep_tid);
+  }
   repop->all_applied = true;
   if (!repop->rep_aborted) {
     eval_repop(repop);
@@ -7757,6 +8070,15 @@ void ReplicatedPG::repop_all_committed(RepGather *repop)
 {
   dout(10) << __func__ << ": repop tid " << repop->rep_tid << " all committed "
 	   << dendl;
+  {
+#ifdef WITH_LTTNG
+    osd_reqid_t reqid;
+    if (repop->ctx->op)
+      reqid = repop->ctx->op->get_reqid();
+#endif
+    tracepoint(osd, repop_all_committed, reqid.name._type,
+        reqid.name._num, reqid.tid, reqid.inc, repop->rep_tid);
+  }
   repop->all_committed = true;
 
   if (!repop->rep_aborted) {
@@ -7856,6 +8178,13 @@ void ReplicatedPG::eval_repop(RepGather *repop)
       }
       reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
       dout(10) << " sending commit on " << *repop << " " << reply << dendl;
+      {
+#ifdef WITH_LTTNG
+        osd_reqid_t reqid = repop->ctx->op->get_reqid();
+#endif
+        tracepoint(osd, send_op_reply, reqid.name._type,
+            reqid.name._num, reqid.tid, reqid.inc, 1);
+      }
       osd->send_message_osd_client(reply, m->get_connection());
       repop->sent_disk = true;
       repop->ctx->op->mark_commit_sent();
@@ -7894,6 +8223,13 @@ void ReplicatedPG::eval_repop(RepGather *repop)
       }
       reply->add_flags(CEPH_OSD_FLAG_ACK);
       dout(10) << " sending ack on " << *repop << " " << reply << dendl;
+      {
+#ifdef WITH_LTTNG
+        osd_reqid_t reqid = repop->ctx->op->get_reqid();
+#endif
+        tracepoint(osd, send_op_reply, reqid.name._type,
+            reqid.name._num, reqid.tid, reqid.inc, 0);
+      }
       osd->send_message_osd_client(reply, m->get_connection());
       repop->sent_ack = true;
     }
@@ -7948,6 +8284,15 @@ void ReplicatedPG::issue_repop(RepGather *repop)
   dout(7) << "issue_repop rep_tid " << repop->rep_tid
           << " o " << soid
           << dendl;
+  {
+#ifdef WITH_LTTNG
+    osd_reqid_t reqid;
+    if (ctx->op)
+      reqid = ctx->op->get_reqid();
+#endif
+    tracepoint(osd, issue_repop, reqid.name._type,
+        reqid.name._num, reqid.tid, reqid.inc, repop->rep_tid);
+  }
 
   repop->v = ctx->at_version;
   if (ctx->at_version > eversion_t()) {
@@ -8133,10 +8478,10 @@ void ReplicatedPG::populate_obc_watchers(ObjectContextRef obc)
   assert(is_active());
   assert((recovering.count(obc->obs.oi.soid) ||
 	  !is_missing_object(obc->obs.oi.soid)) ||
-	 (pg_log.get_log().objects.count(obc->obs.oi.soid) && // or this is a revert... see recover_primary()
-	  pg_log.get_log().objects.find(obc->obs.oi.soid)->second->op ==
+	 (pg_log.get_log().get_object_entry(obc->obs.oi.soid) && // or this is a revert... see recover_primary()
+	  pg_log.get_log().get_object_entry(obc->obs.oi.soid)->op ==
 	    pg_log_entry_t::LOST_REVERT &&
-	  pg_log.get_log().objects.find(obc->obs.oi.soid)->second->reverting_to ==
+	  pg_log.get_log().get_object_entry(obc->obs.oi.soid)->reverting_to ==
 	    obc->obs.oi.version));
 
   dout(10) << "populate_obc_watchers " << obc->obs.oi.soid << dendl;
@@ -8253,8 +8598,8 @@ ObjectContextRef ReplicatedPG::get_object_context(const hobject_t& soid,
   assert(
     attrs || !pg_log.get_missing().is_missing(soid) ||
     // or this is a revert... see recover_primary()
-    (pg_log.get_log().objects.count(soid) &&
-      pg_log.get_log().objects.find(soid)->second->op ==
+    (pg_log.get_log().get_object_entry(soid) &&
+      pg_log.get_log().get_object_entry(soid)->op ==
       pg_log_entry_t::LOST_REVERT));
   ObjectContextRef obc = object_contexts.lookup(soid);
   osd->logger->inc(l_osd_object_ctx_cache_total);
@@ -8611,8 +8956,8 @@ void ReplicatedPG::add_object_context_to_pg_stat(ObjectContextRef obc, pg_stat_t
 
     // subtract off clone overlap
     if (obc->ssc->snapset.clone_overlap.count(oi.soid.snap)) {
-      interval_set<uint64_t>& o = obc->ssc->snapset.clone_overlap[oi.soid.snap];
-      for (interval_set<uint64_t>::const_iterator r = o.begin();
+      extent_set_t& o = obc->ssc->snapset.clone_overlap[oi.soid.snap];
+      for (extent_set_t::const_iterator r = o.begin();
 	   r != o.end();
 	   ++r) {
 	stat.num_bytes -= r.get_len();
@@ -9415,9 +9760,11 @@ void ReplicatedPG::on_change(ObjectStore::Transaction *t)
 
   if (is_primary()) {
     requeue_ops(waiting_for_cache_not_full);
+    requeue_ops(waiting_for_qos);
     requeue_ops(waiting_for_all_missing);
   } else {
     waiting_for_cache_not_full.clear();
+    waiting_for_qos.clear();
     waiting_for_all_missing.clear();
   }
 
@@ -9779,12 +10126,11 @@ int ReplicatedPG::recover_primary(int max, ThreadPool::TPHandle &handle)
     hobject_t soid;
     version_t v = p->first;
 
-    if (pg_log.get_log().objects.count(p->second)) {
-      latest = pg_log.get_log().objects.find(p->second)->second;
+    latest = pg_log.get_log().get_object_entry(p->second);
+    if (latest) {
       assert(latest->is_update());
       soid = latest->soid;
     } else {
-      latest = 0;
       soid = p->second;
     }
     const pg_missing_t::item& item = missing.missing.find(p->second)->second;
@@ -10238,6 +10584,16 @@ int ReplicatedPG::recover_backfill(
     if (sent_scan) {
       ops++;
       start_recovery_op(hobject_t::get_max()); // XXX: was pbi.end
+      // overlap our local scan with the peer round trip: refill the
+      // local interval now so the merge can resume as soon as the
+      // replies arrive instead of scanning then
+      if (!backfill_info.extends_to_end() && backfill_info.empty()) {
+	hobject_t next = backfill_info.end;
+	backfill_info.reset(next, get_sort_bitwise());
+	backfill_info.end = hobject_t::get_max();
+	update_range(&backfill_info, handle);
+	backfill_info.trim();
+      }
       break;
     }
 
@@ -11153,6 +11509,24 @@ bool ReplicatedPG::agent_work(int start_max, int agent_flush_quota)
 					  &ls, &next);
   assert(r >= 0);
   dout(20) << __func__ << " got " << ls.size() << " objects" << dendl;
+
+  // Prime the hit set probes for the whole candidate batch up front.
+  // agent_estimate_atime_temp() walks every in-memory generation per
+  // object; issuing all the prefetches here lets the random bloom bit
+  // lookups for the batch overlap instead of stalling one by one in
+  // between the eviction checks below.
+  if (hit_set && agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE) {
+    for (vector<hobject_t>::iterator p = ls.begin(); p != ls.end(); ++p) {
+      if (p->nspace == cct->_conf->osd_hit_set_namespace)
+	continue;
+      hit_set->prefetch(*p);
+      for (map<time_t,HitSetRef>::iterator q = agent_state->hit_set_map.begin();
+	   q != agent_state->hit_set_map.end();
+	   ++q)
+	q->second->prefetch(*p);
+    }
+  }
+
   int started = 0;
   for (vector<hobject_t>::iterator p = ls.begin();
        p != ls.end();
@@ -11765,6 +12139,15 @@ void ReplicatedPG::agent_estimate_atime_temp(const hobject_t& oid,
   *atime = -1;
   if (temp)
     *temp = 0;
+  // start all the generations' probe lines loading before we test any
+  // of them; each bloom probe otherwise eats its cache misses serially
+  hit_set->prefetch(oid);
+  for (map<time_t,HitSetRef>::reverse_iterator p =
+	 agent_state->hit_set_map.rbegin();
+       p != agent_state->hit_set_map.rend();
+       ++p) {
+    p->second->prefetch(oid);
+  }
   if (hit_set->contains(oid)) {
     *atime = 0;
     if (temp)
@@ -12138,6 +12521,40 @@ void ReplicatedPG::SnapTrimmer::log_exit(const char *state_name, utime_t enter_t
   dout(20) << "exit " << state_name << dendl;
 }
 
+bool ReplicatedPG::SnapTrimmer::over_budget()
+{
+  uint64_t max_objects = pg->cct->_conf->osd_snap_trim_max_objects_per_tick;
+  uint64_t max_bytes = pg->cct->_conf->osd_snap_trim_max_bytes_per_tick;
+  if (!max_objects && !max_bytes)
+    return false;
+  utime_t refill = budget_stamp;
+  refill += pg->cct->_conf->osd_snap_trim_tick_interval;
+  if (ceph_clock_now(pg->cct) >= refill) {
+    budget_stamp = ceph_clock_now(pg->cct);
+    budget_objects = 0;
+    budget_bytes = 0;
+    return false;
+  }
+  return (max_objects && budget_objects >= max_objects) ||
+    (max_bytes && budget_bytes >= max_bytes);
+}
+
+void ReplicatedPG::SnapTrimmer::account_trim(uint64_t bytes)
+{
+  ++budget_objects;
+  budget_bytes += bytes;
+}
+
+double ReplicatedPG::SnapTrimmer::budget_refill_delay()
+{
+  utime_t refill = budget_stamp;
+  refill += pg->cct->_conf->osd_snap_trim_tick_interval;
+  utime_t now = ceph_clock_now(pg->cct);
+  if (refill <= now)
+    return 0.0;
+  return refill - now;
+}
+
 /*---SnapTrimmer states---*/
 #undef dout_prefix
 #define dout_prefix (*_dout << context< SnapTrimmer >().pg->gen_prefix() \
@@ -12224,6 +12641,16 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
   }
 
   while (repops.size() < g_conf->osd_pg_max_concurrent_snap_trims) {
+    if (context<SnapTrimmer>().over_budget()) {
+      // this tick's budget is spent; come back through the op queue
+      // when it refills instead of sleeping in an op thread
+      double delay = context<SnapTrimmer>().budget_refill_delay();
+      dout(10) << "TrimmingObjects: trim budget exhausted, retry in "
+	       << delay << "s" << dendl;
+      pg->schedule_snap_trim_retry(delay);
+      return discard_event();
+    }
+
     // Get next
     hobject_t old_pos = pos;
     int r = pg->snap_mapper.get_next_object_to_trim(snap_to_trim, &pos);
@@ -12248,6 +12675,7 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
     assert(repop);
     repop->queue_snap_trimmer = true;
 
+    context<SnapTrimmer>().account_trim(repop->ctx->obs->oi.size);
     repops.insert(repop->get());
     pg->simple_repop_submit(repop);
   }
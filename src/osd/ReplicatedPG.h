@@ -47,6 +47,7 @@ class PromoteCallback;
 
 class ReplicatedPG;
 class PGLSFilter;
+class Compressor;
 void intrusive_ptr_add_ref(ReplicatedPG *pg);
 void intrusive_ptr_release(ReplicatedPG *pg);
 uint64_t get_with_id(ReplicatedPG *pg);
@@ -526,7 +527,7 @@ public:
     vector<pg_log_entry_t> log;
     boost::optional<pg_hit_set_history_t> updated_hset_history;
 
-    interval_set<uint64_t> modified_ranges;
+    extent_set_t modified_ranges;
     ObjectContextRef obc;
     map<hobject_t,ObjectContextRef, hobject_t::BitwiseComparator> src_obc;
     ObjectContextRef clone_obc;    // if we created a clone
@@ -542,6 +543,11 @@ public:
     int num_read;    ///< count read ops
     int num_write;   ///< count update ops
 
+    /// memoized cls method resolution for consecutive CALL ops
+    ClassHandler::ClassMethod *cls_method;
+    string cls_cname, cls_mname;
+    int cls_flags;
+
     vector<pair<osd_reqid_t, version_t> > extra_reqids;
 
     CopyFromCallback *copy_cb;
@@ -613,6 +619,8 @@ public:
       data_off(0), reply(NULL), pg(_pg),
       num_read(0),
       num_write(0),
+      cls_method(NULL),
+      cls_flags(0),
       copy_cb(NULL),
       async_read_result(0),
       inflightreads(0),
@@ -635,6 +643,8 @@ public:
       data_off(0), reply(NULL), pg(_pg),
       num_read(0),
       num_write(0),
+      cls_method(NULL),
+      cls_flags(0),
       copy_cb(NULL),
       async_read_result(0),
       inflightreads(0),
@@ -1160,10 +1170,24 @@ protected:
   void log_op_stats(OpContext *ctx);
 
   void write_update_size_and_usage(object_stat_sum_t& stats, object_info_t& oi,
-				   interval_set<uint64_t>& modified, uint64_t offset,
+				   extent_set_t& modified, uint64_t offset,
 				   uint64_t length, bool count_bytes,
 				   bool force_changesize=false);
-  void add_interval_usage(interval_set<uint64_t>& s, object_stat_sum_t& st);
+  void add_interval_usage(extent_set_t& s, object_stat_sum_t& st);
+
+  // -- inline compression (pools with the compress flag) --
+  Compressor *get_compressor();
+  /// compress a full-object write if the pool asks for it and it pays off
+  bool maybe_compress_full_write(OpContext *ctx, bufferlist &in,
+				 bufferlist *out);
+  /// read [offset, offset+length) of a compressed object's logical image;
+  /// length == 0 means to the end.  trims the extent like a plain read.
+  int read_compressed(OpContext *ctx, uint64_t &offset, uint64_t &length,
+		      uint32_t op_flags, bufferlist *out);
+  /// rewrite a compressed object raw so partial overwrites can proceed
+  int inflate_object(OpContext *ctx);
+  /// logical (uncompressed) size of a compressed object
+  int get_logical_size(OpContext *ctx, uint64_t *psize);
 
   /**
    * This helper function is called from do_op if the ObjectContext lookup fails.
@@ -1421,7 +1445,7 @@ protected:
 public:
   ReplicatedPG(OSDService *o, OSDMapRef curmap,
 	       const PGPool &_pool, spg_t p);
-  ~ReplicatedPG() {}
+  ~ReplicatedPG();
 
   int do_command(cmdmap_t cmdmap, ostream& ss, bufferlist& idata,
 		 bufferlist& odata);
@@ -1429,6 +1453,7 @@ public:
   void do_request(
     OpRequestRef& op,
     ThreadPool::TPHandle &handle);
+  void maybe_prefetch_obc(OpRequestRef& op);
   void do_op(OpRequestRef& op);
   bool pg_op_must_wait(MOSDOp *op);
   void do_pg_op(OpRequestRef op);
@@ -1454,6 +1479,7 @@ private:
   bool check_src_targ(const hobject_t& soid, const hobject_t& toid) const;
 
   uint64_t temp_seq; ///< last id for naming temp objects
+  Compressor *compressor; ///< lazily created for FLAG_COMPRESS pools
   hobject_t generate_temp_object();  ///< generate a new temp object name
   /// generate a new temp object name (for recovery)
   hobject_t get_temp_recovery_object(eversion_t version, snapid_t snap);
@@ -1489,10 +1515,17 @@ private:
     set<RepGather *> repops;
     snapid_t snap_to_trim;
     bool need_share_pg_info;
-    SnapTrimmer(ReplicatedPG *pg) : pg(pg), need_share_pg_info(false) {}
+    utime_t budget_stamp;     ///< start of the current trim budget tick
+    uint64_t budget_objects;  ///< objects trimmed in the current tick
+    uint64_t budget_bytes;    ///< bytes trimmed in the current tick
+    SnapTrimmer(ReplicatedPG *pg) : pg(pg), need_share_pg_info(false),
+				    budget_objects(0), budget_bytes(0) {}
     ~SnapTrimmer();
     void log_enter(const char *state_name);
     void log_exit(const char *state_name, utime_t duration);
+    bool over_budget();       ///< true if this tick's trim budget is spent
+    void account_trim(uint64_t bytes);
+    double budget_refill_delay();  ///< seconds until the budget refills
   } snap_trimmer_machine;
 
   /* SnapTrimmerStates */
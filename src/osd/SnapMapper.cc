@@ -21,8 +21,12 @@
 using std::string;
 
 const string SnapMapper::MAPPING_PREFIX = "MAP_";
+const string SnapMapper::BUCKET_PREFIX = "SNA_";
 const string SnapMapper::OBJECT_PREFIX = "OBJ_";
 
+/// snaps per bucket in the coarse snap -> object index
+static const unsigned SNAP_BUCKET_BITS = 6;
+
 int OSDriver::get_keys(
   const std::set<std::string> &keys,
   std::map<std::string, bufferlist> *out)
@@ -53,19 +57,28 @@ int OSDriver::get_next(
 struct Mapping {
   snapid_t snap;
   hobject_t hoid;
+  interval_set<snapid_t> snaps; ///< object's snaps within the bucket, v2 only
   Mapping(const pair<snapid_t, hobject_t> &in)
     : snap(in.first), hoid(in.second) {}
+  Mapping(snapid_t snap, const hobject_t &hoid,
+	  const interval_set<snapid_t> &snaps)
+    : snap(snap), hoid(hoid), snaps(snaps) {}
   Mapping() : snap(0) {}
   void encode(bufferlist &bl) const {
-    ENCODE_START(1, 1, bl);
+    // v1 decoders skip the trailing intervals, which is fine: they
+    // only ever see v1 values under MAPPING_PREFIX anyway
+    ENCODE_START(2, 1, bl);
     ::encode(snap, bl);
     ::encode(hoid, bl);
+    ::encode(snaps, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::iterator &bl) {
-    DECODE_START(1, bl);
+    DECODE_START(2, bl);
     ::decode(snap, bl);
     ::decode(hoid, bl);
+    if (struct_v >= 2)
+      ::decode(snaps, bl);
     DECODE_FINISH(bl);
   }
 };
@@ -112,6 +125,48 @@ bool SnapMapper::is_mapping(const string &to_test)
   return to_test.substr(0, MAPPING_PREFIX.size()) == MAPPING_PREFIX;
 }
 
+string SnapMapper::get_bucket_prefix(snapid_t snap)
+{
+  char buf[100];
+  int len = snprintf(
+    buf, sizeof(buf),
+    "%.*X_", (int)(sizeof(snap)*2),
+    static_cast<unsigned>((uint64_t)snap >> SNAP_BUCKET_BITS));
+  return BUCKET_PREFIX + string(buf, len);
+}
+
+string SnapMapper::to_bucket_key(snapid_t snap, const hobject_t &hoid)
+{
+  return get_bucket_prefix(snap) + shard_prefix + hoid.to_str();
+}
+
+void SnapMapper::to_buckets(
+  const std::set<snapid_t> &snaps,
+  std::map<snapid_t, interval_set<snapid_t> > *out)
+{
+  for (set<snapid_t>::const_iterator i = snaps.begin();
+       i != snaps.end();
+       ++i) {
+    snapid_t bucket(((uint64_t)*i >> SNAP_BUCKET_BITS) << SNAP_BUCKET_BITS);
+    (*out)[bucket].insert(*i);
+  }
+}
+
+void SnapMapper::set_bucket_keys(
+  const hobject_t &oid,
+  const std::map<snapid_t, interval_set<snapid_t> > &buckets,
+  std::map<std::string, bufferlist> *to_set)
+{
+  for (map<snapid_t, interval_set<snapid_t> >::const_iterator i =
+	 buckets.begin();
+       i != buckets.end();
+       ++i) {
+    bufferlist bl;
+    ::encode(Mapping(i->first, oid, i->second), bl);
+    (*to_set)[to_bucket_key(i->first, oid)] = bl;
+  }
+}
+
 string SnapMapper::to_object_key(const hobject_t &hoid)
 {
   return OBJECT_PREFIX + shard_prefix + hoid.to_str();
@@ -119,17 +174,38 @@ string SnapMapper::to_object_key(const hobject_t &hoid)
 
 void SnapMapper::object_snaps::encode(bufferlist &bl) const
 {
-  ENCODE_START(1, 1, bl);
+  // v2 range-encodes the snap set; a v1 decoder would misparse the
+  // intervals as a plain set, hence compat 2
+  ENCODE_START(2, 2, bl);
   ::encode(oid, bl);
-  ::encode(snaps, bl);
+  interval_set<snapid_t> intervals;
+  for (set<snapid_t>::const_iterator i = snaps.begin();
+       i != snaps.end();
+       ++i)
+    intervals.insert(*i);
+  ::encode(intervals, bl);
   ENCODE_FINISH(bl);
 }
 
 void SnapMapper::object_snaps::decode(bufferlist::iterator &bl)
 {
-  DECODE_START(1, bl);
+  DECODE_START(2, bl);
   ::decode(oid, bl);
-  ::decode(snaps, bl);
+  if (struct_v >= 2) {
+    interval_set<snapid_t> intervals;
+    ::decode(intervals, bl);
+    snaps.clear();
+    for (interval_set<snapid_t>::const_iterator i = intervals.begin();
+	 i != intervals.end();
+	 ++i) {
+      for (uint64_t s = i.get_start(); s < i.get_start() + i.get_len(); ++s)
+	snaps.insert(snapid_t(s));
+    }
+    legacy = false;
+  } else {
+    ::decode(snaps, bl);
+    legacy = true;
+  }
   DECODE_FINISH(bl);
 }
 
@@ -203,14 +279,42 @@ int SnapMapper::update_snaps(
   object_snaps in(oid, new_snaps);
   set_snaps(oid, in, t);
 
+  map<string, bufferlist> to_set;
   set<string> to_remove;
-  for (set<snapid_t>::iterator i = out.snaps.begin();
-       i != out.snaps.end();
-       ++i) {
-    if (!new_snaps.count(*i)) {
+  if (out.legacy) {
+    // migrate to the bucketed index: drop every per-snap key and
+    // write the object's buckets fresh
+    for (set<snapid_t>::iterator i = out.snaps.begin();
+	 i != out.snaps.end();
+	 ++i)
       to_remove.insert(to_raw_key(make_pair(*i, oid)));
+    map<snapid_t, interval_set<snapid_t> > buckets;
+    to_buckets(new_snaps, &buckets);
+    set_bucket_keys(oid, buckets, &to_set);
+  } else {
+    map<snapid_t, interval_set<snapid_t> > old_buckets, new_buckets, changed;
+    to_buckets(out.snaps, &old_buckets);
+    to_buckets(new_snaps, &new_buckets);
+    for (map<snapid_t, interval_set<snapid_t> >::iterator i =
+	   old_buckets.begin();
+	 i != old_buckets.end();
+	 ++i) {
+      if (!new_buckets.count(i->first))
+	to_remove.insert(to_bucket_key(i->first, oid));
+    }
+    for (map<snapid_t, interval_set<snapid_t> >::iterator i =
+	   new_buckets.begin();
+	 i != new_buckets.end();
+	 ++i) {
+      map<snapid_t, interval_set<snapid_t> >::iterator j =
+	old_buckets.find(i->first);
+      if (j == old_buckets.end() || !(j->second == i->second))
+	changed.insert(*i);
     }
+    set_bucket_keys(oid, changed, &to_set);
   }
+  if (!to_set.empty())
+    backend.set_keys(to_set, t);
   backend.remove_keys(to_remove, t);
   return 0;
 }
@@ -231,12 +335,10 @@ void SnapMapper::add_oid(
   object_snaps _snaps(oid, snaps);
   set_snaps(oid, _snaps, t);
 
+  map<snapid_t, interval_set<snapid_t> > buckets;
+  to_buckets(snaps, &buckets);
   map<string, bufferlist> to_add;
-  for (set<snapid_t>::iterator i = snaps.begin();
-       i != snaps.end();
-       ++i) {
-    to_add.insert(to_raw(make_pair(*i, oid)));
-  }
+  set_bucket_keys(oid, buckets, &to_add);
   backend.set_keys(to_add, t);
 }
 
@@ -247,28 +349,51 @@ int SnapMapper::get_next_object_to_trim(
   for (set<string>::iterator i = prefixes.begin();
        i != prefixes.end();
        ++i) {
+    // legacy per-snap keys
     string list_after(get_prefix(snap) + *i);
 
     pair<string, bufferlist> next;
     int r = backend.get_next(list_after, &next);
     if (r < 0) {
-      break; // Done
+      break; // Done; the bucketed keys sort after MAPPING_PREFIX
     }
 
-    if (next.first.substr(0, list_after.size()) !=
+    if (next.first.substr(0, list_after.size()) ==
 	list_after) {
-      continue; // Done with this prefix
-    }
+      assert(is_mapping(next.first));
 
-    assert(is_mapping(next.first));
+      pair<snapid_t, hobject_t> next_decoded(from_raw(next));
+      assert(next_decoded.first == snap);
+      assert(check(next_decoded.second));
 
-    pair<snapid_t, hobject_t> next_decoded(from_raw(next));
-    assert(next_decoded.first == snap);
-    assert(check(next_decoded.second));
+      if (hoid)
+	*hoid = next_decoded.second;
+      return 0;
+    }
 
-    if (hoid)
-      *hoid = next_decoded.second;
-    return 0;
+    // bucketed keys: scan snap's bucket, skipping objects whose
+    // interval does not contain snap
+    string bucket_after(get_bucket_prefix(snap) + *i);
+    string pos = bucket_after;
+    while (true) {
+      r = backend.get_next(pos, &next);
+      if (r < 0)
+	break; // Done
+      if (next.first.substr(0, bucket_after.size()) !=
+	  bucket_after)
+	break; // Done with this prefix
+      Mapping m;
+      bufferlist bl(next.second);
+      bufferlist::iterator bp(bl.begin());
+      ::decode(m, bp);
+      if (m.snaps.contains(snap)) {
+	assert(check(m.hoid));
+	if (hoid)
+	  *hoid = m.hoid;
+	return 0;
+      }
+      pos = next.first;
+    }
   }
   return -ENOENT;
 }
@@ -295,10 +420,20 @@ int SnapMapper::_remove_oid(
   clear_snaps(oid, t);
 
   set<string> to_remove;
-  for (set<snapid_t>::iterator i = out.snaps.begin();
-       i != out.snaps.end();
-       ++i) {
-    to_remove.insert(to_raw_key(make_pair(*i, oid)));
+  if (out.legacy) {
+    for (set<snapid_t>::iterator i = out.snaps.begin();
+	 i != out.snaps.end();
+	 ++i) {
+      to_remove.insert(to_raw_key(make_pair(*i, oid)));
+    }
+  } else {
+    map<snapid_t, interval_set<snapid_t> > buckets;
+    to_buckets(out.snaps, &buckets);
+    for (map<snapid_t, interval_set<snapid_t> >::iterator i = buckets.begin();
+	 i != buckets.end();
+	 ++i) {
+      to_remove.insert(to_bucket_key(i->first, oid));
+    }
   }
   backend.remove_keys(to_remove, t);
   return 0;
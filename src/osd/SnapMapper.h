@@ -24,6 +24,7 @@
 #include "common/hobject.h"
 #include "include/buffer.h"
 #include "include/encoding.h"
+#include "include/interval_set.h"
 #include "include/object.h"
 #include "os/ObjectStore.h"
 
@@ -82,27 +83,41 @@ public:
  *
  * We accomplish this using two sets of keys:
  *  1) OBJECT_PREFIX + obj.str() -> encoding of object_snaps
- *  2) MAPPING_PREFIX + snapid_t + obj.str() -> encoding of pair<snapid_t, obj>
+ *  2) BUCKET_PREFIX + snap bucket + obj.str() -> encoding of Mapping
+ *
+ * The object_snaps value range-encodes the snap set (an interval_set),
+ * so an object in hundreds of contiguous snaps costs a few intervals
+ * rather than hundreds of entries.
+ *
+ * The 2) mapping is a coarse per-snap index: snaps are grouped into
+ * buckets of 2^SNAP_BUCKET_BITS consecutive ids, and an object gets
+ * one key per bucket it has snaps in (holding the interval_set of its
+ * snaps within that bucket) rather than one key per snap.  Trimming a
+ * snap scans its bucket's prefix and skips entries whose interval does
+ * not contain the snap.  Within a bucket all objects in a pg still
+ * group under up to 8 prefixes.
+ *
+ * Maps written before the bucketed index used one key per (snap,
+ * object) under MAPPING_PREFIX with a v1 (plain set) object_snaps
+ * value.  We still trim and decode those; any update to a legacy
+ * object's snap set rewrites it in the bucketed form.
  *
  * The on disk strings and encodings are implemented in to_raw, to_raw_key,
- * from_raw, to_object_key.
+ * from_raw, to_object_key, to_bucket_key.
  *
  * The object -> {snapid} mapping is primarily included so that the
  * SnapMapper state can be verified against the external PG state during
  * scrub etc.
- *
- * The 2) mapping is arranged such that all objects in a particular
- * snap will sort together, and so that all objects in a pg for a
- * particular snap will group under up to 8 prefixes.
  */
 class SnapMapper {
 public:
   struct object_snaps {
     hobject_t oid;
     std::set<snapid_t> snaps;
+    bool legacy;   ///< true if decoded from a pre-bucket (v1) value; not encoded
     object_snaps(hobject_t oid, const std::set<snapid_t> &snaps)
-      : oid(oid), snaps(snaps) {}
-    object_snaps() {}
+      : oid(oid), snaps(snaps), legacy(false) {}
+    object_snaps() : legacy(false) {}
     void encode(bufferlist &bl) const;
     void decode(bufferlist::iterator &bp);
   };
@@ -111,6 +126,7 @@ private:
   MapCacher::MapCacher<std::string, bufferlist> backend;
 
   static const std::string MAPPING_PREFIX;
+  static const std::string BUCKET_PREFIX;
   static const std::string OBJECT_PREFIX;
 
   static std::string get_prefix(snapid_t snap);
@@ -128,6 +144,23 @@ private:
 
   std::string to_object_key(const hobject_t &hoid);
 
+  /// key prefix of snap's bucket in the coarse index
+  static std::string get_bucket_prefix(snapid_t snap);
+
+  /// coarse index key for (the bucket containing) snap and hoid
+  std::string to_bucket_key(snapid_t snap, const hobject_t &hoid);
+
+  /// group snaps into per-bucket interval sets, keyed by bucket start
+  static void to_buckets(
+    const std::set<snapid_t> &snaps,
+    std::map<snapid_t, interval_set<snapid_t> > *out);
+
+  /// generate the coarse index keys/values for oid's snaps
+  void set_bucket_keys(
+    const hobject_t &oid,
+    const std::map<snapid_t, interval_set<snapid_t> > &buckets,
+    std::map<std::string, bufferlist> *to_set);
+
   int get_snaps(const hobject_t &oid, object_snaps *out);
 
   void set_snaps(
@@ -246,8 +246,18 @@ public:
     osd->watch_lock.Unlock();
     pg->lock();
     watch->cb = NULL;
-    if (!watch->is_discarded() && !canceled)
-      watch->pg->handle_watch_timeout(watch);
+    if (!watch->is_discarded() && !canceled) {
+      utime_t now = ceph_clock_now(NULL);
+      utime_t expire = watch->last_ping;
+      expire += watch->timeout;
+      if (watch->will_ping && watch->conn && now < expire) {
+	// the client has pinged since this event was armed; re-arm
+	// for the remaining grace rather than timing out
+	watch->register_cb_after(expire - now);
+      } else {
+	watch->pg->handle_watch_timeout(watch);
+      }
+    }
     delete this; // ~Watch requires pg lock!
     pg->unlock();
     osd->watch_lock.Lock();
@@ -335,6 +345,15 @@ void Watch::register_cb()
     cb);
 }
 
+void Watch::register_cb_after(double delay)
+{
+  Mutex::Locker l(osd->watch_lock);
+  dout(15) << "re-arming timeout callback in " << delay << "s" << dendl;
+  assert(!cb);
+  cb = new HandleWatchTimeout(self.lock());
+  osd->watch_timer.add_event_after(delay, cb);
+}
+
 void Watch::unregister_cb()
 {
   dout(15) << "unregister_cb" << dendl;
@@ -352,9 +371,10 @@ void Watch::unregister_cb()
 void Watch::got_ping(utime_t t)
 {
   last_ping = t;
-  if (conn) {
+  // the timeout callback consults last_ping and re-arms itself, so
+  // there is no timer churn on the ping fast path
+  if (conn && !cb)
     register_cb();
-  }
 }
 
 void Watch::connect(ConnectionRef con, bool _will_ping)
@@ -444,7 +464,7 @@ void Watch::remove(bool send_disconnect)
   discard_state();
 }
 
-void Watch::start_notify(NotifyRef notif)
+void Watch::start_notify(NotifyRef notif, NotifyBatch *batch)
 {
   assert(in_progress_notifies.find(notif->notify_id) ==
 	 in_progress_notifies.end());
@@ -463,7 +483,7 @@ void Watch::start_notify(NotifyRef notif)
   in_progress_notifies[notif->notify_id] = notif;
   notif->start_watcher(self.lock());
   if (connected())
-    send_notify(notif);
+    send_notify(notif, batch);
 }
 
 void Watch::cancel_notify(NotifyRef notif)
@@ -472,14 +492,17 @@ void Watch::cancel_notify(NotifyRef notif)
   in_progress_notifies.erase(notif->notify_id);
 }
 
-void Watch::send_notify(NotifyRef notif)
+void Watch::send_notify(NotifyRef notif, NotifyBatch *batch)
 {
   dout(10) << "send_notify" << dendl;
   MWatchNotify *notify_msg = new MWatchNotify(
     cookie, notif->version, notif->notify_id,
     CEPH_WATCH_EVENT_NOTIFY, notif->payload);
   notify_msg->notifier_gid = notif->client_gid;
-  conn->send_message(notify_msg);
+  if (batch)
+    batch->messages[conn].push_back(notify_msg);
+  else
+    conn->send_message(notify_msg);
 }
 
 void Watch::notify_ack(uint64_t notify_id, bufferlist& reply_bl)
@@ -501,6 +524,21 @@ WatchRef Watch::makeWatchRef(
   return ret;
 }
 
+void NotifyBatch::send()
+{
+  for (map<ConnectionRef, list<MWatchNotify*> >::iterator i =
+	 messages.begin();
+       i != messages.end();
+       ++i) {
+    for (list<MWatchNotify*>::iterator j = i->second.begin();
+	 j != i->second.end();
+	 ++j) {
+      i->first->send_message(*j);
+    }
+  }
+  messages.clear();
+}
+
 void WatchConState::addWatch(WatchRef watch)
 {
   Mutex::Locker l(lock);
@@ -44,6 +44,18 @@ typedef ceph::weak_ptr<Notify> WNotifyRef;
 
 struct CancelableContext;
 
+/**
+ * NotifyBatch collects the MWatchNotify messages generated while a
+ * notify fans out to an object's watchers so they can be submitted in
+ * one pass per connection, off the PG lock.
+ */
+struct NotifyBatch {
+  std::map<ConnectionRef, std::list<MWatchNotify*> > messages;
+  bool empty() const { return messages.empty(); }
+  /// send and drop all queued messages
+  void send();
+};
+
 /**
  * Notify tracks the progress of a particular notify
  *
@@ -184,8 +196,11 @@ class Watch {
   /// Registers the timeout callback with watch_timer
   void register_cb();
 
-  /// send a Notify message when connected for notif
-  void send_notify(NotifyRef notif);
+  /// Re-arms the timeout callback after delay seconds (ping grace)
+  void register_cb_after(double delay);
+
+  /// send (or queue on batch, if non-NULL) a Notify message for notif
+  void send_notify(NotifyRef notif, NotifyBatch *batch = NULL);
 
   /// Cleans up state on discard or remove (including Connection state, obc)
   void discard_state();
@@ -254,7 +269,8 @@ public:
 
   /// Adds notif as in-progress notify
   void start_notify(
-    NotifyRef notif ///< [in] Reference to new in-progress notify
+    NotifyRef notif,         ///< [in] Reference to new in-progress notify
+    NotifyBatch *batch = NULL ///< [out] if non-NULL, queue message here
     );
 
   /// Removes timed out notify
@@ -948,6 +948,8 @@ void pg_pool_t::dump(Formatter *f) const
   f->dump_unsigned("stripe_width", get_stripe_width());
   f->dump_unsigned("expected_num_objects", expected_num_objects);
   f->dump_bool("fast_read", fast_read);
+  f->dump_unsigned("qos_max_iops", qos_max_iops);
+  f->dump_unsigned("qos_max_bps", qos_max_bps);
 }
 
 void pg_pool_t::convert_to_pg_shards(const vector<int> &from, set<pg_shard_t>* to) const {
@@ -1257,7 +1259,7 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
     return;
   }
 
-  ENCODE_START(22, 5, bl);
+  ENCODE_START(23, 5, bl);
   ::encode(type, bl);
   ::encode(size, bl);
   ::encode(crush_ruleset, bl);
@@ -1303,12 +1305,14 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
   ::encode(min_write_recency_for_promote, bl);
   ::encode(use_gmt_hitset, bl);
   ::encode(fast_read, bl);
+  ::encode(qos_max_iops, bl);
+  ::encode(qos_max_bps, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_pool_t::decode(bufferlist::iterator& bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(22, 5, 5, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(23, 5, 5, bl);
   ::decode(type, bl);
   ::decode(size, bl);
   ::decode(crush_ruleset, bl);
@@ -1440,6 +1444,13 @@ void pg_pool_t::decode(bufferlist::iterator& bl)
   } else {
     fast_read = false;
   }
+  if (struct_v >= 23) {
+    ::decode(qos_max_iops, bl);
+    ::decode(qos_max_bps, bl);
+  } else {
+    qos_max_iops = 0;
+    qos_max_bps = 0;
+  }
   DECODE_FINISH(bl);
   calc_pg_masks();
 }
@@ -1498,6 +1509,8 @@ void pg_pool_t::generate_test_instances(list<pg_pool_t*>& o)
   a.erasure_code_profile = "profile in osdmap";
   a.expected_num_objects = 123456;
   a.fast_read = false;
+  a.qos_max_iops = 20000;
+  a.qos_max_bps = 104857600;
   o.push_back(new pg_pool_t(a));
 }
 
@@ -1523,6 +1536,10 @@ ostream& operator<<(ostream& out, const pg_pool_t& p)
     out << " max_bytes " << p.quota_max_bytes;
   if (p.quota_max_objects)
     out << " max_objects " << p.quota_max_objects;
+  if (p.qos_max_iops)
+    out << " qos_max_iops " << p.qos_max_iops;
+  if (p.qos_max_bps)
+    out << " qos_max_bps " << p.qos_max_bps;
   if (!p.tiers.empty())
     out << " tiers " << p.tiers;
   if (p.is_tier())
@@ -1596,38 +1613,43 @@ void object_stat_sum_t::dump(Formatter *f) const
 void object_stat_sum_t::encode(bufferlist& bl) const
 {
   ENCODE_START(13, 3, bl);
-  ::encode(num_bytes, bl);
-  ::encode(num_objects, bl);
-  ::encode(num_object_clones, bl);
-  ::encode(num_object_copies, bl);
-  ::encode(num_objects_missing_on_primary, bl);
-  ::encode(num_objects_degraded, bl);
-  ::encode(num_objects_unfound, bl);
-  ::encode(num_rd, bl);
-  ::encode(num_rd_kb, bl);
-  ::encode(num_wr, bl);
-  ::encode(num_wr_kb, bl);
-  ::encode(num_scrub_errors, bl);
-  ::encode(num_objects_recovered, bl);
-  ::encode(num_bytes_recovered, bl);
-  ::encode(num_keys_recovered, bl);
-  ::encode(num_shallow_scrub_errors, bl);
-  ::encode(num_deep_scrub_errors, bl);
-  ::encode(num_objects_dirty, bl);
-  ::encode(num_whiteouts, bl);
-  ::encode(num_objects_omap, bl);
-  ::encode(num_objects_hit_set_archive, bl);
-  ::encode(num_objects_misplaced, bl);
-  ::encode(num_bytes_hit_set_archive, bl);
-  ::encode(num_flush, bl);
-  ::encode(num_flush_kb, bl);
-  ::encode(num_evict, bl);
-  ::encode(num_evict_kb, bl);
-  ::encode(num_promote, bl);
-  ::encode(num_flush_mode_high, bl);
-  ::encode(num_flush_mode_low, bl);
-  ::encode(num_evict_mode_some, bl);
-  ::encode(num_evict_mode_full, bl);
+  {
+    // all fixed-size counters; reserve the whole run once and store
+    // straight in, instead of a checked append per field
+    contiguous_encoder enc(bl, 28 * sizeof(ceph_le64) + 4 * sizeof(ceph_le32));
+    enc.put_le64(num_bytes);
+    enc.put_le64(num_objects);
+    enc.put_le64(num_object_clones);
+    enc.put_le64(num_object_copies);
+    enc.put_le64(num_objects_missing_on_primary);
+    enc.put_le64(num_objects_degraded);
+    enc.put_le64(num_objects_unfound);
+    enc.put_le64(num_rd);
+    enc.put_le64(num_rd_kb);
+    enc.put_le64(num_wr);
+    enc.put_le64(num_wr_kb);
+    enc.put_le64(num_scrub_errors);
+    enc.put_le64(num_objects_recovered);
+    enc.put_le64(num_bytes_recovered);
+    enc.put_le64(num_keys_recovered);
+    enc.put_le64(num_shallow_scrub_errors);
+    enc.put_le64(num_deep_scrub_errors);
+    enc.put_le64(num_objects_dirty);
+    enc.put_le64(num_whiteouts);
+    enc.put_le64(num_objects_omap);
+    enc.put_le64(num_objects_hit_set_archive);
+    enc.put_le64(num_objects_misplaced);
+    enc.put_le64(num_bytes_hit_set_archive);
+    enc.put_le64(num_flush);
+    enc.put_le64(num_flush_kb);
+    enc.put_le64(num_evict);
+    enc.put_le64(num_evict_kb);
+    enc.put_le64(num_promote);
+    enc.put_le32(num_flush_mode_high);
+    enc.put_le32(num_flush_mode_low);
+    enc.put_le32(num_evict_mode_some);
+    enc.put_le32(num_evict_mode_full);
+  }
   ENCODE_FINISH(bl);
 }
 
@@ -4272,8 +4294,8 @@ uint64_t SnapSet::get_clone_bytes(snapid_t clone) const
   assert(clone_size.count(clone));
   uint64_t size = clone_size.find(clone)->second;
   assert(clone_overlap.count(clone));
-  const interval_set<uint64_t> &overlap = clone_overlap.find(clone)->second;
-  for (interval_set<uint64_t>::const_iterator i = overlap.begin();
+  const extent_set_t &overlap = clone_overlap.find(clone)->second;
+  for (extent_set_t::const_iterator i = overlap.begin();
        i != overlap.end();
        ++i) {
     assert(size >= i.get_len());
@@ -4776,25 +4798,36 @@ void PullOp::generate_test_instances(list<PullOp*> &o)
 
 void PullOp::encode(bufferlist &bl) const
 {
-  ENCODE_START(1, 1, bl);
+  ENCODE_START(2, 1, bl);
   ::encode(soid, bl);
   ::encode(recovery_info, bl);
   ::encode(recovery_progress, bl);
+  ::encode(puller_omap_digest, bl);
+  ::encode(puller_omap_digest_present, bl);
   ENCODE_FINISH(bl);
 }
 
 void PullOp::decode(bufferlist::iterator &bl)
 {
-  DECODE_START(1, bl);
+  DECODE_START(2, bl);
   ::decode(soid, bl);
   ::decode(recovery_info, bl);
   ::decode(recovery_progress, bl);
+  if (struct_v >= 2) {
+    ::decode(puller_omap_digest, bl);
+    ::decode(puller_omap_digest_present, bl);
+  } else {
+    puller_omap_digest = 0;
+    puller_omap_digest_present = false;
+  }
   DECODE_FINISH(bl);
 }
 
 void PullOp::dump(Formatter *f) const
 {
   f->dump_stream("soid") << soid;
+  if (puller_omap_digest_present)
+    f->dump_format("puller_omap_digest", "0x%08x", puller_omap_digest);
   {
     f->open_object_section("recovery_info");
     recovery_info.dump(f);
@@ -4841,7 +4874,7 @@ void PushOp::generate_test_instances(list<PushOp*> &o)
 
 void PushOp::encode(bufferlist &bl) const
 {
-  ENCODE_START(1, 1, bl);
+  ENCODE_START(2, 1, bl);
   ::encode(soid, bl);
   ::encode(version, bl);
   ::encode(data, bl);
@@ -4852,12 +4885,13 @@ void PushOp::encode(bufferlist &bl) const
   ::encode(recovery_info, bl);
   ::encode(after_progress, bl);
   ::encode(before_progress, bl);
+  ::encode(omap_unchanged, bl);
   ENCODE_FINISH(bl);
 }
 
 void PushOp::decode(bufferlist::iterator &bl)
 {
-  DECODE_START(1, bl);
+  DECODE_START(2, bl);
   ::decode(soid, bl);
   ::decode(version, bl);
   ::decode(data, bl);
@@ -4868,6 +4902,10 @@ void PushOp::decode(bufferlist::iterator &bl)
   ::decode(recovery_info, bl);
   ::decode(after_progress, bl);
   ::decode(before_progress, bl);
+  if (struct_v >= 2)
+    ::decode(omap_unchanged, bl);
+  else
+    omap_unchanged = false;
   DECODE_FINISH(bl);
 }
 
@@ -4879,6 +4917,7 @@ void PushOp::dump(Formatter *f) const
   f->dump_stream("data_included") << data_included;
   f->dump_int("omap_header_len", omap_header.length());
   f->dump_int("omap_entries_len", omap_entries.size());
+  f->dump_int("omap_unchanged", omap_unchanged);
   f->dump_int("attrset_len", attrset.size());
   {
     f->open_object_section("recovery_info");
@@ -4906,6 +4945,7 @@ ostream &PushOp::print(ostream &out) const
     << ", data_size: " << data.length()
     << ", omap_header_size: " << omap_header.length()
     << ", omap_entries_size: " << omap_entries.size()
+    << (omap_unchanged ? ", omap_unchanged" : "")
     << ", attrset_size: " << attrset.size()
     << ", recovery_info: " << recovery_info
     << ", after_progress: " << after_progress
@@ -32,6 +32,7 @@
 #include "include/CompatSet.h"
 #include "common/histogram.h"
 #include "include/interval_set.h"
+#include "include/flat_map.h"
 #include "common/Formatter.h"
 #include "common/bloom_filter.hpp"
 #include "common/hobject.h"
@@ -922,6 +923,7 @@ struct pg_pool_t {
     FLAG_NOPGCHANGE = 1<<5, // pool's pg and pgp num can't be changed
     FLAG_NOSIZECHANGE = 1<<6, // pool's size and min size can't be changed
     FLAG_WRITE_FADVISE_DONTNEED = 1<<7, // write mode with LIBRADOS_OP_FLAG_FADVISE_DONTNEED
+    FLAG_COMPRESS = 1<<8, // compress full-object writes inline
   };
 
   static const char *get_flag_name(int f) {
@@ -934,6 +936,7 @@ struct pg_pool_t {
     case FLAG_NOPGCHANGE: return "nopgchange";
     case FLAG_NOSIZECHANGE: return "nosizechange";
     case FLAG_WRITE_FADVISE_DONTNEED: return "write_fadvise_dontneed";
+    case FLAG_COMPRESS: return "compress";
     default: return "???";
     }
   }
@@ -968,6 +971,8 @@ struct pg_pool_t {
       return FLAG_NOSIZECHANGE;
     if (name == "write_fadvise_dontneed")
       return FLAG_WRITE_FADVISE_DONTNEED;
+    if (name == "compress")
+      return FLAG_COMPRESS;
     return 0;
   }
 
@@ -1121,6 +1126,11 @@ public:
                                  ///< user does not specify any expected value
   bool fast_read;            ///< whether turn on fast read on the pool or not
 
+  uint64_t qos_max_iops;     ///< QoS: pool-wide client op/s limit, 0 = unlimited
+  uint64_t qos_max_bps;      ///< QoS: pool-wide client byte/s limit, 0 = unlimited
+
+  bool has_qos() const { return qos_max_iops || qos_max_bps; }
+
   pg_pool_t()
     : flags(0), type(0), size(0), min_size(0),
       crush_ruleset(0), object_hash(0),
@@ -1148,7 +1158,9 @@ public:
       min_write_recency_for_promote(0),
       stripe_width(0),
       expected_num_objects(0),
-      fast_read(false)
+      fast_read(false),
+      qos_max_iops(0),
+      qos_max_bps(0)
   { }
 
   void dump(Formatter *f) const;
@@ -2869,6 +2881,15 @@ inline ostream& operator<<(ostream& out, const OSDSuperblock& sb)
 
 WRITE_CLASS_ENCODER(interval_set<uint64_t>)
 
+/**
+ * extent sets that stay small and get copied on every write op (clone
+ * overlaps, per-op modified ranges) live on the flat sorted-vector
+ * backend: one allocation instead of a node per extent.  The encoding
+ * is identical to the map-backed interval_set<uint64_t>, so the two
+ * interoperate freely on the wire and on disk.
+ */
+typedef interval_set<uint64_t, flat_map_t<uint64_t, uint64_t> > extent_set_t;
+
 
 
 
@@ -2882,7 +2903,7 @@ struct SnapSet {
   bool head_exists;
   vector<snapid_t> snaps;    // descending
   vector<snapid_t> clones;   // ascending
-  map<snapid_t, interval_set<uint64_t> > clone_overlap;  // overlap w/ next newest
+  map<snapid_t, extent_set_t> clone_overlap;  // overlap w/ next newest
   map<snapid_t, uint64_t> clone_size;
 
   SnapSet() : seq(0), head_exists(false) {}
@@ -2936,6 +2957,7 @@ ostream& operator<<(ostream& out, const SnapSet& cs);
 
 #define OI_ATTR "_"
 #define SS_ATTR "snapset"
+#define COMP_ATTR "compression"   // algorithm + logical size of a compressed object
 
 struct watch_info_t {
   uint64_t cookie;
@@ -2992,6 +3014,7 @@ struct object_info_t {
     FLAG_OMAP     = 1 << 3,  // has (or may have) some/any omap data
     FLAG_DATA_DIGEST = 1 << 4,  // has data crc
     FLAG_OMAP_DIGEST = 1 << 5,  // has omap crc
+    FLAG_COMPRESSED = 1 << 6,   // object data is a compressed image (see COMP_ATTR)
     // ...
     FLAG_USES_TMAP = 1<<8,  // deprecated; no longer used.
   } flag_t;
@@ -3014,6 +3037,8 @@ struct object_info_t {
       s += "|data_digest";
     if (flags & FLAG_OMAP_DIGEST)
       s += "|omap_digest";
+    if (flags & FLAG_COMPRESSED)
+      s += "|compressed";
     if (s.length())
       return s.substr(1);
     return s;
@@ -3064,6 +3089,9 @@ struct object_info_t {
   bool is_omap_digest() const {
     return test_flag(FLAG_OMAP_DIGEST);
   }
+  bool is_compressed() const {
+    return test_flag(FLAG_COMPRESSED);
+  }
 
   void set_data_digest(__u32 d) {
     set_flag(FLAG_DATA_DIGEST);
@@ -3084,6 +3112,7 @@ struct object_info_t {
   void new_object() {
     set_data_digest(-1);
     set_omap_digest(-1);
+    clear_flag(FLAG_COMPRESSED);
   }
 
   void encode(bufferlist& bl) const;
@@ -3583,6 +3612,13 @@ struct PullOp {
   ObjectRecoveryInfo recovery_info;
   ObjectRecoveryProgress recovery_progress;
 
+  /// whole-object omap digest of the puller's stale local copy, if
+  /// known; lets the pullee skip an unchanged omap entirely
+  __u32 puller_omap_digest;
+  bool puller_omap_digest_present;
+
+  PullOp() : puller_omap_digest(0), puller_omap_digest_present(false) {}
+
   static void generate_test_instances(list<PullOp*>& o);
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl);
@@ -3607,6 +3643,12 @@ struct PushOp {
   ObjectRecoveryProgress before_progress;
   ObjectRecoveryProgress after_progress;
 
+  /// omap matched the puller's digest and was not transferred; the
+  /// puller keeps its local omap
+  bool omap_unchanged;
+
+  PushOp() : omap_unchanged(false) {}
+
   static void generate_test_instances(list<PushOp*>& o);
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl);
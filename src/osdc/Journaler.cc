@@ -81,6 +81,14 @@ void Journaler::_set_layout(ceph_file_layout const *l)
   if (periods < 2)
     periods = 2;  // we need at least 2 periods to make progress.
   fetch_len = layout.fl_stripe_count * layout.fl_object_size * periods;
+  min_fetch_len = fetch_len;
+
+  // how far the adaptive window may grow; stays fixed if the max isn't
+  // larger than the initial window
+  uint64_t max_periods = cct->_conf->journaler_prefetch_max_periods;
+  if (max_periods < periods)
+    max_periods = periods;
+  max_fetch_len = layout.fl_stripe_count * layout.fl_object_size * max_periods;
 }
 
 
@@ -602,30 +610,42 @@ void Journaler::_do_flush(unsigned amount)
     waiting_for_zero = false;
   }
   ldout(cct, 10) << "_do_flush flushing " << flush_pos << "~" << len << dendl;
-  
+
   // submit write for anything pending
   // flush _start_ pos to _finish_flush
   utime_t now = ceph_clock_now(cct);
   SnapContext snapc;
 
-  Context *onsafe = new C_Flush(this, flush_pos, now);  // on COMMIT
-  pending_safe.insert(flush_pos);
+  // issue the flush in period-aligned chunks so that each object write is
+  // its own in-flight op: completions may come back out of order, but
+  // safe_pos only ever advances to the oldest start in pending_safe, so a
+  // fast write to one object doesn't have to wait for a slow neighbor
+  while (len > 0) {
+    unsigned chunk = len;
+    uint64_t period_off = flush_pos % period;
+    if (period_off + chunk > period)
+      chunk = period - period_off;
 
-  bufferlist write_bl;
+    Context *onsafe = new C_Flush(this, flush_pos, now);  // on COMMIT
+    pending_safe.insert(flush_pos);
 
-  // adjust pointers
-  if (len == write_buf.length()) {
-    write_bl.swap(write_buf);
-  } else {
-    write_buf.splice(0, len, &write_bl);
-  }
+    bufferlist write_bl;
 
-  filer.write(ino, &layout, snapc,
-	      flush_pos, len, write_bl, ceph_clock_now(cct),
-	      0,
-	      NULL, wrap_finisher(onsafe));
+    // adjust pointers
+    if (chunk == write_buf.length()) {
+      write_bl.swap(write_buf);
+    } else {
+      write_buf.splice(0, chunk, &write_bl);
+    }
+
+    filer.write(ino, &layout, snapc,
+		flush_pos, chunk, write_bl, ceph_clock_now(cct),
+		0,
+		NULL, wrap_finisher(onsafe));
 
-  flush_pos += len;
+    flush_pos += chunk;
+    len -= chunk;
+  }
   assert(write_buf.length() == write_pos - flush_pos);
     
   ldout(cct, 10) << "_do_flush (prezeroing/prezero)/write/flush/safe pointers now at "
@@ -802,11 +822,12 @@ void Journaler::_finish_prezero(int r, uint64_t start, uint64_t len)
 class Journaler::C_Read : public Context {
   Journaler *ls;
   uint64_t offset;
+  utime_t stamp;
 public:
   bufferlist bl;
-  C_Read(Journaler *l, uint64_t o) : ls(l), offset(o) {}
+  C_Read(Journaler *l, uint64_t o, utime_t st) : ls(l), offset(o), stamp(st) {}
   void finish(int r) {
-    ls->_finish_read(r, offset, bl);
+    ls->_finish_read(r, offset, stamp, bl);
   }
 };
 
@@ -821,7 +842,8 @@ public:
   }  
 };
 
-void Journaler::_finish_read(int r, uint64_t offset, bufferlist& bl)
+void Journaler::_finish_read(int r, uint64_t offset, utime_t stamp,
+			     bufferlist& bl)
 {
   Mutex::Locker l(lock);
 
@@ -840,6 +862,13 @@ void Journaler::_finish_read(int r, uint64_t offset, bufferlist& bl)
   ldout(cct, 10) << "_finish_read got " << offset << "~" << bl.length() << dendl;
   prefetch_buf[offset].swap(bl);
 
+  utime_t lat = ceph_clock_now(cct);
+  lat -= stamp;
+  if (fetch_lat == 0)
+    fetch_lat = lat;
+  else
+    fetch_lat = fetch_lat * 0.9 + (double)lat * 0.1;
+
   try {
     _assimilate_prefetch();
   } catch (const buffer::error &err) {
@@ -939,16 +968,47 @@ void Journaler::_issue_read(uint64_t len)
     uint64_t l = e - requested_pos;
     if (l > len)
       l = len;
-    C_Read *c = new C_Read(this, requested_pos);
+    C_Read *c = new C_Read(this, requested_pos, ceph_clock_now(cct));
     filer.read(ino, &layout, CEPH_NOSNAP, requested_pos, l, &c->bl, 0, wrap_finisher(c));
     requested_pos += l;
     len -= l;
   }
 }
 
+void Journaler::_adjust_fetch_len()
+{
+  if (max_fetch_len <= min_fetch_len || fetch_lat == 0 || consumed_bytes == 0)
+    return;
+
+  utime_t now = ceph_clock_now(cct);
+  double elapsed = (double)(now - consume_stamp);
+  if (elapsed < 0.1)
+    return;  // sample too short to give a meaningful rate
+
+  // size the window to cover a couple of fetch round trips at the
+  // observed consumption rate, so the reader doesn't drain it while
+  // replacement fetches are in flight
+  double rate = (double)consumed_bytes / elapsed;
+  uint64_t want = (uint64_t)(rate * fetch_lat * 2.0);
+  uint64_t period = get_layout_period();
+  want = ((want + period - 1) / period) * period;
+  want = MAX(want, min_fetch_len);
+  want = MIN(want, max_fetch_len);
+  if (want != fetch_len) {
+    ldout(cct, 10) << "_adjust_fetch_len " << fetch_len << " -> " << want
+		   << " (consuming " << rate << " b/s, fetch latency "
+		   << fetch_lat << "s)" << dendl;
+    fetch_len = want;
+  }
+  consumed_bytes = 0;
+}
+
 void Journaler::_prefetch()
 {
   ldout(cct, 10) << "_prefetch" << dendl;
+
+  _adjust_fetch_len();
+
   // prefetch
   uint64_t pf;
   if (temp_fetch_len) {
@@ -1113,6 +1173,9 @@ bool Journaler::try_read_entry(bufferlist& bl)
 	   << read_pos << "~" << consumed << " (have " << read_buf.length() << ")" << dendl;
 
   read_pos += consumed;
+  if (consumed_bytes == 0)
+    consume_stamp = ceph_clock_now(cct);
+  consumed_bytes += consumed;
   try {
     // We were readable, we might not be any more
     readable = _is_readable();
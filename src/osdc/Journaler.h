@@ -315,16 +315,23 @@ private:
 
   uint64_t fetch_len;     // how much to read at a time
   uint64_t temp_fetch_len;
+  uint64_t min_fetch_len;   // lower bound on fetch_len
+  uint64_t max_fetch_len;   // upper bound on fetch_len
+  double fetch_lat;         // decaying average object fetch latency, in seconds
+  utime_t consume_stamp;    // start of the current consumption rate sample
+  uint64_t consumed_bytes;  // entry bytes consumed since consume_stamp
 
   // for wait_for_readable()
   C_OnFinisher    *on_readable;
   C_OnFinisher    *on_write_error;
   bool             called_write_error;
 
-  void _finish_read(int r, uint64_t offset, bufferlist &bl); // read completion callback
+  void _finish_read(int r, uint64_t offset, utime_t stamp,
+		    bufferlist &bl); // read completion callback
   void _finish_retry_read(int r);
   void _assimilate_prefetch();
   void _issue_read(uint64_t len);  // read some more
+  void _adjust_fetch_len();     // resize prefetch window from observed rates
   void _prefetch();             // maybe read ahead
   class C_Read;
   friend class C_Read;
@@ -386,6 +393,7 @@ public:
     waiting_for_zero(false),
     read_pos(0), requested_pos(0), received_pos(0),
     fetch_len(0), temp_fetch_len(0),
+    min_fetch_len(0), max_fetch_len(0), fetch_lat(0), consumed_bytes(0),
     on_readable(0), on_write_error(NULL), called_write_error(false),
     expire_pos(0), trimming_pos(0), trimmed_pos(0), readable(false),
     stopping(false)
@@ -415,6 +423,11 @@ public:
     requested_pos = 0;
     received_pos = 0;
     fetch_len = 0;
+    min_fetch_len = 0;
+    max_fetch_len = 0;
+    fetch_lat = 0;
+    consume_stamp = utime_t();
+    consumed_bytes = 0;
     assert(!on_readable);
     expire_pos = 0;
     trimming_pos = 0;
@@ -530,6 +530,7 @@ ObjectCacher::ObjectCacher(CephContext *cct_, string name, WritebackHandler& wb,
     cct(cct_), writeback_handler(wb), name(name), lock(l),
     max_dirty(max_dirty), target_dirty(target_dirty),
     max_size(max_bytes), max_objects(max_objects),
+    max_flush_bytes(0),
     block_writes_upfront(block_writes_upfront),
     flush_set_callback(flush_callback), flush_set_callback_arg(flush_callback_arg),
     last_read_tid(0),
@@ -861,6 +862,110 @@ void ObjectCacher::bh_write(BufferHead *bh)
   mark_tx(bh);
 }
 
+void ObjectCacher::bh_write_merged(list<BufferHead*>& blist)
+{
+  assert(lock.is_locked());
+  assert(!blist.empty());
+
+  if (blist.size() == 1) {
+    bh_write(blist.front());
+    return;
+  }
+
+  BufferHead *first = blist.front();
+  Object *ob = first->ob;
+  loff_t start = first->start();
+  loff_t length = blist.back()->end() - start;
+  ldout(cct, 7) << "bh_write_merged " << *ob << " " << start << "~" << length
+		<< " in " << blist.size() << " bhs" << dendl;
+
+  ob->get();
+
+  bufferlist bl;
+  utime_t mtime;
+  for (list<BufferHead*>::iterator p = blist.begin(); p != blist.end(); ++p) {
+    BufferHead *bh = *p;
+    assert(bh->start() == start + (loff_t)bl.length());
+    bl.append(bh->bl);
+    if (bh->last_write > mtime)
+      mtime = bh->last_write;
+  }
+  assert((loff_t)bl.length() == length);
+
+  // one commit covering the whole run; bh_write_commit matches the
+  // individual bhs by range and tid
+  C_WriteCommit *oncommit = new C_WriteCommit(this, ob->oloc.pool,
+					      ob->get_soid(), start, length);
+  ceph_tid_t tid = writeback_handler.write(ob->get_oid(), ob->get_oloc(),
+				      start, length,
+				      first->snapc, bl, mtime,
+				      ob->truncate_size, ob->truncate_seq,
+				      oncommit);
+  ldout(cct, 20) << " tid " << tid << " on " << ob->get_oid() << dendl;
+
+  oncommit->tid = tid;
+  ob->last_write_tid = tid;
+  for (list<BufferHead*>::iterator p = blist.begin(); p != blist.end(); ++p) {
+    (*p)->last_write_tid = tid;
+    mark_tx(*p);
+  }
+
+  if (perfcounter) {
+    perfcounter->inc(l_objectcacher_data_flushed, length);
+  }
+}
+
+loff_t ObjectCacher::bh_write_adjacencies(BufferHead *start_bh)
+{
+  assert(lock.is_locked());
+  Object *ob = start_bh->ob;
+
+  if ((loff_t)start_bh->bl.length() != start_bh->length()) {
+    // don't know how to merge around this one; flush it by itself
+    bh_write(start_bh);
+    return start_bh->length();
+  }
+
+  // gather the contiguous run of dirty buffers around start_bh so the
+  // whole run goes out as one write instead of one op per bh.  only
+  // strictly contiguous buffers with the same snap context can share a
+  // write.
+  list<BufferHead*> blist;
+  blist.push_back(start_bh);
+
+  map<loff_t, BufferHead*>::iterator p = ob->data.find(start_bh->start());
+  assert(p != ob->data.end());
+
+  map<loff_t, BufferHead*>::iterator next = p;
+  ++next;
+  while (next != ob->data.end()) {
+    BufferHead *bh = next->second;
+    if (!bh->is_dirty() ||
+	bh->start() != blist.back()->end() ||
+	bh->snapc.seq != start_bh->snapc.seq ||
+	bh->snapc.snaps != start_bh->snapc.snaps ||
+	(loff_t)bh->bl.length() != bh->length())
+      break;
+    blist.push_back(bh);
+    ++next;
+  }
+  while (p != ob->data.begin()) {
+    --p;
+    BufferHead *bh = p->second;
+    if (!bh->is_dirty() ||
+	bh->end() != blist.front()->start() ||
+	bh->snapc.seq != start_bh->snapc.seq ||
+	bh->snapc.snaps != start_bh->snapc.snaps ||
+	(loff_t)bh->bl.length() != bh->length())
+      break;
+    blist.push_front(bh);
+  }
+
+  loff_t len = blist.back()->end() - blist.front()->start();
+  bh_write_merged(blist);
+  return len;
+}
+
 void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid, loff_t start,
 				   uint64_t length, ceph_tid_t tid, int r)
 {
@@ -962,6 +1067,13 @@ void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid, loff_t start,
 
     if (!ls.empty())
       finish_contexts(cct, ls, r);
+
+    // this commit freed up part of the writeback window; have the
+    // flusher refill it right away rather than on its next tick
+    if (max_flush_bytes &&
+	(uint64_t)get_stat_tx() < max_flush_bytes &&
+	(uint64_t)(get_stat_dirty() + get_stat_dirty_waiting()) > target_dirty)
+      flusher_cond.Signal();
   }
 }
 
@@ -983,9 +1095,8 @@ void ObjectCacher::flush(loff_t amount)
     if (!bh) break;
     if (bh->last_write > cutoff) break;
 
-    did += bh->length();
-    bh_write(bh);
-  }    
+    did += bh_write_adjacencies(bh);
+  }
 }
 
 
@@ -1110,7 +1221,7 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
 	    ldout(cct, 10) << "readx  flushing " << *bh << dendl;
 	    wait = true;
 	    if (bh->is_dirty())
-	      bh_write(bh);
+	      bh_write_adjacencies(bh);
 	  }
 	}
 	if (wait) {
@@ -1549,12 +1660,23 @@ void ObjectCacher::flusher_entry()
     loff_t actual = get_stat_dirty() + get_stat_dirty_waiting();
     if (actual > 0 && (uint64_t) actual > target_dirty) {
       // flush some dirty pages
-      ldout(cct, 10) << "flusher " 
-		     << get_stat_dirty() << " dirty + " << get_stat_dirty_waiting()
-		     << " dirty_waiting > target "
-		     << target_dirty
-		     << ", flushing some dirty bhs" << dendl;
-      flush(actual - target_dirty);
+      loff_t want = actual - target_dirty;
+      if (max_flush_bytes) {
+	// stay within the writeback window; completed writes wake us
+	// up to issue more, keeping the window topped up instead of
+	// bursting once a second
+	loff_t can = (loff_t)max_flush_bytes - get_stat_tx();
+	if (can < want)
+	  want = can;
+      }
+      if (want > 0) {
+	ldout(cct, 10) << "flusher "
+		       << get_stat_dirty() << " dirty + " << get_stat_dirty_waiting()
+		       << " dirty_waiting > target "
+		       << target_dirty
+		       << ", flushing " << want << " of it" << dendl;
+	flush(want);
+      }
     } else {
       // check tail of lru for old dirty items
       utime_t cutoff = ceph_clock_now(cct);
@@ -1565,7 +1687,7 @@ void ObjectCacher::flusher_entry()
 	     bh->last_write < cutoff &&
 	     --max > 0) {
 	ldout(cct, 10) << "flusher flushing aged dirty bh " << *bh << dendl;
-	bh_write(bh);
+	bh_write_adjacencies(bh);
       }
       if (!max) {
 	// back off the lock to avoid starving other threads
@@ -1696,7 +1818,7 @@ bool ObjectCacher::flush(Object *ob, loff_t offset, loff_t length)
     if (!bh->is_dirty()) {
       continue;
     }
-    bh_write(bh);
+    bh_write_adjacencies(bh);
     clean = false;
   }
   return clean;
@@ -1742,7 +1864,7 @@ bool ObjectCacher::flush_set(ObjectSet *oset, Context *onfinish)
     waitfor_commit.insert(bh->ob);
 
     if (bh->is_dirty())
-      bh_write(bh);
+      bh_write_adjacencies(bh);
 
     it = next;
   }
@@ -201,6 +201,8 @@ class ObjectCacher {
 
   public:
     map<loff_t, BufferHead*>     data;
+    map<loff_t, BufferHead*>::iterator hint;  ///< last data_lower_bound result
+    loff_t hint_start;   ///< start() of *hint, or -1 if the hint is invalid
 
     ceph_tid_t last_write_tid;  // version of bh (if non-zero)
     ceph_tid_t last_commit_tid; // last update commited.
@@ -221,6 +223,7 @@ class ObjectCacher {
       oid(o), object_no(ono), oset(os), set_item(this), oloc(l),
       truncate_size(ts), truncate_seq(tq),
       complete(false), exists(true),
+      hint_start(-1),
       last_write_tid(0), last_commit_tid(0),
       dirty_or_tx(0) {
       // add to set
@@ -264,17 +267,46 @@ class ObjectCacher {
     /**
      * find first buffer that includes or follows an offset
      *
+     * Sequential io lands on or just after the buffer we returned last
+     * time, so remember it and walk forward from there when we can;
+     * buffers are disjoint, so everything before the hint ends at or
+     * before the hint's start and cannot be the answer for a larger
+     * offset.  Falls back to an ordinary tree search when the hint is
+     * cold or too far behind.
+     *
      * @param offset object byte offset
      * @return iterator pointing to buffer, or data.end()
      */
     map<loff_t,BufferHead*>::iterator data_lower_bound(loff_t offset) {
-      map<loff_t,BufferHead*>::iterator p = data.lower_bound(offset);
+      map<loff_t,BufferHead*>::iterator p;
+      if (hint_start >= 0 && offset >= hint_start) {
+	p = hint;
+	int steps = 8;
+	while (p != data.end() &&
+	       p->first + p->second->length() <= offset) {
+	  if (--steps == 0)
+	    break;
+	  ++p;
+	}
+	if (steps) {
+	  if (p != data.end()) {
+	    hint = p;
+	    hint_start = p->first;
+	  }
+	  return p;
+	}
+      }
+      p = data.lower_bound(offset);
       if (p != data.begin() &&
 	  (p == data.end() || p->first > offset)) {
 	--p;     // might overlap!
 	if (p->first + p->second->length() <= offset)
 	  ++p;   // doesn't overlap.
       }
+      if (p != data.end()) {
+	hint = p;
+	hint_start = p->first;
+      }
       return p;
     }
 
@@ -288,6 +320,8 @@ class ObjectCacher {
     }
     void remove_bh(BufferHead *bh) {
       assert(data.count(bh->start()));
+      if (bh->start() == hint_start)
+	hint_start = -1;    // hint would dangle
       data.erase(bh->start());
       if (data.empty())
 	put();
@@ -356,6 +390,7 @@ class ObjectCacher {
   Mutex& lock;
   
   uint64_t max_dirty, target_dirty, max_size, max_objects;
+  uint64_t max_flush_bytes;   ///< writeback issued by the flusher in flight at once (0 = no window)
   utime_t max_dirty_age;
   bool block_writes_upfront;
 
@@ -465,6 +500,8 @@ class ObjectCacher {
   // io
   void bh_read(BufferHead *bh, int op_flags);
   void bh_write(BufferHead *bh);
+  void bh_write_merged(list<BufferHead*>& blist);
+  loff_t bh_write_adjacencies(BufferHead *bh);
 
   void trim();
   void flush(loff_t amount=0);
@@ -650,6 +687,9 @@ public:
   void set_max_dirty(uint64_t v) {
     max_dirty = v;
   }
+  void set_max_flush_bytes(uint64_t v) {
+    max_flush_bytes = v;
+  }
   void set_target_dirty(int64_t v) {
     target_dirty = v;
   }
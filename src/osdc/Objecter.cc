@@ -43,6 +43,7 @@
 #include "messages/MWatchNotify.h"
 
 #include <errno.h>
+#include <sys/utsname.h>
 
 #include "common/config.h"
 #include "common/perf_counters.h"
@@ -163,15 +164,34 @@ void Objecter::handle_conf_change(const struct md_config_t *conf,
 				  const std::set <std::string> &changed)
 {
   if (changed.count("crush_location")) {
-    crush_location.clear();
-    vector<string> lvec;
-    get_str_vec(cct->_conf->crush_location, ";, \t", lvec);
-    int r = CrushWrapper::parse_loc_multimap(lvec, &crush_location);
-    if (r < 0) {
-      lderr(cct) << "warning: crush_location '" << cct->_conf->crush_location
-		 << "' does not parse" << dendl;
+    update_crush_location();
+  }
+}
+
+void Objecter::update_crush_location()
+{
+  string loc = cct->_conf->crush_location;
+  if (loc.empty()) {
+    // fall back to this host, so that BALANCE/LOCALIZE_READS can find
+    // a same-host replica without any explicit configuration
+    struct utsname u;
+    if (uname(&u) >= 0) {
+      string host = u.nodename;
+      size_t dot = host.find('.');
+      if (dot != string::npos)
+	host.resize(dot);
+      loc = string("host=") + host;
     }
   }
+  crush_location.clear();
+  vector<string> lvec;
+  get_str_vec(loc, ";, \t", lvec);
+  int r = CrushWrapper::parse_loc_multimap(lvec, &crush_location);
+  if (r < 0) {
+    lderr(cct) << "warning: crush_location '" << loc
+	       << "' does not parse" << dendl;
+  }
+  ldout(cct, 10) << __func__ << " " << crush_location << dendl;
 }
 
 
@@ -288,6 +308,7 @@ void Objecter::init()
   timer.init();
   timer_lock.Unlock();
 
+  update_crush_location();
   cct->_conf->add_observer(this);
 
   initialized.set(1);
@@ -400,6 +421,14 @@ void Objecter::shutdown()
     }
   }
 
+  if (batch_flush_event) {
+    Mutex::Locker l(timer_lock);
+    if (timer.cancel_event(batch_flush_event)) {
+      ldout(cct, 10) <<  " successfully canceled batch flush" << dendl;
+      batch_flush_event = NULL;
+    }
+  }
+
   if (m_request_state_hook) {
     AdminSocket* admin_socket = cct->get_admin_socket();
     admin_socket->unregister_command("objecter_requests");
@@ -2188,8 +2217,10 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
     _maybe_request_map();
   }
 
+  bool batch = need_send && cct->_conf->objecter_op_batch_max > 0;
+
   MOSDOp *m = NULL;
-  if (need_send) {
+  if (need_send && !batch) {
     m = _prepare_osd_op(op);
   }
 
@@ -2199,7 +2230,10 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
   _session_op_assign(s, op);
 
   if (need_send) {
-    _send_op(op, m);
+    if (batch)
+      _batch_op(s, op);
+    else
+      _send_op(op, m);
   }
 
   // Last chance to touch Op here, after giving up session lock it can be
@@ -2887,12 +2921,92 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
   }
 
   op->incarnation = op->session->incarnation;
+  op->batched = false;
 
   m->set_tid(op->tid);
 
   op->session->con->send_message(m);
 }
 
+/* Queue an op on its session instead of sending it right away.  The
+ * batch is flushed when it reaches objecter_op_batch_max ops or when
+ * the objecter_op_batch_window timer fires, whichever comes first.
+ * Sending the batch back to back lets the messenger push the whole
+ * train out in a single burst (it marks a message MSG_MORE while more
+ * output is queued), which is what makes storms of tiny ops to one
+ * OSD cheap. */
+void Objecter::_batch_op(OSDSession *s, Op *op)
+{
+  assert(s->lock.is_wlocked());
+
+  ldout(cct, 15) << __func__ << " " << op->tid << " to osd." << s->osd << dendl;
+
+  op->batched = true;
+  s->batch_ops.push_back(op->tid);
+  if ((int)s->batch_ops.size() >= cct->_conf->objecter_op_batch_max) {
+    _flush_batch(s);
+  } else {
+    _maybe_schedule_batch_flush();
+  }
+}
+
+void Objecter::_flush_batch(OSDSession *s)
+{
+  assert(rwlock.is_locked());
+  assert(s->lock.is_wlocked());
+
+  ldout(cct, 10) << __func__ << " " << s->batch_ops.size()
+		 << " ops to osd." << s->osd << dendl;
+
+  while (!s->batch_ops.empty()) {
+    ceph_tid_t tid = s->batch_ops.front();
+    s->batch_ops.pop_front();
+    map<ceph_tid_t, Op*>::iterator p = s->ops.find(tid);
+    if (p == s->ops.end())
+      continue;       // cancelled before it was ever sent
+    if (!p->second->batched)
+      continue;       // a resend path already sent it
+    _send_op(p->second);
+  }
+}
+
+void Objecter::_maybe_schedule_batch_flush()
+{
+  Mutex::Locker l(timer_lock);
+  if (batch_flush_event)
+    return;
+  batch_flush_event = new C_BatchFlush(this);
+  timer.add_event_after(cct->_conf->objecter_op_batch_window,
+			batch_flush_event);
+}
+
+void Objecter::batch_flush()
+{
+  {
+    Mutex::Locker l(timer_lock);
+    // we are only called by C_BatchFlush
+    assert(batch_flush_event);
+    batch_flush_event = NULL;
+  }
+
+  if (!initialized.read()) {
+    // we raced with shutdown
+    ldout(cct, 10) << __func__ << " raced with shutdown" << dendl;
+    return;
+  }
+
+  RWLock::RLocker rl(rwlock);
+  for (map<int, OSDSession*>::iterator p = osd_sessions.begin();
+       p != osd_sessions.end();
+       ++p) {
+    OSDSession *s = p->second;
+    s->lock.get_write();
+    if (!s->batch_ops.empty())
+      _flush_batch(s);
+    s->lock.unlock();
+  }
+}
+
 int Objecter::calc_op_budget(Op *op)
 {
   int op_budget = 0;
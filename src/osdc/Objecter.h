@@ -1050,6 +1050,7 @@ public:
   virtual const char** get_tracked_conf_keys() const;
   virtual void handle_conf_change(const struct md_config_t *conf,
 				  const std::set <std::string> &changed);
+  void update_crush_location();
 
 public:
   Messenger *messenger;
@@ -1099,6 +1100,16 @@ private:
   void schedule_tick();
   void tick();
 
+  class C_BatchFlush : public Context {
+    Objecter *ob;
+  public:
+    C_BatchFlush(Objecter *o) : ob(o) {}
+    void finish(int r) { ob->batch_flush(); }
+  } *batch_flush_event;
+
+  void _maybe_schedule_batch_flush();
+  void batch_flush();
+
   class RequestStateHook : public AdminSocketHook {
     Objecter *m_objecter;
   public:
@@ -1202,6 +1213,9 @@ public:
     /// true if we should resend this message on failure
     bool should_resend;
 
+    /// true if queued in the session's batch but not yet sent
+    bool batched;
+
     /// true if the throttle budget is get/put on a series of OPs, instead of
     /// per OP basis, when this flag is set, the budget is acquired before sending
     /// the very first OP of the series and released upon receiving the last OP reply.
@@ -1233,6 +1247,7 @@ public:
       map_dne_bound(0),
       budgeted(false),
       should_resend(true),
+      batched(false),
       ctx_budgeted(false),
       data_offset(offset),
       last_force_resend(0) {
@@ -1684,6 +1699,9 @@ public:
     map<uint64_t, LingerOp*>  linger_ops;
     map<ceph_tid_t,CommandOp*>     command_ops;
 
+    /// tids queued but not yet sent; see objecter_op_batch_max
+    list<ceph_tid_t> batch_ops;
+
     int osd;
     int incarnation;
     int num_locks;
@@ -1749,6 +1767,8 @@ public:
 
   MOSDOp *_prepare_osd_op(Op *op);
   void _send_op(Op *op, MOSDOp *m = NULL);
+  void _batch_op(OSDSession *s, Op *op);
+  void _flush_batch(OSDSession *s);
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
   void finish_op(OSDSession *session, ceph_tid_t tid);
@@ -1887,10 +1907,11 @@ private:
     keep_balanced_budget(false), honor_osdmap_full(true),
     last_seen_osdmap_version(0),
     last_seen_pgmap_version(0),
-    rwlock("Objecter::rwlock"),
+    rwlock("Objecter::rwlock", true, cct->_conf->objecter_rwlock_shards),
     timer_lock("Objecter::timer_lock"),
     timer(cct, timer_lock, false),
     logger(NULL), tick_event(NULL),
+    batch_flush_event(NULL),
     m_request_state_hook(NULL),
     num_linger_callbacks(0),
     linger_callback_lock("Objecter::linger_callback_lock"),
@@ -25,6 +25,19 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "striper "
 
+// log2 of v if v is a power of two, else -1.  layout parameters almost
+// always are, which lets the mapping loops divide with shifts and masks.
+static int power_of_two_shift(uint64_t v)
+{
+  if (v == 0 || (v & (v - 1)))
+    return -1;
+  int s = 0;
+  while (v > 1) {
+    v >>= 1;
+    s++;
+  }
+  return s;
+}
 
 void Striper::file_to_extents(CephContext *cct, const char *object_format,
 			    const ceph_file_layout *layout,
@@ -32,6 +45,52 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
 			    vector<ObjectExtent>& extents,
 			    uint64_t buffer_offset)
 {
+  // fast path for the common non-striped layout: each object covers one
+  // contiguous range of the file and objects are visited in increasing
+  // order, so extents can be written straight into the caller's vector
+  // without the merging map
+  if (layout->fl_stripe_count == 1) {
+    ldout(cct, 10) << "file_to_extents " << offset << "~" << len
+		   << " format " << object_format << " (non-striped)" << dendl;
+    assert(len > 0);
+    uint64_t object_size = layout->fl_object_size;
+    int os_shift = power_of_two_shift(object_size);
+    object_locator_t oloc = OSDMap::file_to_object_locator(*layout);
+    extents.reserve(extents.size() +
+		    (offset + len - 1) / object_size - offset / object_size + 1);
+    uint64_t cur = offset;
+    uint64_t left = len;
+    while (left > 0) {
+      uint64_t objectno, x_offset;
+      if (os_shift >= 0) {
+	objectno = cur >> os_shift;
+	x_offset = cur & (object_size - 1);
+      } else {
+	objectno = cur / object_size;
+	x_offset = cur % object_size;
+      }
+      uint64_t x_len = MIN(left, object_size - x_offset);
+
+      char buf[strlen(object_format) + 32];
+      snprintf(buf, sizeof(buf), object_format, (long long unsigned)objectno);
+
+      extents.resize(extents.size() + 1);
+      ObjectExtent *ex = &extents.back();
+      ex->oid = object_t(buf);
+      ex->objectno = objectno;
+      ex->oloc = oloc;
+      ex->offset = x_offset;
+      ex->length = x_len;
+      ex->truncate_size = object_truncate_size(cct, layout, objectno, trunc_size);
+      ex->buffer_extents.push_back(make_pair(cur - offset + buffer_offset, x_len));
+      ldout(cct, 20) << " added new " << *ex << dendl;
+
+      left -= x_len;
+      cur += x_len;
+    }
+    return;
+  }
+
   map<object_t,vector<ObjectExtent> > object_extents;
   file_to_extents(cct, object_format, layout, offset, len, trunc_size,
 		  object_extents, buffer_offset);
@@ -67,14 +126,25 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
   ldout(cct, 20) << " su " << su << " sc " << stripe_count << " os " << object_size
 		 << " stripes_per_object " << stripes_per_object << dendl;
 
+  // compile the layout parameters once: shifts/masks where they are
+  // powers of two, and the (constant) object locator
+  int su_shift = power_of_two_shift(su);
+  int sc_shift = power_of_two_shift(stripe_count);
+  int spo_shift = power_of_two_shift(stripes_per_object);
+  object_locator_t oloc = OSDMap::file_to_object_locator(*layout);
+
   uint64_t cur = offset;
   uint64_t left = len;
   while (left > 0) {
     // layout into objects
-    uint64_t blockno = cur / su;          // which block
-    uint64_t stripeno = blockno / stripe_count;    // which horizontal stripe        (Y)
-    uint64_t stripepos = blockno % stripe_count;   // which object in the object set (X)
-    uint64_t objectsetno = stripeno / stripes_per_object;       // which object set
+    uint64_t blockno = su_shift >= 0 ?            // which block
+      (cur >> su_shift) : cur / su;
+    uint64_t stripeno = sc_shift >= 0 ?           // which horizontal stripe        (Y)
+      (blockno >> sc_shift) : blockno / stripe_count;
+    uint64_t stripepos = sc_shift >= 0 ?          // which object in the object set (X)
+      (blockno & (stripe_count - 1)) : blockno % stripe_count;
+    uint64_t objectsetno = spo_shift >= 0 ?       // which object set
+      (stripeno >> spo_shift) : stripeno / stripes_per_object;
     uint64_t objectno = objectsetno * stripe_count + stripepos;  // object id
 
     // find oid, extent
@@ -83,8 +153,10 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
     object_t oid = buf;
 
     // map range into object
-    uint64_t block_start = (stripeno % stripes_per_object) * su;
-    uint64_t block_off = cur % su;
+    uint64_t block_start = (spo_shift >= 0 ?
+			    (stripeno & (stripes_per_object - 1)) :
+			    stripeno % stripes_per_object) * su;
+    uint64_t block_off = su_shift >= 0 ? (cur & (su - 1)) : cur % su;
     uint64_t max = su - block_off;
 
     uint64_t x_offset = block_start + block_off;
@@ -109,7 +181,7 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
       ex = &exv.back();
       ex->oid = oid;
       ex->objectno = objectno;
-      ex->oloc = OSDMap::file_to_object_locator(*layout);
+      ex->oloc = oloc;
 
       ex->offset = x_offset;
       ex->length = x_len;
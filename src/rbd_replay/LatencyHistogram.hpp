@@ -0,0 +1,69 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef _INCLUDED_RBD_REPLAY_LATENCYHISTOGRAM_HPP
+#define _INCLUDED_RBD_REPLAY_LATENCYHISTOGRAM_HPP
+
+#include <stdint.h>
+#include <iostream>
+#include <string>
+
+namespace rbd_replay {
+
+/**
+   Power-of-two latency histogram, written in one common text format by
+   both rbd-replay-prep (captured latencies from the trace) and
+   rbd-replay (latencies observed during replay) so the two can be
+   compared directly.
+ */
+class LatencyHistogram {
+public:
+  static const int NUM_BINS = 32;
+
+  LatencyHistogram()
+    : m_count(0),
+      m_total_ns(0) {
+    for (int i = 0; i < NUM_BINS; i++) {
+      m_bins[i] = 0;
+    }
+  }
+
+  void add(uint64_t ns) {
+    m_count++;
+    m_total_ns += ns;
+    int bin = 0;
+    while (ns > 1 && bin < NUM_BINS - 1) {
+      ns >>= 1;
+      bin++;
+    }
+    m_bins[bin]++;
+  }
+
+  /// One line: "<name> count <n> total_ns <t> bins <b0> ... <b31>"
+  void write(std::ostream& out, const std::string& name) const {
+    out << name << " count " << m_count << " total_ns " << m_total_ns
+	<< " bins";
+    for (int i = 0; i < NUM_BINS; i++) {
+      out << " " << m_bins[i];
+    }
+    out << std::endl;
+  }
+
+private:
+  uint64_t m_count;
+  uint64_t m_total_ns;
+  uint64_t m_bins[NUM_BINS];
+};
+
+}
+
+#endif
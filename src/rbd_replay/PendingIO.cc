@@ -26,10 +26,13 @@ void rbd_replay_pending_io_callback(librbd::completion_t cb, void *arg) {
 }
 
 PendingIO::PendingIO(action_id_t id,
-		     ActionCtx &worker)
+		     ActionCtx &worker,
+		     char latency_type)
   : m_id(id),
     m_completion(new librbd::RBD::AioCompletion(this, rbd_replay_pending_io_callback)),
-    m_worker(worker) {
+    m_worker(worker),
+    m_latency_type(latency_type),
+    m_start_time(boost::get_system_time()) {
     }
 
 PendingIO::~PendingIO() {
@@ -16,6 +16,7 @@
 #define _INCLUDED_RBD_REPLAY_PENDINGIO_HPP
 
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/thread_time.hpp>
 #include "actions.hpp"
 
 /// Do not call outside of rbd_replay::PendingIO.
@@ -31,8 +32,13 @@ class PendingIO : public boost::enable_shared_from_this<PendingIO> {
 public:
   typedef boost::shared_ptr<PendingIO> ptr;
 
+  /**
+     @param latency_type 'r' for reads, 'w' for writes, 0 for anything
+            whose latency should not be recorded (open/close)
+   */
   PendingIO(action_id_t id,
-            ActionCtx &worker);
+            ActionCtx &worker,
+            char latency_type = 0);
 
   ~PendingIO();
 
@@ -40,6 +46,15 @@ public:
     return m_id;
   }
 
+  char latency_type() const {
+    return m_latency_type;
+  }
+
+  /// Nanoseconds elapsed since the pending %IO was created.
+  uint64_t elapsed_ns() const {
+    return (boost::get_system_time() - m_start_time).total_nanoseconds();
+  }
+
   ceph::bufferlist &bufferlist() {
     return m_bl;
   }
@@ -57,6 +72,8 @@ private:
   ceph::bufferlist m_bl;
   librbd::RBD::AioCompletion *m_completion;
   ActionCtx &m_worker;
+  const char m_latency_type;
+  const boost::system_time m_start_time;
 };
 
 }
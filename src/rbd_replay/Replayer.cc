@@ -85,6 +85,9 @@ void Worker::run() {
 
 void Worker::remove_pending(PendingIO::ptr io) {
   assert(io);
+  if (io->latency_type()) {
+    m_replayer.record_latency(io->latency_type(), io->elapsed_ns());
+  }
   m_replayer.set_action_complete(io->id());
   boost::mutex::scoped_lock lock(m_pending_ios_mutex);
   size_t num_erased = m_pending_ios.erase(io->id());
@@ -201,6 +204,17 @@ void Replayer::run(const std::string& replay_file) {
 	w.second->join();
 	delete w.second;
       }
+      if (!m_latency_histogram_path.empty()) {
+	ofstream lat_out(m_latency_histogram_path.c_str());
+	if (lat_out.is_open()) {
+	  boost::mutex::scoped_lock lock(m_latency_mutex);
+	  m_read_latencies.write(lat_out, "read");
+	  m_write_latencies.write(lat_out, "write");
+	} else {
+	  cerr << "Unable to write latency histograms to "
+	       << m_latency_histogram_path << std::endl;
+	}
+      }
       clear_images();
       delete m_rbd;
       m_rbd = NULL;
@@ -316,6 +330,15 @@ void Replayer::set_latency_multiplier(float f) {
   m_latency_multiplier = f;
 }
 
+void Replayer::record_latency(char type, uint64_t ns) {
+  boost::mutex::scoped_lock lock(m_latency_mutex);
+  if (type == 'r') {
+    m_read_latencies.add(ns);
+  } else if (type == 'w') {
+    m_write_latencies.add(ns);
+  }
+}
+
 bool Replayer::readonly() const {
   return m_readonly;
 }
@@ -19,6 +19,7 @@
 #include <boost/thread/shared_mutex.hpp>
 #include "BoundedBuffer.hpp"
 #include "ImageNameMap.hpp"
+#include "LatencyHistogram.hpp"
 #include "PendingIO.hpp"
 
 namespace rbd_replay {
@@ -108,6 +109,13 @@ public:
 
   void set_latency_multiplier(float f);
 
+  void set_latency_histogram_path(std::string path) {
+    m_latency_histogram_path = path;
+  }
+
+  /// Records an observed replay latency (type 'r' or 'w').
+  void record_latency(char type, uint64_t ns);
+
   bool readonly() const;
 
   void set_readonly(bool readonly);
@@ -149,6 +157,11 @@ private:
   ImageNameMap m_image_name_map;
   bool m_dump_perf_counters;
 
+  std::string m_latency_histogram_path;
+  LatencyHistogram m_read_latencies;
+  LatencyHistogram m_write_latencies;
+  boost::mutex m_latency_mutex;
+
   std::map<imagectx_id_t, librbd::Image*> m_images;
   boost::shared_mutex m_images_mutex;
 
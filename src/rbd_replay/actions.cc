@@ -168,7 +168,7 @@ void AioReadAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_imagectx_id);
   assert(image);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, 'r'));
   worker.add_pending(io);
   int r = image->aio_read(m_offset, m_length, io->bufferlist(), &io->completion());
   assertf(r >= 0, "id = %d, r = %d", id(), r);
@@ -201,7 +201,7 @@ Action::ptr ReadAction::read_from(Action &src, Deser &d) {
 void ReadAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, 'r'));
   worker.add_pending(io);
   ssize_t r = image->read(m_offset, m_length, io->bufferlist());
   assertf(r >= 0, "id = %d, r = %d", id(), r);
@@ -244,7 +244,7 @@ void AioWriteAction::perform(ActionCtx &worker) {
   static const std::string fake_data(create_fake_data());
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, 'w'));
   uint64_t remaining = m_length;
   while (remaining > 0) {
     uint64_t n = std::min(remaining, (uint64_t)fake_data.length());
@@ -287,7 +287,7 @@ Action::ptr WriteAction::read_from(Action &src, Deser &d) {
 void WriteAction::perform(ActionCtx &worker) {
   dout(ACTION_LEVEL) << "Performing " << *this << dendl;
   librbd::Image *image = worker.get_image(m_imagectx_id);
-  PendingIO::ptr io(new PendingIO(pending_io_id(), worker));
+  PendingIO::ptr io(new PendingIO(pending_io_id(), worker, 'w'));
   worker.add_pending(io);
   io->bufferlist().append_zero(m_length);
   if (!worker.readonly()) {
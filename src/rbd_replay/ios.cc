@@ -86,7 +86,8 @@ void IO::write_to(Ser& out, io_type iotype) const {
 
 IO::ptr IO::create_completion(uint64_t start_time, thread_id_t thread_id) {
   assert(!m_completion.lock());
-  IO::ptr completion(new CompletionIO(m_ionum + 1, start_time, thread_id));
+  IO::ptr completion(new CompletionIO(m_ionum + 1, start_time, thread_id,
+				      shared_from_this()));
   m_completion = completion;
   completion->m_dependencies.insert(shared_from_this());
   return completion;
@@ -113,6 +113,26 @@ public:
     return false;
   }
 
+  /// True if this %IO modifies image data or image state.
+  virtual bool is_write() const {
+    return false;
+  }
+
+  /**
+     True if this %IO touches the given byte range of the given image.
+     Open and close count as touching the whole image.  Used for
+     data-overlap dependency tracking (rbd-replay-prep --data-deps).
+   */
+  virtual bool touches(imagectx_id_t imagectx, uint64_t offset,
+		       uint64_t length) const {
+    return false;
+  }
+
+  /// Returns the completion, or NULL if create_completion has not been called.
+  ptr completion() const {
+    return m_completion.lock();
+  }
+
   void set_ionum(action_id_t ionum) {
     m_ionum = ionum;
   }
@@ -207,6 +227,12 @@ public:
 
   void write_debug(std::ostream& out) const;
 
+  bool touches(imagectx_id_t imagectx, uint64_t offset,
+	       uint64_t length) const {
+    return m_imagectx == imagectx &&
+      offset < m_offset + m_length && m_offset < offset + length;
+  }
+
 private:
   imagectx_id_t m_imagectx;
   uint64_t m_offset;
@@ -232,6 +258,16 @@ public:
 
   void write_debug(std::ostream& out) const;
 
+  bool is_write() const {
+    return true;
+  }
+
+  bool touches(imagectx_id_t imagectx, uint64_t offset,
+	       uint64_t length) const {
+    return m_imagectx == imagectx &&
+      offset < m_offset + m_length && m_offset < offset + length;
+  }
+
 private:
   imagectx_id_t m_imagectx;
   uint64_t m_offset;
@@ -257,6 +293,12 @@ public:
 
   void write_debug(std::ostream& out) const;
 
+  bool touches(imagectx_id_t imagectx, uint64_t offset,
+	       uint64_t length) const {
+    return m_imagectx == imagectx &&
+      offset < m_offset + m_length && m_offset < offset + length;
+  }
+
 private:
   imagectx_id_t m_imagectx;
   uint64_t m_offset;
@@ -282,6 +324,16 @@ public:
 
   void write_debug(std::ostream& out) const;
 
+  bool is_write() const {
+    return true;
+  }
+
+  bool touches(imagectx_id_t imagectx, uint64_t offset,
+	       uint64_t length) const {
+    return m_imagectx == imagectx &&
+      offset < m_offset + m_length && m_offset < offset + length;
+  }
+
 private:
   imagectx_id_t m_imagectx;
   uint64_t m_offset;
@@ -313,6 +365,16 @@ public:
 
   void write_debug(std::ostream& out) const;
 
+  bool is_write() const {
+    return true;
+  }
+
+  // opening an image acts as a barrier against everything on it
+  bool touches(imagectx_id_t imagectx, uint64_t offset,
+	       uint64_t length) const {
+    return m_imagectx == imagectx;
+  }
+
 private:
   imagectx_id_t m_imagectx;
   std::string m_name;
@@ -339,6 +401,16 @@ public:
 
   void write_debug(std::ostream& out) const;
 
+  bool is_write() const {
+    return true;
+  }
+
+  // closing an image acts as a barrier against everything on it
+  bool touches(imagectx_id_t imagectx, uint64_t offset,
+	       uint64_t length) const {
+    return m_imagectx == imagectx;
+  }
+
 private:
   imagectx_id_t m_imagectx;
 };
@@ -347,8 +419,10 @@ class CompletionIO : public IO {
 public:
   CompletionIO(action_id_t ionum,
 	       uint64_t start_time,
-	       thread_id_t thread_id)
-    : IO(ionum, start_time, thread_id, IO::ptr()) {
+	       thread_id_t thread_id,
+	       IO::ptr origin)
+    : IO(ionum, start_time, thread_id, IO::ptr()),
+      m_origin(origin) {
   }
 
   void write_to(Ser& out) const {
@@ -358,9 +432,17 @@ public:
     return true;
   }
 
+  /// The %IO this is the completion of.
+  IO::ptr origin() const {
+    return m_origin;
+  }
+
   void write_debug(std::ostream& out) const {
     write_debug_base(out, "completion");
   }
+
+private:
+  IO::ptr m_origin;
 };
 
 /// @related IO
@@ -24,6 +24,7 @@
 #include <fstream>
 #include <boost/thread/thread.hpp>
 #include "ios.hpp"
+#include "LatencyHistogram.hpp"
 
 using namespace std;
 using namespace rbd_replay;
@@ -119,7 +120,14 @@ private:
 };
 
 static void usage(string prog) {
-  cout << "Usage: " << prog << " [ --window <seconds> ] [ --anonymize ] <trace-input> <replay-output>" << endl;
+  cout << "Usage: " << prog << " [ --window <seconds> ] [ --anonymize ] [ --data-deps ] [ --dump-latencies <file> ] <trace-input> <replay-output>" << endl;
+  cout << "  --data-deps              only make reads and writes depend on completions" << endl;
+  cout << "                           they actually overlap with in image data, instead" << endl;
+  cout << "                           of on all recent completions; replays with the" << endl;
+  cout << "                           captured concurrency" << endl;
+  cout << "  --dump-latencies <file>  write captured read/write latency histograms, in" << endl;
+  cout << "                           the same format rbd-replay --latency-histogram" << endl;
+  cout << "                           writes, for comparing capture against replay" << endl;
 }
 
 __attribute__((noreturn)) static void usage_exit(string prog, string msg) {
@@ -139,6 +147,7 @@ public:
       m_ios(vector<IO::ptr>()),
       m_pending_ios(map<uint64_t, IO::ptr>()),
       m_anonymize(false),
+      m_data_deps(false),
       m_anonymized_images(map<string, AnonymizedImage>()) {
   }
 
@@ -160,6 +169,13 @@ public:
 	m_window = (uint64_t)(1e9 * atof(arg.c_str() + sizeof("--window=")));
       } else if (arg == "--anonymize") {
 	m_anonymize = true;
+      } else if (arg == "--data-deps") {
+	m_data_deps = true;
+      } else if (arg == "--dump-latencies") {
+	if (i == nargs - 1) {
+	  usage_exit(args[0], "--dump-latencies requires an argument");
+	}
+	m_latency_file = args[++i];
       } else if (arg == "-h" || arg == "--help") {
 	usage(args[0]);
 	exit(0);
@@ -244,6 +260,10 @@ public:
       }
     }
 
+    if (!m_latency_file.empty()) {
+      dump_latencies(m_latency_file);
+    }
+
     ofstream myfile;
     myfile.open(output_file_name.c_str(), ios::out | ios::binary);
     Ser ser(myfile);
@@ -362,7 +382,7 @@ private:
       require_image(ts, thread, imagectx, name, snap_name, readonly);
       action_id_t ionum = next_id();
       IO::ptr io(new ReadIO(ionum, ts, threadID, thread->pending_io(), imagectx, offset, length));
-      io->add_dependencies(m_recent_completions);
+      io->add_dependencies(relevant_completions(false, imagectx, offset, length));
       thread->issued_io(io, m_threads);
       m_ios.push_back(io);
     } else if (strcmp(event_name, "librbd:open_image_enter") == 0) {
@@ -410,7 +430,7 @@ private:
       require_image(ts, thread, imagectx, name, snap_name, readonly);
       action_id_t ionum = next_id();
       IO::ptr io(new WriteIO(ionum, ts, threadID, thread->pending_io(), imagectx, offset, length));
-      io->add_dependencies(m_recent_completions);
+      io->add_dependencies(relevant_completions(true, imagectx, offset, length));
       thread->issued_io(io, m_threads);
       m_ios.push_back(io);
     } else if (strcmp(event_name, "librbd:write_exit") == 0) {
@@ -428,7 +448,7 @@ private:
       require_image(ts, thread, imagectx, name, snap_name, readonly);
       action_id_t ionum = next_id();
       IO::ptr io(new AioReadIO(ionum, ts, threadID, thread->pending_io(), imagectx, offset, length));
-      io->add_dependencies(m_recent_completions);
+      io->add_dependencies(relevant_completions(false, imagectx, offset, length));
       m_ios.push_back(io);
       thread->issued_io(io, m_threads);
       m_pending_ios[completion] = io;
@@ -443,7 +463,7 @@ private:
       require_image(ts, thread, imagectx, name, snap_name, readonly);
       action_id_t ionum = next_id();
       IO::ptr io(new AioWriteIO(ionum, ts, threadID, thread->pending_io(), imagectx, offset, length));
-      io->add_dependencies(m_recent_completions);
+      io->add_dependencies(relevant_completions(true, imagectx, offset, length));
       thread->issued_io(io, m_threads);
       m_ios.push_back(io);
       m_pending_ios[completion] = io;
@@ -468,6 +488,66 @@ private:
     return id;
   }
 
+  /**
+     Completions a new data %IO must depend on.  By default that is every
+     recent completion, which serializes far more than the captured
+     workload did.  With --data-deps it is only the completions of IOs
+     that actually overlap the new %IO's byte range (read-after-write,
+     write-after-write, write-after-read; reads do not depend on reads),
+     plus opens and closes of the same image, which act as barriers.
+   */
+  io_set_t relevant_completions(bool is_write, imagectx_id_t imagectx,
+				uint64_t offset, uint64_t length) {
+    if (!m_data_deps) {
+      return m_recent_completions;
+    }
+    io_set_t deps;
+    for (io_set_t::const_iterator itr = m_recent_completions.begin();
+	 itr != m_recent_completions.end(); ++itr) {
+      boost::shared_ptr<CompletionIO> c(boost::dynamic_pointer_cast<CompletionIO>(*itr));
+      assert(c);
+      IO::ptr origin(c->origin());
+      if (!origin->touches(imagectx, offset, length)) {
+	continue;
+      }
+      if (!is_write && !origin->is_write()) {
+	continue; // read-after-read is not a data dependency
+      }
+      deps.insert(*itr);
+    }
+    return deps;
+  }
+
+  void dump_latencies(const string& file) {
+    LatencyHistogram reads, writes;
+    for (vector<IO::ptr>::const_iterator itr = m_ios.begin();
+	 itr != m_ios.end(); ++itr) {
+      IO::ptr io(*itr);
+      if (io->is_completion()) {
+	continue;
+      }
+      IO::ptr completion(io->completion());
+      if (!completion) {
+	continue;
+      }
+      uint64_t latency = completion->start_time() - io->start_time();
+      if (boost::dynamic_pointer_cast<ReadIO>(io) ||
+	  boost::dynamic_pointer_cast<AioReadIO>(io)) {
+	reads.add(latency);
+      } else if (boost::dynamic_pointer_cast<WriteIO>(io) ||
+		 boost::dynamic_pointer_cast<AioWriteIO>(io)) {
+	writes.add(latency);
+      }
+    }
+    ofstream out(file.c_str());
+    if (!out.is_open()) {
+      cerr << "Unable to write latency histograms to " << file << endl;
+      exit(1);
+    }
+    reads.write(out, "read");
+    writes.write(out, "write");
+  }
+
   void completed(IO::ptr io) {
     uint64_t limit = io->start_time() < m_window ? 0 : io->start_time() - m_window;
     for (io_set_t::iterator itr = m_recent_completions.begin(); itr != m_recent_completions.end(); ) {
@@ -524,6 +604,8 @@ private:
   map<uint64_t, IO::ptr> m_pending_ios;
 
   bool m_anonymize;
+  bool m_data_deps;
+  string m_latency_file;
   map<string, AnonymizedImage> m_anonymized_images;
 };
 
@@ -39,6 +39,14 @@ static void usage(const char* program) {
   cout << "Options:" << std::endl;
   cout << "  -p, --pool-name <pool>          Name of the pool to use.  Default: rbd" << std::endl;
   cout << "  --latency-multiplier <float>    Multiplies inter-request latencies.  Default: 1" << std::endl;
+  cout << "  --speed <float>                 Replay accelerated by the given factor:" << std::endl;
+  cout << "                                  think time is compressed, but I/O dependency" << std::endl;
+  cout << "                                  ordering is still preserved.  --speed 10 is" << std::endl;
+  cout << "                                  equivalent to --latency-multiplier 0.1." << std::endl;
+  cout << "  --latency-histogram <file>      Write read/write latency histograms observed" << std::endl;
+  cout << "                                  during replay, in the same format" << std::endl;
+  cout << "                                  rbd-replay-prep --dump-latencies writes, for" << std::endl;
+  cout << "                                  comparing replay against capture." << std::endl;
   cout << "  --read-only                     Only perform non-destructive operations." << std::endl;
   cout << "  --map-image <rule>              Add a rule to map image names in the trace to" << std::endl;
   cout << "                                  image names in the replay cluster." << std::endl;
@@ -65,6 +73,8 @@ int main(int argc, const char **argv) {
   std::vector<const char*>::iterator i;
   string pool_name = "rbd";
   float latency_multiplier = 1;
+  float speed = 1;
+  string latency_histogram_path;
   bool readonly = false;
   ImageNameMap image_name_map;
   std::string val;
@@ -81,6 +91,19 @@ int main(int argc, const char **argv) {
 	cerr << err.str() << std::endl;
 	return 1;
       }
+    } else if (ceph_argparse_witharg(args, i, &speed, err, "--speed",
+				     (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return 1;
+      }
+      if (speed <= 0) {
+	cerr << "--speed must be positive" << std::endl;
+	return 1;
+      }
+    } else if (ceph_argparse_witharg(args, i, &val, "--latency-histogram",
+				     (char*)NULL)) {
+      latency_histogram_path = val;
     } else if (ceph_argparse_flag(args, i, "--read-only", (char*)NULL)) {
       readonly = true;
     } else if (ceph_argparse_witharg(args, i, &val, "--map-image", (char*)NULL)) {
@@ -118,7 +141,8 @@ int main(int argc, const char **argv) {
 
   unsigned int nthreads = boost::thread::hardware_concurrency();
   Replayer replayer(2 * nthreads + 1);
-  replayer.set_latency_multiplier(latency_multiplier);
+  replayer.set_latency_multiplier(latency_multiplier / speed);
+  replayer.set_latency_histogram_path(latency_histogram_path);
   replayer.set_pool_name(pool_name);
   replayer.set_readonly(readonly);
   replayer.set_image_name_map(image_name_map);
@@ -2410,7 +2410,7 @@ next:
     formatter->open_array_section("objects");
     while (is_truncated) {
       map<string, RGWObjEnt> result;
-      int r = store->cls_bucket_list(bucket, marker, prefix, 1000, true,
+      int r = store->cls_bucket_list(bucket, marker, prefix, string(), 1000, true,
                                      result, &is_truncated, &marker,
                                      bucket_object_check_filter);
 
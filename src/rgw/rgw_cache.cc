@@ -295,3 +295,64 @@ void ObjectCache::chain_cache(RGWChainedCache *cache) {
   chained_cache.push_back(cache);
 }
 
+
+void RGWDataCache::chunk_name(const string& oid, uint64_t epoch, off_t ofs, off_t len, string *name)
+{
+  char buf[oid.size() + 64];
+  snprintf(buf, sizeof(buf), "%s+%llu+%lld+%lld", oid.c_str(), (unsigned long long)epoch,
+           (long long)ofs, (long long)len);
+  *name = buf;
+}
+
+bool RGWDataCache::get(const string& name, bufferlist *bl)
+{
+  Mutex::Locker l(lock);
+
+  map<string, RGWDataCacheEntry>::iterator iter = cache_map.find(name);
+  if (iter == cache_map.end()) {
+    ldout(cct, 20) << "data cache get: name=" << name << " : miss" << dendl;
+    return false;
+  }
+
+  RGWDataCacheEntry& entry = iter->second;
+  lru.erase(entry.lru_iter);
+  lru.push_back(iter->first);
+  entry.lru_iter = lru.end();
+  --entry.lru_iter;
+
+  *bl = entry.data;
+  ldout(cct, 20) << "data cache get: name=" << name << " : hit" << dendl;
+  return true;
+}
+
+void RGWDataCache::put(const string& name, bufferlist& bl)
+{
+  Mutex::Locker l(lock);
+
+  if (bl.length() > max_size)
+    return;
+
+  if (cache_map.find(name) != cache_map.end()) {
+    /* raced with another request reading the same chunk */
+    return;
+  }
+
+  ldout(cct, 10) << "data cache put: name=" << name << " len=" << bl.length() << dendl;
+
+  RGWDataCacheEntry& entry = cache_map[name];
+  entry.data = bl;
+  lru.push_back(name);
+  entry.lru_iter = lru.end();
+  --entry.lru_iter;
+  size += bl.length();
+
+  while (size > max_size && !lru.empty()) {
+    string& victim = lru.front();
+    map<string, RGWDataCacheEntry>::iterator viter = cache_map.find(victim);
+    assert(viter != cache_map.end());
+    ldout(cct, 10) << "data cache evict: name=" << victim << dendl;
+    size -= viter->second.data.length();
+    cache_map.erase(viter);
+    lru.pop_front();
+  }
+}
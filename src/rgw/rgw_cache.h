@@ -10,6 +10,7 @@
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/assert.h"
+#include "common/Mutex.h"
 #include "common/RWLock.h"
 
 enum {
@@ -171,6 +172,35 @@ public:
   void invalidate_all();
 };
 
+struct RGWDataCacheEntry {
+  bufferlist data;
+  std::list<string>::iterator lru_iter;
+};
+
+/*
+ * Byte-bounded LRU of object data chunks, keyed by rados oid, head version
+ * epoch, chunk offset and length.  Tail stripes are never overwritten in
+ * place (every upload writes under a fresh tag) and an overwritten head
+ * object gets a new version epoch, so a stale entry can never be served
+ * again; it just ages out of the LRU.
+ */
+class RGWDataCache {
+  std::map<string, RGWDataCacheEntry> cache_map;
+  std::list<string> lru;
+  uint64_t size;
+  uint64_t max_size;
+  Mutex lock;
+  CephContext *cct;
+
+public:
+  RGWDataCache(CephContext *_cct) : size(0), max_size(_cct->_conf->rgw_data_cache_size),
+                                    lock("RGWDataCache"), cct(_cct) {}
+  bool get(const string& name, bufferlist *bl);
+  void put(const string& name, bufferlist& bl);
+
+  static void chunk_name(const string& oid, uint64_t epoch, off_t ofs, off_t len, string *name);
+};
+
 template <class T>
 class RGWCache  : public T
 {
@@ -67,6 +67,29 @@ int RGWClientIO::write(const char *buf, int len)
 }
 
 
+int RGWClientIO::write(bufferlist& bl, unsigned ofs, unsigned len)
+{
+  /* write straight from the bufferlist's buffers; calling c_str() on a
+   * multi-buffer list would first copy everything into one contiguous
+   * allocation */
+  std::list<bufferptr>::const_iterator it = bl.buffers().begin();
+  for (; it != bl.buffers().end() && len > 0; ++it) {
+    unsigned l = it->length();
+    if (ofs >= l) {
+      ofs -= l;
+      continue;
+    }
+    unsigned n = MIN(l - ofs, len);
+    int r = write(it->c_str() + ofs, n);
+    if (r < 0)
+      return r;
+    ofs = 0;
+    len -= n;
+  }
+
+  return 0;
+}
+
 int RGWClientIO::read(char *buf, int max, int *actual)
 {
   int ret = read_data(buf, max);
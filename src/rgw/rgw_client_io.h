@@ -31,6 +31,7 @@ public:
   void init(CephContext *cct);
   int print(const char *format, ...);
   int write(const char *buf, int len);
+  int write(bufferlist& bl, unsigned ofs, unsigned len);
   virtual void flush() = 0;
   int read(char *buf, int max, int *actual);
 
@@ -128,7 +128,32 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
   return 0;
 }
 
-int RGWGC::process(int index, int max_secs)
+struct gc_pending_io {
+  librados::AioCompletion *c;
+  string pool;
+  string oid;
+};
+
+/* reap completed removals until no more than max_pending remain in flight;
+ * a failed removal clears *remove_tag so the chain is retried next cycle */
+static void reap_pending_ios(std::list<gc_pending_io>& ios, size_t max_pending, bool *remove_tag)
+{
+  while (ios.size() > max_pending) {
+    gc_pending_io io = ios.front();
+    ios.pop_front();
+    io.c->wait_for_complete();
+    int ret = io.c->get_return_value();
+    io.c->release();
+    if (ret == -ENOENT)
+      ret = 0;
+    if (ret < 0) {
+      *remove_tag = false;
+      dout(0) << "failed to remove " << io.pool << ":" << io.oid << " ret=" << ret << dendl;
+    }
+  }
+}
+
+int RGWGC::process(int index, int max_secs, bool *backlog)
 {
   rados::cls::lock::Lock l(gc_index_lock_name);
   utime_t end = ceph_clock_now(g_ceph_context);
@@ -147,7 +172,8 @@ int RGWGC::process(int index, int max_secs)
 
   int ret = l.lock_exclusive(&store->gc_pool_ctx, obj_names[index]);
   if (ret == -EBUSY) { /* already locked by another gc processor */
-    dout(0) << "RGWGC::process() failed to acquire lock on " << obj_names[index] << dendl;
+    /* expected whenever gc workers overlap, not worth shouting about */
+    dout(10) << "RGWGC::process() failed to acquire lock on " << obj_names[index] << dendl;
     return 0;
   }
   if (ret < 0)
@@ -155,7 +181,14 @@ int RGWGC::process(int index, int max_secs)
 
   string marker;
   bool truncated;
-  IoCtx *ctx = new IoCtx;
+  size_t max_io = cct->_conf->rgw_gc_max_concurrent_io;
+  if (max_io < 1)
+    max_io = 1;
+  /* io contexts have to outlive the removals issued through them, so hold
+   * one per pool until everything drained */
+  map<string, IoCtx *> pool_ctxs;
+  std::list<gc_pending_io> pending_ios;
+  bool drop_ios = false;
   do {
     int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
@@ -167,7 +200,6 @@ int RGWGC::process(int index, int max_secs)
     if (ret < 0)
       goto done;
 
-    string last_pool;
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
       bool remove_tag;
@@ -176,22 +208,29 @@ int RGWGC::process(int index, int max_secs)
       cls_rgw_obj_chain& chain = info.chain;
 
       utime_t now = ceph_clock_now(g_ceph_context);
-      if (now >= end)
+      if (now >= end) {
+        if (backlog)
+          *backlog = true;
         goto done;
+      }
 
       remove_tag = true;
       for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
         cls_rgw_obj& obj = *liter;
 
-        if (obj.pool != last_pool) {
-          delete ctx;
+        IoCtx *ctx;
+        map<string, IoCtx *>::iterator piter = pool_ctxs.find(obj.pool);
+        if (piter == pool_ctxs.end()) {
           ctx = new IoCtx;
 	  ret = store->get_rados_handle()->ioctx_create(obj.pool.c_str(), *ctx);
 	  if (ret < 0) {
 	    dout(0) << "ERROR: failed to create ioctx pool=" << obj.pool << dendl;
+	    delete ctx;
 	    continue;
 	  }
-          last_pool = obj.pool;
+          pool_ctxs[obj.pool] = ctx;
+        } else {
+          ctx = piter->second;
         }
 
         ctx->locator_set_key(obj.loc);
@@ -202,17 +241,28 @@ int RGWGC::process(int index, int max_secs)
 	dout(0) << "gc::process: removing " << obj.pool << ":" << key_obj.get_object() << dendl;
 	ObjectWriteOperation op;
 	cls_refcount_put(op, info.tag, true);
-        ret = ctx->operate(key_obj.get_object(), &op);
-	if (ret == -ENOENT)
-	  ret = 0;
+
+        gc_pending_io io;
+        io.c = librados::Rados::aio_create_completion();
+        io.pool = obj.pool;
+        io.oid = key_obj.get_object();
+        ret = ctx->aio_operate(io.oid, io.c, &op);
         if (ret < 0) {
+          io.c->release();
           remove_tag = false;
           dout(0) << "failed to remove " << obj.pool << ":" << key_obj.get_object() << "@" << obj.loc << dendl;
+        } else {
+          pending_ios.push_back(io);
+          reap_pending_ios(pending_ios, max_io - 1, &remove_tag);
         }
 
-        if (going_down()) // leave early, even if tag isn't removed, it's ok
+        if (going_down()) { // leave early, even if tag isn't removed, it's ok
+          drop_ios = true;
           goto done;
+        }
       }
+      /* wait for the whole chain's removals before deciding to drop its tag */
+      reap_pending_ios(pending_ios, 0, &remove_tag);
       if (remove_tag) {
         remove_tags.push_back(info.tag);
 #define MAX_REMOVE_CHUNK 16
@@ -225,14 +275,20 @@ int RGWGC::process(int index, int max_secs)
   } while (truncated);
 
 done:
+  if (!pending_ios.empty()) {
+    bool dummy = drop_ios;
+    reap_pending_ios(pending_ios, 0, &dummy);
+  }
   if (!remove_tags.empty())
     RGWGC::remove(index, remove_tags);
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
-  delete ctx;
+  for (map<string, IoCtx *>::iterator piter = pool_ctxs.begin(); piter != pool_ctxs.end(); ++piter) {
+    delete piter->second;
+  }
   return 0;
 }
 
-int RGWGC::process()
+int RGWGC::process(bool *backlog)
 {
   int max_secs = cct->_conf->rgw_gc_processor_max_time;
 
@@ -243,7 +299,7 @@ int RGWGC::process()
 
   for (int i = 0; i < max_objs; i++) {
     int index = (i + start) % max_objs;
-    ret = process(index, max_secs);
+    ret = process(index, max_secs, backlog);
     if (ret < 0)
       return ret;
   }
@@ -258,34 +314,51 @@ bool RGWGC::going_down()
 
 void RGWGC::start_processor()
 {
-  worker = new GCWorker(cct, this);
-  worker->create();
+  int num_threads = cct->_conf->rgw_gc_processor_threads;
+  if (num_threads < 1)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; i++) {
+    GCWorker *worker = new GCWorker(cct, this, i);
+    worker->create();
+    workers.push_back(worker);
+  }
 }
 
 void RGWGC::stop_processor()
 {
   down_flag.set(1);
-  if (worker) {
-    worker->stop();
-    worker->join();
+  std::list<GCWorker *>::iterator iter;
+  for (iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->stop();
   }
-  delete worker;
-  worker = NULL;
+  for (iter = workers.begin(); iter != workers.end(); ++iter) {
+    (*iter)->join();
+    delete *iter;
+  }
+  workers.clear();
 }
 
 void *RGWGC::GCWorker::entry() {
   do {
     utime_t start = ceph_clock_now(cct);
-    dout(2) << "garbage collection: start" << dendl;
-    int r = gc->process();
+    dout(2) << "garbage collection: start (worker " << id << ")" << dendl;
+    bool backlog = false;
+    int r = gc->process(&backlog);
     if (r < 0) {
       dout(0) << "ERROR: garbage collection process() returned error r=" << r << dendl;
     }
-    dout(2) << "garbage collection: stop" << dendl;
+    dout(2) << "garbage collection: stop (worker " << id << ")" << dendl;
 
     if (gc->going_down())
       break;
 
+    if (backlog) {
+      /* ran out of cycle time with work still queued; go right back in
+       * instead of letting the backlog sit for another period */
+      dout(2) << "garbage collection: backlog remains, starting next round (worker " << id << ")" << dendl;
+      continue;
+    }
+
     utime_t end = ceph_clock_now(cct);
     end -= start;
     int secs = cct->_conf->rgw_gc_processor_period;
@@ -5,11 +5,47 @@
 #include <curl/easy.h>
 #include <curl/multi.h>
 
+#include "common/Mutex.h"
+
 #include "rgw_common.h"
 #include "rgw_http_client.h"
 
 #define dout_subsys ceph_subsys_rgw
 
+static Mutex curl_handles_lock("RGWCurlHandles");
+static std::list<CURL *> curl_handles;
+
+/* pooled easy handles keep their libcurl connection cache across requests,
+ * so repeat requests to the same endpoint (keystone, remote auth) ride an
+ * already open TCP/TLS connection instead of paying setup every time */
+static CURL *get_curl_handle()
+{
+  CURL *h = NULL;
+  curl_handles_lock.Lock();
+  if (!curl_handles.empty()) {
+    h = curl_handles.front();
+    curl_handles.pop_front();
+  }
+  curl_handles_lock.Unlock();
+  if (!h)
+    h = curl_easy_init();
+  return h;
+}
+
+static void release_curl_handle(CephContext *cct, CURL *h)
+{
+  /* reset clears the request state but not the connection cache */
+  curl_easy_reset(h);
+  curl_handles_lock.Lock();
+  if (curl_handles.size() < (size_t)cct->_conf->rgw_curl_pool_size) {
+    curl_handles.push_back(h);
+    h = NULL;
+  }
+  curl_handles_lock.Unlock();
+  if (h)
+    curl_easy_cleanup(h);
+}
+
 static size_t receive_http_header(void *ptr, size_t size, size_t nmemb, void *_info)
 {
   RGWHTTPClient *client = static_cast<RGWHTTPClient *>(_info);
@@ -82,7 +118,7 @@ int RGWHTTPClient::process(const char *method, const char *url)
 
   char error_buf[CURL_ERROR_SIZE];
 
-  curl_handle = curl_easy_init();
+  curl_handle = get_curl_handle();
 
   dout(20) << "sending request to " << url << dendl;
 
@@ -111,24 +147,28 @@ int RGWHTTPClient::process(const char *method, const char *url)
     dout(0) << "curl_easy_performed returned error: " << error_buf << dendl;
     ret = -EINVAL;
   }
-  curl_easy_cleanup(curl_handle);
+  release_curl_handle(cct, curl_handle);
   curl_slist_free_all(h);
 
   return ret;
 }
 
 struct multi_req_data {
+  CephContext *cct;
   CURL *easy_handle;
   CURLM *multi_handle;
   curl_slist *h;
 
-  multi_req_data() : easy_handle(NULL), multi_handle(NULL), h(NULL) {}
+  multi_req_data(CephContext *_cct) : cct(_cct), easy_handle(NULL), multi_handle(NULL), h(NULL) {}
   ~multi_req_data() {
+    if (multi_handle && easy_handle)
+      curl_multi_remove_handle(multi_handle, easy_handle);
+
     if (multi_handle)
       curl_multi_cleanup(multi_handle);
 
     if (easy_handle)
-      curl_easy_cleanup(easy_handle);
+      release_curl_handle(cct, easy_handle);
 
     if (h)
       curl_slist_free_all(h);
@@ -139,13 +179,13 @@ int RGWHTTPClient::init_async(const char *method, const char *url, void **handle
 {
   CURL *easy_handle;
   CURLM *multi_handle;
-  multi_req_data *req_data = new multi_req_data;
+  multi_req_data *req_data = new multi_req_data(cct);
   *handle = (void *)req_data;
 
   char error_buf[CURL_ERROR_SIZE];
 
   multi_handle = curl_multi_init();
-  easy_handle = curl_easy_init();
+  easy_handle = get_curl_handle();
 
   req_data->multi_handle = multi_handle;
   req_data->easy_handle = easy_handle;
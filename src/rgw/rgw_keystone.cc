@@ -42,8 +42,10 @@ int KeystoneToken::parse(CephContext *cct, bufferlist& bl)
   return 0;
 }
 
-bool RGWKeystoneTokenCache::find(const string& token_id, KeystoneToken& token)
+bool RGWKeystoneTokenCache::find(const string& token_id, KeystoneToken& token, bool *invalid)
 {
+  if (invalid)
+    *invalid = false;
   lock.Lock();
   map<string, token_entry>::iterator iter = tokens.find(token_id);
   if (iter == tokens.end()) {
@@ -61,6 +63,17 @@ bool RGWKeystoneTokenCache::find(const string& token_id, KeystoneToken& token)
     if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
     return false;
   }
+
+  if (entry.invalid) {
+    if (invalid)
+      *invalid = true;
+    tokens_lru.push_front(token_id);
+    entry.lru_iter = tokens_lru.begin();
+    lock.Unlock();
+    if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
+    return false;
+  }
+
   token = entry.token;
 
   tokens_lru.push_front(token_id);
@@ -72,7 +85,7 @@ bool RGWKeystoneTokenCache::find(const string& token_id, KeystoneToken& token)
   return true;
 }
 
-void RGWKeystoneTokenCache::add(const string& token_id, KeystoneToken& token)
+void RGWKeystoneTokenCache::add(const string& token_id, KeystoneToken& token, bool invalid)
 {
   lock.Lock();
   map<string, token_entry>::iterator iter = tokens.find(token_id);
@@ -84,6 +97,7 @@ void RGWKeystoneTokenCache::add(const string& token_id, KeystoneToken& token)
   tokens_lru.push_front(token_id);
   token_entry& entry = tokens[token_id];
   entry.token = token;
+  entry.invalid = invalid;
   entry.lru_iter = tokens_lru.begin();
 
   while (tokens_lru.size() > max) {
@@ -97,6 +111,18 @@ void RGWKeystoneTokenCache::add(const string& token_id, KeystoneToken& token)
   lock.Unlock();
 }
 
+void RGWKeystoneTokenCache::add_invalid(const string& token_id)
+{
+  /* remember that keystone rejected this token, so repeated attempts with
+   * the same bad token don't each pay a validation round trip; the entry
+   * ages out with the revocation check interval */
+  KeystoneToken t;
+  t.token.expires = ceph_clock_now(cct).sec() + cct->_conf->rgw_keystone_revocation_interval;
+
+  ldout(cct, 20) << "negative caching token id=" << token_id << dendl;
+  add(token_id, t, true);
+}
+
 void RGWKeystoneTokenCache::invalidate(const string& token_id)
 {
   Mutex::Locker l(lock);
@@ -84,7 +84,10 @@ public:
 
 struct token_entry {
   KeystoneToken token;
+  bool invalid; /* negative entry: keystone rejected this token */
   list<string>::iterator lru_iter;
+
+  token_entry() : invalid(false) {}
 };
 
 class RGWKeystoneTokenCache {
@@ -100,8 +103,9 @@ class RGWKeystoneTokenCache {
 public:
   RGWKeystoneTokenCache(CephContext *_cct, int _max) : cct(_cct), lock("RGWKeystoneTokenCache"), max(_max) {}
 
-  bool find(const string& token_id, KeystoneToken& token);
-  void add(const string& token_id, KeystoneToken& token);
+  bool find(const string& token_id, KeystoneToken& token, bool *invalid = NULL);
+  void add(const string& token_id, KeystoneToken& token, bool invalid = false);
+  void add_invalid(const string& token_id);
   void invalidate(const string& token_id);
 };
 
@@ -91,6 +91,8 @@ class UsageLogger {
   SafeTimer timer;
   utime_t round_timestamp;
 
+  bool flush_pending;
+
   class C_UsageLogTimeout : public Context {
     UsageLogger *logger;
   public:
@@ -101,12 +103,21 @@ class UsageLogger {
     }
   };
 
+  class C_UsageLogFlush : public Context {
+    UsageLogger *logger;
+  public:
+    C_UsageLogFlush(UsageLogger *_l) : logger(_l) {}
+    void finish(int r) {
+      logger->flush();
+    }
+  };
+
   void set_timer() {
     timer.add_event_after(cct->_conf->rgw_usage_log_tick_interval, new C_UsageLogTimeout(this));
   }
 public:
 
-  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), lock("UsageLogger"), num_entries(0), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
+  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), lock("UsageLogger"), num_entries(0), flush_pending(false), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
     timer.init();
     Mutex::Locker l(timer_lock);
     set_timer();
@@ -135,11 +146,16 @@ public:
     usage_map[ub].insert(round_timestamp, entry, &account);
     if (account)
       num_entries++;
-    bool need_flush = (num_entries > cct->_conf->rgw_usage_log_flush_threshold);
+    /* don't flush on the request thread, hand it off to the timer thread;
+     * flush_pending makes sure only one flush gets queued at a time */
+    bool need_flush = (num_entries > cct->_conf->rgw_usage_log_flush_threshold) &&
+                      !flush_pending;
+    if (need_flush)
+      flush_pending = true;
     lock.Unlock();
     if (need_flush) {
       Mutex::Locker l(timer_lock);
-      flush();
+      timer.add_event_after(0, new C_UsageLogFlush(this));
     }
   }
 
@@ -148,6 +164,7 @@ public:
     lock.Lock();
     old_map.swap(usage_map);
     num_entries = 0;
+    flush_pending = false;
     lock.Unlock();
 
     store->log_usage(old_map);
@@ -1465,7 +1465,7 @@ void RGWCreateBucket::execute()
   }
   s->bucket.name = s->bucket_name_str;
   ret = store->create_bucket(s->user, s->bucket, region_name, placement_rule, attrs, info, pobjv,
-                             &ep_objv, creation_time, pmaster_bucket, true);
+                             &ep_objv, creation_time, pmaster_bucket, true, num_shards);
   /* continue if EEXIST and create_bucket will fail below.  this way we can recover
    * from a partial create by retrying it. */
   ldout(s->cct, 20) << "rgw_create_bucket returned ret=" << ret << " bucket=" << s->bucket << dendl;
@@ -3235,7 +3235,14 @@ void RGWCompleteMultipart::execute()
 
   int total_parts = 0;
   int handled_parts = 0;
-  int max_parts = 1000;
+  /* part verification is driven entirely by the meta object's omap, so the
+   * listing is the only per-part I/O on this path. Size it off the client's
+   * part list -- already capped by rgw_multipart_part_upload_limit and held
+   * in memory from the XML -- so a large complete costs a single listing
+   * round trip instead of one per 1000 parts. For old-style upload ids the
+   * unsorted listing re-reads the whole omap on every page, so paging there
+   * was quadratic in the number of parts. */
+  int max_parts = parts->parts.size();
   int marker = 0;
   bool truncated;
 
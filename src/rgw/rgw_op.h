@@ -375,11 +375,12 @@ protected:
   obj_version ep_objv;
   bool has_cors;
   RGWCORSConfiguration cors_config;
+  uint32_t num_shards;
 
   bufferlist in_data;
 
 public:
-  RGWCreateBucket() : ret(0), has_cors(false) {}
+  RGWCreateBucket() : ret(0), has_cors(false), num_shards(0) {}
 
   int verify_permission();
   void pre_exec();
@@ -1457,6 +1457,9 @@ void RGWRados::finalize()
   delete obj_expirer;
   obj_expirer = NULL;
 
+  delete data_cache;
+  data_cache = NULL;
+
   delete rest_master_conn;
 
   map<string, RGWRESTConn *>::iterator iter;
@@ -1654,6 +1657,10 @@ int RGWRados::init_complete()
 
   binfo_cache.init(this);
 
+  if (cct->_conf->rgw_data_cache_size) {
+    data_cache = new RGWDataCache(cct);
+  }
+
   return ret;
 }
 
@@ -2139,14 +2146,57 @@ int RGWRados::log_usage(map<rgw_user_bucket, RGWUsageBatch>& usage_info)
     }
   }
 
-  map<string, rgw_usage_log_info>::iterator liter;
+  if (log_objs.empty())
+    return 0;
 
-  for (liter = log_objs.begin(); liter != log_objs.end(); ++liter) {
-    int r = cls_obj_usage_log_add(liter->first, liter->second);
+  librados::IoCtx io_ctx;
+
+  const char *usage_log_pool = zone.usage_log_pool.name.c_str();
+  librados::Rados *rad = get_rados_handle();
+  int r = rad->ioctx_create(usage_log_pool, io_ctx);
+  if (r == -ENOENT) {
+    rgw_bucket pool(usage_log_pool);
+    r = create_pool(pool);
     if (r < 0)
       return r;
+
+    // retry
+    r = rad->ioctx_create(usage_log_pool, io_ctx);
   }
-  return 0;
+  if (r < 0)
+    return r;
+
+  /* the shard objects are independent, so push all the adds out in
+   * parallel and only then wait for the completions */
+  list<librados::AioCompletion *> completions;
+  map<string, rgw_usage_log_info>::iterator liter;
+
+  for (liter = log_objs.begin(); liter != log_objs.end(); ++liter) {
+    ObjectWriteOperation op;
+    cls_rgw_usage_log_add(op, liter->second);
+
+    librados::AioCompletion *c = librados::Rados::aio_create_completion();
+    int ret = io_ctx.aio_operate(liter->first, c, &op);
+    if (ret < 0) {
+      c->release();
+      if (r >= 0)
+        r = ret;
+      continue;
+    }
+    completions.push_back(c);
+  }
+
+  while (!completions.empty()) {
+    librados::AioCompletion *c = completions.front();
+    completions.pop_front();
+    c->wait_for_complete();
+    int ret = c->get_return_value();
+    c->release();
+    if (ret < 0 && r >= 0)
+      r = ret;
+  }
+
+  return r;
 }
 
 int RGWRados::read_usage(string& user, uint64_t start_epoch, uint64_t end_epoch, uint32_t max_entries,
@@ -2618,7 +2668,8 @@ int RGWRados::Bucket::List::list_objects(int max, vector<RGWObjEnt> *result,
       ldout(cct, 20) << "setting cur_marker=" << cur_marker.name << "[" << cur_marker.instance << "]" << dendl;
     }
     std::map<string, RGWObjEnt> ent_map;
-    int r = store->cls_bucket_list(bucket, cur_marker, cur_prefix, max + 1 - count, params.list_versions, ent_map,
+    int r = store->cls_bucket_list(bucket, cur_marker, cur_prefix, params.delim,
+                            max + 1 - count, params.list_versions, ent_map,
                             &truncated, &cur_marker);
     if (r < 0)
       return r;
@@ -2777,9 +2828,20 @@ int RGWRados::create_bucket(RGWUserInfo& owner, rgw_bucket& bucket,
                             obj_version *pep_objv,
                             time_t creation_time,
                             rgw_bucket *pmaster_bucket,
-			    bool exclusive)
+			    bool exclusive,
+                            uint32_t num_shards)
 {
 #define MAX_CREATE_RETRIES 20 /* need to bound retries */
+  uint32_t index_shards = bucket_index_max_shards;
+  if (num_shards) {
+    /* per-bucket override, e.g. for a bucket expected to take heavy ingest */
+    index_shards = num_shards;
+    if (index_shards > MAX_BUCKET_INDEX_SHARDS_PRIME) {
+      index_shards = MAX_BUCKET_INDEX_SHARDS_PRIME;
+      ldout(cct, 1) << __func__ << " bucket index max shards is too large, reset to value: "
+        << MAX_BUCKET_INDEX_SHARDS_PRIME << dendl;
+    }
+  }
   string selected_placement_rule;
   for (int i = 0; i < MAX_CREATE_RETRIES; i++) {
     int ret = 0;
@@ -2813,7 +2875,7 @@ int RGWRados::create_bucket(RGWUserInfo& owner, rgw_bucket& bucket,
     string dir_oid =  dir_oid_prefix;
     dir_oid.append(bucket.marker);
 
-    r = init_bucket_index(bucket, bucket_index_max_shards);
+    r = init_bucket_index(bucket, index_shards);
     if (r < 0)
       return r;
 
@@ -2829,7 +2891,7 @@ int RGWRados::create_bucket(RGWUserInfo& owner, rgw_bucket& bucket,
     info.owner = owner.user_id;
     info.region = region_name;
     info.placement_rule = selected_placement_rule;
-    info.num_shards = bucket_index_max_shards;
+    info.num_shards = index_shards;
     info.bucket_index_shard_hash_type = RGWBucketInfo::MOD;
     if (!creation_time)
       time(&info.creation_time);
@@ -3816,7 +3878,9 @@ public:
                                                                        progress_cb(_progress_cb),
                                                                        progress_data(_progress_data) {}
   int handle_data(bufferlist& bl, off_t ofs, off_t len) {
-    progress_cb(ofs, progress_data);
+    if (progress_cb) {
+      progress_cb(ofs, progress_data);
+    }
 
     bool again;
 
@@ -4395,9 +4459,6 @@ int RGWRados::copy_obj_data(RGWObjectCtx& obj_ctx,
                string *petag,
                struct rgw_err *err)
 {
-  bufferlist first_chunk;
-  RGWObjManifest manifest;
-
   string tag;
   append_rand_alpha(cct, tag, tag, 32);
 
@@ -4412,29 +4473,15 @@ int RGWRados::copy_obj_data(RGWObjectCtx& obj_ctx,
   if (ret < 0)
     return ret;
 
-  off_t ofs = 0;
-
-  do {
-    bufferlist bl;
-    ret = read_op.read(ofs, end, bl);
-
-    uint64_t read_len = ret;
-    bool again;
-
-    do {
-      void *handle;
-
-      ret = processor.handle_data(bl, ofs, NULL, &handle, &again);
-      if (ret < 0) {
-        return ret;
-      }
-      ret = processor.throttle_data(handle, false);
-      if (ret < 0)
-        return ret;
-    } while (again);
+  RGWRadosPutObj cb(&processor, NULL, NULL, NULL);
 
-    ofs += read_len;
-  } while (ofs <= end);
+  /* issue the stripe reads through the windowed aio path (iterate()); the
+   * processor throttles its own in-flight writes, so instead of alternating
+   * one synchronous read round-trip with a batch of writes we keep both
+   * directions in flight */
+  ret = read_op.iterate(0, end, &cb);
+  if (ret < 0)
+    return ret;
 
   string etag;
   map<string, bufferlist>::iterator iter = attrs.find(RGW_ATTR_ETAG);
@@ -4496,7 +4543,7 @@ int RGWRados::delete_bucket(rgw_bucket& bucket, RGWObjVersionTracker& objv_track
 
   do {
 #define NUM_ENTRIES 1000
-    r = cls_bucket_list(bucket, marker, prefix, NUM_ENTRIES, true, ent_map,
+    r = cls_bucket_list(bucket, marker, prefix, string(), NUM_ENTRIES, true, ent_map,
                         &is_truncated, &marker);
     if (r < 0)
       return r;
@@ -6078,6 +6125,8 @@ struct get_obj_data : public RefCountedObject {
   IoCtx io_ctx;
   map<off_t, get_obj_io> io_map;
   map<off_t, librados::AioCompletion *> completion_map;
+  map<off_t, string> cache_key_map;
+  set<off_t> cache_hit_set;
   uint64_t total_read;
   Mutex lock;
   Mutex data_lock;
@@ -6086,6 +6135,7 @@ struct get_obj_data : public RefCountedObject {
   atomic_t cancelled;
   atomic_t err_code;
   Throttle throttle;
+  uint64_t window_size;
   list<bufferlist> read_list;
 
   get_obj_data(CephContext *_cct)
@@ -6093,7 +6143,8 @@ struct get_obj_data : public RefCountedObject {
       rados(NULL), ctx(NULL),
       total_read(0), lock("get_obj_data"), data_lock("get_obj_data::data_lock"),
       client_cb(NULL),
-      throttle(cct, "get_obj_data", cct->_conf->rgw_get_obj_window_size, false) {}
+      throttle(cct, "get_obj_data", cct->_conf->rgw_get_obj_window_size, false),
+      window_size(cct->_conf->rgw_get_obj_window_size) {}
   virtual ~get_obj_data() { } 
   void set_cancelled(int r) {
     cancelled.set(1);
@@ -6108,6 +6159,21 @@ struct get_obj_data : public RefCountedObject {
     return err_code.read();
   }
 
+  /* called when issuing the next read had to wait for window space; the
+   * window is then full of in-flight reads, so the request is capped by
+   * the window and not by the osds. Widen it up to the configured max,
+   * mirroring how the put processor grows its window when acks drain
+   * quickly. Completions free the window, so a slow client just stops
+   * blocking on the throttle and the window stays put. */
+  void grow_window() {
+    uint64_t max_window = cct->_conf->rgw_get_obj_max_window_size;
+    if (window_size >= max_window)
+      return;
+    window_size = min(window_size * 2, max_window);
+    ldout(cct, 20) << "growing get obj window to " << window_size << dendl;
+    throttle.reset_max(window_size);
+  }
+
   int wait_next_io(bool *done) {
     lock.Lock();
     map<off_t, librados::AioCompletion *>::iterator iter = completion_map.begin();
@@ -6136,12 +6202,17 @@ struct get_obj_data : public RefCountedObject {
     return r;
   }
 
-  void add_io(off_t ofs, off_t len, bufferlist **pbl, AioCompletion **pc) {
+  void add_io(off_t ofs, off_t len, bufferlist **pbl, AioCompletion **pc,
+              const string& cache_key) {
     Mutex::Locker l(lock);
 
     get_obj_io& io = io_map[ofs];
     *pbl = &io.bl;
 
+    if (!cache_key.empty()) {
+      cache_key_map[ofs] = cache_key;
+    }
+
     struct get_obj_aio_data aio;
     aio.ofs = ofs;
     aio.len = len;
@@ -6162,6 +6233,29 @@ struct get_obj_data : public RefCountedObject {
     get();
   }
 
+  void add_cached_io(off_t ofs, bufferlist& bl) {
+    Mutex::Locker l(lock);
+
+    get_obj_io& io = io_map[ofs];
+    io.bl.claim(bl);
+    cache_hit_set.insert(ofs);
+  }
+
+  /* move any in-order completed (or cached) ios starting at ofs to the
+   * read list; mirrors what get_obj_aio_completion_cb() does when an aio
+   * finishes */
+  int drain_complete_ios(off_t ofs) {
+    list<bufferlist> bl_list;
+
+    Mutex::Locker l(data_lock);
+    int r = get_complete_ios(ofs, bl_list);
+    if (r < 0) {
+      return r;
+    }
+    read_list.splice(read_list.end(), bl_list);
+    return 0;
+  }
+
   void cancel_io(off_t ofs) {
     ldout(cct, 20) << "get_obj_data::cancel_io() ofs=" << ofs << dendl;
     lock.Lock();
@@ -6199,32 +6293,40 @@ struct get_obj_data : public RefCountedObject {
       return 0;
     }
 
-    map<off_t, librados::AioCompletion *>::iterator aiter;
-    aiter = completion_map.find(ofs);
-    if (aiter == completion_map.end()) {
-    /* completion map does not hold this io, it was cancelled */
-      return 0;
-    }
+    while (liter != io_map.end()) {
+      off_t cur_ofs = liter->first;
 
-    AioCompletion *completion = aiter->second;
-    int r = completion->get_return_value();
-    if (r < 0)
-      return r;
+      if (cache_hit_set.count(cur_ofs) == 0) {
+        map<off_t, librados::AioCompletion *>::iterator aiter = completion_map.find(cur_ofs);
+        if (aiter == completion_map.end()) {
+          /* completion map does not hold this io, it was cancelled */
+          return 0;
+        }
 
-    for (; aiter != completion_map.end(); ++aiter) {
-      completion = aiter->second;
-      if (!completion->is_complete()) {
-        /* reached a request that is not yet complete, stop */
-        break;
-      }
+        AioCompletion *completion = aiter->second;
+        if (!completion->is_complete()) {
+          /* reached a request that is not yet complete, stop */
+          break;
+        }
 
-      r = completion->get_return_value();
-      if (r < 0) {
-        set_cancelled(r); /* mark it as cancelled, so that we don't continue processing next operations */
-        return r;
-      }
+        int r = completion->get_return_value();
+        if (r < 0) {
+          set_cancelled(r); /* mark it as cancelled, so that we don't continue processing next operations */
+          return r;
+        }
+
+        total_read += r;
 
-      total_read += r;
+        map<off_t, string>::iterator kiter = cache_key_map.find(cur_ofs);
+        if (kiter != cache_key_map.end()) {
+          rados->data_cache_put(kiter->second, liter->second.bl);
+          cache_key_map.erase(kiter);
+        }
+      } else {
+        /* served from the data cache, there never was an aio for it */
+        cache_hit_set.erase(cur_ofs);
+        total_read += liter->second.bl.length();
+      }
 
       map<off_t, get_obj_io>::iterator old_liter = liter++;
       bl_list.push_back(old_liter->second.bl);
@@ -6292,6 +6394,13 @@ done:
   return;
 }
 
+void RGWRados::data_cache_put(const string& name, bufferlist& bl)
+{
+  if (data_cache) {
+    data_cache->put(name, bl);
+  }
+}
+
 int RGWRados::flush_read_list(struct get_obj_data *d)
 {
   d->data_lock.Lock();
@@ -6369,7 +6478,27 @@ int RGWRados::get_obj_iterate_cb(RGWObjectCtx *ctx, RGWObjState *astate,
 
   get_obj_bucket_and_oid_loc(obj, bucket, oid, key);
 
-  d->throttle.get(len);
+  string cache_key;
+  if (data_cache && astate) {
+    RGWDataCache::chunk_name(oid, astate->epoch, read_ofs, len, &cache_key);
+
+    bufferlist cbl;
+    if (data_cache->get(cache_key, &cbl)) {
+      /* serve the chunk locally; it still has to be delivered in offset
+       * order, so queue it as an already-complete io and drain whatever
+       * is ready */
+      d->add_cached_io(obj_ofs, cbl);
+      r = d->drain_complete_ios(obj_ofs);
+      if (r < 0) {
+        return r;
+      }
+      return flush_read_list(d);
+    }
+  }
+
+  if (d->throttle.get(len)) {
+    d->grow_window();
+  }
   if (d->is_cancelled()) {
     return d->get_err_code();
   }
@@ -6377,7 +6506,7 @@ int RGWRados::get_obj_iterate_cb(RGWObjectCtx *ctx, RGWObjState *astate,
   /* add io after we check that we're not cancelled, otherwise we're going to have trouble
    * cleaning up
    */
-  d->add_io(obj_ofs, len, &pbl, &c);
+  d->add_io(obj_ofs, len, &pbl, &c, cache_key);
 
   ldout(cct, 20) << "rados->get_obj_iterate_cb oid=" << oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
   op.read(read_ofs, len, pbl, NULL);
@@ -8252,6 +8381,7 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(rgw_bucket& bucket, uint64_t timeou
 }
 
 int RGWRados::cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const string& prefix,
+		              const string& delimiter,
 		              uint32_t num_entries, bool list_versions, map<string, RGWObjEnt>& m,
 			      bool *is_truncated, rgw_obj_key *last_entry,
 			      bool (*force_check_filter)(const string&  name))
@@ -8268,7 +8398,7 @@ int RGWRados::cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const stri
     return r;
 
   cls_rgw_obj_key start_key(start.name, start.instance);
-  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries, list_versions,
+  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, delimiter, num_entries, list_versions,
                             oids, list_results, cct->_conf->rgw_bucket_index_max_aio)();
   if (r < 0)
     return r;
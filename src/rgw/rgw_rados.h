@@ -23,6 +23,7 @@ class SafeTimer;
 class ACLOwner;
 class RGWGC;
 class RGWObjectExpirer;
+class RGWDataCache;
 
 /* flags for put_obj_meta() */
 #define PUT_OBJ_CREATE      0x01
@@ -1298,6 +1299,8 @@ protected:
 
   Finisher *finisher;
 
+  RGWDataCache *data_cache;
+
 public:
   RGWRados() : max_req_id(0), lock("rados_timer_lock"), watchers_lock("watchers_lock"), timer(NULL),
                gc(NULL), obj_expirer(NULL), use_gc_thread(false), quota_threads(false),
@@ -1311,6 +1314,7 @@ public:
                pools_initialized(false),
                quota_handler(NULL),
                finisher(NULL),
+               data_cache(NULL),
                rest_master_conn(NULL),
                meta_mgr(NULL), data_log(NULL) {}
 
@@ -1432,7 +1436,8 @@ public:
                             obj_version *pep_objv,
                             time_t creation_time,
                             rgw_bucket *master_bucket,
-                            bool exclusive = true);
+                            bool exclusive = true,
+                            uint32_t num_shards = 0 /* 0 == zone default */);
   virtual int add_bucket_placement(std::string& new_pool);
   virtual int remove_bucket_placement(std::string& new_pool);
   virtual int list_placement_set(set<string>& names);
@@ -1967,6 +1972,8 @@ public:
 
   int flush_read_list(struct get_obj_data *d);
 
+  void data_cache_put(const string& name, bufferlist& bl);
+
   int get_obj_iterate_cb(RGWObjectCtx *ctx, RGWObjState *astate,
                          rgw_obj& obj,
                          off_t obj_ofs, off_t read_ofs, off_t len,
@@ -2082,6 +2089,7 @@ public:
   int cls_obj_complete_cancel(BucketShard& bs, string& tag, rgw_obj& obj, uint16_t bilog_flags);
   int cls_obj_set_bucket_tag_timeout(rgw_bucket& bucket, uint64_t timeout);
   int cls_bucket_list(rgw_bucket& bucket, rgw_obj_key& start, const string& prefix,
+                      const string& delimiter,
                       uint32_t num_entries, bool list_versions, map<string, RGWObjEnt>& m,
                       bool *is_truncated, rgw_obj_key *last_entry,
                       bool (*force_check_filter)(const string&  name) = NULL);
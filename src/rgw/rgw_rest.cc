@@ -854,7 +854,9 @@ int RGWPutObj_ObjStore::get_data(bufferlist& bl)
 
   int len = 0;
   if (cl) {
-    bufferptr bp(cl);
+    /* page-aligned so the data travels into librados and out the messenger
+     * without getting rebuffered for alignment */
+    bufferptr bp = buffer::create_page_aligned(cl);
 
     int read_len; /* cio->read() expects int * */
     int r = s->cio->read(bp.c_str(), cl, &read_len);
@@ -8,6 +8,7 @@
 #include "common/Formatter.h"
 #include "common/utf8.h"
 #include "common/ceph_json.h"
+#include "common/strtol.h"
 
 #include "rgw_rest.h"
 #include "rgw_rest_s3.h"
@@ -179,7 +180,7 @@ done:
 
 send_data:
   if (get_data && !ret) {
-    int r = s->cio->write(bl.c_str() + bl_ofs, bl_len);
+    int r = s->cio->write(bl, bl_ofs, bl_len);
     if (r < 0)
       return r;
   }
@@ -629,6 +630,18 @@ int RGWCreateBucket_ObjStore_S3::get_params()
     location_constraint = location_constraint.substr(0, pos);
   }
 
+  const char *shards_str = s->info.env->get("HTTP_X_RGW_BUCKET_INDEX_SHARDS");
+  if (shards_str) {
+    string err;
+    long shards = strict_strtol(shards_str, 10, &err);
+    if (!err.empty() || shards < 0) {
+      ldout(s->cct, 0) << "bad x-rgw-bucket-index-shards: " << shards_str << dendl;
+      return -EINVAL;
+    }
+    num_shards = shards;
+    ldout(s->cct, 10) << "create bucket index shards: " << num_shards << dendl;
+  }
+
   return 0;
 }
 
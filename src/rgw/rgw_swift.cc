@@ -471,7 +471,8 @@ int RGWSwift::validate_keystone_token(RGWRados *store, const string& token, stru
   ldout(cct, 20) << "token_id=" << token_id << dendl;
 
   /* check cache first */
-  if (keystone_token_cache->find(token_id, t)) {
+  bool invalid = false;
+  if (keystone_token_cache->find(token_id, t, &invalid)) {
     rgw_set_keystone_token_auth_info(t, info);
 
     ldout(cct, 20) << "cached token.tenant.id=" << t.token.tenant.id << dendl;
@@ -483,6 +484,11 @@ int RGWSwift::validate_keystone_token(RGWRados *store, const string& token, stru
     return 0;
   }
 
+  if (invalid) {
+    ldout(cct, 20) << "cached invalid token, id=" << token_id << dendl;
+    return -EPERM;
+  }
+
   bufferlist bl;
 
   /* check if that's a self signed token that we can decode */
@@ -522,11 +528,14 @@ int RGWSwift::validate_keystone_token(RGWRados *store, const string& token, stru
   ldout(cct, 20) << "received response: " << bl.c_str() << dendl;
 
   int ret = parse_keystone_token_response(token, bl, info, t);
-  if (ret < 0)
+  if (ret < 0) {
+    keystone_token_cache->add_invalid(token_id);
     return ret;
+  }
 
   if (t.expired()) {
     ldout(cct, 0) << "got expired token: " << t.token.tenant.name << ":" << t.user.name << " expired: " << t.token.expires << dendl;
+    keystone_token_cache->add_invalid(token_id);
     return -EPERM;
   }
 
@@ -10,4 +10,7 @@
      --test-random           do random placements
      --test-map-pg <pgid>    map a pgid to osds
      --test-map-object <objectname> [--pool <poolid>] map an object to osds
+     --test-map-load <file>  project per-osd load from a workload
+                             descriptor; exits 1 if any device would
+                             exceed its capability profile
   [1]
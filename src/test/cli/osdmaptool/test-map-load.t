@@ -0,0 +1,58 @@
+  $ NUM_OSDS=16
+  $ PG_BITS=4
+#
+# create a small map
+#
+  $ OSD_MAP="osdmap"
+  $ osdmaptool --osd_pool_default_size 3 --pg_bits $PG_BITS --createsimple $NUM_OSDS "$OSD_MAP" > /dev/null
+  osdmaptool: osdmap file 'osdmap'
+  $ OUT="$TESTDIR/out"
+#
+# generous capability profile: nothing should be flagged, exit 0
+#
+  $ cat > workload <<EOF
+  > # pool <id> <read_iops> <write_iops> <read_mbps> <write_mbps>
+  > pool 0 1600 800 160 80
+  > device-default 10000 1000
+  > EOF
+  $ osdmaptool --mark-up-in --test-map-load workload "$OSD_MAP" > "$OUT"
+  osdmaptool: osdmap file 'osdmap'
+  $ grep "all devices within" "$OUT" || cat "$OUT"
+  all devices within their capability profiles
+#
+# tiny capability profile: everything flagged, exit 1
+#
+  $ cat > workload <<EOF
+  > pool 0 1600 800 160 80
+  > device-default 1 1
+  > EOF
+  $ osdmaptool --mark-up-in --test-map-load workload "$OSD_MAP" > "$OUT"
+  osdmaptool: osdmap file 'osdmap'
+  [1]
+  $ grep -c OVERLOADED "$OUT"
+  16
+#
+# per-device override: only osd.0 uncapped
+#
+  $ cat > workload <<EOF
+  > pool 0 1600 800 160 80
+  > device-default 1 1
+  > device 0 10000 1000
+  > EOF
+  $ osdmaptool --mark-up-in --test-map-load workload "$OSD_MAP" > "$OUT"
+  osdmaptool: osdmap file 'osdmap'
+  [1]
+  $ grep -c OVERLOADED "$OUT"
+  15
+#
+# unparseable descriptor
+#
+  $ echo "bogus line" > workload
+  $ osdmaptool --test-map-load workload "$OSD_MAP"
+  osdmaptool: osdmap file 'osdmap'
+  osdmaptool: workload:1: couldn't parse 'bogus line'
+  [1]
+#
+# cleanup
+#
+  $ rm -f workload "$OSD_MAP" "$OUT"
@@ -128,3 +128,32 @@ TEST(Readahead, alignment) {
   ASSERT_RA(1400, 300, r.update(1290, 10, Readahead::NO_LIMIT)); // internal readahead size 320
   ASSERT_RA(0, 0, r.update(1300, 10, Readahead::NO_LIMIT));
 }
+
+TEST(Readahead, multiple_streams) {
+  Readahead r;
+  r.set_trigger_requests(2);
+  r.set_max_streams(2);
+  // two interleaved sequential streams, far enough apart not to look strided
+  const uint64_t b = 1ull << 30;
+  ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(b, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1010, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(b + 10, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1030, 20, r.update(1020, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(b + 30, 20, r.update(b + 20, 10, Readahead::NO_LIMIT));
+}
+
+TEST(Readahead, strided) {
+  Readahead r;
+  r.set_trigger_requests(2);
+  r.set_max_streams(2);
+  ASSERT_RA(0, 0, r.update(1000, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(0, 0, r.update(1100, 10, Readahead::NO_LIMIT)); // stride candidate
+  ASSERT_RA(1300, 200, r.update(1200, 10, Readahead::NO_LIMIT)); // stride confirmed
+  ASSERT_RA(0, 0, r.update(1300, 10, Readahead::NO_LIMIT));
+  ASSERT_RA(1500, 400, r.update(1400, 10, Readahead::NO_LIMIT));
+  uint64_t hits, misses;
+  r.get_stream_counts(&hits, &misses);
+  ASSERT_EQ((uint64_t)3, hits);
+  ASSERT_EQ((uint64_t)2, misses);
+}
@@ -252,6 +252,47 @@ TEST_F(ThrottleTest, destructor) {
   }
 }
 
+TEST_F(ThrottleTest, adaptive_static) {
+  // without a policy it is a plain throttle pinned at the ceiling
+  AdaptiveThrottle throttle(g_ceph_context, "throttle", 10);
+  ASSERT_FALSE(throttle.adaptive());
+  ASSERT_EQ(throttle.get_max(), 10);
+  ASSERT_FALSE(throttle.get(5));
+  ASSERT_TRUE(throttle.should_wait(6));
+  ASSERT_EQ(throttle.put(5), 0);
+  // latency feedback is ignored
+  for (int i = 0; i < 1000; ++i)
+    throttle.notify_latency(utime_t(1, 0));
+  ASSERT_EQ(throttle.get_max(), 10);
+}
+
+TEST_F(ThrottleTest, adaptive_aimd) {
+  AdaptiveThrottle throttle(g_ceph_context, "throttle", 1000);
+  throttle.set_policy(10, 1000, 0.01, 0.99);
+  ASSERT_TRUE(throttle.adaptive());
+  ASSERT_EQ(throttle.get_max(), 1000);
+
+  // a window of samples over target cuts the budget multiplicatively
+  for (int i = 0; i < 256; ++i)
+    throttle.notify_latency(utime_t(0, 100 * 1000 * 1000));
+  ASSERT_EQ(throttle.get_max(), 750);
+
+  // keep overshooting and it bottoms out at the floor
+  for (int w = 0; w < 32; ++w)
+    for (int i = 0; i < 256; ++i)
+      throttle.notify_latency(utime_t(0, 100 * 1000 * 1000));
+  ASSERT_EQ(throttle.get_max(), 10);
+
+  // fast completions grow it back additively, up to the ceiling
+  for (int i = 0; i < 256; ++i)
+    throttle.notify_latency(utime_t(0, 1000 * 1000));
+  ASSERT_EQ(throttle.get_max(), 10 + (1000 >> 5));
+  for (int w = 0; w < 64; ++w)
+    for (int i = 0; i < 256; ++i)
+      throttle.notify_latency(utime_t(0, 1000 * 1000));
+  ASSERT_EQ(throttle.get_max(), 1000);
+}
+
 int main(int argc, char **argv) {
   vector<const char*> args;
   argv_to_vec(argc, (const char **)argv, args);
@@ -200,6 +200,71 @@ TYPED_TEST(BitVectorTest, partial_decode_encode) {
   }
 }
 
+TYPED_TEST(BitVectorTest, data_window) {
+  typename TestFixture::bit_vector_t bit_vector;
+
+  uint64_t elements_per_byte = 8 / bit_vector.BIT_COUNT;
+  bit_vector.resize((3 * CEPH_PAGE_SIZE + 123) * elements_per_byte);
+  for (uint64_t i = 0; i < bit_vector.size(); ++i) {
+    bit_vector[i] = i % 4;
+  }
+
+  bufferlist bl;
+  ::encode(bit_vector, bl);
+
+  // decode only the pages covering a range near the end, mutate it, and
+  // verify the result matches doing the same update on the full vector
+  uint64_t element_offset = (2 * CEPH_PAGE_SIZE + 5) * elements_per_byte;
+  uint64_t element_length = 11;
+
+  typename TestFixture::bit_vector_t windowed;
+  windowed.set_data_window(element_offset, element_length);
+
+  bufferlist header_bl;
+  header_bl.substr_of(bl, 0, windowed.get_header_length());
+  bufferlist::iterator header_it = header_bl.begin();
+  windowed.decode_header(header_it);
+  ASSERT_EQ(bit_vector.size(), windowed.size());
+  ASSERT_LT(windowed.get_data().length(),
+	    bit_vector.get_data().length());
+
+  bufferlist footer_bl;
+  footer_bl.substr_of(bl, windowed.get_footer_offset(),
+		      bl.length() - windowed.get_footer_offset());
+  bufferlist::iterator footer_it = footer_bl.begin();
+  windowed.decode_footer(footer_it);
+
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  windowed.get_data_extents(element_offset, element_length, &byte_offset,
+			    &byte_length);
+
+  bufferlist data_bl;
+  data_bl.substr_of(bl, windowed.get_header_length() + byte_offset,
+		    byte_length);
+  bufferlist::iterator data_it = data_bl.begin();
+  windowed.decode_data(data_it, byte_offset);
+
+  for (uint64_t i = element_offset; i < element_offset + element_length; ++i) {
+    ASSERT_EQ(bit_vector[i], windowed[i]);
+    windowed[i] = (windowed[i] + 1) % 4;
+    bit_vector[i] = windowed[i];
+  }
+
+  bufferlist windowed_data_bl;
+  windowed.encode_data(windowed_data_bl, byte_offset, byte_length);
+  bufferlist windowed_footer_bl;
+  windowed.encode_footer(windowed_footer_bl);
+
+  bufferlist full_data_bl;
+  bit_vector.encode_data(full_data_bl, byte_offset, byte_length);
+  bufferlist full_footer_bl;
+  bit_vector.encode_footer(full_footer_bl);
+
+  ASSERT_EQ(full_data_bl, windowed_data_bl);
+  ASSERT_EQ(full_footer_bl, windowed_footer_bl);
+}
+
 TYPED_TEST(BitVectorTest, header_crc) {
   typename TestFixture::bit_vector_t bit_vector;
 
@@ -33,6 +33,62 @@ TEST(BloomFilter, Empty) {
   }
 }
 
+TEST(BloomFilter, Prefetch) {
+  // prefetch is only a hint; verify it is safe on empty and populated
+  // filters and that queries still answer the same afterwards
+  bloom_filter empty;
+  empty.prefetch(12345);
+
+  bloom_filter bf(10, .1, 1);
+  for (int i=0; i<10; ++i)
+    bf.insert(i);
+  for (int i=0; i<10; ++i) {
+    bf.prefetch(i);
+    ASSERT_TRUE(bf.contains(i));
+  }
+}
+
+TEST(BloomFilter, Blocked) {
+  bloom_filter bf(1000, .01, 1, true);
+  ASSERT_TRUE(bf.is_blocked());
+  for (int i=0; i<1000; ++i)
+    bf.insert(i * 732);
+  for (int i=0; i<1000; ++i)
+    ASSERT_TRUE(bf.contains(i * 732));
+
+  // fpp should stay in the same ballpark as the scattered layout
+  int test = 100000;
+  int hit = 0;
+  for (int i=0; i<test; ++i)
+    if (bf.contains(1000000 + i * 732))
+      ++hit;
+  double actual = (double)hit / (double)test;
+  ASSERT_TRUE(actual < .01 * 10);
+
+  // the layout must survive an encode/decode round trip
+  bufferlist bl;
+  ::encode(bf, bl);
+  bloom_filter bf2;
+  bufferlist::iterator p = bl.begin();
+  ::decode(bf2, p);
+  ASSERT_TRUE(bf2.is_blocked());
+  for (int i=0; i<1000; ++i)
+    ASSERT_TRUE(bf2.contains(i * 732));
+}
+
+TEST(BloomFilter, BlockedBatch) {
+  bloom_filter bf(1000, .01, 1, true);
+  std::vector<uint32_t> vals;
+  for (int i=0; i<1000; ++i)
+    vals.push_back(i * 732);
+  bf.insert(&vals[0], vals.size());
+
+  bool out[1000];
+  bf.contains(&vals[0], vals.size(), out);
+  for (unsigned i=0; i<vals.size(); ++i)
+    ASSERT_TRUE(out[i]);
+}
+
 TEST(BloomFilter, Sweep) {
   std::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
   std::cout.precision(5);
@@ -0,0 +1,124 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Red Hat
+ *
+ * LGPL2.1 (see COPYING-LGPL2.1) or later
+ */
+
+#include <gtest/gtest.h>
+
+#include "include/interval_set.h"
+#include "include/flat_map.h"
+
+typedef interval_set<uint64_t> map_set_t;
+typedef interval_set<uint64_t, flat_map_t<uint64_t, uint64_t> > flat_set_t;
+
+TEST(IntervalSet, FlatBasic) {
+  flat_set_t s;
+  ASSERT_TRUE(s.empty());
+  s.insert(10, 10);
+  s.insert(30, 10);
+  ASSERT_EQ(2, s.num_intervals());
+  ASSERT_EQ(20, s.size());
+  ASSERT_TRUE(s.contains(10));
+  ASSERT_TRUE(s.contains(15, 5));
+  ASSERT_FALSE(s.contains(20));
+  ASSERT_FALSE(s.contains(25, 1));
+
+  // merge with the interval in front of us
+  s.insert(20, 10);
+  ASSERT_EQ(1, s.num_intervals());
+  ASSERT_EQ(30, s.size());
+  ASSERT_TRUE(s.contains(10, 30));
+
+  // split an interval
+  s.erase(15, 5);
+  ASSERT_EQ(2, s.num_intervals());
+  ASSERT_EQ(25, s.size());
+  ASSERT_FALSE(s.contains(15));
+  ASSERT_TRUE(s.contains(20, 20));
+}
+
+TEST(IntervalSet, FlatUnionIntersection) {
+  flat_set_t a, b, i, u;
+  a.insert(0, 10);
+  a.insert(20, 10);
+  b.insert(5, 20);
+
+  i.intersection_of(a, b);
+  ASSERT_EQ(10, i.size());
+  ASSERT_TRUE(i.contains(5, 5));
+  ASSERT_TRUE(i.contains(20, 5));
+
+  u.union_of(a, b);
+  ASSERT_EQ(1, u.num_intervals());
+  ASSERT_TRUE(u.contains(0, 30));
+
+  u.subtract(b);
+  // [0,30) minus [5,25) leaves [0,5) and [25,30)
+  ASSERT_EQ(10, u.size());
+  ASSERT_TRUE(u.subset_of(a));
+}
+
+TEST(IntervalSet, CrossBackend) {
+  // binary ops work across backends
+  map_set_t m;
+  flat_set_t f;
+  m.insert(0, 100);
+  f.insert(50, 100);
+
+  map_set_t i;
+  i.intersection_of(m, f);
+  ASSERT_EQ(50, i.size());
+  ASSERT_TRUE(i.contains(50, 50));
+
+  flat_set_t u;
+  u.union_of(f, m);
+  ASSERT_TRUE(u.contains(0, 150));
+
+  // subtract requires its argument to be contained, so take out the
+  // overlap rather than f itself (f extends past the end of m)
+  m.subtract(i);
+  ASSERT_EQ(50, m.size());
+  ASSERT_TRUE(m.contains(0, 50));
+}
+
+TEST(IntervalSet, FlatEncodingCompat) {
+  // the flat backend must encode byte-identically to the map backend
+  map_set_t m;
+  flat_set_t f;
+  for (int i = 0; i < 10; ++i) {
+    m.insert(i * 100, 10 + i);
+    f.insert(i * 100, 10 + i);
+  }
+
+  bufferlist mbl, fbl;
+  ::encode(m, mbl);
+  ::encode(f, fbl);
+  ASSERT_TRUE(mbl.contents_equal(fbl));
+
+  // and decode each other's output
+  map_set_t m2;
+  bufferlist::iterator p = fbl.begin();
+  ::decode(m2, p);
+  ASSERT_TRUE(m == m2);
+
+  flat_set_t f2;
+  p = mbl.begin();
+  ::decode(f2, p);
+  ASSERT_TRUE(f == f2);
+  ASSERT_EQ(f.size(), f2.size());
+}
+
+TEST(IntervalSet, FlatSpanOf) {
+  flat_set_t s, span;
+  s.insert(5, 5);
+  s.insert(20, 5);
+  span.span_of(s, 8, 5);
+  ASSERT_EQ(5, span.size());
+  ASSERT_TRUE(span.contains(8, 2));
+  ASSERT_TRUE(span.contains(20, 3));
+}
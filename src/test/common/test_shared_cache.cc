@@ -30,10 +30,11 @@
 
 class SharedLRUTest : public SharedLRU<unsigned int, int> {
 public:
-  Mutex &get_lock() { return lock; }
-  Cond &get_cond() { return cond; }
+  // the default construction has a single shard
+  Mutex &get_lock() { return shards[0]->lock; }
+  Cond &get_cond() { return shards[0]->cond; }
   map<unsigned int, pair< ceph::weak_ptr<int>, int* > > &get_weak_refs() {
-    return weak_refs;
+    return shards[0]->weak_refs;
   }
 };
 
@@ -83,11 +84,10 @@ public:
       //
       if (delay > 0)
         usleep(delay);
-      {
-        Mutex::Locker l(cache.get_lock());
-        if (cache.waiting == waitting) {
-          break;
-        }
+      // waiting is atomic and bumped under per-shard locks; read it
+      // without any lock
+      if (cache.waiting.read() == (size_t)waitting) {
+        break;
       }
       if (delay > 0) {
         cout << "delay " << delay << "us, is not long enough, try again\n";
@@ -211,6 +211,7 @@ public:
       Message *n = decode_message(g_ceph_context, 0, p);
       if (!n)
 	throw std::runtime_error("failed to decode");
+      n->finish_decode();
       if (n->get_type() != m_object->get_type()) {
 	stringstream ss;
 	ss << "decoded type " << n->get_type() << " instead of expected " << m_object->get_type();
@@ -152,6 +152,30 @@ TEST(ErasureCodeTest, encode_misaligned_non_contiguous)
   }
 }
 
+TEST(ErasureCodeTest, encode_aligned_zero_copy)
+{
+  int k = 3;
+  int m = 1;
+  unsigned chunk_size = ErasureCode::SIMD_ALIGN * 7;
+  ErasureCodeTest erasure_code(k, m, chunk_size);
+
+  set<int> want_to_encode;
+  for (unsigned int i = 0; i < erasure_code.get_chunk_count(); i++)
+    want_to_encode.insert(i);
+  bufferptr ptr(buffer::create_aligned(chunk_size * k, ErasureCode::SIMD_ALIGN));
+  ptr.zero();
+  bufferlist in;
+  in.append(ptr);
+  map<int, bufferlist> encoded;
+
+  ASSERT_TRUE(in.is_aligned(ErasureCode::SIMD_ALIGN));
+  ASSERT_EQ(0, erasure_code.encode(want_to_encode, in, &encoded));
+  // the data chunks must reference the input buffer, not copies of it
+  for (int i = 0; i < k; i++)
+    ASSERT_EQ(in.buffers().front().c_str() + i * chunk_size,
+	      encoded[i].buffers().front().c_str());
+}
+
 int main(int argc, char **argv)
 {
   vector<const char*> args;
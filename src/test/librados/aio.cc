@@ -2768,6 +2768,42 @@ TEST(LibRadosAioEC, RoundTripWriteFullPP2)
   destroy_one_pool_pp(pool_name, cluster);
 }
 
+TEST(LibRadosAio, StatBatch) {
+  AioTestData test_data;
+  rados_completion_t my_completion;
+  ASSERT_EQ("", test_data.init());
+  ASSERT_EQ(0, rados_aio_create_completion((void*)&test_data,
+	      set_completion_complete, set_completion_safe, &my_completion));
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  ASSERT_EQ(0, rados_aio_write(test_data.m_ioctx, "foo",
+			       my_completion, buf, sizeof(buf), 0));
+  {
+    TestAlarm alarm;
+    sem_wait(test_data.m_sem);
+    sem_wait(test_data.m_sem);
+  }
+  ASSERT_EQ(0, rados_aio_get_return_value(my_completion));
+  const char *oids[2] = { "foo", "doesnotexist" };
+  uint64_t psizes[2];
+  time_t pmtimes[2];
+  int prvals[2];
+  rados_completion_t my_completion2;
+  ASSERT_EQ(0, rados_aio_create_completion((void*)&test_data,
+	      set_completion_complete, set_completion_safe, &my_completion2));
+  ASSERT_EQ(0, rados_aio_stat_batch(test_data.m_ioctx, my_completion2,
+				    oids, 2, psizes, pmtimes, prvals));
+  {
+    TestAlarm alarm;
+    ASSERT_EQ(0, rados_aio_wait_for_complete(my_completion2));
+  }
+  ASSERT_EQ(-ENOENT, rados_aio_get_return_value(my_completion2));
+  ASSERT_EQ(0, prvals[0]);
+  ASSERT_EQ(-ENOENT, prvals[1]);
+  ASSERT_EQ(sizeof(buf), psizes[0]);
+  rados_aio_release(my_completion);
+  rados_aio_release(my_completion2);
+}
 TEST(LibRadosAioEC, SimpleStat) {
   AioTestDataEC test_data;
   rados_completion_t my_completion;
@@ -856,6 +856,60 @@ TEST_F(TestLibRBD, TestIO)
   rados_ioctx_destroy(ioctx);
 }
 
+TEST_F(TestLibRBD, TestIovecIO)
+{
+  rados_ioctx_t ioctx;
+  rados_ioctx_create(_cluster, m_pool_name.c_str(), &ioctx);
+
+  rbd_image_t image;
+  int order = 0;
+  std::string name = get_temp_image_name();
+  uint64_t size = 2 << 20;
+
+  ASSERT_EQ(0, create_image(ioctx, name.c_str(), size, &order));
+  ASSERT_EQ(0, rbd_open(ioctx, name.c_str(), &image, NULL));
+
+  char test_data[TEST_IO_SIZE];
+  int i;
+  for (i = 0; i < TEST_IO_SIZE; ++i) {
+    test_data[i] = (char) (rand() % (126 - 33) + 33);
+  }
+
+  // scatter the buffer over several segments for both directions
+  struct iovec write_iov[3];
+  write_iov[0].iov_base = test_data;
+  write_iov[0].iov_len = 16;
+  write_iov[1].iov_base = test_data + 16;
+  write_iov[1].iov_len = TEST_IO_SIZE - 64;
+  write_iov[2].iov_base = test_data + TEST_IO_SIZE - 48;
+  write_iov[2].iov_len = 48;
+
+  rbd_completion_t comp;
+  rbd_aio_create_completion(NULL, (rbd_callback_t) simple_write_cb, &comp);
+  ASSERT_EQ(0, rbd_aio_writev(image, write_iov, 3, TEST_IO_SIZE, comp));
+  ASSERT_EQ(0, rbd_aio_wait_for_complete(comp));
+  ASSERT_EQ(TEST_IO_SIZE, rbd_aio_get_return_value(comp));
+  rbd_aio_release(comp);
+
+  char read_data[TEST_IO_SIZE];
+  struct iovec read_iov[2];
+  read_iov[0].iov_base = read_data;
+  read_iov[0].iov_len = TEST_IO_SIZE / 2;
+  read_iov[1].iov_base = read_data + TEST_IO_SIZE / 2;
+  read_iov[1].iov_len = TEST_IO_SIZE - TEST_IO_SIZE / 2;
+
+  rbd_aio_create_completion(NULL, (rbd_callback_t) simple_read_cb, &comp);
+  ASSERT_EQ(0, rbd_aio_readv(image, read_iov, 2, TEST_IO_SIZE, comp));
+  ASSERT_EQ(0, rbd_aio_wait_for_complete(comp));
+  ASSERT_EQ(TEST_IO_SIZE, rbd_aio_get_return_value(comp));
+  rbd_aio_release(comp);
+
+  ASSERT_EQ(0, memcmp(test_data, read_data, TEST_IO_SIZE));
+
+  ASSERT_EQ(0, rbd_close(image));
+  rados_ioctx_destroy(ioctx);
+}
+
 TEST_F(TestLibRBD, TestIOWithIOHint)
 {
   rados_ioctx_t ioctx;
@@ -0,0 +1,37 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * Copyright (C) 2015 Red Hat
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mds/Mutation.h"
+#include "mds/Locker.h"
+
+#include "gtest/gtest.h"
+
+TEST(CapReleaseBatch, Bounded) {
+  // fewer caps than the bound: take them all
+  ASSERT_EQ(7u, Locker::cap_release_batch_size(10000, 7));
+  // more caps than the bound: take exactly the bound; the handler
+  // requeues the rest, so the batch must be non-zero or it livelocks
+  ASSERT_EQ(10000u, Locker::cap_release_batch_size(10000, 500000));
+  ASSERT_EQ(1u, Locker::cap_release_batch_size(1, 500000));
+  // exactly at the bound: take them all, message is freed not requeued
+  ASSERT_EQ(10000u, Locker::cap_release_batch_size(10000, 10000));
+}
+
+TEST(CapReleaseBatch, Unlimited) {
+  // mds_max_cap_releases_per_dispatch = 0 means no bound: the whole
+  // message is processed in one dispatch and never requeued
+  ASSERT_EQ(500000u, Locker::cap_release_batch_size(0, 500000));
+  ASSERT_EQ(0u, Locker::cap_release_batch_size(0, 0));
+  ASSERT_EQ(0u, Locker::cap_release_batch_size(10000, 0));
+}
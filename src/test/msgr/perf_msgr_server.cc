@@ -60,6 +60,7 @@ class ServerDispatcher : public Dispatcher {
     }
     void _process(Message *m, ThreadPool::TPHandle &handle) {
       MOSDOp *osd_op = static_cast<MOSDOp*>(m);
+      osd_op->finish_decode();
       MOSDOpReply *reply = new MOSDOpReply(osd_op, 0, 0, 0, false);
       m->get_connection()->send_message(reply);
       m->put();
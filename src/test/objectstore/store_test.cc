@@ -528,6 +528,67 @@ TEST_P(StoreTest, SimpleAttrTest) {
   }
 }
 
+TEST_P(StoreTest, AsyncReadTest) {
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("async read object", CEPH_NOSNAP)));
+  bufferlist orig;
+  orig.append("abcde");
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.write(cid, hoid, 0, 5, orig);
+    t.setattr(cid, hoid, "foo", orig);
+    map<string,bufferlist> km;
+    km["key1"] = orig;
+    t.omap_setkeys(cid, hoid, km);
+    r = store->apply_transaction(t);
+    ASSERT_EQ(r, 0);
+  }
+  {
+    bufferlist in;
+    C_SaferCond cond;
+    store->queue_read(cid, hoid, 0, 5, &in, &cond);
+    r = cond.wait();
+    ASSERT_EQ(5, r);
+    ASSERT_TRUE(in.contents_equal(orig));
+  }
+  {
+    bufferptr bp;
+    C_SaferCond cond;
+    store->queue_getattr(cid, hoid, "foo", &bp, &cond);
+    r = cond.wait();
+    ASSERT_EQ(0, r);
+    bufferlist bl;
+    bl.append(bp);
+    ASSERT_TRUE(bl.contents_equal(orig));
+  }
+  {
+    bufferlist header;
+    map<string,bufferlist> out;
+    C_SaferCond cond;
+    store->queue_omap_get(cid, hoid, &header, &out, &cond);
+    r = cond.wait();
+    ASSERT_EQ(0, r);
+    ASSERT_EQ(1u, out.size());
+    ASSERT_TRUE(out["key1"].contents_equal(orig));
+  }
+  {
+    ghobject_t noent(hobject_t(sobject_t("no such object", CEPH_NOSNAP)));
+    bufferlist in;
+    C_SaferCond cond;
+    store->queue_read(cid, noent, 0, 5, &in, &cond);
+    ASSERT_EQ(-ENOENT, cond.wait());
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = store->apply_transaction(t);
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, SimpleListTest) {
   int r;
   coll_t cid(spg_t(pg_t(0, 1), shard_id_t(1)));
@@ -1,12 +1,16 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
 #include <chrono>
 #include <cassert>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <random>
+#include <sstream>
 #include <thread>
+#include <vector>
 
 #include "os/ObjectStore.h"
 
@@ -14,6 +18,7 @@
 
 #include "common/strtol.h"
 #include "common/ceph_argparse.h"
+#include "common/Formatter.h"
 
 #define dout_subsys ceph_subsys_filestore
 
@@ -29,7 +34,19 @@ static void usage()
       "	 --threads\n"
       "	       number of threads to carry out this workload\n"
       "	 --multi-object\n"
-      "	       have each thread write to a separate object\n" << dendl;
+      "	       have each thread write to a separate object\n"
+      "	 --workloads\n"
+      "	       comma-separated list from [smallwrite, omap, attr, mixed];\n"
+      "	       runs the workload/queue-depth matrix instead of the write cycle\n"
+      "	 --queue-depths\n"
+      "	       comma-separated queue depths for the matrix (default 1,4,16)\n"
+      "	 --ops\n"
+      "	       transactions per matrix phase (default 4096)\n"
+      "	 --num-objects\n"
+      "	       objects the matrix workloads spread over (default 64)\n"
+      "	 --format\n"
+      "	       matrix output format [json, json-pretty, xml] (default json-pretty)\n"
+      << dendl;
   generic_server_usage();
 }
 
@@ -72,10 +89,18 @@ struct Config {
   int repeats;
   int threads;
   bool multi_object;
+  std::string workloads;
+  std::string queue_depths;
+  int ops;
+  int num_objects;
+  std::string format;
   Config()
     : size(1048576), block_size(4096),
       repeats(1), threads(1),
-      multi_object(false) {}
+      multi_object(false),
+      queue_depths("1,4,16"),
+      ops(4096), num_objects(64),
+      format("json-pretty") {}
 };
 
 class C_NotifyCond : public Context {
@@ -92,6 +117,309 @@ public:
   }
 };
 
+// ---- workload/queue-depth matrix ----
+
+enum workload_t {
+  WORKLOAD_SMALLWRITE,
+  WORKLOAD_OMAP,
+  WORKLOAD_ATTR,
+  WORKLOAD_MIXED,
+};
+
+static bool parse_workload(const std::string &name, workload_t *w)
+{
+  if (name == "smallwrite")
+    *w = WORKLOAD_SMALLWRITE;
+  else if (name == "omap")
+    *w = WORKLOAD_OMAP;
+  else if (name == "attr")
+    *w = WORKLOAD_ATTR;
+  else if (name == "mixed")
+    *w = WORKLOAD_MIXED;
+  else
+    return false;
+  return true;
+}
+
+static const char *workload_name(workload_t w)
+{
+  switch (w) {
+  case WORKLOAD_SMALLWRITE: return "smallwrite";
+  case WORKLOAD_OMAP: return "omap";
+  case WORKLOAD_ATTR: return "attr";
+  case WORKLOAD_MIXED: return "mixed";
+  }
+  return "unknown";
+}
+
+struct phase_result {
+  workload_t workload;
+  int queue_depth;
+  int ops;
+  double duration_sec;
+  std::vector<double> lat_us;  // sorted on completion
+  std::vector<uint64_t> hist;  // log2 buckets of microseconds
+
+  double percentile(double centile) const {
+    if (lat_us.empty())
+      return 0.0;
+    size_t i = (size_t)(centile / 100.0 * lat_us.size() + 0.5);
+    if (i > 0)
+      i--;
+    if (i >= lat_us.size())
+      i = lat_us.size() - 1;
+    return lat_us[i];
+  }
+
+  void dump(Formatter *f) const {
+    f->dump_string("workload", workload_name(workload));
+    f->dump_int("queue_depth", queue_depth);
+    f->dump_int("ops", ops);
+    f->dump_float("duration_sec", duration_sec);
+    f->dump_float("iops", duration_sec > 0 ? ops / duration_sec : 0);
+    f->open_object_section("latency_us");
+    f->dump_float("min", lat_us.empty() ? 0 : lat_us.front());
+    f->dump_float("p50", percentile(50));
+    f->dump_float("p90", percentile(90));
+    f->dump_float("p99", percentile(99));
+    f->dump_float("p999", percentile(99.9));
+    f->dump_float("max", lat_us.empty() ? 0 : lat_us.back());
+    f->close_section();
+    f->open_array_section("histogram_log2_us");
+    for (auto count : hist)
+      f->dump_unsigned("count", count);
+    f->close_section();
+  }
+};
+
+struct phase_state {
+  std::mutex mutex;
+  std::condition_variable cond;
+  int inflight = 0;
+  int commits = 0;
+  std::vector<double> lat_us;
+};
+
+// ondisk: record commit latency
+class C_PhaseCommit : public Context {
+  phase_state *st;
+  std::chrono::high_resolution_clock::time_point start;
+public:
+  C_PhaseCommit(phase_state *st,
+                std::chrono::high_resolution_clock::time_point start)
+    : st(st), start(start) {}
+  void finish(int r) {
+    using namespace std::chrono;
+    auto us = duration_cast<microseconds>(
+        high_resolution_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(st->mutex);
+    st->lat_us.push_back(us);
+    st->commits++;
+    st->cond.notify_all();
+  }
+};
+
+// onreadable: the transaction is no longer referenced, free the slot
+class C_PhaseApply : public Context {
+  phase_state *st;
+  ObjectStore::Transaction *t;
+public:
+  C_PhaseApply(phase_state *st, ObjectStore::Transaction *t)
+    : st(st), t(t) {}
+  void finish(int r) {
+    delete t;
+    std::lock_guard<std::mutex> lock(st->mutex);
+    st->inflight--;
+    st->cond.notify_all();
+  }
+};
+
+phase_result run_phase(ObjectStore *os, const Config &cfg, const coll_t cid,
+                       const std::vector<ghobject_t> &oids,
+                       workload_t workload, int queue_depth)
+{
+  using namespace std::chrono;
+
+  phase_result result;
+  result.workload = workload;
+  result.queue_depth = queue_depth;
+  result.ops = cfg.ops;
+
+  dout(0) << "phase " << workload_name(workload)
+      << " queue-depth " << queue_depth
+      << " ops " << cfg.ops << dendl;
+
+  bufferlist data;
+  data.append(buffer::create(cfg.block_size));
+  bufferlist attrval;
+  attrval.append(buffer::create(256));
+
+  // fixed seed so every backend sees the same op stream
+  std::mt19937 rng(42);
+  const size_t blocks_per_object =
+    std::max<size_t>(1, cfg.size / cfg.block_size);
+
+  ObjectStore::Sequencer osr("osbench-matrix");
+  phase_state st;
+
+  auto t1 = high_resolution_clock::now();
+  for (int i = 0; i < cfg.ops; ++i) {
+    auto t = new ObjectStore::Transaction;
+    const ghobject_t &oid = oids[rng() % oids.size()];
+    workload_t w = workload;
+    if (w == WORKLOAD_MIXED)
+      w = static_cast<workload_t>(i % 3);
+    switch (w) {
+    case WORKLOAD_SMALLWRITE:
+      t->write(cid, oid, (rng() % blocks_per_object) * cfg.block_size,
+               cfg.block_size, data);
+      break;
+    case WORKLOAD_OMAP:
+      {
+        std::stringstream key;
+        key << "osbench." << (rng() % 1024);
+        map<string, bufferlist> kv;
+        kv[key.str()] = attrval;
+        t->omap_setkeys(cid, oid, kv);
+      }
+      break;
+    case WORKLOAD_ATTR:
+      {
+        std::stringstream name;
+        name << "osbench." << (rng() % 8);
+        t->setattr(cid, oid, name.str(), attrval);
+      }
+      break;
+    default:
+      assert(0);
+    }
+
+    std::unique_lock<std::mutex> lock(st.mutex);
+    st.cond.wait(lock, [&st, queue_depth]() {
+        return st.inflight < queue_depth;
+      });
+    st.inflight++;
+    lock.unlock();
+
+    os->queue_transaction(&osr, t, new C_PhaseApply(&st, t),
+                          new C_PhaseCommit(&st,
+                                            high_resolution_clock::now()));
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(st.mutex);
+    st.cond.wait(lock, [&st, &cfg]() {
+        return st.inflight == 0 && st.commits == cfg.ops;
+      });
+  }
+  osr.flush();
+  auto t2 = high_resolution_clock::now();
+
+  result.duration_sec = duration_cast<microseconds>(t2 - t1).count() / 1e6;
+  result.lat_us.swap(st.lat_us);
+  std::sort(result.lat_us.begin(), result.lat_us.end());
+  result.hist.assign(32, 0);
+  for (auto us : result.lat_us) {
+    size_t bucket = 0;
+    while ((1ull << (bucket + 1)) <= (uint64_t)us && bucket < 31)
+      bucket++;
+    result.hist[bucket]++;
+  }
+
+  dout(0) << "phase " << workload_name(workload)
+      << " qd " << queue_depth
+      << " " << (int)(result.duration_sec > 0 ?
+                      cfg.ops / result.duration_sec : 0) << " iops"
+      << " p50 " << result.percentile(50) << "us"
+      << " p99 " << result.percentile(99) << "us" << dendl;
+  return result;
+}
+
+int run_matrix(ObjectStore *os, const Config &cfg, const coll_t cid,
+               const spg_t pg)
+{
+  std::vector<workload_t> workloads;
+  {
+    std::stringstream ss(cfg.workloads);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      workload_t w;
+      if (!parse_workload(item, &w)) {
+        derr << "unknown workload '" << item << "'" << dendl;
+        return 1;
+      }
+      workloads.push_back(w);
+    }
+  }
+  std::vector<int> queue_depths;
+  {
+    std::stringstream ss(cfg.queue_depths);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      int qd = atoi(item.c_str());
+      if (qd < 1) {
+        derr << "invalid queue depth '" << item << "'" << dendl;
+        return 1;
+      }
+      queue_depths.push_back(qd);
+    }
+  }
+  if (workloads.empty() || queue_depths.empty()) {
+    derr << "need at least one workload and one queue depth" << dendl;
+    return 1;
+  }
+
+  std::unique_ptr<Formatter> f(Formatter::create(cfg.format));
+  if (!f) {
+    derr << "bad format '" << cfg.format << "'" << dendl;
+    return 1;
+  }
+
+  std::vector<phase_result> results;
+  for (auto workload : workloads) {
+    for (auto qd : queue_depths) {
+      // recreate the objects so phases start from the same state
+      std::vector<ghobject_t> oids;
+      for (int i = 0; i < cfg.num_objects; i++) {
+        std::stringstream oss;
+        oss << "osbench-matrix-" << i;
+        oids.emplace_back(pg.make_temp_object(oss.str()));
+
+        ObjectStore::Transaction t;
+        if (os->exists(cid, oids[i]))
+          t.remove(cid, oids[i]);
+        t.touch(cid, oids[i]);
+        int r = os->apply_transaction(t);
+        assert(r == 0);
+      }
+
+      results.push_back(run_phase(os, cfg, cid, oids, workload, qd));
+
+      ObjectStore::Transaction t;
+      for (const auto &oid : oids)
+        t.remove(cid, oid);
+      os->apply_transaction(t);
+    }
+  }
+
+  f->open_object_section("objectstore_bench");
+  f->dump_string("backend", g_conf->osd_objectstore);
+  f->dump_unsigned("block_size", cfg.block_size);
+  f->dump_unsigned("object_size", cfg.size);
+  f->dump_int("num_objects", cfg.num_objects);
+  f->open_array_section("phases");
+  for (const auto &result : results) {
+    f->open_object_section("phase");
+    result.dump(f.get());
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+  f->flush(std::cout);
+  std::cout << std::endl;
+  return 0;
+}
+
 void osbench_worker(ObjectStore *os, const Config &cfg,
                     const coll_t cid, const ghobject_t oid,
                     uint64_t starting_offset)
@@ -182,6 +510,16 @@ int main(int argc, const char *argv[])
       cfg.threads = atoi(val.c_str());
     } else if (ceph_argparse_flag(args, i, "--multi-object", (char*)nullptr)) {
       cfg.multi_object = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--workloads", (char*)nullptr)) {
+      cfg.workloads = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--queue-depths", (char*)nullptr)) {
+      cfg.queue_depths = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--ops", (char*)nullptr)) {
+      cfg.ops = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--num-objects", (char*)nullptr)) {
+      cfg.num_objects = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--format", (char*)nullptr)) {
+      cfg.format = val;
     } else {
       derr << "Error: can't understand argument: " << *i << "\n" << dendl;
       usage();
@@ -228,6 +566,13 @@ int main(int argc, const char *argv[])
     os->apply_transaction(t);
   }
 
+  // structured workload/queue-depth matrix?
+  if (!cfg.workloads.empty()) {
+    int r = run_matrix(os.get(), cfg, cid, pg);
+    os->umount();
+    return r;
+  }
+
   // create the objects
   std::vector<ghobject_t> oids;
   if (cfg.multi_object) {
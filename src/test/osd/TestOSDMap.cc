@@ -228,6 +228,44 @@ TEST_F(OSDMapTest, PGTempRespected) {
   EXPECT_EQ(new_acting_osds, acting_osds);
 }
 
+TEST_F(OSDMapTest, PgUpmapRespected) {
+  set_up_map();
+
+  pg_t rawpg(0, 0, -1);
+  pg_t pgid = osdmap.raw_pg_to_pg(rawpg);
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+
+  // reverse the crush-computed mapping via an explicit exception
+  vector<int> new_up_osds(up_osds.rbegin(), up_osds.rend());
+
+  OSDMap::Incremental upmap_map(osdmap.get_epoch() + 1);
+  upmap_map.new_pg_upmap[pgid] = vector<int32_t>(new_up_osds.begin(),
+						 new_up_osds.end());
+  osdmap.apply_incremental(upmap_map);
+  EXPECT_TRUE(osdmap.have_pg_upmap(pgid));
+
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  EXPECT_EQ(new_up_osds, up_osds);
+
+  // and it survives an encode/decode round trip
+  bufferlist bl;
+  osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+  OSDMap osdmap2;
+  osdmap2.decode(bl);
+  EXPECT_TRUE(osdmap2.have_pg_upmap(pgid));
+
+  // removal via an empty vector
+  OSDMap::Incremental rm_map(osdmap.get_epoch() + 1);
+  rm_map.new_pg_upmap[pgid].clear();
+  osdmap.apply_incremental(rm_map);
+  EXPECT_FALSE(osdmap.have_pg_upmap(pgid));
+}
+
 TEST_F(OSDMapTest, PrimaryTempRespected) {
   set_up_map();
 
@@ -187,3 +187,35 @@ TEST(PerfCounters, MultiplePerfCounters) {
   ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
   ASSERT_EQ("{}", msg);
 }
+
+TEST(PerfCounters, DeltaDump) {
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCounters* fake_pf = setup_test_perfcounter2(g_ceph_context);
+  coll->add(fake_pf);
+  AdminSocketClient client(get_rand_socket_path());
+  std::string msg;
+
+  // no cursor: full dump, establishes the first snapshot
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump_delta\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{'cursor':1,'full':1,'perfcounter_collection':"
+	    "{'test_perfcounter_2':{'foo':0,'bar':0.000000000}}}"), msg);
+
+  // nothing changed since cursor 1: empty delta
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump_delta\", \"cursor\": 1, \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{'cursor':2,'full':0,'perfcounter_collection':"
+	    "{'test_perfcounter_2':{}}}"), msg);
+
+  // only the counter that moved shows up
+  fake_pf->inc(TEST_PERFCOUNTERS2_ELEMENT_FOO, 3);
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump_delta\", \"cursor\": 2, \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{'cursor':3,'full':0,'perfcounter_collection':"
+	    "{'test_perfcounter_2':{'foo':3}}}"), msg);
+
+  // a stale cursor degrades to a full dump
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump_delta\", \"cursor\": 1, \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{'cursor':4,'full':1,'perfcounter_collection':"
+	    "{'test_perfcounter_2':{'foo':3,'bar':0.000000000}}}"), msg);
+
+  coll->clear();
+}
@@ -223,3 +223,17 @@ TEST(RBDReplay, batch_unreachable_from) {
   EXPECT_EQ(0U, unreachable.count(io8));
   EXPECT_EQ(0U, unreachable.count(io9));
 }
+
+TEST(RBDReplay, io_touches) {
+  IO::ptr w(new WriteIO(1, 1, 0, IO::ptr(), 1, 100, 10));
+  EXPECT_TRUE(w->is_write());
+  EXPECT_TRUE(w->touches(1, 105, 10));
+  EXPECT_TRUE(w->touches(1, 95, 10));
+  EXPECT_FALSE(w->touches(1, 110, 10));
+  EXPECT_FALSE(w->touches(1, 90, 10));
+  EXPECT_FALSE(w->touches(2, 100, 10));
+  IO::ptr r(new AioReadIO(3, 2, 0, IO::ptr(), 1, 0, 8));
+  EXPECT_FALSE(r->is_write());
+  EXPECT_TRUE(r->touches(1, 7, 1));
+  EXPECT_FALSE(r->touches(1, 8, 1));
+}
@@ -26,6 +26,29 @@ TEST(Striper, Stripe1)
   ASSERT_EQ(94208u, ex[2].truncate_size);
 }
 
+TEST(Striper, NonPowerOfTwoObjectSize)
+{
+  ceph_file_layout l;
+  memset(&l, 0, sizeof(l));
+
+  l.fl_object_size = 3000000;
+  l.fl_stripe_unit = 3000000;
+  l.fl_stripe_count = 1;
+
+  vector<ObjectExtent> ex;
+  Striper::file_to_extents(g_ceph_context, 1, &l, 2999000, 2000, 0, ex);
+
+  cout << "result " << ex << std::endl;
+
+  ASSERT_EQ(2u, ex.size());
+  ASSERT_EQ(0u, ex[0].objectno);
+  ASSERT_EQ(2999000u, ex[0].offset);
+  ASSERT_EQ(1000u, ex[0].length);
+  ASSERT_EQ(1u, ex[1].objectno);
+  ASSERT_EQ(0u, ex[1].offset);
+  ASSERT_EQ(1000u, ex[1].length);
+}
+
 TEST(Striper, EmptyPartialResult)
 {
   ceph_file_layout l;
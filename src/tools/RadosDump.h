@@ -193,24 +193,45 @@ struct object_begin {
 };
 
 struct data_section {
+  enum {
+    COMP_NONE = 0,
+    COMP_SNAPPY = 1,
+  };
   uint64_t offset;
-  uint64_t len;
+  uint64_t len;		// uncompressed length
+  __u8 compression;
   bufferlist databl;
   data_section(uint64_t offset, uint64_t len, bufferlist bl):
-     offset(offset), len(len), databl(bl) { }
-  data_section(): offset(0), len(0) { }
+     offset(offset), len(len), compression(COMP_NONE), databl(bl) { }
+  data_section(): offset(0), len(0), compression(COMP_NONE) { }
 
   void encode(bufferlist& bl) const {
-    ENCODE_START(1, 1, bl);
-    ::encode(offset, bl);
-    ::encode(len, bl);
-    ::encode(databl, bl);
-    ENCODE_FINISH(bl);
+    if (compression == COMP_NONE) {
+      // Keep uncompressed exports decodable by older tools
+      ENCODE_START(1, 1, bl);
+      ::encode(offset, bl);
+      ::encode(len, bl);
+      ::encode(databl, bl);
+      ENCODE_FINISH(bl);
+    } else {
+      // Compressed data would be silently imported as-is by an older
+      // tool, so bump compat to make it fail the decode up front.
+      ENCODE_START(2, 2, bl);
+      ::encode(offset, bl);
+      ::encode(len, bl);
+      ::encode(compression, bl);
+      ::encode(databl, bl);
+      ENCODE_FINISH(bl);
+    }
   }
   void decode(bufferlist::iterator& bl) {
-    DECODE_START(1, bl);
+    DECODE_START(2, bl);
     ::decode(offset, bl);
     ::decode(len, bl);
+    if (struct_v > 1)
+      ::decode(compression, bl);
+    else
+      compression = COMP_NONE;
     ::decode(databl, bl);
     DECODE_FINISH(bl);
   }
@@ -381,6 +402,22 @@ class RadosDump
         return ret;
       }
 
+    // Serialize a section into a bufferlist instead of writing it to
+    // the fd, so sections can be assembled off the output path.
+    template <typename T>
+      int write_section(sectiontype_t type, const T& obj, bufferlist& out) {
+        if (dry_run)
+          return 0;
+        bufferlist bl;
+        obj.encode(bl);
+        header hdr(type, bl.length());
+        hdr.encode(out);
+        out.claim_append(bl);
+        footer ft;
+        ft.encode(out);
+        return 0;
+      }
+
     int write_simple(sectiontype_t type, int fd)
     {
       if (dry_run)
@@ -391,6 +428,15 @@ class RadosDump
       hdr.encode(hbl);
       return hbl.write_fd(fd);
     }
+
+    int write_simple(sectiontype_t type, bufferlist& out)
+    {
+      if (dry_run)
+        return 0;
+      header hdr(type, 0);
+      hdr.encode(out);
+      return 0;
+    }
 };
 
 #endif
@@ -21,6 +21,10 @@
 #include "common/Formatter.h"
 #include "common/errno.h"
 #include "common/ceph_argparse.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
+
+#include "compressor/SnappyCompressor.h"
 
 #include "global/global_init.h"
 
@@ -285,6 +289,8 @@ int file_fd = fd_none;
 bool debug = false;
 super_header sh;
 uint64_t testalign;
+int export_threads = 1;
+bool export_compress = false;
 
 // Convert non-printable characters to '\###'
 static void cleanbin(string &str)
@@ -553,11 +559,16 @@ void get_omap_batch(ObjectMap::ObjectMapIterator &iter, map<string, bufferlist>
   }
 }
 
-int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj)
+// Serialize all of obj's sections.  With out == NULL write (and flush)
+// directly to file_fd; otherwise assemble into *out so a caller can
+// write objects in a different order than they were read.
+int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj,
+    bufferlist *out)
 {
   struct stat st;
   mysize_t total;
   footer ft;
+  bufferlist obl;
 
   int ret = store->stat(cid, obj, &st);
   if (ret < 0)
@@ -587,10 +598,11 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
   // XXX: Should we be checking for WHITEOUT or LOST in objb.oi.flags and skip?
 
-  ret = write_section(TYPE_OBJECT_BEGIN, objb, file_fd);
+  ret = write_section(TYPE_OBJECT_BEGIN, objb, obl);
   if (ret < 0)
     return ret;
 
+  SnappyCompressor snappy;
   uint64_t offset = 0;
   bufferlist rawdatabl;
   while(total > 0) {
@@ -606,14 +618,31 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
       return -EINVAL;
 
     data_section dblock(offset, len, rawdatabl);
+    if (export_compress) {
+      bufferlist cbl;
+      ret = snappy.compress(rawdatabl, cbl);
+      if (ret < 0) {
+	cerr << "compress failure " << ret << std::endl;
+	return -EFAULT;
+      }
+      dblock.compression = data_section::COMP_SNAPPY;
+      dblock.databl.swap(cbl);
+    }
     if (debug)
       cerr << "data section offset=" << offset << " len=" << len << std::endl;
 
     total -= ret;
     offset += ret;
 
-    ret = write_section(TYPE_DATA, dblock, file_fd);
+    ret = write_section(TYPE_DATA, dblock, obl);
     if (ret) return ret;
+
+    // keep memory bounded when we are writing straight to the fd
+    if (!out && obl.length()) {
+      ret = obl.write_fd(file_fd);
+      if (ret) return ret;
+      obl.clear();
+    }
   }
 
   //Handle attrs for this object
@@ -621,7 +650,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   ret = store->getattrs(cid, obj, aset);
   if (ret) return ret;
   attr_section as(aset);
-  ret = write_section(TYPE_ATTRS, as, file_fd);
+  ret = write_section(TYPE_ATTRS, as, obl);
   if (ret)
     return ret;
 
@@ -638,7 +667,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
 
   omap_hdr_section ohs(hdrbuf);
-  ret = write_section(TYPE_OMAP_HDR, ohs, file_fd);
+  ret = write_section(TYPE_OMAP_HDR, ohs, obl);
   if (ret)
     return ret;
 
@@ -650,51 +679,180 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
   iter->seek_to_first();
   int mapcount = 0;
-  map<string, bufferlist> out;
+  map<string, bufferlist> omap_out;
   while(iter->valid()) {
-    get_omap_batch(iter, out);
+    get_omap_batch(iter, omap_out);
 
-    if (out.empty()) break;
+    if (omap_out.empty()) break;
 
-    mapcount += out.size();
-    omap_section oms(out);
-    ret = write_section(TYPE_OMAP, oms, file_fd);
+    mapcount += omap_out.size();
+    omap_section oms(omap_out);
+    ret = write_section(TYPE_OMAP, oms, obl);
     if (ret)
       return ret;
   }
   if (debug)
     cerr << "omap map size " << mapcount << std::endl;
 
-  ret = write_simple(TYPE_OBJECT_END, file_fd);
+  ret = write_simple(TYPE_OBJECT_END, obl);
   if (ret)
     return ret;
 
+  if (out) {
+    out->claim_append(obl);
+  } else if (obl.length()) {
+    ret = obl.write_fd(file_fd);
+    if (ret)
+      return ret;
+  }
+
   return 0;
 }
 
+// Shared state for the parallel export path.  Workers claim objects in
+// listing order and serialize them into their slot; the main thread
+// writes finished slots to the fd in order, so the stream is identical
+// to a serial export.  Workers stay within a window of the writer to
+// bound how much serialized data can pile up in memory.
+struct export_ctx_t {
+  ObjectStoreTool *tool;
+  ObjectStore *store;
+  coll_t cid;
+  const vector<ghobject_t> *objects;
+  vector<bufferlist> sections;
+  vector<int> ret;
+  vector<bool> done;
+  size_t next;
+  size_t written;
+  size_t window;
+  bool error;
+  Mutex lock;
+  Cond cond;
+
+  export_ctx_t(ObjectStoreTool *tool, ObjectStore *store, coll_t cid,
+	       const vector<ghobject_t> *objects, size_t window)
+    : tool(tool), store(store), cid(cid), objects(objects),
+      sections(objects->size()), ret(objects->size(), 0),
+      done(objects->size(), false),
+      next(0), written(0), window(window), error(false),
+      lock("export_ctx_t::lock") {}
+};
+
+class ExportWorker : public Thread {
+  export_ctx_t *ctx;
+public:
+  explicit ExportWorker(export_ctx_t *ctx) : ctx(ctx) {}
+  void *entry() {
+    while (true) {
+      ctx->lock.Lock();
+      while (ctx->next < ctx->objects->size() && !ctx->error &&
+	     ctx->next >= ctx->written + ctx->window)
+	ctx->cond.Wait(ctx->lock);
+      if (ctx->next >= ctx->objects->size() || ctx->error) {
+	ctx->lock.Unlock();
+	break;
+      }
+      size_t i = ctx->next++;
+      ctx->lock.Unlock();
+
+      ghobject_t obj = (*ctx->objects)[i];
+      bufferlist bl;
+      int r = ctx->tool->export_file(ctx->store, ctx->cid, obj, &bl);
+
+      ctx->lock.Lock();
+      ctx->sections[i].claim(bl);
+      ctx->ret[i] = r;
+      ctx->done[i] = true;
+      if (r < 0)
+	ctx->error = true;
+      ctx->cond.Signal();
+      ctx->lock.Unlock();
+    }
+    return NULL;
+  }
+};
+
 int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
 {
   ghobject_t next;
+  vector<ghobject_t> objects;
 
   while (!next.is_max()) {
-    vector<ghobject_t> objects;
+    vector<ghobject_t> batch;
     int r = store->collection_list(coll, next, ghobject_t::get_max(), true, 300,
-      &objects, &next);
+      &batch, &next);
     if (r < 0)
       return r;
-    for (vector<ghobject_t>::iterator i = objects.begin();
-	 i != objects.end();
+    for (vector<ghobject_t>::iterator i = batch.begin();
+	 i != batch.end();
 	 ++i) {
       assert(!i->hobj.is_meta());
       if (i->is_pgmeta() || i->hobj.is_temp()) {
 	continue;
       }
-      r = export_file(store, coll, *i);
+      objects.push_back(*i);
+    }
+  }
+
+  if (export_threads <= 1) {
+    for (vector<ghobject_t>::iterator i = objects.begin();
+	 i != objects.end();
+	 ++i) {
+      int r = export_file(store, coll, *i, NULL);
       if (r < 0)
         return r;
     }
+    return 0;
   }
-  return 0;
+
+  export_ctx_t ctx(this, store, coll, &objects, export_threads * 2);
+  vector<ExportWorker*> workers;
+  for (int i = 0; i < export_threads; ++i) {
+    workers.push_back(new ExportWorker(&ctx));
+    workers.back()->create();
+  }
+
+  int ret = 0;
+  for (size_t i = 0; i < objects.size(); ++i) {
+    ctx.lock.Lock();
+    while (!ctx.done[i])
+      ctx.cond.Wait(ctx.lock);
+    int r = ctx.ret[i];
+    bufferlist bl;
+    bl.claim(ctx.sections[i]);
+    ctx.lock.Unlock();
+
+    if (r < 0) {
+      ret = r;
+      break;
+    }
+    if (!dry_run && bl.length()) {
+      r = bl.write_fd(file_fd);
+      if (r) {
+	ret = r;
+	break;
+      }
+    }
+
+    ctx.lock.Lock();
+    ctx.written = i + 1;
+    ctx.cond.Signal();
+    ctx.lock.Unlock();
+  }
+
+  ctx.lock.Lock();
+  ctx.error = ctx.error || ret < 0;
+  if (ret < 0)
+    ctx.cond.Signal();
+  ctx.lock.Unlock();
+
+  for (vector<ExportWorker*>::iterator i = workers.begin();
+       i != workers.end();
+       ++i) {
+    (*i)->join();
+    delete *i;
+  }
+  return ret;
 }
 
 int set_inc_osdmap(ObjectStore *store, epoch_t e, bufferlist& bl, bool force) {
@@ -858,6 +1016,22 @@ int get_data(ObjectStore *store, coll_t coll, ghobject_t hoid,
   data_section ds;
   ds.decode(ebliter);
 
+  if (ds.compression != data_section::COMP_NONE) {
+    if (ds.compression != data_section::COMP_SNAPPY) {
+      cerr << "Unknown data section compression " << (int)ds.compression
+	   << std::endl;
+      return -EINVAL;
+    }
+    SnappyCompressor snappy;
+    bufferlist rawbl;
+    if (snappy.decompress(ds.databl, rawbl) < 0 ||
+	rawbl.length() != ds.len) {
+      cerr << "Corrupt compressed data section" << std::endl;
+      return -EFAULT;
+    }
+    ds.databl.swap(rawbl);
+  }
+
   if (debug)
     cerr << "\tdata: offset " << ds.offset << " len " << ds.len << std::endl;
   t->write(coll, hoid, ds.offset, ds.len,  ds.databl);
@@ -1924,6 +2098,9 @@ int main(int argc, char **argv)
     ("skip-journal-replay", "Disable journal replay")
     ("skip-mount-omap", "Disable mounting of omap")
     ("dry-run", "Don't modify the objectstore")
+    ("export-threads", po::value<int>(&export_threads)->default_value(1),
+     "Number of concurrent object readers for export")
+    ("compress", "Snappy-compress object data on export (importing tool must support it)")
     ;
 
   po::options_description positional("Positional options");
@@ -1974,6 +2151,13 @@ int main(int argc, char **argv)
 
   if (vm.count("dry-run"))
     dry_run = true;
+
+  if (vm.count("compress"))
+    export_compress = true;
+  if (export_threads < 1) {
+    cerr << "Invalid --export-threads " << export_threads << std::endl;
+    myexit(1);
+  }
   osflagbits_t flags = 0;
   if (dry_run || vm.count("skip-journal-replay"))
     flags |= SKIP_JOURNAL_REPLAY;
@@ -33,7 +33,8 @@ class ObjectStoreTool : public RadosDump
     int get_object(ObjectStore *store, coll_t coll,
         bufferlist &bl, OSDMap &curmap, bool *skipped_objects);
     int export_file(
-        ObjectStore *store, coll_t cid, ghobject_t &obj);
+        ObjectStore *store, coll_t cid, ghobject_t &obj,
+        bufferlist *out);
     int export_files(ObjectStore *store, coll_t coll);
 };
 
@@ -173,6 +173,9 @@ void usage()
   cout << "      [--min-rule r] [--max-rule r] [--rule r]\n";
   cout << "      [--num-rep n]\n";
   cout << "      [--batches b]      split the CRUSH mapping into b > 1 rounds\n";
+  cout << "      [--threads n]      simulate mappings across n worker threads\n";
+  cout << "      [--convergence e]  stop simulating early once no device's\n";
+  cout << "                         placement proportion moves by more than e\n";
   cout << "      [--weight|-w devno weight]\n";
   cout << "                         where weight is 0 to 1.0\n";
   cout << "      [--simulate]       simulate placements using a random\n";
@@ -471,6 +474,18 @@ int main(int argc, const char **argv)
 	exit(EXIT_FAILURE);
       }
       tester.set_batches(x);
+    } else if (ceph_argparse_witharg(args, i, &x, err, "--threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
+      tester.set_num_threads(x);
+    } else if (ceph_argparse_witharg(args, i, &y, err, "--convergence", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
+      tester.set_convergence_tolerance(y);
     } else if (ceph_argparse_witharg(args, i, &y, err, "--mark-down-ratio", (char*)NULL)) {
       if (!err.str().empty()) {
         cerr << err.str() << std::endl;
@@ -12,6 +12,7 @@
  * 
  */
 
+#include <fstream>
 #include <string>
 #include <sys/stat.h>
 
@@ -23,6 +24,162 @@
 
 using namespace std;
 
+/*
+ * Workload simulation (--test-map-load): project per-OSD load from
+ * per-pool op rates and the actual CRUSH mapping.
+ *
+ * The workload descriptor is a plain text file:
+ *
+ *   # comment
+ *   pool <poolid> <read_iops> <write_iops> <read_mbps> <write_mbps>
+ *   device-default <iops_capacity> <mbps_capacity>
+ *   device <osdid> <iops_capacity> <mbps_capacity>
+ *
+ * Each pool's rates are spread evenly over its PGs.  Reads land on the
+ * primary only; writes land on every member of the acting set (for EC
+ * pools, every shard).  Devices whose projected load exceeds their
+ * capability profile are flagged.
+ */
+
+struct pool_load_t {
+  double read_iops, write_iops, read_mbps, write_mbps;
+  pool_load_t() : read_iops(0), write_iops(0), read_mbps(0), write_mbps(0) {}
+};
+
+struct device_profile_t {
+  double iops_capacity, mbps_capacity;
+  device_profile_t() : iops_capacity(0), mbps_capacity(0) {}
+};
+
+static int parse_workload_descriptor(const char *me, const std::string &fn,
+				     map<int64_t, pool_load_t> *pool_load,
+				     device_profile_t *dev_default,
+				     map<int, device_profile_t> *dev_profiles)
+{
+  ifstream in(fn.c_str());
+  if (!in.is_open()) {
+    cerr << me << ": couldn't open workload descriptor " << fn << std::endl;
+    return -1;
+  }
+  string line;
+  int lineno = 0;
+  while (getline(in, line)) {
+    ++lineno;
+    size_t pos = line.find('#');
+    if (pos != string::npos)
+      line.resize(pos);
+    istringstream ss(line);
+    string tag;
+    if (!(ss >> tag))
+      continue;  // blank line
+    bool ok = true;
+    if (tag == "pool") {
+      int64_t id;
+      pool_load_t l;
+      ok = !(ss >> id >> l.read_iops >> l.write_iops
+	       >> l.read_mbps >> l.write_mbps).fail();
+      if (ok)
+	(*pool_load)[id] = l;
+    } else if (tag == "device-default") {
+      ok = !(ss >> dev_default->iops_capacity
+	       >> dev_default->mbps_capacity).fail();
+    } else if (tag == "device") {
+      int id;
+      device_profile_t p;
+      ok = !(ss >> id >> p.iops_capacity >> p.mbps_capacity).fail();
+      if (ok)
+	(*dev_profiles)[id] = p;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      cerr << me << ": " << fn << ":" << lineno
+	   << ": couldn't parse '" << line << "'" << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int test_map_load(const char *me, OSDMap &osdmap,
+			 const std::string &descriptor_fn)
+{
+  map<int64_t, pool_load_t> pool_load;
+  device_profile_t dev_default;
+  map<int, device_profile_t> dev_profiles;
+  if (parse_workload_descriptor(me, descriptor_fn, &pool_load,
+				&dev_default, &dev_profiles) < 0)
+    return -1;
+
+  int n = osdmap.get_max_osd();
+  vector<double> read_iops(n, 0), write_iops(n, 0);
+  vector<double> read_mbps(n, 0), write_mbps(n, 0);
+
+  for (map<int64_t, pool_load_t>::const_iterator p = pool_load.begin();
+       p != pool_load.end(); ++p) {
+    if (!osdmap.have_pg_pool(p->first)) {
+      cerr << "There is no pool " << p->first << std::endl;
+      return -1;
+    }
+    const pg_pool_t *pi = osdmap.get_pg_pool(p->first);
+    unsigned pg_num = pi->get_pg_num();
+    const pool_load_t &l = p->second;
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      pg_t pgid(ps, p->first);
+      vector<int> acting;
+      int primary;
+      osdmap.pg_to_acting_osds(pgid, &acting, &primary);
+      if (primary >= 0) {
+	read_iops[primary] += l.read_iops / pg_num;
+	read_mbps[primary] += l.read_mbps / pg_num;
+      }
+      for (unsigned i = 0; i < acting.size(); i++) {
+	write_iops[acting[i]] += l.write_iops / pg_num;
+	write_mbps[acting[i]] += l.write_mbps / pg_num;
+      }
+    }
+  }
+
+  int flagged = 0;
+  cout << "#osd\tr_iops\tw_iops\tiops\tcap\tr_mbps\tw_mbps\tmbps\tcap\tutil%\n";
+  for (int i = 0; i < n; i++) {
+    if (!osdmap.is_in(i))
+      continue;
+    device_profile_t prof = dev_default;
+    map<int, device_profile_t>::const_iterator dp = dev_profiles.find(i);
+    if (dp != dev_profiles.end())
+      prof = dp->second;
+    double iops = read_iops[i] + write_iops[i];
+    double mbps = read_mbps[i] + write_mbps[i];
+    double util = 0;
+    if (prof.iops_capacity > 0)
+      util = max(util, iops / prof.iops_capacity * 100.0);
+    if (prof.mbps_capacity > 0)
+      util = max(util, mbps / prof.mbps_capacity * 100.0);
+    bool over = util > 100.0;
+    if (over)
+      flagged++;
+    cout << "osd." << i
+	 << "\t" << (int)read_iops[i]
+	 << "\t" << (int)write_iops[i]
+	 << "\t" << (int)iops
+	 << "\t" << (int)prof.iops_capacity
+	 << "\t" << (int)read_mbps[i]
+	 << "\t" << (int)write_mbps[i]
+	 << "\t" << (int)mbps
+	 << "\t" << (int)prof.mbps_capacity
+	 << "\t" << (int)util
+	 << (over ? "\tOVERLOADED" : "")
+	 << std::endl;
+  }
+  if (flagged)
+    cout << flagged << " device(s) would exceed their capability profile"
+	 << std::endl;
+  else
+    cout << "all devices within their capability profiles" << std::endl;
+  return flagged ? 1 : 0;
+}
+
 void usage()
 {
   cout << " usage: [--print] [--createsimple <numosd> [--clobber] [--pg_bits <bitsperosd>]] <mapfilename>" << std::endl;
@@ -36,6 +193,9 @@ void usage()
   cout << "   --test-map-pg <pgid>    map a pgid to osds" << std::endl;
   cout << "   --test-map-object <objectname> [--pool <poolid>] map an object to osds"
        << std::endl;
+  cout << "   --test-map-load <file>  project per-osd load from a workload" << std::endl;
+  cout << "                           descriptor; exits 1 if any device would" << std::endl;
+  cout << "                           exceed its capability profile" << std::endl;
   exit(1);
 }
 
@@ -73,6 +233,7 @@ int main(int argc, const char **argv)
   bool test_map_pgs = false;
   bool test_map_pgs_dump = false;
   bool test_random = false;
+  std::string test_map_load_fn;
 
   std::string val;
   std::ostringstream err;
@@ -111,6 +272,8 @@ int main(int argc, const char **argv)
       test_map_pgs_dump = true;
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--test-map-load", (char*)NULL)) {
+      test_map_load_fn = val;
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
       clobber = true;
     } else if (ceph_argparse_witharg(args, i, &pg_bits, err, "--pg_bits", (char*)NULL)) {
@@ -230,6 +393,8 @@ int main(int argc, const char **argv)
       osdmap.set_weight(i, CEPH_OSD_IN);
       osdmap.crush->adjust_item_weightf(g_ceph_context, i, 1.0);
     }
+    // we went behind OSDMap's back to poke crush
+    osdmap.invalidate_mapping_cache();
   }
   if (clear_temp) {
     cout << "clearing pg/primary temp" << std::endl;
@@ -426,6 +591,12 @@ int main(int argc, const char **argv)
       cout << "size " << i << "\t" << size[i] << std::endl;
     }
   }
+  int load_r = 0;
+  if (!test_map_load_fn.empty()) {
+    load_r = test_map_load(me, osdmap, test_map_load_fn);
+    if (load_r < 0)
+      exit(1);
+  }
   if (test_crush) {
     int pass = 0;
     while (1) {
@@ -460,7 +631,7 @@ int main(int argc, const char **argv)
   if (!print && !tree && !modified &&
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
-      !test_map_pgs && !test_map_pgs_dump) {
+      !test_map_pgs && !test_map_pgs_dump && test_map_load_fn.empty()) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
   }
@@ -505,7 +676,7 @@ int main(int argc, const char **argv)
       return 1;
     }
   }
-  
 
-  return 0;
+
+  return load_r;
 }
@@ -191,6 +191,8 @@ void usage(ostream& out)
 "        prefix output with date/time\n"
 "   --no-verify\n"
 "        do not verify contents of read objects\n"
+"   --target-iops=N\n"
+"        pace ops at a fixed rate instead of running flat out (open-loop)\n"
 "\n"
 "LOAD GEN OPTIONS:\n"
 "   --num-objects                    total number of objects\n"
@@ -1180,6 +1182,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   const char *target_pool_name = NULL;
   string oloc, target_oloc, nspace, target_nspace;
   int concurrent_ios = 16;
+  int target_iops = 0;
   unsigned op_size = default_op_size;
   bool block_size_specified = false;
   bool cleanup = true;
@@ -1244,6 +1247,12 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       return -EINVAL;
     }
   }
+  i = opts.find("target-iops");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &target_iops)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("run-name");
   if (i != opts.end()) {
     run_name = i->second;
@@ -2419,6 +2428,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     }
     RadosBencher bencher(g_ceph_context, rados, io_ctx);
     bencher.set_show_time(show_time);
+    bencher.set_target_iops(target_iops);
     ostream *outstream = NULL;
     if (formatter) {
       bencher.set_formatter(formatter);
@@ -2900,6 +2910,8 @@ int main(int argc, const char **argv)
       opts["striper"] = "true";
     } else if (ceph_argparse_witharg(args, i, &val, "-t", "--concurrent-ios", (char*)NULL)) {
       opts["concurrent-ios"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--target-iops", (char*)NULL)) {
+      opts["target-iops"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--block-size", (char*)NULL)) {
       opts["block-size"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-b", (char*)NULL)) {